@@ -49,6 +49,7 @@ int main(int argc, char *argv[]) {
     mfxStatus sts_r                = MFX_ERR_NONE;
     Params cliParams               = {};
     mfxVideoParam encodeParams     = {};
+    RawFrameReader reader;
 
     // variables used only in 2.x version
     mfxConfig cfg[3];
@@ -158,13 +159,21 @@ int main(int argc, char *argv[]) {
             break;
     }
 
+    // Whole frames are read, the next one is prefetched while the current one is encoded
+    sts = reader.Init(source,
+                      encodeParams.mfx.FrameInfo.FourCC,
+                      cliParams.srcWidth,
+                      cliParams.srcHeight,
+                      true);
+    VERIFY(MFX_ERR_NONE == sts, "Could not initialize raw frame reader");
+
     while (isStillGoing == true) {
         // Load a new frame if not draining
         if (isDraining == false) {
             sts = MFXMemory_GetSurfaceForEncode(session, &encSurfaceIn);
             VERIFY(MFX_ERR_NONE == sts, "Could not get encode surface");
 
-            sts = ReadRawFrame_InternalMem(encSurfaceIn, source);
+            sts = reader.ReadFrame_InternalMem(encSurfaceIn);
             if (sts != MFX_ERR_NONE)
                 isDraining = true;
         }
@@ -225,6 +234,7 @@ end:
     // Clean up resources - It is recommended to close components first, before
     // releasing allocated surfaces, since some surfaces may still be locked by
     // internal resources.
+    reader.Close();
     if (source)
         fclose(source);
 
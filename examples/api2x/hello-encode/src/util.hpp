@@ -16,6 +16,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+#endif
 
 #ifdef USE_MEDIASDK1
     #include "mfxvideo.h"
@@ -33,6 +42,7 @@ enum {
 
 #ifdef __linux__
     #include <fcntl.h>
+    #include <sys/uio.h>
     #include <unistd.h>
 #endif
 
@@ -635,4 +645,344 @@ mfxStatus WriteRawFrame_InternalMem(mfxFrameSurface1 *surface, FILE *f) {
 }
 #endif
 
+#if (MFX_VERSION >= 2000)
+// Whole-frame raw reader. Planes are read straight into the surface when the file and
+// surface formats match (one read per plane when the surface pitch equals the row size,
+// batched vectored reads of the rows otherwise). With prefetch, a helper thread reads the
+// next frame into a staging buffer while the current one is copied into the surface.
+// The reader owns all reads from the file, it must not be read by other means.
+class RawFrameReader {
+public:
+    RawFrameReader()
+            : m_file(NULL),
+              m_fourcc(0),
+              m_width(0),
+              m_height(0),
+              m_frameSize(0),
+              m_prefetch(false),
+              m_stop(false),
+              m_readIdx(0),
+              m_slots() {}
+
+    ~RawFrameReader() {
+        Close();
+    }
+
+    // fourcc is the layout of the file: I420, NV12, P010 or BGRA (RGB4), rows packed
+    mfxStatus Init(FILE *f, mfxU32 fourcc, mfxU16 width, mfxU16 height, bool prefetch) {
+        Close();
+        m_frameSize = GetRawFrameSize(fourcc, width, height);
+        if (!f || !m_frameSize)
+            return MFX_ERR_UNSUPPORTED;
+
+        m_file     = f;
+        m_fourcc   = fourcc;
+        m_width    = width;
+        m_height   = height;
+        m_prefetch = prefetch;
+        m_stop     = false;
+        m_readIdx  = 0;
+
+        if (m_prefetch) {
+            for (Slot &slot : m_slots) {
+                slot.data.resize(m_frameSize);
+                slot.full = false;
+                slot.eof  = false;
+            }
+            m_thread = std::thread(&RawFrameReader::PrefetchThread, this);
+        }
+        return MFX_ERR_NONE;
+    }
+
+    void Close() {
+        if (m_thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_cv.notify_all();
+            m_thread.join();
+        }
+        m_file = NULL;
+    }
+
+    // Read one frame into a CPU-accessible surface, MFX_ERR_MORE_DATA at end of file
+    mfxStatus ReadFrame(mfxFrameSurface1 *surface) {
+        if (!m_file)
+            return MFX_ERR_NOT_INITIALIZED;
+
+        mfxU32 dstFourCC = surface->Info.FourCC;
+        bool isConvert   = (dstFourCC != m_fourcc);
+        if (isConvert && !(m_fourcc == MFX_FOURCC_I420 && dstFourCC == MFX_FOURCC_NV12))
+            return MFX_ERR_UNSUPPORTED;
+
+        if (m_prefetch) {
+            Slot &slot = m_slots[m_readIdx];
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [&slot] {
+                    return slot.full;
+                });
+            }
+            if (slot.eof)
+                return MFX_ERR_MORE_DATA;
+
+            CopyFrame(slot.data.data(), surface);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                slot.full = false;
+            }
+            m_cv.notify_all();
+            m_readIdx ^= 1;
+            return MFX_ERR_NONE;
+        }
+
+        if (isConvert) {
+            m_staging.resize(m_frameSize);
+            if (ReadBytes(m_staging.data(), m_frameSize) != m_frameSize)
+                return MFX_ERR_MORE_DATA;
+            CopyFrame(m_staging.data(), surface);
+            return MFX_ERR_NONE;
+        }
+
+        return ReadFrameDirect(surface);
+    }
+
+    // Map, read and unmap an internally allocated surface
+    mfxStatus ReadFrame_InternalMem(mfxFrameSurface1 *surface) {
+        mfxStatus sts = surface->FrameInterface->Map(surface, MFX_MAP_WRITE);
+        if (sts != MFX_ERR_NONE) {
+            printf("mfxFrameSurfaceInterface->Map failed (%d)\n", sts);
+            return sts;
+        }
+
+        mfxStatus sts_read = ReadFrame(surface);
+
+        sts = surface->FrameInterface->Unmap(surface);
+        if (sts != MFX_ERR_NONE) {
+            printf("mfxFrameSurfaceInterface->Unmap failed (%d)\n", sts);
+            return sts;
+        }
+
+        return sts_read;
+    }
+
+    static size_t GetRawFrameSize(mfxU32 fourcc, mfxU16 width, mfxU16 height) {
+        size_t luma = static_cast<size_t>(width) * height;
+        switch (fourcc) {
+            case MFX_FOURCC_I420:
+            case MFX_FOURCC_NV12:
+                return luma + 2 * ((width / 2) * static_cast<size_t>(height / 2));
+            case MFX_FOURCC_P010:
+                return 2 * (luma + 2 * ((width / 2) * static_cast<size_t>(height / 2)));
+            case MFX_FOURCC_RGB4:
+                return luma * 4;
+            default:
+                return 0;
+        }
+    }
+
+private:
+    struct Plane {
+        mfxU8 *ptr;
+        mfxU32 pitch;
+        mfxU32 rowBytes;
+        mfxU32 rows;
+    };
+
+    struct Slot {
+        std::vector<mfxU8> data;
+        bool full;
+        bool eof;
+    };
+
+    // Destination planes of the surface, in file order
+    int GetPlanes(mfxFrameSurface1 *surface, Plane planes[3]) {
+        mfxFrameData &d = surface->Data;
+        mfxU32 w        = m_width;
+        mfxU32 h        = m_height;
+        mfxU32 pitch    = d.Pitch;
+        switch (m_fourcc) {
+            case MFX_FOURCC_I420:
+                planes[0] = { d.Y, pitch, w, h };
+                planes[1] = { d.U, pitch / 2, w / 2, h / 2 };
+                planes[2] = { d.V, pitch / 2, w / 2, h / 2 };
+                return 3;
+            case MFX_FOURCC_NV12:
+                planes[0] = { d.Y, pitch, w, h };
+                planes[1] = { d.UV, pitch, w, h / 2 };
+                return 2;
+            case MFX_FOURCC_P010:
+                planes[0] = { d.Y, pitch, w * 2, h };
+                planes[1] = { d.UV, pitch, w * 2, h / 2 };
+                return 2;
+            case MFX_FOURCC_RGB4:
+                planes[0] = { d.B, pitch, w * 4, h };
+                return 1;
+            default:
+                return 0;
+        }
+    }
+
+    size_t ReadBytes(mfxU8 *dst, size_t size) {
+#ifdef __linux__
+        int fd      = fileno(m_file);
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = read(fd, dst + done, size - done);
+            if (n <= 0)
+                break;
+            done += static_cast<size_t>(n);
+        }
+        return done;
+#else
+        return fread(dst, 1, size, m_file);
+#endif
+    }
+
+    // Rows of a plane whose pitch differs from the row size
+    bool ReadRows(const Plane &p) {
+#ifdef __linux__
+        const mfxU32 batch = 64;
+        struct iovec iov[batch];
+        for (mfxU32 row = 0; row < p.rows; row += batch) {
+            mfxU32 n      = std::min(batch, p.rows - row);
+            size_t expect = static_cast<size_t>(n) * p.rowBytes;
+            for (mfxU32 i = 0; i < n; i++) {
+                iov[i].iov_base = p.ptr + static_cast<size_t>(row + i) * p.pitch;
+                iov[i].iov_len  = p.rowBytes;
+            }
+            ssize_t got = readv(fileno(m_file), iov, static_cast<int>(n));
+            if (got < 0 || static_cast<size_t>(got) != expect)
+                return false;
+        }
+        return true;
+#else
+        for (mfxU32 row = 0; row < p.rows; row++) {
+            if (fread(p.ptr + static_cast<size_t>(row) * p.pitch, 1, p.rowBytes, m_file) !=
+                p.rowBytes)
+                return false;
+        }
+        return true;
+#endif
+    }
+
+    mfxStatus ReadFrameDirect(mfxFrameSurface1 *surface) {
+        Plane planes[3];
+        int numPlanes = GetPlanes(surface, planes);
+        for (int i = 0; i < numPlanes; i++) {
+            const Plane &p = planes[i];
+            if (p.pitch == p.rowBytes) {
+                size_t size = static_cast<size_t>(p.rowBytes) * p.rows;
+                if (ReadBytes(p.ptr, size) != size)
+                    return MFX_ERR_MORE_DATA;
+            }
+            else if (!ReadRows(p)) {
+                return MFX_ERR_MORE_DATA;
+            }
+        }
+        return MFX_ERR_NONE;
+    }
+
+    static void CopyPlane(const Plane &p, const mfxU8 *src) {
+        if (p.pitch == p.rowBytes) {
+            memcpy(p.ptr, src, static_cast<size_t>(p.rowBytes) * p.rows);
+            return;
+        }
+        for (mfxU32 row = 0; row < p.rows; row++)
+            memcpy(p.ptr + static_cast<size_t>(row) * p.pitch,
+                   src + static_cast<size_t>(row) * p.rowBytes,
+                   p.rowBytes);
+    }
+
+    // I420 chroma planes to the interleaved NV12 UV plane
+    static void InterleaveUV(mfxU8 *dst,
+                             mfxU32 pitch,
+                             const mfxU8 *u,
+                             const mfxU8 *v,
+                             mfxU32 cw,
+                             mfxU32 ch) {
+        for (mfxU32 row = 0; row < ch; row++) {
+            mfxU8 *d       = dst + static_cast<size_t>(row) * pitch;
+            const mfxU8 *s = u + static_cast<size_t>(row) * cw;
+            const mfxU8 *t = v + static_cast<size_t>(row) * cw;
+            mfxU32 x       = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+            for (; x + 16 <= cw; x += 16) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + x));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t + x));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(d + 2 * x), _mm_unpacklo_epi8(a, b));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(d + 2 * x + 16),
+                                 _mm_unpackhi_epi8(a, b));
+            }
+#endif
+            for (; x < cw; x++) {
+                d[2 * x]     = s[x];
+                d[2 * x + 1] = t[x];
+            }
+        }
+    }
+
+    // Staging buffer (file layout) to surface, converting I420 to NV12 if needed
+    void CopyFrame(const mfxU8 *src, mfxFrameSurface1 *surface) {
+        if (m_fourcc == MFX_FOURCC_I420 && surface->Info.FourCC == MFX_FOURCC_NV12) {
+            mfxFrameData &d = surface->Data;
+            mfxU32 cw       = m_width / 2;
+            mfxU32 ch       = m_height / 2;
+            Plane luma      = { d.Y, d.Pitch, m_width, m_height };
+            CopyPlane(luma, src);
+            const mfxU8 *u = src + static_cast<size_t>(m_width) * m_height;
+            const mfxU8 *v = u + static_cast<size_t>(cw) * ch;
+            InterleaveUV(d.UV, d.Pitch, u, v, cw, ch);
+            return;
+        }
+
+        Plane planes[3];
+        int numPlanes = GetPlanes(surface, planes);
+        for (int i = 0; i < numPlanes; i++) {
+            CopyPlane(planes[i], src);
+            src += static_cast<size_t>(planes[i].rowBytes) * planes[i].rows;
+        }
+    }
+
+    void PrefetchThread() {
+        for (mfxU32 idx = 0;; idx ^= 1) {
+            Slot &slot = m_slots[idx];
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this, &slot] {
+                    return m_stop || !slot.full;
+                });
+                if (m_stop)
+                    return;
+            }
+
+            bool eof = (ReadBytes(slot.data.data(), m_frameSize) != m_frameSize);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                slot.eof  = eof;
+                slot.full = true;
+            }
+            m_cv.notify_all();
+            if (eof)
+                return;
+        }
+    }
+
+    FILE *m_file;
+    mfxU32 m_fourcc;
+    mfxU16 m_width;
+    mfxU16 m_height;
+    size_t m_frameSize;
+    bool m_prefetch;
+    bool m_stop;
+    mfxU32 m_readIdx;
+    Slot m_slots[2];
+    std::vector<mfxU8> m_staging;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+};
+#endif
+
 #endif //EXAMPLES_UTIL_HPP_
@@ -0,0 +1,319 @@
+//==============================================================================
+// Copyright Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+//==============================================================================
+
+///
+/// Raw-frame ingest check: RawFrameReader output must match the row-by-row
+/// ReadRawFrame for every frame of the bundled clips, with packed and padded
+/// surface pitches, with and without prefetch. P010, which has no clip, is checked
+/// against a generated file. Read rates of both are printed.
+/// No implementation is needed, surfaces are allocated in system memory.
+///
+/// @file
+
+#include <chrono>
+#include <string>
+#include "util.hpp"
+
+#define WIDTH        320
+#define HEIGHT       240
+#define PITCH_PAD    64
+#define MIN_TEST_MiB 64
+
+mfxU64 NowUsec() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+typedef struct _TestSurface {
+    std::vector<mfxU8> buf;
+    mfxFrameSurface1 surface;
+} TestSurface;
+
+void AllocTestSurface(TestSurface *ts, mfxU32 fourcc, mfxU16 pad) {
+    mfxU32 bpp   = (fourcc == MFX_FOURCC_RGB4) ? 4 : (fourcc == MFX_FOURCC_P010) ? 2 : 1;
+    mfxU32 pitch = WIDTH * bpp + pad;
+    ts->buf.assign(static_cast<size_t>(pitch) * HEIGHT * 2, 0);
+    ts->surface             = {};
+    ts->surface.Info.FourCC = fourcc;
+    ts->surface.Info.CropW  = WIDTH;
+    ts->surface.Info.CropH  = HEIGHT;
+    ts->surface.Info.Width  = WIDTH;
+    ts->surface.Info.Height = HEIGHT;
+
+    mfxFrameData &d = ts->surface.Data;
+    mfxU8 *base     = ts->buf.data();
+    d.Pitch         = static_cast<mfxU16>(pitch);
+    if (fourcc == MFX_FOURCC_RGB4) {
+        d.B = base;
+        d.G = base + 1;
+        d.R = base + 2;
+        d.A = base + 3;
+    }
+    else {
+        d.Y = base;
+        d.U = base + static_cast<size_t>(pitch) * HEIGHT;
+        d.V = d.U + (pitch / 2) * (HEIGHT / 2); // I420 only
+    }
+}
+
+// Visible bytes of two surfaces of the same format, any pitch
+bool SameFrame(const mfxFrameSurface1 &a, const mfxFrameSurface1 &b) {
+    mfxU32 fourcc  = a.Info.FourCC;
+    mfxU32 rowSize = (fourcc == MFX_FOURCC_RGB4) ? WIDTH * 4 :
+                     (fourcc == MFX_FOURCC_P010) ? WIDTH * 2 :
+                                                   WIDTH;
+    const mfxU8 *pa[3] = { fourcc == MFX_FOURCC_RGB4 ? a.Data.B : a.Data.Y, a.Data.U, a.Data.V };
+    const mfxU8 *pb[3] = { fourcc == MFX_FOURCC_RGB4 ? b.Data.B : b.Data.Y, b.Data.U, b.Data.V };
+    mfxU32 rows[3]     = { HEIGHT, HEIGHT / 2, HEIGHT / 2 };
+    mfxU32 bytes[3]    = { rowSize, rowSize / 2, rowSize / 2 };
+    mfxU32 scale[3]    = { 1, 2, 2 };
+    int numPlanes      = 3;
+    if (fourcc == MFX_FOURCC_NV12 || fourcc == MFX_FOURCC_P010) {
+        bytes[1]  = rowSize;
+        scale[1]  = 1;
+        numPlanes = 2;
+    }
+    else if (fourcc == MFX_FOURCC_RGB4) {
+        numPlanes = 1;
+    }
+
+    for (int p = 0; p < numPlanes; p++) {
+        for (mfxU32 r = 0; r < rows[p]; r++) {
+            if (memcmp(pa[p] + r * (a.Data.Pitch / scale[p]),
+                       pb[p] + r * (b.Data.Pitch / scale[p]),
+                       bytes[p]))
+                return false;
+        }
+    }
+    return true;
+}
+
+// Reference I420 frame to NV12 by plain interleaving
+void ReferenceToNV12(const mfxFrameSurface1 &i420, mfxFrameSurface1 *nv12) {
+    for (mfxU32 r = 0; r < HEIGHT; r++)
+        memcpy(nv12->Data.Y + r * nv12->Data.Pitch, i420.Data.Y + r * i420.Data.Pitch, WIDTH);
+    for (mfxU32 r = 0; r < HEIGHT / 2; r++) {
+        for (mfxU32 x = 0; x < WIDTH / 2; x++) {
+            nv12->Data.UV[r * nv12->Data.Pitch + 2 * x] = i420.Data.U[r * i420.Data.Pitch / 2 + x];
+            nv12->Data.UV[r * nv12->Data.Pitch + 2 * x + 1] =
+                i420.Data.V[r * i420.Data.Pitch / 2 + x];
+        }
+    }
+}
+
+// Compare every frame of the clip, returns the number of frames or -1 on mismatch
+int CheckClip(const std::string &path,
+              mfxU32 fileFourCC,
+              mfxU32 dstFourCC,
+              mfxU16 pad,
+              bool prefetch) {
+    FILE *ref = fopen(path.c_str(), "rb");
+    FILE *in  = fopen(path.c_str(), "rb");
+    if (!ref || !in) {
+        printf("Cannot open %s\n", path.c_str());
+        if (ref)
+            fclose(ref);
+        if (in)
+            fclose(in);
+        return -1;
+    }
+
+    TestSurface refSurface, refConverted, outSurface;
+    AllocTestSurface(&refSurface, fileFourCC, 0);
+    AllocTestSurface(&refConverted, dstFourCC, 0);
+    AllocTestSurface(&outSurface, dstFourCC, pad);
+
+    RawFrameReader reader;
+    int frames = 0;
+    if (reader.Init(in, fileFourCC, WIDTH, HEIGHT, prefetch) != MFX_ERR_NONE)
+        frames = -1;
+
+    while (frames >= 0) {
+        mfxStatus stsRef = ReadRawFrame(&refSurface.surface, ref);
+        mfxStatus stsOut = reader.ReadFrame(&outSurface.surface);
+        if (stsRef != stsOut) {
+            frames = -1;
+            break;
+        }
+        if (stsRef == MFX_ERR_MORE_DATA)
+            break;
+
+        mfxFrameSurface1 *expected = &refSurface.surface;
+        if (dstFourCC != fileFourCC) {
+            ReferenceToNV12(refSurface.surface, &refConverted.surface);
+            expected = &refConverted.surface;
+        }
+        if (!SameFrame(*expected, outSurface.surface)) {
+            printf("  mismatch in frame %d\n", frames);
+            frames = -1;
+            break;
+        }
+        frames++;
+    }
+
+    reader.Close();
+    fclose(ref);
+    fclose(in);
+    return frames;
+}
+
+// There is no P010 clip and ReadRawFrame does not read P010: write a few frames of
+// a 10-bit pattern to a temporary file and compare the reader output with it
+int CheckGeneratedP010(mfxU16 pad, bool prefetch) {
+    const int numFrames = 3;
+    size_t frameSize    = RawFrameReader::GetRawFrameSize(MFX_FOURCC_P010, WIDTH, HEIGHT);
+    std::vector<mfxU8> content(frameSize * numFrames);
+    for (size_t i = 0; i < content.size() / 2; i++) {
+        mfxU16 sample      = static_cast<mfxU16>(((i * 7 + i / 1000) & 0x3ff) << 6);
+        content[2 * i]     = static_cast<mfxU8>(sample & 0xff);
+        content[2 * i + 1] = static_cast<mfxU8>(sample >> 8);
+    }
+
+    FILE *in = tmpfile();
+    if (!in) {
+        printf("Cannot create a temporary file\n");
+        return -1;
+    }
+    if (fwrite(content.data(), 1, content.size(), in) != content.size() || fflush(in)) {
+        fclose(in);
+        return -1;
+    }
+    rewind(in);
+
+    TestSurface expected, outSurface;
+    AllocTestSurface(&expected, MFX_FOURCC_P010, 0);
+    AllocTestSurface(&outSurface, MFX_FOURCC_P010, pad);
+
+    RawFrameReader reader;
+    int frames = 0;
+    if (reader.Init(in, MFX_FOURCC_P010, WIDTH, HEIGHT, prefetch) != MFX_ERR_NONE)
+        frames = -1;
+
+    while (frames >= 0) {
+        mfxStatus sts = reader.ReadFrame(&outSurface.surface);
+        if (sts == MFX_ERR_MORE_DATA) {
+            if (frames != numFrames)
+                frames = -1;
+            break;
+        }
+        if (sts != MFX_ERR_NONE || frames == numFrames) {
+            frames = -1;
+            break;
+        }
+
+        // packed rows: luma then interleaved chroma, both WIDTH * 2 bytes wide
+        const mfxU8 *src = content.data() + frameSize * frames;
+        memcpy(expected.surface.Data.Y, src, WIDTH * 2 * HEIGHT);
+        memcpy(expected.surface.Data.UV, src + WIDTH * 2 * HEIGHT, WIDTH * 2 * (HEIGHT / 2));
+        if (!SameFrame(expected.surface, outSurface.surface)) {
+            printf("  mismatch in frame %d\n", frames);
+            frames = -1;
+            break;
+        }
+        frames++;
+    }
+
+    reader.Close();
+    fclose(in);
+    return frames;
+}
+
+// MiB/s reading the clip repeatedly, legacy row-by-row reads or RawFrameReader
+double MeasureRate(const std::string &path, mfxU32 fourcc, bool useReader, bool prefetch) {
+    TestSurface ts;
+    AllocTestSurface(&ts, fourcc, 0);
+    size_t frameSize = RawFrameReader::GetRawFrameSize(fourcc, WIDTH, HEIGHT);
+
+    size_t total = 0;
+    mfxU64 start = NowUsec();
+    while (total < static_cast<size_t>(MIN_TEST_MiB) << 20) {
+        FILE *f = fopen(path.c_str(), "rb");
+        if (!f)
+            return 0;
+        RawFrameReader reader;
+        if (useReader && reader.Init(f, fourcc, WIDTH, HEIGHT, prefetch) != MFX_ERR_NONE) {
+            fclose(f);
+            return 0;
+        }
+        size_t passStart = total;
+        while ((useReader ? reader.ReadFrame(&ts.surface) : ReadRawFrame(&ts.surface, f)) ==
+               MFX_ERR_NONE)
+            total += frameSize;
+        reader.Close();
+        fclose(f);
+        // an empty or short clip would never reach the test size
+        if (total == passStart)
+            return 0;
+    }
+    mfxU64 usec = NowUsec() - start;
+    return usec ? (total / 1048576.0) * 1000000.0 / usec : 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: hello-encode-ingest <content dir>\n");
+        return 1;
+    }
+    std::string dir = argv[1];
+
+    struct {
+        const char *clip;
+        mfxU32 fileFourCC;
+        mfxU32 dstFourCC;
+    } cases[] = {
+        { "cars_320x240.i420", MFX_FOURCC_I420, MFX_FOURCC_I420 },
+        { "cars_320x240.nv12", MFX_FOURCC_NV12, MFX_FOURCC_NV12 },
+        { "cars_320x240.bgra", MFX_FOURCC_RGB4, MFX_FOURCC_RGB4 },
+        { "cars_320x240.i420", MFX_FOURCC_I420, MFX_FOURCC_NV12 },
+    };
+
+    bool isFailed = false;
+    for (auto &c : cases) {
+        std::string path = dir + "/" + c.clip;
+        for (mfxU16 pad : { (mfxU16)0, (mfxU16)PITCH_PAD }) {
+            for (bool prefetch : { false, true }) {
+                int frames = CheckClip(path, c.fileFourCC, c.dstFourCC, pad, prefetch);
+                printf("%s -> %s pitch pad %2u prefetch %d: %s (%d frames)\n",
+                       c.clip,
+                       c.dstFourCC == MFX_FOURCC_NV12 ? "NV12" :
+                       c.dstFourCC == MFX_FOURCC_RGB4 ? "BGRA" :
+                                                        "I420",
+                       pad,
+                       prefetch,
+                       frames > 0 ? "match" : "MISMATCH",
+                       frames);
+                if (frames <= 0)
+                    isFailed = true;
+            }
+        }
+    }
+
+    for (mfxU16 pad : { (mfxU16)0, (mfxU16)PITCH_PAD }) {
+        for (bool prefetch : { false, true }) {
+            int frames = CheckGeneratedP010(pad, prefetch);
+            printf("generated P010 -> P010 pitch pad %2u prefetch %d: %s (%d frames)\n",
+                   pad,
+                   prefetch,
+                   frames > 0 ? "match" : "MISMATCH",
+                   frames);
+            if (frames <= 0)
+                isFailed = true;
+        }
+    }
+
+    printf("\nRead rate (MiB/s)    ReadRawFrame  RawFrameReader  +prefetch\n");
+    for (int i = 0; i < 3; i++) {
+        std::string path = dir + "/" + cases[i].clip;
+        printf("%-20s %12.0f %15.0f %10.0f\n",
+               cases[i].clip,
+               MeasureRate(path, cases[i].fileFourCC, false, false),
+               MeasureRate(path, cases[i].fileFourCC, true, false),
+               MeasureRate(path, cases[i].fileFourCC, true, true));
+    }
+
+    return isFailed ? 1 : 0;
+}
@@ -0,0 +1,513 @@
+//==============================================================================
+// Copyright Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+//==============================================================================
+
+///
+/// A minimal Intel® Video Processing Library (Intel® VPL) multi-channel throughput
+/// harness: N concurrent decode->VPP->encode channels using internal memory and
+/// mfxFrameSurfaceInterface reference counting. For more information see:
+/// https://software.intel.com/content/www/us/en/develop/articles/upgrading-from-msdk-to-onevpl.html
+/// https://intel.github.io/libvpl
+///
+/// @file
+
+#include "util.hpp"
+
+#define TARGETKBPS                 4000
+#define FRAMERATE                  30
+#define MAJOR_API_VERSION_REQUIRED 2
+#define MINOR_API_VERSION_REQUIRED 5
+#define MAX_TIMEOUT_COUNT          10
+#define MAX_CHANNELS               64
+#define DEFAULT_CHANNELS           2
+
+#define WAIT_5_MILLISECONDS 5
+#if defined(_WIN32) || defined(_WIN64)
+    #define sleep(msec) Sleep(msec)
+#else
+    #define sleep(msec) usleep(1000 * msec)
+#endif
+
+typedef struct _ChannelParams {
+    char *infileName;
+    mfxU32 codecId; // input stream codec
+    mfxU32 numChannels;
+    mfxU32 numLoops; // times each channel replays the input
+    mfxU16 dstWidth; // VPP output, 0 - same as input
+    mfxU16 dstHeight;
+    bool pinThreads;
+    bool hwOnly;
+} ChannelParams;
+
+typedef struct _Channel {
+    mfxU32 id;
+    mfxSession session;
+    mfxBitstream bs_dec_in;
+    mfxBitstream bs_enc_out;
+    const std::vector<mfxU8> *stream;
+    mfxU32 loopsLeft;
+    mfxStatus sts;
+    ChannelStats stats;
+    std::vector<mfxU64> submitUsec; // per frame, indexed by surface TimeStamp
+} Channel;
+
+void Usage(void) {
+    printf("\n");
+    printf("   Usage  :  hello-multichannel \n\n");
+    printf("     -i             input file name (H.265 or H.264 elementary stream)\n");
+    printf("     -c             input codec, h265 (default) or h264\n");
+    printf("     -n             number of concurrent channels (default %d)\n", DEFAULT_CHANNELS);
+    printf("     -loops         times each channel replays the input (default 1)\n");
+    printf("     -w -h          VPP output size (default same as input)\n");
+    printf("     -pin           pin channel threads to CPUs round-robin\n");
+    printf("     -hw            require a hardware implementation\n\n");
+    printf("   Example:  hello-multichannel -i in.h265 -n 4 -loops 10 -pin\n");
+    printf(" * Decode, resize and encode to HEVC on N channels, report fps and latency\n\n");
+    return;
+}
+
+bool ParseChannelArgs(int argc, char *argv[], ChannelParams *params) {
+    *params             = {};
+    params->codecId     = MFX_CODEC_HEVC;
+    params->numChannels = DEFAULT_CHANNELS;
+    params->numLoops    = 1;
+
+    for (int idx = 1; idx < argc; idx++) {
+        char *s        = argv[idx];
+        bool has_value = (idx + 1 < argc);
+
+        if (IS_ARG_EQ(s, "-i") && has_value) {
+            params->infileName = ValidateFileName(argv[++idx]);
+            if (!params->infileName)
+                return false;
+        }
+        else if (IS_ARG_EQ(s, "-c") && has_value) {
+            idx++;
+            if (IS_ARG_EQ(argv[idx], "h265"))
+                params->codecId = MFX_CODEC_HEVC;
+            else if (IS_ARG_EQ(argv[idx], "h264"))
+                params->codecId = MFX_CODEC_AVC;
+            else
+                return false;
+        }
+        else if (IS_ARG_EQ(s, "-n") && has_value) {
+            params->numChannels = static_cast<mfxU32>(strtol(argv[++idx], NULL, 10));
+            if (!params->numChannels || params->numChannels > MAX_CHANNELS)
+                return false;
+        }
+        else if (IS_ARG_EQ(s, "-loops") && has_value) {
+            params->numLoops = static_cast<mfxU32>(strtol(argv[++idx], NULL, 10));
+            if (!params->numLoops)
+                return false;
+        }
+        else if (IS_ARG_EQ(s, "-w") && has_value) {
+            if (!ValidateSize(argv[++idx], &params->dstWidth, MAX_WIDTH))
+                return false;
+        }
+        else if (IS_ARG_EQ(s, "-h") && has_value) {
+            if (!ValidateSize(argv[++idx], &params->dstHeight, MAX_HEIGHT))
+                return false;
+        }
+        else if (IS_ARG_EQ(s, "-pin")) {
+            params->pinThreads = true;
+        }
+        else if (IS_ARG_EQ(s, "-hw")) {
+            params->hwOnly = true;
+        }
+        else {
+            printf("ERROR - invalid argument: %s\n", s);
+            return false;
+        }
+    }
+
+    if (!params->infileName) {
+        printf("ERROR - input file name (-i) is required\n");
+        return false;
+    }
+
+    return true;
+}
+
+// Move the unconsumed tail to the front and append another copy of the stream
+void RefillChannelStream(Channel *ch) {
+    mfxBitstream &bs = ch->bs_dec_in;
+    memmove(bs.Data, bs.Data + bs.DataOffset, bs.DataLength);
+    bs.DataOffset = 0;
+    memcpy(bs.Data + bs.DataLength, ch->stream->data(), ch->stream->size());
+    bs.DataLength += static_cast<mfxU32>(ch->stream->size());
+}
+
+// Initialize decode, VPP and encode of one channel. Sessions are created by the
+// caller, this runs on the channel thread.
+mfxStatus InitChannel(Channel *ch, const ChannelParams &params) {
+    mfxVideoParam decodeParams = {};
+    decodeParams.mfx.CodecId   = params.codecId;
+    decodeParams.IOPattern     = MFX_IOPATTERN_OUT_SYSTEM_MEMORY;
+    decodeParams.AsyncDepth    = 1;
+
+    mfxStatus sts = MFXVideoDECODE_DecodeHeader(ch->session, &ch->bs_dec_in, &decodeParams);
+    if (sts != MFX_ERR_NONE)
+        return sts;
+
+    sts = MFXVideoDECODE_Init(ch->session, &decodeParams);
+    if (sts != MFX_ERR_NONE)
+        return sts;
+
+    mfxFrameInfo &decInfo = decodeParams.mfx.FrameInfo;
+    mfxU16 srcW           = decInfo.CropW ? decInfo.CropW : decInfo.Width;
+    mfxU16 srcH           = decInfo.CropH ? decInfo.CropH : decInfo.Height;
+
+    mfxVideoParam vppParams = {};
+    vppParams.vpp.In        = decInfo;
+    PrepareFrameInfo(&vppParams.vpp.Out,
+                     MFX_FOURCC_NV12,
+                     params.dstWidth ? params.dstWidth : srcW,
+                     params.dstHeight ? params.dstHeight : srcH);
+    vppParams.IOPattern  = MFX_IOPATTERN_IN_SYSTEM_MEMORY | MFX_IOPATTERN_OUT_SYSTEM_MEMORY;
+    vppParams.AsyncDepth = 1;
+
+    sts = MFXVideoVPP_Init(ch->session, &vppParams);
+    if (sts != MFX_ERR_NONE)
+        return sts;
+
+    // no B-frames and one frame in flight, so the latency is not dominated by reordering
+    mfxVideoParam encodeParams               = {};
+    encodeParams.mfx.CodecId                 = MFX_CODEC_HEVC;
+    encodeParams.mfx.TargetUsage             = MFX_TARGETUSAGE_BEST_SPEED;
+    encodeParams.mfx.TargetKbps              = TARGETKBPS;
+    encodeParams.mfx.RateControlMethod       = MFX_RATECONTROL_VBR;
+    encodeParams.mfx.GopRefDist              = 1;
+    encodeParams.mfx.FrameInfo               = vppParams.vpp.Out;
+    encodeParams.mfx.FrameInfo.FrameRateExtN = FRAMERATE;
+    encodeParams.mfx.FrameInfo.FrameRateExtD = 1;
+    encodeParams.IOPattern                   = MFX_IOPATTERN_IN_SYSTEM_MEMORY;
+    encodeParams.AsyncDepth                  = 1;
+
+    sts = MFXVideoENCODE_Query(ch->session, &encodeParams, &encodeParams);
+    if (sts == MFX_WRN_INCOMPATIBLE_VIDEO_PARAM)
+        sts = MFX_ERR_NONE;
+    if (sts != MFX_ERR_NONE)
+        return sts;
+
+    sts = MFXVideoENCODE_Init(ch->session, &encodeParams);
+    if (sts != MFX_ERR_NONE)
+        return sts;
+
+    ch->bs_enc_out.MaxLength = GetSurfaceSize(MFX_FOURCC_NV12,
+                                              encodeParams.mfx.FrameInfo.Width,
+                                              encodeParams.mfx.FrameInfo.Height);
+    ch->bs_enc_out.Data      = (mfxU8 *)calloc(ch->bs_enc_out.MaxLength, sizeof(mfxU8));
+    return ch->bs_enc_out.Data ? MFX_ERR_NONE : MFX_ERR_MEMORY_ALLOC;
+}
+
+// Decode a frame, retrying while internal allocation times out or the device is busy
+// with the other channels
+mfxStatus DecodeChannelFrame(Channel *ch, bool isDraining, mfxFrameSurface1 **out) {
+    mfxSyncPoint syncp = {};
+    mfxStatus sts;
+    for (mfxU8 timeout_count = 0;;) {
+        sts = MFXVideoDECODE_DecodeFrameAsync(ch->session,
+                                              isDraining ? NULL : &ch->bs_dec_in,
+                                              NULL,
+                                              out,
+                                              &syncp);
+        if (sts == MFX_WRN_ALLOC_TIMEOUT_EXPIRED) {
+            if (timeout_count++ > MAX_TIMEOUT_COUNT)
+                return MFX_ERR_DEVICE_FAILED;
+        }
+        else if (sts != MFX_WRN_DEVICE_BUSY) {
+            break;
+        }
+        sleep(WAIT_5_MILLISECONDS);
+    }
+    // a warning with a sync point still delivers the frame
+    return (sts > MFX_ERR_NONE && syncp) ? MFX_ERR_NONE : sts;
+}
+
+// Scale a frame, retrying while the device is busy
+mfxStatus ProcessChannelFrame(Channel *ch, mfxFrameSurface1 *in, mfxFrameSurface1 **out) {
+    mfxStatus sts;
+    while ((sts = MFXVideoVPP_ProcessFrameAsync(ch->session, in, out)) == MFX_WRN_DEVICE_BUSY)
+        sleep(WAIT_5_MILLISECONDS);
+    return (sts > MFX_ERR_NONE && *out) ? MFX_ERR_NONE : sts;
+}
+
+// Encode a frame (NULL drains the encoder), retrying while the device is busy
+mfxStatus EncodeChannelFrame(Channel *ch, mfxFrameSurface1 *in, mfxSyncPoint *syncp) {
+    mfxStatus sts;
+    while ((sts = MFXVideoENCODE_EncodeFrameAsync(ch->session, NULL, in, &ch->bs_enc_out, syncp)) ==
+           MFX_WRN_DEVICE_BUSY)
+        sleep(WAIT_5_MILLISECONDS);
+    return (sts > MFX_ERR_NONE && *syncp) ? MFX_ERR_NONE : sts;
+}
+
+// Channel thread: decode -> VPP -> encode until the input has been replayed numLoops
+// times. Encoded output is discarded, only its timing is kept.
+void RunChannel(Channel *ch, const ChannelParams &params) {
+    if (params.pinThreads) {
+        mfxU32 numCPUs = std::max(1u, std::thread::hardware_concurrency());
+        if (!PinThreadToCPU(ch->id % numCPUs))
+            printf("Channel %u: could not pin to CPU %u\n", ch->id, ch->id % numCPUs);
+    }
+
+    ch->sts = InitChannel(ch, params);
+    if (ch->sts != MFX_ERR_NONE)
+        return;
+
+    bool isDrainingDec = false;
+    bool isDrainingEnc = false;
+    mfxStatus sts      = MFX_ERR_NONE;
+
+    ch->stats.startUsec = GetTimeUsec();
+    while (true) {
+        mfxFrameSurface1 *dec_surface_out = NULL;
+        mfxFrameSurface1 *vpp_surface_out = NULL;
+
+        if (!isDrainingEnc) {
+            sts = DecodeChannelFrame(ch, isDrainingDec, &dec_surface_out);
+            if (sts == MFX_ERR_MORE_DATA) {
+                if (!isDrainingDec && ch->loopsLeft > 1) {
+                    ch->loopsLeft--;
+                    RefillChannelStream(ch);
+                }
+                else if (!isDrainingDec) {
+                    isDrainingDec = true;
+                }
+                else {
+                    isDrainingEnc = true; // decoder drained, start encode draining
+                }
+                if (!isDrainingEnc)
+                    continue;
+            }
+            else if (sts == MFX_ERR_MORE_SURFACE || sts == MFX_WRN_VIDEO_PARAM_CHANGED) {
+                continue;
+            }
+            else if (sts != MFX_ERR_NONE) {
+                break;
+            }
+        }
+
+        if (dec_surface_out) {
+            // surfaces are reference counted: VPP holds the input until it is processed
+            mfxU64 submitted = GetTimeUsec();
+
+            sts = ProcessChannelFrame(ch, dec_surface_out, &vpp_surface_out);
+            dec_surface_out->FrameInterface->Release(dec_surface_out);
+            if (sts != MFX_ERR_NONE)
+                break;
+
+            vpp_surface_out->Data.TimeStamp = ch->submitUsec.size();
+            ch->submitUsec.push_back(submitted);
+        }
+
+        mfxSyncPoint syncp = {};
+
+        sts = EncodeChannelFrame(ch, isDrainingEnc ? NULL : vpp_surface_out, &syncp);
+        if (vpp_surface_out)
+            vpp_surface_out->FrameInterface->Release(vpp_surface_out);
+
+        if (sts == MFX_ERR_NONE && syncp) {
+            sts = MFXVideoCORE_SyncOperation(ch->session, syncp, WAIT_100_MILLISECONDS);
+            if (sts != MFX_ERR_NONE)
+                break;
+
+            mfxU64 done = GetTimeUsec();
+            mfxU64 idx  = ch->bs_enc_out.TimeStamp;
+            if (idx < ch->submitUsec.size())
+                ch->stats.latencyUsec.push_back(static_cast<mfxU32>(done - ch->submitUsec[idx]));
+            ch->stats.frames++;
+            ch->bs_enc_out.DataLength = 0;
+        }
+        else if (sts == MFX_ERR_MORE_DATA) {
+            if (isDrainingEnc) {
+                sts = MFX_ERR_NONE;
+                break;
+            }
+        }
+        else if (sts != MFX_ERR_NONE) {
+            break;
+        }
+    }
+    ch->stats.endUsec = GetTimeUsec();
+    ch->sts           = sts;
+}
+
+void PrintChannelReport(const std::vector<Channel> &channels) {
+    printf("\n%-8s %8s %10s %12s %12s %12s\n",
+           "channel",
+           "frames",
+           "fps",
+           "lat p50 ms",
+           "lat p99 ms",
+           "lat max ms");
+
+    mfxU32 totalFrames = 0;
+    mfxU64 firstStart  = 0;
+    mfxU64 lastEnd     = 0;
+    for (const Channel &ch : channels) {
+        if (ch.sts != MFX_ERR_NONE) {
+            printf("%-8u failed with status %d\n", ch.id, ch.sts);
+            continue;
+        }
+        printf("%-8u %8u %10.1f %12.2f %12.2f %12.2f\n",
+               ch.id,
+               ch.stats.frames,
+               GetChannelFPS(ch.stats),
+               GetLatencyPercentile(ch.stats.latencyUsec, 50) / 1000.0,
+               GetLatencyPercentile(ch.stats.latencyUsec, 99) / 1000.0,
+               GetLatencyPercentile(ch.stats.latencyUsec, 100) / 1000.0);
+
+        totalFrames += ch.stats.frames;
+        if (!firstStart || ch.stats.startUsec < firstStart)
+            firstStart = ch.stats.startUsec;
+        lastEnd = std::max(lastEnd, ch.stats.endUsec);
+    }
+
+    if (lastEnd > firstStart) {
+        printf("\nAggregate: %u frames, %.1f fps over %u channels\n",
+               totalFrames,
+               totalFrames * 1000000.0 / (lastEnd - firstStart),
+               static_cast<mfxU32>(channels.size()));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bool isFailed    = false;
+    FILE *source     = NULL;
+    mfxLoader loader = NULL;
+    mfxStatus sts    = MFX_ERR_NONE;
+    mfxConfig cfg[4];
+    mfxVariant cfgVal[4];
+    ChannelParams cliParams = {};
+    std::vector<mfxU8> stream;
+    std::vector<Channel> channels;
+    std::vector<std::thread> threads;
+
+    if (ParseChannelArgs(argc, argv, &cliParams) == false) {
+        Usage();
+        return 1; // return 1 as error code
+    }
+
+    source = fopen(cliParams.infileName, "rb");
+    VERIFY(source, "Could not open input file");
+
+    sts = ReadEncodedStreamToMemory(stream, source);
+    VERIFY(MFX_ERR_NONE == sts, "Error reading bitstream");
+
+    loader = MFXLoad();
+    VERIFY(NULL != loader, "MFXLoad failed -- is implementation in path?");
+
+    // Implementation must provide the input decoder
+    cfg[0] = MFXCreateConfig(loader);
+    VERIFY(NULL != cfg[0], "MFXCreateConfig failed")
+    cfgVal[0].Type     = MFX_VARIANT_TYPE_U32;
+    cfgVal[0].Data.U32 = cliParams.codecId;
+    sts                = MFXSetConfigFilterProperty(
+        cfg[0],
+        (mfxU8 *)"mfxImplDescription.mfxDecoderDescription.decoder.CodecID",
+        cfgVal[0]);
+    VERIFY(MFX_ERR_NONE == sts, "MFXSetConfigFilterProperty failed for decoder CodecID");
+
+    // Implementation must provide an HEVC encoder
+    cfg[1] = MFXCreateConfig(loader);
+    VERIFY(NULL != cfg[1], "MFXCreateConfig failed")
+    cfgVal[1].Type     = MFX_VARIANT_TYPE_U32;
+    cfgVal[1].Data.U32 = MFX_CODEC_HEVC;
+    sts                = MFXSetConfigFilterProperty(
+        cfg[1],
+        (mfxU8 *)"mfxImplDescription.mfxEncoderDescription.encoder.CodecID",
+        cfgVal[1]);
+    VERIFY(MFX_ERR_NONE == sts, "MFXSetConfigFilterProperty failed for encoder CodecID");
+
+    // Implementation must provide equal to or higher API version than MAJOR_API_VERSION_REQUIRED.MINOR_API_VERSION_REQUIRED
+    cfg[2] = MFXCreateConfig(loader);
+    VERIFY(NULL != cfg[2], "MFXCreateConfig failed")
+    cfgVal[2].Type     = MFX_VARIANT_TYPE_U32;
+    cfgVal[2].Data.U32 = VPLVERSION(MAJOR_API_VERSION_REQUIRED, MINOR_API_VERSION_REQUIRED);
+    sts                = MFXSetConfigFilterProperty(cfg[2],
+                                     (mfxU8 *)"mfxImplDescription.ApiVersion.Version",
+                                     cfgVal[2]);
+    VERIFY(MFX_ERR_NONE == sts, "MFXSetConfigFilterProperty failed for API version");
+
+    // CPU implementations are accepted unless hardware is requested
+    if (cliParams.hwOnly) {
+        cfg[3] = MFXCreateConfig(loader);
+        VERIFY(NULL != cfg[3], "MFXCreateConfig failed")
+        cfgVal[3].Type     = MFX_VARIANT_TYPE_U32;
+        cfgVal[3].Data.U32 = MFX_IMPL_TYPE_HARDWARE;
+        sts = MFXSetConfigFilterProperty(cfg[3], (mfxU8 *)"mfxImplDescription.Impl", cfgVal[3]);
+        VERIFY(MFX_ERR_NONE == sts, "MFXSetConfigFilterProperty failed for Impl");
+    }
+
+    // Sessions are created up front on this thread, the loader is shared by all channels
+    channels.resize(cliParams.numChannels);
+    for (mfxU32 i = 0; i < cliParams.numChannels; i++) {
+        Channel &ch  = channels[i];
+        ch.id        = i;
+        ch.stream    = &stream;
+        ch.loopsLeft = cliParams.numLoops;
+
+        sts = MFXCreateSession(loader, 0, &ch.session);
+        VERIFY(MFX_ERR_NONE == sts,
+               "Cannot create session -- no implementations meet selection criteria");
+
+        // room for the unconsumed tail of one pass plus the next pass
+        ch.bs_dec_in.MaxLength = static_cast<mfxU32>(stream.size() * 2);
+        ch.bs_dec_in.Data      = (mfxU8 *)calloc(ch.bs_dec_in.MaxLength, sizeof(mfxU8));
+        VERIFY(ch.bs_dec_in.Data, "Not able to allocate input buffer");
+        ch.bs_dec_in.CodecId = cliParams.codecId;
+        RefillChannelStream(&ch);
+    }
+
+    // Print info about implementation loaded
+    ShowImplementationInfo(loader, 0);
+
+    printf("Running %u channels on %s (%u pass(es) each)\n",
+           cliParams.numChannels,
+           cliParams.infileName,
+           cliParams.numLoops);
+
+    for (Channel &ch : channels)
+        threads.emplace_back(RunChannel, &ch, std::cref(cliParams));
+    for (std::thread &t : threads)
+        t.join();
+
+    PrintChannelReport(channels);
+
+    for (const Channel &ch : channels) {
+        if (ch.sts != MFX_ERR_NONE)
+            isFailed = true;
+    }
+
+end:
+    // Clean up resources - It is recommended to close components first, before
+    // releasing allocated surfaces, since some surfaces may still be locked by
+    // internal resources.
+    for (Channel &ch : channels) {
+        if (ch.session) {
+            MFXVideoENCODE_Close(ch.session);
+            MFXVideoVPP_Close(ch.session);
+            MFXVideoDECODE_Close(ch.session);
+            MFXClose(ch.session);
+        }
+        if (ch.bs_dec_in.Data)
+            free(ch.bs_dec_in.Data);
+        if (ch.bs_enc_out.Data)
+            free(ch.bs_enc_out.Data);
+    }
+
+    if (source)
+        fclose(source);
+
+    if (loader)
+        MFXUnload(loader);
+
+    if (isFailed) {
+        return -1;
+    }
+    else {
+        return 0;
+    }
+}
@@ -55,6 +55,7 @@ int main(int argc, char *argv[]) {
     mfxStatus sts_r                 = MFX_ERR_NONE;
     Params cliParams                = {};
     mfxVideoParam VPPParams         = {};
+    RawFrameReader reader;
 
     // variables used only in 2.x version
     mfxConfig cfg[3];
@@ -123,6 +124,14 @@ int main(int argc, char *argv[]) {
     sts = MFXVideoVPP_Init(session, &VPPParams);
     VERIFY(MFX_ERR_NONE == sts, "Could not initialize VPP");
 
+    // Whole frames are read, the next one is prefetched while the current one is processed
+    sts = reader.Init(source,
+                      VPPParams.vpp.In.FourCC,
+                      cliParams.srcWidth,
+                      cliParams.srcHeight,
+                      true);
+    VERIFY(MFX_ERR_NONE == sts, "Could not initialize raw frame reader");
+
     printf("Processing %s -> %s\n", cliParams.infileName, OUTPUT_FILE);
 
     while (isStillGoing == true) {
@@ -131,7 +140,7 @@ int main(int argc, char *argv[]) {
             sts = MFXMemory_GetSurfaceForVPPIn(session, &vppInSurface);
             VERIFY(MFX_ERR_NONE == sts, "Unknown error in MFXMemory_GetSurfaceForVPPIn");
 
-            sts = ReadRawFrame_InternalMem(vppInSurface, source);
+            sts = reader.ReadFrame_InternalMem(vppInSurface);
             if (sts == MFX_ERR_MORE_DATA)
                 isDraining = true;
             else
@@ -201,6 +210,7 @@ end:
     // Clean up resources - It is recommended to close components first, before
     // releasing allocated surfaces, since some surfaces may still be locked by
     // internal resources.
+    reader.Close();
     if (source)
         fclose(source);
 
@@ -8,6 +8,8 @@
 
 #if defined(_WIN32) || defined(_WIN64)
     #include <Windows.h>
+#else
+    #include <sched.h>
 #endif
 
 #include <assert.h>
@@ -27,6 +29,38 @@ struct mfxDispatcherVersion {
 
 static mfxStatus GetDispatcherVersion(mfxDispatcherVersion *dispatcherVersion);
 
+struct BenchParams {
+    int numIterations; // 0 - single run with per-call log lines
+    int numWarmup;
+    int cpu; // -1 - no pinning
+    bool bResident;
+    bool bUseFastLoad;
+    mfxU32 adapterNum;
+    const char *baselineIn;
+    const char *baselineOut;
+    double thresholdPct;
+};
+
+static void PrintUsage() {
+    printf("Usage: vpl-timing [options]\n");
+    printf("       -e ................ enable EnumImplementations (description)\n");
+    printf("       -f ................ enable fast loading\n");
+    printf("       -p ................ print paths of loaded implementation\n");
+    printf("       -adapterNum n ..... use device adapter number n (default = 0)\n");
+    printf("\nBenchmark mode:\n");
+    printf("       -bench n .......... repeat the load/session sequence n times and print\n");
+    printf("                           per-phase percentiles and 95%% confidence intervals,\n");
+    printf("                           the cold sequence before them runs once\n");
+    printf("       -warmup n ......... iterations discarded after the cold one (default = 3)\n");
+    printf("       -cpu n ............ pin the process to CPU n\n");
+    printf("       -resident ......... keep the runtime loaded between iterations, so warm\n");
+    printf("                           iterations exclude the library load\n");
+    printf("       -save_baseline f .. store the results as a baseline in file f\n");
+    printf("       -baseline f ....... compare with the baseline in file f, exit code is 1\n");
+    printf("                           if a phase regressed\n");
+    printf("       -threshold pct .... regression threshold in percent (default = 5)\n");
+}
+
 static void SetDefaultParamsEncode(mfxVideoParam *par) {
     par->mfx.CodecId                  = MFX_CODEC_AVC;
     par->mfx.TargetUsage              = MFX_TARGETUSAGE_BALANCED;
@@ -51,6 +85,207 @@ static void SetDefaultParamsEncode(mfxVideoParam *par) {
     par->IOPattern = MFX_IOPATTERN_IN_SYSTEM_MEMORY;
 }
 
+// require the minimum API version only, matches every implementation
+static mfxStatus SetMinVersionProperty(mfxConfig config) {
+    mfxVersion ver = {};
+    ver.Major      = 1;
+    ver.Minor      = 0;
+
+    mfxVariant var      = {};
+    var.Version.Version = MFX_VARIANT_VERSION;
+    var.Type            = MFX_VARIANT_TYPE_U32;
+    var.Data.U32        = ver.Version;
+    return MFXSetConfigFilterProperty(config,
+                                      (const mfxU8 *)"mfxImplDescription.ApiVersion.Version",
+                                      var);
+}
+
+static mfxStatus SetFastLoadProperties(mfxLoader loader, mfxU32 adapterNum) {
+    mfxConfig config = MFXCreateConfig(loader);
+    if (!config)
+        return MFX_ERR_NULL_PTR;
+
+    mfxVariant var      = {};
+    var.Version.Version = MFX_VARIANT_VERSION;
+
+    var.Type     = MFX_VARIANT_TYPE_U32;
+    var.Data.U32 = MFX_IMPL_TYPE_HARDWARE;
+    MFXSetConfigFilterProperty(config, (const mfxU8 *)"mfxImplDescription.Impl", var);
+
+    var.Type     = MFX_VARIANT_TYPE_PTR;
+    var.Data.Ptr = (mfxHDL) "mfx-gen";
+    MFXSetConfigFilterProperty(config, (const mfxU8 *)"mfxImplDescription.ImplName", var);
+
+    var.Type     = MFX_VARIANT_TYPE_U32;
+    var.Data.U32 = 0x8086;
+    MFXSetConfigFilterProperty(config, (const mfxU8 *)"mfxImplDescription.VendorID", var);
+
+    var.Type = MFX_VARIANT_TYPE_U32;
+#if defined(_WIN32) || defined(_WIN64)
+    var.Data.U32 = MFX_ACCEL_MODE_VIA_D3D11;
+#else
+    var.Data.U32 = MFX_ACCEL_MODE_VIA_VAAPI;
+#endif
+    MFXSetConfigFilterProperty(config, (const mfxU8 *)"mfxImplDescription.AccelerationMode", var);
+
+    // set which minimum version is required
+    mfxStatus sts = SetMinVersionProperty(config);
+
+    if (adapterNum > 0) {
+#if defined(_WIN32) || defined(_WIN64)
+        var.Type     = MFX_VARIANT_TYPE_U32;
+        var.Data.U32 = adapterNum;
+        sts          = MFXSetConfigFilterProperty(config, (const mfxU8 *)"DXGIAdapterIndex", var);
+#endif
+    }
+
+    return sts;
+}
+
+static bool PinToCPU(int cpu) {
+#if defined(_WIN32) || defined(_WIN64)
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#endif
+}
+
+static double ElapsedUsec(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+// One pass of the sequence a typical application goes through, every phase is timed
+// separately. The encoder is only initialized and closed, runtimes which don't implement it
+// (stub) still get the Init call timed.
+static mfxStatus RunBenchIteration(const BenchParams &par, VPLTimingStats &stats) {
+    auto start       = std::chrono::steady_clock::now();
+    mfxLoader loader = MFXLoad();
+    stats.Add("MFXLoad", ElapsedUsec(start));
+    if (!loader)
+        return MFX_ERR_NOT_FOUND;
+
+    start = std::chrono::steady_clock::now();
+    mfxStatus sts;
+    if (par.bUseFastLoad) {
+        sts = SetFastLoadProperties(loader, par.adapterNum);
+    }
+    else {
+        mfxConfig config = MFXCreateConfig(loader);
+        sts              = config ? SetMinVersionProperty(config) : MFX_ERR_NULL_PTR;
+    }
+    stats.Add("MFXSetConfigFilterProperty", ElapsedUsec(start));
+
+    start      = std::chrono::steady_clock::now();
+    mfxU32 idx = 0;
+    mfxImplDescription *idesc;
+    while (MFX_ERR_NONE == MFXEnumImplementations(loader,
+                                                  idx,
+                                                  MFX_IMPLCAPS_IMPLDESCSTRUCTURE,
+                                                  reinterpret_cast<mfxHDL *>(&idesc))) {
+        MFXDispReleaseImplDescription(loader, idesc);
+        idx++;
+    }
+    stats.Add("MFXEnumImplementations", ElapsedUsec(start));
+
+    mfxSession session = nullptr;
+    start              = std::chrono::steady_clock::now();
+    sts                = MFXCreateSession(loader, 0, &session);
+    stats.Add("MFXCreateSession", ElapsedUsec(start));
+    if (sts != MFX_ERR_NONE) {
+        MFXUnload(loader);
+        return sts;
+    }
+
+    mfxVideoParam par_enc = {};
+    SetDefaultParamsEncode(&par_enc);
+
+    start = std::chrono::steady_clock::now();
+    sts   = MFXVideoENCODE_Init(session, &par_enc);
+    stats.Add("MFXVideoENCODE_Init", ElapsedUsec(start));
+
+    if (sts == MFX_ERR_NONE) {
+        start = std::chrono::steady_clock::now();
+        MFXVideoENCODE_Close(session);
+        stats.Add("MFXVideoENCODE_Close", ElapsedUsec(start));
+    }
+
+    start = std::chrono::steady_clock::now();
+    MFXClose(session);
+    MFXUnload(loader);
+    stats.Add("MFXClose+MFXUnload", ElapsedUsec(start));
+
+    return MFX_ERR_NONE;
+}
+
+static int RunBenchmark(const BenchParams &par) {
+    if (par.cpu >= 0 && !PinToCPU(par.cpu))
+        printf("Warning - failed to pin to CPU %d\n", par.cpu);
+
+    // the first iteration maps the dispatcher's runtime libraries into the process
+    VPLTimingStats coldStats;
+    mfxStatus sts = RunBenchIteration(par, coldStats);
+    if (sts != MFX_ERR_NONE) {
+        printf("Error - benchmark iteration failed with %d\n", sts);
+        return -1;
+    }
+
+    // an extra session keeps the runtime loaded, so warm iterations skip dlopen/LoadLibrary
+    mfxLoader residentLoader   = nullptr;
+    mfxSession residentSession = nullptr;
+    if (par.bResident) {
+        residentLoader = MFXLoad();
+        if (par.bUseFastLoad)
+            SetFastLoadProperties(residentLoader, par.adapterNum);
+        if (!residentLoader || MFXCreateSession(residentLoader, 0, &residentSession)) {
+            printf("Error - failed to create resident session\n");
+            if (residentLoader)
+                MFXUnload(residentLoader);
+            return -1;
+        }
+    }
+
+    VPLTimingStats warmupStats, warmStats;
+    for (int i = 0; i < par.numWarmup + par.numIterations && sts == MFX_ERR_NONE; i++)
+        sts = RunBenchIteration(par, (i < par.numWarmup) ? warmupStats : warmStats);
+
+    if (residentSession) {
+        MFXClose(residentSession);
+        MFXUnload(residentLoader);
+    }
+
+    if (sts != MFX_ERR_NONE) {
+        printf("Error - benchmark iteration failed with %d\n", sts);
+        return -1;
+    }
+
+    // a process loads the runtime for the first time only once, the cold run can't be repeated
+    coldStats.Print("Cold (first load in the process, single run)");
+    warmStats.Print(par.bResident ? "Warm (runtime resident)" : "Warm");
+
+    if (par.baselineOut && !warmStats.Save(par.baselineOut)) {
+        printf("Error - failed to write baseline %s\n", par.baselineOut);
+        return -1;
+    }
+
+    if (par.baselineIn) {
+        int numRegressed = warmStats.Compare(par.baselineIn, par.thresholdPct);
+        if (numRegressed < 0) {
+            printf("Error - failed to read baseline %s\n", par.baselineIn);
+            return -1;
+        }
+        if (numRegressed > 0) {
+            printf("\n%d phase(s) regressed\n", numRegressed);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     mfxSession session = nullptr;
     mfxStatus sts      = MFX_ERR_NONE;
@@ -60,8 +295,35 @@ int main(int argc, char *argv[]) {
     bool bUseFastLoad   = false;
     bool bPrintImplPath = false;
 
+    BenchParams bench   = {};
+    bench.numWarmup     = 3;
+    bench.cpu           = -1;
+    bench.thresholdPct  = 5.0;
+
     for (int i = 1; i < argc; i++) {
-        if (!strncmp(argv[i], "-e", 2)) {
+        bool bHasValue = (i + 1 < argc);
+        if (!strcmp(argv[i], "-bench") && bHasValue) {
+            bench.numIterations = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-warmup") && bHasValue) {
+            bench.numWarmup = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-cpu") && bHasValue) {
+            bench.cpu = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-resident")) {
+            bench.bResident = true;
+        }
+        else if (!strcmp(argv[i], "-save_baseline") && bHasValue) {
+            bench.baselineOut = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-baseline") && bHasValue) {
+            bench.baselineIn = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-threshold") && bHasValue) {
+            bench.thresholdPct = atof(argv[++i]);
+        }
+        else if (!strncmp(argv[i], "-e", 2)) {
             bEnumImpls = true;
         }
         else if (!strncmp(argv[i], "-f", 2)) {
@@ -76,15 +338,25 @@ int main(int argc, char *argv[]) {
         }
         else {
             printf("Error - invalid argument\n\n");
-            printf("Usage: vpl-timing [options]\n");
-            printf("       -e ................ enable EnumImplementations (description)\n");
-            printf("       -f ................ enable fast loading\n");
-            printf("       -p ................ print paths of loaded implementation\n");
-            printf("       -adapterNum n ..... use device adapter number n (default = 0)\n");
+            PrintUsage();
             return -1;
         }
     }
 
+#if !(defined(_WIN32) || defined(_WIN64))
+    if (bUseFastLoad && adapterNum > 0)
+        printf("adapterNum ignored\n");
+#else
+    if (bUseFastLoad && adapterNum > 0)
+        printf("Using adapterNum = %d\n", adapterNum);
+#endif
+
+    if (bench.numIterations > 0) {
+        bench.bUseFastLoad = bUseFastLoad;
+        bench.adapterNum   = adapterNum;
+        return RunBenchmark(bench);
+    }
+
     VPL_LOG_TIME_START(totaltime, "Total time");
 
     VPL_LOG_TIME_START(mfxload, "MFXLoad");
@@ -117,55 +389,7 @@ int main(int argc, char *argv[]) {
     if (bUseFastLoad) {
         VPL_LOG_TIME_START(setprops, "MFXSetConfig (enable fast loading)");
 
-        mfxConfig config = MFXCreateConfig(loader);
-
-        mfxVariant var      = {};
-        var.Version.Version = MFX_VARIANT_VERSION;
-
-        var.Type     = MFX_VARIANT_TYPE_U32;
-        var.Data.U32 = MFX_IMPL_TYPE_HARDWARE;
-        MFXSetConfigFilterProperty(config, (const mfxU8 *)"mfxImplDescription.Impl", var);
-
-        var.Type     = MFX_VARIANT_TYPE_PTR;
-        var.Data.Ptr = (mfxHDL) "mfx-gen";
-        MFXSetConfigFilterProperty(config, (const mfxU8 *)"mfxImplDescription.ImplName", var);
-
-        var.Type     = MFX_VARIANT_TYPE_U32;
-        var.Data.U32 = 0x8086;
-        MFXSetConfigFilterProperty(config, (const mfxU8 *)"mfxImplDescription.VendorID", var);
-
-        var.Type = MFX_VARIANT_TYPE_U32;
-#if defined(_WIN32) || defined(_WIN64)
-        var.Data.U32 = MFX_ACCEL_MODE_VIA_D3D11;
-#else
-        var.Data.U32 = MFX_ACCEL_MODE_VIA_VAAPI;
-#endif
-        MFXSetConfigFilterProperty(config,
-                                   (const mfxU8 *)"mfxImplDescription.AccelerationMode",
-                                   var);
-
-        // set which minimum version is required
-        mfxVersion ver = {};
-        ver.Major      = 1;
-        ver.Minor      = 0;
-
-        var.Type     = MFX_VARIANT_TYPE_U32;
-        var.Data.U32 = ver.Version;
-        sts          = MFXSetConfigFilterProperty(config,
-                                         (const mfxU8 *)"mfxImplDescription.ApiVersion.Version",
-                                         var);
-
-        if (adapterNum > 0) {
-#if defined(_WIN32) || defined(_WIN64)
-            printf("Using adapterNum = %d\n", adapterNum);
-
-            var.Type     = MFX_VARIANT_TYPE_U32;
-            var.Data.U32 = adapterNum;
-            sts = MFXSetConfigFilterProperty(config, (const mfxU8 *)"DXGIAdapterIndex", var);
-#else
-            printf("adapterNum ignored\n");
-#endif
-        }
+        sts = SetFastLoadProperties(loader, adapterNum);
 
         VPL_LOG_TIME_END(setprops);
     }
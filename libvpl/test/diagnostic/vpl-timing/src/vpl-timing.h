@@ -7,11 +7,193 @@
 #ifndef LIBVPL_TEST_DIAGNOSTIC_VPL_TIMING_SRC_VPL_TIMING_H_
 #define LIBVPL_TEST_DIAGNOSTIC_VPL_TIMING_SRC_VPL_TIMING_H_
 
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
 #include <chrono>
+#include <map>
 #include <string>
+#include <vector>
 
 #define ENABLE_VPL_LOG_TIME
 
+// Samples of the benchmark phases, times are in microseconds.
+// Phases are reported in the order they were first added.
+class VPLTimingStats {
+public:
+    struct Summary {
+        size_t count;
+        double min;
+        double max;
+        double mean;
+        double stddev;
+        double p50;
+        double p90;
+        double p99;
+        double ci95; // half-width of the 95% confidence interval of the mean
+    };
+
+    VPLTimingStats() : m_names(), m_samples() {}
+
+    void Add(const std::string &phase, double usec) {
+        if (m_samples.find(phase) == m_samples.end())
+            m_names.push_back(phase);
+        m_samples[phase].push_back(usec);
+    }
+
+    const std::vector<std::string> &GetPhases() const {
+        return m_names;
+    }
+
+    bool GetSummary(const std::string &phase, Summary &summary) const {
+        auto it = m_samples.find(phase);
+        if (it == m_samples.end() || it->second.empty())
+            return false;
+
+        std::vector<double> s = it->second;
+        std::sort(s.begin(), s.end());
+
+        summary       = {};
+        summary.count = s.size();
+        summary.min   = s.front();
+        summary.max   = s.back();
+
+        double sum = 0;
+        for (double v : s)
+            sum += v;
+        summary.mean = sum / s.size();
+
+        double sq = 0;
+        for (double v : s)
+            sq += (v - summary.mean) * (v - summary.mean);
+        summary.stddev = (s.size() > 1) ? sqrt(sq / (s.size() - 1)) : 0;
+
+        summary.p50  = Percentile(s, 50);
+        summary.p90  = Percentile(s, 90);
+        summary.p99  = Percentile(s, 99);
+        summary.ci95 = (s.size() > 1)
+                           ? StudentT95(s.size() - 1) * summary.stddev / sqrt((double)s.size())
+                           : 0;
+        return true;
+    }
+
+    void Print(const char *title) const {
+        printf("\n%s\n", title);
+        printf("%-28s %6s %10s %10s %10s %10s %10s %10s %10s\n",
+               "phase (usec)",
+               "n",
+               "min",
+               "p50",
+               "p90",
+               "p99",
+               "max",
+               "mean",
+               "+-ci95");
+        for (const std::string &phase : m_names) {
+            Summary s;
+            if (!GetSummary(phase, s))
+                continue;
+            printf("%-28s %6zu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                   phase.c_str(),
+                   s.count,
+                   s.min,
+                   s.p50,
+                   s.p90,
+                   s.p99,
+                   s.max,
+                   s.mean,
+                   s.ci95);
+        }
+    }
+
+    // one line per phase: name count mean ci95 p50
+    bool Save(const char *fileName) const {
+        FILE *f = fopen(fileName, "w");
+        if (!f)
+            return false;
+        fprintf(f, "# vpl-timing baseline: phase count mean_usec ci95_usec p50_usec\n");
+        for (const std::string &phase : m_names) {
+            Summary s;
+            if (GetSummary(phase, s))
+                fprintf(f,
+                        "%s %zu %.3f %.3f %.3f\n",
+                        phase.c_str(),
+                        s.count,
+                        s.mean,
+                        s.ci95,
+                        s.p50);
+        }
+        bool ok = !ferror(f);
+        fclose(f);
+        return ok;
+    }
+
+    // Compares the means with a baseline. A phase regresses if it is slower by more than
+    // thresholdPct percent and the difference is larger than both confidence intervals together.
+    // Returns the number of regressed phases or -1 if the baseline can't be read.
+    int Compare(const char *fileName, double thresholdPct) const {
+        FILE *f = fopen(fileName, "r");
+        if (!f)
+            return -1;
+
+        printf("\nComparison with baseline %s (threshold %.1f%%)\n", fileName, thresholdPct);
+        printf("%-28s %10s %10s %8s\n", "phase (usec)", "baseline", "current", "change");
+
+        int numRegressed = 0;
+        char line[512];
+        while (fgets(line, sizeof(line), f)) {
+            char name[256];
+            unsigned long count = 0;
+            double mean = 0, ci95 = 0, p50 = 0;
+            if (line[0] == '#' ||
+                sscanf(line, "%255s %lu %lf %lf %lf", name, &count, &mean, &ci95, &p50) != 5)
+                continue;
+
+            Summary s;
+            if (!GetSummary(name, s)) {
+                printf("%-28s %10.1f %10s\n", name, mean, "-");
+                continue;
+            }
+
+            double change   = (mean > 0) ? 100.0 * (s.mean - mean) / mean : 0;
+            bool bSignif    = fabs(s.mean - mean) > s.ci95 + ci95;
+            const char *tag = "";
+            if (bSignif && change > thresholdPct) {
+                tag = "REGRESSION";
+                numRegressed++;
+            }
+            else if (bSignif && change < -thresholdPct) {
+                tag = "improved";
+            }
+            printf("%-28s %10.1f %10.1f %+7.1f%% %s\n", name, mean, s.mean, change, tag);
+        }
+        fclose(f);
+        return numRegressed;
+    }
+
+private:
+    // nearest-rank percentile of sorted samples
+    static double Percentile(const std::vector<double> &sorted, double pct) {
+        size_t rank = (size_t)ceil(pct / 100.0 * sorted.size());
+        return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+    }
+
+    // two-sided 95% quantile of Student's t distribution
+    static double StudentT95(size_t df) {
+        static const double t[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+                                    2.262,  2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+                                    2.110,  2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+                                    2.060,  2.056, 2.052, 2.048, 2.045, 2.042 };
+        if (df == 0)
+            return 0;
+        return (df <= sizeof(t) / sizeof(t[0])) ? t[df - 1] : 1.96;
+    }
+
+    std::vector<std::string> m_names;
+    std::map<std::string, std::vector<double>> m_samples;
+};
+
 #ifdef ENABLE_VPL_LOG_TIME
 
 class VPLLogTiming {
@@ -7,14 +7,18 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <fstream>
 #include <string>
+#include <thread>
 #include <vector>
 #include "vpl/mfx.h"
 
 #ifdef __linux__
+    #include <dirent.h>
     #include <fcntl.h>
     #include <stdlib.h>
     #include <unistd.h>
@@ -118,6 +122,239 @@ const char *_print_MediaAdapterType(mfxMediaAdapterType type) {
     return "<unknown media adapter type>";
 }
 
+// DRM render node with the PCI attributes of its device, read from sysfs
+typedef struct drmnode {
+    std::string name; // e.g. renderD128
+    int nodeNum;
+    std::string pciSlot; // domain:bus:device.function, empty if not a PCI device
+    unsigned int vendorId;
+    unsigned int deviceId;
+    std::string driver;
+    bool isVirtualFunction;
+    int numVirtualFunctions;
+    int numaNode; // -1 if unknown or not a NUMA system
+    std::string cpuList;
+} drmnode;
+
+// device location reported by an implementation, for correlation with render nodes
+typedef struct impldevice {
+    int implIdx;
+    std::string implName;
+    int renderNodeNum;
+    std::string pciSlot;
+    unsigned int deviceId;
+} impldevice;
+
+static bool read_sysfs_line(const std::string &path, std::string &value) {
+    std::ifstream f(path.c_str());
+    if (!f.good() || !std::getline(f, value))
+        return false;
+    while (!value.empty() && (value.back() == '\n' || value.back() == ' '))
+        value.pop_back();
+    return true;
+}
+
+static bool read_sysfs_int(const std::string &path, int base, int &value) {
+    std::string str;
+    if (!read_sysfs_line(path, str) || str.empty())
+        return false;
+    char *end = nullptr;
+    long v    = strtol(str.c_str(), &end, base);
+    if (end == str.c_str())
+        return false;
+    value = (int)v;
+    return true;
+}
+
+static std::string format_pci_slot(unsigned int domain,
+                                   unsigned int bus,
+                                   unsigned int device,
+                                   unsigned int function) {
+    char str[32];
+    snprintf(str, sizeof(str), "%04x:%02x:%02x.%x", domain, bus, device, function);
+    return std::string(str);
+}
+
+// Read the attributes of <root>/class/drm/<name>/device. Keys from uevent are preferred,
+// they are plain files in a fake tree where the driver link cannot be resolved.
+static void read_drm_device(const std::string &devPath, drmnode &node) {
+    std::ifstream uevent((devPath + "/uevent").c_str());
+    std::string line;
+    while (std::getline(uevent, line)) {
+        size_t eq = line.find('=');
+        if (eq == std::string::npos)
+            continue;
+        std::string key = line.substr(0, eq);
+        std::string val = line.substr(eq + 1);
+        if (key == "DRIVER") {
+            node.driver = val;
+        }
+        else if (key == "PCI_SLOT_NAME") {
+            node.pciSlot = val;
+        }
+        else if (key == "PCI_ID") {
+            sscanf(val.c_str(), "%x:%x", &node.vendorId, &node.deviceId);
+        }
+    }
+
+    int value = 0;
+    if (!node.vendorId && read_sysfs_int(devPath + "/vendor", 16, value))
+        node.vendorId = (unsigned int)value;
+    if (!node.deviceId && read_sysfs_int(devPath + "/device", 16, value))
+        node.deviceId = (unsigned int)value;
+
+    if (node.driver.empty()) {
+        char target[256] = {};
+        if (readlink((devPath + "/driver").c_str(), target, sizeof(target) - 1) > 0) {
+            const char *base = strrchr(target, '/');
+            node.driver      = base ? base + 1 : target;
+        }
+    }
+
+    std::ifstream physfn((devPath + "/physfn/uevent").c_str());
+    node.isVirtualFunction = physfn.good();
+    if (read_sysfs_int(devPath + "/sriov_numvfs", 10, value))
+        node.numVirtualFunctions = value;
+
+    if (!read_sysfs_int(devPath + "/numa_node", 10, node.numaNode))
+        node.numaNode = -1;
+    read_sysfs_line(devPath + "/local_cpulist", node.cpuList);
+}
+
+// All render nodes listed under <sysfsRoot>/class/drm, sorted by node number.
+// Returns false if the directory cannot be read.
+bool find_render_nodes(const std::string &sysfsRoot, std::vector<drmnode> &nodes) {
+    std::string drmPath = sysfsRoot + "/class/drm";
+    DIR *dir            = opendir(drmPath.c_str());
+    if (!dir)
+        return false;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        int nodeNum = 0;
+        if (sscanf(entry->d_name, "renderD%d", &nodeNum) != 1)
+            continue;
+
+        drmnode node  = {};
+        node.name     = entry->d_name;
+        node.nodeNum  = nodeNum;
+        node.numaNode = -1;
+        read_drm_device(drmPath + "/" + node.name + "/device", node);
+        nodes.push_back(node);
+    }
+    closedir(dir);
+
+    std::sort(nodes.begin(), nodes.end(), [](const drmnode &a, const drmnode &b) {
+        return a.nodeNum < b.nodeNum;
+    });
+    return true;
+}
+
+std::vector<impldevice> get_impl_devices() {
+    std::vector<impldevice> devices;
+    mfxLoader loader = MFXLoad();
+    if (loader == NULL)
+        return devices;
+
+    mfxImplDescription *idesc;
+    for (int i = 0; MFX_ERR_NONE == MFXEnumImplementations(loader,
+                                                          i,
+                                                          MFX_IMPLCAPS_IMPLDESCSTRUCTURE,
+                                                          reinterpret_cast<mfxHDL *>(&idesc));
+         i++) {
+        impldevice dev    = {};
+        dev.implIdx       = i;
+        dev.implName      = idesc->ImplName;
+        dev.renderNodeNum = -1;
+        MFXDispReleaseImplDescription(loader, idesc);
+
+        mfxExtendedDeviceId *idescDevice;
+        if (MFX_ERR_NONE == MFXEnumImplementations(loader,
+                                                   i,
+                                                   MFX_IMPLCAPS_DEVICE_ID_EXTENDED,
+                                                   reinterpret_cast<mfxHDL *>(&idescDevice))) {
+            dev.renderNodeNum = idescDevice->DRMRenderNodeNum;
+            dev.deviceId      = idescDevice->DeviceID;
+            dev.pciSlot       = format_pci_slot(idescDevice->PCIDomain,
+                                                idescDevice->PCIBus,
+                                                idescDevice->PCIDevice,
+                                                idescDevice->PCIFunction);
+            MFXDispReleaseImplDescription(loader, idescDevice);
+        }
+        devices.push_back(dev);
+    }
+
+    MFXUnload(loader);
+    return devices;
+}
+
+// Prints one block per render node: PCI location, SR-IOV role, NUMA locality and the
+// implementations driving it. Returns the number of nodes found.
+int show_render_node_topology(const std::string &sysfsRoot) {
+    std::vector<drmnode> nodes;
+    if (!find_render_nodes(sysfsRoot, nodes)) {
+        // containers may expose /dev/dri without sysfs, list the nodes without topology
+        printf("Cannot read %s/class/drm, no topology available\n", sysfsRoot.c_str());
+        int nFound = 0;
+        DIR *dir   = opendir("/dev/dri");
+        if (dir) {
+            struct dirent *entry;
+            while ((entry = readdir(dir)) != nullptr) {
+                if (!strncmp(entry->d_name, "renderD", 7)) {
+                    printf("FOUND: /dev/dri/%s\n", entry->d_name);
+                    nFound++;
+                }
+            }
+            closedir(dir);
+        }
+        return nFound;
+    }
+
+    std::vector<impldevice> devices = get_impl_devices();
+
+    for (const drmnode &node : nodes) {
+        std::string devNode = "/dev/dri/" + node.name;
+        printf("FOUND: %s\n", devNode.c_str());
+        if (sysfsRoot == "/sys" && access(devNode.c_str(), R_OK | W_OK) != 0)
+            printf("  no read/write access, check membership in the render group\n");
+
+        if (!node.pciSlot.empty()) {
+            gpuinfo g = get_gpuinfo(node.deviceId);
+            printf("  PCI: %s  VendorID: 0x%04X  DeviceID: 0x%04X (%s)\n",
+                   node.pciSlot.c_str(),
+                   node.vendorId,
+                   node.deviceId,
+                   g.name.data());
+        }
+        printf("  Driver: %s\n", node.driver.empty() ? "none" : node.driver.c_str());
+        if (node.isVirtualFunction)
+            printf("  SR-IOV: virtual function\n");
+        else if (node.numVirtualFunctions > 0)
+            printf("  SR-IOV: physical function, %d VFs enabled\n", node.numVirtualFunctions);
+
+        if (node.numaNode >= 0)
+            printf("  NUMA node: %d\n", node.numaNode);
+        else
+            printf("  NUMA node: none\n");
+        printf("  Local CPUs: %s\n", node.cpuList.empty() ? "unknown" : node.cpuList.c_str());
+
+        printf("  Implementations:");
+        int numMatched = 0;
+        for (const impldevice &dev : devices) {
+            bool bMatch = (dev.renderNodeNum == node.nodeNum) ||
+                          (dev.renderNodeNum <= 0 && !node.pciSlot.empty() &&
+                           dev.pciSlot == node.pciSlot);
+            if (bMatch) {
+                printf(" #%d %s", dev.implIdx, dev.implName.c_str());
+                numMatched++;
+            }
+        }
+        printf("%s\n", numMatched ? "" : " none");
+    }
+
+    return (int)nodes.size();
+}
+
 bool show_MFXLoad_info() {
     mfxLoader loader = MFXLoad();
     if (loader == NULL) {
@@ -208,7 +445,658 @@ bool show_MFXLoad_info() {
     return (i > 0) ? true : false;
 }
 
-int main() {
+// Probing mode: short timed cycles against every implementation, meant for capacity
+// planning without running the full samples. Works with the stub and CPU runtimes too,
+// workloads an implementation cannot initialize are reported as not available.
+typedef struct probeparams {
+    bool enabled;
+    mfxU32 numCycles;
+    mfxU32 numFrames;
+    mfxU32 maxSessions;
+    mfxU16 width;
+    mfxU16 height;
+} probeparams;
+
+enum ProbeWorkload { PROBE_ENCODE = 0, PROBE_DECODE, PROBE_VPP };
+
+const char *_print_Workload(ProbeWorkload w) {
+    switch (w) {
+        case PROBE_ENCODE:
+            return "Encode";
+        case PROBE_DECODE:
+            return "Decode";
+        case PROBE_VPP:
+            return "VPP";
+    }
+    return "<unknown workload>";
+}
+
+std::string _print_FourCC(mfxU32 fourcc) {
+    char str[5] = { (char)(fourcc & 0xFF),
+                    (char)((fourcc >> 8) & 0xFF),
+                    (char)((fourcc >> 16) & 0xFF),
+                    (char)((fourcc >> 24) & 0xFF),
+                    0 };
+    return std::string(str);
+}
+
+// workload configuration picked from the implementation description
+typedef struct probeconfig {
+    mfxU32 encCodec; // 0 - no usable encoder
+    mfxU32 decCodec; // 0 - no usable decoder
+    bool hasVPP;
+    mfxU32 fourcc;
+} probeconfig;
+
+// frames delivered by a burst and the time it took, session setup excluded
+typedef struct burstresult {
+    mfxU32 numFrames;
+    double usec;
+} burstresult;
+
+static double get_fps(const burstresult &res) {
+    return (res.usec > 0) ? res.numFrames * 1e6 / res.usec : 0;
+}
+
+static double elapsed_usec(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+#define PROBE_SYNC_TIMEOUT_MS 60000
+#define PROBE_BUSY_SLEEP_MS   1
+
+// Gives a busy device time to finish the work in flight. Returns false once it has been busy for
+// as long as a frame may take to sync.
+static bool wait_busy_device(mfxU32 *busyMs) {
+    if (*busyMs >= PROBE_SYNC_TIMEOUT_MS)
+        return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(PROBE_BUSY_SLEEP_MS));
+    *busyMs += PROBE_BUSY_SLEEP_MS;
+    return true;
+}
+
+static bool is_probe_format(mfxU32 fourcc) {
+    return fourcc == MFX_FOURCC_NV12 || fourcc == MFX_FOURCC_I420;
+}
+
+probeconfig get_probe_config(const mfxImplDescription *idesc) {
+    probeconfig cfg = {};
+
+    for (int c = 0; c < idesc->Enc.NumCodecs && !cfg.encCodec; c++) {
+        const mfxEncoderDescription::encoder &enc = idesc->Enc.Codecs[c];
+        for (int p = 0; p < enc.NumProfiles && !cfg.encCodec; p++) {
+            for (int m = 0; m < enc.Profiles[p].NumMemTypes && !cfg.encCodec; m++) {
+                const auto &mem = enc.Profiles[p].MemDesc[m];
+                if (mem.MemHandleType != MFX_RESOURCE_SYSTEM_SURFACE)
+                    continue;
+                for (int f = 0; f < mem.NumColorFormats; f++) {
+                    if (is_probe_format(mem.ColorFormats[f])) {
+                        cfg.encCodec = enc.CodecID;
+                        cfg.fourcc   = mem.ColorFormats[f];
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    // decode consumes what the encode burst produced
+    for (int c = 0; c < idesc->Dec.NumCodecs && cfg.encCodec; c++) {
+        if (idesc->Dec.Codecs[c].CodecID == cfg.encCodec)
+            cfg.decCodec = cfg.encCodec;
+    }
+
+    cfg.hasVPP = (idesc->VPP.NumFilters > 0);
+    if (!cfg.fourcc)
+        cfg.fourcc = MFX_FOURCC_NV12;
+
+    return cfg;
+}
+
+static void fill_probe_frame(mfxFrameSurface1 *surface, mfxU32 frameNum) {
+    const mfxFrameInfo &info = surface->Info;
+    mfxFrameData &data       = surface->Data;
+    mfxU16 w                 = info.CropW ? info.CropW : info.Width;
+    mfxU16 h                 = info.CropH ? info.CropH : info.Height;
+    mfxU16 pitch             = data.Pitch;
+
+    for (mfxU16 y = 0; y < h; y++) {
+        mfxU8 *row = data.Y + (size_t)y * pitch;
+        for (mfxU16 x = 0; x < w; x++)
+            row[x] = (mfxU8)(x + y + frameNum * 4);
+    }
+
+    if (info.FourCC == MFX_FOURCC_I420) {
+        for (mfxU16 y = 0; y < h / 2; y++) {
+            memset(data.U + (size_t)y * (pitch / 2), 128, w / 2);
+            memset(data.V + (size_t)y * (pitch / 2), 128, w / 2);
+        }
+    }
+    else {
+        for (mfxU16 y = 0; y < h / 2; y++)
+            memset(data.UV + (size_t)y * pitch, 128, w);
+    }
+}
+
+static void set_probe_frame_info(mfxFrameInfo *info, const probeparams &par, mfxU32 fourcc) {
+    info->FourCC        = fourcc;
+    info->ChromaFormat  = MFX_CHROMAFORMAT_YUV420;
+    info->PicStruct     = MFX_PICSTRUCT_PROGRESSIVE;
+    info->FrameRateExtN = 30;
+    info->FrameRateExtD = 1;
+    info->CropW         = par.width;
+    info->CropH         = par.height;
+    info->Width         = (par.width + 15) & ~15;
+    info->Height        = (par.height + 15) & ~15;
+}
+
+static void set_probe_encode_params(mfxVideoParam *vpar,
+                                    const probeparams &par,
+                                    const probeconfig &cfg) {
+    memset(vpar, 0, sizeof(*vpar));
+    vpar->mfx.CodecId                 = cfg.encCodec;
+    vpar->mfx.TargetUsage             = MFX_TARGETUSAGE_BEST_SPEED;
+    vpar->mfx.RateControlMethod       = MFX_RATECONTROL_CQP;
+    vpar->mfx.QPI                     = 26;
+    vpar->mfx.QPP                     = 28;
+    vpar->mfx.QPB                     = 30;
+    vpar->mfx.GopPicSize              = 30;
+    vpar->AsyncDepth                  = 1;
+    vpar->IOPattern                   = MFX_IOPATTERN_IN_SYSTEM_MEMORY;
+    set_probe_frame_info(&vpar->mfx.FrameInfo, par, cfg.fourcc);
+}
+
+// One frame is kept in flight per session, so the reported rate is what a single
+// low-latency channel achieves; the concurrency curve shows the aggregate capacity.
+static mfxStatus run_encode_burst(mfxSession session,
+                                  const probeparams &par,
+                                  const probeconfig &cfg,
+                                  std::vector<mfxU8> *stream,
+                                  burstresult *res) {
+    mfxVideoParam vpar;
+    set_probe_encode_params(&vpar, par, cfg);
+    mfxStatus sts = MFXVideoENCODE_Init(session, &vpar);
+    if (sts < MFX_ERR_NONE)
+        return sts;
+
+    std::vector<mfxU8> buffer((size_t)vpar.mfx.FrameInfo.Width * vpar.mfx.FrameInfo.Height * 4);
+    mfxBitstream bs = {};
+    bs.Data         = buffer.data();
+    bs.MaxLength    = (mfxU32)buffer.size();
+
+    auto start       = std::chrono::steady_clock::now();
+    mfxU32 numOutput = 0;
+    bool bDrain      = false;
+    for (mfxU32 i = 0; sts >= MFX_ERR_NONE || sts == MFX_ERR_MORE_DATA; i++) {
+        mfxFrameSurface1 *surface = nullptr;
+        bDrain                    = (i >= par.numFrames);
+        if (!bDrain) {
+            sts = MFXMemory_GetSurfaceForEncode(session, &surface);
+            if (sts != MFX_ERR_NONE)
+                break;
+            sts = surface->FrameInterface->Map(surface, MFX_MAP_WRITE);
+            if (sts != MFX_ERR_NONE) {
+                surface->FrameInterface->Release(surface);
+                break;
+            }
+            fill_probe_frame(surface, i);
+            surface->FrameInterface->Unmap(surface);
+        }
+
+        // a busy device gets the same frame again
+        mfxSyncPoint syncp = nullptr;
+        mfxU32 busyMs      = 0;
+        do {
+            sts = MFXVideoENCODE_EncodeFrameAsync(session, nullptr, surface, &bs, &syncp);
+        } while (sts == MFX_WRN_DEVICE_BUSY && wait_busy_device(&busyMs));
+        if (surface)
+            surface->FrameInterface->Release(surface);
+        if (sts == MFX_WRN_DEVICE_BUSY) {
+            sts = MFX_ERR_DEVICE_FAILED;
+            break;
+        }
+
+        if (sts == MFX_ERR_MORE_DATA && bDrain) {
+            sts = MFX_ERR_NONE;
+            break;
+        }
+        if (sts >= MFX_ERR_NONE && syncp) {
+            sts = MFXVideoCORE_SyncOperation(session, syncp, PROBE_SYNC_TIMEOUT_MS);
+            if (stream)
+                stream->insert(stream->end(), bs.Data + bs.DataOffset,
+                               bs.Data + bs.DataOffset + bs.DataLength);
+            bs.DataOffset = 0;
+            bs.DataLength = 0;
+            numOutput++;
+        }
+    }
+    double usec = elapsed_usec(start);
+
+    MFXVideoENCODE_Close(session);
+    if (sts < MFX_ERR_NONE)
+        return sts;
+
+    res->numFrames = numOutput;
+    res->usec      = usec;
+    return MFX_ERR_NONE;
+}
+
+static mfxStatus run_decode_burst(mfxSession session,
+                                  const probeconfig &cfg,
+                                  std::vector<mfxU8> &stream,
+                                  burstresult *res) {
+    if (stream.empty())
+        return MFX_ERR_MORE_DATA;
+
+    mfxBitstream bs = {};
+    bs.Data         = stream.data();
+    bs.DataLength   = (mfxU32)stream.size();
+    bs.MaxLength    = (mfxU32)stream.size();
+
+    mfxVideoParam vpar = {};
+    vpar.mfx.CodecId   = cfg.decCodec;
+    vpar.IOPattern     = MFX_IOPATTERN_OUT_SYSTEM_MEMORY;
+    mfxStatus sts      = MFXVideoDECODE_DecodeHeader(session, &bs, &vpar);
+    if (sts < MFX_ERR_NONE)
+        return sts;
+    sts = MFXVideoDECODE_Init(session, &vpar);
+    if (sts < MFX_ERR_NONE)
+        return sts;
+
+    auto start       = std::chrono::steady_clock::now();
+    mfxU32 numOutput = 0;
+    mfxU32 busyMs    = 0;
+    bool bDrain      = false;
+    for (;;) {
+        mfxFrameSurface1 *out = nullptr;
+        mfxSyncPoint syncp    = nullptr;
+        sts = MFXVideoDECODE_DecodeFrameAsync(session,
+                                              bDrain ? nullptr : &bs,
+                                              nullptr,
+                                              &out,
+                                              &syncp);
+        if (sts == MFX_ERR_MORE_DATA) {
+            if (bDrain) {
+                sts = MFX_ERR_NONE;
+                break;
+            }
+            bDrain = true;
+            continue;
+        }
+        // the device frees surfaces and gets ready as it completes frames in flight
+        if (sts == MFX_ERR_MORE_SURFACE || sts == MFX_WRN_DEVICE_BUSY) {
+            if (wait_busy_device(&busyMs))
+                continue;
+            sts = MFX_ERR_DEVICE_FAILED;
+            break;
+        }
+        busyMs = 0;
+        if (sts < MFX_ERR_NONE)
+            break;
+        if (out && syncp) {
+            sts = out->FrameInterface->Synchronize(out, PROBE_SYNC_TIMEOUT_MS);
+            out->FrameInterface->Release(out);
+            if (sts < MFX_ERR_NONE)
+                break;
+            numOutput++;
+        }
+    }
+    double usec = elapsed_usec(start);
+
+    MFXVideoDECODE_Close(session);
+    if (sts < MFX_ERR_NONE)
+        return sts;
+
+    res->numFrames = numOutput;
+    res->usec      = usec;
+    return MFX_ERR_NONE;
+}
+
+// input frame size to half size, the typical preview/thumbnail path
+static mfxStatus run_vpp_burst(mfxSession session,
+                               const probeparams &par,
+                               const probeconfig &cfg,
+                               burstresult *res) {
+    mfxVideoParam vpar = {};
+    vpar.IOPattern     = MFX_IOPATTERN_IN_SYSTEM_MEMORY | MFX_IOPATTERN_OUT_SYSTEM_MEMORY;
+    set_probe_frame_info(&vpar.vpp.In, par, cfg.fourcc);
+    probeparams outPar = par;
+    outPar.width       = par.width / 2;
+    outPar.height      = par.height / 2;
+    set_probe_frame_info(&vpar.vpp.Out, outPar, cfg.fourcc);
+
+    mfxStatus sts = MFXVideoVPP_Init(session, &vpar);
+    if (sts < MFX_ERR_NONE)
+        return sts;
+
+    auto start       = std::chrono::steady_clock::now();
+    mfxU32 numOutput = 0;
+    for (mfxU32 i = 0; i < par.numFrames; i++) {
+        mfxFrameSurface1 *in = nullptr;
+        sts                  = MFXMemory_GetSurfaceForVPPIn(session, &in);
+        if (sts != MFX_ERR_NONE)
+            break;
+        sts = in->FrameInterface->Map(in, MFX_MAP_WRITE);
+        if (sts != MFX_ERR_NONE) {
+            in->FrameInterface->Release(in);
+            break;
+        }
+        fill_probe_frame(in, i);
+        in->FrameInterface->Unmap(in);
+
+        mfxFrameSurface1 *out = nullptr;
+        sts                   = MFXVideoVPP_ProcessFrameAsync(session, in, &out);
+        in->FrameInterface->Release(in);
+        if (sts < MFX_ERR_NONE)
+            break;
+        if (out) {
+            sts = out->FrameInterface->Synchronize(out, PROBE_SYNC_TIMEOUT_MS);
+            out->FrameInterface->Release(out);
+            if (sts < MFX_ERR_NONE)
+                break;
+            numOutput++;
+        }
+    }
+    double usec = elapsed_usec(start);
+
+    MFXVideoVPP_Close(session);
+    if (sts < MFX_ERR_NONE)
+        return sts;
+
+    res->numFrames = numOutput;
+    res->usec      = usec;
+    return MFX_ERR_NONE;
+}
+
+static mfxStatus run_burst(mfxSession session,
+                           ProbeWorkload w,
+                           const probeparams &par,
+                           const probeconfig &cfg,
+                           std::vector<mfxU8> *stream,
+                           burstresult *res) {
+    switch (w) {
+        case PROBE_ENCODE:
+            return run_encode_burst(session, par, cfg, stream, res);
+        case PROBE_DECODE:
+            return run_decode_burst(session, cfg, *stream, res);
+        case PROBE_VPP:
+            return run_vpp_burst(session, par, cfg, res);
+    }
+    return MFX_ERR_UNSUPPORTED;
+}
+
+static void print_latency(const char *name, std::vector<double> &usec) {
+    if (usec.empty())
+        return;
+    std::sort(usec.begin(), usec.end());
+    double sum = 0;
+    for (double v : usec)
+        sum += v;
+    printf("    %-26s min %9.1f  p50 %9.1f  max %9.1f  mean %9.1f\n",
+           name,
+           usec.front(),
+           usec[(usec.size() - 1) / 2],
+           usec.back(),
+           sum / usec.size());
+}
+
+// session create, encoder Init/Close and session close, repeated numCycles times
+static void probe_session_latency(mfxLoader loader,
+                                  mfxU32 implIdx,
+                                  const probeparams &par,
+                                  const probeconfig &cfg) {
+    std::vector<double> createUsec, initUsec, closeUsec;
+    mfxStatus initSts = MFX_ERR_NONE;
+
+    for (mfxU32 i = 0; i < par.numCycles; i++) {
+        mfxSession session = nullptr;
+        auto start         = std::chrono::steady_clock::now();
+        mfxStatus sts      = MFXCreateSession(loader, implIdx, &session);
+        createUsec.push_back(elapsed_usec(start));
+        if (sts != MFX_ERR_NONE) {
+            printf("  MFXCreateSession failed with %d\n", sts);
+            return;
+        }
+
+        if (cfg.encCodec) {
+            mfxVideoParam vpar;
+            set_probe_encode_params(&vpar, par, cfg);
+            start   = std::chrono::steady_clock::now();
+            initSts = MFXVideoENCODE_Init(session, &vpar);
+            if (initSts >= MFX_ERR_NONE)
+                MFXVideoENCODE_Close(session);
+            initUsec.push_back(elapsed_usec(start));
+        }
+
+        start = std::chrono::steady_clock::now();
+        MFXClose(session);
+        closeUsec.push_back(elapsed_usec(start));
+    }
+
+    printf("  Session setup latency (%u cycles, usec):\n", par.numCycles);
+    print_latency("MFXCreateSession", createUsec);
+    print_latency("MFXVideoENCODE_Init+Close", initUsec);
+    if (initSts < MFX_ERR_NONE)
+        printf("    %-26s (Init returned %d)\n", "", initSts);
+    print_latency("MFXClose", closeUsec);
+}
+
+// aggregate rate of n sessions running the same workload in parallel threads
+static void probe_concurrency(mfxLoader loader,
+                              mfxU32 implIdx,
+                              ProbeWorkload w,
+                              const probeparams &par,
+                              const probeconfig &cfg,
+                              const std::vector<mfxU8> &stream) {
+    printf("  Concurrency scaling (%s):\n", _print_Workload(w));
+    printf("    %8s %14s %16s %11s\n",
+           "sessions",
+           "aggregate fps",
+           "per-session fps",
+           "efficiency");
+
+    double singleFps = 0;
+    for (mfxU32 n = 1; n <= par.maxSessions; n *= 2) {
+        // sessions are created serially, the loader is not meant to be shared across threads
+        std::vector<mfxSession> sessions(n, nullptr);
+        mfxStatus sts = MFX_ERR_NONE;
+        for (mfxU32 i = 0; i < n && sts == MFX_ERR_NONE; i++)
+            sts = MFXCreateSession(loader, implIdx, &sessions[i]);
+
+        std::vector<burstresult> res(n, burstresult());
+        std::vector<mfxStatus> results(n, MFX_ERR_NONE);
+        // decode needs its own copy of the input, encode output is not kept
+        std::vector<std::vector<mfxU8>> streams(w == PROBE_DECODE ? n : 0, stream);
+        auto start = std::chrono::steady_clock::now();
+        if (sts == MFX_ERR_NONE) {
+            std::vector<std::thread> threads;
+            for (mfxU32 i = 0; i < n; i++) {
+                threads.emplace_back([&, i]() {
+                    std::vector<mfxU8> *s = streams.empty() ? nullptr : &streams[i];
+                    results[i]            = run_burst(sessions[i], w, par, cfg, s, &res[i]);
+                });
+            }
+            for (auto &t : threads)
+                t.join();
+        }
+        double usec = elapsed_usec(start);
+
+        burstresult total = {};
+        for (mfxU32 i = 0; i < n; i++) {
+            if (sessions[i])
+                MFXClose(sessions[i]);
+            if (results[i] < MFX_ERR_NONE)
+                sts = results[i];
+            total.numFrames += res[i].numFrames;
+        }
+        if (sts != MFX_ERR_NONE) {
+            printf("    %8u failed with %d\n", n, sts);
+            break;
+        }
+
+        // wall time of all threads, so start-up skew between sessions counts against scaling
+        total.usec       = usec;
+        double aggregate = get_fps(total);
+        if (n == 1)
+            singleFps = aggregate;
+        printf("    %8u %14.1f %16.1f %10.0f%%\n",
+               n,
+               aggregate,
+               aggregate / n,
+               singleFps > 0 ? 100.0 * aggregate / (singleFps * n) : 0.0);
+    }
+}
+
+void run_probe(const probeparams &par) {
+    mfxLoader loader = MFXLoad();
+    if (loader == NULL) {
+        printf("MFXLoad failed, nothing to probe\n");
+        return;
+    }
+
+    const ProbeWorkload workloads[] = { PROBE_ENCODE, PROBE_DECODE, PROBE_VPP };
+
+    mfxU32 i = 0;
+    mfxImplDescription *idesc;
+    while (MFX_ERR_NONE == MFXEnumImplementations(loader,
+                                                  i,
+                                                  MFX_IMPLCAPS_IMPLDESCSTRUCTURE,
+                                                  reinterpret_cast<mfxHDL *>(&idesc))) {
+        printf("\nProbing implementation #%u: %s (%s)\n",
+               i,
+               idesc->ImplName,
+               _print_Impl(idesc->Impl));
+        probeconfig cfg = get_probe_config(idesc);
+        MFXDispReleaseImplDescription(loader, idesc);
+
+        probe_session_latency(loader, i, par, cfg);
+
+        printf("  Throughput (%ux%u %s, %u frames, one frame in flight):\n",
+               par.width,
+               par.height,
+               _print_FourCC(cfg.fourcc).c_str(),
+               par.numFrames);
+
+        // encode goes first, its output is the decode input
+        std::vector<mfxU8> stream;
+        bool bScaling                 = false;
+        ProbeWorkload scalingWorkload = PROBE_ENCODE;
+        for (ProbeWorkload w : workloads) {
+            bool bAvailable = (w == PROBE_ENCODE && cfg.encCodec) ||
+                              (w == PROBE_DECODE && cfg.decCodec && !stream.empty()) ||
+                              (w == PROBE_VPP && cfg.hasVPP);
+            if (!bAvailable) {
+                printf("    %-8s not available\n", _print_Workload(w));
+                continue;
+            }
+
+            std::string codec = (w == PROBE_VPP) ? "-" : _print_FourCC(cfg.encCodec);
+            mfxSession session = nullptr;
+            burstresult res    = {};
+            mfxStatus sts      = MFXCreateSession(loader, i, &session);
+            if (sts == MFX_ERR_NONE) {
+                sts = run_burst(session, w, par, cfg, &stream, &res);
+                MFXClose(session);
+            }
+
+            if (sts < MFX_ERR_NONE) {
+                printf("    %-8s %-4s failed with %d\n", _print_Workload(w), codec.c_str(), sts);
+                continue;
+            }
+            printf("    %-8s %-4s %9.1f fps\n", _print_Workload(w), codec.c_str(), get_fps(res));
+            if (!bScaling) {
+                bScaling        = true;
+                scalingWorkload = w;
+            }
+        }
+
+        if (bScaling)
+            probe_concurrency(loader, i, scalingWorkload, par, cfg, stream);
+        else
+            printf("  Concurrency scaling: no workload available\n");
+
+        i++;
+    }
+
+    if (i == 0)
+        printf("No implementations to probe\n");
+
+    MFXUnload(loader);
+}
+
+// Parses the positive count of a -probe_* option
+static bool parse_probe_count(const char *name, const char *value, mfxU32 *count) {
+    char *end = nullptr;
+    long v    = strtol(value, &end, 10);
+    if (end == value || *end || v <= 0 || v > INT32_MAX) {
+        printf("Invalid %s value %s\n", name, value);
+        return false;
+    }
+    *count = (mfxU32)v;
+    return true;
+}
+
+void print_usage() {
+    printf("Usage: system_analyzer [options]\n");
+    printf("  -sysfs_root path ...... read render nodes from path/class/drm (default = /sys)\n");
+    printf("  -probe ................ run timed session and workload probes on each\n");
+    printf("                          implementation\n");
+    printf("  -probe_cycles n ....... session create/Init/Close cycles (default = 10)\n");
+    printf("  -probe_frames n ....... frames per encode/decode/VPP burst (default = 60)\n");
+    printf("  -probe_sessions n ..... max parallel sessions for the scaling curve,\n");
+    printf("                          doubled from 1 (default = 4)\n");
+    printf("  -probe_size WxH ....... probe frame size (default = 1280x720)\n");
+}
+
+int main(int argc, char *argv[]) {
+    probeparams probe = {};
+    probe.numCycles   = 10;
+    probe.numFrames   = 60;
+    probe.maxSessions = 4;
+    probe.width       = 1280;
+    probe.height      = 720;
+
+    std::string sysfsRoot = "/sys";
+
+    for (int i = 1; i < argc; i++) {
+        bool bHasValue = (i + 1 < argc);
+        if (!strcmp(argv[i], "-probe")) {
+            probe.enabled = true;
+        }
+        else if (!strcmp(argv[i], "-probe_cycles") && bHasValue) {
+            if (!parse_probe_count(argv[i], argv[i + 1], &probe.numCycles))
+                return 1;
+            i++;
+        }
+        else if (!strcmp(argv[i], "-probe_frames") && bHasValue) {
+            if (!parse_probe_count(argv[i], argv[i + 1], &probe.numFrames))
+                return 1;
+            i++;
+        }
+        else if (!strcmp(argv[i], "-probe_sessions") && bHasValue) {
+            if (!parse_probe_count(argv[i], argv[i + 1], &probe.maxSessions))
+                return 1;
+            i++;
+        }
+        else if (!strcmp(argv[i], "-sysfs_root") && bHasValue) {
+            sysfsRoot = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-probe_size") && bHasValue) {
+            unsigned int w = 0, h = 0;
+            if (sscanf(argv[++i], "%ux%u", &w, &h) != 2 || !w || !h || w > 8192 || h > 8192) {
+                printf("Invalid probe size %s\n", argv[i]);
+                return 1;
+            }
+            probe.width  = (mfxU16)(w & ~1);
+            probe.height = (mfxU16)(h & ~1);
+        }
+        else {
+            print_usage();
+            return (!strcmp(argv[i], "-h") || !strcmp(argv[i], "-help")) ? 0 : 1;
+        }
+    }
+
     bool check_gpu_caps = true;
     void *libva_handle  = dlopen("libva.so", RTLD_NOW | RTLD_GLOBAL);
     if (!libva_handle) {
@@ -221,22 +1109,11 @@ int main() {
         check_gpu_caps = false;
     }
 
-    if (check_gpu_caps) {
+    // a non-default root points at a fake sysfs tree, it does not depend on libva
+    if (check_gpu_caps || sysfsRoot != "/sys") {
         printf("------------------------------------\n");
         printf("Looking for GPU interfaces available to OS...\n");
-        int nGPUadapters             = 0;
-        std::vector<std::string> rns = { "/dev/dri/renderD128", "/dev/dri/renderD129",
-                                         "/dev/dri/renderD130", "/dev/dri/renderD131",
-                                         "/dev/dri/renderD132", "/dev/dri/renderD133",
-                                         "/dev/dri/renderD134", "/dev/dri/renderD135" };
-
-        for (size_t i = 0; i < rns.size(); i++) {
-            std::ifstream rn(rns[i].c_str());
-            if (rn.good()) {
-                printf("FOUND: %s\n", rns[i].c_str());
-                nGPUadapters++;
-            }
-        }
+        int nGPUadapters = show_render_node_topology(sysfsRoot);
         printf("GPU interfaces found: %d\n", nGPUadapters);
         if (!nGPUadapters) {
             printf("No GPU adapters found.  Possible reasons:\n");
@@ -262,6 +1139,13 @@ int main() {
     }
     printf("------------------------------------\n");
 
+    if (probe.enabled) {
+        printf("\n------------------------------------\n");
+        printf("Probing implementations...\n");
+        run_probe(probe);
+        printf("------------------------------------\n");
+    }
+
     if (libva_handle)
         dlclose(libva_handle);
     if (libvadrm_handle)
@@ -16,7 +16,9 @@
 #endif
 
 #include <assert.h>
+#include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <algorithm>
 #include <string>
@@ -280,26 +282,558 @@ const char *_print_ProfileType(mfxU32 fourcc, mfxU32 type) {
     return "<unknown codec format>";
 }
 
+// Capability filters of the query mode, fields which are not set match everything
+struct CapsFilter {
+    mfxU32 codecID; // decoder or encoder CodecID
+    mfxU32 colorFourCC; // decoder output, encoder input or VPP input/output format
+    mfxResourceType memType;
+    bool bMemType;
+
+    CapsFilter()
+            : codecID(0),
+              colorFourCC(0),
+              memType(MFX_RESOURCE_SYSTEM_SURFACE),
+              bMemType(false) {}
+
+    bool IsSet() const {
+        return codecID || colorFourCC || bMemType;
+    }
+
+    bool MatchFormats(const mfxU32 *formats, mfxU16 numFormats) const {
+        return !colorFourCC ||
+               std::find(formats, formats + numFormats, colorFourCC) != formats + numFormats;
+    }
+
+    // decoder and encoder descriptions share the layout of the fields used here
+    template <typename MemDesc>
+    bool MatchMemDesc(const MemDesc &mem) const {
+        return (!bMemType || mem.MemHandleType == memType) &&
+               MatchFormats(mem.ColorFormats, mem.NumColorFormats);
+    }
+
+    template <typename Profile>
+    bool MatchProfile(const Profile &profile) const {
+        if (!IsSet())
+            return true;
+        for (int memtype = 0; memtype < profile.NumMemTypes; memtype++) {
+            if (MatchMemDesc(profile.MemDesc[memtype]))
+                return true;
+        }
+        return false;
+    }
+
+    template <typename Codec>
+    bool MatchCodec(const Codec &codec) const {
+        if (!IsSet())
+            return true;
+        if (codecID && codec.CodecID != codecID)
+            return false;
+        for (int profile = 0; profile < codec.NumProfiles; profile++) {
+            if (MatchProfile(codec.Profiles[profile]))
+                return true;
+        }
+        return false;
+    }
+
+    bool MatchVPPFormat(const mfxVPPDescription::filter::memdesc::format &format) const {
+        return !colorFourCC || format.InFormat == colorFourCC ||
+               MatchFormats(format.OutFormats, format.NumOutFormat);
+    }
+
+    bool MatchVPPMemDesc(const mfxVPPDescription::filter::memdesc &mem) const {
+        if (!IsSet())
+            return true;
+        if (bMemType && mem.MemHandleType != memType)
+            return false;
+        for (int informat = 0; informat < mem.NumInFormats; informat++) {
+            if (MatchVPPFormat(mem.Formats[informat]))
+                return true;
+        }
+        return false;
+    }
+
+    bool MatchVPPFilter(const mfxVPPDescription::filter &filter) const {
+        if (!IsSet())
+            return true;
+        // VPP filters are not tied to a codec
+        if (codecID)
+            return false;
+        for (int memtype = 0; memtype < filter.NumMemTypes; memtype++) {
+            if (MatchVPPMemDesc(filter.MemDesc[memtype]))
+                return true;
+        }
+        return false;
+    }
+
+    bool MatchImpl(const mfxImplDescription *idesc) const {
+        if (!IsSet())
+            return true;
+        for (int codec = 0; codec < idesc->Dec.NumCodecs; codec++) {
+            if (MatchCodec(idesc->Dec.Codecs[codec]))
+                return true;
+        }
+        for (int codec = 0; codec < idesc->Enc.NumCodecs; codec++) {
+            if (MatchCodec(idesc->Enc.Codecs[codec]))
+                return true;
+        }
+        for (int filter = 0; filter < idesc->VPP.NumFilters; filter++) {
+            if (MatchVPPFilter(idesc->VPP.Filters[filter]))
+                return true;
+        }
+        return false;
+    }
+};
+
+// FourCC from a command line string, short codec names are padded with spaces ("AV1" -> "AV1 ")
+bool ParseFourCC(std::string str, mfxU32 &fourcc) {
+    std::transform(str.begin(), str.end(), str.begin(), ::toupper);
+    if (str == "H264")
+        str = "AVC";
+    else if (str == "H265")
+        str = "HEVC";
+    else if (str == "MPEG2")
+        str = "MPG2";
+    else if (str == "P8") {
+        fourcc = MFX_FOURCC_P8;
+        return true;
+    }
+
+    if (str.empty() || str.size() > 4)
+        return false;
+    str.resize(4, ' ');
+    fourcc = MFX_MAKEFOURCC(str[0], str[1], str[2], str[3]);
+    return true;
+}
+
+bool ParseMemType(const std::string &str, mfxResourceType &type) {
+    if (str == "system")
+        type = MFX_RESOURCE_SYSTEM_SURFACE;
+    else if (str == "va")
+        type = MFX_RESOURCE_VA_SURFACE_PTR;
+    else if (str == "vabuffer")
+        type = MFX_RESOURCE_VA_BUFFER_PTR;
+    else if (str == "d3d9")
+        type = MFX_RESOURCE_DX9_SURFACE;
+    else if (str == "d3d11")
+        type = MFX_RESOURCE_DX11_TEXTURE;
+    else if (str == "d3d12")
+        type = MFX_RESOURCE_DX12_RESOURCE;
+    else if (str == "dma")
+        type = MFX_RESOURCE_DMA_RESOURCE;
+    else
+        return false;
+    return true;
+}
+
+// Streaming JSON writer, output is produced while descriptors are walked
+class JsonWriter {
+public:
+    explicit JsonWriter(FILE *f) : m_f(f), m_depth(0), m_bFirst(true) {}
+
+    void BeginObject(const char *key = nullptr) {
+        Prefix(key);
+        fputc('{', m_f);
+        Push();
+    }
+    void EndObject() {
+        Pop('}');
+    }
+    void BeginArray(const char *key = nullptr) {
+        Prefix(key);
+        fputc('[', m_f);
+        Push();
+    }
+    void EndArray() {
+        Pop(']');
+    }
+
+    void String(const char *key, const char *value) {
+        Prefix(key);
+        Escape(value ? value : "");
+    }
+    void UInt(const char *key, mfxU64 value) {
+        Prefix(key);
+        fprintf(m_f, "%llu", (unsigned long long)value);
+    }
+    void Int(const char *key, mfxI64 value) {
+        Prefix(key);
+        fprintf(m_f, "%lld", (long long)value);
+    }
+    void Bool(const char *key, bool value) {
+        Prefix(key);
+        fputs(value ? "true" : "false", m_f);
+    }
+    void Version(const char *key, mfxU16 major, mfxU16 minor) {
+        char str[16];
+        snprintf(str, sizeof(str), "%hu.%hu", major, minor);
+        String(key, str);
+    }
+    void FourCC(const char *key, mfxU32 fourcc) {
+        std::string str(_print_fourcc(fourcc));
+        str.erase(str.find_last_not_of(' ') + 1);
+        String(key, str.c_str());
+    }
+    void Range(const char *key, const mfxRange32U &range) {
+        BeginObject(key);
+        UInt("Min", range.Min);
+        UInt("Max", range.Max);
+        UInt("Step", range.Step);
+        EndObject();
+    }
+
+    void Finish() {
+        fputc('\n', m_f);
+        fflush(m_f);
+    }
+
+private:
+    void Prefix(const char *key) {
+        if (m_depth) {
+            fputs(m_bFirst ? "\n" : ",\n", m_f);
+            fprintf(m_f, "%*s", 2 * m_depth, "");
+        }
+        m_bFirst = false;
+        if (key) {
+            Escape(key);
+            fputs(": ", m_f);
+        }
+    }
+    void Push() {
+        m_depth++;
+        m_bFirst = true;
+    }
+    void Pop(char close) {
+        m_depth--;
+        if (!m_bFirst)
+            fprintf(m_f, "\n%*s", 2 * m_depth, "");
+        fputc(close, m_f);
+        m_bFirst = false;
+    }
+    void Escape(const char *str) {
+        fputc('"', m_f);
+        for (; *str; str++) {
+            unsigned char c = (unsigned char)*str;
+            if (c == '"' || c == '\\')
+                fprintf(m_f, "\\%c", c);
+            else if (c < 0x20)
+                fprintf(m_f, "\\u%04x", c);
+            else
+                fputc(c, m_f);
+        }
+        fputc('"', m_f);
+    }
+
+    FILE *m_f;
+    int m_depth;
+    bool m_bFirst;
+};
+
+template <typename MemDesc>
+void WriteCodecMemDescJSON(JsonWriter &json, const MemDesc &mem) {
+    json.BeginObject();
+    json.String("MemHandleType", _print_ResourceType(mem.MemHandleType));
+    json.Range("Width", mem.Width);
+    json.Range("Height", mem.Height);
+    json.BeginArray("ColorFormats");
+    for (int colorformat = 0; colorformat < mem.NumColorFormats; colorformat++)
+        json.FourCC(nullptr, mem.ColorFormats[colorformat]);
+    json.EndArray();
+    json.EndObject();
+}
+
+template <typename Codec>
+void WriteCodecProfilesJSON(JsonWriter &json, const Codec &codec, const CapsFilter &capsFilter) {
+    json.BeginArray("Profiles");
+    for (int profile = 0; profile < codec.NumProfiles; profile++) {
+        if (!capsFilter.MatchProfile(codec.Profiles[profile]))
+            continue;
+        json.BeginObject();
+        json.String("Profile", _print_ProfileType(codec.CodecID, codec.Profiles[profile].Profile));
+        json.BeginArray("MemDesc");
+        for (int memtype = 0; memtype < codec.Profiles[profile].NumMemTypes; memtype++) {
+            if (capsFilter.MatchMemDesc(codec.Profiles[profile].MemDesc[memtype]))
+                WriteCodecMemDescJSON(json, codec.Profiles[profile].MemDesc[memtype]);
+        }
+        json.EndArray();
+        json.EndObject();
+    }
+    json.EndArray();
+}
+
+void WriteImplDescriptionJSON(JsonWriter &json,
+                              const mfxImplDescription *idesc,
+                              const CapsFilter &capsFilter,
+                              bool bFullInfo) {
+    json.String("ImplName", idesc->ImplName);
+    json.String("AccelerationMode", _print_AccelMode(idesc->AccelerationMode));
+    json.Version("ApiVersion", idesc->ApiVersion.Major, idesc->ApiVersion.Minor);
+    json.String("Impl", _print_Impl(idesc->Impl));
+    json.UInt("VendorImplID", idesc->VendorImplID);
+    json.String("License", idesc->License);
+    json.Version("Version", idesc->Version.Major, idesc->Version.Minor);
+    json.String("Keywords", idesc->Keywords);
+    json.UInt("VendorID", idesc->VendorID);
+
+    const mfxAccelerationModeDescription *accel = &idesc->AccelerationModeDescription;
+    json.BeginArray("AccelerationModes");
+    for (int mode = 0; mode < accel->NumAccelerationModes; mode++)
+        json.String(nullptr, _print_AccelMode(accel->Mode[mode]));
+    json.EndArray();
+
+    if (idesc->Version.Version >= MFX_STRUCT_VERSION(1, 2)) {
+        const mfxPoolPolicyDescription *poolPolicies = &idesc->PoolPolicies;
+        json.BeginArray("PoolPolicies");
+        for (int policy = 0; policy < poolPolicies->NumPoolPolicies; policy++)
+            json.String(nullptr, _print_PoolPolicy(poolPolicies->Policy[policy]));
+        json.EndArray();
+    }
+
+    const mfxDeviceDescription *dev = &idesc->Dev;
+    json.BeginObject("Device");
+    if (dev->Version.Version >= MFX_STRUCT_VERSION(1, 1)) {
+        json.String("MediaAdapterType",
+                    _print_MediaAdapterType((mfxMediaAdapterType)dev->MediaAdapterType));
+    }
+    json.String("DeviceID", dev->DeviceID);
+    json.BeginArray("SubDevices");
+    for (int subdevice = 0; subdevice < dev->NumSubDevices; subdevice++) {
+        json.BeginObject();
+        json.UInt("Index", dev->SubDevices[subdevice].Index);
+        json.String("SubDeviceID", dev->SubDevices[subdevice].SubDeviceID);
+        json.EndObject();
+    }
+    json.EndArray();
+    json.EndObject();
+
+    if (!bFullInfo)
+        return;
+
+    const mfxDecoderDescription *dec = &idesc->Dec;
+    json.BeginArray("Decoders");
+    for (int codec = 0; codec < dec->NumCodecs; codec++) {
+        if (!capsFilter.MatchCodec(dec->Codecs[codec]))
+            continue;
+        json.BeginObject();
+        json.FourCC("CodecID", dec->Codecs[codec].CodecID);
+        json.UInt("MaxcodecLevel", dec->Codecs[codec].MaxcodecLevel);
+        WriteCodecProfilesJSON(json, dec->Codecs[codec], capsFilter);
+        json.EndObject();
+    }
+    json.EndArray();
+
+    const mfxEncoderDescription *enc = &idesc->Enc;
+    json.BeginArray("Encoders");
+    for (int codec = 0; codec < enc->NumCodecs; codec++) {
+        if (!capsFilter.MatchCodec(enc->Codecs[codec]))
+            continue;
+        json.BeginObject();
+        json.FourCC("CodecID", enc->Codecs[codec].CodecID);
+        json.UInt("MaxcodecLevel", enc->Codecs[codec].MaxcodecLevel);
+        json.UInt("BiDirectionalPrediction", enc->Codecs[codec].BiDirectionalPrediction);
+#ifdef ONEVPL_EXPERIMENTAL
+        mfxVersion reqApiVersionReportedStats = {};
+        reqApiVersionReportedStats.Major      = 2;
+        reqApiVersionReportedStats.Minor      = 7;
+        if (idesc->ApiVersion.Version >= reqApiVersionReportedStats.Version) {
+            json.BeginArray("ReportedStats");
+            mfxU16 reportedStats = enc->Codecs[codec].ReportedStats;
+            for (mfxU16 statMask = 1; statMask != 0; statMask <<= 1) {
+                if (reportedStats & statMask)
+                    json.String(nullptr, _print_EncodeStatsType(statMask));
+            }
+            json.EndArray();
+        }
+#endif
+        WriteCodecProfilesJSON(json, enc->Codecs[codec], capsFilter);
+        json.EndObject();
+    }
+    json.EndArray();
+
+    const mfxVPPDescription *vpp = &idesc->VPP;
+    json.BeginArray("VPPFilters");
+    for (int filterIdx = 0; filterIdx < vpp->NumFilters; filterIdx++) {
+        const mfxVPPDescription::filter &vppFilter = vpp->Filters[filterIdx];
+        if (!capsFilter.MatchVPPFilter(vppFilter))
+            continue;
+        json.BeginObject();
+        json.FourCC("FilterFourCC", vppFilter.FilterFourCC);
+        json.UInt("MaxDelayInFrames", vppFilter.MaxDelayInFrames);
+        json.BeginArray("MemDesc");
+        for (int memtype = 0; memtype < vppFilter.NumMemTypes; memtype++) {
+            const mfxVPPDescription::filter::memdesc &mem = vppFilter.MemDesc[memtype];
+            if (!capsFilter.MatchVPPMemDesc(mem))
+                continue;
+            json.BeginObject();
+            json.String("MemHandleType", _print_ResourceType(mem.MemHandleType));
+            json.Range("Width", mem.Width);
+            json.Range("Height", mem.Height);
+            json.BeginArray("Formats");
+            for (int informat = 0; informat < mem.NumInFormats; informat++) {
+                if (!capsFilter.MatchVPPFormat(mem.Formats[informat]))
+                    continue;
+                json.BeginObject();
+                json.FourCC("InFormat", mem.Formats[informat].InFormat);
+                json.BeginArray("OutFormats");
+                for (int outformat = 0; outformat < mem.Formats[informat].NumOutFormat;
+                     outformat++)
+                    json.FourCC(nullptr, mem.Formats[informat].OutFormats[outformat]);
+                json.EndArray();
+                json.EndObject();
+            }
+            json.EndArray();
+            json.EndObject();
+        }
+        json.EndArray();
+        json.EndObject();
+    }
+    json.EndArray();
+
+    json.UInt("NumExtParam", idesc->NumExtParam);
+}
+
+// One element of the "Implementations" array, each capability format is fetched only if requested
+void WriteImplJSON(JsonWriter &json,
+                   mfxLoader loader,
+                   mfxU32 idx,
+                   const mfxImplDescription *idesc,
+                   const CapsFilter &capsFilter,
+                   bool bFullInfo,
+                   bool bImplementedFunctions,
+                   bool bExtendedDeviceID,
+                   bool bSurfaceTypes) {
+    json.BeginObject();
+    json.UInt("Index", idx);
+
+    mfxHDL hImplPath = nullptr;
+    if (MFX_ERR_NONE == MFXEnumImplementations(loader, idx, MFX_IMPLCAPS_IMPLPATH, &hImplPath)) {
+        if (hImplPath) {
+            json.String("LibraryPath", reinterpret_cast<mfxChar *>(hImplPath));
+            MFXDispReleaseImplDescription(loader, hImplPath);
+        }
+    }
+
+    WriteImplDescriptionJSON(json, idesc, capsFilter, bFullInfo);
+
+    if (bImplementedFunctions) {
+        mfxImplementedFunctions *fdesc;
+        if (MFX_ERR_NONE == MFXEnumImplementations(loader,
+                                                   idx,
+                                                   MFX_IMPLCAPS_IMPLEMENTEDFUNCTIONS,
+                                                   reinterpret_cast<mfxHDL *>(&fdesc))) {
+            json.BeginArray("ImplementedFunctions");
+            for (mfxU16 func = 0; func < fdesc->NumFunctions; func++)
+                json.String(nullptr, fdesc->FunctionsName[func]);
+            json.EndArray();
+            MFXDispReleaseImplDescription(loader, fdesc);
+        }
+    }
+
+    if (bExtendedDeviceID) {
+        mfxExtendedDeviceId *idescDevice;
+        if (MFX_ERR_NONE == MFXEnumImplementations(loader,
+                                                   idx,
+                                                   MFX_IMPLCAPS_DEVICE_ID_EXTENDED,
+                                                   reinterpret_cast<mfxHDL *>(&idescDevice))) {
+            json.BeginObject("ExtendedDeviceID");
+            json.UInt("VendorID", idescDevice->VendorID);
+            json.UInt("DeviceID", idescDevice->DeviceID);
+            json.UInt("PCIDomain", idescDevice->PCIDomain);
+            json.UInt("PCIBus", idescDevice->PCIBus);
+            json.UInt("PCIDevice", idescDevice->PCIDevice);
+            json.UInt("PCIFunction", idescDevice->PCIFunction);
+            json.Bool("LUIDValid", idescDevice->LUIDValid != 0);
+            if (idescDevice->LUIDValid) {
+                char luid[17];
+                for (mfxU32 i = 0; i < 8; i++)
+                    snprintf(luid + 2 * i, 3, "%02x", idescDevice->DeviceLUID[7 - i]);
+                json.String("DeviceLUID", luid);
+                json.UInt("LUIDDeviceNodeMask", idescDevice->LUIDDeviceNodeMask);
+            }
+            json.Int("DRMRenderNodeNum", idescDevice->DRMRenderNodeNum);
+            json.Int("DRMPrimaryNodeNum", idescDevice->DRMPrimaryNodeNum);
+            json.UInt("RevisionID", idescDevice->RevisionID);
+            json.String("DeviceName", idescDevice->DeviceName);
+            json.EndObject();
+            MFXDispReleaseImplDescription(loader, idescDevice);
+        }
+    }
+
+#ifdef ONEVPL_EXPERIMENTAL
+    if (bSurfaceTypes) {
+        mfxSurfaceTypesSupported *surf;
+        if (MFX_ERR_NONE == MFXEnumImplementations(loader,
+                                                   idx,
+                                                   MFX_IMPLCAPS_SURFACE_TYPES,
+                                                   reinterpret_cast<mfxHDL *>(&surf))) {
+            json.BeginArray("SurfaceTypes");
+            for (int surfIdx = 0; surfIdx < surf->NumSurfaceTypes; surfIdx++) {
+                json.BeginObject();
+                json.String("SurfaceType",
+                            _print_SurfaceType(surf->SurfaceTypes[surfIdx].SurfaceType));
+                json.BeginArray("SurfaceComponents");
+                for (int compIdx = 0; compIdx < surf->SurfaceTypes[surfIdx].NumSurfaceComponents;
+                     compIdx++) {
+                    const auto &comp = surf->SurfaceTypes[surfIdx].SurfaceComponents[compIdx];
+                    json.BeginObject();
+                    json.String("SurfaceComponent", _print_SurfaceComponent(comp.SurfaceComponent));
+                    json.BeginArray("SurfaceFlags");
+                    for (mfxU32 flagMask = 1; flagMask != 0; flagMask <<= 1) {
+                        if (comp.SurfaceFlags & flagMask)
+                            json.String(nullptr, _print_SurfaceFlags(flagMask));
+                    }
+                    json.EndArray();
+                    json.EndObject();
+                }
+                json.EndArray();
+                json.EndObject();
+            }
+            json.EndArray();
+            MFXDispReleaseImplDescription(loader, surf);
+        }
+    }
+#else
+    (void)bSurfaceTypes;
+#endif
+
+    json.EndObject();
+}
+
 // clang-format off
-static void Usage(void) {
-    printf("\nUsage: vpl-inspect [options]\n");
-    printf("\nIf no options are specified, print default capabilities report (MFX_IMPLCAPS_IMPLDESCSTRUCTURE)\n");
-    printf("\nOptions:\n");
-    printf("   -?, -help ...... print help message\n");
-    printf("   -b ............. print brief output (do not print decoder, encoder, and VPP capabilities)\n");
-    printf("   -ex ............ print extended device ID info (MFX_IMPLCAPS_DEVICE_ID_EXTENDED)\n");
-    printf("   -f ............. print list of implemented functions (MFX_IMPLCAPS_IMPLEMENTEDFUNCTIONS)\n");
-    printf("   -d3d9 .......... only enumerate implementations supporting D3D9\n");
+static void Usage(FILE *f) {
+    fprintf(f, "\nUsage: vpl-inspect [options]\n");
+    fprintf(f, "\nIf no options are specified, print default capabilities report (MFX_IMPLCAPS_IMPLDESCSTRUCTURE)\n");
+    fprintf(f, "\nOptions:\n");
+    fprintf(f, "   -?, -help ...... print help message\n");
+    fprintf(f, "   -b ............. print brief output (do not print decoder, encoder, and VPP capabilities)\n");
+    fprintf(f, "   -ex ............ print extended device ID info (MFX_IMPLCAPS_DEVICE_ID_EXTENDED)\n");
+    fprintf(f, "   -f ............. print list of implemented functions (MFX_IMPLCAPS_IMPLEMENTEDFUNCTIONS)\n");
+    fprintf(f, "   -d3d9 .......... only enumerate implementations supporting D3D9\n");
+    fprintf(f, "   -json .......... print capabilities in JSON format\n");
 #if defined(_WIN32) || defined(_WIN64)
-    printf("   -disp .......... print path to loaded dispatcher library\n");
+    fprintf(f, "   -disp .......... print path to loaded dispatcher library\n");
 #endif
+    fprintf(f, "\nQuery options (only matching implementations and capabilities are reported):\n");
+    fprintf(f, "   -codec fourcc .. decoders and encoders of the codec (AVC, HEVC, AV1, VP9, JPEG, MPG2, ...)\n");
+    fprintf(f, "   -fourcc fourcc . color format (NV12, P010, I420, ...)\n");
+    fprintf(f, "   -mem type ...... memory type: system, va, vabuffer, d3d9, d3d11, d3d12, dma\n");
+    fprintf(f, "   -adapter type .. adapter type: integrated, discrete\n");
+    fprintf(f, "   -impl n ........ only query implementation n\n");
+    fprintf(f, "\nExit code is 1 if a query does not match any implementation\n");
 }
 // clang-format on
 
 int main(int argc, char *argv[]) {
+    // keep stdout parsable in JSON mode, errors and warnings go to stderr
+    bool bJSON = false;
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        if (std::string(argv[argIdx]) == "-json")
+            bJSON = true;
+    }
+    FILE *errOut = bJSON ? stderr : stdout;
+
     mfxLoader loader = MFXLoad();
     if (loader == NULL) {
-        printf("Error - MFXLoad() returned null - no libraries found\n");
+        fprintf(errOut, "Error - MFXLoad() returned null - no libraries found\n");
         return -1;
     }
 
@@ -308,6 +842,9 @@ int main(int argc, char *argv[]) {
     bool bRequireD3D9               = false;
     bool bPrintExtendedDeviceID     = false;
     bool bPrintDispInfo             = false;
+    int implIndex                   = -1;
+    int adapterType                 = -1;
+    CapsFilter capsFilter;
 #ifdef ONEVPL_EXPERIMENTAL
     bool bPrintSurfaceTypes = true;
 #endif
@@ -327,8 +864,54 @@ int main(int argc, char *argv[]) {
         else if (nextArg == "-d3d9") {
             bRequireD3D9 = true;
         }
+        else if (nextArg == "-json") {
+            // picked up before parsing
+        }
+        else if (nextArg == "-codec" || nextArg == "-fourcc" || nextArg == "-mem" ||
+                 nextArg == "-adapter" || nextArg == "-impl") {
+            if (argIdx + 1 >= argc) {
+                fprintf(errOut, "Error - missing value of option %s\n", nextArg.c_str());
+                Usage(errOut);
+                return -1;
+            }
+            std::string value(argv[++argIdx]);
+
+            bool bValid = true;
+            if (nextArg == "-codec") {
+                bValid = ParseFourCC(value, capsFilter.codecID);
+            }
+            else if (nextArg == "-fourcc") {
+                bValid = ParseFourCC(value, capsFilter.colorFourCC);
+            }
+            else if (nextArg == "-mem") {
+                bValid              = ParseMemType(value, capsFilter.memType);
+                capsFilter.bMemType = bValid;
+            }
+            else if (nextArg == "-adapter") {
+                if (value == "integrated")
+                    adapterType = MFX_MEDIA_INTEGRATED;
+                else if (value == "discrete")
+                    adapterType = MFX_MEDIA_DISCRETE;
+                else
+                    bValid = false;
+            }
+            else {
+                implIndex = atoi(value.c_str());
+                bValid    = (implIndex >= 0 && !value.empty() &&
+                          value.find_first_not_of("0123456789") == std::string::npos);
+            }
+
+            if (!bValid) {
+                fprintf(errOut,
+                        "Error - invalid value %s of option %s\n",
+                        value.c_str(),
+                        nextArg.c_str());
+                Usage(errOut);
+                return -1;
+            }
+        }
         else if (nextArg == "-?" || nextArg == "-help") {
-            Usage();
+            Usage(stdout);
             return -1;
         }
 #if defined(_WIN32) || defined(_WIN64)
@@ -337,8 +920,8 @@ int main(int argc, char *argv[]) {
         }
 #endif
         else {
-            printf("Error - unknown option %s\n", nextArg.c_str());
-            Usage();
+            fprintf(errOut, "Error - unknown option %s\n", nextArg.c_str());
+            Usage(errOut);
             return -1;
         }
     }
@@ -347,14 +930,14 @@ int main(int argc, char *argv[]) {
 #if defined(_WIN32) || defined(_WIN64)
         HMODULE handle = GetModuleHandleA(DISPATCHER_DLL_NAME);
         if (!handle) {
-            printf("Error - Failed to get dispatcher handle\n");
+            fprintf(errOut, "Error - Failed to get dispatcher handle\n");
             return -1;
         }
 
         char dispatcherPath[1024] = {};
         DWORD pathLen = GetModuleFileNameA(handle, dispatcherPath, sizeof(dispatcherPath));
         if (pathLen == 0 || pathLen >= sizeof(dispatcherPath)) {
-            printf("Error - Failed to get dispatcher path\n");
+            fprintf(errOut, "Error - Failed to get dispatcher path\n");
             return -1;
         }
 
@@ -366,10 +949,10 @@ int main(int argc, char *argv[]) {
     }
 
     if (bRequireD3D9) {
-        printf("Warning - Enumerating D3D9 implementations ONLY\n");
+        fprintf(errOut, "Warning - Enumerating D3D9 implementations ONLY\n");
         mfxConfig cfg = MFXCreateConfig(loader);
         if (!cfg) {
-            printf("Error - MFXCreateConfig() returned null\n");
+            fprintf(errOut, "Error - MFXCreateConfig() returned null\n");
             return -1;
         }
 
@@ -383,17 +966,84 @@ int main(int argc, char *argv[]) {
                                        (const mfxU8 *)"mfxImplDescription.AccelerationMode",
                                        var);
         if (sts) {
-            printf("Error - MFXSetConfigFilterProperty() returned %d\n", sts);
+            fprintf(errOut, "Error - MFXSetConfigFilterProperty() returned %d\n", sts);
+            return -1;
+        }
+    }
+
+    if (adapterType >= 0) {
+        // let the dispatcher drop other adapters before their descriptions are fetched
+        mfxConfig cfg = MFXCreateConfig(loader);
+        if (!cfg) {
+            fprintf(errOut, "Error - MFXCreateConfig() returned null\n");
             return -1;
         }
+
+        mfxVariant var      = {};
+        var.Version.Version = MFX_VARIANT_VERSION;
+        var.Type            = MFX_VARIANT_TYPE_U16;
+        var.Data.U16        = (mfxU16)adapterType;
+
+        mfxStatus sts = MFXSetConfigFilterProperty(
+            cfg,
+            (const mfxU8 *)"mfxImplDescription.mfxDeviceDescription.MediaAdapterType",
+            var);
+        if (sts) {
+            fprintf(errOut, "Error - MFXSetConfigFilterProperty() returned %d\n", sts);
+            return -1;
+        }
+    }
+
+#ifdef ONEVPL_EXPERIMENTAL
+    // surface types are not covered by the query options
+    if (capsFilter.IsSet())
+        bPrintSurfaceTypes = false;
+#endif
+
+    JsonWriter json(stdout);
+    if (bJSON) {
+        json.BeginObject();
+        json.BeginArray("Implementations");
     }
 
-    int i = 0;
+    // with -impl only the requested implementation is enumerated
+    int i          = (implIndex >= 0) ? implIndex : 0;
+    int numFound   = 0;
+    int numMatched = 0;
     mfxImplDescription *idesc;
-    while (MFX_ERR_NONE == MFXEnumImplementations(loader,
+    while ((implIndex < 0 || i == implIndex) &&
+           MFX_ERR_NONE == MFXEnumImplementations(loader,
                                                   i,
                                                   MFX_IMPLCAPS_IMPLDESCSTRUCTURE,
                                                   reinterpret_cast<mfxHDL *>(&idesc))) {
+        numFound++;
+        if (!capsFilter.MatchImpl(idesc)) {
+            MFXDispReleaseImplDescription(loader, idesc);
+            i++;
+            continue;
+        }
+        numMatched++;
+
+        if (bJSON) {
+#ifdef ONEVPL_EXPERIMENTAL
+            bool bSurfaceTypes = bPrintSurfaceTypes;
+#else
+            bool bSurfaceTypes = false;
+#endif
+            WriteImplJSON(json,
+                          loader,
+                          i,
+                          idesc,
+                          capsFilter,
+                          bFullInfo,
+                          bPrintImplementedFunctions,
+                          bPrintExtendedDeviceID,
+                          bSurfaceTypes);
+            MFXDispReleaseImplDescription(loader, idesc);
+            i++;
+            continue;
+        }
+
         printf("\nImplementation #%d: %s\n", i, idesc->ImplName);
 
         // get path if supported (available starting with API 2.4)
@@ -457,9 +1107,14 @@ int main(int argc, char *argv[]) {
             printf("%2smfxDecoderDescription:\n", "");
             printf("%4sVersion: %hu.%hu\n", "", dec->Version.Major, dec->Version.Minor);
             for (int codec = 0; codec < dec->NumCodecs; codec++) {
+                if (!capsFilter.MatchCodec(dec->Codecs[codec]))
+                    continue;
+
                 printf("%4sCodecID: %c%c%c%c\n", "", DECODE_FOURCC(dec->Codecs[codec].CodecID));
                 printf("%4sMaxcodecLevel: %hu\n", "", dec->Codecs[codec].MaxcodecLevel);
                 for (int profile = 0; profile < dec->Codecs[codec].NumProfiles; profile++) {
+                    if (!capsFilter.MatchProfile(dec->Codecs[codec].Profiles[profile]))
+                        continue;
                     printf("%6sProfile: %s\n",
                            "",
                            _print_ProfileType(dec->Codecs[codec].CodecID,
@@ -467,6 +1122,9 @@ int main(int argc, char *argv[]) {
                     for (int memtype = 0;
                          memtype < dec->Codecs[codec].Profiles[profile].NumMemTypes;
                          memtype++) {
+                        if (!capsFilter.MatchMemDesc(
+                                dec->Codecs[codec].Profiles[profile].MemDesc[memtype]))
+                            continue;
                         printf("%8sMemHandleType: %s\n",
                                "",
                                _print_ResourceType(dec->Codecs[codec]
@@ -514,6 +1172,9 @@ int main(int argc, char *argv[]) {
             printf("%2smfxEncoderDescription:\n", "");
             printf("%4sVersion: %hu.%hu\n", "", enc->Version.Major, enc->Version.Minor);
             for (int codec = 0; codec < enc->NumCodecs; codec++) {
+                if (!capsFilter.MatchCodec(enc->Codecs[codec]))
+                    continue;
+
                 printf("%4sCodecID: %c%c%c%c\n", "", DECODE_FOURCC(enc->Codecs[codec].CodecID));
                 printf("%4sMaxcodecLevel: %hu\n", "", enc->Codecs[codec].MaxcodecLevel);
                 printf("%4sBiDirectionalPrediction: %hu\n",
@@ -543,6 +1204,8 @@ int main(int argc, char *argv[]) {
                 }
 #endif
                 for (int profile = 0; profile < enc->Codecs[codec].NumProfiles; profile++) {
+                    if (!capsFilter.MatchProfile(enc->Codecs[codec].Profiles[profile]))
+                        continue;
                     printf("%6sProfile: %s\n",
                            "",
                            _print_ProfileType(enc->Codecs[codec].CodecID,
@@ -550,6 +1213,9 @@ int main(int argc, char *argv[]) {
                     for (int memtype = 0;
                          memtype < enc->Codecs[codec].Profiles[profile].NumMemTypes;
                          memtype++) {
+                        if (!capsFilter.MatchMemDesc(
+                                enc->Codecs[codec].Profiles[profile].MemDesc[memtype]))
+                            continue;
                         printf("%8sMemHandleType: %s\n",
                                "",
                                _print_ResourceType(enc->Codecs[codec]
@@ -597,11 +1263,16 @@ int main(int argc, char *argv[]) {
             printf("%2smfxVPPDescription:\n", "");
             printf("%4sVersion: %hu.%hu\n", "", vpp->Version.Major, vpp->Version.Minor);
             for (int filter = 0; filter < vpp->NumFilters; filter++) {
+                if (!capsFilter.MatchVPPFilter(vpp->Filters[filter]))
+                    continue;
+
                 printf("%4sFilterFourCC: %c%c%c%c\n",
                        "",
                        DECODE_FOURCC(vpp->Filters[filter].FilterFourCC));
                 printf("%4sMaxDelayInFrames: %hu\n", "", vpp->Filters[filter].MaxDelayInFrames);
                 for (int memtype = 0; memtype < vpp->Filters[filter].NumMemTypes; memtype++) {
+                    if (!capsFilter.MatchVPPMemDesc(vpp->Filters[filter].MemDesc[memtype]))
+                        continue;
                     printf(
                         "%6sMemHandleType: %s\n",
                         "",
@@ -617,16 +1288,19 @@ int main(int argc, char *argv[]) {
                            vpp->Filters[filter].MemDesc[memtype].Width.Step);
                     printf("%6sHeight Min: %u\n",
                            "",
-                           vpp->Filters[filter].MemDesc[memtype].Width.Min);
+                           vpp->Filters[filter].MemDesc[memtype].Height.Min);
                     printf("%6sHeight Max: %u\n",
                            "",
-                           vpp->Filters[filter].MemDesc[memtype].Width.Max);
+                           vpp->Filters[filter].MemDesc[memtype].Height.Max);
                     printf("%6sHeight Step: %u\n",
                            "",
-                           vpp->Filters[filter].MemDesc[memtype].Width.Step);
+                           vpp->Filters[filter].MemDesc[memtype].Height.Step);
                     for (int informat = 0;
                          informat < vpp->Filters[filter].MemDesc[memtype].NumInFormats;
                          informat++) {
+                        if (!capsFilter.MatchVPPFormat(
+                                vpp->Filters[filter].MemDesc[memtype].Formats[informat]))
+                            continue;
                         printf(
                             "%8sInFormat: %s\n",
                             "",
@@ -768,11 +1442,26 @@ int main(int argc, char *argv[]) {
         i++;
     }
 
-    if (i == 0)
+    if (bJSON) {
+        json.EndArray();
+        json.UInt("NumImplementations", numMatched);
+        json.EndObject();
+        json.Finish();
+    }
+    else if (numFound == 0) {
         printf("\nWarning - no implementations found by MFXEnumImplementations()\n");
-    else
-        printf("\nTotal number of implementations found = %d\n", i);
+    }
+    else {
+        printf("\nTotal number of implementations found = %d\n", numFound);
+        if (capsFilter.IsSet())
+            printf("Number of implementations matching the query = %d\n", numMatched);
+    }
 
     MFXUnload(loader);
+
+    // lets health checks test the exit code of a query
+    if ((capsFilter.IsSet() || implIndex >= 0) && numMatched == 0)
+        return 1;
+
     return 0;
 }
@@ -0,0 +1,155 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __FRAME_PACER_H__
+#define __FRAME_PACER_H__
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "vpl/mfxdefs.h"
+
+// Parses a frame rate given as "N", "N/D" (30000/1001) or "N.F" (29.97) into rateN/rateD.
+// Returns MFX_ERR_UNSUPPORTED on syntax errors and zero rates.
+mfxStatus ParseFrameRate(const std::string& str, mfxU32& rateN, mfxU32& rateD);
+
+// Histogram of durations in microseconds
+class CDurationHistogram {
+public:
+    void Add(mfxU32 us) {
+        m_counts[us]++;
+        m_samples++;
+    }
+    void Add(const CDurationHistogram& other) {
+        for (const auto& bin : other.m_counts)
+            m_counts[bin.first] += bin.second;
+        m_samples += other.m_samples;
+    }
+    void Clear() {
+        m_counts.clear();
+        m_samples = 0;
+    }
+    mfxU64 GetSamples() const {
+        return m_samples;
+    }
+    // Returns the smallest duration not exceeded by percent % of the samples, 0 if there are none
+    mfxU32 GetPercentile(mfxU32 percent) const;
+    mfxU32 GetMax() const {
+        return m_counts.empty() ? 0 : m_counts.rbegin()->first;
+    }
+
+private:
+    std::map<mfxU32, mfxU64> m_counts;
+    mfxU64 m_samples = 0;
+};
+
+struct FramePacerStatistics {
+    mfxU64 Frames       = 0;
+    double TargetRate   = 0; // frames per second
+    double AchievedRate = 0; // frames per second between the first and the last frame
+    // how late frames were released after their deadlines, in microseconds
+    mfxU32 LatenessP50 = 0;
+    mfxU32 LatenessP99 = 0;
+    mfxU32 LatenessMax = 0;
+    mfxU32 Resyncs     = 0; // times the schedule was restarted after the pipeline fell behind
+
+    std::string ToString() const;
+};
+
+// Timer thread releasing the frames of several pacers at their deadlines, so that sessions
+// limited to a rate don't each keep a thread sleeping
+class FramePacerTimer {
+public:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    // spinTailUs is how long before a deadline the thread stops sleeping and polls the clock, as
+    // FramePacer::SleepUntil does
+    explicit FramePacerTimer(mfxU32 spinTailUs = 0);
+    ~FramePacerTimer();
+
+    // Blocks the calling thread until deadline has passed
+    void WaitUntil(TimePoint deadline);
+
+protected:
+    FramePacerTimer(const FramePacerTimer&)            = delete;
+    FramePacerTimer& operator=(const FramePacerTimer&) = delete;
+
+private:
+    // thread blocked in WaitUntil, signalled alone when its deadline has passed
+    struct Waiter {
+        bool Released = false;
+        std::condition_variable Wake;
+    };
+
+    void TimerLoop();
+
+    std::chrono::microseconds m_spinTail;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::multimap<TimePoint, Waiter*> m_waiters; // by deadline
+    bool m_bStop;
+    std::thread m_thread;
+};
+
+// Limits a stream of frames to rateN/rateD frames per second. Frame n is released at an absolute
+// deadline start + n * rateD / rateN, so wake-up latency of a frame doesn't delay the next ones
+// and the long-run rate stays exact for fractional rates.
+class FramePacer {
+public:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    FramePacer() = default;
+
+    // rateN == 0 disables pacing, rateD == 0 is taken as 1. Restarts the schedule and statistics.
+    void Reset(mfxU32 rateN, mfxU32 rateD = 1);
+    // Polls the clock for the last spinTailUs before a deadline instead of sleeping
+    void SetSpinTail(mfxU32 spinTailUs) {
+        m_spinTail = std::chrono::microseconds(spinTailUs);
+    }
+    // Waits on a shared timer thread instead of sleeping on the calling thread
+    void SetTimer(std::shared_ptr<FramePacerTimer> timer) {
+        m_timer = timer;
+    }
+    bool IsActive() const {
+        return m_rateN != 0;
+    }
+
+    // Called once per frame, returns at the deadline of the frame. The first call starts the
+    // schedule and returns at once.
+    void Work();
+
+    FramePacerStatistics GetStatistics() const;
+
+    // Offset of the deadline of frame n from the start, in nanoseconds, rounded down
+    static mfxU64 GetDeadlineOffset(mfxU64 n, mfxU32 rateN, mfxU32 rateD);
+    // Sleeps until deadline - spinTail with an absolute timer, then polls the clock up to deadline
+    static void SleepUntil(TimePoint deadline,
+                           std::chrono::microseconds spinTail = std::chrono::microseconds(0));
+
+private:
+    void WaitUntil(TimePoint deadline);
+
+    mfxU32 m_rateN = 0;
+    mfxU32 m_rateD = 1;
+    std::chrono::microseconds m_spinTail{ 0 };
+    std::shared_ptr<FramePacerTimer> m_timer;
+
+    TimePoint m_start; // deadline of frame 0 of the current schedule
+    mfxU64 m_nextFrame = 0; // number of the next frame in the current schedule
+
+    mfxU64 m_frames = 0;
+    TimePoint m_firstFrame;
+    TimePoint m_lastFrame;
+    CDurationHistogram m_lateness;
+    mfxU32 m_resyncs = 0;
+};
+
+#endif //__FRAME_PACER_H__
@@ -0,0 +1,117 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __LIVE_SOURCE_H__
+#define __LIVE_SOURCE_H__
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "frame_pacer.h"
+#include "sample_utils.h"
+
+struct LiveSourceParams {
+    mfxU32 RateN = 0; // frame rate of the source, 0 disables the emulation
+    mfxU32 RateD = 1;
+    mfxU32 JitterUs = 0; // every frame arrives up to this late, uniformly distributed
+    // the first BurstLength frames of every BurstInterval frames are held back and arrive at once
+    // with the last of them, as after a stall of the feed
+    mfxU32 BurstInterval = 0;
+    mfxU32 BurstLength   = 0;
+    mfxU32 DeadlineMs    = 0; // output later than this after arrival is a miss, 0 - 2 frame periods
+    mfxU64 Seed          = 1; // seed of the jitter
+};
+
+struct LiveSourceStatistics {
+    mfxU64 Frames  = 0; // frames taken from the source
+    mfxU64 Outputs = 0; // frames output and matched with their arrival
+    // time from the arrival of a frame to its output, in microseconds
+    mfxU32 LatencyP50    = 0;
+    mfxU32 LatencyP99    = 0;
+    mfxU32 LatencyMax    = 0;
+    mfxU32 DeadlineMs    = 0;
+    mfxU64 DeadlineMiss  = 0; // outputs later than DeadlineMs
+    mfxU32 MaxQueueDepth = 0; // most frames that had arrived and were not taken yet
+
+    std::string ToString() const;
+};
+
+// Schedule of a real-time feed emulated from a file. Frames are taken in order and become
+// available at their arrival times; outputs of the pipeline are matched with arrivals in order.
+class CLiveSource {
+public:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    explicit CLiveSource(const LiveSourceParams& params);
+
+    // Blocks until the next frame of the feed has arrived. The first call starts the feed.
+    void WaitForNextFrame();
+    // Called when the pipeline has output a frame
+    void OnFrameOutput();
+
+    LiveSourceStatistics GetStatistics() const;
+
+    // Offset of the arrival of frame n from the start of the feed in nanoseconds, before frames
+    // overtaken by jitter are held back behind the previous one
+    mfxU64 GetArrivalOffset(mfxU64 n) const;
+
+protected:
+    CLiveSource(const CLiveSource&)            = delete;
+    CLiveSource& operator=(const CLiveSource&) = delete;
+
+private:
+    LiveSourceParams m_params;
+    std::chrono::microseconds m_deadline;
+
+    mutable std::mutex m_mutex;
+    TimePoint m_start;
+    mfxU64 m_nextFrame;
+    mfxU64 m_lastArrival; // offset of the arrival of the last frame taken
+    // arrivals of frames not output yet, the oldest are forgotten if the pipeline outputs nothing
+    std::deque<TimePoint> m_arrivals;
+
+    mfxU64 m_outputs;
+    CDurationHistogram m_latency;
+    mfxU64 m_deadlineMiss;
+    mfxU32 m_maxQueueDepth;
+};
+
+// Reads frames of raw files on the schedule of a live source, as fast as possible without one
+class CLiveYUVReader : public CSmplYUVReader {
+public:
+    void SetLiveSource(std::shared_ptr<CLiveSource> source) {
+        m_pLiveSource = source;
+    }
+
+    virtual mfxStatus LoadNextFrame(mfxFrameSurface1* pSurface);
+    virtual mfxStatus LoadNextFrame(mfxFrameSurface1* pSurface,
+                                    int bytes_to_read,
+                                    mfxU8* buf_read);
+
+protected:
+    std::shared_ptr<CLiveSource> m_pLiveSource;
+};
+
+// Releases the access units of a frame reader on the schedule of a live source
+class CLiveBitstreamReader : public CSmplBitstreamReader {
+public:
+    CLiveBitstreamReader(std::unique_ptr<CSmplBitstreamReader> reader,
+                         std::shared_ptr<CLiveSource> source);
+
+    virtual void Reset();
+    virtual void Close();
+    virtual mfxStatus Init(const char* strFileName);
+    virtual mfxStatus ReadNextFrame(mfxBitstream* pBS);
+
+protected:
+    std::unique_ptr<CSmplBitstreamReader> m_pReader;
+    std::shared_ptr<CLiveSource> m_pLiveSource;
+};
+
+#endif //__LIVE_SOURCE_H__
@@ -0,0 +1,142 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __SAMPLE_QUALITY_H__
+#define __SAMPLE_QUALITY_H__
+
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vpl/mfxstructures.h"
+
+#include "sample_thread_pool.h"
+
+// Options shared by the tools which verify their raw output while it is produced
+struct sQualityCheckParams {
+    std::string strRefFile; // raw reference in the same layout as the output, enables PSNR/SSIM
+    std::string strDigestIn; // previously recorded digest stream to compare CRCs with
+    std::string strDigestOut; // digest stream to record
+    mfxU32 fileFourCC; // layout of the written file if it differs from the surface (NV12 -> I420/YV12)
+    mfxU32 numThreads; // 0 - number of hardware threads
+
+    sQualityCheckParams()
+            : strRefFile(),
+              strDigestIn(),
+              strDigestOut(),
+              fileFourCC(0),
+              numThreads(0) {}
+
+    bool IsEnabled() const {
+        return !strRefFile.empty() || !strDigestIn.empty() || !strDigestOut.empty();
+    }
+};
+
+// One plane of a frame as it appears in a raw output file.
+struct sQualityPlane {
+    const mfxU8* ptr; // first sample of the cropped area
+    mfxU32 pitch; // bytes between rows
+    mfxU32 width; // samples per row
+    mfxU32 height;
+    mfxU16 sampleSize; // bytes per sample: 1, 2 or 4 (packed 10:10:10:2)
+    mfxU16 step; // distance between written samples in samples, >1 picks one of interleaved planes
+    mfxU16 shift; // right shift applied to 16-bit samples before they are written
+    mfxU16 bitDepth;
+    mfxU16 numComp; // interleaved components in a row, SSIM windows never mix them
+    const char* name;
+
+    mfxU32 GetRowBytes() const {
+        return width * sampleSize;
+    }
+};
+
+struct sQualityPlaneStat {
+    std::string name;
+    mfxF64 psnrSum;
+    mfxF64 psnrMin;
+    mfxF64 ssimSum;
+    mfxF64 ssimMin;
+};
+
+// Per-plane CRC32, PSNR and SSIM of output frames computed inside the pipeline.
+//
+// CRCs are computed over the bytes exactly as a raw writer stores the plane, so a
+// digest recorded here matches the CRC32 of the corresponding part of a dumped file.
+// Rows are split between the threads of a CThreadPool shared by all checkers of the process;
+// partial CRCs are merged with crc32_combine, so results are the same for any number of threads.
+class CQualityChecker {
+public:
+    CQualityChecker();
+    ~CQualityChecker();
+
+    mfxStatus Init(const sQualityCheckParams& params);
+    void Close();
+
+    // Surface data has to be mapped; info describes the cropped output frame.
+    mfxStatus CheckFrame(const mfxFrameInfo& info, const mfxFrameData& data);
+
+    void PrintSummary(const char* prefix) const;
+
+    mfxU32 GetFrameCount() const {
+        return m_numFrames;
+    }
+    mfxU32 GetMismatchCount() const {
+        return m_numMismatches;
+    }
+    const std::vector<sQualityPlaneStat>& GetPlaneStat() const {
+        return m_planeStat;
+    }
+    const std::vector<mfxU32>& GetLastCRC() const {
+        return m_lastCRC;
+    }
+
+    // Splits a frame into planes in the order raw writers store them.
+    static mfxStatus GetPlanes(const mfxFrameInfo& info,
+                               const mfxFrameData& data,
+                               mfxU32 fileFourCC,
+                               std::vector<sQualityPlane>& planes);
+
+    // Standard CRC-32 (IEEE 802.3), crc is the value returned for the preceding data.
+    static mfxU32 CRC32(mfxU32 crc, const mfxU8* data, size_t size);
+    // CRC of the concatenation AB from CRC(A), CRC(B) and the length of B.
+    static mfxU32 CRC32Combine(mfxU32 crcA, mfxU32 crcB, mfxU64 sizeB);
+
+    // Metrics of a single plane pair of identical geometry
+    static mfxF64 PSNR(mfxU64 sse, mfxU64 numSamples, mfxU16 bitDepth);
+    mfxU32 PlaneCRC(const sQualityPlane& plane);
+    mfxU64 PlaneSSE(const sQualityPlane& a, const sQualityPlane& b);
+    mfxF64 PlaneSSIM(const sQualityPlane& a, const sQualityPlane& b);
+
+protected:
+    CQualityChecker(const CQualityChecker&)            = delete;
+    CQualityChecker& operator=(const CQualityChecker&) = delete;
+
+private:
+    mfxStatus CompareWithReference(const std::vector<sQualityPlane>& planes);
+    mfxStatus CompareDigest(const std::vector<mfxU32>& crc);
+    CThreadPool& GetPool(); // taken on first use, shared with other checkers of the process
+
+    std::shared_ptr<CThreadPool> m_pPool;
+    sQualityCheckParams m_params;
+    bool m_bInited;
+
+    FILE* m_fRef;
+    FILE* m_fDigestIn;
+    FILE* m_fDigestOut;
+    std::vector<mfxU8> m_refFrame;
+
+    mfxU32 m_numFrames;
+    mfxU32 m_numCompared; // frames with a reference
+    mfxU32 m_numMismatches; // frames whose digest differs
+    bool m_bRefEnded;
+    bool m_bDigestEnded;
+
+    std::vector<sQualityPlaneStat> m_planeStat;
+    std::vector<mfxU32> m_lastCRC;
+};
+
+#endif //__SAMPLE_QUALITY_H__
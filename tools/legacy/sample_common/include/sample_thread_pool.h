@@ -0,0 +1,72 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __SAMPLE_THREAD_POOL_H__
+#define __SAMPLE_THREAD_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "vpl/mfxdefs.h"
+
+// Fixed-size pool of worker threads used by the CPU reference paths of the samples.
+// Work is submitted as a range of independent items (tiles, rows, planes) which is
+// split between the workers and the calling thread; ParallelFor returns when the
+// whole range has been processed.
+class CThreadPool {
+public:
+    // numThreads == 0 selects the number of hardware threads
+    explicit CThreadPool(mfxU32 numThreads = 0);
+    ~CThreadPool();
+
+    // Pool of numThreads threads shared by all its users in the process, so components which
+    // each want all hardware threads don't oversubscribe the CPU. It goes away with its last user.
+    static std::shared_ptr<CThreadPool> GetShared(mfxU32 numThreads = 0);
+
+    mfxU32 GetNumThreads() const {
+        return (mfxU32)m_workers.size() + 1;
+    }
+
+    // Calls func(begin, end) for contiguous sub-ranges of [0, count).
+    // grain is the minimal number of items handed out at once.
+    void ParallelFor(mfxU32 count,
+                     const std::function<void(mfxU32 begin, mfxU32 end)>& func,
+                     mfxU32 grain = 1);
+
+protected:
+    CThreadPool(const CThreadPool&)            = delete;
+    CThreadPool& operator=(const CThreadPool&) = delete;
+
+private:
+    void WorkerLoop();
+    void RunChunks();
+
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::condition_variable m_done;
+
+    // current job, valid while m_bActive is set
+    const std::function<void(mfxU32, mfxU32)>* m_pFunc;
+    mfxU32 m_count;
+    mfxU32 m_grain;
+    std::atomic<mfxU32> m_next;
+    mfxU32 m_busyWorkers;
+    mfxU64 m_jobId;
+    bool m_bActive;
+    bool m_bStop;
+
+    // serializes concurrent ParallelFor callers
+    std::mutex m_submitMutex;
+};
+
+#endif //__SAMPLE_THREAD_POOL_H__
@@ -752,20 +752,62 @@ using mfxEncodeCtrlWrap     = ExtBufHolder<mfxEncodeCtrl>;
 using mfxInitParamlWrap     = ExtBufHolder<mfxInitParam>;
 using mfxFrameSurfaceWrap   = ExtBufHolder<mfxFrameSurface1>;
 
+// Bitstream buffers in size classes, thread safe, can be shared by sessions. Released buffers
+// are kept for reuse and freed with the pool.
+class BitstreamBufferPool {
+public:
+    struct Statistics {
+        mfxU64 Allocations  = 0; //buffers allocated from the heap
+        mfxU64 Reuses       = 0; //requests served by released buffers
+        mfxU64 Resident     = 0; //bytes allocated
+        mfxU64 PeakResident = 0;
+        mfxU64 InUse        = 0; //bytes given out and not released
+        mfxU64 PeakInUse    = 0;
+    };
+
+    BitstreamBufferPool() : m_mutex(), m_free(), m_stat() {}
+    ~BitstreamBufferPool();
+
+    // Returns buffer of at least size bytes, its real size is stored to pCapacity
+    mfxU8* Acquire(mfxU32 size, mfxU32* pCapacity);
+    void Release(mfxU8* pData, mfxU32 capacity);
+
+    Statistics GetStatistics();
+
+    // Size class of the request, there are four classes between powers of two
+    static mfxU32 GetClassSize(mfxU32 size);
+    static const mfxU32 MinClassSize = 4096;
+
+private:
+    BitstreamBufferPool(const BitstreamBufferPool&)            = delete;
+    BitstreamBufferPool& operator=(const BitstreamBufferPool&) = delete;
+
+    std::mutex m_mutex;
+    std::map<mfxU32, std::vector<mfxU8*>> m_free; //key is class size
+    Statistics m_stat;
+};
+
 class mfxBitstreamWrapper : public ExtBufHolder<mfxBitstream> {
     typedef ExtBufHolder<mfxBitstream> base;
 
 public:
-    mfxBitstreamWrapper() : base(), m_data() {}
+    mfxBitstreamWrapper() : base(), m_data(), m_pool(), m_pooled(false) {}
 
-    mfxBitstreamWrapper(mfxU32 n_bytes) : base(), m_data() {
+    mfxBitstreamWrapper(mfxU32 n_bytes) : base(), m_data(), m_pool(), m_pooled(false) {
         Extend(n_bytes);
     }
 
     mfxBitstreamWrapper(const mfxBitstreamWrapper& bs_wrapper)
             : base(bs_wrapper),
-              m_data(bs_wrapper.m_data) {
+              m_data(bs_wrapper.m_data),
+              m_pool(bs_wrapper.m_pool),
+              m_pooled(false) {
         Data = m_data.data();
+        if (bs_wrapper.m_pooled) {
+            Data     = m_pool->Acquire(bs_wrapper.MaxLength, &MaxLength);
+            m_pooled = true;
+            std::copy(bs_wrapper.Data, bs_wrapper.Data + DataOffset + DataLength, Data);
+        }
     }
 
     mfxBitstreamWrapper& operator=(mfxBitstreamWrapper const& bs_wrapper) {
@@ -776,22 +818,91 @@ public:
         return *this;
     }
 
-    mfxBitstreamWrapper(mfxBitstreamWrapper&& bs_wrapper)            = default;
-    mfxBitstreamWrapper& operator=(mfxBitstreamWrapper&& bs_wrapper) = default;
-    ~mfxBitstreamWrapper()                                           = default;
+    mfxBitstreamWrapper(mfxBitstreamWrapper&& bs_wrapper)
+            : base(bs_wrapper),
+              m_data(std::move(bs_wrapper.m_data)),
+              m_pool(std::move(bs_wrapper.m_pool)),
+              m_pooled(bs_wrapper.m_pooled) {
+        bs_wrapper.Detach();
+    }
+
+    mfxBitstreamWrapper& operator=(mfxBitstreamWrapper&& bs_wrapper) {
+        if (this != &bs_wrapper) {
+            ReleaseBuffer();
+            base::operator=(bs_wrapper);
+            m_data   = std::move(bs_wrapper.m_data);
+            m_pool   = std::move(bs_wrapper.m_pool);
+            m_pooled = bs_wrapper.m_pooled;
+            bs_wrapper.Detach();
+        }
+        return *this;
+    }
+
+    ~mfxBitstreamWrapper() {
+        if (m_pooled)
+            m_pool->Release(Data, MaxLength);
+    }
 
     void Extend(mfxU32 n_bytes) {
         if (MaxLength >= n_bytes)
             return;
 
+        if (m_pool) {
+            mfxU32 capacity = 0;
+            mfxU8* data     = m_pool->Acquire(n_bytes, &capacity);
+            // nothing to copy for a bitstream which is empty at the moment
+            if (DataOffset + DataLength)
+                std::copy(Data, Data + DataOffset + DataLength, data);
+
+            if (m_pooled)
+                m_pool->Release(Data, MaxLength);
+            std::vector<mfxU8>().swap(m_data);
+
+            Data      = data;
+            MaxLength = capacity;
+            m_pooled  = true;
+            return;
+        }
+
         m_data.reserve(n_bytes);
 
         Data      = m_data.data();
         MaxLength = n_bytes;
     }
 
+    // Storage is taken from the pool from now on, current storage is released
+    void SetPool(std::shared_ptr<BitstreamBufferPool> pool) {
+        ReleaseBuffer();
+        m_pool = pool;
+    }
+
+    // Gives storage back, next Extend call allocates it again
+    void ReleaseBuffer() {
+        if (m_pooled)
+            m_pool->Release(Data, MaxLength);
+        std::vector<mfxU8>().swap(m_data);
+
+        Data       = nullptr;
+        MaxLength  = 0;
+        DataLength = 0;
+        DataOffset = 0;
+        m_pooled   = false;
+    }
+
 private:
+    // the moved out wrapper doesn't own pooled storage anymore
+    void Detach() {
+        if (m_pooled) {
+            Data      = nullptr;
+            MaxLength = 0;
+        }
+        m_pooled = false;
+    }
+
     std::vector<mfxU8> m_data;
+    std::shared_ptr<BitstreamBufferPool> m_pool;
+    // Data points to a buffer of m_pool
+    bool m_pooled;
 };
 
 class CSmplYUVReader {
@@ -829,6 +940,8 @@ public:
                                      bool isCompleteFrame = true);
     virtual mfxStatus WriteNextFrame(mfxBitstream* pMfxBitstream, mfxU32 targetID, mfxU32 frameNum);
     virtual mfxStatus Reset();
+    // drops everything written after the first size bytes, writing continues from there
+    virtual mfxStatus Truncate(mfxU64 size);
     virtual void Close();
     mfxU32 m_nProcessedFramesNum;
     bool m_bSkipWriting;
@@ -969,6 +1082,7 @@ public:
     virtual mfxStatus InitDuplicate(const char* strFileName);
     virtual mfxStatus JoinDuplicate(CSmplBitstreamDuplicateWriter* pJoinee);
     virtual mfxStatus WriteNextFrame(mfxBitstream* pMfxBitstream, bool isPrint = true);
+    virtual mfxStatus Truncate(mfxU64 size);
     virtual void Close();
 
 protected:
@@ -1398,29 +1512,6 @@ void WaitForDeviceToBecomeFree(MFXVideoSession& session,
 
 mfxU16 FourCCToChroma(mfxU32 fourCC);
 
-class FPSLimiter {
-public:
-    FPSLimiter()  = default;
-    ~FPSLimiter() = default;
-    void Reset(mfxU32 fps) {
-        m_delayTicks = fps ? msdk_time_get_frequency() / fps : 0;
-    }
-    void Work() {
-        msdk_tick current_tick = msdk_time_get_tick();
-        while (m_delayTicks && (m_startTick + m_delayTicks > current_tick)) {
-            msdk_tick left_tick = m_startTick + m_delayTicks - current_tick;
-            uint32_t sleepTime  = (uint32_t)(left_tick * 1000 / msdk_time_get_frequency());
-            MSDK_SLEEP(sleepTime);
-            current_tick = msdk_time_get_tick();
-        };
-        m_startTick = msdk_time_get_tick();
-    }
-
-protected:
-    msdk_tick m_startTick  = 0;
-    msdk_tick m_delayTicks = 0;
-};
-
 #if defined(_WIN32) || defined(_WIN64)
 mfxStatus PrintLoadedModules();
 #else
@@ -1512,6 +1603,7 @@ public:
     CIVFFrameWriter();
 
     virtual mfxStatus Reset();
+    virtual mfxStatus Truncate(mfxU64 size);
     virtual mfxStatus Init(const char* strFileName,
                            const mfxU16 w,
                            const mfxU16 h,
@@ -1573,6 +1665,7 @@ class CBitstreamWriterForParallelEncoding : public CSmplBitstreamWriter {
 public:
     virtual mfxStatus WriteNextFrame(mfxBitstream* pMfxBitstream, mfxU32 targetID, mfxU32 frameNum);
     virtual mfxStatus Reset();
+    virtual mfxStatus Truncate(mfxU64 size);
 
     mfxU32 m_GopSize          = 0;
     mfxU32 m_NumberOfEncoders = 0;
@@ -0,0 +1,139 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __SHM_FRAME_RING_H__
+#define __SHM_FRAME_RING_H__
+
+#include <string>
+
+#include "vpl/mfxstructures.h"
+
+// What the producer does with a frame when all slots hold frames the consumer has not released
+enum ShmFrameRingPolicy {
+    SHM_RING_BLOCK = 0, // wait for the consumer (back-pressure), drop once it is gone
+    SHM_RING_DROP, // drop the new frame, the consumer sees a gap in the frame numbers
+};
+
+struct ShmFrameRingParams {
+    std::string Name; // /dev/shm/<Name>, or a path if Name contains '/'; empty - no ring
+    mfxU32 Slots; // 0 - SHM_RING_DEFAULT_SLOTS
+    ShmFrameRingPolicy Policy;
+    // how long SHM_RING_BLOCK waits for the first consumer, 0 - SHM_RING_DEFAULT_ATTACH_TIMEOUT
+    mfxU32 AttachTimeoutMs;
+};
+
+#define SHM_RING_DEFAULT_SLOTS          8
+#define SHM_RING_DEFAULT_ATTACH_TIMEOUT 10000
+
+// Header of a slot. The planes of the frame follow each other in the slot with Pitch bytes per
+// row, e.g. the UV plane of NV12 starts at Pitch * Height.
+struct ShmFrameInfo {
+    mfxU64 FrameNumber; // frames offered to the ring before this one, gaps are dropped frames
+    mfxU64 TimeStamp;
+    mfxU32 FourCC;
+    mfxU32 Width;
+    mfxU32 Height;
+    mfxU32 Pitch;
+    mfxU32 DataSize;
+    mfxU32 reserved[7];
+};
+
+struct ShmRingHeader;
+
+// Producer side of a ring of fixed size frame slots in shared memory. One producer and one
+// consumer process; the consumer maps the slots and reads frames in place.
+class CShmFrameRingWriter {
+public:
+    CShmFrameRingWriter();
+    virtual ~CShmFrameRingWriter();
+
+    // Keeps the parameters, the ring is created by Create or with the first WriteFrame
+    mfxStatus Init(const ShmFrameRingParams& params);
+    // Creates the ring with slots of slotSize bytes. An existing file of the same name is replaced
+    // only if it is a ring left behind by a producer that died, otherwise creation fails.
+    mfxStatus Create(mfxU32 slotSize);
+    bool IsCreated() const {
+        return m_pHeader != NULL;
+    }
+
+    // Returns the next free slot, waiting for one under SHM_RING_BLOCK. data is NULL if the
+    // frame has to be dropped. A full ring no consumer has opened yet waits up to AttachTimeoutMs
+    // for the first one under SHM_RING_BLOCK.
+    mfxStatus AcquireSlot(mfxU8*& data);
+    // Publishes the slot returned by AcquireSlot, FrameNumber of info is set by the ring
+    mfxStatus CommitSlot(const ShmFrameInfo& info);
+    // Copies the cropped area of a mapped frame into the next slot. The first frame creates the
+    // ring with slots fitting Width x Height frames.
+    mfxStatus WriteFrame(mfxFrameSurface1* pSurface);
+
+    // Tells the consumer no more frames come and removes the name of the ring
+    void Close();
+
+    // Whether a live consumer has the ring open. Once the first consumer is gone (or never came),
+    // frames that find the ring full are dropped under any policy.
+    bool IsConsumerAttached() const;
+
+    mfxU64 GetWritten() const {
+        return m_written;
+    }
+    mfxU64 GetDropped() const {
+        return m_dropped;
+    }
+    // seconds spent waiting for the consumer
+    double GetBlockTime() const {
+        return m_blockTime;
+    }
+
+protected:
+    CShmFrameRingWriter(const CShmFrameRingWriter&)            = delete;
+    CShmFrameRingWriter& operator=(const CShmFrameRingWriter&) = delete;
+
+private:
+    mfxU32 GetSlotSize() const;
+
+    ShmFrameRingParams m_params;
+    std::string m_path;
+    ShmRingHeader* m_pHeader;
+    size_t m_size;
+    mfxU8* m_pAcquired;
+    bool m_bAttachWaited; // the wait for the first consumer is over
+    mfxU64 m_frameNumber;
+    mfxU64 m_written;
+    mfxU64 m_dropped;
+    double m_blockTime;
+};
+
+// Consumer side of a ring created by CShmFrameRingWriter
+class CShmFrameRingReader {
+public:
+    CShmFrameRingReader();
+    virtual ~CShmFrameRingReader();
+
+    // Attaches to the ring, fails if another live consumer is attached
+    mfxStatus Open(const std::string& name);
+    // Waits up to timeoutMs for the next frame. info and data point into the slot until Release.
+    // Returns MFX_WRN_IN_EXECUTION on timeout and MFX_ERR_MORE_DATA once the producer has closed
+    // the ring (or died) and all frames were read.
+    mfxStatus Acquire(const ShmFrameInfo*& info, const mfxU8*& data, mfxU32 timeoutMs);
+    // Gives the slot of the last acquired frame back to the producer
+    void Release();
+    void Close();
+
+    // frames the producer has dropped so far
+    mfxU64 GetDropped() const;
+    mfxU32 GetSlots() const;
+
+protected:
+    CShmFrameRingReader(const CShmFrameRingReader&)            = delete;
+    CShmFrameRingReader& operator=(const CShmFrameRingReader&) = delete;
+
+private:
+    ShmRingHeader* m_pHeader;
+    size_t m_size;
+    bool m_bAcquired;
+};
+
+#endif //__SHM_FRAME_RING_H__
@@ -0,0 +1,120 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __STREAM_SCHEDULER_H__
+#define __STREAM_SCHEDULER_H__
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "vpl/mfxdefs.h"
+
+// Number of surfaces the streams of a process may hold together
+class CSurfaceBudget {
+public:
+    // surfaces == 0 makes the budget unlimited
+    explicit CSurfaceBudget(mfxU32 surfaces);
+
+    // Blocks until count surfaces are free and takes them. Returns MFX_ERR_MEMORY_ALLOC at once
+    // if count exceeds the whole budget.
+    mfxStatus Acquire(mfxU32 count);
+    // Takes count surfaces at once even if that goes over the budget, for streams that must not
+    // wait (e.g. growing on a resolution change while other streams wait to start)
+    void ForceAcquire(mfxU32 count);
+    void Release(mfxU32 count);
+
+    mfxU32 GetTotal() const {
+        return m_total;
+    }
+    mfxU32 GetPeak() const;
+
+protected:
+    CSurfaceBudget(const CSurfaceBudget&)            = delete;
+    CSurfaceBudget& operator=(const CSurfaceBudget&) = delete;
+
+private:
+    mfxU32 m_total;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_released;
+    mfxU32 m_inUse;
+    mfxU32 m_peak;
+};
+
+// Stream run by CStreamScheduler in small steps
+class IScheduledStream {
+public:
+    virtual ~IScheduledStream() {}
+
+    // Prepares the stream, may block until its surfaces fit the budget
+    virtual mfxStatus Start() = 0;
+    // Does a slice of the work. Returns MFX_ERR_NONE or a warning while there is more to do and
+    // MFX_ERR_MORE_DATA once the stream has ended.
+    virtual mfxStatus Step() = 0;
+    // Ends the stream and frees its resources, called after the last step or a failure
+    virtual mfxStatus Finish() = 0;
+};
+
+struct ScheduledStreamStatistics {
+    mfxStatus Status = MFX_ERR_NONE;
+    double WaitTime  = 0; // seconds from the start of the run until the stream was started
+    double RunTime   = 0; // seconds from the start of the stream until it finished
+    mfxU64 Steps     = 0;
+};
+
+// Runs streams over a fixed pool of worker threads. Streams are started one by one in order on
+// the calling thread, so a stream waiting for surfaces doesn't hold a worker; started streams
+// take turns on the workers one step at a time.
+class CStreamScheduler {
+public:
+    // numThreads == 0 selects the number of hardware threads
+    explicit CStreamScheduler(mfxU32 numThreads = 0);
+
+    mfxU32 GetNumThreads() const {
+        return m_numThreads;
+    }
+
+    // Runs all streams to their end and returns the first error of a stream. A failing stream
+    // doesn't stop the others.
+    mfxStatus Run(const std::vector<IScheduledStream*>& streams);
+
+    // Statistics of the streams of the last run, in the order they were given
+    const std::vector<ScheduledStreamStatistics>& GetStatistics() const {
+        return m_statistics;
+    }
+    // Seconds from the start of the last run until all its streams finished
+    double GetRunTime() const {
+        return m_runTime;
+    }
+
+protected:
+    CStreamScheduler(const CStreamScheduler&)            = delete;
+    CStreamScheduler& operator=(const CStreamScheduler&) = delete;
+
+private:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    void WorkerLoop();
+
+    mfxU32 m_numThreads;
+
+    std::vector<IScheduledStream*> m_streams;
+    std::vector<ScheduledStreamStatistics> m_statistics;
+    std::vector<TimePoint> m_startTimes;
+    double m_runTime;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::condition_variable m_done;
+    std::deque<size_t> m_ready; // started streams waiting for their next step
+    size_t m_running; // started streams that have not finished
+    bool m_bStop;
+};
+
+#endif //__STREAM_SCHEDULER_H__
@@ -8,6 +8,7 @@
 #define __VPL_IMPLEMENTATION_LOADER_H__
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include "vpl/mfxdispatcher.h"
@@ -50,6 +51,8 @@ class VPLImplementationLoader {
     mfxU32 m_DRMRenderNodeNum;
     mfxU32 m_DRMRenderNodeNumUsed;
 #endif
+    // the dispatcher updates the selected implementation while creating a session
+    std::mutex m_CreateSessionMutex;
 
 public:
     VPLImplementationLoader();
@@ -69,6 +72,8 @@ public:
                                               mfxAccelerationMode accelerationMode,
                                               bool lowLatencyMode = true);
     mfxLoader GetLoader() const;
+    // thread-safe MFXCreateSession for the selected implementation
+    mfxStatus CreateSession(mfxSession* session);
     mfxU32 GetImplIndex() const;
     std::string GetImplName() const;
     mfxU16 GetImplType() const;
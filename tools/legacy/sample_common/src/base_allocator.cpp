@@ -91,6 +91,8 @@ mfxStatus BaseFrameAllocator::ReallocFrame(mfxMemId midIn,
 
 mfxStatus BaseFrameAllocator::AllocFrames(mfxFrameAllocRequest* request,
                                           mfxFrameAllocResponse* response) {
+    std::lock_guard<std::mutex> lock(mtx);
+
     if (0 == request || 0 == response || 0 == request->NumFrameSuggested)
         return MFX_ERR_MEMORY_ALLOC;
 
@@ -0,0 +1,240 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "frame_pacer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <errno.h>
+    #include <time.h>
+#endif
+
+// a frame this late restarts the schedule instead of releasing the frames behind it at once
+static const std::chrono::seconds MaxLateness(1);
+// the timer thread takes the final approach to a deadline on the clock rather than on its
+// condition variable; a waiter with an earlier deadline coming meanwhile is released this late
+static const std::chrono::microseconds TimerApproach(1000);
+
+static bool ReadDigits(const std::string& word, mfxU64& value) {
+    // 9 digits keep rates and the scale of fractions within 32 bits
+    if (word.empty() || word.size() > 9 ||
+        word.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+    value = strtoull(word.c_str(), NULL, 10);
+    return true;
+}
+
+mfxStatus ParseFrameRate(const std::string& str, mfxU32& rateN, mfxU32& rateD) {
+    mfxU64 n = 0, d = 1;
+    size_t slash = str.find('/');
+    size_t point = str.find('.');
+    if (slash != std::string::npos) {
+        if (!ReadDigits(str.substr(0, slash), n) || !ReadDigits(str.substr(slash + 1), d))
+            return MFX_ERR_UNSUPPORTED;
+    }
+    else if (point != std::string::npos) {
+        std::string fraction = str.substr(point + 1);
+        if (!ReadDigits(str.substr(0, point) + fraction, n) || fraction.empty())
+            return MFX_ERR_UNSUPPORTED;
+        for (size_t i = 0; i < fraction.size(); i++)
+            d *= 10;
+    }
+    else if (!ReadDigits(str, n)) {
+        return MFX_ERR_UNSUPPORTED;
+    }
+    if (!n || !d)
+        return MFX_ERR_UNSUPPORTED;
+
+    rateN = (mfxU32)n;
+    rateD = (mfxU32)d;
+    return MFX_ERR_NONE;
+}
+
+std::string FramePacerStatistics::ToString() const {
+    char str[256];
+    snprintf(str,
+             sizeof(str),
+             "target %.3f fps, achieved %.3f fps, lateness p50 %u us, p99 %u us, max %u us, "
+             "%u resyncs",
+             TargetRate,
+             AchievedRate,
+             LatenessP50,
+             LatenessP99,
+             LatenessMax,
+             Resyncs);
+    return str;
+}
+
+mfxU32 CDurationHistogram::GetPercentile(mfxU32 percent) const {
+    mfxU64 below = 0;
+    for (const auto& bucket : m_counts) {
+        below += bucket.second;
+        if (below * 100 >= m_samples * percent)
+            return bucket.first;
+    }
+    return GetMax();
+}
+
+void FramePacer::SleepUntil(TimePoint deadline, std::chrono::microseconds spinTail) {
+    TimePoint wakeUp = deadline - spinTail;
+#if !defined(_WIN32) && !defined(_WIN64)
+    // steady_clock is CLOCK_MONOTONIC, an absolute wake-up doesn't add the time spent in the call
+    auto sinceEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        wakeUp.time_since_epoch());
+    if (sinceEpoch.count() > 0) {
+        struct timespec ts;
+        ts.tv_sec  = (time_t)(sinceEpoch.count() / 1000000000);
+        ts.tv_nsec = (long)(sinceEpoch.count() % 1000000000);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+            ;
+    }
+#else
+    std::this_thread::sleep_until(wakeUp);
+#endif
+    while (std::chrono::steady_clock::now() < deadline)
+        std::this_thread::yield();
+}
+
+FramePacerTimer::FramePacerTimer(mfxU32 spinTailUs)
+        : m_spinTail(spinTailUs),
+          m_mutex(),
+          m_wakeUp(),
+          m_waiters(),
+          m_bStop(false),
+          m_thread() {
+    m_thread = std::thread(&FramePacerTimer::TimerLoop, this);
+}
+
+FramePacerTimer::~FramePacerTimer() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStop = true;
+    }
+    m_wakeUp.notify_one();
+    m_thread.join();
+}
+
+void FramePacerTimer::WaitUntil(TimePoint deadline) {
+    Waiter waiter;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool earliest = m_waiters.empty() || deadline < m_waiters.begin()->first;
+    m_waiters.insert(std::make_pair(deadline, &waiter));
+    if (earliest)
+        m_wakeUp.notify_one();
+    waiter.Wake.wait(lock, [&waiter] {
+        return waiter.Released;
+    });
+}
+
+void FramePacerTimer::TimerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_bStop) {
+        if (m_waiters.empty()) {
+            m_wakeUp.wait(lock);
+            continue;
+        }
+
+        TimePoint deadline = m_waiters.begin()->first;
+        TimePoint approach = deadline - m_spinTail - TimerApproach;
+        if (std::chrono::steady_clock::now() < approach) {
+            // woken up early when a waiter with an earlier deadline comes
+            m_wakeUp.wait_until(lock, approach);
+            continue;
+        }
+
+        // absolute sleep until the spin tail, then the clock is polled up to the deadline
+        lock.unlock();
+        FramePacer::SleepUntil(deadline, m_spinTail);
+        lock.lock();
+
+        TimePoint now = std::chrono::steady_clock::now();
+        while (!m_waiters.empty() && m_waiters.begin()->first <= now) {
+            Waiter* waiter   = m_waiters.begin()->second;
+            waiter->Released = true;
+            waiter->Wake.notify_one();
+            m_waiters.erase(m_waiters.begin());
+        }
+    }
+
+    // nobody is left behind on shutdown
+    for (auto& waiter : m_waiters) {
+        waiter.second->Released = true;
+        waiter.second->Wake.notify_one();
+    }
+    m_waiters.clear();
+}
+
+mfxU64 FramePacer::GetDeadlineOffset(mfxU64 n, mfxU32 rateN, mfxU32 rateD) {
+    // n / rateN * period is exact in integers: splitting n = q * rateN + r and
+    // period = a * rateN + b keeps every product within 64 bits
+    const mfxU64 period = (mfxU64)rateD * 1000000000;
+    mfxU64 q = n / rateN, r = n % rateN;
+    mfxU64 a = period / rateN, b = period % rateN;
+    return q * period + r * a + r * b / rateN;
+}
+
+void FramePacer::Reset(mfxU32 rateN, mfxU32 rateD) {
+    m_rateN     = rateN;
+    m_rateD     = rateD ? rateD : 1;
+    m_nextFrame = 0;
+    m_frames    = 0;
+    m_lateness.Clear();
+    m_resyncs = 0;
+}
+
+void FramePacer::WaitUntil(TimePoint deadline) {
+    if (m_timer)
+        m_timer->WaitUntil(deadline);
+    else
+        SleepUntil(deadline, m_spinTail);
+}
+
+void FramePacer::Work() {
+    if (!m_rateN)
+        return;
+
+    TimePoint now = std::chrono::steady_clock::now();
+    TimePoint deadline =
+        m_start + std::chrono::nanoseconds(GetDeadlineOffset(m_nextFrame, m_rateN, m_rateD));
+    if (!m_nextFrame || now > deadline + MaxLateness) {
+        if (m_nextFrame)
+            m_resyncs++;
+        m_start     = now;
+        m_nextFrame = 0;
+        deadline    = now;
+    }
+    else if (now < deadline) {
+        WaitUntil(deadline);
+        now = std::chrono::steady_clock::now();
+    }
+    m_nextFrame++;
+
+    if (!m_frames++)
+        m_firstFrame = now;
+    else
+        m_lateness.Add(
+            (mfxU32)std::chrono::duration_cast<std::chrono::microseconds>(now - deadline).count());
+    m_lastFrame = now;
+}
+
+FramePacerStatistics FramePacer::GetStatistics() const {
+    FramePacerStatistics stat;
+    stat.Frames     = m_frames;
+    stat.TargetRate = m_rateN ? (double)m_rateN / m_rateD : 0;
+    stat.Resyncs    = m_resyncs;
+
+    double seconds = std::chrono::duration<double>(m_lastFrame - m_firstFrame).count();
+    if (m_frames > 1 && seconds > 0)
+        stat.AchievedRate = (m_frames - 1) / seconds;
+
+    stat.LatenessP50 = m_lateness.GetPercentile(50);
+    stat.LatenessP99 = m_lateness.GetPercentile(99);
+    stat.LatenessMax = m_lateness.GetMax();
+    return stat;
+}
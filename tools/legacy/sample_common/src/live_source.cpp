@@ -0,0 +1,180 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "live_source.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+// arrivals kept for frames the pipeline has not output yet
+static const size_t MaxPendingArrivals = 4096;
+// frames looked ahead of the next one when the queue of arrived frames is measured
+static const mfxU32 MaxQueueLookahead = 100000;
+
+// splitmix64, the jitter of a frame depends on the seed and its number only
+static mfxU64 MixBits(mfxU64 value) {
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+std::string LiveSourceStatistics::ToString() const {
+    char str[256];
+    snprintf(str,
+             sizeof(str),
+             "%llu frames, latency p50 %.1f ms, p99 %.1f ms, max %.1f ms, %llu deadline misses "
+             "(> %u ms), max queue %u frames",
+             (unsigned long long)Frames,
+             LatencyP50 / 1000.,
+             LatencyP99 / 1000.,
+             LatencyMax / 1000.,
+             (unsigned long long)DeadlineMiss,
+             DeadlineMs,
+             MaxQueueDepth);
+    return str;
+}
+
+CLiveSource::CLiveSource(const LiveSourceParams& params)
+        : m_params(params),
+          m_deadline(),
+          m_mutex(),
+          m_start(),
+          m_nextFrame(0),
+          m_lastArrival(0),
+          m_arrivals(),
+          m_outputs(0),
+          m_latency(),
+          m_deadlineMiss(0),
+          m_maxQueueDepth(0) {
+    if (!m_params.RateD)
+        m_params.RateD = 1;
+    m_params.BurstLength = std::min(m_params.BurstLength, m_params.BurstInterval);
+    if (!m_params.DeadlineMs && m_params.RateN) {
+        mfxU64 twoPeriods   = FramePacer::GetDeadlineOffset(2, m_params.RateN, m_params.RateD);
+        m_params.DeadlineMs = (mfxU32)(twoPeriods / 1000000);
+    }
+    m_deadline = std::chrono::milliseconds(m_params.DeadlineMs);
+}
+
+mfxU64 CLiveSource::GetArrivalOffset(mfxU64 n) const {
+    if (!m_params.RateN)
+        return 0;
+
+    mfxU64 slot = n;
+    if (m_params.BurstLength) {
+        mfxU64 pos = n % m_params.BurstInterval;
+        if (pos < m_params.BurstLength)
+            slot = n - pos + m_params.BurstLength - 1;
+    }
+    mfxU64 offset = FramePacer::GetDeadlineOffset(slot, m_params.RateN, m_params.RateD);
+    if (m_params.JitterUs)
+        offset += MixBits(m_params.Seed ^ MixBits(n)) % (m_params.JitterUs + 1) * 1000;
+    return offset;
+}
+
+void CLiveSource::WaitForNextFrame() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    TimePoint now = std::chrono::steady_clock::now();
+    if (!m_nextFrame)
+        m_start = now;
+
+    // a frame overtaken by jitter arrives right after the one before it
+    mfxU64 frame      = m_nextFrame++;
+    m_lastArrival     = std::max(m_lastArrival, GetArrivalOffset(frame));
+    TimePoint arrival = m_start + std::chrono::nanoseconds(m_lastArrival);
+
+    mfxU32 depth = 1;
+    if (now < arrival) {
+        lock.unlock();
+        FramePacer::SleepUntil(arrival);
+        lock.lock();
+    }
+    else {
+        // the pipeline fell behind the feed, frames arrived since are waiting for it
+        mfxU64 nowOffset =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_start).count();
+        mfxU64 next = m_lastArrival;
+        while (depth < MaxQueueLookahead &&
+               (next = std::max(next, GetArrivalOffset(frame + depth))) <= nowOffset)
+            depth++;
+    }
+    m_maxQueueDepth = std::max(m_maxQueueDepth, depth);
+
+    if (m_arrivals.size() == MaxPendingArrivals)
+        m_arrivals.pop_front();
+    m_arrivals.push_back(arrival);
+}
+
+void CLiveSource::OnFrameOutput() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_arrivals.empty())
+        return;
+
+    auto latency = std::chrono::steady_clock::now() - m_arrivals.front();
+    m_arrivals.pop_front();
+
+    m_outputs++;
+    m_latency.Add((mfxU32)std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+    if (latency > m_deadline)
+        m_deadlineMiss++;
+}
+
+LiveSourceStatistics CLiveSource::GetStatistics() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    LiveSourceStatistics stat;
+    stat.Frames        = m_nextFrame;
+    stat.Outputs       = m_outputs;
+    stat.LatencyP50    = m_latency.GetPercentile(50);
+    stat.LatencyP99    = m_latency.GetPercentile(99);
+    stat.LatencyMax    = m_latency.GetMax();
+    stat.DeadlineMs    = m_params.DeadlineMs;
+    stat.DeadlineMiss  = m_deadlineMiss;
+    stat.MaxQueueDepth = m_maxQueueDepth;
+    return stat;
+}
+
+mfxStatus CLiveYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
+    mfxStatus sts = CSmplYUVReader::LoadNextFrame(pSurface);
+    // the frame is read ahead and handed out when it arrives
+    if (sts == MFX_ERR_NONE && m_pLiveSource)
+        m_pLiveSource->WaitForNextFrame();
+    return sts;
+}
+
+mfxStatus CLiveYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface,
+                                        int bytes_to_read,
+                                        mfxU8* buf_read) {
+    mfxStatus sts = CSmplYUVReader::LoadNextFrame(pSurface, bytes_to_read, buf_read);
+    if (sts == MFX_ERR_NONE && m_pLiveSource)
+        m_pLiveSource->WaitForNextFrame();
+    return sts;
+}
+
+CLiveBitstreamReader::CLiveBitstreamReader(std::unique_ptr<CSmplBitstreamReader> reader,
+                                           std::shared_ptr<CLiveSource> source)
+        : CSmplBitstreamReader(),
+          m_pReader(std::move(reader)),
+          m_pLiveSource(source) {}
+
+void CLiveBitstreamReader::Reset() {
+    m_pReader->Reset();
+}
+
+void CLiveBitstreamReader::Close() {
+    m_pReader->Close();
+}
+
+mfxStatus CLiveBitstreamReader::Init(const char* strFileName) {
+    return m_pReader->Init(strFileName);
+}
+
+mfxStatus CLiveBitstreamReader::ReadNextFrame(mfxBitstream* pBS) {
+    mfxStatus sts = m_pReader->ReadNextFrame(pBS);
+    if (sts == MFX_ERR_NONE && m_pLiveSource)
+        m_pLiveSource->WaitForNextFrame();
+    return sts;
+}
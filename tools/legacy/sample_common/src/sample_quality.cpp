@@ -0,0 +1,751 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "sample_quality.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "sample_defs.h"
+
+// rows of a plane processed as one task, fixed so the results do not depend on threading
+#define QUALITY_BAND_ROWS 32
+
+// SSIM window size and step in samples of one component
+#define SSIM_WINDOW 8
+#define SSIM_STEP   4
+
+// reported for identical planes
+#define QUALITY_MAX_PSNR 100.0
+
+// only the first mismatches are printed, the rest are counted
+#define QUALITY_MAX_REPORTS 10
+
+/* ************************************************************************* */
+/* CRC-32, reflected polynomial 0xEDB88320, slicing by 4                      */
+/* ************************************************************************* */
+
+namespace {
+
+struct CRCTables {
+    mfxU32 t[4][256];
+
+    CRCTables() {
+        for (mfxU32 i = 0; i < 256; i++) {
+            mfxU32 c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? (c >> 1) ^ 0xEDB88320u : c >> 1;
+            t[0][i] = c;
+        }
+        for (mfxU32 i = 0; i < 256; i++) {
+            t[1][i] = (t[0][i] >> 8) ^ t[0][t[0][i] & 0xFF];
+            t[2][i] = (t[1][i] >> 8) ^ t[0][t[1][i] & 0xFF];
+            t[3][i] = (t[2][i] >> 8) ^ t[0][t[2][i] & 0xFF];
+        }
+    }
+};
+
+const CRCTables& GetCRCTables() {
+    static const CRCTables tables;
+    return tables;
+}
+
+// a(x) * b(x) modulo the CRC polynomial, both reflected
+mfxU32 MultModP(mfxU32 a, mfxU32 b) {
+    mfxU32 m = 1u << 31, p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ 0xEDB88320u : b >> 1;
+    }
+    return p;
+}
+
+// x^(n * 2^k) modulo the CRC polynomial
+mfxU32 X2NModP(mfxU64 n, mfxU32 k) {
+    static const struct X2NTable {
+        mfxU32 t[32];
+        X2NTable() {
+            mfxU32 p = 1u << 30; // x^1
+            t[0]     = p;
+            for (int i = 1; i < 32; i++)
+                t[i] = p = MultModP(p, p);
+        }
+    } table;
+
+    mfxU32 p = 1u << 31; // x^0
+    while (n) {
+        if (n & 1)
+            p = MultModP(table.t[k & 31], p);
+        n >>= 1;
+        k++;
+    }
+    return p;
+}
+
+/* ************************************************************************* */
+/* row access                                                                 */
+/* ************************************************************************* */
+
+inline const mfxU8* RowPtr(const sQualityPlane& plane, mfxU32 y) {
+    return plane.ptr + (size_t)y * plane.pitch;
+}
+
+// Returns the row bytes as a raw writer stores them, tmp is used if they have to be gathered
+const mfxU8* GetFileRow(const sQualityPlane& plane, mfxU32 y, std::vector<mfxU8>& tmp) {
+    const mfxU8* src = RowPtr(plane, y);
+    if (plane.step == 1 && !plane.shift)
+        return src;
+
+    tmp.resize(plane.GetRowBytes());
+    if (plane.sampleSize == 2) {
+        const mfxU16* s = (const mfxU16*)src;
+        mfxU16* d       = (mfxU16*)tmp.data();
+        for (mfxU32 x = 0; x < plane.width; x++)
+            d[x] = (mfxU16)(s[x * plane.step] >> plane.shift);
+    }
+    else if (plane.sampleSize == 4) {
+        const mfxU32* s = (const mfxU32*)src;
+        mfxU32* d       = (mfxU32*)tmp.data();
+        for (mfxU32 x = 0; x < plane.width; x++)
+            d[x] = s[x * plane.step];
+    }
+    else {
+        for (mfxU32 x = 0; x < plane.width; x++)
+            tmp[x] = src[x * plane.step];
+    }
+    return tmp.data();
+}
+
+inline mfxU32 GetCompsPerRow(const sQualityPlane& plane) {
+    return plane.width * (plane.sampleSize == 4 ? 3 : 1);
+}
+
+// Unpacks a row into one sample per component
+void GetCompRow(const sQualityPlane& plane, mfxU32 y, mfxU16* dst) {
+    const mfxU8* src = RowPtr(plane, y);
+    mfxU32 step      = plane.step;
+
+    switch (plane.sampleSize) {
+        case 1:
+            for (mfxU32 x = 0; x < plane.width; x++)
+                dst[x] = src[x * step];
+            break;
+        case 2: {
+            const mfxU16* s = (const mfxU16*)src;
+            mfxU16 shift    = plane.shift;
+            for (mfxU32 x = 0; x < plane.width; x++)
+                dst[x] = (mfxU16)(s[x * step] >> shift);
+            break;
+        }
+        case 4: {
+            // 10:10:10:2 packed (Y410, A2RGB10), alpha is left out
+            const mfxU32* s = (const mfxU32*)src;
+            for (mfxU32 x = 0; x < plane.width; x++) {
+                mfxU32 v       = s[x * step];
+                dst[3 * x + 0] = (mfxU16)(v & 0x3FF);
+                dst[3 * x + 1] = (mfxU16)((v >> 10) & 0x3FF);
+                dst[3 * x + 2] = (mfxU16)((v >> 20) & 0x3FF);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+inline mfxU32 GetNumBands(mfxU32 height) {
+    return (height + QUALITY_BAND_ROWS - 1) / QUALITY_BAND_ROWS;
+}
+
+inline mfxU32 GetNumWindows(mfxU32 size) {
+    return (size <= SSIM_WINDOW) ? 1 : (size - SSIM_WINDOW) / SSIM_STEP + 1;
+}
+
+} // namespace
+
+/* ************************************************************************* */
+
+CQualityChecker::CQualityChecker()
+        : m_pPool(),
+          m_params(),
+          m_bInited(false),
+          m_fRef(NULL),
+          m_fDigestIn(NULL),
+          m_fDigestOut(NULL),
+          m_refFrame(),
+          m_numFrames(0),
+          m_numCompared(0),
+          m_numMismatches(0),
+          m_bRefEnded(false),
+          m_bDigestEnded(false),
+          m_planeStat(),
+          m_lastCRC() {}
+
+CQualityChecker::~CQualityChecker() {
+    Close();
+}
+
+mfxStatus CQualityChecker::Init(const sQualityCheckParams& params) {
+    Close();
+
+    m_params = params;
+
+    if (!m_params.strRefFile.empty()) {
+        MSDK_FOPEN(m_fRef, m_params.strRefFile.c_str(), "rb");
+        MSDK_CHECK_POINTER(m_fRef, MFX_ERR_NULL_PTR);
+    }
+    if (!m_params.strDigestIn.empty()) {
+        MSDK_FOPEN(m_fDigestIn, m_params.strDigestIn.c_str(), "r");
+        MSDK_CHECK_POINTER(m_fDigestIn, MFX_ERR_NULL_PTR);
+    }
+    if (!m_params.strDigestOut.empty()) {
+        MSDK_FOPEN(m_fDigestOut, m_params.strDigestOut.c_str(), "w");
+        MSDK_CHECK_POINTER(m_fDigestOut, MFX_ERR_NULL_PTR);
+        fprintf(m_fDigestOut, "# frame crc32 per plane\n");
+    }
+
+    if (m_pPool && m_params.numThreads && m_pPool->GetNumThreads() != m_params.numThreads)
+        m_pPool.reset();
+
+    m_numFrames     = 0;
+    m_numCompared   = 0;
+    m_numMismatches = 0;
+    m_bRefEnded     = false;
+    m_bDigestEnded  = false;
+    m_planeStat.clear();
+    m_lastCRC.clear();
+
+    m_bInited = true;
+
+    return MFX_ERR_NONE;
+}
+
+void CQualityChecker::Close() {
+    if (m_fDigestIn) {
+        // output is shorter than the recorded stream
+        char line[1024];
+        while (!m_bDigestEnded && fgets(line, sizeof(line), m_fDigestIn)) {
+            if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+                continue;
+            printf("Quality check: digest stream has more frames than the output\n");
+            m_numMismatches++;
+            break;
+        }
+        fclose(m_fDigestIn);
+        m_fDigestIn = NULL;
+    }
+    if (m_fDigestOut) {
+        fclose(m_fDigestOut);
+        m_fDigestOut = NULL;
+    }
+    if (m_fRef) {
+        fclose(m_fRef);
+        m_fRef = NULL;
+    }
+    m_bInited = false;
+}
+
+mfxStatus CQualityChecker::GetPlanes(const mfxFrameInfo& info,
+                                     const mfxFrameData& data,
+                                     mfxU32 fileFourCC,
+                                     std::vector<sQualityPlane>& planes) {
+    planes.clear();
+
+    mfxU32 cx = info.CropX, cy = info.CropY;
+    mfxU32 w = info.CropW ? info.CropW : info.Width;
+    mfxU32 h = info.CropH ? info.CropH : info.Height;
+    if (!w || !h)
+        return MFX_ERR_INVALID_VIDEO_PARAM;
+
+    mfxU32 pitch  = ((mfxU32)data.PitchHigh << 16) | data.PitchLow;
+    mfxU32 cw     = (w + 1) / 2;
+    mfxU32 ch     = (h + 1) / 2;
+    mfxU16 depth  = info.BitDepthLuma;
+    mfxU16 cdepth = info.BitDepthChroma ? info.BitDepthChroma : depth;
+
+    auto add = [&](const mfxU8* ptr,
+                   mfxU32 planePitch,
+                   mfxU32 width,
+                   mfxU32 height,
+                   mfxU16 sampleSize,
+                   mfxU16 step,
+                   mfxU16 bitDepth,
+                   mfxU16 numComp,
+                   const char* name) {
+        sQualityPlane plane;
+        plane.ptr        = ptr;
+        plane.pitch      = planePitch;
+        plane.width      = width;
+        plane.height     = height;
+        plane.sampleSize = sampleSize;
+        plane.step       = step;
+        plane.bitDepth   = bitDepth;
+        plane.shift      = (sampleSize == 2 && info.Shift) ? (mfxU16)(16 - bitDepth) : 0;
+        plane.numComp    = numComp;
+        plane.name       = name;
+        planes.push_back(plane);
+    };
+
+    switch (info.FourCC) {
+        case MFX_FOURCC_NV12:
+        case MFX_FOURCC_NV16: {
+            MSDK_CHECK_POINTER(data.Y, MFX_ERR_NULL_PTR);
+            MSDK_CHECK_POINTER(data.UV, MFX_ERR_NULL_PTR);
+            mfxU32 chromaH = (info.FourCC == MFX_FOURCC_NV12) ? ch : h;
+            mfxU32 chromaY = (info.FourCC == MFX_FOURCC_NV12) ? cy / 2 : cy;
+            const mfxU8* uv = data.UV + chromaY * pitch + (cx & ~1u);
+
+            add(data.Y + cy * pitch + cx, pitch, w, h, 1, 1, 8, 1, "Y");
+            if (info.FourCC == MFX_FOURCC_NV12 && fileFourCC == MFX_FOURCC_I420) {
+                add(uv, pitch, cw, chromaH, 1, 2, 8, 1, "U");
+                add(uv + 1, pitch, cw, chromaH, 1, 2, 8, 1, "V");
+            }
+            else if (info.FourCC == MFX_FOURCC_NV12 && fileFourCC == MFX_FOURCC_YV12) {
+                add(uv + 1, pitch, cw, chromaH, 1, 2, 8, 1, "V");
+                add(uv, pitch, cw, chromaH, 1, 2, 8, 1, "U");
+            }
+            else {
+                add(uv, pitch, 2 * cw, chromaH, 1, 1, 8, 2, "UV");
+            }
+            break;
+        }
+        case MFX_FOURCC_I420:
+        case MFX_FOURCC_YV12:
+        case MFX_FOURCC_I422: {
+            MSDK_CHECK_POINTER(data.Y, MFX_ERR_NULL_PTR);
+            MSDK_CHECK_POINTER(data.U, MFX_ERR_NULL_PTR);
+            MSDK_CHECK_POINTER(data.V, MFX_ERR_NULL_PTR);
+            mfxU32 cpitch   = pitch / 2;
+            mfxU32 chromaH  = (info.FourCC == MFX_FOURCC_I422) ? h : ch;
+            mfxU32 chromaY  = (info.FourCC == MFX_FOURCC_I422) ? cy : cy / 2;
+            const mfxU8* pU = data.U + chromaY * cpitch + cx / 2;
+            const mfxU8* pV = data.V + chromaY * cpitch + cx / 2;
+
+            add(data.Y + cy * pitch + cx, pitch, w, h, 1, 1, 8, 1, "Y");
+            if (info.FourCC == MFX_FOURCC_YV12) {
+                add(pV, cpitch, cw, chromaH, 1, 1, 8, 1, "V");
+                add(pU, cpitch, cw, chromaH, 1, 1, 8, 1, "U");
+            }
+            else {
+                add(pU, cpitch, cw, chromaH, 1, 1, 8, 1, "U");
+                add(pV, cpitch, cw, chromaH, 1, 1, 8, 1, "V");
+            }
+            break;
+        }
+        case MFX_FOURCC_P010:
+        case MFX_FOURCC_P016:
+        case MFX_FOURCC_P210: {
+            MSDK_CHECK_POINTER(data.Y, MFX_ERR_NULL_PTR);
+            MSDK_CHECK_POINTER(data.UV, MFX_ERR_NULL_PTR);
+            mfxU16 def     = (info.FourCC == MFX_FOURCC_P016) ? 16 : 10;
+            mfxU32 chromaH = (info.FourCC == MFX_FOURCC_P210) ? h : ch;
+            mfxU32 chromaY = (info.FourCC == MFX_FOURCC_P210) ? cy : cy / 2;
+
+            add(data.Y + cy * pitch + cx * 2, pitch, w, h, 2, 1, depth ? depth : def, 1, "Y");
+            add(data.UV + chromaY * pitch + (cx & ~1u) * 2,
+                pitch,
+                2 * cw,
+                chromaH,
+                2,
+                1,
+                cdepth ? cdepth : def,
+                2,
+                "UV");
+            break;
+        }
+        case MFX_FOURCC_I010:
+        case MFX_FOURCC_I210: {
+            MSDK_CHECK_POINTER(data.Y, MFX_ERR_NULL_PTR);
+            MSDK_CHECK_POINTER(data.U, MFX_ERR_NULL_PTR);
+            MSDK_CHECK_POINTER(data.V, MFX_ERR_NULL_PTR);
+            mfxU32 cpitch  = pitch / 2;
+            mfxU32 chromaH = (info.FourCC == MFX_FOURCC_I210) ? h : ch;
+            mfxU32 chromaY = (info.FourCC == MFX_FOURCC_I210) ? cy : cy / 2;
+
+            add(data.Y + cy * pitch + cx * 2, pitch, w, h, 2, 1, depth ? depth : 10, 1, "Y");
+            add(data.U + chromaY * cpitch + (cx / 2) * 2,
+                cpitch,
+                cw,
+                chromaH,
+                2,
+                1,
+                cdepth ? cdepth : 10,
+                1,
+                "U");
+            add(data.V + chromaY * cpitch + (cx / 2) * 2,
+                cpitch,
+                cw,
+                chromaH,
+                2,
+                1,
+                cdepth ? cdepth : 10,
+                1,
+                "V");
+            break;
+        }
+        case MFX_FOURCC_Y210:
+        case MFX_FOURCC_Y216: {
+            MSDK_CHECK_POINTER(data.Y, MFX_ERR_NULL_PTR);
+            mfxU16 def = (info.FourCC == MFX_FOURCC_Y216) ? 16 : 10;
+            add(data.Y + cy * pitch + cx * 4, pitch, 2 * w, h, 2, 1, depth ? depth : def, 4, "YUYV");
+            break;
+        }
+        case MFX_FOURCC_Y416: {
+            MSDK_CHECK_POINTER(data.U, MFX_ERR_NULL_PTR);
+            add(data.U + cy * pitch + cx * 8, pitch, 4 * w, h, 2, 1, depth ? depth : 16, 4, "UYVA");
+            break;
+        }
+        case MFX_FOURCC_Y410: {
+            MSDK_CHECK_POINTER(data.Y410, MFX_ERR_NULL_PTR);
+            add((const mfxU8*)data.Y410 + cy * pitch + cx * 4, pitch, w, h, 4, 1, 10, 3, "UYV");
+            break;
+        }
+        case MFX_FOURCC_A2RGB10:
+        case MFX_FOURCC_RGB4:
+        case MFX_FOURCC_AYUV: {
+            // lowest of the channel pointers is the start of the packed pixel
+            const mfxU8* ptr = nullptr;
+            for (const mfxU8* p : { data.R, data.G, data.B }) {
+                if (p && (!ptr || p < ptr))
+                    ptr = p;
+            }
+            MSDK_CHECK_POINTER(ptr, MFX_ERR_NULL_PTR);
+            if (info.FourCC == MFX_FOURCC_A2RGB10)
+                add(ptr + cy * pitch + cx * 4, pitch, w, h, 4, 1, 10, 3, "BGR");
+            else
+                add(ptr + cy * pitch + cx * 4, pitch, 4 * w, h, 1, 1, 8, 4, "RGBA");
+            break;
+        }
+        case MFX_FOURCC_YUY2: {
+            MSDK_CHECK_POINTER(data.Y, MFX_ERR_NULL_PTR);
+            add(data.Y + cy * pitch + cx * 2, pitch, 4 * cw, h, 1, 1, 8, 4, "YUYV");
+            break;
+        }
+        default:
+            return MFX_ERR_UNSUPPORTED;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+mfxU32 CQualityChecker::CRC32(mfxU32 crc, const mfxU8* data, size_t size) {
+    const CRCTables& tab = GetCRCTables();
+
+    crc = ~crc;
+    while (size && ((size_t)data & 3)) {
+        crc = (crc >> 8) ^ tab.t[0][(crc ^ *data++) & 0xFF];
+        size--;
+    }
+    while (size >= 4) {
+        mfxU32 v = crc ^ ((mfxU32)data[0] | ((mfxU32)data[1] << 8) | ((mfxU32)data[2] << 16) |
+                          ((mfxU32)data[3] << 24));
+        crc      = tab.t[3][v & 0xFF] ^ tab.t[2][(v >> 8) & 0xFF] ^ tab.t[1][(v >> 16) & 0xFF] ^
+              tab.t[0][v >> 24];
+        data += 4;
+        size -= 4;
+    }
+    while (size--)
+        crc = (crc >> 8) ^ tab.t[0][(crc ^ *data++) & 0xFF];
+
+    return ~crc;
+}
+
+mfxU32 CQualityChecker::CRC32Combine(mfxU32 crcA, mfxU32 crcB, mfxU64 sizeB) {
+    return MultModP(X2NModP(sizeB, 3), crcA) ^ crcB;
+}
+
+mfxF64 CQualityChecker::PSNR(mfxU64 sse, mfxU64 numSamples, mfxU16 bitDepth) {
+    if (!sse)
+        return QUALITY_MAX_PSNR;
+
+    mfxF64 maxVal = (mfxF64)((1u << bitDepth) - 1);
+    mfxF64 psnr   = 10.0 * log10(maxVal * maxVal * (mfxF64)numSamples / (mfxF64)sse);
+    return std::min(psnr, QUALITY_MAX_PSNR);
+}
+
+CThreadPool& CQualityChecker::GetPool() {
+    if (!m_pPool)
+        m_pPool = CThreadPool::GetShared(m_params.numThreads);
+    return *m_pPool;
+}
+
+mfxU32 CQualityChecker::PlaneCRC(const sQualityPlane& plane) {
+    mfxU32 numBands = GetNumBands(plane.height);
+    std::vector<mfxU32> bandCRC(numBands, 0);
+
+    GetPool().ParallelFor(numBands, [&](mfxU32 begin, mfxU32 end) {
+        std::vector<mfxU8> tmp;
+        for (mfxU32 band = begin; band < end; band++) {
+            mfxU32 y0  = band * QUALITY_BAND_ROWS;
+            mfxU32 y1  = std::min(y0 + QUALITY_BAND_ROWS, plane.height);
+            mfxU32 crc = 0;
+            for (mfxU32 y = y0; y < y1; y++)
+                crc = CRC32(crc, GetFileRow(plane, y, tmp), plane.GetRowBytes());
+            bandCRC[band] = crc;
+        }
+    });
+
+    mfxU32 crc = bandCRC[0];
+    for (mfxU32 band = 1; band < numBands; band++) {
+        mfxU32 rows = std::min<mfxU32>(QUALITY_BAND_ROWS, plane.height - band * QUALITY_BAND_ROWS);
+        crc         = CRC32Combine(crc, bandCRC[band], (mfxU64)rows * plane.GetRowBytes());
+    }
+    return crc;
+}
+
+mfxU64 CQualityChecker::PlaneSSE(const sQualityPlane& a, const sQualityPlane& b) {
+    mfxU32 numBands = GetNumBands(a.height);
+    mfxU32 n        = GetCompsPerRow(a);
+    std::vector<mfxU64> bandSSE(numBands, 0);
+
+    GetPool().ParallelFor(numBands, [&](mfxU32 begin, mfxU32 end) {
+        std::vector<mfxU16> rowA(n), rowB(n);
+        for (mfxU32 band = begin; band < end; band++) {
+            mfxU32 y0  = band * QUALITY_BAND_ROWS;
+            mfxU32 y1  = std::min(y0 + QUALITY_BAND_ROWS, a.height);
+            mfxU64 sse = 0;
+            for (mfxU32 y = y0; y < y1; y++) {
+                GetCompRow(a, y, rowA.data());
+                GetCompRow(b, y, rowB.data());
+                const mfxU16* pa = rowA.data();
+                const mfxU16* pb = rowB.data();
+                for (mfxU32 x = 0; x < n; x++) {
+                    mfxI64 d = (mfxI32)pa[x] - (mfxI32)pb[x];
+                    sse += (mfxU64)(d * d);
+                }
+            }
+            bandSSE[band] = sse;
+        }
+    });
+
+    mfxU64 sse = 0;
+    for (mfxU64 v : bandSSE)
+        sse += v;
+    return sse;
+}
+
+mfxF64 CQualityChecker::PlaneSSIM(const sQualityPlane& a, const sQualityPlane& b) {
+    mfxU32 n       = GetCompsPerRow(a);
+    mfxU32 numComp = std::max<mfxU16>(a.numComp, 1);
+    mfxU32 winH    = std::min<mfxU32>(SSIM_WINDOW, a.height);
+    mfxU32 rowsWin = GetNumWindows(a.height);
+
+    mfxF64 maxVal = (mfxF64)((1u << a.bitDepth) - 1);
+    mfxF64 c1     = (0.01 * maxVal) * (0.01 * maxVal);
+    mfxF64 c2     = (0.03 * maxVal) * (0.03 * maxVal);
+
+    std::vector<mfxF64> rowSum(rowsWin, 0.0);
+    std::vector<mfxU32> rowCount(rowsWin, 0);
+
+    GetPool().ParallelFor(rowsWin, [&](mfxU32 begin, mfxU32 end) {
+        std::vector<mfxU16> bufA((size_t)n * winH), bufB((size_t)n * winH);
+        for (mfxU32 wy = begin; wy < end; wy++) {
+            mfxU32 y0 = wy * SSIM_STEP;
+            for (mfxU32 i = 0; i < winH; i++) {
+                GetCompRow(a, y0 + i, &bufA[(size_t)i * n]);
+                GetCompRow(b, y0 + i, &bufB[(size_t)i * n]);
+            }
+
+            mfxF64 sum   = 0.0;
+            mfxU32 count = 0;
+            for (mfxU32 c = 0; c < numComp && c < n; c++) {
+                mfxU32 compW   = (n - c + numComp - 1) / numComp;
+                mfxU32 winW    = std::min<mfxU32>(SSIM_WINDOW, compW);
+                mfxU32 colsWin = GetNumWindows(compW);
+                mfxF64 numPix  = (mfxF64)winW * winH;
+
+                for (mfxU32 wx = 0; wx < colsWin; wx++) {
+                    mfxU64 sA = 0, sB = 0, sAA = 0, sBB = 0, sAB = 0;
+                    for (mfxU32 i = 0; i < winH; i++) {
+                        const mfxU16* pa = &bufA[(size_t)i * n + c + wx * SSIM_STEP * numComp];
+                        const mfxU16* pb = &bufB[(size_t)i * n + c + wx * SSIM_STEP * numComp];
+                        for (mfxU32 j = 0; j < winW; j++) {
+                            mfxU32 va = pa[j * numComp], vb = pb[j * numComp];
+                            sA += va;
+                            sB += vb;
+                            sAA += va * va;
+                            sBB += vb * vb;
+                            sAB += va * vb;
+                        }
+                    }
+                    mfxF64 muA  = sA / numPix;
+                    mfxF64 muB  = sB / numPix;
+                    mfxF64 varA = sAA / numPix - muA * muA;
+                    mfxF64 varB = sBB / numPix - muB * muB;
+                    mfxF64 cov  = sAB / numPix - muA * muB;
+                    sum += ((2 * muA * muB + c1) * (2 * cov + c2)) /
+                           ((muA * muA + muB * muB + c1) * (varA + varB + c2));
+                    count++;
+                }
+            }
+            rowSum[wy]   = sum;
+            rowCount[wy] = count;
+        }
+    });
+
+    mfxF64 sum   = 0.0;
+    mfxU64 count = 0;
+    for (mfxU32 wy = 0; wy < rowsWin; wy++) {
+        sum += rowSum[wy];
+        count += rowCount[wy];
+    }
+    return count ? sum / count : 1.0;
+}
+
+mfxStatus CQualityChecker::CompareDigest(const std::vector<mfxU32>& crc) {
+    if (m_bDigestEnded) {
+        m_numMismatches++;
+        return MFX_ERR_NONE;
+    }
+
+    char line[1024];
+    for (;;) {
+        if (!fgets(line, sizeof(line), m_fDigestIn)) {
+            printf("Quality check: digest stream ended at frame %u\n", m_numFrames - 1);
+            m_bDigestEnded = true;
+            m_numMismatches++;
+            return MFX_ERR_NONE;
+        }
+        if (line[0] != '#' && line[0] != '\n' && line[0] != '\r')
+            break;
+    }
+
+    char* pos = line;
+    strtoul(pos, &pos, 10); // frame number is informational
+    bool bMatch = true;
+    for (size_t i = 0; i < crc.size(); i++) {
+        char* next        = nullptr;
+        unsigned long ref = strtoul(pos, &next, 16);
+        bool bRead        = (next != pos);
+        pos               = next;
+        if (!bRead || (mfxU32)ref != crc[i]) {
+            if (bMatch && m_numMismatches < QUALITY_MAX_REPORTS) {
+                printf("Quality check: frame %u plane %s digest mismatch (expected %08x, got %08x)\n",
+                       m_numFrames - 1,
+                       m_planeStat[i].name.c_str(),
+                       bRead ? (mfxU32)ref : 0,
+                       crc[i]);
+            }
+            bMatch = false;
+        }
+    }
+    if (!bMatch)
+        m_numMismatches++;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CQualityChecker::CompareWithReference(const std::vector<sQualityPlane>& planes) {
+    if (m_bRefEnded)
+        return MFX_ERR_NONE;
+
+    size_t frameSize = 0;
+    for (auto& plane : planes)
+        frameSize += (size_t)plane.GetRowBytes() * plane.height;
+
+    m_refFrame.resize(frameSize);
+    if (fread(m_refFrame.data(), 1, frameSize, m_fRef) != frameSize) {
+        printf("Quality check: reference ended at frame %u\n", m_numFrames - 1);
+        m_bRefEnded = true;
+        return MFX_ERR_NONE;
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < planes.size(); i++) {
+        // reference planes are stored contiguously with samples already shifted down
+        sQualityPlane ref = planes[i];
+        ref.ptr           = m_refFrame.data() + offset;
+        ref.pitch         = ref.GetRowBytes();
+        ref.step          = 1;
+        ref.shift         = 0;
+        offset += (size_t)ref.pitch * ref.height;
+
+        mfxU64 numSamples = (mfxU64)GetCompsPerRow(ref) * ref.height;
+        mfxF64 psnr       = PSNR(PlaneSSE(planes[i], ref), numSamples, ref.bitDepth);
+        mfxF64 ssim       = PlaneSSIM(planes[i], ref);
+
+        sQualityPlaneStat& stat = m_planeStat[i];
+        stat.psnrSum += psnr;
+        stat.ssimSum += ssim;
+        stat.psnrMin = m_numCompared ? std::min(stat.psnrMin, psnr) : psnr;
+        stat.ssimMin = m_numCompared ? std::min(stat.ssimMin, ssim) : ssim;
+    }
+    m_numCompared++;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CQualityChecker::CheckFrame(const mfxFrameInfo& info, const mfxFrameData& data) {
+    MSDK_CHECK_ERROR(m_bInited, false, MFX_ERR_NOT_INITIALIZED);
+
+    std::vector<sQualityPlane> planes;
+    mfxStatus sts = GetPlanes(info, data, m_params.fileFourCC, planes);
+    MSDK_CHECK_STATUS(sts, "CQualityChecker::GetPlanes failed");
+
+    if (m_planeStat.size() != planes.size()) {
+        m_planeStat.resize(planes.size());
+        for (size_t i = 0; i < planes.size(); i++) {
+            m_planeStat[i]      = {};
+            m_planeStat[i].name = planes[i].name;
+        }
+    }
+
+    m_lastCRC.resize(planes.size());
+    for (size_t i = 0; i < planes.size(); i++)
+        m_lastCRC[i] = PlaneCRC(planes[i]);
+
+    m_numFrames++;
+
+    if (m_fDigestOut) {
+        fprintf(m_fDigestOut, "%u", m_numFrames - 1);
+        for (mfxU32 crc : m_lastCRC)
+            fprintf(m_fDigestOut, " %08x", crc);
+        fprintf(m_fDigestOut, "\n");
+    }
+
+    if (m_fDigestIn) {
+        sts = CompareDigest(m_lastCRC);
+        MSDK_CHECK_STATUS(sts, "CompareDigest failed");
+    }
+
+    if (m_fRef) {
+        sts = CompareWithReference(planes);
+        MSDK_CHECK_STATUS(sts, "CompareWithReference failed");
+    }
+
+    return MFX_ERR_NONE;
+}
+
+void CQualityChecker::PrintSummary(const char* prefix) const {
+    if (!prefix)
+        prefix = "";
+
+    printf("%sQuality check: %u frame(s)\n", prefix, m_numFrames);
+    if (m_numCompared) {
+        for (auto& stat : m_planeStat) {
+            printf("%s  %-4s PSNR avg %6.2f dB min %6.2f dB, SSIM avg %.4f min %.4f\n",
+                   prefix,
+                   stat.name.c_str(),
+                   stat.psnrSum / m_numCompared,
+                   stat.psnrMin,
+                   stat.ssimSum / m_numCompared,
+                   stat.ssimMin);
+        }
+        if (m_numCompared != m_numFrames)
+            printf("%s  %u frame(s) compared with the reference\n", prefix, m_numCompared);
+    }
+    if (!m_params.strDigestIn.empty())
+        printf("%s  digest: %u frame(s) mismatched\n", prefix, m_numMismatches);
+    if (!m_params.strDigestOut.empty())
+        printf("%s  digest written to %s\n", prefix, m_params.strDigestOut.c_str());
+}
@@ -0,0 +1,145 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "sample_thread_pool.h"
+
+#include <map>
+
+static mfxU32 GetDefaultNumThreads() {
+    mfxU32 numThreads = std::thread::hardware_concurrency();
+    return numThreads ? numThreads : 1;
+}
+
+CThreadPool::CThreadPool(mfxU32 numThreads)
+        : m_workers(),
+          m_mutex(),
+          m_wakeUp(),
+          m_done(),
+          m_pFunc(nullptr),
+          m_count(0),
+          m_grain(1),
+          m_next(0),
+          m_busyWorkers(0),
+          m_jobId(0),
+          m_bActive(false),
+          m_bStop(false),
+          m_submitMutex() {
+    if (!numThreads)
+        numThreads = GetDefaultNumThreads();
+
+    // calling thread takes part in every job
+    for (mfxU32 i = 1; i < numThreads; i++) {
+        m_workers.emplace_back(&CThreadPool::WorkerLoop, this);
+    }
+}
+
+CThreadPool::~CThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStop = true;
+    }
+    m_wakeUp.notify_all();
+
+    for (auto& worker : m_workers) {
+        if (worker.joinable())
+            worker.join();
+    }
+}
+
+std::shared_ptr<CThreadPool> CThreadPool::GetShared(mfxU32 numThreads) {
+    static std::mutex mutex;
+    static std::map<mfxU32, std::weak_ptr<CThreadPool>> pools;
+
+    if (!numThreads)
+        numThreads = GetDefaultNumThreads();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<CThreadPool> pool = pools[numThreads].lock();
+    if (!pool) {
+        pool              = std::make_shared<CThreadPool>(numThreads);
+        pools[numThreads] = pool;
+    }
+    return pool;
+}
+
+void CThreadPool::RunChunks() {
+    for (;;) {
+        mfxU32 begin = m_next.fetch_add(m_grain);
+        if (begin >= m_count)
+            break;
+        mfxU32 end = (m_count - begin > m_grain) ? begin + m_grain : m_count;
+        (*m_pFunc)(begin, end);
+    }
+}
+
+void CThreadPool::WorkerLoop() {
+    mfxU64 lastJob = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait(lock, [&] {
+                return m_bStop || (m_bActive && m_jobId != lastJob);
+            });
+            if (m_bStop)
+                return;
+            lastJob = m_jobId;
+            m_busyWorkers++;
+        }
+
+        RunChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busyWorkers--;
+        }
+        m_done.notify_one();
+    }
+}
+
+void CThreadPool::ParallelFor(mfxU32 count,
+                              const std::function<void(mfxU32 begin, mfxU32 end)>& func,
+                              mfxU32 grain) {
+    if (!count)
+        return;
+    if (!grain)
+        grain = 1;
+
+    // nothing to share - run inline and skip the wake-up round trip
+    if (m_workers.empty() || count <= grain) {
+        func(0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit(m_submitMutex);
+
+    // hand out roughly 4 chunks per thread to smooth out uneven tiles
+    mfxU32 chunk = count / (GetNumThreads() * 4);
+    if (chunk < grain)
+        chunk = grain;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pFunc = &func;
+        m_count = count;
+        m_grain = chunk;
+        m_next.store(0);
+        m_jobId++;
+        m_bActive = true;
+    }
+    m_wakeUp.notify_all();
+
+    RunChunks();
+
+    // wait for workers that already grabbed a chunk of this job
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] {
+        return m_busyWorkers == 0;
+    });
+    // workers which did not wake up in time must not join a finished job
+    m_bActive = false;
+    m_pFunc   = nullptr;
+}
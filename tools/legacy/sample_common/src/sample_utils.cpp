@@ -30,6 +30,7 @@
 #if defined(_WIN32) || defined(_WIN64)
 
     #include <DXGI.h>
+    #include <io.h>
     #include <psapi.h>
     #include <windows.h>
     #include <memory>
@@ -40,6 +41,7 @@
 #else
 
     #include <link.h>
+    #include <unistd.h>
     #include <string>
 
 #endif // #if defined(_WIN32) || defined(_WIN64)
@@ -549,6 +551,23 @@ mfxStatus CSmplBitstreamWriter::Reset() {
     return Init(m_sFile.c_str());
 }
 
+mfxStatus CSmplBitstreamWriter::Truncate(mfxU64 size) {
+    MSDK_CHECK_ERROR(m_bInited, false, MFX_ERR_NOT_INITIALIZED);
+
+    if (fflush(m_fSource))
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+#if defined(_WIN32) || defined(_WIN64)
+    if (_chsize_s(_fileno(m_fSource), (__int64)size) ||
+        _fseeki64(m_fSource, (__int64)size, SEEK_SET))
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+#else
+    if (ftruncate(fileno(m_fSource), (off_t)size) || fseeko(m_fSource, (off_t)size, SEEK_SET))
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+#endif
+
+    return MFX_ERR_NONE;
+}
+
 mfxStatus CSmplBitstreamWriter::WriteNextFrame(mfxBitstream* pMfxBitstream,
                                                bool isPrint,
                                                bool isCompleteFrame) {
@@ -680,6 +699,11 @@ mfxStatus CBitstreamWriterForParallelEncoding::Reset() {
     return MFX_ERR_NOT_IMPLEMENTED;
 }
 
+mfxStatus CBitstreamWriterForParallelEncoding::Truncate(mfxU64) {
+    // frames of all the encoders are interleaved in the file
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
 CSmplBitstreamDuplicateWriter::CSmplBitstreamDuplicateWriter() : CSmplBitstreamWriter() {
     m_fSourceDuplicate = NULL;
     m_bJoined          = false;
@@ -726,6 +750,11 @@ mfxStatus CSmplBitstreamDuplicateWriter::WriteNextFrame(mfxBitstream* pMfxBitstr
     return MFX_ERR_NONE;
 }
 
+mfxStatus CSmplBitstreamDuplicateWriter::Truncate(mfxU64) {
+    // the duplicate may be shared with another writer
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
 void CSmplBitstreamDuplicateWriter::Close() {
     if (m_fSourceDuplicate && !m_bJoined) {
         fclose(m_fSourceDuplicate);
@@ -737,6 +766,69 @@ void CSmplBitstreamDuplicateWriter::Close() {
     CSmplBitstreamWriter::Close();
 }
 
+BitstreamBufferPool::~BitstreamBufferPool() {
+    for (auto& sizeClass : m_free) {
+        for (mfxU8* pData : sizeClass.second) {
+            delete[] pData;
+        }
+    }
+}
+
+mfxU32 BitstreamBufferPool::GetClassSize(mfxU32 size) {
+    if (size <= MinClassSize)
+        return MinClassSize;
+
+    mfxU32 msb = 0;
+    while ((size - 1) >> (msb + 1))
+        msb++;
+
+    mfxU64 step = ((mfxU64)1 << msb) / 4;
+    mfxU64 cls  = ((size + step - 1) / step) * step;
+    return (mfxU32)std::min<mfxU64>(cls, 0xFFFFFFFF);
+}
+
+mfxU8* BitstreamBufferPool::Acquire(mfxU32 size, mfxU32* pCapacity) {
+    mfxU32 cls   = GetClassSize(size);
+    mfxU8* pData = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<mfxU8*>& freeList = m_free[cls];
+        if (!freeList.empty()) {
+            pData = freeList.back();
+            freeList.pop_back();
+            m_stat.Reuses++;
+        }
+        else {
+            m_stat.Allocations++;
+            m_stat.Resident += cls;
+            m_stat.PeakResident = std::max(m_stat.PeakResident, m_stat.Resident);
+        }
+        m_stat.InUse += cls;
+        m_stat.PeakInUse = std::max(m_stat.PeakInUse, m_stat.InUse);
+    }
+
+    if (!pData)
+        pData = new mfxU8[cls];
+
+    if (pCapacity)
+        *pCapacity = cls;
+    return pData;
+}
+
+void BitstreamBufferPool::Release(mfxU8* pData, mfxU32 capacity) {
+    if (!pData)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free[capacity].push_back(pData);
+    m_stat.InUse -= capacity;
+}
+
+BitstreamBufferPool::Statistics BitstreamBufferPool::GetStatistics() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stat;
+}
+
 CSmplBitstreamReader::CSmplBitstreamReader() {
     m_fSource = NULL;
     m_bInited = false;
@@ -967,6 +1059,11 @@ mfxStatus CIVFFrameWriter::Reset() {
     return MFX_ERR_NONE;
 }
 
+mfxStatus CIVFFrameWriter::Truncate(mfxU64) {
+    // the stream header counts the frames written
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
 mfxStatus CIVFFrameWriter::Init(const char* strFileName,
                                 const mfxU16 w,
                                 const mfxU16 h,
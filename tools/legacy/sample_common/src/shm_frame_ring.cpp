@@ -0,0 +1,599 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "shm_frame_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "sample_defs.h"
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <linux/futex.h>
+    #include <signal.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #include <atomic>
+    #include <chrono>
+    #include <climits>
+    #include <new>
+#endif
+
+// Bytes per pixel of the first plane and rows of the interleaved chroma plane per 2 rows of luma
+// (0 for packed formats)
+static bool GetFrameFormat(mfxU32 fourCC, mfxU32& bytesPerPixel, mfxU32& chromaRows) {
+    switch (fourCC) {
+        case MFX_FOURCC_NV12:
+            bytesPerPixel = 1;
+            chromaRows    = 1;
+            return true;
+        case MFX_FOURCC_NV16:
+            bytesPerPixel = 1;
+            chromaRows    = 2;
+            return true;
+        case MFX_FOURCC_P010:
+        case MFX_FOURCC_P016:
+            bytesPerPixel = 2;
+            chromaRows    = 1;
+            return true;
+        case MFX_FOURCC_P210:
+            bytesPerPixel = 2;
+            chromaRows    = 2;
+            return true;
+        case MFX_FOURCC_YUY2:
+            bytesPerPixel = 2;
+            chromaRows    = 0;
+            return true;
+        case MFX_FOURCC_Y210:
+        case MFX_FOURCC_Y216:
+        case MFX_FOURCC_RGB4:
+        case MFX_FOURCC_BGR4:
+        case MFX_FOURCC_AYUV:
+        case MFX_FOURCC_A2RGB10:
+        case MFX_FOURCC_Y410:
+            bytesPerPixel = 4;
+            chromaRows    = 0;
+            return true;
+        case MFX_FOURCC_Y416:
+            bytesPerPixel = 8;
+            chromaRows    = 0;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static mfxU32 GetChromaRows(mfxU32 height, mfxU32 chromaRows) {
+    return (chromaRows == 1) ? (height + 1) / 2 : height * chromaRows / 2;
+}
+
+// Layout of a frame in a slot, rows are rounded up to an even number of pixels for subsampling
+static void GetSlotLayout(mfxU32 width,
+                          mfxU32 height,
+                          mfxU32 bytesPerPixel,
+                          mfxU32 chromaRows,
+                          mfxU32& pitch,
+                          mfxU32& size) {
+    pitch = ((width + 1) & ~1) * bytesPerPixel;
+    size  = pitch * (height + GetChromaRows(height, chromaRows));
+}
+
+static std::string GetRingPath(const std::string& name) {
+    return (name.find('/') == std::string::npos) ? "/dev/shm/" + name : name;
+}
+
+CShmFrameRingWriter::CShmFrameRingWriter()
+        : m_params(),
+          m_path(),
+          m_pHeader(NULL),
+          m_size(0),
+          m_pAcquired(NULL),
+          m_bAttachWaited(false),
+          m_frameNumber(0),
+          m_written(0),
+          m_dropped(0),
+          m_blockTime(0) {}
+
+CShmFrameRingWriter::~CShmFrameRingWriter() {
+    Close();
+}
+
+mfxStatus CShmFrameRingWriter::Init(const ShmFrameRingParams& params) {
+    MSDK_CHECK_ERROR(params.Name.empty(), true, MFX_ERR_NOT_INITIALIZED);
+    Close();
+
+    m_params = params;
+    if (!m_params.Slots)
+        m_params.Slots = SHM_RING_DEFAULT_SLOTS;
+    if (!m_params.AttachTimeoutMs)
+        m_params.AttachTimeoutMs = SHM_RING_DEFAULT_ATTACH_TIMEOUT;
+    m_path        = GetRingPath(params.Name);
+    m_frameNumber = 0;
+    m_written     = 0;
+    m_dropped     = 0;
+    m_blockTime   = 0;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CShmFrameRingWriter::WriteFrame(mfxFrameSurface1* pSurface) {
+    MSDK_CHECK_POINTER(pSurface, MFX_ERR_NULL_PTR);
+
+    const mfxFrameInfo& info = pSurface->Info;
+    const mfxFrameData& data = pSurface->Data;
+    mfxU32 bytesPerPixel = 0, chromaRows = 0;
+    if (!GetFrameFormat(info.FourCC, bytesPerPixel, chromaRows)) {
+        printf("error: shared memory ring doesn't support FourCC %s\n",
+               ColorFormatToStr(info.FourCC));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    if (!IsCreated()) {
+        mfxU32 pitch = 0, slotSize = 0;
+        GetSlotLayout(info.Width, info.Height, bytesPerPixel, chromaRows, pitch, slotSize);
+        mfxStatus sts = Create(slotSize);
+        MSDK_CHECK_STATUS(sts, "Create failed");
+    }
+
+    mfxU32 width  = info.CropW ? info.CropW : info.Width;
+    mfxU32 height = info.CropH ? info.CropH : info.Height;
+    ShmFrameInfo frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.TimeStamp = data.TimeStamp;
+    frame.FourCC    = info.FourCC;
+    frame.Width     = width;
+    frame.Height    = height;
+    GetSlotLayout(width, height, bytesPerPixel, chromaRows, frame.Pitch, frame.DataSize);
+
+    if (frame.DataSize > GetSlotSize()) {
+        // the slots are sized by the first frame
+        printf("error: %ux%u frame doesn't fit the slots of the shared memory ring\n",
+               width,
+               height);
+        return MFX_ERR_NOT_ENOUGH_BUFFER;
+    }
+
+    const mfxU8* src = NULL;
+    switch (info.FourCC) {
+        case MFX_FOURCC_RGB4:
+        case MFX_FOURCC_BGR4:
+        case MFX_FOURCC_AYUV:
+            src = std::min({ data.R, data.G, data.B });
+            break;
+        case MFX_FOURCC_A2RGB10:
+            src = (const mfxU8*)data.A2RGB10;
+            break;
+        case MFX_FOURCC_Y410:
+            src = (const mfxU8*)data.Y410;
+            break;
+        case MFX_FOURCC_Y416:
+            src = (const mfxU8*)data.Y416;
+            break;
+        default:
+            src = data.Y;
+            break;
+    }
+    MSDK_CHECK_POINTER(src, MFX_ERR_NULL_PTR);
+    if (chromaRows)
+        MSDK_CHECK_POINTER(data.UV, MFX_ERR_NULL_PTR);
+
+    mfxU8* dst    = NULL;
+    mfxStatus sts = AcquireSlot(dst);
+    MSDK_CHECK_STATUS(sts, "AcquireSlot failed");
+    if (!dst)
+        return MFX_ERR_NONE;
+
+    mfxU32 cropX = info.CropX, cropY = info.CropY;
+    src += cropY * data.Pitch + cropX * bytesPerPixel;
+    for (mfxU32 i = 0; i < height; i++) {
+        memcpy(dst, src + i * data.Pitch, frame.Pitch);
+        dst += frame.Pitch;
+    }
+
+    if (chromaRows) {
+        src = data.UV + GetChromaRows(cropY, chromaRows) * data.Pitch +
+              (cropX & ~1) * bytesPerPixel;
+        for (mfxU32 i = 0; i < GetChromaRows(height, chromaRows); i++) {
+            memcpy(dst, src + i * data.Pitch, frame.Pitch);
+            dst += frame.Pitch;
+        }
+    }
+
+    return CommitSlot(frame);
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+
+    #define SHM_RING_MAGIC   MFX_MAKEFOURCC('F', 'R', 'N', 'G')
+    #define SHM_RING_VERSION 1
+    #define SHM_RING_PAGE    4096
+    // how often a waiting side checks that the other side is still alive
+    #define SHM_RING_POLL_MS 100
+
+// Start of the shared memory, followed by the slots. Indexes count the frames written to and
+// released from the ring, slot of index i is i % SlotCount. Each side sets its Waiting flag
+// before sleeping on its futex word, the other side bumps the word and wakes it only when the
+// flag is set, so frames pass without system calls while neither side waits.
+struct ShmRingHeader {
+    std::atomic<mfxU32> Magic; // set last by the producer once the ring is ready
+    mfxU32 Version;
+    mfxU32 SlotCount;
+    mfxU32 SlotSize; // bytes of frame data a slot holds
+    mfxU64 SlotStride;
+    mfxU32 Policy;
+    std::atomic<mfxI32> ProducerPid;
+
+    alignas(64) std::atomic<mfxU64> WriteIndex;
+    std::atomic<mfxU32> DataFutex;
+    std::atomic<mfxU32> ConsumerWaiting;
+    std::atomic<mfxU32> Closed;
+
+    alignas(64) std::atomic<mfxU64> ReadIndex;
+    std::atomic<mfxU32> SpaceFutex;
+    std::atomic<mfxU32> ProducerWaiting;
+    std::atomic<mfxI32> ConsumerPid;
+    std::atomic<mfxU32> ConsumerAttaches; // consumers that have opened the ring so far
+
+    alignas(64) std::atomic<mfxU64> Dropped;
+};
+
+static_assert(sizeof(ShmRingHeader) <= SHM_RING_PAGE, "ring header doesn't fit its page");
+static_assert(sizeof(ShmFrameInfo) == 64, "frame data follows the 64 byte slot header");
+static_assert(sizeof(std::atomic<mfxU32>) == sizeof(int), "futex words must be 32 bit");
+
+static mfxU8* GetSlotAt(ShmRingHeader* pHeader, mfxU64 index) {
+    return (mfxU8*)pHeader + SHM_RING_PAGE + (index % pHeader->SlotCount) * pHeader->SlotStride;
+}
+
+// Returns false if the wait timed out
+static bool FutexWait(std::atomic<mfxU32>* word, mfxU32 expected, mfxU32 timeoutMs) {
+    struct timespec timeout = { (time_t)(timeoutMs / 1000), (long)(timeoutMs % 1000) * 1000000 };
+    return syscall(SYS_futex, (int*)word, FUTEX_WAIT, expected, &timeout, NULL, 0) == 0 ||
+           errno != ETIMEDOUT;
+}
+
+static void FutexWake(std::atomic<mfxU32>* word) {
+    word->fetch_add(1);
+    syscall(SYS_futex, (int*)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static bool IsProcessAlive(mfxI32 pid) {
+    return pid && (kill(pid, 0) == 0 || errno != ESRCH);
+}
+
+static double SecondsSince(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// Whether path is a ring left behind by a producer that died without removing it
+static bool IsStaleRing(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void* ptr = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size >= SHM_RING_PAGE)
+        ptr = mmap(NULL, SHM_RING_PAGE, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+        return false;
+
+    const ShmRingHeader* pHeader = (const ShmRingHeader*)ptr;
+    bool bRing                   = pHeader->Magic.load() == SHM_RING_MAGIC;
+    mfxI32 producer              = pHeader->ProducerPid.load();
+    munmap(ptr, SHM_RING_PAGE);
+    return bRing && !IsProcessAlive(producer);
+}
+
+mfxStatus CShmFrameRingWriter::Create(mfxU32 slotSize) {
+    MSDK_CHECK_ERROR(m_path.empty(), true, MFX_ERR_NOT_INITIALIZED);
+    MSDK_CHECK_ERROR(IsCreated(), true, MFX_ERR_UNDEFINED_BEHAVIOR);
+
+    mfxU64 stride = MSDK_ALIGN((mfxU64)sizeof(ShmFrameInfo) + slotSize, SHM_RING_PAGE);
+    size_t size   = (size_t)(SHM_RING_PAGE + stride * m_params.Slots);
+
+    int fd = open(m_path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        // only a ring left behind by a producer that died is replaced, never other files
+        if (!IsStaleRing(m_path)) {
+            printf("error: %s exists and is not a ring left behind by a finished producer\n",
+                   m_path.c_str());
+            return MFX_ERR_UNSUPPORTED;
+        }
+        unlink(m_path.c_str());
+        fd = open(m_path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    }
+    if (fd < 0) {
+        printf("error: can't create shared memory %s: %s\n", m_path.c_str(), strerror(errno));
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+    void* ptr = MAP_FAILED;
+    if (ftruncate(fd, (off_t)size) == 0)
+        ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        printf("error: can't map %zu bytes of shared memory: %s\n", size, strerror(errno));
+        unlink(m_path.c_str());
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+
+    m_pHeader              = new (ptr) ShmRingHeader();
+    m_size                 = size;
+    m_pHeader->Version     = SHM_RING_VERSION;
+    m_pHeader->SlotCount   = m_params.Slots;
+    m_pHeader->SlotSize    = slotSize;
+    m_pHeader->SlotStride  = stride;
+    m_pHeader->Policy      = m_params.Policy;
+    m_pHeader->ProducerPid = (mfxI32)getpid();
+    m_pHeader->Magic.store(SHM_RING_MAGIC);
+    m_bAttachWaited = false;
+    return MFX_ERR_NONE;
+}
+
+mfxU32 CShmFrameRingWriter::GetSlotSize() const {
+    return m_pHeader ? m_pHeader->SlotSize : 0;
+}
+
+bool CShmFrameRingWriter::IsConsumerAttached() const {
+    return m_pHeader && IsProcessAlive(m_pHeader->ConsumerPid.load());
+}
+
+mfxStatus CShmFrameRingWriter::AcquireSlot(mfxU8*& data) {
+    data = NULL;
+    MSDK_CHECK_POINTER(m_pHeader, MFX_ERR_NOT_INITIALIZED);
+    ShmRingHeader& header = *m_pHeader;
+
+    mfxU64 writeIndex = header.WriteIndex.load(std::memory_order_relaxed);
+    if (writeIndex - header.ReadIndex.load() >= header.SlotCount) {
+        bool bDrop = m_params.Policy == SHM_RING_DROP;
+        // a consumer started together with the producer may open the ring after it filled up
+        bool bWaitAttach = !bDrop && !m_bAttachWaited && !header.ConsumerAttaches.load();
+        if (!bWaitAttach && !IsConsumerAttached())
+            bDrop = true;
+        if (!bDrop) {
+            auto start = std::chrono::steady_clock::now();
+            header.ProducerWaiting.store(1);
+            for (;;) {
+                mfxU32 space = header.SpaceFutex.load();
+                if (writeIndex - header.ReadIndex.load() < header.SlotCount)
+                    break;
+                if (FutexWait(&header.SpaceFutex, space, SHM_RING_POLL_MS) || IsConsumerAttached())
+                    continue;
+                if (!bWaitAttach || header.ConsumerAttaches.load() ||
+                    SecondsSince(start) * 1000 >= m_params.AttachTimeoutMs) {
+                    bDrop = true;
+                    break;
+                }
+            }
+            header.ProducerWaiting.store(0);
+            m_blockTime += SecondsSince(start);
+            if (bWaitAttach)
+                m_bAttachWaited = true;
+        }
+        if (bDrop) {
+            m_frameNumber++;
+            m_dropped++;
+            header.Dropped.fetch_add(1, std::memory_order_relaxed);
+            return MFX_ERR_NONE;
+        }
+    }
+
+    m_pAcquired = GetSlotAt(m_pHeader, writeIndex);
+    data        = m_pAcquired + sizeof(ShmFrameInfo);
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CShmFrameRingWriter::CommitSlot(const ShmFrameInfo& info) {
+    MSDK_CHECK_POINTER(m_pHeader, MFX_ERR_NOT_INITIALIZED);
+    MSDK_CHECK_POINTER(m_pAcquired, MFX_ERR_UNDEFINED_BEHAVIOR);
+    MSDK_CHECK_ERROR(info.DataSize > m_pHeader->SlotSize, true, MFX_ERR_NOT_ENOUGH_BUFFER);
+
+    ShmFrameInfo* pInfo = (ShmFrameInfo*)m_pAcquired;
+    *pInfo              = info;
+    pInfo->FrameNumber  = m_frameNumber++;
+    m_pAcquired         = NULL;
+
+    m_pHeader->WriteIndex.fetch_add(1);
+    m_written++;
+    if (m_pHeader->ConsumerWaiting.load())
+        FutexWake(&m_pHeader->DataFutex);
+    return MFX_ERR_NONE;
+}
+
+void CShmFrameRingWriter::Close() {
+    if (!m_pHeader)
+        return;
+
+    m_pHeader->Closed.store(1);
+    FutexWake(&m_pHeader->DataFutex);
+    munmap(m_pHeader, m_size);
+    // a consumer that has the ring mapped keeps reading it
+    unlink(m_path.c_str());
+
+    m_pHeader   = NULL;
+    m_size      = 0;
+    m_pAcquired = NULL;
+}
+
+CShmFrameRingReader::CShmFrameRingReader() : m_pHeader(NULL), m_size(0), m_bAcquired(false) {}
+
+CShmFrameRingReader::~CShmFrameRingReader() {
+    Close();
+}
+
+mfxStatus CShmFrameRingReader::Open(const std::string& name) {
+    MSDK_CHECK_ERROR(name.empty(), true, MFX_ERR_NOT_INITIALIZED);
+    Close();
+
+    std::string path = GetRingPath(name);
+    int fd           = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+        return MFX_ERR_NOT_FOUND;
+
+    struct stat st;
+    void* ptr = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= SHM_RING_PAGE)
+        ptr = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    // the producer has not sized the ring yet
+    if (ptr == MAP_FAILED)
+        return MFX_ERR_NOT_FOUND;
+
+    ShmRingHeader* pHeader = (ShmRingHeader*)ptr;
+    if (pHeader->Magic.load() != SHM_RING_MAGIC) {
+        munmap(ptr, (size_t)st.st_size);
+        return MFX_ERR_NOT_FOUND;
+    }
+    if (pHeader->Version != SHM_RING_VERSION || !pHeader->SlotCount ||
+        SHM_RING_PAGE + pHeader->SlotStride * pHeader->SlotCount > (mfxU64)st.st_size) {
+        printf("error: %s is not a frame ring of this version\n", path.c_str());
+        munmap(ptr, (size_t)st.st_size);
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    // take the place of a consumer that died without closing the ring
+    mfxI32 pid      = (mfxI32)getpid();
+    mfxI32 consumer = pHeader->ConsumerPid.load();
+    if ((consumer && IsProcessAlive(consumer)) ||
+        !pHeader->ConsumerPid.compare_exchange_strong(consumer, pid)) {
+        printf("error: %s already has a consumer\n", path.c_str());
+        munmap(ptr, (size_t)st.st_size);
+        return MFX_ERR_UNSUPPORTED;
+    }
+    // a producer may wait for the first consumer
+    pHeader->ConsumerAttaches.fetch_add(1);
+    if (pHeader->ProducerWaiting.load())
+        FutexWake(&pHeader->SpaceFutex);
+
+    m_pHeader = pHeader;
+    m_size    = (size_t)st.st_size;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CShmFrameRingReader::Acquire(const ShmFrameInfo*& info,
+                                       const mfxU8*& data,
+                                       mfxU32 timeoutMs) {
+    MSDK_CHECK_POINTER(m_pHeader, MFX_ERR_NOT_INITIALIZED);
+    MSDK_CHECK_ERROR(m_bAcquired, true, MFX_ERR_UNDEFINED_BEHAVIOR);
+    ShmRingHeader& header = *m_pHeader;
+
+    mfxU64 readIndex = header.ReadIndex.load(std::memory_order_relaxed);
+    if (readIndex == header.WriteIndex.load()) {
+        auto start = std::chrono::steady_clock::now();
+        header.ConsumerWaiting.store(1);
+        bool bProducerGone = false;
+        for (;;) {
+            mfxU32 published = header.DataFutex.load();
+            bool bFinished   = header.Closed.load() || bProducerGone;
+            if (readIndex != header.WriteIndex.load())
+                break;
+
+            double elapsedMs = SecondsSince(start) * 1000;
+            if (bFinished || elapsedMs >= timeoutMs) {
+                header.ConsumerWaiting.store(0);
+                return bFinished ? MFX_ERR_MORE_DATA : MFX_WRN_IN_EXECUTION;
+            }
+            mfxU32 waitMs = std::min((mfxU32)(timeoutMs - elapsedMs) + 1, (mfxU32)SHM_RING_POLL_MS);
+            if (!FutexWait(&header.DataFutex, published, waitMs))
+                bProducerGone = !IsProcessAlive(header.ProducerPid.load());
+        }
+        header.ConsumerWaiting.store(0);
+    }
+
+    mfxU8* slot = GetSlotAt(m_pHeader, readIndex);
+    info        = (const ShmFrameInfo*)slot;
+    data        = slot + sizeof(ShmFrameInfo);
+    m_bAcquired = true;
+    return MFX_ERR_NONE;
+}
+
+void CShmFrameRingReader::Release() {
+    if (!m_pHeader || !m_bAcquired)
+        return;
+
+    m_bAcquired = false;
+    m_pHeader->ReadIndex.fetch_add(1);
+    if (m_pHeader->ProducerWaiting.load())
+        FutexWake(&m_pHeader->SpaceFutex);
+}
+
+void CShmFrameRingReader::Close() {
+    if (!m_pHeader)
+        return;
+
+    mfxI32 pid = (mfxI32)getpid();
+    m_pHeader->ConsumerPid.compare_exchange_strong(pid, 0);
+    // a producer waiting for space drops frames from now on
+    FutexWake(&m_pHeader->SpaceFutex);
+    munmap(m_pHeader, m_size);
+
+    m_pHeader   = NULL;
+    m_size      = 0;
+    m_bAcquired = false;
+}
+
+mfxU64 CShmFrameRingReader::GetDropped() const {
+    return m_pHeader ? m_pHeader->Dropped.load(std::memory_order_relaxed) : 0;
+}
+
+mfxU32 CShmFrameRingReader::GetSlots() const {
+    return m_pHeader ? m_pHeader->SlotCount : 0;
+}
+
+#else // shared memory frame rings are available on Linux only
+
+mfxStatus CShmFrameRingWriter::Create(mfxU32) {
+    return MFX_ERR_UNSUPPORTED;
+}
+
+mfxU32 CShmFrameRingWriter::GetSlotSize() const {
+    return 0;
+}
+
+bool CShmFrameRingWriter::IsConsumerAttached() const {
+    return false;
+}
+
+mfxStatus CShmFrameRingWriter::AcquireSlot(mfxU8*& data) {
+    data = NULL;
+    return MFX_ERR_UNSUPPORTED;
+}
+
+mfxStatus CShmFrameRingWriter::CommitSlot(const ShmFrameInfo&) {
+    return MFX_ERR_UNSUPPORTED;
+}
+
+void CShmFrameRingWriter::Close() {}
+
+CShmFrameRingReader::CShmFrameRingReader() : m_pHeader(NULL), m_size(0), m_bAcquired(false) {}
+
+CShmFrameRingReader::~CShmFrameRingReader() {}
+
+mfxStatus CShmFrameRingReader::Open(const std::string&) {
+    return MFX_ERR_UNSUPPORTED;
+}
+
+mfxStatus CShmFrameRingReader::Acquire(const ShmFrameInfo*&, const mfxU8*&, mfxU32) {
+    return MFX_ERR_UNSUPPORTED;
+}
+
+void CShmFrameRingReader::Release() {}
+
+void CShmFrameRingReader::Close() {}
+
+mfxU64 CShmFrameRingReader::GetDropped() const {
+    return 0;
+}
+
+mfxU32 CShmFrameRingReader::GetSlots() const {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,157 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "stream_scheduler.h"
+
+#include <algorithm>
+
+static double SecondsBetween(std::chrono::steady_clock::time_point begin,
+                             std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<double>(end - begin).count();
+}
+
+CSurfaceBudget::CSurfaceBudget(mfxU32 surfaces)
+        : m_total(surfaces),
+          m_mutex(),
+          m_released(),
+          m_inUse(0),
+          m_peak(0) {}
+
+mfxStatus CSurfaceBudget::Acquire(mfxU32 count) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_total) {
+        if (count > m_total)
+            return MFX_ERR_MEMORY_ALLOC;
+        m_released.wait(lock, [&] {
+            return m_inUse + count <= m_total;
+        });
+    }
+    m_inUse += count;
+    m_peak = std::max(m_peak, m_inUse);
+    return MFX_ERR_NONE;
+}
+
+void CSurfaceBudget::ForceAcquire(mfxU32 count) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_inUse += count;
+    m_peak = std::max(m_peak, m_inUse);
+}
+
+void CSurfaceBudget::Release(mfxU32 count) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_inUse -= std::min(count, m_inUse);
+    }
+    m_released.notify_all();
+}
+
+mfxU32 CSurfaceBudget::GetPeak() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_peak;
+}
+
+CStreamScheduler::CStreamScheduler(mfxU32 numThreads)
+        : m_numThreads(numThreads),
+          m_streams(),
+          m_statistics(),
+          m_startTimes(),
+          m_runTime(0),
+          m_mutex(),
+          m_wakeUp(),
+          m_done(),
+          m_ready(),
+          m_running(0),
+          m_bStop(false) {
+    if (!m_numThreads)
+        m_numThreads = std::max(1u, std::thread::hardware_concurrency());
+}
+
+mfxStatus CStreamScheduler::Run(const std::vector<IScheduledStream*>& streams) {
+    m_streams = streams;
+    m_statistics.assign(streams.size(), ScheduledStreamStatistics());
+    m_startTimes.assign(streams.size(), TimePoint());
+    m_ready.clear();
+    m_running = 0;
+    m_bStop   = false;
+
+    TimePoint start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (mfxU32 i = 0; i < m_numThreads; i++)
+        workers.emplace_back(&CStreamScheduler::WorkerLoop, this);
+
+    for (size_t i = 0; i < m_streams.size(); i++) {
+        mfxStatus sts            = m_streams[i]->Start();
+        m_startTimes[i]          = std::chrono::steady_clock::now();
+        m_statistics[i].WaitTime = SecondsBetween(start, m_startTimes[i]);
+        if (sts < MFX_ERR_NONE) {
+            // whatever the stream took before it failed is given back
+            m_streams[i]->Finish();
+            m_statistics[i].Status = sts;
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ready.push_back(i);
+        m_running++;
+        m_wakeUp.notify_one();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [&] {
+            return !m_running;
+        });
+        m_bStop = true;
+    }
+    m_wakeUp.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+
+    m_runTime = SecondsBetween(start, std::chrono::steady_clock::now());
+
+    for (const auto& stat : m_statistics) {
+        if (stat.Status < MFX_ERR_NONE)
+            return stat.Status;
+    }
+    return MFX_ERR_NONE;
+}
+
+void CStreamScheduler::WorkerLoop() {
+    for (;;) {
+        size_t i = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait(lock, [&] {
+                return m_bStop || !m_ready.empty();
+            });
+            if (m_ready.empty())
+                return;
+            i = m_ready.front();
+            m_ready.pop_front();
+        }
+
+        // a stream is in the queue once, so only this thread touches it until it is put back
+        mfxStatus sts = m_streams[i]->Step();
+        m_statistics[i].Steps++;
+        if (sts >= MFX_ERR_NONE) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_ready.push_back(i);
+            continue;
+        }
+
+        if (sts == MFX_ERR_MORE_DATA)
+            sts = MFX_ERR_NONE;
+        mfxStatus finishSts = m_streams[i]->Finish();
+        if (sts == MFX_ERR_NONE && finishSts < MFX_ERR_NONE)
+            sts = finishSts;
+        m_statistics[i].Status  = sts;
+        m_statistics[i].RunTime = SecondsBetween(m_startTimes[i], std::chrono::steady_clock::now());
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!--m_running)
+            m_done.notify_all();
+    }
+}
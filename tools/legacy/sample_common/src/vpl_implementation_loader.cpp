@@ -530,8 +530,13 @@ void VPLImplementationLoader::SetMinVersion(mfxVersion const& version) {
     m_MinVersion = version;
 }
 
+mfxStatus VPLImplementationLoader::CreateSession(mfxSession* session) {
+    std::lock_guard<std::mutex> lock(m_CreateSessionMutex);
+    return MFXCreateSession(m_Loader, m_ImplIndex, session);
+}
+
 mfxStatus MainVideoSession::CreateSession(VPLImplementationLoader* Loader) {
-    return MFXCreateSession(Loader->GetLoader(), Loader->GetImplIndex(), &m_session);
+    return Loader->CreateSession(&m_session);
 }
 
 mfxStatus MainVideoSession::PrintLibInfo(VPLImplementationLoader* Loader) {
@@ -0,0 +1,893 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "frame_pacer.h"
+#include "gtest/gtest.h"
+#include "live_source.h"
+#include "sample_quality.h"
+#include "sample_thread_pool.h"
+#include "shm_frame_ring.h"
+#include "stream_scheduler.h"
+#include "vm/time_defs.h"
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+#define EXPECT_CONTAINS(ACTUAL, EXPECTED) EXPECT_TRUE(ACTUAL.find(EXPECTED) != ACTUAL.npos);
+
+static void write_file(const char* name, const std::string& content) {
+    std::ofstream file(name, std::ios::binary | std::ios::trunc);
+    file << content;
+}
+
+TEST(Common_FramePacer, DeadlinesAreExact) {
+    // 30000/1001 fps: 1001 s for every 30000 frames, however long the stream
+    EXPECT_EQ(FramePacer::GetDeadlineOffset(1, 30000, 1001), 33366666u);
+    EXPECT_EQ(FramePacer::GetDeadlineOffset(30000, 30000, 1001), 1001000000000u);
+    EXPECT_EQ(FramePacer::GetDeadlineOffset(30000ull * 86400, 30000, 1001),
+              1001000000000ull * 86400);
+    // no overflow with the largest rates
+    EXPECT_EQ(FramePacer::GetDeadlineOffset(3, 0xFFFFFFFF, 0xFFFFFFFF), 3000000000u);
+    EXPECT_EQ(FramePacer::GetDeadlineOffset(2ull * 0xFFFFFFFF + 5, 0xFFFFFFFF, 1), 2000000001u);
+}
+
+// Processes numFrames frames taking 0.5 to 2.5 ms each and limits them with limit, returns the
+// time between the first and the last frame in seconds
+static double pace_frames(int numFrames, const std::function<void()>& limit) {
+    std::chrono::steady_clock::time_point first;
+    for (int frame = 0; frame < numFrames; frame++) {
+        std::this_thread::sleep_for(std::chrono::microseconds(500 + 1000 * (frame % 3)));
+        limit();
+        if (!frame)
+            first = std::chrono::steady_clock::now();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - first).count();
+}
+
+// Frames released at absolute deadlines keep the rate, sleeping for the rest of the period of a
+// frame as the former limiter did loses the wake-up latency of every frame
+TEST(Common_FramePacer, HoldsFractionalRate) {
+    const int numFrames = 90;
+    const double rate   = 500. / 3;
+
+    FramePacer pacer;
+    pacer.Reset(500, 3);
+    double paced = pace_frames(numFrames, [&pacer]() {
+        pacer.Work();
+    });
+
+    msdk_tick period = msdk_time_get_frequency() * 3 / 500, start = 0;
+    double relative  = pace_frames(numFrames, [period, &start]() {
+        msdk_tick now = msdk_time_get_tick();
+        while (start && start + period > now) {
+            MSDK_SLEEP((mfxU32)((start + period - now) * 1000 / msdk_time_get_frequency()));
+            now = msdk_time_get_tick();
+        }
+        start = msdk_time_get_tick();
+    });
+
+    FramePacerStatistics stat = pacer.GetStatistics();
+    printf("[ BENCHMARK] target %.3f fps: relative sleep %.3f fps, absolute deadlines %.3f fps, "
+           "lateness p50 %u us, p99 %u us, max %u us\n",
+           rate,
+           (numFrames - 1) / relative,
+           (numFrames - 1) / paced,
+           stat.LatenessP50,
+           stat.LatenessP99,
+           stat.LatenessMax);
+
+    EXPECT_EQ(stat.Frames, (mfxU64)numFrames);
+    EXPECT_NEAR(stat.TargetRate, rate, 1e-9);
+    EXPECT_GE(paced, (numFrames - 1) / rate);
+    // only the lateness of the last frame adds up
+    EXPECT_LT(paced, (numFrames - 1) / rate + 0.005);
+    EXPECT_NEAR(stat.AchievedRate, rate, rate * 0.01);
+    EXPECT_LE(stat.LatenessP50, stat.LatenessP99);
+    EXPECT_LE(stat.LatenessP99, stat.LatenessMax);
+    EXPECT_EQ(stat.Resyncs, 0u);
+}
+
+TEST(Common_FramePacer, SharedTimerPacesSeveralStreams) {
+    const int numFrames     = 40;
+    const mfxU32 rates[][2] = { { 200, 1 }, { 100, 1 }, { 250, 2 }, { 60000, 1001 } };
+
+    // with and without polling the clock before the deadlines
+    for (mfxU32 spinTail : { 0, 100 }) {
+        auto timer = std::make_shared<FramePacerTimer>(spinTail);
+
+        std::vector<double> time(4);
+        std::vector<FramePacer> pacers(4);
+        std::vector<std::thread> streams;
+        for (size_t i = 0; i < pacers.size(); i++) {
+            pacers[i].Reset(rates[i][0], rates[i][1]);
+            pacers[i].SetTimer(timer);
+            streams.emplace_back([&pacers, &time, i]() {
+                time[i] = pace_frames(numFrames, [&pacers, i]() {
+                    pacers[i].Work();
+                });
+            });
+        }
+        for (auto& stream : streams)
+            stream.join();
+
+        for (size_t i = 0; i < pacers.size(); i++) {
+            double rate = (double)rates[i][0] / rates[i][1];
+            EXPECT_GE(time[i], (numFrames - 1) / rate) << i << " spin " << spinTail;
+            EXPECT_LT(time[i], (numFrames - 1) / rate + 0.005) << i << " spin " << spinTail;
+            EXPECT_NEAR(pacers[i].GetStatistics().AchievedRate, rate, rate * 0.02)
+                << i << " spin " << spinTail;
+        }
+    }
+}
+
+TEST(Common_FramePacer, ResyncsAfterStall) {
+    FramePacer pacer;
+    pacer.Reset(100);
+    pacer.Work();
+    pacer.Work();
+    // more than a second behind: the frames missed are not released in a burst
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    pacer.Work();
+    auto start = std::chrono::steady_clock::now();
+    pacer.Work();
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(9));
+    EXPECT_EQ(pacer.GetStatistics().Resyncs, 1u);
+
+    pacer.Reset(0);
+    start = std::chrono::steady_clock::now();
+    pacer.Work();
+    pacer.Work();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(5));
+    EXPECT_EQ(pacer.GetStatistics().Frames, 0u);
+}
+
+TEST(Common_LiveSource, ArrivalSchedule) {
+    LiveSourceParams params;
+    params.RateN         = 100;
+    params.BurstInterval = 10;
+    params.BurstLength   = 3;
+    CLiveSource source(params);
+    // frames 0-2 and 10-12 come with frames 2 and 12
+    EXPECT_EQ(source.GetArrivalOffset(0), 20000000u);
+    EXPECT_EQ(source.GetArrivalOffset(2), 20000000u);
+    EXPECT_EQ(source.GetArrivalOffset(3), 30000000u);
+    EXPECT_EQ(source.GetArrivalOffset(10), 120000000u);
+    EXPECT_EQ(source.GetArrivalOffset(13), 130000000u);
+    EXPECT_EQ(source.GetStatistics().DeadlineMs, 20u);
+
+    params.BurstLength = 0;
+    params.JitterUs    = 300;
+    CLiveSource jittered(params), same(params);
+    bool anyJitter = false;
+    for (mfxU64 n = 0; n < 100; n++) {
+        mfxU64 nominal = n * 10000000;
+        EXPECT_GE(jittered.GetArrivalOffset(n), nominal);
+        EXPECT_LE(jittered.GetArrivalOffset(n), nominal + 300000);
+        EXPECT_EQ(jittered.GetArrivalOffset(n), same.GetArrivalOffset(n));
+        anyJitter = anyJitter || jittered.GetArrivalOffset(n) != nominal;
+    }
+    EXPECT_TRUE(anyJitter);
+}
+
+// Stands in for a frame reader of a file with numFrames access units
+class CountingFrameReader : public CSmplBitstreamReader {
+public:
+    explicit CountingFrameReader(mfxU32 numFrames) : m_numFrames(numFrames), m_read(0) {}
+
+    virtual mfxStatus ReadNextFrame(mfxBitstream*) {
+        if (m_read == m_numFrames)
+            return MFX_ERR_MORE_DATA;
+        m_read++;
+        return MFX_ERR_NONE;
+    }
+
+private:
+    mfxU32 m_numFrames;
+    mfxU32 m_read;
+};
+
+TEST(Common_LiveSource, ReaderReleasesFramesOnSchedule) {
+    LiveSourceParams params;
+    params.RateN = 200;
+    auto source  = std::make_shared<CLiveSource>(params);
+    CLiveBitstreamReader reader(std::make_unique<CountingFrameReader>(11), source);
+
+    mfxBitstream bs = {};
+    auto start      = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < 11; frame++) {
+        ASSERT_EQ(reader.ReadNextFrame(&bs), MFX_ERR_NONE);
+        source->OnFrameOutput();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    // the end of the file doesn't wait for a frame
+    EXPECT_EQ(reader.ReadNextFrame(&bs), MFX_ERR_MORE_DATA);
+
+    EXPECT_GE(elapsed, std::chrono::milliseconds(50));
+    EXPECT_LT(elapsed, std::chrono::milliseconds(100));
+    LiveSourceStatistics stat = source->GetStatistics();
+    EXPECT_EQ(stat.Frames, 11u);
+    EXPECT_EQ(stat.Outputs, 11u);
+    EXPECT_EQ(stat.DeadlineMiss, 0u);
+    EXPECT_EQ(stat.MaxQueueDepth, 1u);
+    EXPECT_LT(stat.LatencyMax, 10000u);
+}
+
+// A pipeline slower than the feed builds up a queue and misses its deadlines
+TEST(Common_LiveSource, SlowPipelineFallsBehind) {
+    LiveSourceParams params;
+    params.RateN      = 500;
+    params.DeadlineMs = 10;
+    CLiveSource source(params);
+
+    for (int frame = 0; frame < 20; frame++) {
+        source.WaitForNextFrame();
+        // 4 ms per frame against 2 ms between arrivals
+        std::this_thread::sleep_for(std::chrono::milliseconds(4));
+        source.OnFrameOutput();
+    }
+
+    LiveSourceStatistics stat = source.GetStatistics();
+    printf("[ BENCHMARK] live source at 500 fps, 4 ms per frame: %s\n", stat.ToString().c_str());
+    EXPECT_EQ(stat.Outputs, 20u);
+    EXPECT_GE(stat.MaxQueueDepth, 8u);
+    EXPECT_GT(stat.LatencyMax, 30000u);
+    EXPECT_GT(stat.DeadlineMiss, 10u);
+    EXPECT_LE(stat.LatencyP50, stat.LatencyP99);
+}
+
+// Stands in for a decoding stream: takes surfaces from the budget while it runs
+class FakeStream : public IScheduledStream {
+public:
+    FakeStream(CSurfaceBudget* budget, mfxU32 surfaces, mfxU32 steps, int stepUs = 0)
+            : m_budget(budget),
+              m_surfaces(surfaces),
+              m_steps(steps),
+              m_stepUs(stepUs),
+              m_done(0),
+              m_bStarted(false),
+              m_bFinished(false) {}
+
+    virtual mfxStatus Start() {
+        mfxStatus sts = m_budget ? m_budget->Acquire(m_surfaces) : MFX_ERR_NONE;
+        m_bStarted    = sts == MFX_ERR_NONE;
+        return sts;
+    }
+    virtual mfxStatus Step() {
+        if (m_stepUs)
+            std::this_thread::sleep_for(std::chrono::microseconds(m_stepUs));
+        return ++m_done < m_steps ? MFX_ERR_NONE : MFX_ERR_MORE_DATA;
+    }
+    virtual mfxStatus Finish() {
+        if (m_budget && m_bStarted)
+            m_budget->Release(m_surfaces);
+        m_bFinished = true;
+        return MFX_ERR_NONE;
+    }
+
+    mfxU32 GetDone() const {
+        return m_done;
+    }
+    bool IsFinished() const {
+        return m_bFinished;
+    }
+
+private:
+    CSurfaceBudget* m_budget;
+    mfxU32 m_surfaces;
+    mfxU32 m_steps;
+    int m_stepUs;
+    mfxU32 m_done;
+    bool m_bStarted;
+    bool m_bFinished;
+};
+
+TEST(Common_StreamScheduler, RunsStreamsToTheirEnd) {
+    std::vector<std::unique_ptr<FakeStream>> fakes;
+    std::vector<IScheduledStream*> streams;
+    for (mfxU32 i = 0; i < 7; i++) {
+        fakes.emplace_back(new FakeStream(nullptr, 0, 10 + i * 5));
+        streams.push_back(fakes.back().get());
+    }
+
+    CStreamScheduler scheduler(3);
+    EXPECT_EQ(scheduler.GetNumThreads(), 3u);
+    EXPECT_EQ(scheduler.Run(streams), MFX_ERR_NONE);
+
+    ASSERT_EQ(scheduler.GetStatistics().size(), 7u);
+    for (mfxU32 i = 0; i < 7; i++) {
+        EXPECT_EQ(fakes[i]->GetDone(), 10 + i * 5);
+        EXPECT_TRUE(fakes[i]->IsFinished());
+        EXPECT_EQ(scheduler.GetStatistics()[i].Steps, 10 + i * 5);
+        EXPECT_EQ(scheduler.GetStatistics()[i].Status, MFX_ERR_NONE);
+    }
+}
+
+// Streams that don't fit the budget wait for running streams to finish instead of holding workers
+TEST(Common_StreamScheduler, BudgetHoldsStreamsBack) {
+    CSurfaceBudget budget(20);
+    std::vector<std::unique_ptr<FakeStream>> fakes;
+    std::vector<IScheduledStream*> streams;
+    for (mfxU32 i = 0; i < 6; i++) {
+        fakes.emplace_back(new FakeStream(&budget, 8, 20, 500));
+        streams.push_back(fakes.back().get());
+    }
+    // a stream larger than the whole budget fails at once and the others go on
+    fakes.emplace_back(new FakeStream(&budget, 21, 1));
+    streams.push_back(fakes.back().get());
+
+    CStreamScheduler scheduler(1);
+    EXPECT_EQ(scheduler.Run(streams), MFX_ERR_MEMORY_ALLOC);
+
+    const auto& stat = scheduler.GetStatistics();
+    EXPECT_EQ(stat[6].Status, MFX_ERR_MEMORY_ALLOC);
+    EXPECT_EQ(fakes[6]->GetDone(), 0u);
+    for (mfxU32 i = 0; i < 6; i++) {
+        EXPECT_EQ(stat[i].Status, MFX_ERR_NONE);
+        EXPECT_EQ(fakes[i]->GetDone(), 20u);
+    }
+    // two streams fit at a time, so the third waits for one of them
+    EXPECT_EQ(budget.GetPeak(), 16u);
+    EXPECT_LT(stat[1].WaitTime, 0.005);
+    EXPECT_GT(stat[2].WaitTime, 0.005);
+    EXPECT_LE(stat[2].WaitTime, stat[4].WaitTime);
+}
+
+TEST(Common_StreamScheduler, ForcedSurfacesGoOverBudget) {
+    CSurfaceBudget budget(4);
+    EXPECT_EQ(budget.Acquire(3), MFX_ERR_NONE);
+    budget.ForceAcquire(3);
+    EXPECT_EQ(budget.GetPeak(), 6u);
+    budget.Release(6);
+    EXPECT_EQ(budget.Acquire(4), MFX_ERR_NONE);
+    budget.Release(4);
+
+    CSurfaceBudget unlimited(0);
+    EXPECT_EQ(unlimited.Acquire(1000), MFX_ERR_NONE);
+    EXPECT_EQ(unlimited.GetPeak(), 1000u);
+}
+
+// Runs many short streams on a few threads. Prints the scheduling cost per step. Disabled as it
+// only measures, run it with --gtest_also_run_disabled_tests.
+TEST(Common_StreamScheduler, DISABLED_SchedulingOverhead) {
+    std::vector<std::unique_ptr<FakeStream>> fakes;
+    std::vector<IScheduledStream*> streams;
+    for (mfxU32 i = 0; i < 64; i++) {
+        fakes.emplace_back(new FakeStream(nullptr, 0, 2000));
+        streams.push_back(fakes.back().get());
+    }
+
+    CStreamScheduler scheduler(4);
+    EXPECT_EQ(scheduler.Run(streams), MFX_ERR_NONE);
+    double steps = 64 * 2000.;
+    printf("[ BENCHMARK] 64 streams on 4 threads: %.0f steps in %.3f s, %.2f us per step\n",
+           steps,
+           scheduler.GetRunTime(),
+           scheduler.GetRunTime() * 1000000 / steps);
+}
+
+// NV12 frame in system memory with its luma and chroma planes one after another
+struct QualityTestFrame {
+    std::vector<mfxU8> buffer;
+    mfxFrameInfo info;
+    mfxFrameData data;
+
+    QualityTestFrame(mfxU16 width, mfxU16 height) : buffer(width * height * 3 / 2) {
+        memset(&info, 0, sizeof(info));
+        memset(&data, 0, sizeof(data));
+        info.FourCC = MFX_FOURCC_NV12;
+        info.Width  = width;
+        info.Height = height;
+        info.CropW  = width;
+        info.CropH  = height;
+        data.Pitch  = width;
+        data.Y      = buffer.data();
+        data.UV     = buffer.data() + width * height;
+        for (size_t i = 0; i < buffer.size(); i++)
+            buffer[i] = (mfxU8)((i * 31) ^ (i >> 5));
+    }
+};
+
+TEST(Common_QualityChecker, SharesThreadPools) {
+    std::shared_ptr<CThreadPool> a = CThreadPool::GetShared(3);
+    std::shared_ptr<CThreadPool> b = CThreadPool::GetShared(3);
+    std::shared_ptr<CThreadPool> c = CThreadPool::GetShared(2);
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a, c);
+    EXPECT_EQ(a->GetNumThreads(), 3u);
+    EXPECT_EQ(c->GetNumThreads(), 2u);
+
+    // the pool goes away with its last user
+    std::weak_ptr<CThreadPool> weak = a;
+    a.reset();
+    EXPECT_FALSE(weak.expired());
+    b.reset();
+    EXPECT_TRUE(weak.expired());
+}
+
+// Checkers of concurrent sessions share the pool and each gets the CRCs of its own frames
+TEST(Common_QualityChecker, ConcurrentCheckersAgree) {
+    QualityTestFrame frame(96, 80);
+    sQualityCheckParams params;
+    params.numThreads = 1;
+    CQualityChecker reference;
+    ASSERT_EQ(reference.Init(params), MFX_ERR_NONE);
+    ASSERT_EQ(reference.CheckFrame(frame.info, frame.data), MFX_ERR_NONE);
+    std::vector<mfxU32> expected = reference.GetLastCRC();
+    ASSERT_EQ(expected.size(), 2u);
+
+    params.numThreads = 3;
+    std::vector<std::vector<mfxU32>> crc(4);
+    std::vector<std::thread> sessions;
+    for (size_t i = 0; i < crc.size(); i++) {
+        sessions.emplace_back([&, i]() {
+            CQualityChecker checker;
+            if (checker.Init(params) != MFX_ERR_NONE)
+                return;
+            for (int n = 0; n < 20; n++) {
+                if (checker.CheckFrame(frame.info, frame.data) != MFX_ERR_NONE)
+                    return;
+            }
+            if (checker.GetFrameCount() == 20)
+                crc[i] = checker.GetLastCRC();
+        });
+    }
+    for (auto& session : sessions)
+        session.join();
+
+    for (size_t i = 0; i < crc.size(); i++)
+        EXPECT_EQ(crc[i], expected) << "session " << i;
+}
+
+TEST(Common_QualityChecker, ComparesWithReference) {
+    const char* ref = "common_quality_test.nv12";
+    QualityTestFrame frame(64, 48);
+    // the second reference frame differs in one luma sample
+    std::string content((const char*)frame.buffer.data(), frame.buffer.size());
+    content += content;
+    content[frame.buffer.size() + 100] ^= 0x20;
+    write_file(ref, content);
+
+    sQualityCheckParams params;
+    params.strRefFile = ref;
+    CQualityChecker checker;
+    ASSERT_EQ(checker.Init(params), MFX_ERR_NONE);
+    for (int n = 0; n < 3; n++)
+        EXPECT_EQ(checker.CheckFrame(frame.info, frame.data), MFX_ERR_NONE);
+
+    testing::internal::CaptureStdout();
+    checker.PrintSummary("");
+    std::string out = testing::internal::GetCapturedStdout();
+    checker.Close();
+    remove(ref);
+
+    // the reference ends after two frames
+    EXPECT_EQ(checker.GetFrameCount(), 3u);
+    EXPECT_EQ(checker.GetMismatchCount(), 0u);
+    const std::vector<sQualityPlaneStat>& stat = checker.GetPlaneStat();
+    ASSERT_EQ(stat.size(), 2u);
+    EXPECT_EQ(stat[0].name, "Y");
+    EXPECT_DOUBLE_EQ(stat[0].psnrMin, CQualityChecker::PSNR(0x20 * 0x20, 64 * 48, 8));
+    EXPECT_DOUBLE_EQ(stat[0].psnrSum, 100.0 + stat[0].psnrMin);
+    EXPECT_LT(stat[0].ssimMin, 1.0);
+    EXPECT_EQ(stat[1].name, "UV");
+    EXPECT_DOUBLE_EQ(stat[1].psnrSum, 200.0);
+    EXPECT_NEAR(stat[1].ssimMin, 1.0, 1e-9);
+    EXPECT_CONTAINS(out, "Quality check: 3 frame(s)");
+}
+
+TEST(Common_QualityChecker, NeedsInit) {
+    QualityTestFrame frame(16, 16);
+    CQualityChecker checker;
+    EXPECT_EQ(checker.CheckFrame(frame.info, frame.data), MFX_ERR_NOT_INITIALIZED);
+
+    ASSERT_EQ(checker.Init(sQualityCheckParams()), MFX_ERR_NONE);
+    frame.info.FourCC = MFX_FOURCC_P8;
+    EXPECT_EQ(checker.CheckFrame(frame.info, frame.data), MFX_ERR_UNSUPPORTED);
+
+    sQualityCheckParams params;
+    params.strRefFile = "no_such_reference.yuv";
+    EXPECT_NE(checker.Init(params), MFX_ERR_NONE);
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+// NV12 frame in system memory, pixels of frame i are (i + x + y) & 0xFF
+struct ShmTestFrame {
+    std::vector<mfxU8> buffer;
+    mfxFrameSurface1 surface;
+
+    ShmTestFrame(mfxU16 width, mfxU16 height, mfxU16 pitch) : buffer(pitch * height * 3 / 2) {
+        memset(&surface, 0, sizeof(surface));
+        surface.Info.FourCC = MFX_FOURCC_NV12;
+        surface.Info.Width  = width;
+        surface.Info.Height = height;
+        surface.Info.CropW  = width;
+        surface.Info.CropH  = height;
+        surface.Data.Pitch  = pitch;
+        surface.Data.Y      = buffer.data();
+        surface.Data.UV     = buffer.data() + pitch * height;
+    }
+
+    void Fill(mfxU32 i) {
+        mfxU32 rows = surface.Info.Height * 3 / 2;
+        for (mfxU32 y = 0; y < rows; y++)
+            for (mfxU32 x = 0; x < surface.Data.Pitch; x++)
+                buffer[y * surface.Data.Pitch + x] = (mfxU8)(i + x + y);
+        surface.Data.TimeStamp = i;
+    }
+};
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string shm_test_ring_name(const char* test) {
+    return std::string("common_test_") + test + "_" + std::to_string(getpid());
+}
+
+TEST(Common_ShmFrameRing, PassesFramesInPlace) {
+    ShmFrameRingParams params = {};
+    params.Name               = shm_test_ring_name("in_place");
+    params.Slots              = 3;
+    CShmFrameRingWriter writer;
+    ASSERT_EQ(writer.Init(params), MFX_ERR_NONE);
+
+    // the cropped area goes to the ring without the padding of the surface
+    ShmTestFrame frame(64, 32, 128);
+    frame.surface.Info.CropX = 4;
+    frame.surface.Info.CropY = 2;
+    frame.surface.Info.CropW = 48;
+    frame.surface.Info.CropH = 16;
+
+    CShmFrameRingReader reader;
+    EXPECT_EQ(reader.Open(params.Name), MFX_ERR_NOT_FOUND);
+    frame.Fill(0);
+    ASSERT_EQ(writer.WriteFrame(&frame.surface), MFX_ERR_NONE);
+    ASSERT_EQ(reader.Open(params.Name), MFX_ERR_NONE);
+    EXPECT_EQ(reader.GetSlots(), 3u);
+    CShmFrameRingReader second;
+    EXPECT_EQ(second.Open(params.Name), MFX_ERR_UNSUPPORTED);
+
+    frame.Fill(1);
+    ASSERT_EQ(writer.WriteFrame(&frame.surface), MFX_ERR_NONE);
+    writer.Close();
+
+    for (mfxU32 i = 0; i < 2; i++) {
+        const ShmFrameInfo* info = nullptr;
+        const mfxU8* data        = nullptr;
+        ASSERT_EQ(reader.Acquire(info, data, 1000), MFX_ERR_NONE);
+        EXPECT_EQ(info->FrameNumber, i);
+        EXPECT_EQ(info->TimeStamp, i);
+        EXPECT_EQ(info->FourCC, (mfxU32)MFX_FOURCC_NV12);
+        EXPECT_EQ(info->Width, 48u);
+        EXPECT_EQ(info->Height, 16u);
+        EXPECT_EQ(info->Pitch, 48u);
+        EXPECT_EQ(info->DataSize, 48u * 24);
+        // luma starts at (4, 2), chroma at (4, 1) of the UV plane at row 32 of the buffer
+        EXPECT_EQ(data[0], (mfxU8)(i + 4 + 2));
+        EXPECT_EQ(data[48 * 15 + 47], (mfxU8)(i + 51 + 17));
+        EXPECT_EQ(data[48 * 16], (mfxU8)(i + 4 + 33));
+        EXPECT_EQ(data[48 * 24 - 1], (mfxU8)(i + 51 + 40));
+        reader.Release();
+    }
+
+    // the ring is gone once its frames are read
+    const ShmFrameInfo* info = nullptr;
+    const mfxU8* data        = nullptr;
+    EXPECT_EQ(reader.Acquire(info, data, 1000), MFX_ERR_MORE_DATA);
+    EXPECT_EQ(writer.GetWritten(), 2u);
+    EXPECT_EQ(writer.GetDropped(), 0u);
+}
+
+TEST(Common_ShmFrameRing, BlockWaitsForConsumer) {
+    ShmFrameRingParams params = {};
+    params.Name               = shm_test_ring_name("block");
+    params.Slots              = 2;
+    CShmFrameRingWriter writer;
+    ASSERT_EQ(writer.Init(params), MFX_ERR_NONE);
+    ASSERT_EQ(writer.Create(64), MFX_ERR_NONE);
+
+    CShmFrameRingReader reader;
+    ASSERT_EQ(reader.Open(params.Name), MFX_ERR_NONE);
+    std::vector<mfxU64> received;
+    std::thread consumer([&] {
+        const ShmFrameInfo* info = nullptr;
+        const mfxU8* data        = nullptr;
+        while (reader.Acquire(info, data, 5000) == MFX_ERR_NONE) {
+            received.push_back(info->FrameNumber);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            reader.Release();
+        }
+    });
+
+    for (mfxU32 i = 0; i < 20; i++) {
+        mfxU8* slot = nullptr;
+        ASSERT_EQ(writer.AcquireSlot(slot), MFX_ERR_NONE);
+        ASSERT_NE(slot, nullptr);
+        ShmFrameInfo info = {};
+        info.DataSize     = 64;
+        ASSERT_EQ(writer.CommitSlot(info), MFX_ERR_NONE);
+    }
+    writer.Close();
+    consumer.join();
+
+    // the producer waited for the slow consumer instead of dropping frames
+    ASSERT_EQ(received.size(), 20u);
+    for (mfxU64 i = 0; i < received.size(); i++)
+        EXPECT_EQ(received[i], i);
+    EXPECT_EQ(writer.GetDropped(), 0u);
+    EXPECT_GT(writer.GetBlockTime(), 0.01);
+}
+
+TEST(Common_ShmFrameRing, DropLeavesGaps) {
+    ShmFrameRingParams params = {};
+    params.Name               = shm_test_ring_name("drop");
+    params.Slots              = 2;
+    params.Policy             = SHM_RING_DROP;
+    CShmFrameRingWriter writer;
+    ASSERT_EQ(writer.Init(params), MFX_ERR_NONE);
+    ASSERT_EQ(writer.Create(64), MFX_ERR_NONE);
+    CShmFrameRingReader reader;
+    ASSERT_EQ(reader.Open(params.Name), MFX_ERR_NONE);
+
+    auto write = [&]() {
+        mfxU8* slot = nullptr;
+        EXPECT_EQ(writer.AcquireSlot(slot), MFX_ERR_NONE);
+        if (slot) {
+            EXPECT_EQ(writer.CommitSlot(ShmFrameInfo()), MFX_ERR_NONE);
+        }
+        return slot != nullptr;
+    };
+    auto read = [&]() {
+        const ShmFrameInfo* info = nullptr;
+        const mfxU8* data        = nullptr;
+        EXPECT_EQ(reader.Acquire(info, data, 1000), MFX_ERR_NONE);
+        mfxU64 number = info ? info->FrameNumber : ~0ull;
+        reader.Release();
+        return number;
+    };
+
+    // frames 2-4 find the ring full
+    for (mfxU32 i = 0; i < 5; i++)
+        EXPECT_EQ(write(), i < 2);
+    EXPECT_EQ(read(), 0u);
+    EXPECT_TRUE(write());
+    EXPECT_EQ(read(), 1u);
+    EXPECT_EQ(read(), 5u);
+    EXPECT_EQ(writer.GetDropped(), 3u);
+    EXPECT_EQ(reader.GetDropped(), 3u);
+
+    // a blocking ring drops frames as well once its consumer is gone
+    reader.Close();
+    params.Policy = SHM_RING_BLOCK;
+    ASSERT_EQ(writer.Init(params), MFX_ERR_NONE);
+    ASSERT_EQ(writer.Create(64), MFX_ERR_NONE);
+    ASSERT_EQ(reader.Open(params.Name), MFX_ERR_NONE);
+    reader.Close();
+    for (mfxU32 i = 0; i < 4; i++)
+        EXPECT_EQ(write(), i < 2);
+    EXPECT_EQ(writer.GetDropped(), 2u);
+}
+
+TEST(Common_ShmFrameRing, BlockWaitsForFirstConsumer) {
+    ShmFrameRingParams params = {};
+    params.Name               = shm_test_ring_name("first_consumer");
+    params.Slots              = 2;
+    CShmFrameRingWriter writer;
+    ASSERT_EQ(writer.Init(params), MFX_ERR_NONE);
+    ASSERT_EQ(writer.Create(64), MFX_ERR_NONE);
+
+    auto write = [&]() {
+        mfxU8* slot = nullptr;
+        EXPECT_EQ(writer.AcquireSlot(slot), MFX_ERR_NONE);
+        if (slot) {
+            EXPECT_EQ(writer.CommitSlot(ShmFrameInfo()), MFX_ERR_NONE);
+        }
+        return slot != nullptr;
+    };
+
+    // the consumer comes after the ring filled up, as with "producer & consumer" in a shell
+    std::vector<mfxU64> received;
+    std::thread consumer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        CShmFrameRingReader reader;
+        ASSERT_EQ(reader.Open(params.Name), MFX_ERR_NONE);
+        const ShmFrameInfo* info = nullptr;
+        const mfxU8* data        = nullptr;
+        while (reader.Acquire(info, data, 5000) == MFX_ERR_NONE) {
+            received.push_back(info->FrameNumber);
+            reader.Release();
+        }
+    });
+    for (mfxU32 i = 0; i < 6; i++)
+        EXPECT_TRUE(write());
+    writer.Close();
+    consumer.join();
+
+    EXPECT_EQ(received, std::vector<mfxU64>({ 0, 1, 2, 3, 4, 5 }));
+    EXPECT_EQ(writer.GetDropped(), 0u);
+    EXPECT_GT(writer.GetBlockTime(), 0.1);
+
+    // without any consumer the producer gives up after AttachTimeoutMs and drops from then on
+    params.AttachTimeoutMs = 100;
+    ASSERT_EQ(writer.Init(params), MFX_ERR_NONE);
+    ASSERT_EQ(writer.Create(64), MFX_ERR_NONE);
+    for (mfxU32 i = 0; i < 5; i++)
+        EXPECT_EQ(write(), i < 2);
+    EXPECT_EQ(writer.GetDropped(), 3u);
+    EXPECT_GE(writer.GetBlockTime(), 0.09);
+    EXPECT_LT(writer.GetBlockTime(), 1.0);
+}
+
+TEST(Common_ShmFrameRing, CreateReplacesOnlyStaleRings) {
+    ShmFrameRingParams params = {};
+    params.Name               = "./" + shm_test_ring_name("create") + ".yuv";
+    CShmFrameRingWriter writer;
+    ASSERT_EQ(writer.Init(params), MFX_ERR_NONE);
+
+    // a file that is not a ring is left alone
+    write_file(params.Name.c_str(), std::string(8192, 'y'));
+    testing::internal::CaptureStdout();
+    EXPECT_EQ(writer.Create(64), MFX_ERR_UNSUPPORTED);
+    std::string out = testing::internal::GetCapturedStdout();
+    EXPECT_CONTAINS(out, "is not a ring left behind by a finished producer");
+    std::ifstream file(params.Name, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(content, std::string(8192, 'y'));
+    remove(params.Name.c_str());
+
+    // nor is the ring of a running producer
+    ASSERT_EQ(writer.Create(64), MFX_ERR_NONE);
+    CShmFrameRingWriter second;
+    ASSERT_EQ(second.Init(params), MFX_ERR_NONE);
+    testing::internal::CaptureStdout();
+    EXPECT_EQ(second.Create(64), MFX_ERR_UNSUPPORTED);
+    testing::internal::GetCapturedStdout();
+    writer.Close();
+
+    // the ring of a producer that died without closing it is replaced
+    pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        CShmFrameRingWriter dying;
+        _exit(dying.Init(params) == MFX_ERR_NONE && dying.Create(64) == MFX_ERR_NONE ? 0 : 1);
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    EXPECT_TRUE(std::ifstream(params.Name).good());
+    EXPECT_EQ(second.Create(64), MFX_ERR_NONE);
+    second.Close();
+    EXPECT_FALSE(std::ifstream(params.Name).good());
+}
+
+// Writes numFrames copies of frame to a consumer process, which reads one byte of every cache
+// line of each frame in place and checks frame numbers and sizes. Returns the time taken.
+static void ring_to_consumer(const std::string& name,
+                             ShmTestFrame& frame,
+                             mfxU32 numFrames,
+                             CShmFrameRingWriter& writer,
+                             double& time) {
+    const size_t frameSize = (size_t)frame.surface.Info.CropW * frame.surface.Info.CropH * 3 / 2;
+
+    ShmFrameRingParams params = {};
+    params.Name               = name;
+    ASSERT_EQ(writer.Init(params), MFX_ERR_NONE);
+    ASSERT_EQ(writer.WriteFrame(&frame.surface), MFX_ERR_NONE);
+
+    pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (!child) {
+        CShmFrameRingReader reader;
+        if (reader.Open(params.Name) != MFX_ERR_NONE)
+            _exit(2);
+        const ShmFrameInfo* info = nullptr;
+        const mfxU8* data        = nullptr;
+        mfxU32 frames = 0, sum = 0;
+        while (reader.Acquire(info, data, 10000) == MFX_ERR_NONE) {
+            if (info->FrameNumber != frames || info->DataSize != frameSize)
+                _exit(3);
+            for (size_t i = 0; i < info->DataSize; i += 64)
+                sum += data[i];
+            reader.Release();
+            frames++;
+        }
+        _exit(frames == numFrames + 1 && sum ? 0 : 4);
+    }
+
+    // frames are dropped until the consumer attaches
+    for (mfxU32 i = 0; i < 1000 && !writer.IsConsumerAttached(); i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_TRUE(writer.IsConsumerAttached());
+
+    auto start = std::chrono::steady_clock::now();
+    for (mfxU32 i = 0; i < numFrames; i++)
+        ASSERT_EQ(writer.WriteFrame(&frame.surface), MFX_ERR_NONE);
+    writer.Close();
+    int status = -1;
+    waitpid(child, &status, 0);
+    time = SecondsSince(start);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0) << "consumer status " << status;
+    EXPECT_EQ(writer.GetDropped(), 0u);
+}
+
+TEST(Common_ShmFrameRing, PassesFramesToAnotherProcess) {
+    ShmTestFrame frame(320, 240, 384);
+    frame.Fill(0);
+    CShmFrameRingWriter writer;
+    double time = 0;
+    ASSERT_NO_FATAL_FAILURE(
+        ring_to_consumer(shm_test_ring_name("process"), frame, 50, writer, time));
+}
+
+// Hands 1080p NV12 frames to a consumer process through the ring and through a pipe. Disabled as
+// it only measures, run it with --gtest_also_run_disabled_tests.
+TEST(Common_ShmFrameRing, DISABLED_Throughput) {
+    const mfxU32 numFrames = 200;
+    ShmTestFrame frame(1920, 1088, 1920);
+    frame.surface.Info.CropH = 1080;
+    frame.Fill(0);
+    const size_t frameSize = 1920 * 1080 * 3 / 2;
+
+    CShmFrameRingWriter writer;
+    double ringTime = 0;
+    ASSERT_NO_FATAL_FAILURE(
+        ring_to_consumer(shm_test_ring_name("throughput"), frame, numFrames, writer, ringTime));
+
+    // the same frames copied through a pipe, as consumers in other processes do without the ring
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (!child) {
+        close(fds[1]);
+        std::vector<mfxU8> buffer(frameSize);
+        size_t total = 0;
+        for (ssize_t n; (n = read(fds[0], buffer.data(), buffer.size())) > 0;)
+            total += (size_t)n;
+        _exit(total == frameSize * numFrames ? 0 : 4);
+    }
+    close(fds[0]);
+    std::vector<mfxU8> packed(frameSize);
+    auto start = std::chrono::steady_clock::now();
+    for (mfxU32 i = 0; i < numFrames; i++) {
+        memcpy(packed.data(), frame.buffer.data(), 1920 * 1080);
+        memcpy(packed.data() + 1920 * 1080, frame.surface.Data.UV, 1920 * 540);
+        for (size_t written = 0; written < frameSize;) {
+            ssize_t n = write(fds[1], packed.data() + written, frameSize - written);
+            ASSERT_GT(n, 0);
+            written += (size_t)n;
+        }
+    }
+    close(fds[1]);
+    int status = -1;
+    waitpid(child, &status, 0);
+    double pipeTime = SecondsSince(start);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0) << "pipe reader status " << status;
+
+    printf("[ BENCHMARK] %u 1080p NV12 frames to another process: ring %.0f fps (%.2f GB/s, "
+           "%.3f s blocked), pipe %.0f fps (%.2f GB/s)\n",
+           numFrames,
+           numFrames / ringTime,
+           numFrames * frameSize / ringTime / 1e9,
+           writer.GetBlockTime(),
+           numFrames / pipeTime,
+           numFrames * frameSize / pipeTime / 1e9);
+}
+#endif
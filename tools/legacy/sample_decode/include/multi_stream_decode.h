@@ -0,0 +1,76 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __MULTI_STREAM_DECODE_H__
+#define __MULTI_STREAM_DECODE_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pipeline_decode.h"
+#include "stream_scheduler.h"
+
+// State shared by the streams of the multi-stream mode
+struct DecodingStreamContext {
+    std::shared_ptr<VPLImplementationLoader> pLoader; // taken from the first stream to start
+    std::shared_ptr<CSurfaceBudget> pSurfaceBudget;
+};
+
+// One input of the multi-stream mode, decoded in steps by CStreamScheduler
+class CDecodingStream : public IScheduledStream {
+public:
+    CDecodingStream(const sInputParams& params, std::shared_ptr<DecodingStreamContext> context);
+
+    virtual mfxStatus Start();
+    virtual mfxStatus Step();
+    virtual mfxStatus Finish();
+
+    const std::string& GetFileName() const {
+        return m_fileName;
+    }
+    mfxU32 GetFrames() const {
+        return m_pipeline.m_output_count;
+    }
+    const CDurationHistogram& GetLatency() const {
+        return m_pipeline.GetLatency();
+    }
+
+protected:
+    CDecodingStream(const CDecodingStream&)            = delete;
+    CDecodingStream& operator=(const CDecodingStream&) = delete;
+
+private:
+    sInputParams m_params;
+    std::string m_fileName;
+    std::shared_ptr<DecodingStreamContext> m_pContext;
+    CDecodingPipeline m_pipeline;
+    mfxU64 m_prevResetBytesCount;
+};
+
+// Decodes several inputs in one process. The streams share the implementation loader, a budget
+// of surfaces and a pool of threads they take turns on.
+class CMultiStreamDecoder {
+public:
+    CMultiStreamDecoder();
+
+    // Creates nStreams streams (one per input if 0) cycling through strSrcFile and streamFiles
+    mfxStatus Init(const sInputParams& params);
+    mfxStatus Run();
+    // Prints fps and latency of every stream and of all of them
+    void PrintResults();
+
+protected:
+    CMultiStreamDecoder(const CMultiStreamDecoder&)            = delete;
+    CMultiStreamDecoder& operator=(const CMultiStreamDecoder&) = delete;
+
+private:
+    std::shared_ptr<DecodingStreamContext> m_pContext;
+    std::vector<std::unique_ptr<CDecodingStream>> m_streams;
+    std::unique_ptr<CStreamScheduler> m_pScheduler;
+};
+
+#endif //__MULTI_STREAM_DECODE_H__
@@ -15,14 +15,21 @@
     #include <dxva2api.h>
 #endif
 
+#include <ctime>
 #include <memory>
+#include <string>
+#include <thread>
 #include <vector>
 #include "decode_render.h"
+#include "frame_pacer.h"
 #include "hw_device.h"
 #include "mfx_buffering.h"
+#include "stream_scheduler.h"
 
 #include "base_allocator.h"
+#include "sample_quality.h"
 #include "sample_utils.h"
+#include "shm_frame_ring.h"
 #include "vpl_implementation_loader.h"
 
 #include "mfxplugin.h"
@@ -67,7 +74,8 @@ struct sInputParams {
     bool bLowLat; // low latency mode
     bool bCalLat; // latency calculation
     bool bUseFullColorRange; //whether to use full color range
-    mfxU16 nMaxFPS; // limits overall fps
+    mfxU32 nMaxFPS; // limits overall fps
+    mfxU32 nMaxFPSDenom; // denominator of a fractional nMaxFPS, 0 if the rate is whole
     mfxU32 nWallCell;
     mfxU32 nWallW; //number of windows located in each row
     mfxU32 nWallH; //number of windows located in each column
@@ -139,6 +147,14 @@ struct sInputParams {
     std::string m_decode_cfg;
     std::string m_vpp_cfg;
     std::string dump_file;
+    sQualityCheckParams qualityParams;
+
+    std::vector<std::string> streamFiles; // inputs after strSrcFile, decoded as separate streams
+    mfxU32 nStreams; // number of streams cycling through the inputs, 0 - one per input
+    mfxU32 nStreamThreads; // threads the streams take turns on, 0 - one per CPU
+    mfxU32 nSurfaceBudget; // surfaces all streams may hold at a time, 0 - unlimited
+    bool bMultiStream; // the pipeline is one of several streams, the caller reports results
+    ShmFrameRingParams shmRing; // -shm_ring, frames are handed to another process
 };
 
 struct CPipelineStatistics {
@@ -174,6 +190,11 @@ public:
 
     virtual mfxStatus Init(sInputParams* pParams);
     virtual mfxStatus RunDecoding();
+    // RunDecoding in steps, so that several pipelines can take turns on a pool of threads:
+    // StartDecoding, DecodeStep until it returns false, then FinishDecoding
+    virtual mfxStatus StartDecoding();
+    virtual bool DecodeStep();
+    virtual mfxStatus FinishDecoding();
     virtual void Close();
     virtual mfxStatus ResetDecoder(sInputParams* pParams);
     virtual mfxStatus ResetDevice();
@@ -181,10 +202,29 @@ public:
     void SetMultiView();
     virtual void PrintLibInfo();
     virtual void PrintStreamInfo();
+    // prints results of -verify_ref/-verify_digest/-dump_digest, fails on digest mismatch
+    virtual mfxStatus FinishQualityCheck();
     mfxU64 GetTotalBytesProcessed() {
         return totalBytesProcessed + m_mfxBS.DataOffset;
     }
 
+    // Several pipelines can share the implementation loader and a budget of surfaces. Both must
+    // be set before Init; a pipeline without a loader creates its own.
+    void SetLoader(std::shared_ptr<VPLImplementationLoader> loader) {
+        m_pLoader = loader;
+    }
+    std::shared_ptr<VPLImplementationLoader> GetLoader() {
+        return m_pLoader;
+    }
+    void SetSurfaceBudget(std::shared_ptr<CSurfaceBudget> budget) {
+        m_pSurfaceBudget = budget;
+    }
+    // Latency from the submission of a complete frame to its output, in microseconds. Measured
+    // with -low_latency, -calc_latency and for the streams of the multi-stream mode.
+    const CDurationHistogram& GetLatency() const {
+        return m_latency;
+    }
+
     inline void PrintDecodeErrorReport(mfxExtDecodeErrorReport* pDecodeErrorReport) {
         if (pDecodeErrorReport) {
             if (pDecodeErrorReport->ErrorTypes & MFX_ERROR_SPS)
@@ -232,6 +272,8 @@ protected: // functions
      */
     virtual mfxStatus SyncOutputSurface(mfxU32 wait);
     virtual mfxStatus DeliverOutput(mfxFrameSurface1* frame);
+    // writes and/or verifies a frame with mapped data
+    virtual mfxStatus WriteOutput(mfxFrameSurface1* frame);
     virtual void PrintPerFrameStat(bool force = false);
 
     virtual void DeliverLoop();
@@ -240,11 +282,16 @@ protected: // functions
 
 protected: // variables
     CSmplYUVWriter m_FileWriter;
+    bool m_bWriteFile; // -o is set, otherwise output is only verified
+    CQualityChecker m_qualityChecker;
+    bool m_bQualityCheck;
+    CShmFrameRingWriter m_shmRing;
+    bool m_bShmRing; // -shm_ring is set
     std::unique_ptr<CSmplBitstreamReader> m_FileReader;
     mfxBitstreamWrapper m_mfxBS; // contains encoded data
     mfxU64 totalBytesProcessed;
 
-    std::unique_ptr<VPLImplementationLoader> m_pLoader;
+    std::shared_ptr<VPLImplementationLoader> m_pLoader;
     MainVideoSession m_mfxSession;
     mfxIMPL m_impl;
     MFXVideoDECODE* m_pmfxDEC;
@@ -284,7 +331,7 @@ protected: // variables
     mfxU16 m_vppOutHeight;
 
     mfxU32 m_nTimeout; // enables timeout for video playback, measured in seconds
-    mfxU16 m_nMaxFps; // limit of fps, if isn't specified equal 0.
+    mfxU32 m_nMaxFps; // limit of fps rounded up, if isn't specified equal 0.
     mfxU32 m_nFrames; //limit number of output frames
 
     mfxU16 m_diMode;
@@ -292,8 +339,10 @@ protected: // variables
     bool m_bVppFullColorRange;
     bool m_bSoftRobustFlag;
     std::vector<msdk_tick> m_vLatency;
+    CDurationHistogram m_latency;
+    bool m_bMultiStream;
 
-    FPSLimiter m_fpsLimiter;
+    FramePacer m_framePacer;
 
     mfxExtVPPVideoSignalInfo m_VppVideoSignalInfo;
     std::vector<mfxExtBuffer*> m_VppSurfaceExtParams;
@@ -328,6 +377,16 @@ protected: // variables
 
     eAPIVersion m_verSessionInit;
 
+    std::shared_ptr<CSurfaceBudget> m_pSurfaceBudget;
+    mfxU32 m_nBudgetSurfaces; // surfaces taken from the budget
+
+    // state of the decoding loop between steps
+    mfxBitstream* m_pDecodeBitstream; // NULL once the input has ended
+    mfxStatus m_decodeSts;
+    bool m_bErrIncompatibleVideoParams;
+    time_t m_decodeStartTime;
+    std::thread m_deliverThread;
+
 private:
     CDecodingPipeline(const CDecodingPipeline&);
     void operator=(const CDecodingPipeline&);
@@ -0,0 +1,166 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "multi_stream_decode.h"
+
+static std::string LatencyToString(const CDurationHistogram& latency) {
+    // only streams read frame by frame measure their latency
+    if (!latency.GetSamples())
+        return "latency n/a";
+
+    char str[128];
+    snprintf(str,
+             sizeof(str),
+             "latency p50 %.2f ms, p99 %.2f ms, max %.2f ms",
+             latency.GetPercentile(50) / 1000.,
+             latency.GetPercentile(99) / 1000.,
+             latency.GetMax() / 1000.);
+    return str;
+}
+
+CDecodingStream::CDecodingStream(const sInputParams& params,
+                                 std::shared_ptr<DecodingStreamContext> context)
+        : m_params(params),
+          m_fileName(params.strSrcFile),
+          m_pContext(context),
+          m_pipeline(),
+          m_prevResetBytesCount(0xFFFFFFFFFFFFFFFF) {}
+
+mfxStatus CDecodingStream::Start() {
+    if (m_pContext->pLoader)
+        m_pipeline.SetLoader(m_pContext->pLoader);
+    m_pipeline.SetSurfaceBudget(m_pContext->pSurfaceBudget);
+
+    mfxStatus sts = m_pipeline.Init(&m_params);
+    if (!m_pContext->pLoader && m_pipeline.GetLoader()) {
+        m_pContext->pLoader = m_pipeline.GetLoader();
+        if (sts == MFX_ERR_NONE)
+            m_pipeline.PrintLibInfo();
+    }
+    MSDK_CHECK_STATUS(sts, "m_pipeline.Init failed");
+
+    return m_pipeline.StartDecoding();
+}
+
+mfxStatus CDecodingStream::Step() {
+    if (m_pipeline.DecodeStep())
+        return MFX_ERR_NONE;
+
+    mfxStatus sts = m_pipeline.FinishDecoding();
+    if (MFX_ERR_INCOMPATIBLE_VIDEO_PARAM == sts || MFX_ERR_DEVICE_LOST == sts ||
+        MFX_ERR_DEVICE_FAILED == sts) {
+        // the stream recovers the way a single stream does and goes on
+        if (m_prevResetBytesCount == m_pipeline.GetTotalBytesProcessed()) {
+            printf("\nERROR: %s: no input data was consumed since last reset\n",
+                   m_fileName.c_str());
+            return sts;
+        }
+        m_prevResetBytesCount = m_pipeline.GetTotalBytesProcessed();
+
+        if (MFX_ERR_INCOMPATIBLE_VIDEO_PARAM != sts) {
+            sts = m_pipeline.ResetDevice();
+            MSDK_CHECK_STATUS(sts, "m_pipeline.ResetDevice failed");
+        }
+        sts = m_pipeline.ResetDecoder(&m_params);
+        MSDK_CHECK_STATUS(sts, "m_pipeline.ResetDecoder failed");
+
+        return m_pipeline.StartDecoding();
+    }
+    MSDK_CHECK_STATUS(sts, "m_pipeline.FinishDecoding failed");
+
+    return MFX_ERR_MORE_DATA;
+}
+
+mfxStatus CDecodingStream::Finish() {
+    // gives the surfaces of the stream back to the budget for the streams waiting to start
+    m_pipeline.Close();
+    return MFX_ERR_NONE;
+}
+
+CMultiStreamDecoder::CMultiStreamDecoder() : m_pContext(), m_streams(), m_pScheduler() {}
+
+mfxStatus CMultiStreamDecoder::Init(const sInputParams& params) {
+    std::vector<std::string> files(1, params.strSrcFile);
+    files.insert(files.end(), params.streamFiles.begin(), params.streamFiles.end());
+    mfxU32 numStreams = params.nStreams ? params.nStreams : (mfxU32)files.size();
+
+    m_pContext                 = std::make_shared<DecodingStreamContext>();
+    m_pContext->pSurfaceBudget = std::make_shared<CSurfaceBudget>(params.nSurfaceBudget);
+
+    m_streams.clear();
+    for (mfxU32 i = 0; i < numStreams; i++) {
+        sInputParams streamParams = params;
+        streamParams.streamFiles.clear();
+        streamParams.bMultiStream = true;
+
+        const std::string& file = files[i % files.size()];
+        if (file.size() >= MSDK_MAX_FILENAME_LEN) {
+            printf("error: file name %s is too long\n", file.c_str());
+            return MFX_ERR_UNSUPPORTED;
+        }
+        snprintf(streamParams.strSrcFile, sizeof(streamParams.strSrcFile), "%s", file.c_str());
+
+        m_streams.emplace_back(new CDecodingStream(streamParams, m_pContext));
+    }
+
+    m_pScheduler.reset(new CStreamScheduler(params.nStreamThreads));
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CMultiStreamDecoder::Run() {
+    MSDK_CHECK_POINTER(m_pScheduler, MFX_ERR_NOT_INITIALIZED);
+
+    std::vector<IScheduledStream*> streams;
+    for (auto& stream : m_streams)
+        streams.push_back(stream.get());
+
+    return m_pScheduler->Run(streams);
+}
+
+void CMultiStreamDecoder::PrintResults() {
+    if (!m_pScheduler)
+        return;
+
+    const std::vector<ScheduledStreamStatistics>& statistics = m_pScheduler->GetStatistics();
+    CDurationHistogram latency;
+    mfxU64 frames = 0;
+
+    printf("\n");
+    for (size_t i = 0; i < m_streams.size() && i < statistics.size(); i++) {
+        const CDecodingStream& stream         = *m_streams[i];
+        const ScheduledStreamStatistics& stat = statistics[i];
+
+        printf("Stream %u (%s): ", (unsigned)i, stream.GetFileName().c_str());
+        if (stat.Status < MFX_ERR_NONE) {
+            printf("failed with %s\n", StatusToString(stat.Status));
+            continue;
+        }
+        printf("%u frames in %.3f s, %.2f fps, %s, started after %.3f s\n",
+               stream.GetFrames(),
+               stat.RunTime,
+               stat.RunTime > 0 ? stream.GetFrames() / stat.RunTime : 0.0,
+               LatencyToString(stream.GetLatency()).c_str(),
+               stat.WaitTime);
+
+        frames += stream.GetFrames();
+        latency.Add(stream.GetLatency());
+    }
+
+    double runTime               = m_pScheduler->GetRunTime();
+    const CSurfaceBudget& budget = *m_pContext->pSurfaceBudget;
+    printf("All %u streams: %llu frames in %.3f s, %.2f fps, %s\n",
+           (unsigned)m_streams.size(),
+           (unsigned long long)frames,
+           runTime,
+           runTime > 0 ? frames / runTime : 0.0,
+           LatencyToString(latency).c_str());
+    printf("%u threads, peak %u surfaces", m_pScheduler->GetNumThreads(), budget.GetPeak());
+    if (budget.GetTotal())
+        printf(" of a budget of %u", budget.GetTotal());
+    printf("\n");
+}
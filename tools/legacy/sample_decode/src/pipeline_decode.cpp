@@ -48,6 +48,11 @@
 
 CDecodingPipeline::CDecodingPipeline()
         : m_FileWriter(),
+          m_bWriteFile(false),
+          m_qualityChecker(),
+          m_bQualityCheck(false),
+          m_shmRing(),
+          m_bShmRing(false),
           m_FileReader(),
           m_mfxBS(8 * 1024 * 1024),
           totalBytesProcessed(0),
@@ -91,7 +96,9 @@ CDecodingPipeline::CDecodingPipeline()
           m_bVppFullColorRange(false),
           m_bSoftRobustFlag(false),
           m_vLatency(),
-          m_fpsLimiter(),
+          m_latency(),
+          m_bMultiStream(false),
+          m_framePacer(),
           m_VppVideoSignalInfo({}),
           m_VppSurfaceExtParams(),
           m_ContentLight({}),
@@ -121,7 +128,14 @@ CDecodingPipeline::CDecodingPipeline()
 #endif
           m_bResetFileWriter(false),
           m_bResetFileReader(false),
-          m_verSessionInit(API_2X) {
+          m_verSessionInit(API_2X),
+          m_pSurfaceBudget(),
+          m_nBudgetSurfaces(0),
+          m_pDecodeBitstream(NULL),
+          m_decodeSts(MFX_ERR_NONE),
+          m_bErrIncompatibleVideoParams(false),
+          m_decodeStartTime(0),
+          m_deliverThread() {
     // reserve some space to reduce dynamic reallocation impact on pipeline execution
     m_vLatency.reserve(1000);
     m_VppVideoSignalInfo.Header.BufferId = MFX_EXTBUFF_VPP_VIDEO_SIGNAL_INFO;
@@ -268,30 +282,38 @@ mfxStatus CDecodingPipeline::Init(sInputParams* pParams) {
 
     mfxStatus sts = MFX_ERR_NONE;
 
+    m_bMultiStream = pParams->bMultiStream;
+
     // prepare input stream file reader
     // for VP8 complete and single frame reader is a requirement
     // create reader that supports completeframe mode for latency oriented scenarios
-    if (pParams->bLowLat || pParams->bCalLat) {
+    // streams of the multi-stream mode report their latency, per-frame latency isn't printed
+    if (pParams->bLowLat || pParams->bCalLat || m_bMultiStream) {
         switch (pParams->videoType) {
             case MFX_CODEC_AVC:
                 m_FileReader.reset(new CH264FrameReader());
                 m_bIsCompleteFrame = true;
-                m_bPrintLatency    = pParams->bCalLat;
+                m_bPrintLatency    = pParams->bCalLat && !m_bMultiStream;
                 break;
             case MFX_CODEC_JPEG:
                 m_FileReader.reset(new CJPEGFrameReader());
                 m_bIsCompleteFrame = true;
-                m_bPrintLatency    = pParams->bCalLat;
+                m_bPrintLatency    = pParams->bCalLat && !m_bMultiStream;
                 break;
             case MFX_CODEC_VP8:
             case MFX_CODEC_VP9:
             case MFX_CODEC_AV1:
                 m_FileReader.reset(new CIVFFrameReader());
                 m_bIsCompleteFrame = true;
-                m_bPrintLatency    = pParams->bCalLat;
+                m_bPrintLatency    = pParams->bCalLat && !m_bMultiStream;
                 break;
             default:
-                return MFX_ERR_UNSUPPORTED; // latency mode is supported only for H.264 and JPEG codecs
+                // latency mode is supported only for H.264 and JPEG codecs
+                if (!m_bMultiStream)
+                    return MFX_ERR_UNSUPPORTED;
+                // other streams are read in chunks, their latency isn't measured
+                m_FileReader.reset(new CSmplBitstreamReader());
+                break;
         }
     }
     else {
@@ -349,7 +371,9 @@ mfxStatus CDecodingPipeline::Init(sInputParams* pParams) {
         }
     }
 
-    m_nMaxFps = pParams->nMaxFPS;
+    m_nMaxFps = pParams->nMaxFPSDenom
+                    ? (pParams->nMaxFPS + pParams->nMaxFPSDenom - 1) / pParams->nMaxFPSDenom
+                    : pParams->nMaxFPS;
     m_nFrames = pParams->nFrames ? pParams->nFrames : MFX_INFINITE;
 
     m_bOutI420 = pParams->outI420;
@@ -424,28 +448,32 @@ mfxStatus CDecodingPipeline::Init(sInputParams* pParams) {
     else {
         initPar.Implementation = pParams->bUseHWLib ? MFX_IMPL_HARDWARE : MFX_IMPL_SOFTWARE;
 
-        m_pLoader.reset(new VPLImplementationLoader);
+        // streams of the multi-stream mode share the loader of the first one
+        bool bOwnLoader = !m_pLoader;
+        if (bOwnLoader) {
+            m_pLoader.reset(new VPLImplementationLoader);
 
-        if (pParams->dGfxIdx >= 0)
-            m_pLoader->SetDiscreteAdapterIndex(pParams->dGfxIdx);
-        else
-            m_pLoader->SetAdapterType(pParams->adapterType);
+            if (pParams->dGfxIdx >= 0)
+                m_pLoader->SetDiscreteAdapterIndex(pParams->dGfxIdx);
+            else
+                m_pLoader->SetAdapterType(pParams->adapterType);
 
-        if (pParams->adapterNum >= 0)
-            m_pLoader->SetAdapterNum(pParams->adapterNum);
+            if (pParams->adapterNum >= 0)
+                m_pLoader->SetAdapterNum(pParams->adapterNum);
 
-        if (pParams->PCIDeviceSetup)
-            m_pLoader->SetPCIDevice(pParams->PCIDomain,
-                                    pParams->PCIBus,
-                                    pParams->PCIDevice,
-                                    pParams->PCIFunction);
+            if (pParams->PCIDeviceSetup)
+                m_pLoader->SetPCIDevice(pParams->PCIDomain,
+                                        pParams->PCIBus,
+                                        pParams->PCIDevice,
+                                        pParams->PCIFunction);
 
 #if (defined(_WIN64) || defined(_WIN32))
-        if (pParams->luid.HighPart > 0 || pParams->luid.LowPart)
-            m_pLoader->SetupLUID(pParams->luid);
+            if (pParams->luid.HighPart > 0 || pParams->luid.LowPart)
+                m_pLoader->SetupLUID(pParams->luid);
 #else
-        m_pLoader->SetupDRMRenderNodeNum(pParams->DRMRenderNodeNum);
+            m_pLoader->SetupDRMRenderNodeNum(pParams->DRMRenderNodeNum);
 #endif
+        }
 
         if (!pParams->accelerationMode && pParams->bUseHWLib) {
 #if D3D_SURFACES_SUPPORT
@@ -455,12 +483,14 @@ mfxStatus CDecodingPipeline::Init(sInputParams* pParams) {
 #endif
         }
 
-        bool bLowLatencyMode = !pParams->dispFullSearch;
+        if (bOwnLoader) {
+            bool bLowLatencyMode = !pParams->dispFullSearch;
 
-        sts = m_pLoader->ConfigureAndEnumImplementations(initPar.Implementation,
-                                                         pParams->accelerationMode,
-                                                         bLowLatencyMode);
-        MSDK_CHECK_STATUS(sts, "m_mfxSession.EnumImplementations failed");
+            sts = m_pLoader->ConfigureAndEnumImplementations(initPar.Implementation,
+                                                             pParams->accelerationMode,
+                                                             bLowLatencyMode);
+            MSDK_CHECK_STATUS(sts, "m_mfxSession.EnumImplementations failed");
+        }
 
         sts = m_mfxSession.CreateSession(m_pLoader.get());
         MSDK_CHECK_STATUS(sts, "m_mfxSession.CreateSession failed");
@@ -542,7 +572,7 @@ mfxStatus CDecodingPipeline::Init(sInputParams* pParams) {
 #endif
     }
 
-    m_fpsLimiter.Reset(pParams->nMaxFPS);
+    m_framePacer.Reset(pParams->nMaxFPS, pParams->nMaxFPSDenom);
 
     // create decoder
     m_pmfxDEC = new MFXVideoDECODE(m_mfxSession);
@@ -564,9 +594,26 @@ mfxStatus CDecodingPipeline::Init(sInputParams* pParams) {
     }
 
     if (m_eWorkMode == MODE_FILE_DUMP) {
-        // prepare YUV file writer
-        sts = m_FileWriter.Init(pParams->strDstFile, pParams->numViews);
-        MSDK_CHECK_STATUS(sts, "m_FileWriter.Init failed");
+        // prepare YUV file writer, output may be verified without writing it
+        m_bWriteFile = (0 != strlen(pParams->strDstFile));
+        if (m_bWriteFile) {
+            sts = m_FileWriter.Init(pParams->strDstFile, pParams->numViews);
+            MSDK_CHECK_STATUS(sts, "m_FileWriter.Init failed");
+        }
+
+        m_bQualityCheck = pParams->qualityParams.IsEnabled();
+        if (m_bQualityCheck) {
+            sQualityCheckParams qualityParams = pParams->qualityParams;
+            qualityParams.fileFourCC          = m_bOutI420 ? MFX_FOURCC_I420 : 0;
+            sts                               = m_qualityChecker.Init(qualityParams);
+            MSDK_CHECK_STATUS(sts, "m_qualityChecker.Init failed");
+        }
+
+        m_bShmRing = !pParams->shmRing.Name.empty();
+        if (m_bShmRing) {
+            sts = m_shmRing.Init(pParams->shmRing);
+            MSDK_CHECK_STATUS(sts, "m_shmRing.Init failed");
+        }
     }
     else if ((m_eWorkMode != MODE_PERFORMANCE) && (m_eWorkMode != MODE_RENDERING)) {
         printf("error: unsupported work mode\n");
@@ -672,11 +719,17 @@ void CDecodingPipeline::Close() {
     MSDK_SAFE_DELETE(m_pmfxVPP);
 
     DeleteFrames();
+    if (m_pSurfaceBudget) {
+        m_pSurfaceBudget->Release(m_nBudgetSurfaces);
+        m_nBudgetSurfaces = 0;
+    }
 
     DeallocateExtMVCBuffers();
 
     m_mfxSession.Close();
     m_FileWriter.Close();
+    m_qualityChecker.Close();
+    m_shmRing.Close();
     if (m_FileReader.get())
         m_FileReader->Close();
 
@@ -1293,6 +1346,20 @@ mfxStatus CDecodingPipeline::AllocFrames() {
     }
 #endif
 
+    if (m_pSurfaceBudget) {
+        mfxU32 nBudgetSurfaces = Request.NumFrameSuggested + nVppSurfNum;
+        if (!m_nBudgetSurfaces) {
+            sts = m_pSurfaceBudget->Acquire(nBudgetSurfaces);
+            MSDK_CHECK_STATUS(sts, "surfaces of the stream exceed the surface budget");
+            m_nBudgetSurfaces = nBudgetSurfaces;
+        }
+        else if (nBudgetSurfaces > m_nBudgetSurfaces) {
+            // a decoder reset can't wait for other streams to give surfaces back
+            m_pSurfaceBudget->ForceAcquire(nBudgetSurfaces - m_nBudgetSurfaces);
+            m_nBudgetSurfaces = nBudgetSurfaces;
+        }
+    }
+
     // alloc frames for decoder
     sts = m_pGeneralAllocator->Alloc(m_pGeneralAllocator->pthis, &Request, &m_mfxResponse);
     MSDK_CHECK_STATUS(sts, "m_pGeneralAllocator->Alloc failed");
@@ -1616,8 +1683,7 @@ mfxStatus CDecodingPipeline::DeliverOutput(mfxFrameSurface1* frame) {
                                             frame->Data.MemId,
                                             &(frame->Data));
             if (MFX_ERR_NONE == res) {
-                res = m_bOutI420 ? m_FileWriter.WriteNextFrameI420(frame)
-                                 : m_FileWriter.WriteNextFrame(frame);
+                res = WriteOutput(frame);
                 sts = m_pGeneralAllocator->Unlock(m_pGeneralAllocator->pthis,
                                                   frame->Data.MemId,
                                                   &(frame->Data));
@@ -1635,15 +1701,50 @@ mfxStatus CDecodingPipeline::DeliverOutput(mfxFrameSurface1* frame) {
         }
     }
     else {
-        res = m_bOutI420 ? m_FileWriter.WriteNextFrameI420(frame)
-                         : m_FileWriter.WriteNextFrame(frame);
+        res = WriteOutput(frame);
     }
 
-    m_fpsLimiter.Work();
+    m_framePacer.Work();
 
     return res;
 }
 
+mfxStatus CDecodingPipeline::WriteOutput(mfxFrameSurface1* frame) {
+    mfxStatus sts = MFX_ERR_NONE;
+
+    if (m_bWriteFile) {
+        sts = m_bOutI420 ? m_FileWriter.WriteNextFrameI420(frame)
+                         : m_FileWriter.WriteNextFrame(frame);
+        MSDK_CHECK_STATUS(sts, "m_FileWriter.WriteNextFrame failed");
+    }
+
+    if (m_bQualityCheck) {
+        sts = m_qualityChecker.CheckFrame(frame->Info, frame->Data);
+        MSDK_CHECK_STATUS(sts, "m_qualityChecker.CheckFrame failed");
+    }
+
+    if (m_bShmRing) {
+        sts = m_shmRing.WriteFrame(frame);
+        MSDK_CHECK_STATUS(sts, "m_shmRing.WriteFrame failed");
+    }
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CDecodingPipeline::FinishQualityCheck() {
+    if (!m_bQualityCheck)
+        return MFX_ERR_NONE;
+
+    m_qualityChecker.Close();
+    m_qualityChecker.PrintSummary("");
+
+    if (m_qualityChecker.GetMismatchCount()) {
+        printf("\nERROR: output does not match the digest stream\n");
+        return MFX_ERR_ABORTED;
+    }
+    return MFX_ERR_NONE;
+}
+
 void CDecodingPipeline::DeliverLoop(void) {
     while (!m_bStopDeliverLoop) {
         m_pDeliverOutputSemaphore->Wait();
@@ -1721,16 +1822,19 @@ mfxStatus CDecodingPipeline::SyncOutputSurface(mfxU32 wait) {
     if (MFX_ERR_NONE == sts) {
         // we got completely decoded frame - pushing it to the delivering thread...
         ++m_synced_count;
-        if (m_bPrintLatency) {
-            m_vLatency.push_back(m_timer_overall.Sync() - m_pCurrentOutputSurface->surface->submit);
+        if (m_bIsCompleteFrame) {
+            msdk_tick latency = m_timer_overall.Sync() - m_pCurrentOutputSurface->surface->submit;
+            m_latency.Add((mfxU32)(CTimer::ConvertToSeconds(latency) * 1000000));
+            if (m_bPrintLatency)
+                m_vLatency.push_back(latency);
         }
-        else {
+        if (!m_bPrintLatency) {
             PrintPerFrameStat();
         }
 
         if (m_eWorkMode == MODE_PERFORMANCE) {
             m_output_count = m_synced_count;
-            m_fpsLimiter.Work();
+            m_framePacer.Work();
             ReturnSurfaceToBuffers(m_pCurrentOutputSurface);
         }
         else if (m_eWorkMode == MODE_FILE_DUMP) {
@@ -1755,327 +1859,351 @@ mfxStatus CDecodingPipeline::SyncOutputSurface(mfxU32 wait) {
 }
 
 mfxStatus CDecodingPipeline::RunDecoding() {
-    mfxFrameSurface1* pOutSurface    = NULL;
-    mfxBitstream* pBitstream         = &m_mfxBS;
-    mfxStatus sts                    = MFX_ERR_NONE;
-    bool bErrIncompatibleVideoParams = false;
-    CTimeInterval<> decodeTimer(m_bIsCompleteFrame);
-    time_t start_time = time(0);
-    std::thread deliverThread;
+    mfxStatus sts = StartDecoding();
+    MSDK_CHECK_STATUS(sts, "StartDecoding failed");
+
+    while (DecodeStep()) {
+    }
+
+    return FinishDecoding();
+}
+
+mfxStatus CDecodingPipeline::StartDecoding() {
+    mfxStatus sts                 = MFX_ERR_NONE;
+    m_pDecodeBitstream            = &m_mfxBS;
+    m_decodeSts                   = MFX_ERR_NONE;
+    m_bErrIncompatibleVideoParams = false;
+    m_decodeStartTime             = time(0);
 
     if (m_eWorkMode == MODE_RENDERING) {
         m_pDeliverOutputSemaphore = new MSDKSemaphore(sts);
         m_pDeliveredEvent         = new MSDKEvent(sts, false, false);
 
-        deliverThread = std::thread(&CDecodingPipeline::DeliverLoop, this);
+        m_deliverThread = std::thread(&CDecodingPipeline::DeliverLoop, this);
     }
 
-    while (((sts == MFX_ERR_NONE) || (MFX_ERR_MORE_DATA == sts) || (MFX_ERR_MORE_SURFACE == sts)) &&
-           (m_nFrames > m_output_count)) {
-        if (MFX_ERR_NONE != m_error) {
-            printf("DeliverOutput return error = %d\n", (int)m_error);
-            break;
-        }
+    return MFX_ERR_NONE;
+}
 
-        if (pBitstream &&
-            ((MFX_ERR_MORE_DATA == sts) || (m_bIsCompleteFrame && !pBitstream->DataLength))) {
-            CAutoTimer timer_fread(m_tick_fread);
-            sts = m_FileReader->ReadNextFrame(pBitstream); // read more data to input bit stream
+bool CDecodingPipeline::DecodeStep() {
+    mfxFrameSurface1* pOutSurface     = NULL;
+    mfxBitstream*& pBitstream         = m_pDecodeBitstream;
+    mfxStatus& sts                    = m_decodeSts;
+    bool& bErrIncompatibleVideoParams = m_bErrIncompatibleVideoParams;
+    const time_t start_time           = m_decodeStartTime;
 
-            if (MFX_ERR_MORE_DATA == sts) {
-                sts = MFX_ERR_NONE;
-                // Timeout has expired or videowall mode
-                m_timer_overall.Sync();
-                if (((CTimer::ConvertToSeconds(m_tick_overall) < m_nTimeout) && m_nTimeout) ||
-                    m_bIsVideoWall) {
-                    m_FileReader->Reset();
-                    m_bResetFileWriter = true;
+    if (((sts != MFX_ERR_NONE) && (MFX_ERR_MORE_DATA != sts) && (MFX_ERR_MORE_SURFACE != sts)) ||
+        (m_nFrames <= m_output_count)) {
+        return false;
+    }
 
-                    // Reset bitstream state
-                    pBitstream->DataFlag = 0;
+    if (MFX_ERR_NONE != m_error) {
+        printf("DeliverOutput return error = %d\n", (int)m_error);
+        return false;
+    }
 
-                    continue;
-                }
+    if (pBitstream &&
+        ((MFX_ERR_MORE_DATA == sts) || (m_bIsCompleteFrame && !pBitstream->DataLength))) {
+        CAutoTimer timer_fread(m_tick_fread);
+        sts = m_FileReader->ReadNextFrame(pBitstream); // read more data to input bit stream
 
-                // we almost reached end of stream, need to pull buffered data now
-                pBitstream = NULL;
+        if (MFX_ERR_MORE_DATA == sts) {
+            sts = MFX_ERR_NONE;
+            // Timeout has expired or videowall mode
+            m_timer_overall.Sync();
+            if (((CTimer::ConvertToSeconds(m_tick_overall) < m_nTimeout) && m_nTimeout) ||
+                m_bIsVideoWall) {
+                m_FileReader->Reset();
+                m_bResetFileWriter = true;
+
+                // Reset bitstream state
+                pBitstream->DataFlag = 0;
+
+                return true;
             }
+
+            // we almost reached end of stream, need to pull buffered data now
+            pBitstream = NULL;
         }
+    }
 
-        if ((MFX_ERR_NONE == sts) || (MFX_ERR_MORE_DATA == sts) || (MFX_ERR_MORE_SURFACE == sts)) {
-            // here we check whether output is ready, though we do not wait...
+    if ((MFX_ERR_NONE == sts) || (MFX_ERR_MORE_DATA == sts) || (MFX_ERR_MORE_SURFACE == sts)) {
+        // here we check whether output is ready, though we do not wait...
 #ifndef __SYNC_WA
-            mfxStatus _sts = SyncOutputSurface(0);
-            if (MFX_ERR_UNKNOWN == _sts) {
-                sts = _sts;
-                break;
-            }
-            else if (MFX_ERR_NONE == _sts) {
-                continue;
-            }
-#endif
+        mfxStatus _sts = SyncOutputSurface(0);
+        if (MFX_ERR_UNKNOWN == _sts) {
+            sts = _sts;
+            return false;
         }
-        else {
-            MSDK_CHECK_STATUS_NO_RET(sts, "ReadNextFrame failed");
+        else if (MFX_ERR_NONE == _sts) {
+            return true;
         }
+#endif
+    }
+    else {
+        MSDK_CHECK_STATUS_NO_RET(sts, "ReadNextFrame failed");
+    }
 
-        if ((MFX_ERR_NONE == sts) || (MFX_ERR_MORE_DATA == sts) || (MFX_ERR_MORE_SURFACE == sts)) {
-            SyncFrameSurfaces();
-            SyncVppFrameSurfaces();
-            if (!m_pCurrentFreeSurface) {
-                m_pCurrentFreeSurface = m_FreeSurfacesPool.GetSurface();
-            }
-            if (!m_pCurrentFreeVppSurface) {
-                m_pCurrentFreeVppSurface = m_FreeVppSurfacesPool.GetSurface();
-            }
+    if ((MFX_ERR_NONE == sts) || (MFX_ERR_MORE_DATA == sts) || (MFX_ERR_MORE_SURFACE == sts)) {
+        SyncFrameSurfaces();
+        SyncVppFrameSurfaces();
+        if (!m_pCurrentFreeSurface) {
+            m_pCurrentFreeSurface = m_FreeSurfacesPool.GetSurface();
+        }
+        if (!m_pCurrentFreeVppSurface) {
+            m_pCurrentFreeVppSurface = m_FreeVppSurfacesPool.GetSurface();
+        }
 #ifndef __SYNC_WA
-            if (!m_pCurrentFreeSurface || !m_pCurrentFreeVppSurface) {
+        if (!m_pCurrentFreeSurface || !m_pCurrentFreeVppSurface) {
 #else
-            if (!m_pCurrentFreeSurface || (!m_pCurrentFreeVppSurface && m_bVppIsUsed) ||
-                (m_OutputSurfacesPool.GetSurfaceCount() == m_mfxVideoParams.AsyncDepth)) {
+        if (!m_pCurrentFreeSurface || (!m_pCurrentFreeVppSurface && m_bVppIsUsed) ||
+            (m_OutputSurfacesPool.GetSurfaceCount() == m_mfxVideoParams.AsyncDepth)) {
 #endif
-                // we stuck with no free surface available, now we will sync...
-                sts = SyncOutputSurface(MSDK_DEC_WAIT_INTERVAL);
-                if (MFX_ERR_MORE_DATA == sts) {
-                    if ((m_eWorkMode == MODE_PERFORMANCE) || (m_eWorkMode == MODE_FILE_DUMP)) {
-                        sts = MFX_ERR_NOT_FOUND;
-                    }
-                    else if (m_eWorkMode == MODE_RENDERING) {
-                        if (m_synced_count != m_output_count) {
-                            sts = m_pDeliveredEvent->TimedWait(MSDK_DEC_WAIT_INTERVAL);
-                        }
-                        else {
-                            sts = MFX_ERR_NOT_FOUND;
-                        }
+            // we stuck with no free surface available, now we will sync...
+            sts = SyncOutputSurface(MSDK_DEC_WAIT_INTERVAL);
+            if (MFX_ERR_MORE_DATA == sts) {
+                if ((m_eWorkMode == MODE_PERFORMANCE) || (m_eWorkMode == MODE_FILE_DUMP)) {
+                    sts = MFX_ERR_NOT_FOUND;
+                }
+                else if (m_eWorkMode == MODE_RENDERING) {
+                    if (m_synced_count != m_output_count) {
+                        sts = m_pDeliveredEvent->TimedWait(MSDK_DEC_WAIT_INTERVAL);
                     }
-                    if (MFX_ERR_NOT_FOUND == sts) {
-                        printf("fatal: failed to find output surface, that's a bug!\n");
-                        break;
+                    else {
+                        sts = MFX_ERR_NOT_FOUND;
                     }
                 }
-                MSDK_CHECK_ERR_NONE_STATUS_NO_RET(sts, "SyncOperation fail or timeout");
-                // note: MFX_WRN_IN_EXECUTION will also be treated as an error at this point
-                continue;
-            }
-
-            if (!m_pCurrentFreeOutputSurface) {
-                m_pCurrentFreeOutputSurface = GetFreeOutputSurface();
-            }
-            if (!m_pCurrentFreeOutputSurface) {
-                sts = MFX_ERR_NOT_FOUND;
-                break;
+                if (MFX_ERR_NOT_FOUND == sts) {
+                    printf("fatal: failed to find output surface, that's a bug!\n");
+                    return false;
+                }
             }
+            MSDK_CHECK_ERR_NONE_STATUS_NO_RET(sts, "SyncOperation fail or timeout");
+            // note: MFX_WRN_IN_EXECUTION will also be treated as an error at this point
+            return true;
         }
 
-        // exit by timeout
-        if ((MFX_ERR_NONE == sts) && m_bIsVideoWall && (time(0) - start_time) >= m_nTimeout) {
-            sts = MFX_ERR_NONE;
-            break;
+        if (!m_pCurrentFreeOutputSurface) {
+            m_pCurrentFreeOutputSurface = GetFreeOutputSurface();
+        }
+        if (!m_pCurrentFreeOutputSurface) {
+            sts = MFX_ERR_NOT_FOUND;
+            return false;
         }
+    }
 
-        if ((MFX_ERR_NONE == sts) || (MFX_ERR_MORE_DATA == sts) || (MFX_ERR_MORE_SURFACE == sts)) {
-            if (m_bIsCompleteFrame) {
-                m_pCurrentFreeSurface->submit = m_timer_overall.Sync();
+    // exit by timeout
+    if ((MFX_ERR_NONE == sts) && m_bIsVideoWall && (time(0) - start_time) >= m_nTimeout) {
+        sts = MFX_ERR_NONE;
+        return false;
+    }
+
+    if ((MFX_ERR_NONE == sts) || (MFX_ERR_MORE_DATA == sts) || (MFX_ERR_MORE_SURFACE == sts)) {
+        if (m_bIsCompleteFrame) {
+            m_pCurrentFreeSurface->submit = m_timer_overall.Sync();
+        }
+        pOutSurface = NULL;
+        do {
+            mfxExtDecodeErrorReport* errorReport = nullptr;
+            if (pBitstream) {
+                errorReport =
+                    (mfxExtDecodeErrorReport*)GetExtBuffer(pBitstream->ExtParam,
+                                                           pBitstream->NumExtParam,
+                                                           MFX_EXTBUFF_DECODE_ERROR_REPORT);
             }
-            pOutSurface = NULL;
-            do {
-                mfxExtDecodeErrorReport* errorReport = nullptr;
-                if (pBitstream) {
-                    errorReport =
-                        (mfxExtDecodeErrorReport*)GetExtBuffer(pBitstream->ExtParam,
-                                                               pBitstream->NumExtParam,
-                                                               MFX_EXTBUFF_DECODE_ERROR_REPORT);
-                }
 
-                //Obtain HDR metadata only P010(10-bit) and w/o VPP.
-                if (m_mfxVideoParams.mfx.FrameInfo.FourCC == MFX_FOURCC_P010 && !m_bVppIsUsed) {
-                    m_OutSurfaceExtParams.clear();
-                    m_DisplayColor.Header.BufferId = MFX_EXTBUFF_MASTERING_DISPLAY_COLOUR_VOLUME;
-                    m_ContentLight.Header.BufferId = MFX_EXTBUFF_CONTENT_LIGHT_LEVEL_INFO;
-                    m_OutSurfaceExtParams.push_back((mfxExtBuffer*)&m_DisplayColor);
-                    m_OutSurfaceExtParams.push_back((mfxExtBuffer*)&m_ContentLight);
-                    m_pCurrentFreeSurface->frame.Data.ExtParam =
-                        reinterpret_cast<mfxExtBuffer**>(&m_OutSurfaceExtParams[0]);
-                    m_pCurrentFreeSurface->frame.Data.NumExtParam =
-                        static_cast<mfxU16>(m_OutSurfaceExtParams.size());
-                }
+            //Obtain HDR metadata only P010(10-bit) and w/o VPP.
+            if (m_mfxVideoParams.mfx.FrameInfo.FourCC == MFX_FOURCC_P010 && !m_bVppIsUsed) {
+                m_OutSurfaceExtParams.clear();
+                m_DisplayColor.Header.BufferId = MFX_EXTBUFF_MASTERING_DISPLAY_COLOUR_VOLUME;
+                m_ContentLight.Header.BufferId = MFX_EXTBUFF_CONTENT_LIGHT_LEVEL_INFO;
+                m_OutSurfaceExtParams.push_back((mfxExtBuffer*)&m_DisplayColor);
+                m_OutSurfaceExtParams.push_back((mfxExtBuffer*)&m_ContentLight);
+                m_pCurrentFreeSurface->frame.Data.ExtParam =
+                    reinterpret_cast<mfxExtBuffer**>(&m_OutSurfaceExtParams[0]);
+                m_pCurrentFreeSurface->frame.Data.NumExtParam =
+                    static_cast<mfxU16>(m_OutSurfaceExtParams.size());
+            }
 
-                sts = m_pmfxDEC->DecodeFrameAsync(pBitstream,
-                                                  &(m_pCurrentFreeSurface->frame),
-                                                  &pOutSurface,
-                                                  &(m_pCurrentFreeOutputSurface->syncp));
+            sts = m_pmfxDEC->DecodeFrameAsync(pBitstream,
+                                              &(m_pCurrentFreeSurface->frame),
+                                              &pOutSurface,
+                                              &(m_pCurrentFreeOutputSurface->syncp));
 
-                PrintDecodeErrorReport(errorReport);
+            PrintDecodeErrorReport(errorReport);
 
-                if (pBitstream && MFX_ERR_MORE_DATA == sts &&
-                    pBitstream->MaxLength == pBitstream->DataLength) {
-                    m_mfxBS.Extend(pBitstream->MaxLength * 2);
-                }
+            if (pBitstream && MFX_ERR_MORE_DATA == sts &&
+                pBitstream->MaxLength == pBitstream->DataLength) {
+                m_mfxBS.Extend(pBitstream->MaxLength * 2);
+            }
 
-                if (MFX_WRN_DEVICE_BUSY == sts) {
-                    if (m_bIsCompleteFrame) {
-                        //in low latency mode device busy leads to increasing of latency
-                        //printf("Warning : latency increased due to MFX_WRN_DEVICE_BUSY\n");
-                    }
-                    mfxStatus _sts = SyncOutputSurface(MSDK_DEC_WAIT_INTERVAL);
-                    // note: everything except MFX_ERR_NONE are errors at this point
-                    if (MFX_ERR_NONE == _sts) {
-                        sts = MFX_WRN_DEVICE_BUSY;
-                    }
-                    else {
-                        sts = _sts;
-                        if (MFX_ERR_MORE_DATA == sts) {
-                            // we can't receive MFX_ERR_MORE_DATA and have no output - that's a bug
-                            sts = MFX_WRN_DEVICE_BUSY; //MFX_ERR_NOT_FOUND;
-                        }
-                    }
+            if (MFX_WRN_DEVICE_BUSY == sts) {
+                if (m_bIsCompleteFrame) {
+                    //in low latency mode device busy leads to increasing of latency
+                    //printf("Warning : latency increased due to MFX_WRN_DEVICE_BUSY\n");
                 }
-            } while (MFX_WRN_DEVICE_BUSY == sts);
-
-            if (sts > MFX_ERR_NONE) {
-                // ignoring warnings...
-                if (m_pCurrentFreeOutputSurface->syncp) {
-                    MSDK_SELF_CHECK(pOutSurface);
-                    // output is available
-                    sts = MFX_ERR_NONE;
+                mfxStatus _sts = SyncOutputSurface(MSDK_DEC_WAIT_INTERVAL);
+                // note: everything except MFX_ERR_NONE are errors at this point
+                if (MFX_ERR_NONE == _sts) {
+                    sts = MFX_WRN_DEVICE_BUSY;
                 }
                 else {
-                    // output is not available
-                    sts = MFX_ERR_MORE_SURFACE;
+                    sts = _sts;
+                    if (MFX_ERR_MORE_DATA == sts) {
+                        // we can't receive MFX_ERR_MORE_DATA and have no output - that's a bug
+                        sts = MFX_WRN_DEVICE_BUSY; //MFX_ERR_NOT_FOUND;
+                    }
                 }
             }
-            else if ((MFX_ERR_MORE_DATA == sts) && pBitstream) {
-                if (m_bIsCompleteFrame && pBitstream->DataLength) {
-                    // In low_latency mode decoder have to process bitstream completely
-                    printf(
-                        "error: Incorrect decoder behavior in low latency mode (bitstream length is not equal to 0 after decoding)\n");
-                    sts = MFX_ERR_UNDEFINED_BEHAVIOR;
-                    continue;
-                }
+        } while (MFX_WRN_DEVICE_BUSY == sts);
+
+        if (sts > MFX_ERR_NONE) {
+            // ignoring warnings...
+            if (m_pCurrentFreeOutputSurface->syncp) {
+                MSDK_SELF_CHECK(pOutSurface);
+                // output is available
+                sts = MFX_ERR_NONE;
             }
-            else if ((MFX_ERR_MORE_DATA == sts) && !pBitstream) {
-                // that's it - we reached end of stream; now we need to render bufferred data...
-                do {
-                    sts = SyncOutputSurface(MSDK_DEC_WAIT_INTERVAL);
-                } while (MFX_ERR_NONE == sts);
+            else {
+                // output is not available
+                sts = MFX_ERR_MORE_SURFACE;
+            }
+        }
+        else if ((MFX_ERR_MORE_DATA == sts) && pBitstream) {
+            if (m_bIsCompleteFrame && pBitstream->DataLength) {
+                // In low_latency mode decoder have to process bitstream completely
+                printf(
+                    "error: Incorrect decoder behavior in low latency mode (bitstream length is not equal to 0 after decoding)\n");
+                sts = MFX_ERR_UNDEFINED_BEHAVIOR;
+                return true;
+            }
+        }
+        else if ((MFX_ERR_MORE_DATA == sts) && !pBitstream) {
+            // that's it - we reached end of stream; now we need to render bufferred data...
+            do {
+                sts = SyncOutputSurface(MSDK_DEC_WAIT_INTERVAL);
+            } while (MFX_ERR_NONE == sts);
 
-                MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_DATA);
-                if (sts)
-                    MSDK_PRINT_WRN_MSG(sts, "SyncOutputSurface failed")
+            MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_DATA);
+            if (sts)
+                MSDK_PRINT_WRN_MSG(sts, "SyncOutputSurface failed")
 
-                while (m_synced_count != m_output_count) {
-                    m_pDeliveredEvent->Wait();
-                }
-                break;
+            while (m_synced_count != m_output_count) {
+                m_pDeliveredEvent->Wait();
             }
-            else if (MFX_ERR_INCOMPATIBLE_VIDEO_PARAM == sts) {
-                bErrIncompatibleVideoParams = true;
+            return false;
+        }
+        else if (MFX_ERR_INCOMPATIBLE_VIDEO_PARAM == sts) {
+            bErrIncompatibleVideoParams = true;
+            // need to go to the buffering loop prior to reset procedure
+            pBitstream = NULL;
+            sts        = MFX_ERR_NONE;
+            return true;
+        }
+        else if (MFX_ERR_REALLOC_SURFACE == sts) {
+            mfxVideoParam param{};
+            sts = m_pmfxDEC->GetVideoParam(&param);
+            if (MFX_ERR_NONE != sts) {
                 // need to go to the buffering loop prior to reset procedure
                 pBitstream = NULL;
                 sts        = MFX_ERR_NONE;
-                continue;
+                return true;
             }
-            else if (MFX_ERR_REALLOC_SURFACE == sts) {
-                mfxVideoParam param{};
-                sts = m_pmfxDEC->GetVideoParam(&param);
-                if (MFX_ERR_NONE != sts) {
-                    // need to go to the buffering loop prior to reset procedure
-                    pBitstream = NULL;
-                    sts        = MFX_ERR_NONE;
-                    continue;
-                }
 
-                sts = ReallocCurrentSurface(param.mfx.FrameInfo);
-                if (MFX_ERR_NONE != sts) {
-                    // need to go to the buffering loop prior to reset procedure
-                    pBitstream = NULL;
-                    sts        = MFX_ERR_NONE;
-                }
-                continue;
+            sts = ReallocCurrentSurface(param.mfx.FrameInfo);
+            if (MFX_ERR_NONE != sts) {
+                // need to go to the buffering loop prior to reset procedure
+                pBitstream = NULL;
+                sts        = MFX_ERR_NONE;
             }
+            return true;
         }
+    }
 
-        if ((MFX_ERR_NONE == sts) || (MFX_ERR_MORE_DATA == sts) || (MFX_ERR_MORE_SURFACE == sts)) {
-            // if current free surface is locked we are moving it to the used surfaces array
-            /*if (m_pCurrentFreeSurface->frame.Data.Locked)*/ {
-                m_UsedSurfacesPool.AddSurface(m_pCurrentFreeSurface);
-                m_pCurrentFreeSurface = NULL;
-            }
+    if ((MFX_ERR_NONE == sts) || (MFX_ERR_MORE_DATA == sts) || (MFX_ERR_MORE_SURFACE == sts)) {
+        // if current free surface is locked we are moving it to the used surfaces array
+        /*if (m_pCurrentFreeSurface->frame.Data.Locked)*/ {
+            m_UsedSurfacesPool.AddSurface(m_pCurrentFreeSurface);
+            m_pCurrentFreeSurface = NULL;
         }
-        else {
-            MSDK_CHECK_STATUS_NO_RET(sts, "DecodeFrameAsync returned error status");
-        }
-
-        if (MFX_ERR_NONE == sts) {
-            if (m_bVppIsUsed) {
-                if (m_pCurrentFreeVppSurface) {
-                    do {
-                        if ((m_pCurrentFreeVppSurface->frame.Info.CropW == 0) ||
-                            (m_pCurrentFreeVppSurface->frame.Info.CropH == 0)) {
-                            m_pCurrentFreeVppSurface->frame.Info.CropW = pOutSurface->Info.CropW;
-                            m_pCurrentFreeVppSurface->frame.Info.CropH = pOutSurface->Info.CropH;
-                            m_pCurrentFreeVppSurface->frame.Info.CropX = pOutSurface->Info.CropX;
-                            m_pCurrentFreeVppSurface->frame.Info.CropY = pOutSurface->Info.CropY;
-                        }
-                        if (pOutSurface->Info.PicStruct !=
-                            m_pCurrentFreeVppSurface->frame.Info.PicStruct) {
-                            m_pCurrentFreeVppSurface->frame.Info.PicStruct =
-                                pOutSurface->Info.PicStruct;
-                        }
-                        if ((pOutSurface->Info.PicStruct == 0) &&
-                            (m_pCurrentFreeVppSurface->frame.Info.PicStruct == 0)) {
-                            m_pCurrentFreeVppSurface->frame.Info.PicStruct =
-                                pOutSurface->Info.PicStruct = MFX_PICSTRUCT_PROGRESSIVE;
-                        }
-
-                        if (m_diMode)
-                            m_pCurrentFreeVppSurface->frame.Info.PicStruct =
-                                MFX_PICSTRUCT_PROGRESSIVE;
-
-                        // WA: RunFrameVPPAsync doesn't copy ViewId from input to output
-                        m_pCurrentFreeVppSurface->frame.Info.FrameId.ViewId =
-                            pOutSurface->Info.FrameId.ViewId;
-                        sts = m_pmfxVPP->RunFrameVPPAsync(pOutSurface,
-                                                          &(m_pCurrentFreeVppSurface->frame),
-                                                          NULL,
-                                                          &(m_pCurrentFreeOutputSurface->syncp));
-
-                        if (MFX_WRN_DEVICE_BUSY == sts) {
-                            MSDK_SLEEP(
-                                1); // just wait and then repeat the same call to RunFrameVPPAsync
-                        }
-                    } while (MFX_WRN_DEVICE_BUSY == sts);
-
-                    // process errors
-                    if (MFX_ERR_MORE_DATA == sts) { // will never happen actually
-                        continue;
+    }
+    else {
+        MSDK_CHECK_STATUS_NO_RET(sts, "DecodeFrameAsync returned error status");
+    }
+
+    if (MFX_ERR_NONE == sts) {
+        if (m_bVppIsUsed) {
+            if (m_pCurrentFreeVppSurface) {
+                do {
+                    if ((m_pCurrentFreeVppSurface->frame.Info.CropW == 0) ||
+                        (m_pCurrentFreeVppSurface->frame.Info.CropH == 0)) {
+                        m_pCurrentFreeVppSurface->frame.Info.CropW = pOutSurface->Info.CropW;
+                        m_pCurrentFreeVppSurface->frame.Info.CropH = pOutSurface->Info.CropH;
+                        m_pCurrentFreeVppSurface->frame.Info.CropX = pOutSurface->Info.CropX;
+                        m_pCurrentFreeVppSurface->frame.Info.CropY = pOutSurface->Info.CropY;
+                    }
+                    if (pOutSurface->Info.PicStruct !=
+                        m_pCurrentFreeVppSurface->frame.Info.PicStruct) {
+                        m_pCurrentFreeVppSurface->frame.Info.PicStruct =
+                            pOutSurface->Info.PicStruct;
                     }
-                    else if (MFX_ERR_NONE != sts) {
-                        MSDK_PRINT_RET_MSG(sts, "RunFrameVPPAsync failed");
-                        break;
+                    if ((pOutSurface->Info.PicStruct == 0) &&
+                        (m_pCurrentFreeVppSurface->frame.Info.PicStruct == 0)) {
+                        m_pCurrentFreeVppSurface->frame.Info.PicStruct =
+                            pOutSurface->Info.PicStruct = MFX_PICSTRUCT_PROGRESSIVE;
                     }
 
-                    m_UsedVppSurfacesPool.AddSurface(m_pCurrentFreeVppSurface);
-                    msdk_atomic_inc16(&(m_pCurrentFreeVppSurface->render_lock));
+                    if (m_diMode)
+                        m_pCurrentFreeVppSurface->frame.Info.PicStruct = MFX_PICSTRUCT_PROGRESSIVE;
 
-                    m_pCurrentFreeOutputSurface->surface = m_pCurrentFreeVppSurface;
-                    m_OutputSurfacesPool.AddSurface(m_pCurrentFreeOutputSurface);
+                    // WA: RunFrameVPPAsync doesn't copy ViewId from input to output
+                    m_pCurrentFreeVppSurface->frame.Info.FrameId.ViewId =
+                        pOutSurface->Info.FrameId.ViewId;
+                    sts = m_pmfxVPP->RunFrameVPPAsync(pOutSurface,
+                                                      &(m_pCurrentFreeVppSurface->frame),
+                                                      NULL,
+                                                      &(m_pCurrentFreeOutputSurface->syncp));
+
+                    if (MFX_WRN_DEVICE_BUSY == sts) {
+                        MSDK_SLEEP(1); // just wait and then repeat the same call to RunFrameVPPAsync
+                    }
+                } while (MFX_WRN_DEVICE_BUSY == sts);
 
-                    m_pCurrentFreeOutputSurface = NULL;
-                    m_pCurrentFreeVppSurface    = NULL;
+                // process errors
+                if (MFX_ERR_MORE_DATA == sts) { // will never happen actually
+                    return true;
+                }
+                else if (MFX_ERR_NONE != sts) {
+                    MSDK_PRINT_RET_MSG(sts, "RunFrameVPPAsync failed");
+                    return false;
                 }
-            }
-            else {
-                msdkFrameSurface* surface = FindUsedSurface(pOutSurface);
 
-                msdk_atomic_inc16(&(surface->render_lock));
+                m_UsedVppSurfacesPool.AddSurface(m_pCurrentFreeVppSurface);
+                msdk_atomic_inc16(&(m_pCurrentFreeVppSurface->render_lock));
 
-                m_pCurrentFreeOutputSurface->surface = surface;
+                m_pCurrentFreeOutputSurface->surface = m_pCurrentFreeVppSurface;
                 m_OutputSurfacesPool.AddSurface(m_pCurrentFreeOutputSurface);
+
                 m_pCurrentFreeOutputSurface = NULL;
+                m_pCurrentFreeVppSurface    = NULL;
             }
         }
-    } //while processing
+        else {
+            msdkFrameSurface* surface = FindUsedSurface(pOutSurface);
+
+            msdk_atomic_inc16(&(surface->render_lock));
+
+            m_pCurrentFreeOutputSurface->surface = surface;
+            m_OutputSurfacesPool.AddSurface(m_pCurrentFreeOutputSurface);
+            m_pCurrentFreeOutputSurface = NULL;
+        }
+    }
+
+    return true;
+}
+
+mfxStatus CDecodingPipeline::FinishDecoding() {
+    mfxStatus sts = m_decodeSts;
 
     if (m_nFrames == m_output_count) {
         if (sts != MFX_ERR_NONE) {
@@ -2088,7 +2216,9 @@ mfxStatus CDecodingPipeline::RunDecoding() {
         }
     }
 
-    PrintPerFrameStat(true);
+    // streams of the multi-stream mode are reported together by the caller
+    if (!m_bMultiStream)
+        PrintPerFrameStat(true);
 
     if (m_bPrintLatency && m_vLatency.size() > 0) {
         unsigned int frame_idx = 0;
@@ -2116,18 +2246,27 @@ mfxStatus CDecodingPipeline::RunDecoding() {
         m_bStopDeliverLoop = true;
         m_pDeliverOutputSemaphore->Post();
 
-        if (deliverThread.joinable())
-            deliverThread.join();
+        if (m_deliverThread.joinable())
+            m_deliverThread.join();
     }
 
     MSDK_SAFE_DELETE(m_pDeliverOutputSemaphore);
     MSDK_SAFE_DELETE(m_pDeliveredEvent);
 
+    if (m_framePacer.IsActive() && !m_bMultiStream)
+        printf("\nFrame pacing: %s\n", m_framePacer.GetStatistics().ToString().c_str());
+
+    if (m_bShmRing)
+        printf("\nShared memory ring: %llu frames written, %llu dropped, %.3f s blocked\n",
+               (unsigned long long)m_shmRing.GetWritten(),
+               (unsigned long long)m_shmRing.GetDropped(),
+               m_shmRing.GetBlockTime());
+
     // exit in case of other errors
     MSDK_CHECK_STATUS(sts, "Unexpected error!!");
 
     // if we exited main decoding loop with ERR_INCOMPATIBLE_PARAM we need to send this status to caller
-    if (bErrIncompatibleVideoParams) {
+    if (m_bErrIncompatibleVideoParams) {
         sts = MFX_ERR_INCOMPATIBLE_VIDEO_PARAM;
     }
 
@@ -8,6 +8,7 @@
 
 #include <regex>
 #include <sstream>
+#include "multi_stream_decode.h"
 #include "pipeline_decode.h"
 #include "version.h"
 
@@ -27,6 +28,7 @@ void PrintHelp(char* strAppName, const char* strErrorMessage) {
     printf("Usage: %s <codecid> [<options>] -i InputBitstream\n", strAppName);
     printf("   or: %s <codecid> [<options>] -i InputBitstream -r\n", strAppName);
     printf("   or: %s <codecid> [<options>] -i InputBitstream -o OutputYUVFile\n", strAppName);
+    printf("   or: %s <codecid> [<options>] -i InputBitstream -i InputBitstream ...\n", strAppName);
     printf("\n");
     printf("Supported codecs (<codecid>):\n");
     printf("   <codecid>=h264|mpeg2|vc1|mvc|jpeg|vp9|av1 - built-in Media SDK codecs\n");
@@ -38,6 +40,8 @@ void PrintHelp(char* strAppName, const char* strErrorMessage) {
         "  1. Performance model: decoding on MAX speed, no screen rendering, no YUV dumping (no -r or -o option)\n");
     printf("  2. Rendering model: decoding with rendering on the screen (-r option)\n");
     printf("  3. Dump model: decoding with YUV dumping (-o option)\n");
+    printf(
+        "  4. Multi-stream model: several inputs (-i given several times or -streams) decoded at MAX speed in one process\n");
     printf("\n");
     printf("Options:\n");
     printf("   [-?]                      - print help\n");
@@ -48,7 +52,7 @@ void PrintHelp(char* strAppName, const char* strErrorMessage) {
         "                               (optional for Media SDK in-box plugins, required for user-decoder ones)\n");
     printf(
         "   [-p plugin]               - DEPRECATED: decoder plugin. Supported values: hevcd_sw, hevcd_hw, vp8d_hw, vp9d_hw, camera_hw, capture_hw\n");
-    printf("   [-fps]                    - limits overall fps of pipeline\n");
+    printf("   [-fps N[/D]]              - limits overall fps of pipeline, e.g. 30000/1001\n");
     printf("   [-w]                      - output width\n");
     printf("   [-h]                      - output height\n");
     printf("   [-di bob/adi]             - enable deinterlacing BOB/ADI\n");
@@ -164,6 +168,22 @@ void PrintHelp(char* strAppName, const char* strErrorMessage) {
 #endif
     printf(
         "   [-dump fileName]         - dump MSDK components configuration to the file in text form\n");
+    printf("   [-verify_ref fileName]    - compare output with a raw reference, print PSNR and SSIM\n");
+    printf("   [-verify_digest fileName] - compare per-plane CRC32 of output with a digest stream\n");
+    printf("   [-dump_digest fileName]   - write per-plane CRC32 of output to a digest stream\n");
+    printf("   [-verify_threads n]       - number of threads for output verification\n");
+    printf("   [-streams n]              - decode n streams at once, cycling through the inputs\n");
+    printf("   [-stream_threads n]       - threads the streams take turns on, one per CPU by default\n");
+    printf(
+        "   [-surface_budget n]       - surfaces all streams may hold at a time, further streams wait to start\n");
+    printf("   [-shm_ring name]          - hand output frames to another process via /dev/shm/name\n");
+    printf("   [-shm_ring_slots n]       - frame slots of the shared memory ring, %d by default\n",
+           SHM_RING_DEFAULT_SLOTS);
+    printf(
+        "   [-shm_ring_drop]          - drop frames while the ring is full instead of waiting for the consumer\n");
+    printf(
+        "                               (without it the first consumer is waited for up to %d s)\n",
+        SHM_RING_DEFAULT_ATTACH_TIMEOUT / 1000);
 
 #if defined(_WIN32) || defined(_WIN64)
     printf("\nFeatures: \n");
@@ -629,7 +649,8 @@ mfxStatus ParseInputString(char* strInput[], mfxU32 nArgNum, sInputParams* pPara
                 PrintHelp(strInput[0], "Not enough parameters for -fps key");
                 return MFX_ERR_UNSUPPORTED;
             }
-            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nMaxFPS)) {
+            if (MFX_ERR_NONE !=
+                ParseFrameRate(strInput[++i], pParams->nMaxFPS, pParams->nMaxFPSDenom)) {
                 PrintHelp(strInput[0], "overall fps is invalid");
                 return MFX_ERR_UNSUPPORTED;
             }
@@ -752,6 +773,90 @@ mfxStatus ParseInputString(char* strInput[], mfxU32 nArgNum, sInputParams* pPara
             i++;
             pParams->dump_file = strInput[i];
         }
+        else if (msdk_match(strInput[i], "-verify_ref")) {
+            if (i + 1 >= nArgNum) {
+                PrintHelp(strInput[0], "File name for -verify_ref should be provided");
+                return MFX_ERR_UNSUPPORTED;
+            }
+            pParams->qualityParams.strRefFile = strInput[++i];
+        }
+        else if (msdk_match(strInput[i], "-verify_digest")) {
+            if (i + 1 >= nArgNum) {
+                PrintHelp(strInput[0], "File name for -verify_digest should be provided");
+                return MFX_ERR_UNSUPPORTED;
+            }
+            pParams->qualityParams.strDigestIn = strInput[++i];
+        }
+        else if (msdk_match(strInput[i], "-dump_digest")) {
+            if (i + 1 >= nArgNum) {
+                PrintHelp(strInput[0], "File name for -dump_digest should be provided");
+                return MFX_ERR_UNSUPPORTED;
+            }
+            pParams->qualityParams.strDigestOut = strInput[++i];
+        }
+        else if (msdk_match(strInput[i], "-streams")) {
+            if (i + 1 >= nArgNum) {
+                PrintHelp(strInput[0], "Not enough parameters for -streams key");
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nStreams) ||
+                !pParams->nStreams) {
+                PrintHelp(strInput[0], "number of streams is invalid");
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (msdk_match(strInput[i], "-stream_threads")) {
+            if (i + 1 >= nArgNum) {
+                PrintHelp(strInput[0], "Not enough parameters for -stream_threads key");
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nStreamThreads)) {
+                PrintHelp(strInput[0], "number of stream threads is invalid");
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (msdk_match(strInput[i], "-surface_budget")) {
+            if (i + 1 >= nArgNum) {
+                PrintHelp(strInput[0], "Not enough parameters for -surface_budget key");
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nSurfaceBudget)) {
+                PrintHelp(strInput[0], "surface budget is invalid");
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (msdk_match(strInput[i], "-shm_ring")) {
+            if (i + 1 >= nArgNum) {
+                PrintHelp(strInput[0], "Name for -shm_ring should be provided");
+                return MFX_ERR_UNSUPPORTED;
+            }
+            pParams->mode         = MODE_FILE_DUMP;
+            pParams->shmRing.Name = strInput[++i];
+        }
+        else if (msdk_match(strInput[i], "-shm_ring_slots")) {
+            if (i + 1 >= nArgNum) {
+                PrintHelp(strInput[0], "Not enough parameters for -shm_ring_slots key");
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->shmRing.Slots) ||
+                !pParams->shmRing.Slots) {
+                PrintHelp(strInput[0], "number of shared memory ring slots is invalid");
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (msdk_match(strInput[i], "-shm_ring_drop")) {
+            pParams->shmRing.Policy = SHM_RING_DROP;
+        }
+        else if (msdk_match(strInput[i], "-verify_threads")) {
+            if (i + 1 >= nArgNum) {
+                PrintHelp(strInput[0], "Not enough parameters for -verify_threads key");
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->qualityParams.numThreads)) {
+                PrintHelp(strInput[0], "verification threads number is invalid");
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
         else // 1-character options
         {
             switch (strInput[i][1]) {
@@ -761,7 +866,11 @@ mfxStatus ParseInputString(char* strInput[], mfxU32 nArgNum, sInputParams* pPara
                     break;
                 case 'i':
                     if (++i < nArgNum) {
-                        msdk_opt_read(strInput[i], pParams->strSrcFile);
+                        // every further input is decoded as a separate stream
+                        if (strlen(pParams->strSrcFile))
+                            pParams->streamFiles.push_back(strInput[i]);
+                        else
+                            msdk_opt_read(strInput[i], pParams->strSrcFile);
                     }
                     else {
                         printf("error: option '-i' expects an argument\n");
@@ -794,7 +903,19 @@ mfxStatus ParseInputString(char* strInput[], mfxU32 nArgNum, sInputParams* pPara
         return MFX_ERR_UNSUPPORTED;
     }
 
-    if ((pParams->mode == MODE_FILE_DUMP) && (0 == strlen(pParams->strDstFile))) {
+    // output has to be delivered to be verified
+    if (pParams->qualityParams.IsEnabled() && pParams->mode == MODE_PERFORMANCE) {
+        pParams->mode = MODE_FILE_DUMP;
+    }
+
+    if ((!pParams->streamFiles.empty() || pParams->nStreams > 1) &&
+        pParams->mode != MODE_PERFORMANCE) {
+        printf("error: several streams can't be written, rendered or verified");
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    if ((pParams->mode == MODE_FILE_DUMP) && (0 == strlen(pParams->strDstFile)) &&
+        !pParams->qualityParams.IsEnabled() && pParams->shmRing.Name.empty()) {
         printf("error: destination file name not found");
         return MFX_ERR_UNSUPPORTED;
     }
@@ -846,6 +967,21 @@ int main(int argc, char* argv[]) {
         Params.fourcc  = MFX_FOURCC_I420;
         Params.outI420 = false;
     }
+
+    if (!Params.streamFiles.empty() || Params.nStreams > 1) {
+        CMultiStreamDecoder decoder;
+        sts = decoder.Init(Params);
+        MSDK_CHECK_STATUS(sts, "decoder.Init failed");
+
+        printf("Decoding started\n");
+        sts = decoder.Run();
+        decoder.PrintResults();
+        MSDK_CHECK_STATUS(sts, "decoder.Run failed");
+
+        printf("\nDecoding finished\n");
+        return 0;
+    }
+
     sts = Pipeline.Init(&Params);
     MSDK_CHECK_STATUS(sts, "Pipeline.Init failed");
 
@@ -894,5 +1030,8 @@ int main(int argc, char* argv[]) {
 
     printf("\nDecoding finished\n");
 
+    sts = Pipeline.FinishQualityCheck();
+    MSDK_CHECK_STATUS(sts, "Quality check failed");
+
     return 0;
 }
@@ -37,6 +37,8 @@
 #endif
 
 #include "brc_routines.h"
+#include "frame_pacer.h"
+#include "live_source.h"
 
 #if defined(_WIN64) || defined(_WIN32)
     #include "vpl/mfxadapter.h"
@@ -189,12 +191,16 @@ struct sInputParams {
 
     mfxU32 nTimeout;
     mfxU16 nPerfOpt; // size of pre-load buffer which used for loop encode
-    mfxU16 nMaxFPS; // limits overall fps
+    mfxU32 nMaxFPS; // limits overall fps
+    mfxU32 nMaxFPSDenom; // denominator of a fractional nMaxFPS, 0 if the rate is whole
+    bool bLiveSource; // input frames arrive on the schedule of a live feed at dFrameRate
+    LiveSourceParams LiveSource;
 
     mfxU32 nSyncOpTimeout; // SyncOperation timeout in msec
 
     mfxU16 nNumSlice;
     bool UseRegionEncode;
+    mfxU16 nRegionThreads; // threads of region encode, 0 - one per region
 
     bool isV4L2InputEnabled;
 
@@ -316,6 +322,10 @@ public:
     virtual void Close();
     virtual void SetGpuHangRecoveryFlag();
     virtual void ClearTasks();
+    // complete output frames are reported to the live source to measure their latency
+    void SetLiveSource(std::shared_ptr<CLiveSource> source) {
+        m_pLiveSource = source;
+    }
 
     msdk_tick firstOut_total;
     msdk_tick firstOut_start;
@@ -336,6 +346,7 @@ protected:
 
     CTimeStatistics m_statOverall;
     CTimeStatistics m_statFile;
+    std::shared_ptr<CLiveSource> m_pLiveSource;
     virtual mfxU32 GetFreeTaskIndex();
 };
 
@@ -378,7 +389,8 @@ protected:
     const CEncodingPipeline& operator=(CEncodingPipeline const&) = delete;
 
     std::pair<CSmplBitstreamWriter*, CSmplBitstreamWriter*> m_FileWriters;
-    CSmplYUVReader m_FileReader;
+    CLiveYUVReader m_FileReader;
+    std::shared_ptr<CLiveSource> m_pLiveSource;
     CEncTaskPool m_TaskPool;
     QPFile::Reader m_QPFileReader;
     TCBRCTestFile::Reader m_TCBRCFileReader;
@@ -445,7 +457,7 @@ protected:
     CTimeStatisticsReal m_statOverall;
     CTimeStatisticsReal m_statFile;
 
-    FPSLimiter m_fpsLimiter;
+    FramePacer m_framePacer;
 
     eAPIVersion m_verSessionInit;
     bool m_bReadByFrame;
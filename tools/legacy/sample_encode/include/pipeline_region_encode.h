@@ -7,6 +7,13 @@
 #ifndef __PIPELINE_REGION_ENCODE_H__
 #define __PIPELINE_REGION_ENCODE_H__
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "pipeline_encode.h"
 
 #ifndef MFX_VERSION
@@ -49,7 +56,6 @@ public:
     mfxStatus CreateEncoders();
     mfxStatus CreatePlugins(mfxPluginUID pluginGUID, mfxChar* pluginPath);
 
-    mfxStatus GetFreeTask(int resourceNum, sTask** ppTask);
     void CloseAndDeleteEverything();
 
 protected:
@@ -67,6 +73,74 @@ private:
     }
 };
 
+/* Encodes the regions of a frame on worker threads. Each worker submits its regions on its own,
+ * so a slow or busy region doesn't hold back the others, and a region goes on with the next frames
+ * while earlier ones are still encoded. The writer takes the encoded regions of the oldest frame
+ * in region order. With fewer workers than regions, regions are reassigned between frames so that
+ * the measured encode time of every worker is about the same. */
+class CRegionWorkers {
+public:
+    // Submits pSurface (NULL gets buffered frames) to region regionId. Returns MFX_ERR_NONE if the
+    // region has one more encoded frame for the writer, MFX_ERR_MORE_DATA if not.
+    typedef std::function<mfxStatus(int regionId, mfxFrameSurface1* pSurface, bool bIDR)>
+        EncodeRegionFunc;
+
+    CRegionWorkers();
+    ~CRegionWorkers();
+
+    // numWorkers 0 starts one worker per region
+    mfxStatus Start(int numRegions, int numWorkers, EncodeRegionFunc encodeRegion);
+    void Stop();
+
+    // Queues a frame for all regions, every region gets the same frame type
+    void Submit(mfxFrameSurface1* pSurface, bool bIDR);
+    // Frames a region still has to submit or to hand to the writer, the largest over all regions.
+    // Each of them may take a task of the region.
+    int GetPending();
+    // Whether a region has not submitted pSurface yet, so the encoder hasn't locked it
+    bool IsQueued(mfxFrameSurface1* pSurface);
+
+    // Waits for the oldest encoded frame of a region and keeps the worker off the region until
+    // ReleaseOutput. Returns MFX_ERR_MORE_DATA if the region has submitted all frames and has
+    // nothing to write, or the error of the region.
+    mfxStatus AcquireOutput(int regionId);
+    void ReleaseOutput(int regionId);
+
+    // Regions of each worker in ascending order
+    std::vector<std::vector<int>> GetAssignment();
+
+protected:
+    struct RegionFrame {
+        mfxFrameSurface1* pSurface;
+        bool bIDR;
+    };
+
+    void WorkerRoutine(int workerId);
+    // The region of a worker to submit next: the one furthest behind, -1 if none is ready
+    int GetNextRegion(int workerId);
+    // Longest processing time first: the slowest regions go first, each to the least loaded worker
+    void Rebalance();
+
+    EncodeRegionFunc m_encodeRegion;
+    std::vector<std::thread> m_workers;
+    std::vector<std::vector<int>> m_assignment;
+    std::deque<RegionFrame> m_frames; // frames not submitted by all regions yet
+    mfxU64 m_nFirstFrame; // number of the first frame in m_frames
+    mfxU64 m_nFrames; // number of submitted frames
+    std::vector<mfxU64> m_regionNext; // number of the next frame of a region
+    std::vector<int> m_regionOutputs; // encoded frames of a region not written yet
+    std::vector<bool> m_regionBusy; // a worker or the writer is on the region
+    std::vector<mfxStatus> m_regionSts; // the first error of a region
+    std::vector<double> m_regionAvgTime; // moving average of the submit time over frames
+    bool m_bStop;
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+
+private:
+    CRegionWorkers(const CRegionWorkers&)            = delete;
+    CRegionWorkers& operator=(const CRegionWorkers&) = delete;
+};
+
 /* This class implements a pipeline with 2 mfx components: vpp (video preprocessing) and encode */
 class CRegionEncodingPipeline : public CEncodingPipeline {
 public:
@@ -86,6 +160,16 @@ public:
 protected:
     mfxI64 m_timeAll;
     CResourcesPool m_resources;
+    CRegionWorkers m_workers;
+    mfxU16 m_nRegionThreads; // 0 - one worker per region
+
+    // Runs on a worker thread
+    mfxStatus EncodeRegion(int regId, mfxFrameSurface1* pSurface, bool bIDR);
+    // Synchronizes the oldest encoded frame of every region and writes the regions (slices) in
+    // order. Returns MFX_ERR_MORE_DATA if no region had a frame to write.
+    mfxStatus WriteRegions();
+    // Finds an input surface the encoders and the workers are done with
+    mfxStatus GetFreeRegionSurface(mfxU16& nSurfIdx);
 
     virtual mfxStatus InitMfxEncParams(sInputParams* pParams);
 
@@ -78,7 +78,8 @@ CEncTaskPool::CEncTaskPool()
         : firstOut_total(0),
           firstOut_start(0),
           lastOut_total(0),
-          lastOut_start(0) {
+          lastOut_start(0),
+          m_pLiveSource() {
     m_pTasks           = NULL;
     m_pmfxSession      = NULL;
     m_nTaskBufferStart = 0;
@@ -184,6 +185,8 @@ mfxStatus CEncTaskPool::SynchronizeFirstTask(mfxU32 syncOpTimeout) {
                 sts = m_pTasks[m_nTaskBufferStart].WriteBitstream();
                 m_statFile.StopTimeMeasurement();
                 MSDK_CHECK_STATUS(sts, "m_pTasks[m_nTaskBufferStart].WriteBitstream failed");
+                if (m_pLiveSource)
+                    m_pLiveSource->OnFrameOutput();
 
                 sts = m_pTasks[m_nTaskBufferStart].Reset();
                 MSDK_CHECK_STATUS(sts, "m_pTasks[m_nTaskBufferStart].Reset failed");
@@ -1295,6 +1298,7 @@ CEncodingPipeline::CEncodingPipeline()
 #endif
           m_FileWriters(NULL, NULL),
           m_FileReader(),
+          m_pLiveSource(),
           m_TaskPool(),
           m_QPFileReader(),
           m_TCBRCFileReader(),
@@ -1341,7 +1345,7 @@ CEncodingPipeline::CEncodingPipeline()
           m_bPartialOutput(false),
           m_statOverall(),
           m_statFile(),
-          m_fpsLimiter(),
+          m_framePacer(),
           m_verSessionInit(API_2X),
           m_bReadByFrame(false) {
 }
@@ -1835,6 +1839,14 @@ mfxStatus CEncodingPipeline::Init(sInputParams* pParams) {
         // prepare input file reader
         sts = m_FileReader.Init(pParams->InputFiles, pParams->FileInputFourCC, readerShift);
         MSDK_CHECK_STATUS(sts, "m_FileReader.Init failed");
+
+        if (pParams->bLiveSource) {
+            LiveSourceParams live = pParams->LiveSource;
+            ConvertFrameRate(pParams->dFrameRate, &live.RateN, &live.RateD);
+            m_pLiveSource = std::make_shared<CLiveSource>(live);
+            m_FileReader.SetLiveSource(m_pLiveSource);
+            m_TaskPool.SetLiveSource(m_pLiveSource);
+        }
     }
 
     sts = InitFileWriters(pParams);
@@ -1843,7 +1855,7 @@ mfxStatus CEncodingPipeline::Init(sInputParams* pParams) {
     // set memory type
     m_memType  = pParams->memType;
     m_nPerfOpt = pParams->nPerfOpt;
-    m_fpsLimiter.Reset(pParams->nMaxFPS);
+    m_framePacer.Reset(pParams->nMaxFPS, pParams->nMaxFPSDenom);
 
     m_bSoftRobustFlag = pParams->bSoftRobustFlag;
 
@@ -1991,6 +2003,10 @@ void CEncodingPipeline::Close() {
                    (1000.0 * m_TaskPool.lastOut_total) /
                        (freq * m_FileWriters.first->m_nProcessedFramesNum));
         }
+        if (m_framePacer.IsActive())
+            printf("Frame pacing: %s\n", m_framePacer.GetStatistics().ToString().c_str());
+        if (m_pLiveSource)
+            printf("Live source: %s\n", m_pLiveSource->GetStatistics().ToString().c_str());
     }
 
     std::for_each(m_UserDataUnregSEI.begin(), m_UserDataUnregSEI.end(), [](mfxPayload* payload) {
@@ -2226,7 +2242,7 @@ mfxStatus CEncodingPipeline::GetFreeTask(sTask** ppTask) {
     if (MFX_ERR_NOT_FOUND == sts) {
         sts = m_TaskPool.SynchronizeFirstTask(m_nSyncOpTimeout);
         if (MFX_ERR_NONE == sts) {
-            m_fpsLimiter.Work();
+            m_framePacer.Work();
         }
         if (sts == MFX_ERR_GPU_HANG && m_bSoftRobustFlag) {
             m_TaskPool.ClearTasks();
@@ -2618,7 +2634,7 @@ mfxStatus CEncodingPipeline::Run() {
     while (MFX_ERR_NONE == sts) {
         sts = m_TaskPool.SynchronizeFirstTask(m_nSyncOpTimeout);
         if (MFX_ERR_NONE == sts) {
-            m_fpsLimiter.Work();
+            m_framePacer.Work();
         }
         if (sts == MFX_ERR_GPU_HANG && m_bSoftRobustFlag) {
             m_bInsertIDR = true;
@@ -6,6 +6,8 @@
 
 #include "mfx_samples_config.h"
 
+#include <algorithm>
+
 #include "pipeline_region_encode.h"
 #include "sysmem_allocator.h"
 
@@ -27,23 +29,6 @@
     #error MFX_VERSION not defined
 #endif
 
-mfxStatus CResourcesPool::GetFreeTask(int resourceNum, sTask** ppTask) {
-    // get a pointer to a free task (bit stream and sync point for encoder)
-    mfxStatus sts = m_resources[resourceNum].TaskPool.GetFreeTask(ppTask);
-    if (MFX_ERR_NOT_FOUND == sts) {
-        // We should syncrhonize every first task in all task pools to write regions (slices) into destination in correct order
-        for (int i = 0; i < m_size; i++) {
-            sts = m_resources[i].TaskPool.SynchronizeFirstTask(m_nSyncOpTimeout);
-            MSDK_CHECK_STATUS(sts, "m_resources[i].TaskPool.SynchronizeFirstTask failed");
-        }
-
-        // try again
-        sts = m_resources[resourceNum].TaskPool.GetFreeTask(ppTask);
-    }
-
-    return sts;
-}
-
 mfxStatus CResourcesPool::Init(int sz, mfxIMPL impl, mfxVersion* pVer) {
     MSDK_CHECK_NOT_EQUAL(m_resources, NULL, MFX_ERR_INVALID_HANDLE);
     m_size      = sz;
@@ -105,6 +90,205 @@ void CResourcesPool::CloseAndDeleteEverything() {
     }
 }
 
+//------------------- Region workers -----------------------------------------------------------------------
+
+CRegionWorkers::CRegionWorkers()
+        : m_encodeRegion(),
+          m_workers(),
+          m_assignment(),
+          m_frames(),
+          m_nFirstFrame(0),
+          m_nFrames(0),
+          m_regionNext(),
+          m_regionOutputs(),
+          m_regionBusy(),
+          m_regionSts(),
+          m_regionAvgTime(),
+          m_bStop(false),
+          m_mutex(),
+          m_changed() {}
+
+CRegionWorkers::~CRegionWorkers() {
+    Stop();
+}
+
+mfxStatus CRegionWorkers::Start(int numRegions, int numWorkers, EncodeRegionFunc encodeRegion) {
+    MSDK_CHECK_ERROR(m_workers.empty(), false, MFX_ERR_UNDEFINED_BEHAVIOR);
+    if (numRegions <= 0 || numWorkers < 0)
+        return MFX_ERR_INVALID_VIDEO_PARAM;
+    if (!numWorkers || numWorkers > numRegions)
+        numWorkers = numRegions;
+
+    m_encodeRegion = encodeRegion;
+    m_frames.clear();
+    m_nFirstFrame = 0;
+    m_nFrames     = 0;
+    m_regionNext.assign(numRegions, 0);
+    m_regionOutputs.assign(numRegions, 0);
+    m_regionBusy.assign(numRegions, false);
+    m_regionSts.assign(numRegions, MFX_ERR_NONE);
+    m_regionAvgTime.assign(numRegions, 0);
+    m_assignment.assign(numWorkers, std::vector<int>());
+    for (int regId = 0; regId < numRegions; regId++)
+        m_assignment[regId % numWorkers].push_back(regId);
+
+    m_bStop = false;
+    for (int workerId = 0; workerId < numWorkers; workerId++)
+        m_workers.emplace_back(&CRegionWorkers::WorkerRoutine, this, workerId);
+
+    return MFX_ERR_NONE;
+}
+
+void CRegionWorkers::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStop = true;
+    }
+    m_changed.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+    m_workers.clear();
+}
+
+void CRegionWorkers::Submit(mfxFrameSurface1* pSurface, bool bIDR) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frames.push_back({ pSurface, bIDR });
+        m_nFrames++;
+
+        if (m_workers.size() < m_regionNext.size())
+            Rebalance();
+    }
+    m_changed.notify_all();
+}
+
+int CRegionWorkers::GetPending() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int pending = 0;
+    for (size_t regId = 0; regId < m_regionNext.size(); regId++)
+        pending = std::max(pending, (int)(m_nFrames - m_regionNext[regId]) + m_regionOutputs[regId]);
+    return pending;
+}
+
+bool CRegionWorkers::IsQueued(mfxFrameSurface1* pSurface) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& frame : m_frames) {
+        if (frame.pSurface == pSurface)
+            return true;
+    }
+    return false;
+}
+
+mfxStatus CRegionWorkers::AcquireOutput(int regionId) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_changed.wait(lock, [this, regionId]() {
+        return m_regionSts[regionId] < MFX_ERR_NONE ||
+               (!m_regionBusy[regionId] &&
+                (m_regionOutputs[regionId] || m_regionNext[regionId] == m_nFrames));
+    });
+
+    if (m_regionSts[regionId] < MFX_ERR_NONE)
+        return m_regionSts[regionId];
+    if (!m_regionOutputs[regionId])
+        return MFX_ERR_MORE_DATA;
+
+    m_regionBusy[regionId] = true;
+    return MFX_ERR_NONE;
+}
+
+void CRegionWorkers::ReleaseOutput(int regionId) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_regionBusy[regionId] = false;
+        m_regionOutputs[regionId]--;
+    }
+    m_changed.notify_all();
+}
+
+std::vector<std::vector<int>> CRegionWorkers::GetAssignment() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_assignment;
+}
+
+int CRegionWorkers::GetNextRegion(int workerId) {
+    int nextRegId = -1;
+    for (int regId : m_assignment[workerId]) {
+        if (m_regionBusy[regId] || m_regionNext[regId] == m_nFrames)
+            continue;
+        if (nextRegId < 0 || m_regionNext[regId] < m_regionNext[nextRegId])
+            nextRegId = regId;
+    }
+    return nextRegId;
+}
+
+void CRegionWorkers::Rebalance() {
+    std::vector<int> regions;
+    for (int regId = 0; regId < (int)m_regionAvgTime.size(); regId++)
+        regions.push_back(regId);
+    std::stable_sort(regions.begin(), regions.end(), [this](int a, int b) {
+        return m_regionAvgTime[a] > m_regionAvgTime[b];
+    });
+
+    std::vector<double> load(m_assignment.size(), 0);
+    for (auto& workerRegions : m_assignment)
+        workerRegions.clear();
+    for (int regId : regions) {
+        size_t workerId = std::min_element(load.begin(), load.end()) - load.begin();
+        load[workerId] += m_regionAvgTime[regId];
+        m_assignment[workerId].push_back(regId);
+    }
+    for (auto& workerRegions : m_assignment)
+        std::sort(workerRegions.begin(), workerRegions.end());
+}
+
+void CRegionWorkers::WorkerRoutine(int workerId) {
+    for (;;) {
+        int regId         = -1;
+        RegionFrame frame = {};
+        bool bFailed      = false;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_changed.wait(lock, [this, workerId, &regId]() {
+                return m_bStop || (regId = GetNextRegion(workerId)) >= 0;
+            });
+            if (m_bStop)
+                return;
+
+            // a region that has moved to this worker is not submitted by the previous one anymore
+            m_regionBusy[regId] = true;
+            frame               = m_frames[m_regionNext[regId] - m_nFirstFrame];
+            bFailed             = m_regionSts[regId] < MFX_ERR_NONE;
+        }
+
+        // frames of a failed region are skipped, the writer reports the error
+        msdk_tick start = msdk_time_get_tick();
+        mfxStatus sts =
+            bFailed ? MFX_ERR_MORE_DATA : m_encodeRegion(regId, frame.pSurface, frame.bIDR);
+        msdk_tick time = msdk_time_get_tick() - start;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_regionBusy[regId] = false;
+            if (MFX_ERR_NONE == sts)
+                m_regionOutputs[regId]++;
+            else if (MFX_ERR_MORE_DATA != sts)
+                m_regionSts[regId] = sts;
+
+            // the first frame sets the average, later ones move it by 1/8
+            m_regionAvgTime[regId] = m_regionNext[regId]
+                                         ? m_regionAvgTime[regId] +
+                                               (time - m_regionAvgTime[regId]) / 8
+                                         : (double)time;
+            m_regionNext[regId]++;
+
+            mfxU64 nFirstPending = *std::min_element(m_regionNext.begin(), m_regionNext.end());
+            for (; m_nFirstFrame < nFirstPending; m_nFirstFrame++)
+                m_frames.pop_front();
+        }
+        m_changed.notify_all();
+    }
+}
+
 //------------------- Pipeline -----------------------------------------------------------------------------
 
 mfxStatus CRegionEncodingPipeline::InitMfxEncParams(sInputParams* pInParams) {
@@ -125,7 +309,6 @@ mfxStatus CRegionEncodingPipeline::InitMfxEncParams(sInputParams* pInParams) {
         MSDK_ZERO_MEMORY(m_mfxEncParams.mfx.reserved5);
     }
 
-    m_mfxEncParams.AsyncDepth     = 1;
     m_mfxEncParams.mfx.GopRefDist = 1;
 
     return MFX_ERR_NONE;
@@ -263,7 +446,10 @@ mfxStatus CRegionEncodingPipeline::CreateAllocator() {
     return MFX_ERR_NONE;
 }
 
-CRegionEncodingPipeline::CRegionEncodingPipeline() : CEncodingPipeline() {
+CRegionEncodingPipeline::CRegionEncodingPipeline()
+        : CEncodingPipeline(),
+          m_workers(),
+          m_nRegionThreads(0) {
     m_timeAll = 0;
 }
 
@@ -294,6 +480,8 @@ mfxStatus CRegionEncodingPipeline::Init(sInputParams* pParams) {
     m_timeAll = 0;
     if (pParams->nNumSlice == 0)
         pParams->nNumSlice = 1;
+    m_nRegionThreads = pParams->nRegionThreads;
+    m_nSyncOpTimeout = pParams->nSyncOpTimeout ? pParams->nSyncOpTimeout : MSDK_WAIT_INTERVAL;
 
     // Init session
     if (pParams->bUseHWLib) {
@@ -326,8 +514,8 @@ mfxStatus CRegionEncodingPipeline::Init(sInputParams* pParams) {
     }
 
     mfxVersion version;
-    sts = m_mfxSession.QueryVersion(&version);
-    MSDK_CHECK_STATUS(sts, "m_mfxSession.QueryVersion failed");
+    sts = GetFirstSession().QueryVersion(&version);
+    MSDK_CHECK_STATUS(sts, "GetFirstSession().QueryVersion failed");
 
     if ((pParams->MVC_flags & MVC_ENABLED) != 0 && !CheckVersion(&version, MSDK_FEATURE_MVC)) {
         printf("error: MVC is not supported in the %d.%d API version\n",
@@ -389,6 +577,8 @@ mfxStatus CRegionEncodingPipeline::Init(sInputParams* pParams) {
 }
 
 void CRegionEncodingPipeline::Close() {
+    m_workers.Stop();
+
     if (m_FileWriters.first) {
         mfxU32 frameNum = m_resources.GetSize()
                               ? m_FileWriters.first->m_nProcessedFramesNum / m_resources.GetSize()
@@ -416,6 +606,8 @@ mfxStatus CRegionEncodingPipeline::ResetMFXComponents(sInputParams* pParams) {
 
     mfxStatus sts = MFX_ERR_NONE;
 
+    m_workers.Stop();
+
     for (int i = 0; i < m_resources.GetSize(); i++) {
         if (m_resources[i].pEncoder) {
             sts = m_resources[i].pEncoder->Close();
@@ -460,42 +652,127 @@ mfxStatus CRegionEncodingPipeline::ResetMFXComponents(sInputParams* pParams) {
                                     pParams->bUseHWLib);
     MSDK_CHECK_STATUS(sts, "m_resources.InitTaskPools failed");
 
+    sts = m_workers.Start(m_resources.GetSize(),
+                          m_nRegionThreads,
+                          [this](int regId, mfxFrameSurface1* pSurface, bool bIDR) {
+                              return EncodeRegion(regId, pSurface, bIDR);
+                          });
+    MSDK_CHECK_STATUS(sts, "m_workers.Start failed");
+
     sts = FillBuffers();
     MSDK_CHECK_STATUS(sts, "FillBuffers failed");
 
     return MFX_ERR_NONE;
 }
 
-mfxStatus CRegionEncodingPipeline::Run() {
-    mfxI64 timeCurStart = 0;
-    mfxI64 timeCurEnd   = 0;
-    mfxI64 timeCurMax;
-    mfxI64 nFrames = 0;
+mfxStatus CRegionEncodingPipeline::EncodeRegion(int regId, mfxFrameSurface1* pSurface, bool bIDR) {
+    // Run keeps fewer frames in flight than the pool has tasks, a task is always free
+    sTask* pTask  = NULL;
+    mfxStatus sts = m_resources[regId].TaskPool.GetFreeTask(&pTask);
+    MSDK_CHECK_STATUS(sts, "m_resources[regId].TaskPool.GetFreeTask failed");
+
+    InsertIDR(pTask->encCtrl, bIDR);
+
+    for (;;) {
+        sts = m_resources[regId].pEncoder->EncodeFrameAsync(&pTask->encCtrl,
+                                                            pSurface,
+                                                            &pTask->mfxBS,
+                                                            &pTask->EncSyncP);
+
+        if (MFX_ERR_NONE < sts && !pTask->EncSyncP) // repeat the call if warning and no output
+        {
+            if (MFX_WRN_DEVICE_BUSY == sts)
+                MSDK_SLEEP(1); // wait if device is busy, other regions go on
+        }
+        else if (MFX_ERR_NONE < sts && pTask->EncSyncP) {
+            sts = MFX_ERR_NONE; // ignore warnings if output is available
+            break;
+        }
+        else if (MFX_ERR_NOT_ENOUGH_BUFFER == sts) {
+            // ask the region's own encoder, the others may be busy on their threads
+            mfxVideoParam par;
+            MSDK_ZERO_MEMORY(par);
+            sts = m_resources[regId].pEncoder->GetVideoParam(&par);
+            MSDK_CHECK_STATUS(sts, "m_resources[regId].pEncoder->GetVideoParam failed");
+            pTask->mfxBS.Extend(par.mfx.BufferSizeInKB *
+                                std::max<mfxU32>(par.mfx.BRCParamMultiplier, 1) * 1000u);
+            continue;
+        }
+        else {
+            MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_BITSTREAM);
+            break;
+        }
+    }
+    if (MFX_ERR_NONE == sts && !pTask->EncSyncP)
+        return MFX_ERR_MORE_DATA;
+
+    // the writer synchronizes the task
+    return sts;
+}
+
+mfxStatus CRegionEncodingPipeline::WriteRegions() {
+    mfxStatus sts = MFX_ERR_MORE_DATA;
+
+    // regions (slices) go to the destination in order
+    for (int regId = 0; regId < m_resources.GetSize(); regId++) {
+        mfxStatus outSts = m_workers.AcquireOutput(regId);
+        if (MFX_ERR_MORE_DATA == outSts)
+            continue;
+        MSDK_CHECK_STATUS(outSts, "EncodeRegion failed");
+
+        do {
+            outSts = m_resources[regId].TaskPool.SynchronizeFirstTask(m_nSyncOpTimeout);
+        } while (MFX_WRN_IN_EXECUTION == outSts);
+        m_workers.ReleaseOutput(regId);
+        MSDK_CHECK_STATUS(outSts, "m_resources[regId].TaskPool.SynchronizeFirstTask failed");
+
+        sts = MFX_ERR_NONE;
+    }
+
+    return sts;
+}
 
+mfxStatus CRegionEncodingPipeline::GetFreeRegionSurface(mfxU16& nSurfIdx) {
+    for (;;) {
+        for (nSurfIdx = 0; nSurfIdx < m_EncResponse.NumFrameActual; nSurfIdx++) {
+            mfxFrameSurface1* pSurf = &m_pEncSurfaces[nSurfIdx];
+            if (!pSurf->Data.Locked && !m_workers.IsQueued(pSurf))
+                return MFX_ERR_NONE;
+        }
+        if (!m_workers.GetPending())
+            return MFX_ERR_MEMORY_ALLOC;
+
+        // the encoders unlock the surfaces of written frames
+        mfxStatus sts = WriteRegions();
+        MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_DATA);
+        MSDK_CHECK_STATUS(sts, "WriteRegions failed");
+    }
+}
+
+mfxStatus CRegionEncodingPipeline::Run() {
     mfxStatus sts = MFX_ERR_NONE;
 
     mfxFrameSurface1* pSurf = NULL; // dispatching pointer
-
-    sTask* pCurrentTask = NULL; // a pointer to the current task
-    mfxU16 nEncSurfIdx  = 0; // index of free surface for encoder input (vpp output)
+    mfxU16 nEncSurfIdx      = 0; // index of free surface for encoder input (vpp output)
 
     // Since in sample we support just 2 views
     // we will change this value between 0 and 1 in case of MVC
     mfxU16 currViewNum = 0;
 
-    sts = MFX_ERR_NONE;
     m_statOverall.StartTimeMeasurement();
+    msdk_tick timeStart = time_get_tick();
 
-    // main loop, preprocessing and encoding
+    // main loop, the regions encode up to AsyncDepth frames on their workers while the next frames
+    // are loaded
     while (MFX_ERR_NONE <= sts || MFX_ERR_MORE_DATA == sts) {
         // find free surface for encoder input
         if (m_nPerfOpt) {
             nEncSurfIdx %= m_nPerfOpt;
         }
         else {
-            nEncSurfIdx = GetFreeSurface(m_pEncSurfaces, m_EncResponse.NumFrameActual);
+            sts = GetFreeRegionSurface(nEncSurfIdx);
+            MSDK_CHECK_STATUS(sts, "GetFreeRegionSurface failed");
         }
-        MSDK_CHECK_ERROR(nEncSurfIdx, MSDK_INVALID_SURF_IDX, MFX_ERR_MEMORY_ALLOC);
 
         // point pSurf to encoder surface
         pSurf                      = &m_pEncSurfaces[nEncSurfIdx];
@@ -511,9 +788,6 @@ mfxStatus CRegionEncodingPipeline::Run() {
             currViewNum ^= 1; // Flip between 0 and 1 for ViewId
         MSDK_BREAK_ON_ERROR(sts);
 
-        m_statFile.StopTimeMeasurement();
-
-        timeCurMax = 0;
         if (m_bFileWriterReset) {
             if (m_FileWriters.first) {
                 sts = m_FileWriters.first->Reset();
@@ -525,56 +799,20 @@ mfxStatus CRegionEncodingPipeline::Run() {
             }
             m_bFileWriterReset = false;
         }
-        for (int regId = 0; regId < m_resources.GetSize(); regId++) {
-            // get a pointer to a free task (bit stream and sync point for encoder)
-            sts = m_resources.GetFreeTask(regId, &pCurrentTask);
-            MSDK_CHECK_STATUS(sts, "m_resources.GetFreeTask failed");
-
-            for (;;) {
-                timeCurStart = time_get_tick();
-                // at this point surface for encoder contains a frame from a file
-
-                InsertIDR(pCurrentTask->encCtrl, m_bInsertIDR);
-                m_bInsertIDR = false;
-
-                sts = m_resources[regId].pEncoder->EncodeFrameAsync(&pCurrentTask->encCtrl,
-                                                                    &m_pEncSurfaces[nEncSurfIdx],
-                                                                    &pCurrentTask->mfxBS,
-                                                                    &pCurrentTask->EncSyncP);
-
-                if ((sts != MFX_ERR_NOT_ENOUGH_BUFFER) && m_nPerfOpt) {
-                    nEncSurfIdx++;
-                }
-
-                if (MFX_ERR_NONE < sts &&
-                    !pCurrentTask->EncSyncP) // repeat the call if warning and no output
-                {
-                    if (MFX_WRN_DEVICE_BUSY == sts)
-                        MSDK_SLEEP(1); // wait if device is busy
-                }
-                else if (MFX_ERR_NONE < sts && pCurrentTask->EncSyncP) {
-                    sts = MFX_ERR_NONE; // ignore warnings if output is available
-                    break;
-                }
-                else if (MFX_ERR_NOT_ENOUGH_BUFFER == sts) {
-                    sts = AllocateSufficientBuffer(pCurrentTask->mfxBS);
-                    MSDK_CHECK_STATUS(sts, "AllocateSufficientBuffer failed");
-                    continue;
-                }
-                else {
-                    // get next surface and new task for 2nd bitstream in ViewOutput mode
-                    MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_BITSTREAM);
-                    break;
-                }
-            }
 
-            timeCurEnd = time_get_tick();
-            if (timeCurMax < (timeCurEnd - timeCurStart))
-                timeCurMax = timeCurEnd - timeCurStart;
+        // a task of every region must stay free for the new frame
+        while (m_workers.GetPending() >= m_mfxEncParams.AsyncDepth) {
+            sts = WriteRegions();
+            MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_DATA);
+            MSDK_CHECK_STATUS(sts, "WriteRegions failed");
         }
-        if (timeCurMax) {
-            nFrames++;
-            m_timeAll += timeCurMax;
+
+        // all regions of the frame get the same frame type
+        m_workers.Submit(pSurf, m_bInsertIDR);
+        m_bInsertIDR = false;
+
+        if (m_nPerfOpt) {
+            nEncSurfIdx++;
         }
     }
 
@@ -583,69 +821,23 @@ mfxStatus CRegionEncodingPipeline::Run() {
     // exit in case of other errors
     MSDK_CHECK_STATUS(sts, "Unexpected error!!");
 
+    // write the frames in flight
+    while (m_workers.GetPending()) {
+        sts = WriteRegions();
+        MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_DATA);
+        MSDK_CHECK_STATUS(sts, "WriteRegions failed");
+    }
+
     // loop to get buffered frames from encoder
     while (MFX_ERR_NONE <= sts) {
-        timeCurMax = 0;
-        for (int regId = 0; regId < m_resources.GetSize(); regId++) {
-            // get a free task (bit stream and sync point for encoder)
-            sts = m_resources.GetFreeTask(regId, &pCurrentTask);
-            MSDK_CHECK_STATUS(sts, "m_resources.GetFreeTask failed");
-
-            for (;;) {
-                timeCurStart = time_get_tick();
-
-                InsertIDR(pCurrentTask->encCtrl, m_bInsertIDR);
-                m_bInsertIDR = false;
-
-                sts = m_resources[regId].pEncoder->EncodeFrameAsync(&pCurrentTask->encCtrl,
-                                                                    NULL,
-                                                                    &pCurrentTask->mfxBS,
-                                                                    &pCurrentTask->EncSyncP);
-
-                if (MFX_ERR_NONE < sts &&
-                    !pCurrentTask->EncSyncP) // repeat the call if warning and no output
-                {
-                    if (MFX_WRN_DEVICE_BUSY == sts)
-                        MSDK_SLEEP(1); // wait if device is busy
-                }
-                else if (MFX_ERR_NONE < sts && pCurrentTask->EncSyncP) {
-                    sts = MFX_ERR_NONE; // ignore warnings if output is available
-                    break;
-                }
-                else if (MFX_ERR_NOT_ENOUGH_BUFFER == sts) {
-                    sts = AllocateSufficientBuffer(pCurrentTask->mfxBS);
-                    MSDK_CHECK_STATUS(sts, "AllocateSufficientBuffer failed");
-                    continue;
-                }
-                else {
-                    // get new task for 2nd bitstream in ViewOutput mode
-                    MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_BITSTREAM);
-                    break;
-                }
-            }
-
-            // MFX_ERR_MORE_DATA is the correct status to exit buffering loop with
-            // indicates that there are no more buffered frames
-            if (sts == MFX_ERR_MORE_DATA)
-                continue;
-            // exit in case of other errors
-            MSDK_CHECK_STATUS(sts, "m_resources[regId].pEncoder->EncodeFrameAsync failed");
-
-            timeCurEnd = time_get_tick();
-            if (timeCurMax < (timeCurEnd - timeCurStart))
-                timeCurMax = timeCurEnd - timeCurStart;
-        }
-        if (timeCurMax) {
-            nFrames++;
-            m_timeAll += timeCurMax;
-        }
+        m_workers.Submit(NULL, false);
+        // MFX_ERR_MORE_DATA is the correct status to exit buffering loop with
+        // indicates that there are no more buffered frames
+        sts = WriteRegions();
     }
+    m_timeAll += time_get_tick() - timeStart;
 
     MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_DATA);
-
-    // MFX_ERR_NOT_FOUND is the correct status to exit the loop with
-    // EncodeFrameAsync and SyncOperation don't return this status
-    MSDK_IGNORE_MFX_STS(sts, MFX_ERR_NOT_FOUND);
     // report any errors that occurred in asynchronous part
     MSDK_CHECK_STATUS(sts, "Unexpected error!!");
 
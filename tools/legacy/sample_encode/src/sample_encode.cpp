@@ -214,6 +214,10 @@ void PrintHelp(char* strAppName, const char* strErrorMessage, ...) {
         "   [-BitrateLimit:<on,off>] - Turn this flag ON to set bitrate limitations imposed by the SDK encoder. Off by default.\n");
     printf(
         "   [-re]                    - enable region encode mode. Works only with h265 encoder\n");
+    printf(
+        "   [-re_threads N]          - number of threads encoding regions, 0 (default) is one per region.\n"
+        "                              The number of threads doesn't adapt, rebalancing only\n"
+        "                              reassigns regions to threads by their encode time\n");
     printf("   [-trows rows]            - Number of rows for tiled encoding\n");
     printf("   [-tcols cols]            - Number of columns for tiled encoding\n");
     printf("   [-CodecProfile]          - specifies codec profile\n");
@@ -254,7 +258,16 @@ void PrintHelp(char* strAppName, const char* strErrorMessage, ...) {
     printf("   [-syncop_timeout]        - SyncOperation timeout in milliseconds\n");
     printf(
         "   [-perf_opt n]            - sets number of prefetched frames. In performance mode app preallocates buffer and loads first n frames\n");
-    printf("   [-fps]                   - limits overall fps of pipeline\n");
+    printf("   [-fps N[/D]]             - limits overall fps of pipeline, e.g. 30000/1001\n");
+    printf(
+        "   [-live]                  - emulate a live feed: input frames arrive at the frame rate of -f\n"
+        "                              and end-to-end latency is reported\n");
+    printf(
+        "   [-live_jitter us]        - frames of the live feed arrive up to us microseconds late\n");
+    printf(
+        "   [-live_burst N L]        - the first L of every N frames of the live feed arrive at once\n");
+    printf(
+        "   [-live_deadline ms]      - latency counted as a deadline miss, two frame periods by default\n");
     printf(
         "   [-uncut]                 - do not cut output file in looped mode (in case of -timeout option)\n");
     printf(
@@ -582,11 +595,41 @@ mfxStatus ParseAdditionalParams(char* strInput[],
     else if (msdk_match(strInput[i], "-fps")) {
         VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
 
-        if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nMaxFPS)) {
+        if (MFX_ERR_NONE !=
+            ParseFrameRate(strInput[++i], pParams->nMaxFPS, pParams->nMaxFPSDenom)) {
             PrintHelp(strInput[0], "overall fps is invalid");
             return MFX_ERR_UNSUPPORTED;
         }
     }
+    else if (msdk_match(strInput[i], "-live")) {
+        pParams->bLiveSource = true;
+    }
+    else if (msdk_match(strInput[i], "-live_jitter")) {
+        VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+
+        if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->LiveSource.JitterUs)) {
+            PrintHelp(strInput[0], "live jitter is invalid");
+            return MFX_ERR_UNSUPPORTED;
+        }
+    }
+    else if (msdk_match(strInput[i], "-live_burst")) {
+        VAL_CHECK(i + 2 >= nArgNum, i, strInput[i]);
+
+        if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->LiveSource.BurstInterval) ||
+            MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->LiveSource.BurstLength) ||
+            pParams->LiveSource.BurstLength > pParams->LiveSource.BurstInterval) {
+            PrintHelp(strInput[0], "live burst is invalid");
+            return MFX_ERR_UNSUPPORTED;
+        }
+    }
+    else if (msdk_match(strInput[i], "-live_deadline")) {
+        VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+
+        if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->LiveSource.DeadlineMs)) {
+            PrintHelp(strInput[0], "live deadline is invalid");
+            return MFX_ERR_UNSUPPORTED;
+        }
+    }
     else if (msdk_match(strInput[i], "-TargetBitDepthLuma")) {
         VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
 
@@ -1475,6 +1518,13 @@ mfxStatus ParseInputString(char* strInput[], mfxU32 nArgNum, sInputParams* pPara
         else if (msdk_match(strInput[i], "-re")) {
             pParams->UseRegionEncode = true;
         }
+        else if (msdk_match(strInput[i], "-re_threads")) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nRegionThreads)) {
+                PrintHelp(strInput[0], "Number of region threads is invalid");
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
 #if defined(_WIN64) || defined(_WIN32)
         else if (msdk_match(strInput[i], "-PartialOutput")) {
             VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
@@ -1748,6 +1798,12 @@ mfxStatus ParseInputString(char* strInput[], mfxU32 nArgNum, sInputParams* pPara
         pParams->nAsyncDepth = 4;
     }
 
+    if (pParams->bLiveSource && pParams->nPerfOpt) {
+        PrintHelp(strInput[0],
+                  "-live reads frames when they arrive, it can't be used with -perf_opt");
+        return MFX_ERR_UNSUPPORTED;
+    }
+
     if (pParams->nNumFrames == 0 && pParams->nPerfOpt > 0) {
         printf(
             "Warning: if -n is not specified, number of frames to be encoded is dictated by -perf_opt.\n");
@@ -0,0 +1,467 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+// Stub runtime (libvpl/test/runtimes/stub) with an encoder that takes a set time per frame.
+// It stands in for the runtime of the region sessions in sample_encode_test. Every session encodes
+// its frames one after the other in the background, with the latency of its region:
+//   SAMPLE_ENCODE_TEST_RT_LATENCY - ms per frame of each region, e.g. "20/2,5" - region 0 takes
+//                                   20 and 2 ms by turns, region 1 5 ms
+//   SAMPLE_ENCODE_TEST_RT_SUBMIT  - ms EncodeFrameAsync of each region takes, e.g. "10,0"
+// A task locks its surface until SyncOperation, which reads the surface and writes one line
+// "region R frame F data Y idr I inflight N" into the bitstream, Y being the first luma byte.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vpl/mfx.h"
+
+#define SLICE_SIZE 128
+
+typedef std::chrono::steady_clock Clock;
+
+struct DelayTask {
+    mfxFrameSurface1 *surface;
+    mfxBitstream *bs;
+    mfxU32 frameOrder; // frames the session got before this one
+    bool idr;
+    mfxU32 inFlight; // tasks of the session in flight with this one
+    Clock::time_point ready;
+};
+
+struct DelayEncoder {
+    mfxVideoParam par;
+    mfxU16 regionId;
+    std::vector<int> latencyMs;
+    int submitMs;
+    mfxU32 submitted;
+    Clock::time_point lastReady;
+    std::list<DelayTask> tasks; // sync points point to the tasks
+
+    DelayEncoder()
+            : par(),
+              regionId(0),
+              latencyMs(),
+              submitMs(0),
+              submitted(0),
+              lastReady(),
+              tasks() {}
+};
+
+static std::mutex g_mutex;
+static std::map<mfxSession, DelayEncoder> g_encoders;
+
+static DelayEncoder *FindEncoder(mfxSession session) {
+    auto it = g_encoders.find(session);
+    return it != g_encoders.end() ? &it->second : nullptr;
+}
+
+// Delays of region regionId in a list of regions separated by ',', 0 if not given
+static std::vector<int> GetRegionDelays(const char *name, mfxU16 regionId) {
+    std::vector<int> delays;
+    const char *value = getenv(name);
+    std::string regions(value ? value : "");
+
+    size_t start = 0;
+    for (mfxU16 i = 0; i < regionId && start != std::string::npos; i++) {
+        start = regions.find(',', start);
+        if (start != std::string::npos)
+            start++;
+    }
+    if (start != std::string::npos) {
+        std::string region = regions.substr(start, regions.find(',', start) - start);
+        for (size_t pos = 0; pos < region.size(); pos = region.find('/', pos) + 1) {
+            delays.push_back(atoi(region.c_str() + pos));
+            if (region.find('/', pos) == std::string::npos)
+                break;
+        }
+    }
+    if (delays.empty())
+        delays.push_back(0);
+
+    return delays;
+}
+
+mfxStatus MFXInit(mfxIMPL implParam, mfxVersion *ver, mfxSession *session) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXJoinSession(mfxSession session, mfxSession child) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXSetPriority(mfxSession session, mfxPriority priority) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXGetPriority(mfxSession session, mfxPriority *priority) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoCORE_SetFrameAllocator(mfxSession session, mfxFrameAllocator *allocator) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoCORE_SetHandle(mfxSession session, mfxHandleType type, mfxHDL hdl) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoCORE_GetHandle(mfxSession session, mfxHandleType type, mfxHDL *hdl) {
+    // per spec, GetHandle returns UNDEFINED_BEHAVIOR for unknown handle type, which for stub RT is currently all types
+    return MFX_ERR_UNDEFINED_BEHAVIOR;
+}
+
+mfxStatus MFXVideoCORE_QueryPlatform(mfxSession session, mfxPlatform *platform) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoCORE_SyncOperation(mfxSession session, mfxSyncPoint syncp, mfxU32 wait) {
+    std::unique_lock<std::mutex> lock(g_mutex);
+    DelayEncoder *encoder = FindEncoder(session);
+    if (!encoder)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    auto task = encoder->tasks.begin();
+    while (task != encoder->tasks.end() && reinterpret_cast<mfxSyncPoint>(&*task) != syncp)
+        task++;
+    if (task == encoder->tasks.end())
+        return MFX_ERR_NULL_PTR;
+
+    // the encoder is done with the frame once its latency has passed
+    Clock::time_point ready = task->ready;
+    lock.unlock();
+    if (ready > Clock::now() + std::chrono::milliseconds(wait)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(wait));
+        return MFX_WRN_IN_EXECUTION;
+    }
+    std::this_thread::sleep_until(ready);
+    lock.lock();
+
+    // the surface is read when the frame is encoded, it has to stay untouched until then
+    mfxFrameSurface1 *surface = task->surface;
+    mfxBitstream *bs          = task->bs;
+    char slice[SLICE_SIZE];
+    int size = snprintf(slice,
+                        sizeof(slice),
+                        "region %u frame %u data %u idr %u inflight %u\n",
+                        (unsigned)encoder->regionId,
+                        (unsigned)task->frameOrder,
+                        (unsigned)(surface->Data.Y ? surface->Data.Y[0] : 0),
+                        (unsigned)task->idr,
+                        (unsigned)task->inFlight);
+    memcpy(bs->Data + bs->DataOffset + bs->DataLength, slice, size);
+    bs->DataLength += size;
+    bs->FrameType = task->idr ? MFX_FRAMETYPE_I | MFX_FRAMETYPE_IDR | MFX_FRAMETYPE_REF
+                              : MFX_FRAMETYPE_P | MFX_FRAMETYPE_REF;
+
+    surface->Data.Locked--;
+    encoder->tasks.erase(task);
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoDECODE_DecodeHeader(mfxSession session, mfxBitstream *bs, mfxVideoParam *par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_Query(mfxSession session, mfxVideoParam *in, mfxVideoParam *out) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_QueryIOSurf(mfxSession session,
+                                     mfxVideoParam *par,
+                                     mfxFrameAllocRequest *request) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_Init(mfxSession session, mfxVideoParam *par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_Close(mfxSession session) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_DecodeFrameAsync(mfxSession session,
+                                          mfxBitstream *bs,
+                                          mfxFrameSurface1 *surface_work,
+                                          mfxFrameSurface1 **surface_out,
+                                          mfxSyncPoint *syncp) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_GetVideoParam(mfxSession session, mfxVideoParam *par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_Reset(mfxSession session, mfxVideoParam *par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_GetDecodeStat(mfxSession session, mfxDecodeStat *stat) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_SetSkipMode(mfxSession session, mfxSkipMode mode) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_GetPayload(mfxSession session, mfxU64 *ts, mfxPayload *payload) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_VPP_Init(mfxSession session,
+                                  mfxVideoParam *decode_par,
+                                  mfxVideoChannelParam **vpp_par_array,
+                                  mfxU32 num_vpp_par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_VPP_DecodeFrameAsync(mfxSession session,
+                                              mfxBitstream *bs,
+                                              mfxU32 *skip_channels,
+                                              mfxU32 num_skip_channels,
+                                              mfxSurfaceArray **surf_array_out) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_VPP_Reset(mfxSession session,
+                                   mfxVideoParam *decode_par,
+                                   mfxVideoChannelParam **vpp_par_array,
+                                   mfxU32 num_vpp_par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_VPP_GetChannelParam(mfxSession session,
+                                             mfxVideoChannelParam *par,
+                                             mfxU32 channel_id) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_VPP_Close(mfxSession session) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoENCODE_Query(mfxSession session, mfxVideoParam *in, mfxVideoParam *out) {
+    if (!out)
+        return MFX_ERR_NULL_PTR;
+
+    // any parameters are supported
+    if (in && in != out) {
+        out->mfx        = in->mfx;
+        out->IOPattern  = in->IOPattern;
+        out->AsyncDepth = in->AsyncDepth;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoENCODE_QueryIOSurf(mfxSession session,
+                                     mfxVideoParam *par,
+                                     mfxFrameAllocRequest *request) {
+    if (!par || !request)
+        return MFX_ERR_NULL_PTR;
+
+    // every frame in flight locks its surface
+    request->Info              = par->mfx.FrameInfo;
+    request->NumFrameMin       = 1;
+    request->NumFrameSuggested = std::max<mfxU16>(par->AsyncDepth, 1);
+    request->Type              = MFX_MEMTYPE_EXTERNAL_FRAME | MFX_MEMTYPE_FROM_ENCODE;
+    request->Type |= MFX_MEMTYPE_SYSTEM_MEMORY;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoENCODE_Init(mfxSession session, mfxVideoParam *par) {
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!par)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (FindEncoder(session))
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    DelayEncoder &encoder   = g_encoders[session];
+    encoder.par             = *par;
+    encoder.par.NumExtParam = 0;
+    encoder.par.ExtParam    = nullptr;
+    if (!encoder.par.AsyncDepth)
+        encoder.par.AsyncDepth = 1;
+
+    for (mfxU16 i = 0; i < par->NumExtParam; i++) {
+        if (par->ExtParam[i] && par->ExtParam[i]->BufferId == MFX_EXTBUFF_HEVC_REGION)
+            encoder.regionId = ((mfxExtHEVCRegion *)par->ExtParam[i])->RegionId;
+    }
+    encoder.latencyMs = GetRegionDelays("SAMPLE_ENCODE_TEST_RT_LATENCY", encoder.regionId);
+    encoder.submitMs  = GetRegionDelays("SAMPLE_ENCODE_TEST_RT_SUBMIT", encoder.regionId)[0];
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoENCODE_Close(mfxSession session) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    DelayEncoder *encoder = FindEncoder(session);
+    if (!encoder)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    for (auto &task : encoder->tasks)
+        task.surface->Data.Locked--;
+    g_encoders.erase(session);
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoENCODE_EncodeFrameAsync(mfxSession session,
+                                          mfxEncodeCtrl *ctrl,
+                                          mfxFrameSurface1 *surface,
+                                          mfxBitstream *bs,
+                                          mfxSyncPoint *syncp) {
+    if (!bs || !syncp)
+        return MFX_ERR_NULL_PTR;
+
+    std::unique_lock<std::mutex> lock(g_mutex);
+    DelayEncoder *encoder = FindEncoder(session);
+    if (!encoder)
+        return MFX_ERR_NOT_INITIALIZED;
+    // no frames are buffered
+    if (!surface)
+        return MFX_ERR_MORE_DATA;
+    if (encoder->tasks.size() >= encoder->par.AsyncDepth)
+        return MFX_WRN_DEVICE_BUSY;
+    if (bs->MaxLength - bs->DataOffset - bs->DataLength < SLICE_SIZE)
+        return MFX_ERR_NOT_ENOUGH_BUFFER;
+
+    // the part of the work done by the calling thread
+    int submitMs = encoder->submitMs;
+    lock.unlock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(submitMs));
+    lock.lock();
+
+    // the frames of a session are encoded one after the other
+    Clock::time_point start = std::max(Clock::now(), encoder->lastReady);
+    int latencyMs           = encoder->latencyMs[encoder->submitted % encoder->latencyMs.size()];
+
+    DelayTask task  = {};
+    task.surface    = surface;
+    task.bs         = bs;
+    task.frameOrder = encoder->submitted++;
+    task.idr        = ctrl && (ctrl->FrameType & MFX_FRAMETYPE_IDR);
+    task.inFlight   = (mfxU32)encoder->tasks.size() + 1;
+    task.ready      = start + std::chrono::milliseconds(latencyMs);
+
+    encoder->lastReady = task.ready;
+    encoder->tasks.push_back(task);
+
+    surface->Data.Locked++;
+    *syncp = reinterpret_cast<mfxSyncPoint>(&encoder->tasks.back());
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoENCODE_Reset(mfxSession session, mfxVideoParam *par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoENCODE_GetVideoParam(mfxSession session, mfxVideoParam *par) {
+    if (!par)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    DelayEncoder *encoder = FindEncoder(session);
+    if (!encoder)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    par->mfx        = encoder->par.mfx;
+    par->IOPattern  = encoder->par.IOPattern;
+    par->AsyncDepth = encoder->par.AsyncDepth;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoENCODE_GetEncodeStat(mfxSession session, mfxEncodeStat *stat) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoVPP_Query(mfxSession session, mfxVideoParam *in, mfxVideoParam *out) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoVPP_QueryIOSurf(mfxSession session,
+                                  mfxVideoParam *par,
+                                  mfxFrameAllocRequest request[2]) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoVPP_Init(mfxSession session, mfxVideoParam *par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoVPP_Close(mfxSession session) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoVPP_GetVideoParam(mfxSession session, mfxVideoParam *par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoVPP_RunFrameVPPAsync(mfxSession session,
+                                       mfxFrameSurface1 *in,
+                                       mfxFrameSurface1 *out,
+                                       mfxExtVppAuxData *aux,
+                                       mfxSyncPoint *syncp) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoVPP_Reset(mfxSession session, mfxVideoParam *par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoVPP_GetVPPStat(mfxSession session, mfxVPPStat *stat) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoVPP_ProcessFrameAsync(mfxSession session,
+                                        mfxFrameSurface1 *in,
+                                        mfxFrameSurface1 **out) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+// memory functions are associated with initialized session
+mfxStatus MFXMemory_GetSurfaceForVPP(mfxSession session, mfxFrameSurface1 **surface) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXMemory_GetSurfaceForEncode(mfxSession session, mfxFrameSurface1 **surface) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXMemory_GetSurfaceForDecode(mfxSession session, mfxFrameSurface1 **surface) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXMemory_GetSurfaceForVPPOut(mfxSession session, mfxFrameSurface1 **surface) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+// DLL entry point
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+BOOL APIENTRY DllMain(HMODULE, DWORD, LPVOID lpReserved) {
+    return TRUE;
+} // BOOL APIENTRY DllMain(HMODULE hModule,
+#else // #if defined(_WIN32) || defined(_WIN64)
+void __attribute__((constructor)) dll_init(void) {}
+#endif // #if defined(_WIN32) || defined(_WIN64)
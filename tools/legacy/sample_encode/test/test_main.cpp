@@ -0,0 +1,275 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "pipeline_region_encode.h"
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+TEST(Encode_RegionWorkers, StartChecksArguments) {
+    auto encodeRegion = [](int, mfxFrameSurface1*, bool) {
+        return MFX_ERR_MORE_DATA;
+    };
+    CRegionWorkers workers;
+    EXPECT_EQ(workers.Start(0, 0, encodeRegion), MFX_ERR_INVALID_VIDEO_PARAM);
+    EXPECT_EQ(workers.Start(2, -1, encodeRegion), MFX_ERR_INVALID_VIDEO_PARAM);
+
+    // no more workers than regions
+    ASSERT_EQ(workers.Start(2, 8, encodeRegion), MFX_ERR_NONE);
+    EXPECT_EQ(workers.GetAssignment(), std::vector<std::vector<int>>({ { 0 }, { 1 } }));
+    EXPECT_EQ(workers.Start(2, 0, encodeRegion), MFX_ERR_UNDEFINED_BEHAVIOR);
+    workers.Stop();
+
+    ASSERT_EQ(workers.Start(3, 2, encodeRegion), MFX_ERR_NONE);
+    EXPECT_EQ(workers.GetAssignment(), std::vector<std::vector<int>>({ { 0, 2 }, { 1 } }));
+}
+
+TEST(Encode_RegionWorkers, WriterGetsTheErrorOfARegion) {
+    CRegionWorkers workers;
+    ASSERT_EQ(workers.Start(3,
+                            0,
+                            [](int regionId, mfxFrameSurface1*, bool) {
+                                return regionId == 1 ? MFX_ERR_DEVICE_FAILED : MFX_ERR_NONE;
+                            }),
+              MFX_ERR_NONE);
+
+    mfxFrameSurface1 surface = {};
+    workers.Submit(&surface, false);
+    workers.Submit(&surface, false);
+    EXPECT_EQ(workers.AcquireOutput(0), MFX_ERR_NONE);
+    workers.ReleaseOutput(0);
+    EXPECT_EQ(workers.AcquireOutput(1), MFX_ERR_DEVICE_FAILED);
+    EXPECT_EQ(workers.AcquireOutput(2), MFX_ERR_NONE);
+    workers.ReleaseOutput(2);
+
+    // the frames of the failed region are skipped, they don't stay pending
+    EXPECT_EQ(workers.AcquireOutput(0), MFX_ERR_NONE);
+    workers.ReleaseOutput(0);
+    EXPECT_EQ(workers.AcquireOutput(2), MFX_ERR_NONE);
+    workers.ReleaseOutput(2);
+    EXPECT_EQ(workers.GetPending(), 0);
+    EXPECT_FALSE(workers.IsQueued(&surface));
+}
+
+static void set_env(const char* name, const std::string& value) {
+#if defined(_WIN32) || defined(_WIN64)
+    _putenv_s(name, value.c_str());
+#else
+    setenv(name, value.c_str(), 1);
+#endif
+}
+
+// Region pipeline on the stub runtime of test/runtime/delay_stubs.cpp, which writes a line for
+// every region of a frame. Frame i of the input has luma value i, and the frames listed in
+// idrFrames are encoded as IDR.
+class TestRegionPipeline : public CRegionEncodingPipeline {
+public:
+    explicit TestRegionPipeline(const std::vector<int>& idrFrames)
+            : CRegionEncodingPipeline(),
+              m_idrFrames(idrFrames) {}
+
+    std::vector<std::vector<int>> GetAssignment() {
+        return m_workers.GetAssignment();
+    }
+
+protected:
+    virtual mfxStatus LoadNextFrame(mfxFrameSurface1* pSurf) {
+        mfxU32 frame = m_nFramesRead;
+        if (std::find(m_idrFrames.begin(), m_idrFrames.end(), (int)frame) != m_idrFrames.end())
+            m_bInsertIDR = true;
+        return CRegionEncodingPipeline::LoadNextFrame(pSurf);
+    }
+
+    std::vector<int> m_idrFrames;
+};
+
+struct RegionSlice {
+    unsigned region;
+    unsigned frame;
+    unsigned data;
+    unsigned idr;
+    unsigned inFlight;
+};
+
+struct RegionEncodeResult {
+    mfxStatus sts;
+    std::vector<RegionSlice> slices; // in the order of the output
+    std::vector<std::vector<int>> assignment; // regions of the workers after the last frame
+    double timeMs;
+};
+
+static RegionEncodeResult encode_regions(int numRegions,
+                                         int numFrames,
+                                         mfxU16 asyncDepth,
+                                         mfxU16 threads,
+                                         const std::vector<int>& idrFrames = {}) {
+    const mfxU16 width = 64, height = 64;
+    const char* inFile = "region_in.yuv";
+    char outFile[]     = "region_out.txt";
+
+    // I420 frames
+    std::vector<char> frame(width * height * 3 / 2);
+    FILE* f = fopen(inFile, "wb");
+    for (int i = 0; i < numFrames; i++) {
+        std::fill(frame.begin(), frame.begin() + width * height, (char)i);
+        fwrite(frame.data(), 1, frame.size(), f);
+    }
+    fclose(f);
+
+    sInputParams params    = {};
+    params.CodecId         = MFX_CODEC_HEVC;
+    params.FileInputFourCC = MFX_FOURCC_I420;
+    params.EncodeFourCC    = MFX_FOURCC_NV12;
+    params.nWidth = params.nDstWidth = width;
+    params.nHeight = params.nDstHeight = height;
+    params.nPicStruct                  = MFX_PICSTRUCT_PROGRESSIVE;
+    params.dFrameRate                  = 30;
+    params.nRateControlMethod          = MFX_RATECONTROL_CQP;
+    params.nNumSlice                   = (mfxU16)numRegions;
+    params.nAsyncDepth                 = asyncDepth;
+    params.UseRegionEncode             = true;
+    params.nRegionThreads              = threads;
+    params.memType                     = SYSTEM_MEMORY;
+    params.InputFiles.push_back(inFile);
+    params.dstFileBuff.push_back(outFile);
+
+    RegionEncodeResult result = {};
+    {
+        TestRegionPipeline pipeline(idrFrames);
+        result.sts = pipeline.Init(&params);
+        if (result.sts == MFX_ERR_NONE) {
+            auto start    = std::chrono::steady_clock::now();
+            result.sts    = pipeline.Run();
+            result.timeMs = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+            result.assignment = pipeline.GetAssignment();
+        }
+        pipeline.Close();
+    }
+
+    f = fopen(outFile, "r");
+    RegionSlice slice = {};
+    while (f && fscanf(f,
+                       "region %u frame %u data %u idr %u inflight %u\n",
+                       &slice.region,
+                       &slice.frame,
+                       &slice.data,
+                       &slice.idr,
+                       &slice.inFlight) == 5)
+        result.slices.push_back(slice);
+    if (f)
+        fclose(f);
+    remove(inFile);
+    remove(outFile);
+
+    return result;
+}
+
+#define SKIP_WITHOUT_TEST_RUNTIME()                                                      \
+    if (!getenv("ONEVPL_SEARCH_PATH"))                                                   \
+        GTEST_SKIP() << "ONEVPL_SEARCH_PATH has to point to the vplencodetestrt runtime"; \
+    static_assert(true, "")
+
+// Slices are written frame by frame in region order while several frames are in flight in every
+// region. A surface is reused only once all regions have encoded its frame, and an IDR request
+// reaches all regions of the frame.
+TEST(Encode_RegionPipeline, WritesSlicesInOrderWithFramesInFlight) {
+    SKIP_WITHOUT_TEST_RUNTIME();
+    set_env("SAMPLE_ENCODE_TEST_RT_LATENCY", "6/1,1,3/9");
+    set_env("SAMPLE_ENCODE_TEST_RT_SUBMIT", "0,2,0");
+
+    const int numRegions = 3, numFrames = 12;
+    auto result          = encode_regions(numRegions, numFrames, 4, 0, { 0, 5 });
+    ASSERT_EQ(result.sts, MFX_ERR_NONE);
+    ASSERT_EQ(result.slices.size(), (size_t)(numRegions * numFrames));
+
+    unsigned maxInFlight = 0;
+    for (int frame = 0; frame < numFrames; frame++) {
+        for (int regId = 0; regId < numRegions; regId++) {
+            const RegionSlice& slice = result.slices[frame * numRegions + regId];
+            EXPECT_EQ(slice.region, (unsigned)regId);
+            EXPECT_EQ(slice.frame, (unsigned)frame);
+            EXPECT_EQ(slice.data, (unsigned)frame) << "surface reused before region " << regId
+                                                   << " encoded frame " << frame;
+            EXPECT_EQ(slice.idr, (unsigned)(frame == 0 || frame == 5)) << frame;
+            EXPECT_LE(slice.inFlight, 4u);
+            maxInFlight = std::max(maxInFlight, slice.inFlight);
+        }
+    }
+    EXPECT_GT(maxInFlight, 1u);
+}
+
+// Regions whose frames take turns being slow keep going at their own pace with frames in flight,
+// a barrier on every frame would wait for the slow one every time. Prints the time with one and
+// with four frames in flight.
+TEST(Encode_RegionPipeline, FramesInFlightHideUnevenRegionLatency) {
+    SKIP_WITHOUT_TEST_RUNTIME();
+    set_env("SAMPLE_ENCODE_TEST_RT_LATENCY", "20/2,2/20");
+    set_env("SAMPLE_ENCODE_TEST_RT_SUBMIT", "");
+
+    auto barrier   = encode_regions(2, 16, 1, 0);
+    auto pipelined = encode_regions(2, 16, 4, 0);
+    ASSERT_EQ(barrier.sts, MFX_ERR_NONE);
+    ASSERT_EQ(pipelined.sts, MFX_ERR_NONE);
+    EXPECT_EQ(pipelined.slices.size(), 32u);
+
+    printf("[ BENCHMARK] 1 frame in flight: %6.1f ms, 4 frames: %6.1f ms, speedup %.2fx\n",
+           barrier.timeMs,
+           pipelined.timeMs,
+           barrier.timeMs / pipelined.timeMs);
+    // 20 ms against 11 ms per frame
+    EXPECT_LT(pipelined.timeMs, 0.8 * barrier.timeMs);
+}
+
+// A region that takes long to submit holds back only its own worker. Prints the time with one
+// thread and with one thread per region.
+TEST(Encode_RegionPipeline, RegionsAreSubmittedConcurrently) {
+    SKIP_WITHOUT_TEST_RUNTIME();
+    set_env("SAMPLE_ENCODE_TEST_RT_LATENCY", "");
+    set_env("SAMPLE_ENCODE_TEST_RT_SUBMIT", "15,5,5,5");
+
+    auto serial     = encode_regions(4, 8, 4, 1);
+    auto concurrent = encode_regions(4, 8, 4, 0);
+    ASSERT_EQ(serial.sts, MFX_ERR_NONE);
+    ASSERT_EQ(concurrent.sts, MFX_ERR_NONE);
+    EXPECT_EQ(concurrent.slices.size(), 32u);
+
+    printf("[ BENCHMARK] 1 thread: %6.1f ms, 4 threads: %6.1f ms, speedup %.2fx\n",
+           serial.timeMs,
+           concurrent.timeMs,
+           serial.timeMs / concurrent.timeMs);
+    // 30 ms against 15 ms per frame
+    EXPECT_LT(concurrent.timeMs, 0.8 * serial.timeMs);
+}
+
+// With fewer threads than regions, the slowest region gets a thread of its own and the output
+// keeps the region order
+TEST(Encode_RegionPipeline, RegionsAreRebalancedBySubmitTime) {
+    SKIP_WITHOUT_TEST_RUNTIME();
+    set_env("SAMPLE_ENCODE_TEST_RT_LATENCY", "");
+    set_env("SAMPLE_ENCODE_TEST_RT_SUBMIT", "1,1,12,1");
+
+    auto result = encode_regions(4, 6, 2, 2);
+    ASSERT_EQ(result.sts, MFX_ERR_NONE);
+    EXPECT_EQ(result.assignment, std::vector<std::vector<int>>({ { 2 }, { 0, 1, 3 } }));
+
+    ASSERT_EQ(result.slices.size(), 24u);
+    for (size_t i = 0; i < result.slices.size(); i++) {
+        EXPECT_EQ(result.slices[i].region, i % 4);
+        EXPECT_EQ(result.slices[i].frame, i / 4);
+        EXPECT_EQ(result.slices[i].data, i / 4);
+    }
+}
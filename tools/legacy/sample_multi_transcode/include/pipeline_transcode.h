@@ -9,6 +9,7 @@
 
 #include <stddef.h>
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <ctime>
@@ -29,12 +30,16 @@
 #include "sysmem_allocator.h"
 
 #include "brc_routines.h"
+#include "frame_pacer.h"
 #include "hw_device.h"
 #include "mfxdeprecated.h"
 #include "mfxplugin.h"
 #include "plugin_utils.h"
 #include "preset_manager.h"
 #include "sample_defs.h"
+#include "smt_affinity.h"
+#include "smt_control.h"
+#include "smt_frame_ctrl.h"
 #include "smt_tracer.h"
 #include "vpl/mfxdispatcher.h"
 #include "vpl/mfxjpeg.h"
@@ -98,6 +103,10 @@ public:
 
         mfxU32 PoolID =
             0; //surface pool for this target, it is output of decoder side VPP and input of encoder side VPP
+
+        mfxU16 Priority      = 0; //higher priority targets are scaled first
+        mfxU32 LatencyBudget = 0; //ms from decoded frame to scaled frame, 0 - no deadline
+        mfxU32 SrcTargetID   = DecoderTargetID; //target this one is scaled from
     };
 
     class PoolDescritpor {
@@ -114,6 +123,10 @@ public:
     };
 
     TargetDescriptor GetDesc(mfxU32 id);
+    // Every target is scaled from the smallest cascade output it can be produced from, targets
+    // are dispatched so that ones with the tightest deadline and then highest priority are not
+    // waiting for the others. Fills SrcTargetID of targets and DispatchOrder.
+    void BuildScalingTree();
     void PropagateCascadeParameters();
     void CreatePoolList();
     bool SkipFrame(mfxU32 targetID, mfxU32 frameNum);
@@ -124,6 +137,7 @@ public:
     mfxU32 GopSize                = 0;
 
     std::vector<TargetDescriptor> Targets;
+    std::vector<mfxU32> DispatchOrder; //target IDs, every target comes after its source
     std::map<mfxU32, PoolDescritpor> Pools; //key is pool ID
     std::map<mfxU32, sInputParams>
         InParams; //key is target ID, copy of par file for cascade VPP initialization
@@ -135,6 +149,7 @@ public:
             : ParFileImported(false),
               CascadeScalerRequired(false),
               Targets(),
+              DispatchOrder(),
               Pools(),
               InParams(),
               Tracer(nullptr) {}
@@ -157,6 +172,15 @@ struct ExtendedSurface {
     mfxSyncPoint Syncp;
 };
 
+// Time from decoded frame to the completed scaling of its rendition, for targets with a budget
+struct RenditionLatency {
+    mfxU32 Frames   = 0;
+    mfxU32 Missed   = 0; //frames over the latency budget of the target
+    mfxU32 Budget   = 0; //ms
+    msdk_tick Total = 0;
+    msdk_tick Max   = 0;
+};
+
 struct ExtendedBS {
     bool IsFree = true;
     mfxBitstreamWrapper Bitstream;
@@ -244,8 +268,16 @@ protected:
 
 class ExtendedBSStore {
 public:
-    explicit ExtendedBSStore(mfxU32 size) {
+    // bitstreams take storage from the pool when encoding starts and give it back on release
+    explicit ExtendedBSStore(mfxU32 size, std::shared_ptr<BitstreamBufferPool> pool = nullptr)
+            : m_pExtBS(),
+              m_pool(pool) {
         m_pExtBS.resize(size);
+        if (m_pool) {
+            for (mfxU32 i = 0; i < m_pExtBS.size(); i++) {
+                m_pExtBS[i].Bitstream.SetPool(m_pool);
+            }
+        }
     }
     virtual ~ExtendedBSStore() {
         m_pExtBS.clear();
@@ -263,6 +295,9 @@ public:
         for (mfxU32 i = 0; i < m_pExtBS.size(); i++) {
             if (&m_pExtBS[i] == pBS) {
                 m_pExtBS[i].IsFree = true;
+                if (m_pool) {
+                    m_pExtBS[i].Bitstream.ReleaseBuffer();
+                }
                 return;
             }
         }
@@ -271,6 +306,9 @@ public:
     void ReleaseAll() {
         for (mfxU32 i = 0; i < m_pExtBS.size(); i++) {
             m_pExtBS[i].IsFree = true;
+            if (m_pool) {
+                m_pExtBS[i].Bitstream.ReleaseBuffer();
+            }
         }
         return;
     }
@@ -284,6 +322,7 @@ public:
 
 protected:
     std::vector<ExtendedBS> m_pExtBS;
+    std::shared_ptr<BitstreamBufferPool> m_pool;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(ExtendedBSStore);
@@ -329,6 +368,22 @@ private:
     DISALLOW_COPY_AND_ASSIGN(SafetySurfaceBuffer);
 };
 
+// State of a session at its last encoded IDR frame, -robust rebuilds a session hung on the GPU
+// with the rate control it had there
+struct RecoveryCheckpoint {
+    // frames written before the IDR frame
+    mfxU32 frameNum = 0;
+    // output bytes written before the IDR frame
+    mfxU64 outputOffset = 0;
+    // BRC parameters of the encoder
+    mfxU16 BRCParamMultiplier = 0;
+    mfxU16 RateControlMethod  = 0;
+    mfxU16 InitialDelayInKB   = 0;
+    mfxU16 BufferSizeInKB     = 0;
+    mfxU16 TargetKbps         = 0;
+    mfxU16 MaxKbps            = 0;
+};
+
 class FileBitstreamProcessor {
 public:
     FileBitstreamProcessor();
@@ -344,7 +399,21 @@ public:
                                              mfxU32 frameNum);
     virtual mfxStatus ResetInput();
     virtual mfxStatus ResetOutput();
+    // keeps the first size bytes of the output
+    virtual mfxStatus TruncateOutput(mfxU64 size);
     virtual bool IsNulOutput();
+    // outputs are reported to the live source the input arrives from
+    void SetLiveSource(std::shared_ptr<CLiveSource> source) {
+        m_pLiveSource = source;
+    }
+    std::shared_ptr<CLiveSource> GetLiveSource() const {
+        return m_pLiveSource;
+    }
+
+    // bytes written to the output since the last reset
+    mfxU64 GetOutputOffset() const {
+        return m_nOutputOffset;
+    }
 
 protected:
     std::unique_ptr<CSmplBitstreamReader> m_pFileReader;
@@ -352,6 +421,8 @@ protected:
     // for performance options can be zero
     std::shared_ptr<CSmplBitstreamWriter> m_pFileWriter;
     mfxBitstreamWrapper m_Bitstream;
+    mfxU64 m_nOutputOffset;
+    std::shared_ptr<CLiveSource> m_pLiveSource;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(FileBitstreamProcessor);
@@ -381,6 +452,8 @@ public:
     virtual void Close();
     virtual mfxStatus Reset(); // for 1.X init
     virtual mfxStatus Reset(VPLImplementationLoader* mfxLoader);
+    // Rebuilds the session after MFX_ERR_GPU_HANG using the last checkpoint
+    virtual mfxStatus ResumeFromCheckpoint(VPLImplementationLoader* mfxLoader);
     virtual mfxStatus Join(MFXVideoSession* pChildSession);
     virtual mfxStatus Run();
     virtual mfxStatus FlushLastFrames() {
@@ -390,6 +463,14 @@ public:
     mfxU32 GetProcessFrames() {
         return m_nProcessedFramesNum;
     }
+    // tick at which the first frame left the pipeline, 0 if none did yet
+    msdk_tick GetFirstFrameTick() const {
+        return m_FirstFrameTick;
+    }
+    // per target ID, filled by the decoding session of cascade scaling pipeline
+    const std::map<mfxU32, RenditionLatency>& GetRenditionLatency() const {
+        return m_RenditionLatency;
+    }
 
     bool GetJoiningFlag() {
         return m_bIsJoinSession;
@@ -413,6 +494,21 @@ public:
     bool IsOverlayUsed();
     size_t GetRobustFlag();
     eAPIVersion GetVersionOfSessionInitAPI();
+    // true if a sync operation returned MFX_ERR_GPU_HANG in robust mode
+    bool IsGpuHangDetected() {
+        return m_bGpuHangDetected;
+    }
+    const RecoveryCheckpoint& GetCheckpoint() {
+        return m_Checkpoint;
+    }
+    // stops the sessions feeding this one from queuing frames for it
+    void CancelInputBuffering() {
+        if (m_pBuffer)
+            m_pBuffer->CancelBuffering();
+    }
+
+    // prints results of output verification, fails on digest mismatch
+    mfxStatus FinishQualityCheck();
 
     std::string GetSessionText() {
         std::stringstream ss;
@@ -438,6 +534,36 @@ public:
     void SetSyncOpTimeout(mfxU32 syncOpTimeout = MSDK_WAIT_INTERVAL) {
         m_nSyncOpTimeout = syncOpTimeout;
     };
+    // output bitstreams take storage from this pool, it may be shared with other sessions
+    void SetBitstreamPool(std::shared_ptr<BitstreamBufferPool> pool) {
+        m_pBitstreamPool = pool;
+    };
+    // sessions limited with -fps wait for their frames on this timer, it may be shared
+    void SetFramePacerTimer(std::shared_ptr<FramePacerTimer> timer) {
+        m_FramePacer.SetTimer(timer);
+    };
+    FramePacerStatistics GetFramePacerStatistics() const {
+        return m_FramePacer.GetStatistics();
+    };
+    // ring raw output of -shm_ring goes to, NULL if not given
+    const CShmFrameRingWriter* GetShmRing() const {
+        return m_pShmRing.get();
+    };
+    // reconfiguration commands addressed to the session by name come through the mailbox
+    void SetControlMailbox(const std::string& name, std::shared_ptr<ControlMailbox> mailbox) {
+        m_ControlName     = name;
+        m_pControlMailbox = mailbox;
+    };
+    // commands still waiting in the mailbox count as expired
+    ControlStatistics GetControlStatistics() const {
+        ControlStatistics stat = m_ControlStat;
+        if (m_pControlMailbox)
+            stat.Expired += (mfxU32)m_pControlMailbox->GetPendingCount();
+        return stat;
+    }
+    bool HasControlMailbox() const {
+        return m_pControlMailbox != nullptr;
+    }
 
     mfxU16 GetAdapterType() const {
         return m_adapterType;
@@ -476,7 +602,22 @@ public:
 protected:
     virtual mfxStatus CheckRequiredAPIVersion(mfxVersion& version, sInputParams* pParams);
 
+    mfxU32 CountProcessedFrame() {
+        if (!m_FirstFrameTick)
+            m_FirstFrameTick = msdk_time_get_tick();
+        return ++m_nProcessedFramesNum;
+    }
+
     virtual mfxStatus Decode();
+    // Scales decoded frame along the cascade scaling tree in dispatch order. Renditions with
+    // latency budget are handed to their sessions at once, the rest is added to OutSurfaces.
+    mfxStatus CascadeScaleFrame(const ExtendedSurface& DecExtSurface,
+                                ExtendedSurface& VppExtSurface,
+                                std::vector<ExtendedSurface>& OutSurfaces,
+                                bool bEndOfFile);
+    mfxStatus PublishRendition(const ExtendedSurface& Surf);
+    // Waits until the scaling of a rendition is complete
+    virtual mfxStatus SyncRendition(ExtendedSurface& Surf);
     virtual mfxStatus Encode();
     virtual mfxStatus Transcode();
     virtual mfxStatus DecodeOneFrame(ExtendedSurface* pExtSurface);
@@ -538,6 +679,7 @@ protected:
     mfxStatus PutBS();
 
     mfxStatus DumpSurface2File(mfxFrameSurface1* pSurface);
+    mfxStatus CheckOutputQuality(mfxFrameSurface1* pSurface);
     mfxStatus ReplaceBlackSurface(mfxFrameSurface1* pSurface);
     mfxStatus Surface2BS(ExtendedSurface* pSurf, mfxBitstreamWrapper* pBS, mfxU32 fourCC);
     mfxStatus NV12toBS(mfxFrameSurface1* pSurface, mfxBitstreamWrapper* pBS);
@@ -556,6 +698,7 @@ protected:
     void SetNumFramesForReset(mfxU32 nFrames);
 
     void HandlePossibleGpuHang(mfxStatus& sts);
+    void UpdateCheckpoint();
 
     mfxStatus SetAllocatorAndHandleIfRequired();
     mfxStatus LoadGenericPlugin();
@@ -588,6 +731,12 @@ protected:
     CSmplYUVWriter m_dumpVppCompFileWriter;
     mfxU32 m_vppCompDumpRenderMode;
 
+    CQualityChecker m_qualityChecker;
+    bool m_bQualityCheck;
+
+    // raw output handed to another process, NULL without -shm_ring
+    std::unique_ptr<CShmFrameRingWriter> m_pShmRing;
+
 #if defined(_WIN32) || defined(_WIN64)
     CDecodeD3DRender* m_hwdev4Rendering;
 #else
@@ -650,6 +799,11 @@ protected:
     mfxU32 m_nID;
     mfxU16 m_AsyncDepth;
     mfxU32 m_nProcessedFramesNum;
+    msdk_tick m_FirstFrameTick;
+    std::map<mfxU32, RenditionLatency> m_RenditionLatency;
+    // cascade outputs locked until all targets scaled from them are dispatched
+    std::vector<mfxFrameSurface1*> m_CascadeLockedSurfaces;
+    msdk_tick m_CascadeFrameTick;
     mfxU32 m_nTotalFramesNum;
 
     bool m_bIsJoinSession;
@@ -675,8 +829,14 @@ protected:
     mfxU32 m_NumFramesForReset;
     std::mutex m_mReset;
     std::mutex m_mStopSession;
+    // guards state updated by child sessions initialized concurrently
+    std::mutex m_mChildInit;
     bool m_bRobustFlag;
     bool m_bSoftGpuHangRecovery;
+    std::atomic<bool> m_bGpuHangDetected;
+    RecoveryCheckpoint m_Checkpoint;
+    // frames a resumed session drops before it encodes again
+    mfxU32 m_nResumeSkipFrames;
 
     bool isHEVCSW;
 
@@ -686,6 +846,7 @@ protected:
     bool m_shouldUseShifted10BitEnc;
 
     std::unique_ptr<ExtendedBSStore> m_pBSStore;
+    std::shared_ptr<BitstreamBufferPool> m_pBitstreamPool;
 
     mfxU32 m_FrameNumberPreference;
     mfxU32 m_MaxFramesForTranscode;
@@ -697,7 +858,7 @@ protected:
     // pointer to already extended bs processor
     FileBitstreamProcessor* m_pBSProcessor;
 
-    msdk_tick m_nReqFrameTime; // time required to transcode one frame
+    FramePacer m_FramePacer; // limits the frame rate to -fps
 
     mfxU32 statisticsWindowSize; // Sliding window size for Statistics
     mfxU32 m_nOutputFramesNum;
@@ -708,16 +869,15 @@ protected:
     bool shouldUseGreedyFormula;
 
     // ROI data
-    std::vector<mfxExtEncoderROI> m_ROIData;
+    ROIReader m_ROIReader;
     mfxU32 m_nSubmittedFramesNum;
 
     // ROI with MBQP map data
     bool m_bUseQPMap;
+    MBQPRasterizer m_MBQPRasterizer;
 
-    std::map<void*, mfxExtMBQP> m_bufExtMBQP;
-    std::map<void*, std::vector<mfxU8>> m_qpMapStorage;
-    std::map<void*, std::vector<mfxExtBuffer*>> m_extBuffPtrStorage;
-    std::map<void*, mfxEncodeCtrl> encControlStorage;
+    // run-time encode control, ROI and MBQP buffers of every encoder input surface
+    FrameControlArena m_FrameControls;
 
     mfxU32 m_QPmapWidth;
     mfxU32 m_QPmapHeight;
@@ -731,11 +891,24 @@ protected:
     std::string dump_file;
 
     void FillMBQPBuffer(mfxExtMBQP& qpMap, mfxU16 pictStruct);
+    mfxU16 GetMBQPBlockSize();
 
     TCBRCTestFile::Reader m_TCBRCFileReader;
     bool m_bTCBRCFileMode;
     mfxStatus ConfigTCBRCTest(mfxFrameSurface1* pSurf);
 
+    // applies commands of the control channel, called at frame boundaries
+    void ApplyControlCommands();
+    std::string m_ControlName;
+    std::shared_ptr<ControlMailbox> m_pControlMailbox;
+    std::vector<ControlCommand> m_ControlCommands;
+    std::vector<ControlCommand> m_ExpiredControlCommands;
+    ControlStatistics m_ControlStat;
+    mfxU16 m_ControlFrameQP = 0;
+    // size of the surfaces, frames can't grow over it
+    mfxU16 m_ControlMaxWidth  = 0;
+    mfxU16 m_ControlMaxHeight = 0;
+
 #ifdef ENABLE_MCTF
     sMctfRunTimeParams m_MctfRTParams;
 #endif
@@ -786,9 +959,19 @@ struct ThreadTranscodeContext {
     mfxStatus startStatus = MFX_ERR_NONE;
     // Session's working time
     mfxF64 working_time = 0;
+    // Time spent in Init and CompleteInit
+    mfxF64 init_time = 0;
+    // Number of rebuilds after GPU hang and time from hang detection to restart
+    mfxU32 numRecoveries = 0;
+    mfxF64 recovery_time = 0;
 
     // Number of processed frames
     mfxU32 numTransFrames = 0;
+    // CPUs and memory node of the session's threads, and how often they changed CPU while running
+    CpuPlacement placement;
+    mfxU64 cpuMigrations = 0;
+    // Result of binding the thread initializing the session to placement
+    mfxStatus bindSts = MFX_ERR_NONE;
     // Status of the finished session
     mfxStatus transcodingSts = MFX_ERR_NONE;
 
@@ -800,11 +983,20 @@ struct ThreadTranscodeContext {
         MSDK_CHECK_POINTER_NO_RET(pPipeline);
         transcodingSts = MFX_ERR_NONE;
 
+        BindCurrentThread(placement);
+        mfxU64 startMigrations = GetCurrentThreadMigrations();
+
         auto start_time = system_clock::now();
         while (MFX_ERR_NONE == transcodingSts) {
             transcodingSts = pPipeline->Run();
         }
-        working_time = duration_cast<duration<mfxF64>>(system_clock::now() - start_time).count();
+        // robust mode restarts the routine after recovery, keep the time of all runs
+        working_time += duration_cast<duration<mfxF64>>(system_clock::now() - start_time).count();
+        cpuMigrations += GetCurrentThreadMigrations() - startMigrations;
+
+        // sync errors are reported as MFX_ERR_ABORTED
+        if (transcodingSts < MFX_ERR_NONE && pPipeline->IsGpuHangDetected())
+            transcodingSts = MFX_ERR_GPU_HANG;
 
         MSDK_IGNORE_MFX_STS(transcodingSts, MFX_WRN_VALUE_NOT_CHANGED);
         numTransFrames = pPipeline->GetProcessFrames();
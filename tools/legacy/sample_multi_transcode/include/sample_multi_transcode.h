@@ -17,6 +17,9 @@
 #include "smt_cli.h"
 #include "vpl_implementation_loader.h"
 
+#include <functional>
+#include <future>
+#include <map>
 #include <memory>
 #include <vector>
 #include "d3d11_allocator.h"
@@ -39,6 +42,62 @@
 #include "smt_cli_params.h"
 
 namespace TranscodingSample {
+
+// Returns for each session the sessions that must finish a step of initialization before the
+// session itself may start it: session 0 fills the decoder part of the shared cascade scaler
+// config, sources take frames from the sinks before them and the rest inherit from the first
+// joined session.
+std::vector<std::vector<mfxU32>> GetSessionInitDependencies(
+    const std::vector<sInputParams>& params);
+
+// Returns the sessions to rebuild together with session idx after a GPU hang in ascending order:
+// sinks and sources exchange surfaces and joined sessions share one scheduler, the rest are
+// independent.
+std::vector<mfxU32> GetRecoveryGroup(const std::vector<sInputParams>& params, mfxU32 idx);
+
+// Returns the sessions of a recovery group to rebuild: the ones that haven't completed, and the
+// sinks of a rebuilt source since it reads their frames again from the start.
+std::vector<mfxU32> GetRestartedSessions(const std::vector<sInputParams>& params,
+                                         const std::vector<mfxU32>& group,
+                                         const std::vector<bool>& completed);
+
+// Returns for each session of a 1 to N par file the index of its safety buffer in the order
+// CreateSafetyBuffers creates them, one per source: a sink gets the buffer of the last source
+// before the next sink, the head of its sources' chain. -1 for the rest and for a sink without
+// sources.
+std::vector<mfxI32> GetOneToManyBuffers(const std::vector<sInputParams>& params);
+
+// Returns for each session the name the control channel routes commands to it by (-name or the
+// session number), empty for decode-only sinks that have no encoder to reconfigure
+std::vector<std::string> GetControlSessionNames(const std::vector<sInputParams>& params);
+
+// Returns groups of at least two sessions, in par file order, that read the same input with the
+// same decoder, device and memory settings. Only par files of plain transcoding sessions are
+// grouped, sessions with decoder post-processing or raw input are left alone.
+std::vector<std::vector<mfxU32>> GetSharedDecodeGroups(const std::vector<sInputParams>& params);
+
+// Replaces every group of GetSharedDecodeGroups by a decode-only sink followed by the sessions of
+// the group as its sources, so the input is read and decoded once. Returns for each resulting
+// session the par file session it comes from, -1 for the added sinks.
+std::vector<mfxI32> ShareDuplicateDecodes(std::vector<sInputParams>& params);
+
+// Runs one initialization step per session, each on its own thread. A step starts as soon as
+// the steps of its dependencies succeeded, and returns the first dependency error otherwise.
+class SessionInitScheduler {
+public:
+    SessionInitScheduler() : m_steps() {}
+
+    void Launch(mfxU32 idx, const std::vector<mfxU32>& deps, std::function<mfxStatus()> step);
+    // Waits for the given launched steps, returns the first error in session order
+    mfxStatus Wait(const std::vector<mfxU32>& idxs, mfxU32* pFailedIdx = nullptr);
+    mfxStatus WaitAll(mfxU32* pFailedIdx = nullptr);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(SessionInitScheduler);
+
+    std::map<mfxU32, std::shared_future<mfxStatus>> m_steps;
+};
+
 class Launcher {
 public:
     Launcher();
@@ -58,10 +117,17 @@ protected:
     mfxStatus CheckAndFixAdapterDependency(mfxU32 idxSession,
                                            CTranscodingPipeline* pParentPipeline);
     virtual mfxStatus VerifyCrossSessionsOptions();
+    // Decodes inputs shared by several sessions once, for -share_decode
+    virtual void ShareDecodes();
+    // Returns the CPUs and memory node of each session, from -cpus, -numa_node and -affinity
+    virtual std::vector<CpuPlacement> PlaceSessionsOnCpus(AffinityPolicy policy);
     virtual mfxStatus CreateSafetyBuffers();
     CascadeScalerConfig& CreateCascadeScalerConfig();
     virtual void DoTranscoding();
-    virtual void DoRobustTranscoding();
+    // Stops the sessions that share a pipeline with the hung ones, rebuilds them in parallel
+    // and restarts them from their last IDR frame while other sessions keep running. Sessions
+    // that completed keep their output.
+    virtual mfxStatus RecoverSessions(const std::vector<mfxU32>& hungSessions);
 
     virtual void Close();
 
@@ -85,6 +151,8 @@ protected:
     std::vector<std::shared_ptr<mfxAllocatorParams>> m_pAllocParams;
     std::vector<std::unique_ptr<CHWDevice>> m_hwdevs;
     msdk_tick m_StartTime;
+    // start of Launcher::Init, reference point for time to first frame
+    msdk_tick m_InitStartTime;
     // need to work with HW pipeline
     mfxHandleType m_eDevType;
     mfxAccelerationMode m_accelerationMode;
@@ -95,6 +163,11 @@ protected:
     CascadeScalerConfig m_CSConfig;
     SMTTracer m_Tracer;
     std::shared_ptr<CSmplBitstreamWriter> m_GlobalBitstreamWriter{};
+    // storage of output bitstreams of all sessions
+    std::shared_ptr<BitstreamBufferPool> m_pBitstreamPool;
+    std::shared_ptr<FramePacerTimer> m_pFramePacerTimer;
+    // reconfiguration commands of -ctrl
+    ControlChannel m_ControlChannel;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(Launcher);
@@ -0,0 +1,72 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __SMT_AFFINITY_H__
+#define __SMT_AFFINITY_H__
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "vpl/mfxdefs.h"
+
+namespace TranscodingSample {
+
+// How sessions without -cpus or -numa_node are placed, given with -affinity
+enum class AffinityPolicy {
+    None, // threads float over all CPUs
+    Auto, // session groups are spread over NUMA nodes and split the CPUs of their node
+    Adapter // as Auto, but a group goes to the node of its adapter when the node is known
+};
+
+// CPUs of every NUMA node, in ascending order
+struct CpuTopology {
+    std::map<mfxI32, std::vector<mfxU32>> NodeCpus;
+
+    // Returns the node of cpu, -1 if the CPU is unknown
+    mfxI32 GetNode(mfxU32 cpu) const;
+};
+
+// CPUs the threads of a session run on and the node its memory is taken from
+struct CpuPlacement {
+    std::vector<mfxU32> Cpus; // empty if the session is not bound
+    mfxI32 Node = -1; // -1 if memory is taken from any node
+};
+
+// Parses CPU lists like "0-3,8,10-11" into sorted unique CPUs, returns false on syntax errors
+bool ParseCpuList(const std::string& list, std::vector<mfxU32>& cpus);
+// Formats cpus back into the shortest list of ranges
+std::string FormatCpuList(const std::vector<mfxU32>& cpus);
+
+// Reads NUMA nodes from <sysfsRoot>/devices/system/node. Hosts without NUMA information have one
+// node 0 with the online CPUs.
+CpuTopology ReadCpuTopology(const std::string& sysfsRoot = "/sys");
+
+// Returns the NUMA node of DRM render node renderD<renderNodeNum>, -1 if it is unknown
+mfxI32 GetRenderNodeNumaNode(mfxU32 renderNodeNum, const std::string& sysfsRoot = "/sys");
+
+// Places sessions on CPUs. cpuLists and numaNodes hold -cpus and -numa_node of each session
+// ("" and -1 if not given), which take precedence over the policy. Sessions with the same group
+// exchange surfaces and are placed together; adapterNodes holds the node of the adapter of each
+// session, -1 if unknown. Explicit placements naming no known CPU are left unbound.
+std::vector<CpuPlacement> PlaceSessions(const std::vector<std::string>& cpuLists,
+                                        const std::vector<mfxI32>& numaNodes,
+                                        const std::vector<mfxU32>& groups,
+                                        const std::vector<mfxI32>& adapterNodes,
+                                        const CpuTopology& topology,
+                                        AffinityPolicy policy);
+
+// Binds the calling thread to the CPUs of placement and prefers memory of its node. Threads
+// created by the calling one afterwards inherit both. Returns MFX_ERR_UNSUPPORTED if the OS
+// doesn't allow it.
+mfxStatus BindCurrentThread(const CpuPlacement& placement);
+
+// Returns how many times the calling thread was moved to another CPU, 0 if it is unknown
+mfxU64 GetCurrentThreadMigrations();
+
+} // namespace TranscodingSample
+
+#endif //__SMT_AFFINITY_H__
@@ -15,6 +15,7 @@
 #endif
 
 #include <map>
+#include <mutex>
 #include <vector>
 #include "pipeline_transcode.h"
 #include "smt_cli_params.h"
@@ -64,17 +65,46 @@ public:
     mfxU32 GetParameterSurfaceWaitInterval() {
         return m_surface_wait_interval;
     };
+    // FIFO of reconfiguration commands given with -ctrl, empty if none
+    std::string GetControlChannel() {
+        return m_ControlChannel;
+    };
+    mfxU32 GetControlLatency() {
+        return m_nControlLatency;
+    };
+    // -share_decode: sessions with the same input are fed by one decode
+    bool IsDecodeSharingEnabled() {
+        return m_bShareDecode;
+    };
+    // -affinity: placement of sessions without -cpus or -numa_node
+    AffinityPolicy GetAffinityPolicy() {
+        return m_AffinityPolicy;
+    };
+    // -fps_spin: microseconds the frame pacing timer polls the clock before a deadline
+    mfxU32 GetFpsSpinTail() {
+        return m_nFpsSpinTail;
+    };
 
 protected:
     mfxStatus ParseParFile(const std::string& filename);
+    // Parses lines of a par file on m_nParThreads threads. Sessions, their descriptions and the
+    // returned status are the ones of parsing the lines one by one, messages may come out of order.
+    mfxStatus ParseParLines(const std::vector<std::string>& lines);
     mfxStatus TokenizeLine(const std::string& line);
     size_t GetStringLength(char* pTempLine, size_t length);
 
-    static bool isspace(char a);
-    static bool is_not_allowed_char(char a);
-    bool ParseROIFile(const std::string& roi_file_name, std::vector<mfxExtEncoderROI>& m_ROIData);
-
     mfxStatus ParseParamsForOneSession(mfxU32 argc, char* argv[]);
+    // Parses options of one session. Changes nothing but its arguments and the ROI file cache, so
+    // sessions can be parsed in parallel; performanceFile stands for performance_file_name and
+    // hasSession is false if all options were skipped.
+    mfxStatus ParseSessionOptions(mfxU32 argc,
+                                  char* argv[],
+                                  TranscodingSample::sInputParams& InputParams,
+                                  std::string& performanceFile,
+                                  bool& hasSession) const;
+    // Opens and indexes an ROI file once, sessions naming the same file share it
+    std::shared_ptr<const ROIFile> OpenROIFile(const std::string& fileName) const;
+    mfxStatus AddSession(TranscodingSample::sInputParams& InputParams);
     mfxStatus ParseOption__set(char* strCodecType, char* strPluginPath);
     mfxStatus VerifyAndCorrectInputParams(TranscodingSample::sInputParams& InputParams);
     mfxU32 m_SessionParamId;
@@ -92,7 +122,15 @@ protected:
     bool bRobustFlag;
     bool bSoftRobustFlag;
     bool shouldUseGreedyFormula;
+    std::string m_ControlChannel;
+    mfxU32 m_nControlLatency;
+    mfxU32 m_nParThreads;
+    bool m_bShareDecode;
+    AffinityPolicy m_AffinityPolicy;
+    mfxU32 m_nFpsSpinTail;
     std::vector<std::string> session_descriptions;
+    mutable std::mutex m_ROIFilesMutex;
+    mutable std::map<std::string, std::shared_ptr<const ROIFile>> m_ROIFiles;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(CmdProcessor);
@@ -7,6 +7,10 @@
 #ifndef __SMT_CLI_PARAMS_H__
 #define __SMT_CLI_PARAMS_H__
 
+#include "live_source.h"
+#include "sample_quality.h"
+#include "shm_frame_ring.h"
+#include "smt_roi.h"
 #include "smt_tracer.h"
 #include "vpl/mfx.h"
 namespace TranscodingSample {
@@ -126,6 +130,8 @@ typedef enum eAPIVersion { API_2X, API_1X } eAPIVersion;
 typedef struct sInputParams {
     mfxU32 TargetID;
     bool CascadeScaler;
+    mfxU16 CascadePriority;
+    mfxU32 CascadeLatencyBudget;
     bool EnableTracing;
     mfxU32 TraceBufferSize;
     SMTTracer::LatencyType LatencyType;
@@ -180,6 +186,7 @@ typedef struct sInputParams {
     std::string strSrcFile; // source bitstream file
     std::string strDstFile; // destination bitstream file
     std::string strDumpVppCompFile; // VPP composition output dump file
+    sQualityCheckParams qualityParams; // verification of raw or VPP composition dump output
     std::string dump_file;
 
     std::string strTCBRCFilePath;
@@ -272,7 +279,8 @@ typedef struct sInputParams {
     sPluginParams encoderPluginParams;
 
     mfxU32 nTimeout; // how long transcoding works in seconds
-    mfxU32 nFPS; // limit transcoding to the number of frames per second
+    mfxU32 nFPS; // limit transcoding to nFPS / nFPSDenom frames per second
+    mfxU32 nFPSDenom;
 
     mfxU32 statisticsWindowSize;
     FILE* statisticsLogFile;
@@ -403,8 +411,13 @@ typedef struct sInputParams {
     bool TCBRCFileMode;
 
     std::string DumpLogFileName;
+    std::string SessionName; // name in commands of the control channel
+    std::string CpuList; // CPUs of -cpus, empty if not given
+    mfxI32 NumaNode; // node of -numa_node, -1 if not given
+    LiveSourceParams LiveSource; // input of -live, RateN is 0 if the file is read at full speed
+    ShmFrameRingParams ShmRing; // output of -shm_ring, Name is empty if not given
 
-    std::vector<mfxExtEncoderROI> m_ROIData;
+    std::shared_ptr<const ROIFile> m_ROIFile;
 
     bool bDecoderPostProcessing;
     bool bROIasQPMAP;
@@ -423,6 +436,8 @@ typedef struct sInputParams {
     sInputParams()
             : TargetID(0),
               CascadeScaler(false),
+              CascadePriority(0),
+              CascadeLatencyBudget(0),
               EnableTracing(false),
               TraceBufferSize(0),
               LatencyType(SMTTracer::LatencyType::DEFAULT),
@@ -465,6 +480,7 @@ typedef struct sInputParams {
               strSrcFile(),
               strDstFile(),
               strDumpVppCompFile(),
+              qualityParams(),
               dump_file(),
               strTCBRCFilePath(),
               m_encode_cfg(),
@@ -499,6 +515,7 @@ typedef struct sInputParams {
               eModeExt(Native),
               FrameNumberPreference(0),
               MaxFrameNumber(MFX_INFINITE),
+              prolonged(0),
               ExactNframe(0),
               numSurf4Comp(0),
               numTiles4Comp(0),
@@ -535,6 +552,7 @@ typedef struct sInputParams {
               encoderPluginParams(),
               nTimeout(0),
               nFPS(0),
+              nFPSDenom(1),
               statisticsWindowSize(0),
               statisticsLogFile(nullptr),
               bLABRC(false),
@@ -632,7 +650,12 @@ typedef struct sInputParams {
               nSyncOpTimeout(MSDK_WAIT_INTERVAL),
               TCBRCFileMode(false),
               DumpLogFileName(),
-              m_ROIData(),
+              SessionName(),
+              CpuList(),
+              NumaNode(-1),
+              LiveSource(),
+              ShmRing(),
+              m_ROIFile(),
               bDecoderPostProcessing(false),
               bROIasQPMAP(false),
 #ifdef ENABLE_MCTF
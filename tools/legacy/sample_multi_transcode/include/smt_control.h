@@ -0,0 +1,140 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __SMT_CONTROL_H__
+#define __SMT_CONTROL_H__
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vm/time_defs.h"
+#include "vpl/mfxstructures.h"
+
+namespace TranscodingSample {
+
+// Reconfiguration request of the control channel, one text line:
+//   <session|*> bitrate <kbps> [<max kbps>]
+//   <session|*> size <width> <height>
+//   <session|*> qp <0-51>
+//   <session|*> idr
+struct ControlCommand {
+    enum class Type { Bitrate, Size, QP, IDR };
+
+    std::string Session;
+    Type Kind       = Type::IDR;
+    mfxU32 Value[2] = { 0, 0 };
+    std::string Text;
+    msdk_tick Received = 0;
+};
+
+// Returns MFX_ERR_UNSUPPORTED and sets error if the line is not a command
+mfxStatus ParseControlCommand(const std::string& line, ControlCommand& cmd, std::string& error);
+
+// What a command changes in a session
+struct ControlChange {
+    bool ResetEncoder = false;
+    bool ResetVpp     = false;
+    bool InsertIDR    = false;
+    bool SetFrameQP   = false;
+    mfxU16 FrameQP    = 0;
+};
+
+// Applies command to copies of the encoder parameters and of the VPP output, pVppOut is NULL if
+// the session has no VPP. Frames can't grow over maxWidth x maxHeight the surfaces were allocated
+// for. Returns MFX_ERR_UNSUPPORTED and sets error if the session can't take the command.
+mfxStatus ApplyControlCommand(const ControlCommand& cmd,
+                              mfxInfoMFX& enc,
+                              mfxFrameInfo* pVppOut,
+                              mfxU16 maxWidth,
+                              mfxU16 maxHeight,
+                              ControlChange& change,
+                              std::string& error);
+
+// Reconfigurations of a session
+struct ControlStatistics {
+    mfxU32 Applied      = 0;
+    mfxU32 Rejected     = 0;
+    mfxU32 Expired      = 0;
+    msdk_tick WaitTotal = 0; // from reception to the frame boundary it was applied at
+    msdk_tick WaitMax   = 0;
+    msdk_tick CostTotal = 0; // time spent in Reset calls
+    msdk_tick CostMax   = 0;
+};
+
+// Commands of one session. The control thread posts them, the session takes them at frame
+// boundaries; the check costs one atomic load when nothing was posted.
+class ControlMailbox {
+public:
+    // Commands waiting longer than latencyBound ms are not applied, 0 means no bound
+    explicit ControlMailbox(mfxU32 latencyBound);
+
+    void Post(const ControlCommand& cmd);
+    // Moves posted commands to commands or, if they waited for too long, to expired.
+    // Returns false if there was nothing posted.
+    bool Fetch(std::vector<ControlCommand>& commands,
+               std::vector<ControlCommand>& expired,
+               msdk_tick now);
+    size_t GetPendingCount();
+
+    mfxU32 GetLatencyBound() const {
+        return m_latencyBound;
+    }
+
+private:
+    const mfxU32 m_latencyBound;
+    std::atomic<bool> m_posted;
+    std::mutex m_mutex;
+    std::vector<ControlCommand> m_commands;
+};
+
+// Local control channel given with -ctrl: a FIFO read on its own thread, every line is a command
+// routed to the mailbox of the session it names
+class ControlChannel {
+public:
+    ControlChannel();
+    ~ControlChannel();
+
+    // Returns nullptr if the name is taken. Sessions are added before the channel is opened.
+    std::shared_ptr<ControlMailbox> AddSession(const std::string& name, mfxU32 latencyBound);
+
+    // Creates the FIFO unless it exists and starts reading it
+    mfxStatus Open(const std::string& path);
+    void Close();
+    bool IsOpen() const {
+        return m_thread.joinable();
+    }
+
+    // Posts the command to the sessions it names, returns false if it was rejected
+    bool Dispatch(const std::string& line, msdk_tick received);
+    mfxU32 GetRejectedCount() const {
+        return m_rejected;
+    }
+
+private:
+    ControlChannel(const ControlChannel&)            = delete;
+    ControlChannel& operator=(const ControlChannel&) = delete;
+
+    void ReadCommands();
+
+    std::map<std::string, std::shared_ptr<ControlMailbox>> m_sessions;
+    std::string m_path;
+    int m_fd;
+    // write end kept open so the FIFO does not report end of file between writers
+    int m_keepAliveFd;
+    bool m_created;
+    std::atomic<bool> m_stop;
+    std::atomic<mfxU32> m_rejected;
+    std::thread m_thread;
+};
+
+} // namespace TranscodingSample
+
+#endif //__SMT_CONTROL_H__
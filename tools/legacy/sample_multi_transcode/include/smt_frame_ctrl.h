@@ -0,0 +1,81 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __SMT_FRAME_CTRL_H__
+#define __SMT_FRAME_CTRL_H__
+
+#include <stddef.h>
+#include <deque>
+#include <vector>
+
+#include "vpl/mfxstructures.h"
+
+namespace TranscodingSample {
+
+// Encode control of one frame together with the ext buffers it points to. The encoder may keep
+// the pointers until the frame is encoded, so a bundle is bound to an input surface and reused
+// every time that surface is submitted again.
+struct FrameControl {
+    explicit FrameControl(mfxU32 numQP);
+
+    // Makes Ctrl a copy of *pSrc (may be NULL) referring to its ext buffers through ExtParam
+    void Reset(const mfxEncodeCtrl* pSrc);
+    // Appends one more ext buffer to Ctrl
+    void Attach(mfxExtBuffer* pBuffer);
+
+    mfxEncodeCtrl Ctrl;
+    mfxExtEncoderROI ROI;
+    mfxExtMBQP MBQP;
+    std::vector<mfxU8> QP;
+    std::vector<mfxExtBuffer*> ExtParam;
+
+private:
+    // MBQP.QP and Ctrl.ExtParam point into the object
+    FrameControl(const FrameControl&)            = delete;
+    FrameControl& operator=(const FrameControl&) = delete;
+};
+
+// Per session set of FrameControl bundles. Bundles are constructed up front and never move, the
+// bundle of a surface is found in an open addressing table, so a frame costs neither map lookups
+// nor heap allocations once every surface of the pool has been seen.
+class FrameControlArena {
+public:
+    FrameControlArena();
+
+    // Preconstructs numSlots bundles, numQP is the size of the MBQP map or 0
+    void Init(size_t numSlots, mfxU32 numQP);
+    void Close();
+
+    // Returns bundle of the surface, a free one is bound to it on the first call
+    FrameControl& Get(const mfxFrameSurface1* pSurface);
+
+    size_t GetBoundCount() const {
+        return m_bound;
+    }
+    size_t GetCapacity() const {
+        return m_slots.size();
+    }
+
+private:
+    FrameControlArena(const FrameControlArena&)            = delete;
+    FrameControlArena& operator=(const FrameControlArena&) = delete;
+
+    // Position of the surface in the table or of the empty entry where it belongs
+    size_t Find(const mfxFrameSurface1* pSurface) const;
+    void Rehash(size_t tableSize);
+
+    mfxU32 m_numQP;
+    // std::deque keeps references valid when more bundles are added
+    std::deque<FrameControl> m_slots;
+    size_t m_bound;
+    // surface -> bundle index, size is a power of 2 and at least twice the bound count
+    std::vector<const mfxFrameSurface1*> m_keys;
+    std::vector<mfxU32> m_values;
+};
+
+} // namespace TranscodingSample
+
+#endif //__SMT_FRAME_CTRL_H__
@@ -0,0 +1,133 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __SMT_ROI_H__
+#define __SMT_ROI_H__
+
+#include <stdio.h>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vpl/mfxstructures.h"
+
+namespace TranscodingSample {
+
+// ROI file given with -roi_file: for every frame "N;L;T;R;B;DeltaQP;..." with N rectangles.
+// The file is validated and indexed once, the per-frame ROI lists are read back on demand so
+// memory does not grow with the stream length. The object is immutable and can be shared by
+// all sessions.
+class ROIFile {
+public:
+    // Returns nullptr if the file can't be read or has wrong format
+    static std::shared_ptr<const ROIFile> Open(const std::string& fileName);
+
+    const std::string& GetFileName() const {
+        return m_fileName;
+    }
+    mfxU32 GetFrameCount() const {
+        return m_frameCount;
+    }
+
+    // every CheckpointStep-th frame has its file offset stored
+    static const mfxU32 CheckpointStep = 64;
+
+    long GetCheckpointOffset(mfxU32 frame) const {
+        return m_checkpoints[frame / CheckpointStep];
+    }
+
+    enum class Item { Value, End, Error };
+
+    // Reads next ';' separated item ignoring white spaces; pPos is advanced by bytes consumed
+    static Item ReadItem(FILE* file, std::string& item, long* pPos);
+    // Reads ROI list of the next frame
+    static Item ReadFrame(FILE* file, mfxExtEncoderROI& roi, long* pPos);
+
+private:
+    ROIFile() : m_fileName(), m_frameCount(0), m_checkpoints() {}
+
+    std::string m_fileName;
+    mfxU32 m_frameCount;
+    std::vector<long> m_checkpoints;
+};
+
+// Sequential reader of ROIFile, one per session
+class ROIReader {
+public:
+    ROIReader();
+    ~ROIReader();
+
+    mfxStatus Init(std::shared_ptr<const ROIFile> file);
+    void Close();
+
+    // Returns ROI list of given frame, valid until the next call, or NULL if there is none
+    const mfxExtEncoderROI* GetFrame(mfxU32 frame);
+
+private:
+    ROIReader(const ROIReader&)            = delete;
+    ROIReader& operator=(const ROIReader&) = delete;
+
+    std::shared_ptr<const ROIFile> m_file;
+    FILE* m_fd;
+    // frame read by next ReadFrame call and file position of it
+    mfxU32 m_nextFrame;
+    long m_nextPos;
+    // last frame read, repeated requests are served from here
+    mfxU32 m_lastFrame;
+    mfxExtEncoderROI m_lastROI;
+};
+
+// Builds MBQP maps of 16x16 blocks from ROI lists. Rectangles are snapped to the QP block size
+// of the encoder (16, 32 or 64), maps built for recently seen ROI lists are reused.
+class MBQPRasterizer {
+public:
+    MBQPRasterizer();
+
+    void Init(mfxU32 mapWidth, mfxU32 mapHeight, mfxU16 blockSize, size_t cacheSize = 16);
+    bool IsInitialized() const {
+        return m_mapWidth != 0;
+    }
+
+    // Fills numQP values of progressive frame map, roi may be NULL
+    void FillFrame(mfxU8* qp, mfxU32 numQP, mfxU32 frameQP, const mfxExtEncoderROI* roi);
+    // Fills numQP values of a field map, it covers half of the map rows
+    void FillField(mfxU8* qp, mfxU32 numQP, mfxU32 fieldQP, const mfxExtEncoderROI* roi);
+
+    mfxU32 GetCacheHits() const {
+        return m_cacheHits;
+    }
+
+private:
+    struct CachedMap {
+        bool field;
+        mfxU32 baseQP;
+        mfxU16 numROI;
+        std::vector<mfxU8> roi;
+        std::vector<mfxU8> map;
+    };
+
+    void Rasterize(mfxU8* qp,
+                   mfxU32 numQP,
+                   mfxU32 baseQP,
+                   const mfxExtEncoderROI& roi,
+                   mfxU32 rows,
+                   mfxU32 vertBlockSize);
+    void Fill(mfxU8* qp, mfxU32 numQP, mfxU32 baseQP, const mfxExtEncoderROI* roi, bool field);
+
+    mfxU32 m_mapWidth;
+    mfxU32 m_mapHeight;
+    mfxU16 m_blockSize;
+    size_t m_cacheSize;
+    mfxU32 m_cacheHits;
+    // most recently used first
+    std::list<CachedMap> m_cache;
+    std::vector<mfxU32> m_bands;
+};
+
+} // namespace TranscodingSample
+
+#endif //__SMT_ROI_H__
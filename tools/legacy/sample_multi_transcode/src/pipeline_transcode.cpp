@@ -94,6 +94,9 @@ CTranscodingPipeline::CTranscodingPipeline()
           m_encoderFourCC(0),
           m_dumpVppCompFileWriter(),
           m_vppCompDumpRenderMode(0),
+          m_qualityChecker(),
+          m_bQualityCheck(false),
+          m_pShmRing(),
           m_hwdev4Rendering(NULL),
           m_pSurfaceDecPool(),
           m_pSurfaceEncPool(),
@@ -130,6 +133,10 @@ CTranscodingPipeline::CTranscodingPipeline()
           m_nID(0),
           m_AsyncDepth(0),
           m_nProcessedFramesNum(0),
+          m_FirstFrameTick(0),
+          m_RenditionLatency(),
+          m_CascadeLockedSurfaces(),
+          m_CascadeFrameTick(0),
           m_nTotalFramesNum(0),
           m_bIsJoinSession(false),
           m_bAllocHint(),
@@ -149,28 +156,30 @@ CTranscodingPipeline::CTranscodingPipeline()
           m_mStopSession(),
           m_bRobustFlag(false),
           m_bSoftGpuHangRecovery(false),
+          m_bGpuHangDetected(false),
+          m_Checkpoint(),
+          m_nResumeSkipFrames(0),
           isHEVCSW(false),
           m_bInsertIDR(false),
           m_rawInput(false),
           m_shouldUseShifted10BitEnc(false),
           m_pBSStore(),
+          m_pBitstreamPool(),
           m_FrameNumberPreference(0xFFFFFFFF),
           m_MaxFramesForTranscode(0xFFFFFFFF),
           m_MaxFramesForEncode(0),
           m_pBSProcessor(NULL),
-          m_nReqFrameTime(0),
+          m_FramePacer(),
           statisticsWindowSize(0),
           m_nOutputFramesNum(0),
           inputStatistics(),
           outputStatistics(),
           shouldUseGreedyFormula(false),
-          m_ROIData(),
+          m_ROIReader(),
           m_nSubmittedFramesNum(0),
           m_bUseQPMap(0),
-          m_bufExtMBQP(),
-          m_qpMapStorage(),
-          m_extBuffPtrStorage(),
-          encControlStorage(),
+          m_MBQPRasterizer(),
+          m_FrameControls(),
           m_QPmapWidth(0),
           m_QPmapHeight(0),
           m_GOPSize(0),
@@ -274,9 +283,7 @@ mfxStatus CTranscodingPipeline::DecodePreInit(sInputParams* pParams) {
         m_bOwnMVCSeqDescMemory = false;
     }
 
-    if (pParams->nFPS) {
-        this->m_nReqFrameTime = 1000000 / pParams->nFPS;
-    }
+    m_FramePacer.Reset(pParams->nFPS, pParams->nFPSDenom);
 
     return sts;
 
@@ -372,13 +379,14 @@ mfxStatus CTranscodingPipeline::VPPPreInit(sInputParams* pParams) {
             MSDK_CHECK_STATUS(sts, "InitVppMfxParams failed");
 
             if (m_ScalerConfig.CascadeScalerRequired && TargetID == DecoderTargetID) {
-                for (const auto& p : m_ScalerConfig.Pools) {
-                    const auto& PoolDesc = p.second;
-                    if (PoolDesc.ID == DecoderPoolID) {
+                //output of the source pool is input of the next one, go in dispatch order
+                for (mfxU32 id : m_ScalerConfig.DispatchOrder) {
+                    const auto& desc = m_ScalerConfig.GetDesc(id);
+                    if (!desc.CascadeScaler) {
                         continue;
                     }
 
-                    sts = InitVppMfxParams(m_mfxCSVppParams[PoolDesc.ID], pParams, PoolDesc.ID);
+                    sts = InitVppMfxParams(m_mfxCSVppParams[desc.PoolID], pParams, desc.PoolID);
                     MSDK_CHECK_STATUS(sts, "InitVppMfxParams failed");
                 }
             }
@@ -1069,6 +1077,99 @@ mfxStatus CTranscodingPipeline::ConfigTCBRCTest(mfxFrameSurface1* pSurf) {
     return sts;
 }
 
+void CTranscodingPipeline::ApplyControlCommands() {
+    if (!m_pControlMailbox || !m_pmfxENC.get())
+        return;
+
+    msdk_tick now = msdk_time_get_tick();
+    if (!m_pControlMailbox->Fetch(m_ControlCommands, m_ExpiredControlCommands, now))
+        return;
+
+    static msdk_tick frequency = msdk_time_get_frequency();
+    for (const ControlCommand& cmd : m_ExpiredControlCommands) {
+        printf("[ctrl] session %s: \"%s\" expired after %.1f ms\n",
+               m_ControlName.c_str(),
+               cmd.Text.c_str(),
+               1000. * (now - cmd.Received) / frequency);
+        m_ControlStat.Expired++;
+    }
+
+    if (!m_ControlMaxWidth) {
+        m_ControlMaxWidth  = m_mfxEncParams.mfx.FrameInfo.Width;
+        m_ControlMaxHeight = m_mfxEncParams.mfx.FrameInfo.Height;
+    }
+    // VPP output size is changed together with the encoder one, MBQP maps keep the initial size
+    bool canResize = m_pmfxVPP.get() && !m_bIsPlugin && !m_nVPPCompMode && !m_bUseQPMap;
+
+    for (const ControlCommand& cmd : m_ControlCommands) {
+        mfxInfoMFX enc      = m_mfxEncParams.mfx;
+        mfxFrameInfo vppOut = m_mfxVppParams.vpp.Out;
+        ControlChange change;
+        std::string error;
+
+        mfxStatus sts = ApplyControlCommand(cmd,
+                                            enc,
+                                            canResize ? &vppOut : NULL,
+                                            m_ControlMaxWidth,
+                                            m_ControlMaxHeight,
+                                            change,
+                                            error);
+
+        msdk_tick start = msdk_time_get_tick();
+        if (sts == MFX_ERR_NONE && change.ResetVpp) {
+            std::swap(m_mfxVppParams.vpp.Out, vppOut);
+            sts = m_pmfxVPP->Reset(&m_mfxVppParams);
+            if (sts < MFX_ERR_NONE) {
+                std::swap(m_mfxVppParams.vpp.Out, vppOut);
+                error = std::string("VPP Reset failed with ") + StatusToString(sts);
+            }
+        }
+        if (sts >= MFX_ERR_NONE && change.ResetEncoder) {
+            std::swap(m_mfxEncParams.mfx, enc);
+            sts = m_pmfxENC->Reset(&m_mfxEncParams);
+            if (sts < MFX_ERR_NONE) {
+                std::swap(m_mfxEncParams.mfx, enc);
+                error = std::string("encoder Reset failed with ") + StatusToString(sts);
+
+                // resolution is changed in both components or in none
+                if (change.ResetVpp) {
+                    std::swap(m_mfxVppParams.vpp.Out, vppOut);
+                    m_pmfxVPP->Reset(&m_mfxVppParams);
+                }
+            }
+        }
+        msdk_tick end = msdk_time_get_tick();
+
+        if (sts < MFX_ERR_NONE) {
+            printf("[ctrl] session %s: \"%s\" rejected: %s\n",
+                   m_ControlName.c_str(),
+                   cmd.Text.c_str(),
+                   error.c_str());
+            m_ControlStat.Rejected++;
+            continue;
+        }
+
+        if (change.InsertIDR)
+            m_bInsertIDR = true;
+        if (change.SetFrameQP)
+            m_ControlFrameQP = change.FrameQP;
+
+        msdk_tick wait = start - cmd.Received;
+        msdk_tick cost = end - start;
+        m_ControlStat.Applied++;
+        m_ControlStat.WaitTotal += wait;
+        m_ControlStat.WaitMax = std::max(m_ControlStat.WaitMax, wait);
+        m_ControlStat.CostTotal += cost;
+        m_ControlStat.CostMax = std::max(m_ControlStat.CostMax, cost);
+
+        printf("[ctrl] session %s: \"%s\" applied after %.1f ms, reset took %.1f ms\n",
+               m_ControlName.c_str(),
+               cmd.Text.c_str(),
+               1000. * wait / frequency,
+               1000. * cost / frequency);
+    }
+}
+
 // signal that there are no more frames
 void CTranscodingPipeline::NoMoreFramesSignal() {
     SafetySurfaceBuffer* pNextBuffer = m_pBuffer;
@@ -1150,7 +1251,7 @@ mfxStatus CTranscodingPipeline::Decode() {
         if (pNextBuffer->GetLength() == 0) {
             // add surfaces in queue for all sinks
             pNextBuffer->AddSurface(PreEncExtSurface);
-            m_nProcessedFramesNum++;
+            CountProcessedFrame();
         }
         return MFX_ERR_NONE;
     }
@@ -1165,8 +1266,6 @@ mfxStatus CTranscodingPipeline::Decode() {
         if (bLastCycle)
             SetNumFramesForReset(0);
 
-        msdk_tick nBeginTime = msdk_time_get_tick(); // microseconds.
-
         if (shouldReadNextFrame) {
             if (!bEndOfFile) {
                 if (!m_bUseOverlay) {
@@ -1259,32 +1358,12 @@ mfxStatus CTranscodingPipeline::Decode() {
                 }
                 else {
                     if (m_ScalerConfig.CascadeScalerRequired) {
-                        ExtendedSurface InSurface = DecExtSurface;
-                        for (auto desc : m_ScalerConfig.Targets) {
-                            if (desc.CascadeScaler) {
-                                sts = VPPOneFrame(&InSurface, &VppExtSurface, desc.TargetID);
-                                if (sts == MFX_ERR_NONE) {
-                                    IncreaseReference(*VppExtSurface.pSurface);
-                                    InSurface = VppExtSurface;
-                                }
-                                else if (sts == MFX_ERR_MORE_DATA && !bEndOfFile) {
-                                    sts = MFX_ERR_NONE; //important to continue processing
-                                    break;
-                                }
-                                else if (sts == MFX_ERR_MORE_DATA && bEndOfFile) {
-                                    VppExtSurface = InSurface;
-                                }
-                                else {
-                                    return MFX_ERR_UNKNOWN;
-                                }
-                            }
-                            else {
-                                VppExtSurface = InSurface;
-                            }
-
-                            VppExtSurface.TargetID =
-                                desc.TargetID; //we can't remove it, it is used for pass thorugh case
-                            OutSurfaces.push_back(VppExtSurface);
+                        sts = CascadeScaleFrame(DecExtSurface,
+                                                VppExtSurface,
+                                                OutSurfaces,
+                                                bEndOfFile);
+                        if (sts == MFX_ERR_UNKNOWN) {
+                            return sts;
                         }
                     }
                     else {
@@ -1371,32 +1450,22 @@ mfxStatus CTranscodingPipeline::Decode() {
 
         // add surfaces in queue for all sinks
         if (m_ScalerConfig.CascadeScalerRequired) {
-            //unlock out surfaces
             for (auto& s : OutSurfaces) {
-                auto desc = m_ScalerConfig.GetDesc(s.TargetID);
-                if (desc.CascadeScaler) {
-                    DecreaseReference(*s.pSurface);
-                }
+                sts = PublishRendition(s);
+                MSDK_CHECK_STATUS(sts, "PublishRendition failed");
             }
+            OutSurfaces.clear();
 
-            //build list of output buffers and reverse it to match order of output surfaces
-            std::vector<SafetySurfaceBuffer*> buf;
-            do {
-                buf.push_back(pNextBuffer);
-                pNextBuffer = pNextBuffer->m_pNext;
-            } while (pNextBuffer);
-            std::reverse(buf.begin(), buf.end());
-            pNextBuffer = buf[0];
-
-            for (mfxU32 i = 0; i < OutSurfaces.size(); i++) {
-                //sanity check
-                if (buf[i]->TargetID != OutSurfaces[i].TargetID) {
-                    return MFX_ERR_UNKNOWN;
-                }
-                buf[i]->AddSurface(OutSurfaces[i]);
+            //unlock cascade outputs, buffers hold their own references
+            for (auto pSurface : m_CascadeLockedSurfaces) {
+                DecreaseReference(*pSurface);
             }
+            m_CascadeLockedSurfaces.clear();
 
-            OutSurfaces.clear();
+            //buffers are chained in reverse order, throttle on the first target
+            while (pNextBuffer->m_pNext) {
+                pNextBuffer = pNextBuffer->m_pNext;
+            }
         }
         else {
             pNextBuffer->AddSurface(PreEncExtSurface);
@@ -1452,11 +1521,8 @@ mfxStatus CTranscodingPipeline::Decode() {
             break;
         }
 
-        msdk_tick nFrameTime = msdk_time_get_tick() - nBeginTime;
-        if (nFrameTime < m_nReqFrameTime) {
-            MSDK_USLEEP((mfxU32)(m_nReqFrameTime - nFrameTime));
-        }
-        if (++m_nProcessedFramesNum >= m_MaxFramesForTranscode) {
+        m_FramePacer.Work();
+        if (CountProcessedFrame() >= m_MaxFramesForTranscode) {
             break;
         }
     }
@@ -1471,6 +1537,113 @@ mfxStatus CTranscodingPipeline::Decode() {
     return sts;
 } // mfxStatus CTranscodingPipeline::Decode()
 
+mfxStatus CTranscodingPipeline::CascadeScaleFrame(const ExtendedSurface& DecExtSurface,
+                                                  ExtendedSurface& VppExtSurface,
+                                                  std::vector<ExtendedSurface>& OutSurfaces,
+                                                  bool bEndOfFile) {
+    mfxStatus sts           = MFX_ERR_NONE;
+    ExtendedSurface LastOut = { 0 };
+    m_CascadeFrameTick      = msdk_time_get_tick();
+
+    //output of every pool for this frame, decoder pool is the root of the scaling tree
+    std::map<mfxU32, ExtendedSurface> PoolSurfaces;
+    PoolSurfaces[DecoderPoolID] = DecExtSurface;
+
+    for (mfxU32 id : m_ScalerConfig.DispatchOrder) {
+        const auto desc = m_ScalerConfig.GetDesc(id);
+        mfxU32 InPoolID =
+            desc.CascadeScaler ? m_ScalerConfig.Pools[desc.PoolID].PrevID : desc.PoolID;
+
+        auto in = PoolSurfaces.find(InPoolID);
+        if (in == PoolSurfaces.end()) {
+            //source has no output for this frame yet, neither has this target
+            continue;
+        }
+        ExtendedSurface InSurface = in->second;
+
+        if (desc.CascadeScaler) {
+            sts = VPPOneFrame(&InSurface, &VppExtSurface, id);
+            if (sts == MFX_ERR_NONE) {
+                IncreaseReference(*VppExtSurface.pSurface);
+                m_CascadeLockedSurfaces.push_back(VppExtSurface.pSurface);
+            }
+            else if (sts == MFX_ERR_MORE_DATA && !bEndOfFile) {
+                sts = MFX_ERR_NONE; //important to continue processing
+                continue;
+            }
+            else if (sts == MFX_ERR_MORE_DATA && bEndOfFile) {
+                VppExtSurface = InSurface;
+            }
+            else {
+                return MFX_ERR_UNKNOWN;
+            }
+            PoolSurfaces[desc.PoolID] = VppExtSurface;
+        }
+        else {
+            VppExtSurface = InSurface;
+        }
+
+        VppExtSurface.TargetID = id; //we can't remove it, it is used for pass thorugh case
+        LastOut                = VppExtSurface;
+
+        //targets with deadline don't wait for the rest of the tree
+        if (desc.LatencyBudget) {
+            mfxStatus sts_publish = PublishRendition(VppExtSurface);
+            MSDK_CHECK_STATUS(sts_publish, "PublishRendition failed");
+        }
+        else {
+            OutSurfaces.push_back(VppExtSurface);
+        }
+    }
+
+    VppExtSurface = LastOut;
+    return sts;
+} // mfxStatus CTranscodingPipeline::CascadeScaleFrame()
+
+mfxStatus CTranscodingPipeline::PublishRendition(const ExtendedSurface& Surf) {
+    SafetySurfaceBuffer* pBuffer = m_pBuffer;
+    while (pBuffer && pBuffer->TargetID != Surf.TargetID) {
+        pBuffer = pBuffer->m_pNext;
+    }
+    MSDK_CHECK_POINTER(pBuffer, MFX_ERR_UNKNOWN);
+
+    //renditions with deadline are handed over scaled, latency is taken when scaling is complete
+    ExtendedSurface Rendition = Surf;
+    mfxU32 Budget             = m_ScalerConfig.GetDesc(Surf.TargetID).LatencyBudget;
+    if (Rendition.pSurface && Budget) {
+        mfxStatus sts = SyncRendition(Rendition);
+        MSDK_CHECK_STATUS(sts, "SyncRendition failed");
+
+        static msdk_tick frequency = msdk_time_get_frequency();
+        msdk_tick latency          = msdk_time_get_tick() - m_CascadeFrameTick;
+
+        RenditionLatency& stat = m_RenditionLatency[Surf.TargetID];
+        stat.Budget            = Budget;
+        stat.Max               = std::max(stat.Max, latency);
+        stat.Total += latency;
+        stat.Frames++;
+        if (latency * 1000 > (msdk_tick)stat.Budget * frequency) {
+            stat.Missed++;
+        }
+    }
+    pBuffer->AddSurface(Rendition);
+
+    return MFX_ERR_NONE;
+} // mfxStatus CTranscodingPipeline::PublishRendition()
+
+mfxStatus CTranscodingPipeline::SyncRendition(ExtendedSurface& Surf) {
+    if (!Surf.Syncp)
+        return MFX_ERR_NONE;
+
+    MFX_ITT_TASK("SyncOperation");
+    mfxStatus sts = m_pmfxSession->SyncOperation(Surf.Syncp, GetSyncOpTimeout());
+    HandlePossibleGpuHang(sts);
+    MSDK_CHECK_ERR_NONE_STATUS(sts, MFX_ERR_ABORTED, "Cascade: SyncOperation failed");
+    Surf.Syncp = NULL;
+
+    return MFX_ERR_NONE;
+} // mfxStatus CTranscodingPipeline::SyncRendition()
+
 mfxStatus CTranscodingPipeline::Encode() {
     mfxStatus sts                  = MFX_ERR_NONE;
     ExtendedSurface DecExtSurface  = { 0 };
@@ -1484,7 +1657,6 @@ mfxStatus CTranscodingPipeline::Encode() {
 
     bool shouldReadNextFrame = true;
     while (MFX_ERR_NONE == sts || MFX_ERR_MORE_DATA == sts) {
-        msdk_tick nBeginTime = msdk_time_get_tick(); // microseconds
         if (shouldReadNextFrame) {
             if (isQuit) {
                 // We're here because one of decoders has reported that there're no any more frames ready.
@@ -1544,6 +1716,8 @@ mfxStatus CTranscodingPipeline::Encode() {
             if (NULL == DecExtSurface.pSurface) {
                 isQuit = true;
             }
+
+            ApplyControlCommands();
         }
 
         if (m_pmfxVPP.get()) {
@@ -1634,8 +1808,11 @@ mfxStatus CTranscodingPipeline::Encode() {
             m_pBSProcessor->ResetOutput();
         }
 
-        SetEncCtrlRT(VppExtSurface, m_bInsertIDR);
-        m_bInsertIDR = false;
+        // a resumed session drops the frames written before its checkpoint
+        bool bResumeSkip = VppExtSurface.pSurface && m_nResumeSkipFrames;
+        SetEncCtrlRT(VppExtSurface, m_bInsertIDR && !bResumeSkip);
+        if (!bResumeSkip)
+            m_bInsertIDR = false;
 
         if ((m_nVPPCompMode != VppCompOnly) || (m_nVPPCompMode == VppCompOnlyEncode)) {
             if (m_mfxEncParams.mfx.CodecId != MFX_CODEC_DUMP) {
@@ -1647,6 +1824,14 @@ mfxStatus CTranscodingPipeline::Encode() {
                     VppExtSurface.Syncp = nullptr;
                     sts                 = MFX_ERR_MORE_DATA;
                 }
+                else if (bResumeSkip) {
+                    m_nResumeSkipFrames--;
+                    VppExtSurface.Syncp = nullptr;
+                    sts                 = MFX_ERR_MORE_DATA;
+                    if (CountProcessedFrame() >= m_MaxFramesForTranscode) {
+                        bPollFlag = true;
+                    }
+                }
                 else {
                     if (bPollFlag) {
                         VppExtSurface.pSurface = 0;
@@ -1667,7 +1852,7 @@ mfxStatus CTranscodingPipeline::Encode() {
 
                     // Count only real surfaces
                     if (VppExtSurface.pSurface) {
-                        m_nProcessedFramesNum++;
+                        CountProcessedFrame();
                         bAllBlackFrame = true; //reset value, default to true
                     }
 
@@ -1679,6 +1864,11 @@ mfxStatus CTranscodingPipeline::Encode() {
                         nFramesAlreadyPut++;
                 }
             }
+            else if (bResumeSkip) {
+                m_nResumeSkipFrames--;
+                VppExtSurface.Syncp = nullptr;
+                sts                 = MFX_ERR_MORE_DATA;
+            }
             else {
                 sts = Surface2BS(&VppExtSurface, &m_BSPool.back()->Bitstream, m_encoderFourCC);
             }
@@ -1779,10 +1969,7 @@ mfxStatus CTranscodingPipeline::Encode() {
             }
         } // if (m_nVPPCompMode != VppCompOnly)
 
-        msdk_tick nFrameTime = msdk_time_get_tick() - nBeginTime;
-        if (nFrameTime < m_nReqFrameTime) {
-            MSDK_USLEEP((mfxU32)(m_nReqFrameTime - nFrameTime));
-        }
+        m_FramePacer.Work();
     }
     MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_DATA);
 
@@ -1843,41 +2030,11 @@ void CTranscodingPipeline::FillMBQPBuffer(mfxExtMBQP& qpMap, mfxU16 pictStruct)
 
     // External MBQP with ROI case
     if (pictStruct == MFX_PICSTRUCT_PROGRESSIVE) {
-        mfxI8 fQP = (m_nSubmittedFramesNum % m_GOPSize) ? (mfxI8)m_QPforP : (mfxI8)m_QPforI;
-        std::memset(qpMap.QP, fQP, qpMap.NumQPAlloc);
-
-        //        printf("QP expectation: %d, map PTR %lld\n",fQP,(long long int)qpMap.QP);
-
-        if (m_ROIData.size() > m_nSubmittedFramesNum) {
-            mfxExtEncoderROI& roi = m_ROIData[m_nSubmittedFramesNum];
-            for (mfxI32 i = roi.NumROI - 1; i >= 0; i--) {
-                mfxU32 l = (roi.ROI[i].Left) >> 4, t = (roi.ROI[i].Top) >> 4,
-                       r = (roi.ROI[i].Right + 15) >> 4, b = (roi.ROI[i].Bottom + 15) >> 4;
-
-                //Additional 32x32 block alignment for HEVC VDEnc, using caps could be better
-                if (m_mfxEncParams.mfx.CodecId == MFX_CODEC_HEVC &&
-                    m_mfxEncParams.mfx.LowPower == MFX_CODINGOPTION_ON) {
-                    l = ((roi.ROI[i].Left) >> 5) << 1;
-                    t = ((roi.ROI[i].Top) >> 5) << 1;
-                    r = ((roi.ROI[i].Right + 31) >> 5) << 1;
-                    b = ((roi.ROI[i].Bottom + 31) >> 5) << 1;
-                }
-
-                if (l > m_QPmapWidth)
-                    l = m_QPmapWidth;
-                if (r > m_QPmapWidth)
-                    r = m_QPmapWidth;
-                if (t > m_QPmapHeight)
-                    t = m_QPmapHeight;
-                if (b > m_QPmapHeight)
-                    b = m_QPmapHeight;
-
-                mfxI8 qp_value = (mfxI8)std::min(std::max(fQP + (mfxI8)roi.ROI[i].DeltaQP, 0), 51);
-
-                for (mfxU32 k = t; k < b; k++)
-                    std::memset(qpMap.QP + k * m_QPmapWidth + l, qp_value, r - l);
-            }
-        }
+        mfxU32 fQP = (m_nSubmittedFramesNum % m_GOPSize) ? m_QPforP : m_QPforI;
+        m_MBQPRasterizer.FillFrame(qpMap.QP,
+                                   qpMap.NumQPAlloc,
+                                   fQP,
+                                   m_ROIReader.GetFrame(m_nSubmittedFramesNum));
     }
     else if (pictStruct == MFX_PICSTRUCT_FIELD_TFF || pictStruct == MFX_PICSTRUCT_FIELD_BFF) {
         mfxU32 fQP[2] = { (m_nSubmittedFramesNum % m_GOPSize) ? m_QPforP : m_QPforI,
@@ -1888,28 +2045,10 @@ void CTranscodingPipeline::FillMBQPBuffer(mfxExtMBQP& qpMap, mfxU16 pictStruct)
         fOff[(pictStruct == MFX_PICSTRUCT_FIELD_BFF) ? 0 : 1] = qpMap.NumQPAlloc / 2;
 
         for (int fld = 0; fld <= 1; fld++) {
-            std::memset(qpMap.QP + fOff[fld], fQP[fld], qpMap.NumQPAlloc / 2);
-            if (m_ROIData.size() > fIdx[fld]) {
-                mfxExtEncoderROI& roi = m_ROIData[fIdx[fld]];
-                for (mfxI32 i = roi.NumROI - 1; i >= 0; i--) {
-                    mfxU32 l = (roi.ROI[i].Left) >> 4, t = (roi.ROI[i].Top) >> 5,
-                           r = (roi.ROI[i].Right + 15) >> 4, b = (roi.ROI[i].Bottom + 31) >> 5;
-                    mfxI8 qp_delta = (mfxI8)roi.ROI[i].DeltaQP;
-                    mfxU8 roi_qp   = (mfxU8)std::min(std::max(mfxI8(fQP[fld]) + qp_delta, 0), 51);
-
-                    if (l > m_QPmapWidth)
-                        l = m_QPmapWidth;
-                    if (r > m_QPmapWidth)
-                        r = m_QPmapWidth;
-                    if (t > m_QPmapHeight / 2)
-                        t = m_QPmapHeight / 2;
-                    if (b > m_QPmapHeight / 2)
-                        b = m_QPmapHeight / 2;
-
-                    for (mfxU32 k = t; k < b; k++)
-                        std::memset(qpMap.QP + fOff[fld] + k * m_QPmapWidth + l, roi_qp, r - l);
-                }
-            }
+            m_MBQPRasterizer.FillField(qpMap.QP + fOff[fld],
+                                       qpMap.NumQPAlloc / 2,
+                                       fQP[fld],
+                                       m_ROIReader.GetFrame(fIdx[fld]));
         }
     }
     else {
@@ -1918,73 +2057,67 @@ void CTranscodingPipeline::FillMBQPBuffer(mfxExtMBQP& qpMap, mfxU16 pictStruct)
     }
 }
 
-void CTranscodingPipeline::SetEncCtrlRT(ExtendedSurface& extSurface, bool bInsertIDR) {
-    extSurface.pEncCtrl = NULL;
-    if (extSurface.pAuxCtrl) {
-        extSurface.pEncCtrl = &extSurface.pAuxCtrl->encCtrl;
-    }
+mfxU16 CTranscodingPipeline::GetMBQPBlockSize() {
+    // Query QP block size the encoder works with, HEVC reports it in mfxExtMBQP
+    if (m_pmfxENC.get()) {
+        mfxExtMBQP mbqp;
+        MSDK_ZERO_MEMORY(mbqp);
+        mbqp.Header.BufferId = MFX_EXTBUFF_MBQP;
+        mbqp.Header.BufferSz = sizeof(mfxExtMBQP);
 
-    if (extSurface.pSurface) {
-        void* keyId = (void*)extSurface.pSurface;
+        mfxExtBuffer* extParam[] = { &mbqp.Header };
 
-        // Use encoded surface pointer to find placeholders for run-time structures in maps
-        if (m_bUseQPMap && m_bufExtMBQP.find(keyId) == m_bufExtMBQP.end()) {
-            m_extBuffPtrStorage[keyId] = std::vector<mfxExtBuffer*>();
+        mfxVideoParam enc_par;
+        MSDK_ZERO_MEMORY(enc_par);
+        enc_par.ExtParam    = extParam;
+        enc_par.NumExtParam = 1;
 
-            m_qpMapStorage[keyId] = std::vector<mfxU8>();
-            m_qpMapStorage[keyId].resize(m_QPmapWidth * m_QPmapHeight);
+        if (m_pmfxENC->GetVideoParam(&enc_par) >= MFX_ERR_NONE &&
+            (mbqp.BlockSize == 16 || mbqp.BlockSize == 32 || mbqp.BlockSize == 64))
+            return mbqp.BlockSize;
+    }
 
-            m_bufExtMBQP[keyId]                 = mfxExtMBQP();
-            m_bufExtMBQP[keyId].Header.BufferId = MFX_EXTBUFF_MBQP;
-            m_bufExtMBQP[keyId].Header.BufferSz = sizeof(mfxExtMBQP);
-            m_bufExtMBQP[keyId].NumQPAlloc      = m_QPmapWidth * m_QPmapHeight;
-            m_bufExtMBQP[keyId].QP =
-                m_QPmapWidth && m_QPmapHeight ? &(m_qpMapStorage[keyId][0]) : NULL;
-        }
+    // HEVC VDEnc works with 32x32 blocks
+    if (m_mfxEncParams.mfx.CodecId == MFX_CODEC_HEVC &&
+        m_mfxEncParams.mfx.LowPower == MFX_CODINGOPTION_ON)
+        return 32;
 
-        // Initialize *pCtrl optionally copying content of the pExtSurface.pAuxCtrl.encCtrl
-        mfxEncodeCtrl& ctrl = encControlStorage[keyId];
-        MSDK_ZERO_MEMORY(ctrl);
+    return 16;
+}
 
-        if (extSurface.pEncCtrl) {
-            ctrl = *extSurface.pEncCtrl;
-        }
+void CTranscodingPipeline::SetEncCtrlRT(ExtendedSurface& extSurface, bool bInsertIDR) {
+    extSurface.pEncCtrl = NULL;
+    if (extSurface.pAuxCtrl) {
+        extSurface.pEncCtrl = &extSurface.pAuxCtrl->encCtrl;
+    }
 
-        // Copy all extended buffer pointers from pExtSurface.pAuxCtrl.encCtrl
-        m_extBuffPtrStorage[keyId].clear();
-        if (extSurface.pAuxCtrl) {
-            for (unsigned int i = 0; i < ctrl.NumExtParam; i++) {
-                m_extBuffPtrStorage[keyId].push_back(extSurface.pAuxCtrl->encCtrl.ExtParam[i]);
-            }
-        }
+    if (extSurface.pSurface) {
+        // Bundle bound to the encoded surface keeps run-time structures until it is encoded,
+        // its control is a copy of pExtSurface.pAuxCtrl.encCtrl if there is one
+        FrameControl& frameCtrl = m_FrameControls.Get(extSurface.pSurface);
+        frameCtrl.Reset(extSurface.pEncCtrl);
+        if (m_ControlFrameQP)
+            frameCtrl.Ctrl.QP = m_ControlFrameQP;
 
         // Attach additional buffer with either MBQP or ROI information
         if (m_bUseQPMap) {
-            FillMBQPBuffer(m_bufExtMBQP[keyId], extSurface.pSurface->Info.PicStruct);
-            m_extBuffPtrStorage[keyId].push_back((mfxExtBuffer*)&m_bufExtMBQP[keyId]);
+            FillMBQPBuffer(frameCtrl.MBQP, extSurface.pSurface->Info.PicStruct);
+            frameCtrl.Attach(&frameCtrl.MBQP.Header);
         }
         else {
-            if (m_ROIData.size() > m_nSubmittedFramesNum)
-                m_extBuffPtrStorage[keyId].push_back(
-                    (mfxExtBuffer*)&m_ROIData[m_nSubmittedFramesNum]);
-        }
-
-        // Replace the buffers pointer to pre-allocated storage
-        ctrl.NumExtParam = (mfxU16)m_extBuffPtrStorage[keyId].size();
-        if (ctrl.NumExtParam) {
-            ctrl.ExtParam = &(m_extBuffPtrStorage[keyId][0]);
+            // ROI list is kept per surface as the reader reuses its buffer
+            const mfxExtEncoderROI* roi = m_ROIReader.GetFrame(m_nSubmittedFramesNum);
+            if (roi) {
+                frameCtrl.ROI = *roi;
+                frameCtrl.Attach(&frameCtrl.ROI.Header);
+            }
         }
 
-        extSurface.pEncCtrl = &ctrl;
+        extSurface.pEncCtrl = &frameCtrl.Ctrl;
         m_nSubmittedFramesNum++;
     }
 
-    if (bInsertIDR && extSurface.pSurface) {
-        if (extSurface.pEncCtrl == NULL) {
-            mfxEncodeCtrl& ctrl = encControlStorage[(void*)extSurface.pSurface];
-            MSDK_ZERO_MEMORY(ctrl);
-            extSurface.pEncCtrl = &ctrl;
-        }
+    if (bInsertIDR && extSurface.pEncCtrl) {
         extSurface.pEncCtrl->FrameType = MFX_FRAMETYPE_I | MFX_FRAMETYPE_IDR | MFX_FRAMETYPE_REF;
     }
     else {
@@ -2006,8 +2139,6 @@ mfxStatus CTranscodingPipeline::Transcode() {
 
     time_t start = time(0);
     while (MFX_ERR_NONE == sts) {
-        msdk_tick nBeginTime = msdk_time_get_tick(); // microseconds.
-
         if (time(0) - start >= m_nTimeout)
             bLastCycle = true;
         if (m_MaxFramesForTranscode == m_nProcessedFramesNum) {
@@ -2054,6 +2185,8 @@ mfxStatus CTranscodingPipeline::Transcode() {
         if (m_bIsFieldSplitting && DecExtSurface.pSurface != NULL) {
             m_mfxDecParams.mfx.FrameInfo.PicStruct = DecExtSurface.pSurface->Info.PicStruct;
         }
+        if (shouldReadNextFrame)
+            ApplyControlCommands();
         // pre-process a frame
         if (m_pmfxVPP.get() && bNeedDecodedFrames && !m_rawInput) {
             if (m_bIsFieldWeaving) {
@@ -2142,11 +2275,14 @@ mfxStatus CTranscodingPipeline::Transcode() {
 
         // Set Encoding control if it is required.
 
-        SetEncCtrlRT(VppExtSurface, m_bInsertIDR);
-        m_bInsertIDR = false;
+        // a resumed session drops the frames written before its checkpoint
+        bool bResumeSkip = VppExtSurface.pSurface && m_nResumeSkipFrames;
+        SetEncCtrlRT(VppExtSurface, m_bInsertIDR && !bResumeSkip);
+        if (!bResumeSkip)
+            m_bInsertIDR = false;
 
         if (DecExtSurface.pSurface)
-            m_nProcessedFramesNum++;
+            CountProcessedFrame();
 
         if (m_mfxEncParams.mfx.CodecId != MFX_CODEC_DUMP) {
             if (VppExtSurface.pSurface &&
@@ -2154,10 +2290,20 @@ mfxStatus CTranscodingPipeline::Transcode() {
                 VppExtSurface.Syncp = nullptr;
                 sts                 = MFX_ERR_MORE_DATA;
             }
+            else if (bResumeSkip) {
+                m_nResumeSkipFrames--;
+                VppExtSurface.Syncp = nullptr;
+                sts                 = MFX_ERR_MORE_DATA;
+            }
             else {
                 sts = EncodeOneFrame(&VppExtSurface, &m_BSPool.back()->Bitstream);
             }
         }
+        else if (bResumeSkip) {
+            m_nResumeSkipFrames--;
+            VppExtSurface.Syncp = nullptr;
+            sts                 = MFX_ERR_MORE_DATA;
+        }
         else {
             sts = Surface2BS(&VppExtSurface, &m_BSPool.back()->Bitstream, m_encoderFourCC);
         }
@@ -2211,10 +2357,7 @@ mfxStatus CTranscodingPipeline::Transcode() {
             MSDK_CHECK_STATUS(sts, "PutBS failed");
         }
 
-        msdk_tick nFrameTime = msdk_time_get_tick() - nBeginTime;
-        if (nFrameTime < m_nReqFrameTime) {
-            MSDK_USLEEP((mfxU32)(m_nReqFrameTime - nFrameTime));
-        }
+        m_FramePacer.Work();
     }
     MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_DATA);
 
@@ -2267,6 +2410,10 @@ mfxStatus CTranscodingPipeline::PutBS() {
         outputStatistics.StartTimeMeasurement();
     }
 
+    if (m_bRobustFlag && (pBitstreamEx->Bitstream.FrameType & MFX_FRAMETYPE_IDR)) {
+        UpdateCheckpoint();
+    }
+
     m_ScalerConfig.Tracer->BeginEvent(SMTTracer::ThreadType::ENC,
                                       TargetID,
                                       SMTTracer::EventName::WRITE_BS,
@@ -2349,6 +2496,11 @@ mfxStatus CTranscodingPipeline::DumpSurface2File(mfxFrameSurface1* pSurf) {
     sts = m_dumpVppCompFileWriter.WriteNextFrame(pSurf);
     MSDK_CHECK_STATUS(sts, "m_dumpVppCompFileWriter.WriteNextFrame failed");
 
+    if (m_bQualityCheck) {
+        sts = CheckOutputQuality(pSurf);
+        MSDK_CHECK_STATUS(sts, "CheckOutputQuality failed");
+    }
+
     if (m_MemoryModel == GENERAL_ALLOC) {
         sts = m_pMFXAllocator->Unlock(m_pMFXAllocator->pthis, pSurf->Data.MemId, &pSurf->Data);
         MSDK_CHECK_STATUS(sts, "m_pMFXAllocator->Unlock failed");
@@ -2361,6 +2513,26 @@ mfxStatus CTranscodingPipeline::DumpSurface2File(mfxFrameSurface1* pSurf) {
     return sts;
 } // mfxStatus CTranscodingPipeline::DumpSurface2File(ExtendedSurface* pSurf)
 
+mfxStatus CTranscodingPipeline::CheckOutputQuality(mfxFrameSurface1* pSurf) {
+    mfxStatus sts = m_qualityChecker.CheckFrame(pSurf->Info, pSurf->Data);
+    MSDK_CHECK_STATUS(sts, "m_qualityChecker.CheckFrame failed");
+
+    return sts;
+}
+
+mfxStatus CTranscodingPipeline::FinishQualityCheck() {
+    if (!m_bQualityCheck)
+        return MFX_ERR_NONE;
+
+    m_qualityChecker.Close();
+
+    std::stringstream prefix;
+    prefix << "session " << m_nID << ": ";
+    m_qualityChecker.PrintSummary(prefix.str().c_str());
+
+    return m_qualityChecker.GetMismatchCount() ? MFX_ERR_ABORTED : MFX_ERR_NONE;
+}
+
 mfxStatus CTranscodingPipeline::Surface2BS(ExtendedSurface* pSurf,
                                            mfxBitstreamWrapper* pBS,
                                            mfxU32 fourCC) {
@@ -2376,7 +2548,8 @@ mfxStatus CTranscodingPipeline::Surface2BS(ExtendedSurface* pSurf,
         MSDK_CHECK_ERR_NONE_STATUS(sts, MFX_ERR_ABORTED, "SyncOperation failed");
         pSurf->Syncp = 0;
 
-        if (!m_pBSProcessor->IsNulOutput()) {
+        bool bWrite = !m_pBSProcessor->IsNulOutput();
+        if (bWrite || m_bQualityCheck || m_pShmRing) {
             //--- Copying data from surface to bitstream
             if (m_MemoryModel == GENERAL_ALLOC) {
                 sts = m_pMFXAllocator->Lock(m_pMFXAllocator->pthis,
@@ -2389,27 +2562,39 @@ mfxStatus CTranscodingPipeline::Surface2BS(ExtendedSurface* pSurf,
                 MSDK_CHECK_STATUS(sts, "FrameInterface->Map failed");
             }
 
-            switch (fourCC) {
-                case 0: // Default value is MFX_FOURCC_I420
-                case MFX_FOURCC_I420:
+            if (bWrite) {
+                switch (fourCC) {
+                    case 0: // Default value is MFX_FOURCC_I420
+                    case MFX_FOURCC_I420:
 #if (MFX_VERSION >= 2000)
-                    if (m_initPar.Implementation == MFX_IMPL_SOFTWARE)
-                        sts = I420toBS(pSurf->pSurface, pBS);
-                    else
+                        if (m_initPar.Implementation == MFX_IMPL_SOFTWARE)
+                            sts = I420toBS(pSurf->pSurface, pBS);
+                        else
 #endif
-                        sts = NV12asI420toBS(pSurf->pSurface, pBS);
-                    break;
-                case MFX_FOURCC_NV12:
-                    sts = NV12toBS(pSurf->pSurface, pBS);
-                    break;
-                case MFX_FOURCC_RGB4:
-                    sts = RGB4toBS(pSurf->pSurface, pBS);
-                    break;
-                case MFX_FOURCC_YUY2:
-                    sts = YUY2toBS(pSurf->pSurface, pBS);
-                    break;
+                            sts = NV12asI420toBS(pSurf->pSurface, pBS);
+                        break;
+                    case MFX_FOURCC_NV12:
+                        sts = NV12toBS(pSurf->pSurface, pBS);
+                        break;
+                    case MFX_FOURCC_RGB4:
+                        sts = RGB4toBS(pSurf->pSurface, pBS);
+                        break;
+                    case MFX_FOURCC_YUY2:
+                        sts = YUY2toBS(pSurf->pSurface, pBS);
+                        break;
+                }
+                MSDK_CHECK_STATUS(sts, "<FourCC>toBS failed");
+            }
+
+            if (m_bQualityCheck) {
+                sts = CheckOutputQuality(pSurf->pSurface);
+                MSDK_CHECK_STATUS(sts, "CheckOutputQuality failed");
+            }
+
+            if (m_pShmRing) {
+                sts = m_pShmRing->WriteFrame(pSurf->pSurface);
+                MSDK_CHECK_STATUS(sts, "m_pShmRing->WriteFrame failed");
             }
-            MSDK_CHECK_STATUS(sts, "<FourCC>toBS failed");
 
             if (m_MemoryModel == GENERAL_ALLOC) {
                 sts = m_pMFXAllocator->Unlock(m_pMFXAllocator->pthis,
@@ -4060,6 +4245,8 @@ mfxStatus CTranscodingPipeline::CalculateNumberOfReqFrames(mfxFrameAllocRequest&
 
 void CTranscodingPipeline::CorrectNumberOfAllocatedFrames(mfxFrameAllocRequest* pNewReq,
                                                           mfxU32 ID) {
+    std::lock_guard<std::mutex> lock(m_mChildInit);
+
     if (m_ScalerConfig.CascadeScalerRequired && TargetID == DecoderTargetID) {
         const auto& desc = m_ScalerConfig.GetDesc(ID);
         if (desc.PoolID == DecoderPoolID) {
@@ -4193,7 +4380,10 @@ mfxStatus CTranscodingPipeline::Init(sInputParams* pParams,
     m_bAllocHint   = pParams->useAllocHints;
     m_nPreallocate = pParams->preallocate;
 
-    m_ROIData = pParams->m_ROIData;
+    if (pParams->m_ROIFile) {
+        sts = m_ROIReader.Init(pParams->m_ROIFile);
+        MSDK_CHECK_STATUS(sts, "m_ROIReader.Init failed");
+    }
 
     m_forceSyncAllSession = pParams->forceSyncAllSession == MFX_CODINGOPTION_ON;
 
@@ -4221,7 +4411,7 @@ mfxStatus CTranscodingPipeline::Init(sInputParams* pParams,
         statisticsWindowSize = m_MaxFramesForTranscode;
 
     if (m_bEncodeEnable) {
-        m_pBSStore.reset(new ExtendedBSStore(m_AsyncDepth));
+        m_pBSStore.reset(new ExtendedBSStore(m_AsyncDepth, m_pBitstreamPool));
     }
 
     // Determine processing mode
@@ -4456,6 +4646,31 @@ mfxStatus CTranscodingPipeline::Init(sInputParams* pParams,
         }
     }
 
+    // raw output and VPP composition dump can be verified while they are produced
+    if (pParams->qualityParams.IsEnabled()) {
+        if (pParams->EncodeId != MFX_CODEC_DUMP &&
+            m_vppCompDumpRenderMode != DUMP_FILE_VPP_COMP) {
+            printf("ERROR: output verification requires -o::raw or -vpp_comp_dump <file>\n");
+            return MFX_ERR_UNSUPPORTED;
+        }
+
+        sQualityCheckParams qualityParams = pParams->qualityParams;
+        // raw writer stores NV12 as I420 unless NV12 output is requested
+        if (m_vppCompDumpRenderMode != DUMP_FILE_VPP_COMP &&
+            (m_encoderFourCC == 0 || m_encoderFourCC == MFX_FOURCC_I420))
+            qualityParams.fileFourCC = MFX_FOURCC_I420;
+
+        sts = m_qualityChecker.Init(qualityParams);
+        MSDK_CHECK_STATUS(sts, "m_qualityChecker.Init failed");
+        m_bQualityCheck = true;
+    }
+
+    if (!pParams->ShmRing.Name.empty()) {
+        m_pShmRing.reset(new CShmFrameRingWriter());
+        sts = m_pShmRing->Init(pParams->ShmRing);
+        MSDK_CHECK_STATUS(sts, "m_pShmRing->Init failed");
+    }
+
     if (m_MemoryModel == GENERAL_ALLOC || pParams->useAllocHints ||
         (pParentPipeline && pParentPipeline->m_bAllocHint)) {
         // Frames allocation for all component
@@ -4516,6 +4731,10 @@ mfxStatus CTranscodingPipeline::Init(sInputParams* pParams,
             m_bUseQPMap = true;
         }
 
+        if (m_bRobustFlag) {
+            UpdateCheckpoint();
+        }
+
         if (pParams->bROIasQPMAP) {
             mfxVideoParam enc_par;
             MSDK_ZERO_MEMORY(enc_par);
@@ -4536,8 +4755,13 @@ mfxStatus CTranscodingPipeline::Init(sInputParams* pParams,
                 m_QPforI    = enc_par.mfx.QPI;
                 m_QPforP    = enc_par.mfx.QPP;
                 m_bUseQPMap = true;
+                m_MBQPRasterizer.Init(m_QPmapWidth, m_QPmapHeight, GetMBQPBlockSize());
             }
         }
+
+        // one bundle per encoder input surface, more are added if the pool is shared
+        m_FrameControls.Init(std::max<size_t>(m_pSurfaceEncPool.size(), m_AsyncDepth),
+                             m_bUseQPMap ? m_QPmapWidth * m_QPmapHeight : 0);
     }
 
     // Dumping components configuration if required
@@ -4591,10 +4815,12 @@ mfxStatus CTranscodingPipeline::CompleteInit() {
         mfxF64 frcFactor       = frOut / frIn;
         mfxU32 framesForEncode = std::min(mfxU32(std::ceil(m_MaxFramesForTranscode / frcFactor)),
                                           m_MaxFramesForTranscode);
-        if (m_pParentPipeline)
+        if (m_pParentPipeline) {
+            std::lock_guard<std::mutex> lock(m_pParentPipeline->m_mChildInit);
             m_pParentPipeline->m_MaxFramesForEncode =
                 std::max(m_pParentPipeline->m_MaxFramesForEncode,
                          framesForEncode); // Inform decoder how many frames required by encode
+        }
 
         if (m_bIsPlugin && m_bIsVpp)
             sts = m_pmfxVPP->InitMulti(&m_mfxPluginParams, &m_mfxVppParams);
@@ -4621,10 +4847,12 @@ mfxStatus CTranscodingPipeline::CompleteInit() {
 
     // Init encode
     if (m_pmfxENC.get()) {
-        if (!m_pmfxVPP.get() && m_pParentPipeline)
+        if (!m_pmfxVPP.get() && m_pParentPipeline) {
+            std::lock_guard<std::mutex> lock(m_pParentPipeline->m_mChildInit);
             m_pParentPipeline->m_MaxFramesForEncode = std::max(
                 m_pParentPipeline->m_MaxFramesForEncode,
                 m_MaxFramesForTranscode); // Inform decoder how many frames required by encode
+        }
 
         sts = m_pmfxENC->Init(&m_mfxEncParams);
         if (MFX_WRN_PARTIAL_ACCELERATION == sts) {
@@ -4772,6 +5000,9 @@ void CTranscodingPipeline::SetNumFramesForReset(mfxU32 nFrames) {
 }
 
 void CTranscodingPipeline::HandlePossibleGpuHang(mfxStatus& sts) {
+    if (sts == MFX_ERR_GPU_HANG && m_bRobustFlag) {
+        m_bGpuHangDetected = true;
+    }
     if (sts == MFX_ERR_GPU_HANG && m_bSoftGpuHangRecovery) {
         printf("[WARNING] GPU hang happened. Inserting an IDR and continuing transcoding.\n");
         m_bInsertIDR = true;
@@ -4854,6 +5085,11 @@ void CTranscodingPipeline::Close() {
     FreeVppDoNotUse();
     FreeMVCSeqDesc();
 
+    m_ROIReader.Close();
+    m_FrameControls.Close();
+    if (m_pShmRing)
+        m_pShmRing->Close();
+
     mfxExtVPPComposite* vppCompPar = m_mfxVppParams;
     if (vppCompPar && vppCompPar->InputStream)
         free(vppCompPar->InputStream);
@@ -5075,6 +5311,62 @@ mfxStatus CTranscodingPipeline::Reset(VPLImplementationLoader* mfxLoader) {
     return sts;
 }
 
+void CTranscodingPipeline::UpdateCheckpoint() {
+    m_Checkpoint.frameNum     = m_nOutputFramesNum ? m_nOutputFramesNum - 1 : 0;
+    m_Checkpoint.outputOffset = m_pBSProcessor ? m_pBSProcessor->GetOutputOffset() : 0;
+
+    m_Checkpoint.BRCParamMultiplier = m_mfxEncParams.mfx.BRCParamMultiplier;
+    m_Checkpoint.RateControlMethod  = m_mfxEncParams.mfx.RateControlMethod;
+    m_Checkpoint.InitialDelayInKB   = m_mfxEncParams.mfx.InitialDelayInKB;
+    m_Checkpoint.BufferSizeInKB     = m_mfxEncParams.mfx.BufferSizeInKB;
+    m_Checkpoint.TargetKbps         = m_mfxEncParams.mfx.TargetKbps;
+    m_Checkpoint.MaxKbps            = m_mfxEncParams.mfx.MaxKbps;
+}
+
+mfxStatus CTranscodingPipeline::ResumeFromCheckpoint(VPLImplementationLoader* mfxLoader) {
+    mfxStatus sts = MFX_ERR_NONE;
+
+    // Rate control may have been changed at runtime after the last IDR frame
+    if (m_pmfxENC.get()) {
+        m_mfxEncParams.mfx.BRCParamMultiplier = m_Checkpoint.BRCParamMultiplier;
+        m_mfxEncParams.mfx.RateControlMethod  = m_Checkpoint.RateControlMethod;
+        m_mfxEncParams.mfx.InitialDelayInKB   = m_Checkpoint.InitialDelayInKB;
+        m_mfxEncParams.mfx.BufferSizeInKB     = m_Checkpoint.BufferSizeInKB;
+        m_mfxEncParams.mfx.TargetKbps         = m_Checkpoint.TargetKbps;
+        m_mfxEncParams.mfx.MaxKbps            = m_Checkpoint.MaxKbps;
+    }
+
+    if (m_verSessionInit == API_1X) {
+        sts = Reset();
+    }
+    else {
+        sts = Reset(mfxLoader);
+    }
+    MSDK_CHECK_STATUS(sts, "Reset failed");
+
+    // Output after the last IDR frame is dropped, the input is read again from its start and
+    // encoding continues with an IDR frame once the frames before the checkpoint are skipped
+    if (m_pBSProcessor) {
+        sts = m_pBSProcessor->TruncateOutput(m_Checkpoint.outputOffset);
+        MSDK_CHECK_STATUS(sts, "m_pBSProcessor->TruncateOutput failed");
+        sts = m_pBSProcessor->ResetInput();
+        MSDK_CHECK_STATUS(sts, "m_pBSProcessor->ResetInput failed");
+    }
+    m_nOutputFramesNum    = m_Checkpoint.frameNum;
+    m_nProcessedFramesNum = 0;
+    m_nTotalFramesNum     = 0;
+    m_nSubmittedFramesNum = 0;
+    m_nResumeSkipFrames   = m_Checkpoint.frameNum;
+
+    m_bInsertIDR       = true;
+    m_bGpuHangDetected = false;
+
+    std::lock_guard<std::mutex> guard(m_mStopSession);
+    m_bForceStop = false;
+
+    return sts;
+}
+
 mfxStatus CTranscodingPipeline::AllocAndInitVppDoNotUse(MfxVideoParamsWrapper& par,
                                                         sInputParams* pInParams) {
     std::vector<mfxU32> filtersDisabled;
@@ -5130,6 +5422,10 @@ mfxStatus CTranscodingPipeline::AllocateSufficientBuffer(mfxBitstreamWrapper* pB
             par.mfx.BRCParamMultiplier == 0 ? 1 : par.mfx.BRCParamMultiplier;
         new_size = par.mfx.BufferSizeInKB * tempBRCParamMultiplier * 1000u;
     }
+    // The encoder checks for BufferSizeInKB of free space when the frame is submitted, before
+    // the frame size is known, and can't grow the buffer while it writes into it. So a pooled
+    // bitstream gets the size class of the full buffer size for every frame; the pool only
+    // bounds the storage to the frames in flight.
     pBS->Extend(new_size);
 
     return MFX_ERR_NONE;
@@ -5138,6 +5434,7 @@ mfxStatus CTranscodingPipeline::AllocateSufficientBuffer(mfxBitstreamWrapper* pB
 mfxStatus CTranscodingPipeline::Join(MFXVideoSession* pChildSession) {
     mfxStatus sts = MFX_ERR_NONE;
     MSDK_CHECK_POINTER(pChildSession, MFX_ERR_NULL_PTR);
+    std::lock_guard<std::mutex> lock(m_mChildInit);
     sts              = m_pmfxSession->JoinSession(*pChildSession);
     m_bIsJoinSession = (MFX_ERR_NONE == sts);
     return sts;
@@ -5303,7 +5600,9 @@ FileBitstreamProcessor::FileBitstreamProcessor()
         : m_pFileReader(),
           m_pYUVFileReader(),
           m_pFileWriter(),
-          m_Bitstream() {
+          m_Bitstream(),
+          m_nOutputOffset(0),
+          m_pLiveSource() {
     m_Bitstream.TimeStamp = (mfxU64)-1;
 }
 
@@ -5369,8 +5668,12 @@ mfxStatus FileBitstreamProcessor::GetInputFrame(mfxFrameSurface1* pSurface) {
 }
 
 mfxStatus FileBitstreamProcessor::ProcessOutputBitstream(mfxBitstreamWrapper* pBitstream) {
-    if (m_pFileWriter.get())
+    if (m_pLiveSource)
+        m_pLiveSource->OnFrameOutput();
+    if (m_pFileWriter.get()) {
+        m_nOutputOffset += pBitstream->DataLength;
         return m_pFileWriter->WriteNextFrame(pBitstream, false);
+    }
 
     return MFX_ERR_NONE;
 }
@@ -5378,8 +5681,12 @@ mfxStatus FileBitstreamProcessor::ProcessOutputBitstream(mfxBitstreamWrapper* pB
 mfxStatus FileBitstreamProcessor::ProcessOutputBitstream(mfxBitstreamWrapper* pBitstream,
                                                          mfxU32 targetID,
                                                          mfxU32 frameNum) {
-    if (m_pFileWriter.get())
+    if (m_pLiveSource)
+        m_pLiveSource->OnFrameOutput();
+    if (m_pFileWriter.get()) {
+        m_nOutputOffset += pBitstream->DataLength;
         return m_pFileWriter->WriteNextFrame(pBitstream, targetID, frameNum);
+    }
 
     return MFX_ERR_NONE;
 }
@@ -5389,7 +5696,9 @@ mfxStatus FileBitstreamProcessor::ResetInput() {
         m_pFileReader->Reset();
 
         // Reset input bitstream state
-        m_Bitstream.DataFlag = 0;
+        m_Bitstream.DataFlag   = 0;
+        m_Bitstream.DataOffset = 0;
+        m_Bitstream.DataLength = 0;
     }
     if (m_pYUVFileReader.get()) {
         m_pYUVFileReader->Reset();
@@ -5401,6 +5710,16 @@ mfxStatus FileBitstreamProcessor::ResetOutput() {
     if (m_pFileWriter.get()) {
         m_pFileWriter->Reset();
     }
+    m_nOutputOffset = 0;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus FileBitstreamProcessor::TruncateOutput(mfxU64 size) {
+    if (m_pFileWriter.get()) {
+        mfxStatus sts = m_pFileWriter->Truncate(size);
+        MSDK_CHECK_STATUS(sts, "m_pFileWriter->Truncate failed");
+    }
+    m_nOutputOffset = size;
     return MFX_ERR_NONE;
 }
 
@@ -19,6 +19,7 @@
     #error MFX_VERSION not defined
 #endif
 
+#include <algorithm>
 #include <future>
 #include <iomanip>
 #include <memory>
@@ -89,6 +90,7 @@ Launcher::Launcher()
           m_pAllocParams(),
           m_hwdevs(),
           m_StartTime(0),
+          m_InitStartTime(0),
           m_eDevType(static_cast<mfxHandleType>(0)),
           m_accelerationMode(MFX_ACCEL_MODE_NA),
           m_pLoader(),
@@ -96,11 +98,17 @@ Launcher::Launcher()
           m_CSConfig(),
 #if (defined(_WIN32) || defined(_WIN64))
           m_Tracer(),
+          m_pBitstreamPool(std::make_shared<BitstreamBufferPool>()),
+          m_pFramePacerTimer(),
+          m_ControlChannel(),
           m_DisplaysData() {
     MSDK_ZERO_MEMORY(m_Adapters);
 }
 #else
-          m_Tracer() {
+          m_Tracer(),
+          m_pBitstreamPool(std::make_shared<BitstreamBufferPool>()),
+          m_pFramePacerTimer(),
+          m_ControlChannel() {
 } // Launcher::Launcher()
 #endif
 
@@ -114,6 +122,372 @@ CTranscodingPipeline* CreatePipeline() {
     return new CTranscodingPipeline;
 }
 
+mfxF64 GetTimeSince(msdk_tick start) {
+    static msdk_tick frequency = msdk_time_get_frequency();
+    return MSDK_GET_TIME(msdk_time_get_tick(), start, frequency);
+}
+
+std::vector<std::vector<mfxU32>> TranscodingSample::GetSessionInitDependencies(
+    const std::vector<sInputParams>& params) {
+    std::vector<std::vector<mfxU32>> deps(params.size());
+    std::vector<mfxU32> sinks;
+    mfxU32 joinParent  = 0;
+    bool hasJoinParent = false;
+
+    for (mfxU32 i = 0; i < params.size(); i++) {
+        auto addDep = [&deps, i](mfxU32 dep) {
+            if (std::find(deps[i].begin(), deps[i].end(), dep) == deps[i].end())
+                deps[i].push_back(dep);
+        };
+
+        if (i > 0)
+            addDep(0);
+
+        if (params[i].eMode == Source) {
+            for (mfxU32 sink : sinks)
+                addDep(sink);
+        }
+        else if (hasJoinParent) {
+            addDep(joinParent);
+        }
+
+        if (params[i].eMode == Sink)
+            sinks.push_back(i);
+
+        if (!hasJoinParent && params[i].bIsJoin) {
+            joinParent    = i;
+            hasJoinParent = true;
+        }
+    }
+
+    return deps;
+}
+
+std::vector<mfxU32> TranscodingSample::GetRecoveryGroup(const std::vector<sInputParams>& params,
+                                                        mfxU32 idx) {
+    std::vector<mfxU32> group;
+    if (idx >= params.size())
+        return group;
+
+    bool isInterSession = params[idx].eMode == Sink || params[idx].eMode == Source;
+    bool isJoined       = params[idx].bIsJoin;
+
+    // a joined sink or source ties all joined and all inter-session sessions together
+    for (const auto& par : params) {
+        bool parInterSession = par.eMode == Sink || par.eMode == Source;
+        if (par.bIsJoin && parInterSession && (isInterSession || isJoined))
+            isInterSession = isJoined = true;
+    }
+
+    for (mfxU32 i = 0; i < params.size(); i++) {
+        bool parInterSession = params[i].eMode == Sink || params[i].eMode == Source;
+        if (i == idx || (isInterSession && parInterSession) || (isJoined && params[i].bIsJoin))
+            group.push_back(i);
+    }
+
+    return group;
+}
+
+std::vector<mfxU32> TranscodingSample::GetRestartedSessions(const std::vector<sInputParams>& params,
+                                                            const std::vector<mfxU32>& group,
+                                                            const std::vector<bool>& completed) {
+    bool hasSource = false;
+    for (mfxU32 idx : group) {
+        if (!completed[idx] && params[idx].eMode == Source)
+            hasSource = true;
+    }
+
+    std::vector<mfxU32> restarted;
+    for (mfxU32 idx : group) {
+        if (!completed[idx] || (hasSource && params[idx].eMode == Sink))
+            restarted.push_back(idx);
+    }
+
+    return restarted;
+}
+
+std::vector<mfxI32> TranscodingSample::GetOneToManyBuffers(const std::vector<sInputParams>& params) {
+    std::vector<mfxI32> buffers(params.size(), -1);
+    mfxI32 numBuffers = 0;
+    for (mfxU32 i = 0; i < params.size(); i++) {
+        if (params[i].eMode == Source)
+            buffers[i] = numBuffers++;
+    }
+
+    // the buffers of the sink's sources are chained from the last one
+    for (mfxU32 i = 0; i < params.size(); i++) {
+        if (params[i].eMode != Sink)
+            continue;
+        for (mfxU32 j = i + 1; j < params.size() && params[j].eMode != Sink; j++) {
+            if (params[j].eMode == Source)
+                buffers[i] = buffers[j];
+        }
+    }
+
+    return buffers;
+}
+
+std::vector<std::string> TranscodingSample::GetControlSessionNames(
+    const std::vector<sInputParams>& params) {
+    std::vector<std::string> names;
+    for (mfxU32 i = 0; i < params.size(); i++) {
+        if (params[i].eMode == Sink)
+            names.push_back(std::string());
+        else
+            names.push_back(params[i].SessionName.empty() ? std::to_string(i)
+                                                          : params[i].SessionName);
+    }
+    return names;
+}
+
+// sessions that read the input and run the decoder the same way get the same frames
+static bool HaveSameDecode(const sInputParams& a, const sInputParams& b) {
+    bool same = a.strSrcFile == b.strSrcFile && a.DecodeId == b.DecodeId &&
+                a.bIsMVC == b.bIsMVC && a.DecoderFourCC == b.DecoderFourCC &&
+                a.dDecoderFrameRateOverride == b.dDecoderFrameRateOverride &&
+                a.m_decode_cfg == b.m_decode_cfg && a.nIVFHeader == b.nIVFHeader &&
+                a.decoderPluginParams.strPluginPath == b.decoderPluginParams.strPluginPath &&
+                AreGuidsEqual(a.decoderPluginParams.pluginGuid, b.decoderPluginParams.pluginGuid) &&
+                a.MaxFrameNumber == b.MaxFrameNumber && a.prolonged == b.prolonged &&
+                a.nTimeout == b.nTimeout && a.nFPS == b.nFPS && a.nFPSDenom == b.nFPSDenom &&
+                !a.LiveSource.RateN && !b.LiveSource.RateN;
+
+    // frames are passed between the sessions, so they have to use the same device and memory
+    same = same && a.libType == b.libType && a.verSessionInit == b.verSessionInit &&
+           a.nMemoryModel == b.nMemoryModel && a.bForceSysMem == b.bForceSysMem &&
+           a.DecOutPattern == b.DecOutPattern && a.nGpuCopyMode == b.nGpuCopyMode &&
+           a.AllocPolicy == b.AllocPolicy && a.useAllocHints == b.useAllocHints &&
+           a.preallocate == b.preallocate && a.bSingleTexture == b.bSingleTexture &&
+           a.nThreadsNum == b.nThreadsNum && a.priority == b.priority && a.bIsJoin == b.bIsJoin &&
+           a.adapterType == b.adapterType && a.dGfxIdx == b.dGfxIdx &&
+           a.adapterNum == b.adapterNum && a.dispFullSearch == b.dispFullSearch &&
+           a.PCIDeviceSetup == b.PCIDeviceSetup && a.PCIDomain == b.PCIDomain &&
+           a.PCIBus == b.PCIBus && a.PCIDevice == b.PCIDevice && a.PCIFunction == b.PCIFunction;
+#if defined(LINUX32) || defined(LINUX64)
+    same = same && a.strDevicePath == b.strDevicePath;
+#endif
+#if (defined(_WIN64) || defined(_WIN32))
+    same = same && a.luid.HighPart == b.luid.HighPart && a.luid.LowPart == b.luid.LowPart &&
+           a.isDualMode == b.isDualMode && a.hyperMode == b.hyperMode &&
+           a.bPreferiGfx == b.bPreferiGfx && a.bPreferdGfx == b.bPreferdGfx;
+#else
+    same = same && a.DRMRenderNodeNum == b.DRMRenderNodeNum;
+#endif
+
+    return same;
+}
+
+// decode-only session with the decoder, device and run settings of par, as given by -o::sink
+static sInputParams MakeSharedDecodeSink(const sInputParams& par) {
+    sInputParams sink;
+    sink.eMode = Sink;
+
+    sink.strSrcFile                = par.strSrcFile;
+    sink.DecodeId                  = par.DecodeId;
+    sink.bIsMVC                    = par.bIsMVC;
+    sink.DecoderFourCC             = par.DecoderFourCC;
+    sink.dDecoderFrameRateOverride = par.dDecoderFrameRateOverride;
+    sink.m_decode_cfg              = par.m_decode_cfg;
+    sink.nIVFHeader                = par.nIVFHeader;
+    sink.decoderPluginParams       = par.decoderPluginParams;
+    sink.MaxFrameNumber            = par.MaxFrameNumber;
+    sink.prolonged                 = par.prolonged;
+    sink.nTimeout                  = par.nTimeout;
+    sink.nFPS                      = par.nFPS;
+    sink.nFPSDenom                 = par.nFPSDenom;
+
+    sink.libType        = par.libType;
+    sink.verSessionInit = par.verSessionInit;
+    sink.nMemoryModel   = par.nMemoryModel;
+    sink.bForceSysMem   = par.bForceSysMem;
+    sink.DecOutPattern  = par.DecOutPattern;
+    sink.nGpuCopyMode   = par.nGpuCopyMode;
+    sink.AllocPolicy    = par.AllocPolicy;
+    sink.useAllocHints  = par.useAllocHints;
+    sink.preallocate    = par.preallocate;
+    sink.bSingleTexture = par.bSingleTexture;
+    sink.nThreadsNum    = par.nThreadsNum;
+    sink.priority       = par.priority;
+    sink.bIsJoin        = par.bIsJoin;
+    sink.adapterType    = par.adapterType;
+    sink.dGfxIdx        = par.dGfxIdx;
+    sink.adapterNum     = par.adapterNum;
+    sink.dispFullSearch = par.dispFullSearch;
+    sink.PCIDeviceSetup = par.PCIDeviceSetup;
+    sink.PCIDomain      = par.PCIDomain;
+    sink.PCIBus         = par.PCIBus;
+    sink.PCIDevice      = par.PCIDevice;
+    sink.PCIFunction    = par.PCIFunction;
+#if defined(LINUX32) || defined(LINUX64)
+    sink.strDevicePath = par.strDevicePath;
+#endif
+#if (defined(_WIN64) || defined(_WIN32))
+    sink.luid        = par.luid;
+    sink.isDualMode  = par.isDualMode;
+    sink.hyperMode   = par.hyperMode;
+    sink.bPreferiGfx = par.bPreferiGfx;
+    sink.bPreferdGfx = par.bPreferdGfx;
+#else
+    sink.DRMRenderNodeNum = par.DRMRenderNodeNum;
+#endif
+
+    // options given once for all sessions
+    sink.statisticsWindowSize   = par.statisticsWindowSize;
+    sink.statisticsLogFile      = par.statisticsLogFile;
+    sink.DumpLogFileName        = par.DumpLogFileName;
+    sink.bRobustFlag            = par.bRobustFlag;
+    sink.bSoftRobustFlag        = par.bSoftRobustFlag;
+    sink.shouldUseGreedyFormula = par.shouldUseGreedyFormula;
+    sink.nSyncOpTimeout         = par.nSyncOpTimeout;
+    sink.forceSyncAllSession    = par.forceSyncAllSession;
+
+    // as CmdProcessor sets for decoder sessions of inter-session pipelines
+    sink.nAsyncDepth = par.nAsyncDepth ? par.nAsyncDepth : 4;
+
+    return sink;
+}
+
+std::vector<std::vector<mfxU32>> TranscodingSample::GetSharedDecodeGroups(
+    const std::vector<sInputParams>& params) {
+    std::vector<std::vector<mfxU32>> groups;
+
+    // sessions already exchanging surfaces keep their topology
+    for (const auto& par : params) {
+        if (par.eMode != Native || par.eModeExt != Native)
+            return groups;
+    }
+
+    std::vector<bool> grouped(params.size(), false);
+    for (mfxU32 i = 0; i < params.size(); i++) {
+        const sInputParams& par = params[i];
+        // raw and overlay inputs are not decoded, decoder scaling is specific to the session
+        if (grouped[i] || par.rawInput || par.DecodeId == MFX_CODEC_RGB4 ||
+            par.bDecoderPostProcessing || par.ParallelEncoding)
+            continue;
+
+        std::vector<mfxU32> group(1, i);
+        for (mfxU32 j = i + 1; j < params.size(); j++) {
+            if (!grouped[j] && !params[j].bDecoderPostProcessing && !params[j].ParallelEncoding &&
+                HaveSameDecode(par, params[j]))
+                group.push_back(j);
+        }
+        if (group.size() < 2)
+            continue;
+
+        // inter-session pipelines are either all joined or all not joined
+        if (!groups.empty() && params[groups[0][0]].bIsJoin != par.bIsJoin)
+            continue;
+
+        for (mfxU32 idx : group)
+            grouped[idx] = true;
+        groups.push_back(group);
+    }
+
+    return groups;
+}
+
+std::vector<mfxI32> TranscodingSample::ShareDuplicateDecodes(std::vector<sInputParams>& params) {
+    std::vector<std::vector<mfxU32>> groups = GetSharedDecodeGroups(params);
+
+    std::vector<mfxI32> origins;
+    for (mfxU32 i = 0; i < params.size(); i++)
+        origins.push_back(i);
+
+    if (groups.empty())
+        return origins;
+
+    // group of the session, its first session places the group in the par file order
+    std::vector<mfxI32> groupOf(params.size(), -1);
+    for (mfxU32 g = 0; g < groups.size(); g++) {
+        for (mfxU32 idx : groups[g])
+            groupOf[idx] = g;
+    }
+
+    std::vector<sInputParams> shared;
+    origins.clear();
+    for (mfxU32 i = 0; i < params.size(); i++) {
+        if (groupOf[i] < 0) {
+            shared.push_back(params[i]);
+            origins.push_back(i);
+            continue;
+        }
+
+        const std::vector<mfxU32>& group = groups[groupOf[i]];
+        if (group[0] != i)
+            continue;
+
+        // sources are declared right after their sink
+        shared.push_back(MakeSharedDecodeSink(params[i]));
+        origins.push_back(-1);
+
+        for (mfxU32 idx : group) {
+            sInputParams source = params[idx];
+            source.eMode        = Source;
+            source.strSrcFile.clear();
+            source.DecodeId      = 0;
+            source.DecoderFourCC = 0;
+            shared.push_back(source);
+            origins.push_back(idx);
+        }
+    }
+
+    // control commands keep addressing sessions by their par file line
+    for (mfxU32 i = 0; i < shared.size(); i++) {
+        if (origins[i] >= 0 && shared[i].SessionName.empty())
+            shared[i].SessionName = std::to_string(origins[i]);
+    }
+
+    params.swap(shared);
+    return origins;
+}
+
+void SessionInitScheduler::Launch(mfxU32 idx,
+                                  const std::vector<mfxU32>& deps,
+                                  std::function<mfxStatus()> step) {
+    std::vector<std::shared_future<mfxStatus>> depSteps;
+    for (mfxU32 dep : deps) {
+        auto it = m_steps.find(dep);
+        if (it != m_steps.end())
+            depSteps.push_back(it->second);
+    }
+
+    m_steps[idx] = std::async(std::launch::async, [depSteps, step]() {
+                       for (const auto& depStep : depSteps) {
+                           mfxStatus sts = depStep.get();
+                           if (sts < MFX_ERR_NONE)
+                               return sts;
+                       }
+                       return step();
+                   }).share();
+}
+
+mfxStatus SessionInitScheduler::Wait(const std::vector<mfxU32>& idxs, mfxU32* pFailedIdx) {
+    mfxStatus sts = MFX_ERR_NONE;
+
+    for (mfxU32 idx : idxs) {
+        auto it = m_steps.find(idx);
+        if (it == m_steps.end())
+            continue;
+
+        mfxStatus stepSts = it->second.get();
+        if (stepSts < MFX_ERR_NONE && sts == MFX_ERR_NONE) {
+            sts = stepSts;
+            if (pFailedIdx)
+                *pFailedIdx = idx;
+        }
+    }
+
+    return sts;
+}
+
+mfxStatus SessionInitScheduler::WaitAll(mfxU32* pFailedIdx) {
+    std::vector<mfxU32> idxs;
+    for (const auto& step : m_steps)
+        idxs.push_back(step.first);
+
+    return Wait(idxs, pFailedIdx);
+}
+
 mfxStatus Launcher::Init(int argc, char* argv[]) {
     mfxStatus sts;
     mfxU32 i                     = 0;
@@ -128,6 +502,8 @@ mfxStatus Launcher::Init(int argc, char* argv[]) {
     sInputParams InputParams;
     bool lowLatencyMode = true;
 
+    m_InitStartTime = msdk_time_get_tick();
+
     //parent transcode pipeline
     CTranscodingPipeline* pParentPipeline = NULL;
     // source transcode pipeline use instead parent in heterogeneous pipeline
@@ -143,9 +519,7 @@ mfxStatus Launcher::Init(int argc, char* argv[]) {
     }
 
     // get parameters for each session from parser
-    mfxU32 id = DecoderTargetID;
     while (parser.GetNextSessionParams(InputParams)) {
-        InputParams.TargetID = id++;
         m_InputParamsArray.push_back(InputParams);
     }
 
@@ -154,6 +528,15 @@ mfxStatus Launcher::Init(int argc, char* argv[]) {
     session_descriptions  = parser.GetSessionDescriptions();
     surface_wait_interval = parser.GetParameterSurfaceWaitInterval();
 
+    if (parser.IsDecodeSharingEnabled()) {
+        ShareDecodes();
+    }
+
+    mfxU32 id = DecoderTargetID;
+    for (auto& par : m_InputParamsArray) {
+        par.TargetID = id++;
+    }
+
     m_CSConfig.Tracer = &m_Tracer;
 
     // check correctness of input parameters
@@ -471,6 +854,7 @@ mfxStatus Launcher::Init(int argc, char* argv[]) {
     // each pair of source and sink has own safety buffer
     sts = CreateSafetyBuffers();
     MSDK_CHECK_STATUS(sts, "CreateSafetyBuffers failed");
+    std::vector<mfxI32> oneToManyBuffers = GetOneToManyBuffers(m_InputParamsArray);
 
     /* One more hint. Example you have 3 dec + 1 enc sessions
     * (enc means vpp_comp call invoked. m_InputParamsArray.size() is 4.
@@ -489,16 +873,29 @@ mfxStatus Launcher::Init(int argc, char* argv[]) {
         m_VppDstRects.push_back(tempDstRect);
     }
 
+    std::vector<CpuPlacement> placements = PlaceSessionsOnCpus(parser.GetAffinityPolicy());
+
+    // sessions limited with -fps wait for their frames on one timer thread
+    for (const auto& params : m_InputParamsArray) {
+        if (params.nFPS && !m_pFramePacerTimer)
+            m_pFramePacerTimer = std::make_shared<FramePacerTimer>(parser.GetFpsSpinTail());
+    }
+
+    // sessions are initialized concurrently, each one once the sessions it depends on are ready
+    std::vector<std::vector<mfxU32>> initDeps = GetSessionInitDependencies(m_InputParamsArray);
+    SessionInitScheduler initScheduler;
+    mfxU32 failedIdx = 0;
+
     // create sessions, allocators
     for (i = 0; i < m_InputParamsArray.size(); i++) {
-        printf("Session %d:\n", (int)i);
         auto pAllocator = std::make_unique<GeneralAllocator>();
         sts             = pAllocator->Init(m_pAllocParams[i].get());
         MSDK_CHECK_STATUS(sts, "pAllocator->Init failed");
 
         m_pAllocArray.push_back(std::move(pAllocator));
 
-        auto pThreadPipeline = std::make_unique<ThreadTranscodeContext>();
+        auto pThreadPipeline       = std::make_unique<ThreadTranscodeContext>();
+        pThreadPipeline->placement = placements[i];
         // extend BS processing init
         m_pExtBSProcArray.push_back(std::make_unique<FileBitstreamProcessor>());
 
@@ -517,6 +914,9 @@ mfxStatus Launcher::Init(int argc, char* argv[]) {
         }
 
         pThreadPipeline->pPipeline->SetSurfaceWaitInterval(surface_wait_interval);
+        pThreadPipeline->pPipeline->SetBitstreamPool(m_pBitstreamPool);
+        if (m_InputParamsArray[i].nFPS)
+            pThreadPipeline->pPipeline->SetFramePacerTimer(m_pFramePacerTimer);
 
         pThreadPipeline->pPipeline->SetSyncOpTimeout(m_InputParamsArray[i].nSyncOpTimeout);
 
@@ -524,7 +924,20 @@ mfxStatus Launcher::Init(int argc, char* argv[]) {
 
         std::unique_ptr<CSmplBitstreamReader> reader;
         std::unique_ptr<CSmplYUVReader> yuvreader;
-        if (m_InputParamsArray[i].DecodeId == MFX_CODEC_VP9 ||
+        std::shared_ptr<CLiveSource> liveSource;
+        if (m_InputParamsArray[i].LiveSource.RateN) {
+            liveSource = std::make_shared<CLiveSource>(m_InputParamsArray[i].LiveSource);
+            m_pExtBSProcArray.back()->SetLiveSource(liveSource);
+        }
+
+        if (liveSource && m_InputParamsArray[i].DecodeId == MFX_CODEC_AVC) {
+            // a live feed delivers whole access units
+            reader.reset(new CH264FrameReader());
+        }
+        else if (liveSource && m_InputParamsArray[i].DecodeId == MFX_CODEC_JPEG) {
+            reader.reset(new CJPEGFrameReader());
+        }
+        else if (m_InputParamsArray[i].DecodeId == MFX_CODEC_VP9 ||
             m_InputParamsArray[i].DecodeId == MFX_CODEC_VP8 ||
             m_InputParamsArray[i].DecodeId == MFX_CODEC_AV1) {
             reader.reset(new CIVFFrameReader());
@@ -536,7 +949,9 @@ mfxStatus Launcher::Init(int argc, char* argv[]) {
                  m_InputParamsArray[i].DecodeId == MFX_CODEC_YUY2 ||
                  m_InputParamsArray[i].DecodeId == MFX_CODEC_Y210) {
             // YUV reader for RGB4 overlay and raw input
-            yuvreader.reset(new CSmplYUVReader());
+            auto liveReader = std::make_unique<CLiveYUVReader>();
+            liveReader->SetLiveSource(liveSource);
+            yuvreader = std::move(liveReader);
         }
         else {
             reader.reset(new CSmplBitstreamReader());
@@ -549,6 +964,8 @@ mfxStatus Launcher::Init(int argc, char* argv[]) {
                 printf("WARNING: Stream is not IVF, default reader\n");
             }
             MSDK_CHECK_STATUS(sts, "reader->Init failed");
+            if (liveSource)
+                reader.reset(new CLiveBitstreamReader(std::move(reader), liveSource));
             sts = m_pExtBSProcArray.back()->SetReader(reader);
             MSDK_CHECK_STATUS(sts, "m_pExtBSProcArray.back()->SetReader failed");
         }
@@ -595,7 +1012,8 @@ mfxStatus Launcher::Init(int argc, char* argv[]) {
             }
             else /* 1_to_N mode*/
             {
-                pBuffer = m_pBufferArray[m_pBufferArray.size() - 1].get();
+                MSDK_CHECK_ERROR(oneToManyBuffers[i], -1, MFX_ERR_UNSUPPORTED);
+                pBuffer = m_pBufferArray[oneToManyBuffers[i]].get();
             }
             pSinkPipeline = pThreadPipeline->pPipeline.get();
         }
@@ -607,8 +1025,7 @@ mfxStatus Launcher::Init(int argc, char* argv[]) {
             }
             else /* 1_to_N mode*/
             {
-                pBuffer = m_pBufferArray[BufCounter].get();
-                BufCounter++;
+                pBuffer = m_pBufferArray[oneToManyBuffers[i]].get();
             }
         }
         else {
@@ -624,6 +1041,12 @@ mfxStatus Launcher::Init(int argc, char* argv[]) {
         sts = MFX_ERR_MORE_DATA;
 
         auto pipeline = Source == m_InputParamsArray[i].eMode ? pSinkPipeline : pParentPipeline;
+
+        // parent pipeline state is only valid once its own Init is over
+        sts = initScheduler.Wait(initDeps[i], &failedIdx);
+        if (sts < MFX_ERR_NONE)
+            break;
+
         if (m_InputParamsArray[i].verSessionInit == API_1X) {
 #if (defined(_WIN32) || defined(_WIN64))
             sts = CheckAndFixAdapterDependency_1X(i, pipeline);
@@ -648,31 +1071,77 @@ mfxStatus Launcher::Init(int argc, char* argv[]) {
                 if (m_InputParamsArray[i].adapterNum >= 0)
                     m_pLoader->SetAdapterNum(m_InputParamsArray[i].adapterNum);
 
+                // sessions still being created use the implementation selected for them
+                sts = initScheduler.WaitAll(&failedIdx);
+                if (sts < MFX_ERR_NONE)
+                    break;
+
                 sts = m_pLoader->ConfigureAndEnumImplementations(m_InputParamsArray[i].libType,
                                                                  m_accelerationMode,
                                                                  lowLatencyMode);
                 MSDK_CHECK_STATUS(sts, "ConfigureAndEnumImplementations failed");
             }
         }
-        sts = pThreadPipeline->pPipeline->Init(&m_InputParamsArray[i],
-                                               m_pAllocArray[i].get(),
-                                               hdls[i],
-                                               pipeline,
-                                               pBuffer,
-                                               m_pExtBSProcArray.back().get(),
-                                               m_pLoader.get(),
-                                               CreateCascadeScalerConfig());
 
-        MSDK_CHECK_STATUS(sts, "pThreadPipeline->pPipeline->Init failed");
+        // the vectors of the launcher grow while the steps run, they get the elements they use
+        ThreadTranscodeContext* pContext = pThreadPipeline.get();
+        sInputParams* pParams            = &m_InputParamsArray[i];
+        GeneralAllocator* pAlloc         = m_pAllocArray[i].get();
+        FileBitstreamProcessor* pBSProc  = m_pExtBSProcArray.back().get();
+        VPLImplementationLoader* pLoader = m_pLoader.get();
+        mfxHDL sessionHdl                = hdls[i];
+        CascadeScalerConfig& CSConfig    = CreateCascadeScalerConfig();
+        initScheduler.Launch(
+            i,
+            initDeps[i],
+            [pContext,
+             pParams,
+             pAlloc,
+             sessionHdl,
+             pipeline,
+             pBuffer,
+             pBSProc,
+             pLoader,
+             &CSConfig]() {
+                // runtime threads created by Init inherit the placement, a failure is reported
+                // once all sessions are initialized
+                pContext->bindSts = BindCurrentThread(pContext->placement);
+                msdk_tick start   = msdk_time_get_tick();
+                mfxStatus initSts = pContext->pPipeline->Init(pParams,
+                                                              pAlloc,
+                                                              sessionHdl,
+                                                              pipeline,
+                                                              pBuffer,
+                                                              pBSProc,
+                                                              pLoader,
+                                                              CSConfig);
+                pContext->init_time += GetTimeSince(start);
+                return initSts;
+            });
 
         if (!pParentPipeline && m_InputParamsArray[i].bIsJoin)
             pParentPipeline = pThreadPipeline->pPipeline.get();
 
+        m_pThreadContextArray.push_back(std::move(pThreadPipeline));
+    }
+
+    sts = initScheduler.WaitAll(&failedIdx);
+    if (sts < MFX_ERR_NONE) {
+        printf("error: session %d failed to initialize\n", (int)failedIdx);
+        MSDK_CHECK_STATUS(sts, "pThreadPipeline->pPipeline->Init failed");
+    }
+
+    for (i = 0; i < m_InputParamsArray.size(); i++) {
+        printf("Session %d:\n", (int)i);
+        if (m_pThreadContextArray[i]->bindSts != MFX_ERR_NONE)
+            printf("warning: session %d couldn't be bound to CPUs %s\n",
+                   (int)i,
+                   FormatCpuList(m_pThreadContextArray[i]->placement.Cpus).c_str());
+
         // set the session's start status (like it is waiting)
-        pThreadPipeline->startStatus = MFX_WRN_DEVICE_BUSY;
+        m_pThreadContextArray[i]->startStatus = MFX_WRN_DEVICE_BUSY;
         // set other session's parameters
-        pThreadPipeline->implType = m_InputParamsArray[i].libType;
-        m_pThreadContextArray.push_back(std::move(pThreadPipeline));
+        m_pThreadContextArray[i]->implType = m_InputParamsArray[i].libType;
 
         mfxVersion ver = { { 0, 0 } };
         sts            = m_pThreadContextArray[i]->pPipeline->QueryMFXVersion(&ver);
@@ -684,15 +1153,35 @@ mfxStatus Launcher::Init(int argc, char* argv[]) {
         PrintStreamInfo(i, &m_InputParamsArray[i], &ver);
     }
 
+    // components of a session are initialized after the ones of the sessions it depends on
+    SessionInitScheduler completeInitScheduler;
     for (i = 0; i < m_InputParamsArray.size(); i++) {
-        sts = m_pThreadContextArray[i]->pPipeline->CompleteInit();
+        ThreadTranscodeContext* pContext = m_pThreadContextArray[i].get();
+        completeInitScheduler.Launch(i, initDeps[i], [pContext]() {
+            BindCurrentThread(pContext->placement);
+            msdk_tick start   = msdk_time_get_tick();
+            mfxStatus initSts = pContext->pPipeline->CompleteInit();
+            pContext->init_time += GetTimeSince(start);
+            return initSts;
+        });
+    }
+
+    sts = completeInitScheduler.WaitAll(&failedIdx);
+    if (sts < MFX_ERR_NONE) {
+        printf("error: session %d failed to complete initialization\n", (int)failedIdx);
         MSDK_CHECK_STATUS(sts, "m_pThreadContextArray[i]->pPipeline->CompleteInit failed");
+    }
 
+    for (i = 0; i < m_InputParamsArray.size(); i++) {
         if (m_pThreadContextArray[i]->pPipeline->GetJoiningFlag())
             printf("Session %d was joined with other sessions\n", (int)i);
         else
             printf("Session %d was NOT joined with other sessions\n", (int)i);
 
+        printf("Session %d initialized in %.3f sec\n",
+               (int)i,
+               m_pThreadContextArray[i]->init_time);
+
         m_pThreadContextArray[i]->pPipeline->SetPipelineID(i);
     }
 
@@ -713,6 +1202,27 @@ mfxStatus Launcher::Init(int argc, char* argv[]) {
         }
     }
 
+    // commands are routed to the sessions that encode, by name or number
+    if (!parser.GetControlChannel().empty()) {
+        std::vector<std::string> names = GetControlSessionNames(m_InputParamsArray);
+        for (i = 0; i < m_InputParamsArray.size(); i++) {
+            const std::string& name = names[i];
+            if (name.empty())
+                continue;
+
+            auto mailbox = m_ControlChannel.AddSession(name, parser.GetControlLatency());
+            if (!mailbox) {
+                printf("error: session name \"%s\" is used more than once\n", name.c_str());
+                return MFX_ERR_UNSUPPORTED;
+            }
+            m_pThreadContextArray[i]->pPipeline->SetControlMailbox(name, mailbox);
+        }
+
+        sts = m_ControlChannel.Open(parser.GetControlChannel());
+        MSDK_CHECK_STATUS(sts, "m_ControlChannel.Open failed");
+        printf("Reconfiguration commands are read from %s\n", parser.GetControlChannel().c_str());
+    }
+
     printf("\n");
 
     return sts;
@@ -725,25 +1235,21 @@ void Launcher::Run() {
     // mark start time
     m_StartTime = msdk_time_get_tick();
 
-    // Robust flag is applied to every seession if enabled in one
-    if (m_pThreadContextArray[0]->pPipeline->GetRobustFlag()) {
-        DoRobustTranscoding();
-    }
-    else {
-        DoTranscoding();
-    }
+    DoTranscoding();
+
+    m_ControlChannel.Close();
 
     printf("\nTranscoding finished\n");
 
 } // mfxStatus Launcher::Init()
 
-void Launcher::DoTranscoding() {
-    auto RunTranscodeRoutine = [](ThreadTranscodeContext* context) {
-        context->handle = std::async(std::launch::async, [context]() {
-            context->TranscodeRoutine();
-        });
-    };
+static void RunTranscodeRoutine(ThreadTranscodeContext* context) {
+    context->handle = std::async(std::launch::async, [context]() {
+        context->TranscodeRoutine();
+    });
+}
 
+void Launcher::DoTranscoding() {
     bool isOverlayUsed = false;
     for (const auto& context : m_pThreadContextArray) {
         MSDK_CHECK_POINTER_NO_RET(context);
@@ -755,6 +1261,7 @@ void Launcher::DoTranscoding() {
 
     // Transcoding threads waiting cycle
     bool aliveNonOverlaySessions = true;
+    std::vector<mfxU32> hungSessions;
     while (aliveNonOverlaySessions) {
         aliveNonOverlaySessions = false;
 
@@ -775,8 +1282,11 @@ void Launcher::DoTranscoding() {
                 if (m_pThreadContextArray[i]->transcodingSts < MFX_ERR_NONE) {
                     // Stop all the sessions if an error happened in one
                     // But do not stop in robust mode when gpu hang's happened
-                    if (m_pThreadContextArray[i]->transcodingSts != MFX_ERR_GPU_HANG ||
-                        !m_pThreadContextArray[i]->pPipeline->GetRobustFlag()) {
+                    if (m_pThreadContextArray[i]->transcodingSts == MFX_ERR_GPU_HANG &&
+                        m_pThreadContextArray[i]->pPipeline->GetRobustFlag()) {
+                        hungSessions.push_back((mfxU32)i);
+                    }
+                    else {
                         std::cout << "\n\n session " << i << " ["
                                   << m_pThreadContextArray[i]->pPipeline->GetSessionText()
                                   << "] failed with status "
@@ -804,6 +1314,19 @@ void Launcher::DoTranscoding() {
             }
         }
 
+        if (!hungSessions.empty()) {
+            if (RecoverSessions(hungSessions) == MFX_ERR_NONE) {
+                aliveNonOverlaySessions = true;
+            }
+            else {
+                printf("\n[WARNING] GPU Hang recovery wasn't succeed. Exiting...\n");
+                for (const auto& context : m_pThreadContextArray) {
+                    context->pPipeline->StopSession();
+                }
+            }
+            hungSessions.clear();
+        }
+
         // Stop overlay sessions
         // Note: Overlay sessions never stop themselves so they should be forcibly stopped
         // after stopping of all non-overlay sessions
@@ -826,46 +1349,94 @@ void Launcher::DoTranscoding() {
     }
 }
 
-void Launcher::DoRobustTranscoding() {
-    mfxStatus sts = MFX_ERR_NONE;
+mfxStatus Launcher::RecoverSessions(const std::vector<mfxU32>& hungSessions) {
+    msdk_tick hangTime = msdk_time_get_tick();
 
-    // Cycle for handling MFX_ERR_GPU_HANG during transcoding
-    // If it's returned, reset all the pipelines and start over from the last point
-    bool bGPUHang = false;
-    for (;;) {
-        if (bGPUHang) {
-            for (size_t i = 0; i < m_pThreadContextArray.size(); i++) {
-                if (m_pThreadContextArray[i]->pPipeline->GetVersionOfSessionInitAPI() == API_1X) {
-                    sts = m_pThreadContextArray[i]->pPipeline->Reset();
-                }
-                else {
-                    sts = m_pThreadContextArray[i]->pPipeline->Reset(m_pLoader.get());
-                }
-                if (sts) {
-                    printf("\n[WARNING] GPU Hang recovery wasn't succeed. Exiting...\n");
-                    return;
-                }
-            }
-            bGPUHang = false;
-            printf("\n[WARNING] Successfully recovered. Continue transcoding.\n");
+    std::vector<mfxU32> recoveryGroup;
+    for (mfxU32 hung : hungSessions) {
+        for (mfxU32 idx : GetRecoveryGroup(m_InputParamsArray, hung)) {
+            if (std::find(recoveryGroup.begin(), recoveryGroup.end(), idx) == recoveryGroup.end())
+                recoveryGroup.push_back(idx);
         }
+    }
+    std::sort(recoveryGroup.begin(), recoveryGroup.end());
 
-        DoTranscoding();
+    // Sessions that completed keep their output
+    std::vector<bool> completed(m_pThreadContextArray.size(), false);
+    for (mfxU32 idx : recoveryGroup) {
+        completed[idx] = !m_pThreadContextArray[idx]->handle.valid() &&
+                         m_pThreadContextArray[idx]->transcodingSts >= MFX_ERR_NONE;
+    }
+    std::vector<mfxU32> group = GetRestartedSessions(m_InputParamsArray, recoveryGroup, completed);
 
-        for (size_t i = 0; i < m_pThreadContextArray.size(); i++) {
-            if (m_pThreadContextArray[i]->transcodingSts == MFX_ERR_GPU_HANG) {
-                bGPUHang = true;
-            }
+    printf("\n[WARNING] GPU Hang has happened. Trying to recover session(s)");
+    for (mfxU32 idx : group)
+        printf(" %u", idx);
+    printf("...\n");
+
+    // Sessions sharing the pipeline have to be stopped before they are rebuilt
+    for (mfxU32 idx : group) {
+        if (m_pThreadContextArray[idx]->handle.valid())
+            m_pThreadContextArray[idx]->pPipeline->StopSession();
+    }
+    for (mfxU32 idx : group) {
+        if (m_pThreadContextArray[idx]->handle.valid())
+            m_pThreadContextArray[idx]->handle.get();
+    }
+
+    // Rebuild in the order sessions were initialized, independent ones in parallel
+    std::vector<std::vector<mfxU32>> initDeps = GetSessionInitDependencies(m_InputParamsArray);
+    SessionInitScheduler recoveryScheduler;
+    std::vector<mfxF64> recoveryTimes(m_pThreadContextArray.size(), 0);
+    for (mfxU32 idx : group) {
+        std::vector<mfxU32> deps;
+        for (mfxU32 dep : initDeps[idx]) {
+            if (std::find(group.begin(), group.end(), dep) != group.end())
+                deps.push_back(dep);
         }
-        if (!bGPUHang)
-            break;
-        printf("\n[WARNING] GPU Hang has happened. Trying to recover...\n");
+
+        ThreadTranscodeContext* pContext = m_pThreadContextArray[idx].get();
+        VPLImplementationLoader* pLoader = m_pLoader.get();
+        mfxF64* pRecoveryTime            = &recoveryTimes[idx];
+        recoveryScheduler.Launch(idx, deps, [pContext, pLoader, pRecoveryTime, hangTime]() {
+            BindCurrentThread(pContext->placement);
+            mfxStatus resumeSts = pContext->pPipeline->ResumeFromCheckpoint(pLoader);
+            *pRecoveryTime      = GetTimeSince(hangTime);
+            pContext->recovery_time += *pRecoveryTime;
+            pContext->numRecoveries++;
+            return resumeSts;
+        });
     }
-}
 
-mfxF64 GetTimeSince(msdk_tick start) {
-    static msdk_tick frequency = msdk_time_get_frequency();
-    return MSDK_GET_TIME(msdk_time_get_tick(), start, frequency);
+    mfxU32 failedIdx = 0;
+    mfxStatus sts    = recoveryScheduler.WaitAll(&failedIdx);
+    if (sts < MFX_ERR_NONE) {
+        printf("\n[WARNING] Session %u wasn't rebuilt: %s\n", failedIdx, StatusToString(sts));
+        return sts;
+    }
+
+    // Rebuilt sinks must not queue frames for sources that completed
+    for (mfxU32 idx : recoveryGroup) {
+        if (std::find(group.begin(), group.end(), idx) == group.end())
+            m_pThreadContextArray[idx]->pPipeline->CancelInputBuffering();
+    }
+
+    for (mfxU32 idx : group) {
+        const RecoveryCheckpoint& checkpoint =
+            m_pThreadContextArray[idx]->pPipeline->GetCheckpoint();
+        printf("[WARNING] Session %u recovered in %.3f sec. Resuming from IDR frame %u at output "
+               "offset %llu\n",
+               idx,
+               recoveryTimes[idx],
+               checkpoint.frameNum,
+               (unsigned long long)checkpoint.outputOffset);
+
+        m_pThreadContextArray[idx]->transcodingSts = MFX_ERR_NONE;
+        RunTranscodeRoutine(m_pThreadContextArray[idx].get());
+    }
+    printf("\n[WARNING] Successfully recovered. Continue transcoding.\n");
+
+    return MFX_ERR_NONE;
 }
 
 mfxStatus Launcher::ProcessResult() {
@@ -893,6 +1464,10 @@ mfxStatus Launcher::ProcessResult() {
         mfxF64 workTime          = m_pThreadContextArray[i]->working_time;
         mfxU32 framesNum         = m_pThreadContextArray[i]->numTransFrames;
 
+        mfxStatus qualitySts = m_pThreadContextArray[i]->pPipeline->FinishQualityCheck();
+        if (!transcodingSts)
+            transcodingSts = qualitySts;
+
         if (!FinalSts)
             FinalSts = transcodingSts;
 
@@ -904,6 +1479,69 @@ mfxStatus Launcher::ProcessResult() {
                           << SessionStsStr << " (" << StatusToString(transcodingSts) << ") "
                           << workTime << " sec, " << framesNum << " frames, " << std::fixed
                           << std::setprecision(3) << framesNum / workTime << " fps" << std::endl;
+        msdk_tick firstFrameTick = m_pThreadContextArray[i]->pPipeline->GetFirstFrameTick();
+        if (firstFrameTick) {
+            static msdk_tick frequency = msdk_time_get_frequency();
+            session_info_sstr << "    init " << m_pThreadContextArray[i]->init_time
+                              << " sec, first frame "
+                              << MSDK_GET_TIME(firstFrameTick, m_InitStartTime, frequency)
+                              << " sec after start" << std::endl;
+        }
+        for (const auto& r : m_pThreadContextArray[i]->pPipeline->GetRenditionLatency()) {
+            static msdk_tick frequency   = msdk_time_get_frequency();
+            const RenditionLatency& stat = r.second;
+            session_info_sstr << "    rendition " << r.first << ": " << stat.Frames
+                              << " frames, latency avg "
+                              << 1000. * stat.Total / frequency / std::max(stat.Frames, 1u)
+                              << " ms, max " << 1000. * stat.Max / frequency << " ms, budget "
+                              << stat.Budget << " ms missed " << stat.Missed << " time(s)"
+                              << std::endl;
+        }
+        if (m_pThreadContextArray[i]->pPipeline->HasControlMailbox()) {
+            static msdk_tick frequency = msdk_time_get_frequency();
+            auto& pipeline             = *m_pThreadContextArray[i]->pPipeline;
+            ControlStatistics stat     = pipeline.GetControlStatistics();
+            mfxU32 applied             = std::max(stat.Applied, 1u);
+            session_info_sstr << "    reconfigured " << stat.Applied
+                              << " time(s), applied after avg "
+                              << 1000. * stat.WaitTotal / frequency / applied << " ms, max "
+                              << 1000. * stat.WaitMax / frequency << " ms, reset avg "
+                              << 1000. * stat.CostTotal / frequency / applied << " ms, max "
+                              << 1000. * stat.CostMax / frequency << " ms; " << stat.Rejected
+                              << " rejected, " << stat.Expired << " expired" << std::endl;
+        }
+        std::shared_ptr<CLiveSource> liveSource =
+            m_pThreadContextArray[i]->pBSProcessor
+                ? m_pThreadContextArray[i]->pBSProcessor->GetLiveSource()
+                : nullptr;
+        if (liveSource) {
+            session_info_sstr << "    live source: " << liveSource->GetStatistics().ToString()
+                              << std::endl;
+        }
+        const CShmFrameRingWriter* pShmRing = m_pThreadContextArray[i]->pPipeline->GetShmRing();
+        if (pShmRing) {
+            session_info_sstr << "    shared memory ring: " << pShmRing->GetWritten()
+                              << " frames written, " << pShmRing->GetDropped() << " dropped, "
+                              << pShmRing->GetBlockTime() << " sec blocked" << std::endl;
+        }
+        if (m_InputParamsArray[i].nFPS) {
+            session_info_sstr << "    frame pacing: "
+                              << m_pThreadContextArray[i]->pPipeline->GetFramePacerStatistics()
+                                     .ToString()
+                              << std::endl;
+        }
+        const CpuPlacement& placement = m_pThreadContextArray[i]->placement;
+        session_info_sstr << "    cpus "
+                          << (placement.Cpus.empty() ? "any" : FormatCpuList(placement.Cpus));
+        if (placement.Node >= 0)
+            session_info_sstr << ", memory node " << placement.Node;
+        session_info_sstr << ", " << m_pThreadContextArray[i]->cpuMigrations << " CPU migrations"
+                          << std::endl;
+        if (m_pThreadContextArray[i]->numRecoveries) {
+            session_info_sstr << "    recovered from GPU hang "
+                              << m_pThreadContextArray[i]->numRecoveries << " time(s) in "
+                              << m_pThreadContextArray[i]->recovery_time << " sec" << std::endl;
+        }
         if (i < session_descriptions.size()) {
             session_info_sstr << session_descriptions[i] << std::endl;
         }
@@ -916,6 +1554,19 @@ mfxStatus Launcher::ProcessResult() {
             performance_file << session_info_sstr.str();
         }
     }
+
+    BitstreamBufferPool::Statistics bsStat = m_pBitstreamPool->GetStatistics();
+    if (bsStat.Allocations) {
+        std::stringstream ssBitstreams;
+        ssBitstreams << "Output bitstreams: " << bsStat.Allocations << " allocations, "
+                     << bsStat.Reuses << " reuses, peak resident " << std::fixed
+                     << std::setprecision(3) << bsStat.PeakResident / 1048576.
+                     << " MB, peak in use " << bsStat.PeakInUse / 1048576. << " MB" << std::endl;
+        std::cout << ssBitstreams.str();
+        if (performance_file.is_open()) {
+            performance_file << ssBitstreams.str();
+        }
+    }
     printf("-------------------------------------------------------------------------------\n");
 
     std::stringstream ssTest;
@@ -1364,11 +2015,75 @@ mfxStatus Launcher::VerifyCrossSessionsOptions() {
 
 } // mfxStatus Launcher::VerifyCrossSessionsOptions()
 
+std::vector<CpuPlacement> Launcher::PlaceSessionsOnCpus(AffinityPolicy policy) {
+    std::vector<std::string> cpuLists;
+    std::vector<mfxI32> numaNodes;
+    std::vector<mfxU32> groups;
+    std::vector<mfxI32> adapterNodes;
+    for (mfxU32 i = 0; i < m_InputParamsArray.size(); i++) {
+        const sInputParams& par = m_InputParamsArray[i];
+        cpuLists.push_back(par.CpuList);
+        numaNodes.push_back(par.NumaNode);
+        groups.push_back(GetRecoveryGroup(m_InputParamsArray, i).front());
+
+        mfxI32 adapterNode = -1;
+#if !defined(_WIN32) && !defined(_WIN64)
+        mfxU32 renderNode = par.DRMRenderNodeNum;
+        if (!renderNode && m_pLoader)
+            renderNode = m_pLoader->GetDRMRenderNodeNumUsed();
+        if (renderNode && par.libType != MFX_IMPL_SOFTWARE)
+            adapterNode = GetRenderNodeNumaNode(renderNode);
+#endif
+        adapterNodes.push_back(adapterNode);
+    }
+
+    CpuTopology topology = ReadCpuTopology();
+    std::vector<CpuPlacement> placements =
+        PlaceSessions(cpuLists, numaNodes, groups, adapterNodes, topology, policy);
+
+    for (mfxU32 i = 0; i < placements.size(); i++) {
+        if (placements[i].Cpus.empty() && (!cpuLists[i].empty() || numaNodes[i] >= 0))
+            printf("warning: session %u asks for CPUs that aren't online, it runs on any CPU\n",
+                   i);
+    }
+    return placements;
+} // std::vector<CpuPlacement> Launcher::PlaceSessionsOnCpus()
+
+void Launcher::ShareDecodes() {
+    std::vector<mfxI32> origins = ShareDuplicateDecodes(m_InputParamsArray);
+
+    std::vector<std::string> descriptions;
+    for (mfxU32 i = 0; i < origins.size(); i++) {
+        if (origins[i] >= 0) {
+            descriptions.push_back((size_t)origins[i] < session_descriptions.size()
+                                       ? session_descriptions[origins[i]]
+                                       : std::string());
+            continue;
+        }
+
+        std::stringstream sessions;
+        for (mfxU32 j = i + 1; j < origins.size() && m_InputParamsArray[j].eMode == Source; j++)
+            sessions << " " << origins[j];
+
+        printf("Sessions%s share one decode of %s\n",
+               sessions.str().c_str(),
+               m_InputParamsArray[i].strSrcFile.c_str());
+        descriptions.push_back("shared decode of " + m_InputParamsArray[i].strSrcFile +
+                               " for sessions" + sessions.str());
+    }
+    session_descriptions.swap(descriptions);
+} // void Launcher::ShareDecodes()
+
 mfxStatus Launcher::CreateSafetyBuffers() {
     SafetySurfaceBuffer* pBuffer     = NULL;
     SafetySurfaceBuffer* pPrevBuffer = NULL;
 
     for (mfxU32 i = 0; i < m_InputParamsArray.size(); i++) {
+        // every sink of 1 to N case feeds the chain of its own sources
+        if ((Sink == m_InputParamsArray[i].eMode) && (Native == m_InputParamsArray[0].eModeExt)) {
+            pPrevBuffer = NULL;
+        }
+
         /* this is for 1 to N case*/
         if ((Source == m_InputParamsArray[i].eMode) && (Native == m_InputParamsArray[0].eModeExt)) {
             pBuffer           = new SafetySurfaceBuffer(pPrevBuffer);
@@ -1468,6 +2183,8 @@ CascadeScalerConfig& Launcher::CreateCascadeScalerConfig() {
             if (desc.CascadeScaler) {
                 cfg.CascadeScalerRequired = true;
             }
+            desc.Priority      = par.CascadePriority;
+            desc.LatencyBudget = par.CascadeLatencyBudget;
 
             cfg.Targets.push_back(desc);
             cfg.InParams[desc.TargetID] = par;
@@ -1479,6 +2196,7 @@ CascadeScalerConfig& Launcher::CreateCascadeScalerConfig() {
     }
 
     cfg.ParFileImported = true;
+    cfg.BuildScalingTree();
     cfg.CreatePoolList();
 
     //init tracer, should be called when config is fully initialized
@@ -1495,64 +2213,186 @@ CascadeScalerConfig& Launcher::CreateCascadeScalerConfig() {
     return m_CSConfig;
 }
 
-//propagate cascade parameters, decoder parameters should be set before this call
-void TranscodingSample::CascadeScalerConfig::PropagateCascadeParameters() {
-    if (Targets.size() <= 1) {
-        //we should have at least two enc channels to propagate something
-        return;
-    }
+void TranscodingSample::CascadeScalerConfig::BuildScalingTree() {
+    DispatchOrder.clear();
+
+    //zero size means decoder output size
+    auto width = [](const TargetDescriptor& d) {
+        return d.DstWidth ? d.DstWidth : 0xFFFF;
+    };
+    auto height = [](const TargetDescriptor& d) {
+        return d.DstHeight ? d.DstHeight : 0xFFFF;
+    };
 
-    //special case for first channel output, should be incorporated into loop below, somehow
-    if (!Targets[0].FRC) {
-        Targets[0].DstFrameRate = Targets[0].SrcFrameRate;
+    //-cs is sticky, target gets frame rate and picture structure of the cascade outputs before
+    //it in par file. The tree keeps them, it only changes the source resolution.
+    struct Stream {
+        mfxU32 FRC; //target which did the last frame rate conversion
+        bool DI;
+        bool operator==(const Stream& other) const {
+            return FRC == other.FRC && DI == other.DI;
+        }
+    };
+    std::vector<Stream> in(Targets.size()), out(Targets.size());
+    //pool target used before the tree
+    std::vector<mfxU32> chained(Targets.size());
+    Stream stream      = { DecoderTargetID, false };
+    mfxU32 lastCascade = DecoderTargetID;
+    for (mfxU32 i = 0; i < Targets.size(); i++) {
+        in[i]      = stream;
+        out[i].FRC = Targets[i].FRC ? Targets[i].TargetID : stream.FRC;
+        out[i].DI  = Targets[i].DI || stream.DI;
+        chained[i] = lastCascade;
+        if (Targets[i].CascadeScaler) {
+            stream      = out[i];
+            lastCascade = Targets[i].TargetID;
+        }
     }
-    if (!Targets[0].DI) {
-        Targets[0].DstPicStruct = Targets[0].SrcPicStruct;
+
+    //cascade targets from the largest one, equal sizes keep par file order to avoid cycles
+    std::vector<mfxU32> bySize;
+    for (mfxU32 i = 0; i < Targets.size(); i++) {
+        if (Targets[i].CascadeScaler) {
+            bySize.push_back(i);
+        }
     }
+    std::stable_sort(bySize.begin(), bySize.end(), [&](mfxU32 l, mfxU32 r) {
+        return (mfxU32)width(Targets[l]) * height(Targets[l]) >
+               (mfxU32)width(Targets[r]) * height(Targets[r]);
+    });
+
+    for (mfxU32 i = 0; i < Targets.size(); i++) {
+        TargetDescriptor& dst = Targets[i];
+        //cascade target may use only larger targets as source, others may use any of them
+        size_t numCandidates = bySize.size();
+        if (dst.CascadeScaler) {
+            numCandidates = std::find(bySize.begin(), bySize.end(), i) - bySize.begin();
+        }
 
-    //set current parameters equal to decoder output
-    mfxU16 Width     = Targets[0].SrcWidth;
-    mfxU16 Height    = Targets[0].SrcHeight;
-    double FrameRate = Targets[0].SrcFrameRate;
-    mfxU16 PicStruct = Targets[0].SrcPicStruct;
+        //the last matching candidate is the smallest one
+        mfxU32 src = 0xFFFFFFFF;
+        for (size_t c = 0; c < numCandidates; c++) {
+            const TargetDescriptor& cand = Targets[bySize[c]];
+            if (bySize[c] != i && width(cand) >= width(dst) && height(cand) >= height(dst) &&
+                out[bySize[c]] == in[i]) {
+                src = cand.TargetID;
+            }
+        }
 
-    for (mfxU32 i = 1; i < Targets.size(); i++) {
-        //resolution
-        if (Targets[i - 1].CascadeScaler) {
-            Width = Targets[i].SrcWidth = Targets[i - 1].DstWidth;
-            Height = Targets[i].SrcHeight = Targets[i - 1].DstHeight;
+        if (src != 0xFFFFFFFF) {
+            dst.SrcTargetID = src;
+        }
+        else if (dst.CascadeScaler) {
+            dst.SrcTargetID = DecoderTargetID;
         }
         else {
-            Targets[i].SrcWidth  = Width;
-            Targets[i].SrcHeight = Height;
+            dst.SrcTargetID = chained[i];
         }
+    }
 
-        //framerate
-        if (Targets[i - 1].CascadeScaler && Targets[i - 1].FRC) {
-            FrameRate = Targets[i].SrcFrameRate = Targets[i - 1].DstFrameRate;
+    //target urgency is the most urgent one of its subtree, so sources of urgent targets are
+    //dispatched before everything else
+    struct Urgency {
+        mfxU32 Budget;
+        mfxU16 Priority;
+    };
+    std::vector<Urgency> urgency(Targets.size());
+    for (mfxU32 i = 0; i < Targets.size(); i++) {
+        urgency[i].Budget   = Targets[i].LatencyBudget ? Targets[i].LatencyBudget : 0xFFFFFFFF;
+        urgency[i].Priority = Targets[i].Priority;
+    }
+    for (mfxU32 i = 0; i < Targets.size(); i++) {
+        //walk up to the decoder, depth is limited by number of targets
+        mfxU32 src = Targets[i].SrcTargetID;
+        for (size_t depth = 0; src != DecoderTargetID && depth < Targets.size(); depth++) {
+            auto itr = std::find_if(Targets.begin(), Targets.end(), [src](TargetDescriptor& d) {
+                return d.TargetID == src;
+            });
+            if (itr == Targets.end()) {
+                break;
+            }
+            Urgency& u = urgency[itr - Targets.begin()];
+            u.Budget   = std::min(u.Budget, urgency[i].Budget);
+            u.Priority = std::max(u.Priority, urgency[i].Priority);
+            src        = itr->SrcTargetID;
         }
-        else {
-            Targets[i].SrcFrameRate = FrameRate;
+    }
+    //targets whose source is already dispatched, the most urgent one goes next
+    std::vector<bool> dispatched(Targets.size(), false);
+    while (DispatchOrder.size() < Targets.size()) {
+        mfxU32 next = (mfxU32)Targets.size();
+        for (mfxU32 i = 0; i < Targets.size(); i++) {
+            if (dispatched[i]) {
+                continue;
+            }
+            mfxU32 src = Targets[i].SrcTargetID;
+            if (src != DecoderTargetID &&
+                std::find(DispatchOrder.begin(), DispatchOrder.end(), src) == DispatchOrder.end()) {
+                continue;
+            }
+            if (next == Targets.size() || urgency[i].Budget < urgency[next].Budget ||
+                (urgency[i].Budget == urgency[next].Budget &&
+                 urgency[i].Priority > urgency[next].Priority)) {
+                next = i;
+            }
         }
-        if (!Targets[i].FRC) {
-            Targets[i].DstFrameRate = Targets[i].SrcFrameRate;
+        if (next == Targets.size()) {
+            //can't happen, sources are always larger than targets
+            break;
         }
+        dispatched[next] = true;
+        DispatchOrder.push_back(Targets[next].TargetID);
+    }
+}
 
-        //PicStruct
-        if (Targets[i - 1].CascadeScaler && Targets[i - 1].DI) {
-            PicStruct = Targets[i].SrcPicStruct = Targets[i - 1].DstPicStruct;
+//propagate cascade parameters, decoder parameters should be set before this call
+void TranscodingSample::CascadeScalerConfig::PropagateCascadeParameters() {
+    if (Targets.size() <= 1) {
+        //we should have at least two enc channels to propagate something
+        return;
+    }
+
+    //decoder output
+    const mfxU16 Width     = Targets[0].SrcWidth;
+    const mfxU16 Height    = Targets[0].SrcHeight;
+    const double FrameRate = Targets[0].SrcFrameRate;
+    const mfxU16 PicStruct = Targets[0].SrcPicStruct;
+
+    //sources are always before their targets in dispatch order
+    for (mfxU32 id : DispatchOrder) {
+        auto itr = std::find_if(Targets.begin(), Targets.end(), [id](TargetDescriptor& d) {
+            return d.TargetID == id;
+        });
+        if (itr == Targets.end()) {
+            continue;
+        }
+        TargetDescriptor& desc = *itr;
+
+        if (desc.SrcTargetID == DecoderTargetID) {
+            desc.SrcWidth     = Width;
+            desc.SrcHeight    = Height;
+            desc.SrcFrameRate = FrameRate;
+            desc.SrcPicStruct = PicStruct;
         }
         else {
-            Targets[i].SrcPicStruct = PicStruct;
+            const TargetDescriptor src = GetDesc(desc.SrcTargetID);
+            desc.SrcWidth              = src.DstWidth ? src.DstWidth : src.SrcWidth;
+            desc.SrcHeight             = src.DstHeight ? src.DstHeight : src.SrcHeight;
+            desc.SrcFrameRate          = src.DstFrameRate;
+            desc.SrcPicStruct          = src.DstPicStruct;
+        }
+
+        if (!desc.FRC) {
+            desc.DstFrameRate = desc.SrcFrameRate;
         }
-        if (!Targets[i].DI) {
-            Targets[i].DstPicStruct = Targets[i].SrcPicStruct;
+        if (!desc.DI) {
+            desc.DstPicStruct = desc.SrcPicStruct;
         }
     }
 
     PoolDescritpor& pool = Pools[DecoderPoolID];
-    pool.SurfaceWidth    = Targets[0].SrcWidth;
-    pool.SurfaceHeight   = Targets[0].SrcHeight;
+    pool.SurfaceWidth    = Width;
+    pool.SurfaceHeight   = Height;
 }
 
 void TranscodingSample::CascadeScalerConfig::CreatePoolList() {
@@ -1567,16 +2407,23 @@ void TranscodingSample::CascadeScalerConfig::CreatePoolList() {
     pool.SurfaceHeight = 0; // Targets[0].SrcHeight;
     Pools[pool.ID]     = pool;
 
+    //every cascade target owns a pool, which is the input of targets scaled from it
+    auto poolID = [](mfxU32 targetID) {
+        return DecoderPoolID + (targetID - DecoderTargetID);
+    };
     for (TargetDescriptor& desc : Targets) {
         if (desc.CascadeScaler) {
-            pool.PrevID        = pool.ID;
-            pool.ID            = DecoderPoolID + (desc.TargetID - DecoderTargetID);
+            pool.ID            = poolID(desc.TargetID);
+            pool.PrevID        = poolID(desc.SrcTargetID);
             pool.TargetID      = desc.TargetID;
             pool.SurfaceWidth  = desc.DstWidth;
             pool.SurfaceHeight = desc.DstHeight;
             Pools[pool.ID]     = pool;
+            desc.PoolID        = pool.ID;
+        }
+        else {
+            desc.PoolID = poolID(desc.SrcTargetID);
         }
-        desc.PoolID = pool.ID;
     }
 }
 
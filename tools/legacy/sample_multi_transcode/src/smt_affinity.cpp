@@ -0,0 +1,282 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "smt_affinity.h"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <sched.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+using namespace TranscodingSample;
+
+// CPU numbers above are rejected as typos
+static const mfxU32 MaxCpuNumber = 4095;
+
+static bool ReadCpuNumber(const std::string& word, mfxU32& cpu) {
+    if (word.empty() || word.size() > 4 ||
+        word.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+
+    cpu = (mfxU32)strtoul(word.c_str(), NULL, 10);
+    return cpu <= MaxCpuNumber;
+}
+
+bool TranscodingSample::ParseCpuList(const std::string& list, std::vector<mfxU32>& cpus) {
+    std::vector<mfxU32> parsed;
+    std::istringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        size_t dash  = range.find('-');
+        mfxU32 first = 0, last = 0;
+        if (!ReadCpuNumber(range.substr(0, dash), first))
+            return false;
+        last = first;
+        if (dash != std::string::npos &&
+            (!ReadCpuNumber(range.substr(dash + 1), last) || last < first))
+            return false;
+
+        for (mfxU32 cpu = first; cpu <= last; cpu++)
+            parsed.push_back(cpu);
+    }
+    // a trailing comma leaves an empty range behind
+    if (parsed.empty() || list.back() == ',')
+        return false;
+
+    std::sort(parsed.begin(), parsed.end());
+    parsed.erase(std::unique(parsed.begin(), parsed.end()), parsed.end());
+    cpus = parsed;
+    return true;
+}
+
+std::string TranscodingSample::FormatCpuList(const std::vector<mfxU32>& cpus) {
+    std::ostringstream list;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+            j++;
+
+        if (i)
+            list << ',';
+        list << cpus[i];
+        if (j > i)
+            list << '-' << cpus[j];
+        i = j + 1;
+    }
+    return list.str();
+}
+
+mfxI32 CpuTopology::GetNode(mfxU32 cpu) const {
+    for (const auto& node : NodeCpus) {
+        if (std::binary_search(node.second.begin(), node.second.end(), cpu))
+            return node.first;
+    }
+    return -1;
+}
+
+static bool ReadSysfsLine(const std::string& path, std::string& line) {
+    std::ifstream file(path);
+    return file.is_open() && std::getline(file, line);
+}
+
+CpuTopology TranscodingSample::ReadCpuTopology(const std::string& sysfsRoot) {
+    CpuTopology topology;
+
+    std::string line;
+    std::vector<mfxU32> nodes;
+    if (ReadSysfsLine(sysfsRoot + "/devices/system/node/online", line) &&
+        ParseCpuList(line, nodes)) {
+        for (mfxU32 node : nodes) {
+            std::vector<mfxU32> cpus;
+            // nodes with memory only have an empty list
+            if (ReadSysfsLine(sysfsRoot + "/devices/system/node/node" + std::to_string(node) +
+                                  "/cpulist",
+                              line) &&
+                ParseCpuList(line, cpus))
+                topology.NodeCpus[(mfxI32)node] = cpus;
+        }
+    }
+    if (!topology.NodeCpus.empty())
+        return topology;
+
+    std::vector<mfxU32> cpus;
+    if (!ReadSysfsLine(sysfsRoot + "/devices/system/cpu/online", line) ||
+        !ParseCpuList(line, cpus)) {
+        cpus.clear();
+        for (mfxU32 cpu = 0; cpu < std::max(std::thread::hardware_concurrency(), 1u); cpu++)
+            cpus.push_back(cpu);
+    }
+    topology.NodeCpus[0] = cpus;
+    return topology;
+}
+
+mfxI32 TranscodingSample::GetRenderNodeNumaNode(mfxU32 renderNodeNum,
+                                                const std::string& sysfsRoot) {
+    std::string line;
+    if (!ReadSysfsLine(sysfsRoot + "/class/drm/renderD" + std::to_string(renderNodeNum) +
+                           "/device/numa_node",
+                       line))
+        return -1;
+
+    // devices of single node hosts report -1
+    return (mfxI32)strtol(line.c_str(), NULL, 10);
+}
+
+std::vector<CpuPlacement> TranscodingSample::PlaceSessions(
+    const std::vector<std::string>& cpuLists,
+    const std::vector<mfxI32>& numaNodes,
+    const std::vector<mfxU32>& groups,
+    const std::vector<mfxI32>& adapterNodes,
+    const CpuTopology& topology,
+    AffinityPolicy policy) {
+    std::vector<CpuPlacement> placements(groups.size());
+    std::vector<bool> byPolicy(groups.size(), false);
+
+    // groups of the sessions left to the policy with their nodes, in order of first session
+    std::vector<mfxU32> policyGroups;
+    std::map<mfxU32, mfxI32> groupNodes;
+    for (size_t i = 0; i < groups.size(); i++) {
+        CpuPlacement& placement = placements[i];
+        bool hasCpus            = i < cpuLists.size() && !cpuLists[i].empty();
+        bool hasNode            = i < numaNodes.size() && numaNodes[i] >= 0;
+
+        if (hasCpus) {
+            ParseCpuList(cpuLists[i], placement.Cpus);
+            placement.Cpus.erase(std::remove_if(placement.Cpus.begin(),
+                                                placement.Cpus.end(),
+                                                [&topology](mfxU32 cpu) {
+                                                    return topology.GetNode(cpu) < 0;
+                                                }),
+                                 placement.Cpus.end());
+            // memory follows the CPUs if they are all on one node
+            if (!placement.Cpus.empty())
+                placement.Node = topology.GetNode(placement.Cpus.front());
+            for (mfxU32 cpu : placement.Cpus) {
+                if (topology.GetNode(cpu) != placement.Node)
+                    placement.Node = -1;
+            }
+        }
+        if (hasNode) {
+            auto node = topology.NodeCpus.find(numaNodes[i]);
+            if (node == topology.NodeCpus.end())
+                continue;
+            if (!hasCpus)
+                placement.Cpus = node->second;
+            placement.Node = node->first;
+        }
+        if (hasCpus || hasNode || policy == AffinityPolicy::None || topology.NodeCpus.empty())
+            continue;
+
+        byPolicy[i] = true;
+
+        if (groupNodes.find(groups[i]) == groupNodes.end()) {
+            mfxI32 node = -1;
+            if (policy == AffinityPolicy::Adapter && i < adapterNodes.size() &&
+                topology.NodeCpus.count(adapterNodes[i]))
+                node = adapterNodes[i];
+            groupNodes[groups[i]] = node;
+            policyGroups.push_back(groups[i]);
+        }
+    }
+
+    // groups without an adapter node are spread round-robin, starting from the least used node
+    std::map<mfxI32, std::vector<mfxU32>> nodeGroups;
+    for (mfxU32 group : policyGroups) {
+        if (groupNodes[group] >= 0)
+            nodeGroups[groupNodes[group]].push_back(group);
+    }
+    for (mfxU32 group : policyGroups) {
+        if (groupNodes[group] >= 0)
+            continue;
+
+        mfxI32 node     = topology.NodeCpus.begin()->first;
+        size_t leastUse = nodeGroups[node].size();
+        for (const auto& candidate : topology.NodeCpus) {
+            if (nodeGroups[candidate.first].size() < leastUse) {
+                node     = candidate.first;
+                leastUse = nodeGroups[node].size();
+            }
+        }
+        groupNodes[group] = node;
+        nodeGroups[node].push_back(group);
+    }
+
+    // the groups of a node split its CPUs into equal slices, more groups than CPUs share them
+    std::map<mfxU32, std::vector<mfxU32>> groupCpus;
+    for (const auto& node : nodeGroups) {
+        const std::vector<mfxU32>& cpus = topology.NodeCpus.at(node.first);
+        size_t numGroups                = node.second.size();
+        for (size_t k = 0; k < numGroups; k++) {
+            std::vector<mfxU32>& slice = groupCpus[node.second[k]];
+            if (numGroups <= cpus.size())
+                slice.assign(cpus.begin() + k * cpus.size() / numGroups,
+                             cpus.begin() + (k + 1) * cpus.size() / numGroups);
+            else
+                slice.push_back(cpus[k % cpus.size()]);
+        }
+    }
+
+    for (size_t i = 0; i < groups.size(); i++) {
+        if (!byPolicy[i])
+            continue;
+        placements[i].Cpus = groupCpus[groups[i]];
+        placements[i].Node = groupNodes[groups[i]];
+    }
+
+    return placements;
+}
+
+mfxStatus TranscodingSample::BindCurrentThread(const CpuPlacement& placement) {
+    if (placement.Cpus.empty())
+        return MFX_ERR_NONE;
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (mfxU32 cpu : placement.Cpus) {
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &cpuSet);
+    }
+    if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet))
+        return MFX_ERR_UNSUPPORTED;
+
+    if (placement.Node >= 0) {
+        // MPOL_PREFERRED of linux/mempolicy.h, pages come from other nodes once the node is full
+        const int preferred    = 1;
+        const mfxU32 maxNodes  = 8 * sizeof(unsigned long);
+        unsigned long nodeMask = 1ul << (placement.Node % maxNodes);
+        if ((mfxU32)placement.Node >= maxNodes ||
+            syscall(SYS_set_mempolicy, preferred, &nodeMask, maxNodes + 1))
+            return MFX_ERR_UNSUPPORTED;
+    }
+    return MFX_ERR_NONE;
+#else
+    return MFX_ERR_UNSUPPORTED;
+#endif
+}
+
+mfxU64 TranscodingSample::GetCurrentThreadMigrations() {
+#if !defined(_WIN32) && !defined(_WIN64)
+    std::ifstream sched("/proc/thread-self/sched");
+    std::string line;
+    while (std::getline(sched, line)) {
+        if (line.compare(0, 16, "se.nr_migrations") != 0)
+            continue;
+
+        size_t colon = line.find(':');
+        if (colon != std::string::npos)
+            return strtoull(line.c_str() + colon + 1, NULL, 10);
+    }
+#endif
+    return 0;
+}
@@ -27,15 +27,19 @@
 #include "version.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <iterator>
 #include <limits>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 using namespace TranscodingSample;
@@ -174,6 +178,43 @@ void PrintHelp() {
     HELP_LINE("  -greedy");
     HELP_LINE("                Use greedy formula to calculate number of surfaces");
     HELP_LINE("");
+    HELP_LINE("  -par_threads <N>");
+    HELP_LINE("                Parse lines of the par file on N threads, 1 by default.");
+    HELP_LINE("                Messages of different lines may be printed out of order");
+    HELP_LINE("");
+    HELP_LINE("  -share_decode");
+    HELP_LINE("                Decode an input once for all sessions that read it with the");
+    HELP_LINE("                same decoder, device and memory settings. These sessions run");
+    HELP_LINE("                as -i::source of one -o::sink session, the slowest of them");
+    HELP_LINE("                bounds the number of decoded frames in flight");
+    HELP_LINE("");
+    HELP_LINE("  -affinity <none|auto|adapter>");
+    HELP_LINE("                Place sessions without -cpus or -numa_node on CPUs (Linux):");
+    HELP_LINE("                  none    - threads run on any CPU (default)");
+    HELP_LINE("                  auto    - sessions sharing surfaces are kept together, the");
+    HELP_LINE("                            groups are spread over NUMA nodes and split the");
+    HELP_LINE("                            CPUs of their node");
+    HELP_LINE("                  adapter - as auto, on the NUMA node of the session's adapter");
+    HELP_LINE("                Sessions allocate memory on the node of their CPUs");
+    HELP_LINE("");
+    HELP_LINE("  -fps_spin <microseconds>");
+    HELP_LINE("                Sessions limited with -fps share one timer thread which sleeps");
+    HELP_LINE("                until this long before a frame deadline and then polls the");
+    HELP_LINE("                clock, trading CPU time for lower jitter. 0 by default");
+    HELP_LINE("");
+    HELP_LINE("  -ctrl <fifo-name>");
+    HELP_LINE("                Read reconfiguration commands from FIFO (created if missing),");
+    HELP_LINE("                one per line, applied at the next frame of the session:");
+    HELP_LINE("                  <session|*> bitrate <kbps> [<max kbps>]");
+    HELP_LINE("                  <session|*> size <width> <height>   (sessions with VPP)");
+    HELP_LINE("                  <session|*> qp <0-51>               (CQP, 0 - encoder QP)");
+    HELP_LINE("                  <session|*> idr");
+    HELP_LINE("                Sessions are named by -name or by their number");
+    HELP_LINE("");
+    HELP_LINE("  -ctrl_latency <ms>");
+    HELP_LINE("                Drop commands not applied within <ms>, 1000 by default,");
+    HELP_LINE("                0 - no limit");
+    HELP_LINE("");
     HELP_LINE("Pipeline description (general options):");
     HELP_LINE("");
     HELP_LINE("  -i::<h265|h264|mpeg2|vc1|mvc|jpeg|vp9|av1> <file-name>");
@@ -300,10 +341,46 @@ void PrintHelp() {
 
     HELP_LINE("");
     HELP_LINE("  -robust       Recover from gpu hang errors as they come");
-    HELP_LINE("                (by resetting components)");
+    HELP_LINE("                (by resetting components of the hung session and of the");
+    HELP_LINE("                sessions sharing its pipeline, others keep running; the");
+    HELP_LINE("                output is written again from the last IDR frame)");
     HELP_LINE("");
     HELP_LINE("  -robust:soft  Recover from gpu hang errors by inserting an IDR");
     HELP_LINE("");
+    HELP_LINE("  -name <name>  Name of the session in -ctrl commands");
+    HELP_LINE("");
+    HELP_LINE("  -cpus <list>  Run threads of the session on CPUs of <list>, e.g. 0-3,8");
+    HELP_LINE("");
+    HELP_LINE("  -numa_node <node>");
+    HELP_LINE("                Run threads of the session on CPUs of NUMA node <node> and");
+    HELP_LINE("                allocate its memory there. With -cpus only memory is placed");
+    HELP_LINE("");
+    HELP_LINE("  -live <frames per second>[/<denominator>]");
+    HELP_LINE("                Emulate a live feed: frames or access units of the input file");
+    HELP_LINE("                arrive at this rate instead of being read at full speed. The");
+    HELP_LINE("                latency from arrival to output, deadline misses and the most");
+    HELP_LINE("                frames waiting for the session are reported. Needs a raw, h264,");
+    HELP_LINE("                mjpeg or IVF (vp8, vp9, av1) input");
+    HELP_LINE("  -live_jitter <microseconds>");
+    HELP_LINE("                Frames of the live feed arrive up to this much late");
+    HELP_LINE("  -live_burst <N> <L>");
+    HELP_LINE("                The first L of every N frames of the live feed are held back");
+    HELP_LINE("                and arrive at once");
+    HELP_LINE("  -live_deadline <ms>");
+    HELP_LINE("                Outputs later than this after the arrival of their frame are");
+    HELP_LINE("                deadline misses, two frame periods by default");
+    HELP_LINE("");
+    HELP_LINE("  -shm_ring <name>");
+    HELP_LINE("                Hand raw output frames to another process through a ring of");
+    HELP_LINE("                frame slots in /dev/shm/<name>. Implies -o::raw if no output");
+    HELP_LINE("                is given, see sample_shm_consumer for a consumer");
+    HELP_LINE("  -shm_ring_slots <n>");
+    HELP_LINE("                Frame slots of the shared memory ring, 8 by default");
+    HELP_LINE("  -shm_ring_drop");
+    HELP_LINE("                Drop frames while the ring is full instead of waiting for the");
+    HELP_LINE("                consumer. Without it the first consumer is waited for up to");
+    HELP_LINE("                10 s, frames are dropped after that or once it has exited");
+    HELP_LINE("");
     HELP_LINE("  -async        Depth of asynchronous pipeline. default value 1");
     HELP_LINE("");
     HELP_LINE("  -join         Join session with other session(s),");
@@ -377,8 +454,10 @@ void PrintHelp() {
     HELP_LINE("");
     HELP_LINE("  -vpp::vid     Set vpp output to video memory");
     HELP_LINE("");
-    HELP_LINE("  -fps <frames per second>");
-    HELP_LINE("                Transcoding frame rate limit");
+    HELP_LINE("  -fps <frames per second>[/<denominator>]");
+    HELP_LINE("                Transcoding frame rate limit, e.g. 30 or 30000/1001. Frames are");
+    HELP_LINE("                released at exact deadlines, the pacing of every session is");
+    HELP_LINE("                reported at the end.");
     HELP_LINE("");
     HELP_LINE("  -pe           Set encoding plugin for this particular session.");
     HELP_LINE("                This setting overrides plugin settings defined by SET clause.");
@@ -814,6 +893,20 @@ void PrintHelp() {
     HELP_LINE("  -dump <fileName>");
     HELP_LINE("                dump MSDK components configuration to the file in text form");
     HELP_LINE("");
+    HELP_LINE("  -verify_ref <fileName>");
+    HELP_LINE("                compare raw output (-o::raw or -vpp_comp_dump) with a reference");
+    HELP_LINE("                of the same layout and print per-plane PSNR and SSIM");
+    HELP_LINE("");
+    HELP_LINE("  -verify_digest <fileName>");
+    HELP_LINE("                compare per-plane CRC32 of raw output with a digest stream,");
+    HELP_LINE("                the session fails on mismatch");
+    HELP_LINE("");
+    HELP_LINE("  -dump_digest <fileName>");
+    HELP_LINE("                write per-plane CRC32 of raw output to a digest stream");
+    HELP_LINE("");
+    HELP_LINE("  -verify_threads <number>");
+    HELP_LINE("                number of output verification threads. Default: hardware threads");
+    HELP_LINE("");
     HELP_LINE("  -tcbrctestfile <filepath>");
     HELP_LINE("                if specified, the encoder will take targetFrameSize parameters for");
     HELP_LINE("                TCBRC test from text file. The parameters for TCBRC should be");
@@ -821,7 +914,17 @@ void PrintHelp() {
     HELP_LINE("                have this functionality. Therefore the file data from <filepath>");
     HELP_LINE("                is used for TCBRC test. This is a test model");
     HELP_LINE("");
-    HELP_LINE("  -cs           turn on cascade scaling");
+    HELP_LINE("  -cs           turn on cascade scaling, every output is scaled from the smallest");
+    HELP_LINE("                larger output");
+    HELP_LINE("");
+    HELP_LINE("  -cs_priority <n>");
+    HELP_LINE("                cascade scaling priority of this output, higher is scaled first.");
+    HELP_LINE("                Default: 0");
+    HELP_LINE("");
+    HELP_LINE("  -cs_latency <ms>");
+    HELP_LINE("                cascade scaling latency budget of this output, outputs with lower");
+    HELP_LINE("                budget are scaled first and handed to encoder once scaled.");
+    HELP_LINE("                Default: 0 - no budget");
     HELP_LINE("");
     HELP_LINE("  -trace        turn on tracing");
     HELP_LINE("");
@@ -939,7 +1042,15 @@ CmdProcessor::CmdProcessor()
           bRobustFlag(false),
           bSoftRobustFlag(false),
           shouldUseGreedyFormula(false),
-          session_descriptions() {} //CmdProcessor::CmdProcessor()
+          m_ControlChannel(),
+          m_nControlLatency(1000),
+          m_nParThreads(1),
+          m_bShareDecode(false),
+          m_AffinityPolicy(AffinityPolicy::None),
+          m_nFpsSpinTail(0),
+          session_descriptions(),
+          m_ROIFilesMutex(),
+          m_ROIFiles() {} //CmdProcessor::CmdProcessor()
 
 CmdProcessor::~CmdProcessor() {
     m_SessionArray.clear();
@@ -970,6 +1081,51 @@ mfxStatus CmdProcessor::ParseCmdLine(int argc, char* argv[]) {
             }
             parameter_file_name = std::string(argv[0]);
         }
+        else if (msdk_match(argv[0], "-par_threads")) {
+            --argc;
+            ++argv;
+            if (!argv[0]) {
+                printf("error: no argument given for '-par_threads' option\n");
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (MFX_ERR_NONE != msdk_opt_read(argv[0], m_nParThreads) || !m_nParThreads) {
+                printf("error: -par_threads \"%s\" is invalid", argv[0]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (msdk_match(argv[0], "-share_decode")) {
+            m_bShareDecode = true;
+        }
+        else if (msdk_match(argv[0], "-affinity")) {
+            --argc;
+            ++argv;
+            if (!argv[0]) {
+                printf("error: no argument given for '-affinity' option\n");
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (msdk_match(argv[0], "none"))
+                m_AffinityPolicy = AffinityPolicy::None;
+            else if (msdk_match(argv[0], "auto"))
+                m_AffinityPolicy = AffinityPolicy::Auto;
+            else if (msdk_match(argv[0], "adapter"))
+                m_AffinityPolicy = AffinityPolicy::Adapter;
+            else {
+                printf("error: -affinity \"%s\" is invalid", argv[0]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (msdk_match(argv[0], "-fps_spin")) {
+            --argc;
+            ++argv;
+            if (!argv[0]) {
+                printf("error: no argument given for '-fps_spin' option\n");
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (MFX_ERR_NONE != msdk_opt_read(argv[0], m_nFpsSpinTail)) {
+                printf("error: -fps_spin \"%s\" is invalid", argv[0]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
         else if (msdk_match(argv[0], "-surface_wait_interval")) {
             --argc;
             ++argv;
@@ -1005,6 +1161,27 @@ mfxStatus CmdProcessor::ParseCmdLine(int argc, char* argv[]) {
         else if (msdk_match(argv[0], "-greedy")) {
             shouldUseGreedyFormula = true;
         }
+        else if (msdk_match(argv[0], "-ctrl")) {
+            --argc;
+            ++argv;
+            if (!argv[0]) {
+                printf("error: no argument given for '-ctrl' option\n");
+                return MFX_ERR_UNSUPPORTED;
+            }
+            m_ControlChannel = argv[0];
+        }
+        else if (msdk_match(argv[0], "-ctrl_latency")) {
+            --argc;
+            ++argv;
+            if (!argv[0]) {
+                printf("error: no argument given for '-ctrl_latency' option\n");
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (MFX_ERR_NONE != msdk_opt_read(argv[0], m_nControlLatency)) {
+                printf("error: -ctrl_latency \"%s\" is invalid", argv[0]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
         else if (msdk_match(argv[0], "-p")) {
             if (!performance_file_name.empty()) {
                 printf("error: only one performance file is supported");
@@ -1113,12 +1290,20 @@ mfxStatus CmdProcessor::ParseParFile(const std::string& filename) {
         printf("error: ParFile \"%s\" could not be opened\n", parameter_file_name.c_str());
         return MFX_ERR_UNSUPPORTED;
     }
+    std::vector<std::string> lines;
     std::string line;
     while (std::getline(in_stream, line)) {
         if (line.empty()) {
             continue;
         }
-        sts = TokenizeLine(line);
+        lines.push_back(std::move(line));
+    }
+
+    if (m_nParThreads > 1 && lines.size() > 1)
+        return ParseParLines(lines);
+
+    for (const std::string& sessionLine : lines) {
+        sts = TokenizeLine(sessionLine);
         MSDK_CHECK_STATUS(sts, "TokenizeLine failed");
     }
     return MFX_ERR_NONE;
@@ -1189,6 +1374,25 @@ static void split_cmd(std::string const& cmd, std::vector<std::string>& args) {
 }
 
     #endif
+
+static void split_cmd(std::string const& cmd, std::vector<char>& buffer, std::vector<char*>& argv) {
+    std::vector<std::string> args;
+    split_cmd(cmd, args);
+
+    size_t size = 0;
+    for (auto& arg : args)
+        size += arg.size() + 1;
+    buffer.resize(size);
+
+    argv.clear();
+    char* out = buffer.data();
+    for (auto& arg : args) {
+        argv.push_back(out);
+        out = std::copy(arg.begin(), arg.end(), out);
+        *out++ = '\0';
+    }
+}
+
 #else
 
 /*
@@ -1198,38 +1402,45 @@ This function uses the algorithm used by CommandLineToArgvW, but runs on
 ASCII/UTF-8 input, and treats '=' as whitespace for word breaking purposes.
 
 The last is to maintain backward compatibility with the prior behavior of TokenizeLine.
+
+Arguments are written one after another to buffer, so a line costs no allocation per argument
+once buffer has grown to the longest line.
 */
 
-static void split_cmd(std::string const& cmd, std::vector<std::string>& args) {
-    if (cmd.empty()) {
-        return;
-    }
+static void split_cmd(std::string const& cmd, std::vector<char>& buffer, std::vector<char*>& argv) {
+    argv.clear();
+    // an argument is never longer than the characters it was read from and all but the last one
+    // end with a separator, so one resize makes room for all of them and their terminating zeros
+    buffer.resize(cmd.size() + 1);
+    char* out = buffer.data();
+
+    const size_t size  = cmd.size();
     size_t i           = 0;
     bool found_arg     = false;
     bool in_quotes     = false;
     size_t slash_count = 0;
     bool use_char      = true;
-    std::stringstream arg;
-    while (i < cmd.size()) {
+    while (i < size) {
         // remove leading whitespace
-        while ((i < cmd.size()) && (cmd[i] == ' ' || cmd[i] == '\t' || cmd[i] == '=')) {
+        while ((i < size) && (cmd[i] == ' ' || cmd[i] == '\t' || cmd[i] == '=')) {
             i += 1;
         }
-        if (i >= cmd.size()) {
+        if (i >= size) {
             break;
         }
         found_arg = false;
-        while (i < cmd.size()) {
+        char* arg = out;
+        while (i < size) {
             slash_count = 0;
             use_char    = true;
-            while ((i < cmd.size()) && cmd[i] == '\\') {
+            while ((i < size) && cmd[i] == '\\') {
                 i += 1;
                 slash_count += 1;
             }
-            if (cmd[i] == '"') {
+            if ((i < size) && cmd[i] == '"') {
                 found_arg = true;
                 if (slash_count % 2 == 0) {
-                    if (in_quotes && cmd[i + 1] == '"') {
+                    if (in_quotes && (i + 1 < size) && cmd[i + 1] == '"') {
                         in_quotes = !in_quotes;
                         i += 1;
                     }
@@ -1241,124 +1452,41 @@ static void split_cmd(std::string const& cmd, std::vector<std::string>& args) {
                 slash_count /= 2;
             }
             while (slash_count--) {
-                arg << '\\';
+                *out++    = '\\';
                 found_arg = true;
             }
+            if (i >= size) {
+                break;
+            }
             if (!in_quotes && (cmd[i] == ' ' || cmd[i] == '\t' || cmd[i] == '=')) {
                 break;
             }
             if (use_char) {
-                arg << cmd[i];
+                *out++    = cmd[i];
                 found_arg = true;
             }
             i += 1;
         }
         if (found_arg) {
-            args.push_back(arg.str());
+            *out++ = '\0';
+            argv.push_back(arg);
         }
-        arg.str(std::string());
     }
 }
 
 #endif
 
 mfxStatus CmdProcessor::TokenizeLine(const std::string& line) {
-    std::vector<std::string> args;
-    split_cmd(line, args);
+    std::vector<char> buffer;
     std::vector<char*> argv;
-    for (auto& arg : args) {
-        argv.push_back(&arg[0]);
-    }
-    return ParseParamsForOneSession((mfxU32)argv.size(), &argv[0]);
-}
-
-bool CmdProcessor::isspace(char a) {
-    return (std::isspace(a) != 0);
-}
+    split_cmd(line, buffer, argv);
+    // nothing but separators
+    if (argv.empty())
+        return MFX_ERR_NONE;
 
-bool CmdProcessor::is_not_allowed_char(char a) {
-    return (std::isdigit(a) == 0) && (std::isspace(a) == 0) && (a != ';') && (a != '-');
+    return ParseParamsForOneSession((mfxU32)argv.size(), argv.data());
 }
 
-bool CmdProcessor::ParseROIFile(const std::string& roi_file_name,
-                                std::vector<mfxExtEncoderROI>& m_ROIData) {
-    FILE* roi_file = NULL;
-    MSDK_FOPEN(roi_file, roi_file_name.c_str(), "rb");
-
-    m_ROIData.clear();
-
-    if (roi_file) {
-        // read file to buffer
-        fseek(roi_file, 0, SEEK_END);
-        long file_size = ftell(roi_file);
-        rewind(roi_file);
-        std::vector<char> buffer(file_size);
-        char* roi_data = &buffer[0];
-        if (file_size < 0 || (size_t)file_size != fread(roi_data, 1, file_size, roi_file)) {
-            fclose(roi_file);
-            return false;
-        }
-        fclose(roi_file);
-
-        // search for not allowed characters
-        char* not_allowed_char = std::find_if(roi_data, roi_data + file_size, is_not_allowed_char);
-        if (not_allowed_char != (roi_data + file_size)) {
-            return false;
-        }
-
-        // get unformatted roi data
-        std::string unformatted_roi_data;
-        unformatted_roi_data.clear();
-        std::remove_copy_if(roi_data,
-                            roi_data + file_size,
-                            std::inserter(unformatted_roi_data, unformatted_roi_data.end()),
-                            isspace);
-
-        // split data to items
-        std::stringstream unformatted_roi_data_ss(unformatted_roi_data);
-        std::vector<std::string> items;
-        items.clear();
-        split(unformatted_roi_data, items, char(';'));
-
-        // parse data and store roi data for each frame
-        unsigned int item_ind = 0;
-        while (1) {
-            if (item_ind >= items.size())
-                break;
-
-            mfxExtEncoderROI frame_roi;
-            std::memset(&frame_roi, 0, sizeof(frame_roi));
-            frame_roi.Header.BufferId = MFX_EXTBUFF_ENCODER_ROI;
-            frame_roi.ROIMode         = MFX_ROI_MODE_QP_DELTA;
-
-            int roi_num = std::atoi(items[item_ind].c_str());
-            if (roi_num < 0 || roi_num > (int)(sizeof(frame_roi.ROI) / sizeof(frame_roi.ROI[0]))) {
-                m_ROIData.clear();
-                return false;
-            }
-            if ((item_ind + 5 * roi_num) >= items.size()) {
-                m_ROIData.clear();
-                return false;
-            }
-
-            for (int i = 0; i < roi_num; i++) {
-                // do not handle out of range integer errors
-                frame_roi.ROI[i].Left    = std::atoi(items[item_ind + i * 5 + 1].c_str());
-                frame_roi.ROI[i].Top     = std::atoi(items[item_ind + i * 5 + 2].c_str());
-                frame_roi.ROI[i].Right   = std::atoi(items[item_ind + i * 5 + 3].c_str());
-                frame_roi.ROI[i].Bottom  = std::atoi(items[item_ind + i * 5 + 4].c_str());
-                frame_roi.ROI[i].DeltaQP = (mfxI16)std::atoi(items[item_ind + i * 5 + 5].c_str());
-            }
-            frame_roi.NumROI = (mfxU16)roi_num;
-            m_ROIData.push_back(frame_roi);
-            item_ind = item_ind + roi_num * 5 + 1;
-        }
-    }
-    else {
-        return false;
-    }
-    return true;
-}
 #ifdef ENABLE_MCTF
 
 int ParseMCTFParamsFileContent(std::fstream& input, sInputParams* pParams, int maxParams);
@@ -1541,82 +1669,6 @@ mfxStatus ParseAdditionalParams(char* argv[],
         i += 1;
     }
 #endif
-    else if (msdk_match(argv[i], "-BaseLayerPID")) {
-        VAL_CHECK(i + 1 >= argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nBaseLayerPID)) {
-            PrintError("BaseLayerPID is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
-    else if (msdk_match(argv[i], "-SPSId")) {
-        VAL_CHECK(i + 1 >= argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nSPSId)) {
-            PrintError("SPSId is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
-    else if (msdk_match(argv[i], "-PPSId")) {
-        VAL_CHECK(i + 1 >= argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nPPSId)) {
-            PrintError("PPSId is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
-    else if (msdk_match(argv[i], "-VuiTC")) {
-        VAL_CHECK(i + 1 >= argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nTransferCharacteristics)) {
-            PrintError("-VuiTC TransferCharacteristics is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
-    else if (msdk_match(argv[i], "-lowpower:on")) {
-        InputParams.enableQSVFF = true;
-    }
-    else if (msdk_match(argv[i], "-lowpower:off")) {
-        InputParams.enableQSVFF = false;
-    }
-    else if (msdk_match(argv[i], "-PicTimingSEI:on")) {
-        InputParams.nPicTimingSEI = MFX_CODINGOPTION_ON;
-    }
-    else if (msdk_match(argv[i], "-PicTimingSEI:off")) {
-        InputParams.nPicTimingSEI = MFX_CODINGOPTION_OFF;
-    }
-    else if (msdk_match(argv[i], "-NalHrdConformance:on")) {
-        InputParams.nNalHrdConformance = MFX_CODINGOPTION_ON;
-    }
-    else if (msdk_match(argv[i], "-NalHrdConformance:off")) {
-        InputParams.nNalHrdConformance = MFX_CODINGOPTION_OFF;
-    }
-    else if (msdk_match(argv[i], "-VuiNalHrdParameters:on")) {
-        InputParams.nVuiNalHrdParameters = MFX_CODINGOPTION_ON;
-    }
-    else if (msdk_match(argv[i], "-VuiNalHrdParameters:off")) {
-        InputParams.nVuiNalHrdParameters = MFX_CODINGOPTION_OFF;
-    }
-    else if (msdk_match(argv[i], "-BitrateLimit:on")) {
-        InputParams.BitrateLimit = MFX_CODINGOPTION_ON;
-    }
-    else if (msdk_match(argv[i], "-BitrateLimit:off")) {
-        InputParams.BitrateLimit = MFX_CODINGOPTION_OFF;
-    }
-    else if (msdk_match(argv[i], "-AdaptiveI:on")) {
-        InputParams.AdaptiveI = MFX_CODINGOPTION_ON;
-    }
-    else if (msdk_match(argv[i], "-AdaptiveI:off")) {
-        InputParams.AdaptiveI = MFX_CODINGOPTION_OFF;
-    }
-    else if (msdk_match(argv[i], "-AdaptiveB:on")) {
-        InputParams.AdaptiveB = MFX_CODINGOPTION_ON;
-    }
-    else if (msdk_match(argv[i], "-AdaptiveB:off")) {
-        InputParams.AdaptiveB = MFX_CODINGOPTION_OFF;
-    }
-    else if (msdk_match(argv[i], "-AdaptiveCQM:on")) {
-        InputParams.AdaptiveCQM = MFX_CODINGOPTION_ON;
-    }
-    else if (msdk_match(argv[i], "-AdaptiveCQM:off")) {
-        InputParams.AdaptiveCQM = MFX_CODINGOPTION_OFF;
-    }
     else if (msdk_match(argv[i], "-iGfx")) {
         InputParams.adapterType = mfxMediaAdapterType::MFX_MEDIA_INTEGRATED;
 #if (defined(_WIN32) || defined(_WIN64))
@@ -1635,13 +1687,6 @@ mfxStatus ParseAdditionalParams(char* argv[],
         InputParams.bPreferdGfx = true;
 #endif
     }
-    else if (msdk_match(argv[i], "-AdapterNum")) {
-        VAL_CHECK(i + 1 >= argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.adapterNum)) {
-            PrintError("Value of -AdapterNum is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
     else if (msdk_match(argv[i], "-tcbrctestfile")) {
         VAL_CHECK(i + 1 >= argc, i, argv[i]);
         InputParams.TCBRCFileMode = true;
@@ -1650,15 +1695,6 @@ mfxStatus ParseAdditionalParams(char* argv[],
             return MFX_ERR_UNSUPPORTED;
         }
     }
-    else if (msdk_match(argv[i], "-dispatcher:fullSearch")) {
-        InputParams.dispFullSearch = true;
-    }
-    else if (msdk_match(argv[i], "-dispatcher:lowLatency")) {
-        InputParams.dispFullSearch = false;
-    }
-    else if (msdk_match(argv[i], "-dec::sys")) {
-        InputParams.DecOutPattern = MFX_IOPATTERN_OUT_SYSTEM_MEMORY;
-    }
 
     else if (msdk_match(argv[i], "-HdrSEI:mdcv")) {
         InputParams.bEnableMDCV = true;
@@ -1829,15 +1865,6 @@ mfxStatus ParseAdditionalParams(char* argv[],
             InputParams.nMemoryModel = GENERAL_ALLOC;
         }
     }
-    else if (msdk_match(argv[i], "-MemModel::GeneralAlloc")) {
-        InputParams.nMemoryModel = GENERAL_ALLOC;
-    }
-    else if (msdk_match(argv[i], "-MemModel::VisibleIntAlloc")) {
-        InputParams.nMemoryModel = VISIBLE_INT_ALLOC;
-    }
-    else if (msdk_match(argv[i], "-MemModel::HiddenIntAlloc")) {
-        InputParams.nMemoryModel = HIDDEN_INT_ALLOC;
-    }
     else if (msdk_match(argv[i], "-AllocPolicy::optimal")) {
         InputParams.AllocPolicy   = MFX_ALLOCATION_OPTIMAL;
         InputParams.useAllocHints = true;
@@ -1850,44 +1877,6 @@ mfxStatus ParseAdditionalParams(char* argv[],
         InputParams.AllocPolicy   = MFX_ALLOCATION_UNLIMITED;
         InputParams.useAllocHints = true;
     }
-    else if (msdk_match(argv[i], "-preallocate")) {
-        VAL_CHECK(i + 1 >= argc, i, argv[i]);
-
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.preallocate)) {
-            PrintError("preallocate param is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
-    else if (msdk_match(argv[i], "-TargetBitDepthLuma")) {
-        VAL_CHECK(i + 1 >= argc, i, argv[i]);
-
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.TargetBitDepthLuma)) {
-            PrintError("TargetBitDepthLuma param is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
-    else if (msdk_match(argv[i], "-TargetBitDepthChroma")) {
-        VAL_CHECK(i + 1 >= argc, i, argv[i]);
-
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.TargetBitDepthChroma)) {
-            PrintError("TargetBitDepthChroma param is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
-    else if (msdk_match(argv[i], "-cs")) {
-        InputParams.CascadeScaler = true;
-    }
-    else if (msdk_match(argv[i], "-trace")) {
-        InputParams.EnableTracing = true;
-    }
-    else if (msdk_match(argv[i], "-trace_buffer_size")) {
-        VAL_CHECK(i + 1 == argc, i, argv[i]);
-        i++;
-        if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.TraceBufferSize)) {
-            PrintError("-trace_buffer_size \"%s\" is invalid", argv[i]);
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
     else if (msdk_match(argv[i], "-trace::E2E")) {
         InputParams.EnableTracing = true;
         InputParams.LatencyType   = SMTTracer::LatencyType::E2E;
@@ -1896,9 +1885,6 @@ mfxStatus ParseAdditionalParams(char* argv[],
         InputParams.EnableTracing = true;
         InputParams.LatencyType   = SMTTracer::LatencyType::ENC;
     }
-    else if (msdk_match(argv[i], "-parallel_encoding")) {
-        InputParams.ParallelEncoding = true;
-    }
 #if (defined(_WIN64) || defined(_WIN32))
     else if (msdk_match(argv[i], "-dual_gfx::on")) {
         InputParams.isDualMode = true;
@@ -1913,13 +1899,6 @@ mfxStatus ParseAdditionalParams(char* argv[],
         InputParams.hyperMode  = MFX_HYPERMODE_ADAPTIVE;
     }
 #endif
-    else if (msdk_match(argv[i], "-idr_interval")) {
-        VAL_CHECK(i + 1 >= argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nIdrInterval)) {
-            PrintError("IdrInterval is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
     else if (msdk_match(argv[i], "-EmbeddedDenoise")) {
         VAL_CHECK(i + 1 >= argc, i, argv[i]);
         if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.EmbeddedDenoiseMode)) {
@@ -1933,55 +1912,6 @@ mfxStatus ParseAdditionalParams(char* argv[],
         }
         InputParams.bEmbeddedDenoiser = true;
     }
-    else if (msdk_match(argv[i], "-MinQPI")) {
-        VAL_CHECK(i + 1 >= argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nMinQPI)) {
-            PrintError("Min Quantizer for I frames is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
-    else if (msdk_match(argv[i], "-MinQPP")) {
-        VAL_CHECK(i + 1 >= argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nMinQPP)) {
-            PrintError("Min Quantizer for P frames is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
-    else if (msdk_match(argv[i], "-MinQPB")) {
-        VAL_CHECK(i + 1 >= argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nMinQPB)) {
-            PrintError("Min Quantizer for B frames is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
-    else if (msdk_match(argv[i], "-MaxQPI")) {
-        VAL_CHECK(i + 1 >= argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nMaxQPI)) {
-            PrintError("Max Quantizer for I frames is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
-    else if (msdk_match(argv[i], "-MaxQPP")) {
-        VAL_CHECK(i + 1 >= argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nMaxQPP)) {
-            PrintError("Max Quantizer for P frames is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
-    else if (msdk_match(argv[i], "-MaxQPB")) {
-        VAL_CHECK(i + 1 >= argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nMaxQPB)) {
-            PrintError("Max Quantizer for B frames is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
-    else if (msdk_match(argv[i], "-NumActiveRefP")) {
-        VAL_CHECK(i + 1 == argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nNumRefActiveP)) {
-            PrintError("Number of active reference frames for P frames \"%s\" is invalid", argv[i]);
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
     else if (msdk_match(argv[i], "-pci")) {
         std::string deviceInfo;
         VAL_CHECK(i + 1 == argc, i, argv[i]);
@@ -2036,54 +1966,6 @@ mfxStatus ParseAdditionalParams(char* argv[],
         }
     }
 #endif
-    else if (msdk_match(argv[i], "-ivf:on")) {
-        InputParams.nIVFHeader = MFX_CODINGOPTION_ON;
-    }
-    else if (msdk_match(argv[i], "-ivf:off")) {
-        InputParams.nIVFHeader = MFX_CODINGOPTION_OFF;
-    }
-    else if (msdk_match(argv[i], "-msb10")) {
-        InputParams.IsSourceMSB = true;
-    }
-    else if (msdk_match(argv[i], "-syncop_timeout")) {
-        VAL_CHECK(i + 1 == argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nSyncOpTimeout)) {
-            PrintError("syncop_timeout is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
-    else if (msdk_match(argv[i], "-api_ver_init::1x")) {
-        InputParams.verSessionInit = API_1X;
-    }
-    else if (msdk_match(argv[i], "-api_ver_init::2x")) {
-        InputParams.verSessionInit = API_2X;
-    }
-#ifdef ONEVPL_EXPERIMENTAL
-    else if (msdk_match(argv[i], "-perc_enc_filter")) {
-        InputParams.PercEncPrefilter = true;
-    }
-    else if (msdk_match(argv[i], "-tune_enc")) {
-        VAL_CHECK(i + 1 == argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.TuneEncodeQuality)) {
-            PrintError("-tune_enc is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
-#endif
-    else if (msdk_match(argv[i], "-ScenarioInfo")) {
-        VAL_CHECK(i + 1 == argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.ScenarioInfo)) {
-            PrintError("-ScenarioInfo option is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
-    else if (msdk_match(argv[i], "-ContentInfo")) {
-        VAL_CHECK(i + 1 == argc, i, argv[i]);
-        if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.ContentInfo)) {
-            PrintError("-ContentInfo option is invalid");
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
 #ifdef ONEVPL_EXPERIMENTAL
     else if (msdk_match(argv[i], "-cfg::dec")) {
         VAL_CHECK(i + 1 == argc, i, argv[i]);
@@ -2134,14 +2016,6 @@ mfxStatus ParseAdditionalParams(char* argv[],
         }
         i += 1;
     }
-    else if (msdk_match(argv[i], "-exactNframe")) {
-        VAL_CHECK(i + 1 == argc, i, argv[i]);
-        i++;
-        if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.ExactNframe)) {
-            PrintError("-exactNframe %s is invalid", argv[i]);
-            return MFX_ERR_UNSUPPORTED;
-        }
-    }
     else {
         // no matching argument was found
         return MFX_ERR_NOT_FOUND;
@@ -2360,48 +2234,448 @@ mfxStatus ParseVPPCmdLine(char* argv[],
     return MFX_ERR_MORE_DATA;
 }
 
-mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, char* argv[]) {
-    mfxStatus sts           = MFX_ERR_NONE;
-    mfxStatus stsExtBuf     = MFX_ERR_NONE;
-    mfxStatus stsAddlParams = MFX_ERR_NONE;
-    mfxU32 skipped          = 0;
-
-    // save original cmd line for debug purpose
-    std::stringstream cmd;
-    for (mfxU32 i = 0; i < argc; i++)
-        cmd << argv[i] << " ";
-    session_descriptions.push_back(cmd.str());
-
-    TranscodingSample::sInputParams InputParams;
-    if (m_nTimeout)
-        InputParams.nTimeout = m_nTimeout;
-    if (bRobustFlag)
-        InputParams.bRobustFlag = true;
-    if (bSoftRobustFlag)
-        InputParams.bSoftRobustFlag = true;
+// Option of a session that stores its value, or a constant, in one field of sInputParams
+struct SessionOption {
+    // 1 if the option takes a value, 0 for flags
+    mfxU32 NumArgs;
+    std::function<mfxStatus(char* value, TranscodingSample::sInputParams& params)> Apply;
+};
 
-    InputParams.shouldUseGreedyFormula = shouldUseGreedyFormula;
+template <typename T>
+static SessionOption ValueOption(T TranscodingSample::sInputParams::*field, const char* error) {
+    return { 1, [field, error](char* value, TranscodingSample::sInputParams& params) {
+                if (MFX_ERR_NONE != msdk_opt_read(value, params.*field)) {
+                    PrintError(error, value);
+                    return MFX_ERR_UNSUPPORTED;
+                }
+                return MFX_ERR_NONE;
+            } };
+}
 
-    InputParams.statisticsWindowSize = statisticsWindowSize;
-    InputParams.statisticsLogFile    = statisticsLogFile;
+template <typename T, typename V>
+static SessionOption FlagOption(T TranscodingSample::sInputParams::*field, V value) {
+    return { 0, [field, value](char*, TranscodingSample::sInputParams& params) {
+                params.*field = value;
+                return MFX_ERR_NONE;
+            } };
+}
 
-    //bind to a dump-log-file name
-    InputParams.DumpLogFileName = DumpLogFileName;
+// FNV-1a of the option name, keys are compared without making std::string out of them
+struct OptionNameHash {
+    size_t operator()(const char* name) const {
+        mfxU32 hash = 2166136261u;
+        for (; *name; name++)
+            hash = (hash ^ (mfxU8)*name) * 16777619u;
+        return hash;
+    }
+};
 
-    if (msdk_match(argv[0], "set")) {
-        if (argc != 3) {
-            printf("error: number of arguments for 'set' options is wrong");
-            return MFX_ERR_UNSUPPORTED;
-        }
-        sts = ParseOption__set(argv[1], argv[2]);
-        return sts;
+struct OptionNameEqual {
+    bool operator()(const char* left, const char* right) const {
+        return strcmp(left, right) == 0;
     }
-    // default implementation
-    InputParams.libType = MFX_IMPL_HARDWARE_ANY;
-#if defined(_WIN32) || defined(_WIN64)
-    InputParams.libType = MFX_IMPL_HARDWARE_ANY | MFX_IMPL_VIA_D3D11;
-#endif
-    InputParams.eModeExt = Native;
+};
+
+// Most options of a session are found with one hash lookup instead of walking the if/else chains
+// of ParseParamsForOneSession and ParseAdditionalParams, which add up in par files with thousands
+// of sessions. Options doing more than setting a field stay in the chains.
+static const SessionOption* FindSessionOption(const char* name) {
+    // initialization of the static is thread safe, par file lines may be parsed in parallel
+    static const std::unordered_map<const char*, SessionOption, OptionNameHash, OptionNameEqual>
+        options = {
+            { "-roi_qpmap", FlagOption(&sInputParams::bROIasQPMAP, true) },
+            { "-extmbqp", FlagOption(&sInputParams::bExtMBQP, true) },
+            { "-sw", FlagOption(&sInputParams::libType, MFX_IMPL_SOFTWARE) },
+            { "-robust", FlagOption(&sInputParams::bRobustFlag, true) },
+            { "-robust:soft", FlagOption(&sInputParams::bSoftRobustFlag, true) },
+            { "-threads", ValueOption(&sInputParams::nThreadsNum, "Threads number is invalid") },
+            { "-fe", ValueOption(&sInputParams::dVPPOutFramerate, "FrameRate \"%s\" is invalid") },
+            { "-fps",
+              { 1,
+                [](char* value, TranscodingSample::sInputParams& params) {
+                    if (MFX_ERR_NONE != ParseFrameRate(value, params.nFPS, params.nFPSDenom)) {
+                        PrintError("FPS limit \"%s\" is invalid", value);
+                        return MFX_ERR_UNSUPPORTED;
+                    }
+                    return MFX_ERR_NONE;
+                } } },
+            { "-b", ValueOption(&sInputParams::nBitRate, "BitRate \"%s\" is invalid") },
+            { "-bm",
+              ValueOption(&sInputParams::nBitRateMultiplier,
+                          "Bitrate multiplier \"%s\" is invalid") },
+            { "-wb",
+              ValueOption(&sInputParams::WinBRCMaxAvgKbps,
+                          "Maximum bitrate for sliding window \"%s\" is invalid") },
+            { "-ws",
+              ValueOption(&sInputParams::WinBRCSize, "Sliding window size \"%s\" is invalid") },
+            { "-hrd",
+              ValueOption(&sInputParams::BufferSizeInKB, "Frame buffer size \"%s\" is invalid") },
+            { "-dist",
+              ValueOption(&sInputParams::GopRefDist, "GOP reference distance \"%s\" is invalid") },
+            { "-gop_size", ValueOption(&sInputParams::GopPicSize, "GOP size \"%s\" is invalid") },
+            { "-num_ref",
+              ValueOption(&sInputParams::NumRefFrame,
+                          "Number of reference frames \"%s\" is invalid") },
+            { "-trows",
+              ValueOption(&sInputParams::nEncTileRows,
+                          "Encoding tile row count \"%s\" is invalid") },
+            { "-tcols",
+              ValueOption(&sInputParams::nEncTileCols,
+                          "Encoding tile column count \"%s\" is invalid") },
+            { "-CodecLevel",
+              ValueOption(&sInputParams::CodecLevel, "CodecLevel \"%s\" is invalid") },
+            { "-CodecProfile",
+              ValueOption(&sInputParams::CodecProfile, "CodecProfile \"%s\" is invalid") },
+            { "-MaxKbps", ValueOption(&sInputParams::MaxKbps, "MaxKbps \"%s\" is invalid") },
+            { "-InitialDelayInKB",
+              ValueOption(&sInputParams::InitialDelayInKB, "InitialDelayInKB \"%s\" is invalid") },
+            { "-GopOptFlag:closed", FlagOption(&sInputParams::GopOptFlag, MFX_GOP_CLOSED) },
+            { "-GopOptFlag:strict", FlagOption(&sInputParams::GopOptFlag, MFX_GOP_STRICT) },
+            { "-bref", FlagOption(&sInputParams::nBRefType, MFX_B_REF_PYRAMID) },
+            { "-nobref", FlagOption(&sInputParams::nBRefType, MFX_B_REF_OFF) },
+            { "-gpb:on", FlagOption(&sInputParams::GPB, MFX_CODINGOPTION_ON) },
+            { "-gpb:off", FlagOption(&sInputParams::GPB, MFX_CODINGOPTION_OFF) },
+            { "-TransformSkip:on", FlagOption(&sInputParams::nTransformSkip, MFX_CODINGOPTION_ON) },
+            { "-TransformSkip:off",
+              FlagOption(&sInputParams::nTransformSkip, MFX_CODINGOPTION_OFF) },
+            { "-WeightedPred::default",
+              FlagOption(&sInputParams::WeightedPred, MFX_WEIGHTED_PRED_DEFAULT) },
+            { "-WeightedPred::implicit",
+              FlagOption(&sInputParams::WeightedPred, MFX_WEIGHTED_PRED_IMPLICIT) },
+            { "-WeightedBiPred::default",
+              FlagOption(&sInputParams::WeightedBiPred, MFX_WEIGHTED_PRED_DEFAULT) },
+            { "-WeightedBiPred::implicit",
+              FlagOption(&sInputParams::WeightedBiPred, MFX_WEIGHTED_PRED_IMPLICIT) },
+            { "-q", ValueOption(&sInputParams::nQuality, " \"%s\" quality is invalid") },
+            { "-w", ValueOption(&sInputParams::nDstWidth, "width \"%s\" is invalid") },
+            { "-h", ValueOption(&sInputParams::nDstHeight, "height \"%s\" is invalid") },
+            { "-l", ValueOption(&sInputParams::nSlices, "numSlices \"%s\" is invalid") },
+            { "-mss", ValueOption(&sInputParams::nMaxSliceSize, "maxSliceSize \"%s\" is invalid") },
+            { "-async", ValueOption(&sInputParams::nAsyncDepth, "async \"%s\" is invalid") },
+            { "-join", FlagOption(&sInputParams::bIsJoin, true) },
+            { "-priority", ValueOption(&sInputParams::priority, "priority \"%s\" is invalid") },
+#if defined(LIBVA_X11_SUPPORT)
+            { "-rx11", FlagOption(&sInputParams::libvaBackend, MFX_LIBVA_X11) },
+#endif
+            { "-vpp::sys",
+              FlagOption(&sInputParams::VppOutPattern, MFX_IOPATTERN_OUT_SYSTEM_MEMORY) },
+            { "-vpp::vid",
+              FlagOption(&sInputParams::VppOutPattern, MFX_IOPATTERN_OUT_VIDEO_MEMORY) },
+            { "-vpp_comp_tile_id",
+              ValueOption(&sInputParams::nVppCompTileId, "-vpp_comp_tile_id %s is invalid") },
+            { "-dec_postproc", FlagOption(&sInputParams::bDecoderPostProcessing, true) },
+            { "-n", ValueOption(&sInputParams::MaxFrameNumber, "-n %s is invalid") },
+            { "-prolong", ValueOption(&sInputParams::prolonged, "-prolong %s is invalid") },
+            { "-mfe_frames",
+              ValueOption(&sInputParams::numMFEFrames, "-mfe_frames %s num frames is invalid") },
+            { "-mfe_mode", ValueOption(&sInputParams::MFMode, "-mfe_mode %s is invalid") },
+            { "-mfe_timeout",
+              ValueOption(&sInputParams::mfeTimeout, "-mfe_timeout %s is invalid") },
+            { "-dump", ValueOption(&sInputParams::dump_file, "Dump file name \"%s\" is invalid") },
+            { "-la_ext", FlagOption(&sInputParams::bEnableExtLA, true) },
+            { "-vbr", FlagOption(&sInputParams::nRateControlMethod, MFX_RATECONTROL_VBR) },
+            { "-cbr", FlagOption(&sInputParams::nRateControlMethod, MFX_RATECONTROL_CBR) },
+            { "-bpyr", FlagOption(&sInputParams::bEnableBPyramid, true) },
+            { "-vcm", FlagOption(&sInputParams::nRateControlMethod, MFX_RATECONTROL_VCM) },
+            { "-lad", ValueOption(&sInputParams::nLADepth, "look ahead depth \"%s\" is invalid") },
+            { "-override_decoder_framerate",
+              ValueOption(&sInputParams::dDecoderFrameRateOverride,
+                          "Framerate \"%s\" is invalid") },
+            { "-override_encoder_framerate",
+              ValueOption(&sInputParams::dEncoderFrameRateOverride,
+                          "Framerate \"%s\" is invalid") },
+            { "-override_encoder_picstruct",
+              ValueOption(&sInputParams::EncoderPicstructOverride, "Picstruct \"%s\" is invalid") },
+            { "-gpucopy::on", FlagOption(&sInputParams::nGpuCopyMode, MFX_GPUCOPY_ON) },
+            { "-gpucopy::off", FlagOption(&sInputParams::nGpuCopyMode, MFX_GPUCOPY_OFF) },
+            { "-repartitioncheck::on",
+              FlagOption(&sInputParams::RepartitionCheckMode, MFX_CODINGOPTION_ON) },
+            { "-repartitioncheck::off",
+              FlagOption(&sInputParams::RepartitionCheckMode, MFX_CODINGOPTION_OFF) },
+            { "-cqp", FlagOption(&sInputParams::nRateControlMethod, MFX_RATECONTROL_CQP) },
+            { "-qpi", ValueOption(&sInputParams::nQPI, "Quantizer for I frames is invalid") },
+            { "-qpp", ValueOption(&sInputParams::nQPP, "Quantizer for P frames is invalid") },
+            { "-qpb", ValueOption(&sInputParams::nQPB, "Quantizer for B frames is invalid") },
+            { "-DisableQPOffset", FlagOption(&sInputParams::bDisableQPOffset, true) },
+            { "-qsv-ff", FlagOption(&sInputParams::enableQSVFF, true) },
+            { "-single_texture_d3d11", FlagOption(&sInputParams::bSingleTexture, true) },
+            { "-extbrc::on", FlagOption(&sInputParams::nExtBRC, TranscodingSample::EXTBRC_ON) },
+            { "-extbrc::off", FlagOption(&sInputParams::nExtBRC, TranscodingSample::EXTBRC_OFF) },
+            { "-extbrc::implicit",
+              FlagOption(&sInputParams::nExtBRC, TranscodingSample::EXTBRC_IMPLICIT) },
+            { "-ExtBrcAdaptiveLTR:on",
+              FlagOption(&sInputParams::ExtBrcAdaptiveLTR, MFX_CODINGOPTION_ON) },
+            { "-ExtBrcAdaptiveLTR:off",
+              FlagOption(&sInputParams::ExtBrcAdaptiveLTR, MFX_CODINGOPTION_OFF) },
+            { "-pp", FlagOption(&sInputParams::shouldPrintPresets, true) },
+            { "-forceSyncAllSession:on",
+              FlagOption(&sInputParams::forceSyncAllSession, MFX_CODINGOPTION_ON) },
+            { "-forceSyncAllSession:off",
+              FlagOption(&sInputParams::forceSyncAllSession, MFX_CODINGOPTION_OFF) },
+            { "-ir_type", ValueOption(&sInputParams::IntRefType, "Intra refresh type is invalid") },
+            { "-ir_cycle_size",
+              ValueOption(&sInputParams::IntRefCycleSize,
+                          "IR refresh cycle size param is invalid") },
+            { "-ir_qp_delta",
+              ValueOption(&sInputParams::IntRefQPDelta, "IR QP delta param is invalid") },
+            { "-ir_cycle_dist",
+              ValueOption(&sInputParams::IntRefCycleDist, "IR cycle distance param is invalid") },
+            { "-LowDelayBRC", FlagOption(&sInputParams::LowDelayBRC, MFX_CODINGOPTION_ON) },
+            { "-amfs:on", FlagOption(&sInputParams::nAdaptiveMaxFrameSize, MFX_CODINGOPTION_ON) },
+            { "-amfs:off", FlagOption(&sInputParams::nAdaptiveMaxFrameSize, MFX_CODINGOPTION_OFF) },
+            { "-mfs", ValueOption(&sInputParams::nMaxFrameSize, "MaxFrameSize is invalid") },
+            { "-BaseLayerPID",
+              ValueOption(&sInputParams::nBaseLayerPID, "BaseLayerPID is invalid") },
+            { "-SPSId", ValueOption(&sInputParams::nSPSId, "SPSId is invalid") },
+            { "-PPSId", ValueOption(&sInputParams::nPPSId, "PPSId is invalid") },
+            { "-VuiTC",
+              ValueOption(&sInputParams::nTransferCharacteristics,
+                          "-VuiTC TransferCharacteristics is invalid") },
+            { "-lowpower:on", FlagOption(&sInputParams::enableQSVFF, true) },
+            { "-lowpower:off", FlagOption(&sInputParams::enableQSVFF, false) },
+            { "-PicTimingSEI:on", FlagOption(&sInputParams::nPicTimingSEI, MFX_CODINGOPTION_ON) },
+            { "-PicTimingSEI:off", FlagOption(&sInputParams::nPicTimingSEI, MFX_CODINGOPTION_OFF) },
+            { "-NalHrdConformance:on",
+              FlagOption(&sInputParams::nNalHrdConformance, MFX_CODINGOPTION_ON) },
+            { "-NalHrdConformance:off",
+              FlagOption(&sInputParams::nNalHrdConformance, MFX_CODINGOPTION_OFF) },
+            { "-VuiNalHrdParameters:on",
+              FlagOption(&sInputParams::nVuiNalHrdParameters, MFX_CODINGOPTION_ON) },
+            { "-VuiNalHrdParameters:off",
+              FlagOption(&sInputParams::nVuiNalHrdParameters, MFX_CODINGOPTION_OFF) },
+            { "-BitrateLimit:on", FlagOption(&sInputParams::BitrateLimit, MFX_CODINGOPTION_ON) },
+            { "-BitrateLimit:off", FlagOption(&sInputParams::BitrateLimit, MFX_CODINGOPTION_OFF) },
+            { "-AdaptiveI:on", FlagOption(&sInputParams::AdaptiveI, MFX_CODINGOPTION_ON) },
+            { "-AdaptiveI:off", FlagOption(&sInputParams::AdaptiveI, MFX_CODINGOPTION_OFF) },
+            { "-AdaptiveB:on", FlagOption(&sInputParams::AdaptiveB, MFX_CODINGOPTION_ON) },
+            { "-AdaptiveB:off", FlagOption(&sInputParams::AdaptiveB, MFX_CODINGOPTION_OFF) },
+            { "-AdaptiveCQM:on", FlagOption(&sInputParams::AdaptiveCQM, MFX_CODINGOPTION_ON) },
+            { "-AdaptiveCQM:off", FlagOption(&sInputParams::AdaptiveCQM, MFX_CODINGOPTION_OFF) },
+            { "-AdapterNum",
+              ValueOption(&sInputParams::adapterNum, "Value of -AdapterNum is invalid") },
+            { "-dispatcher:fullSearch", FlagOption(&sInputParams::dispFullSearch, true) },
+            { "-dispatcher:lowLatency", FlagOption(&sInputParams::dispFullSearch, false) },
+            { "-dec::sys",
+              FlagOption(&sInputParams::DecOutPattern, MFX_IOPATTERN_OUT_SYSTEM_MEMORY) },
+            { "-MemModel::GeneralAlloc", FlagOption(&sInputParams::nMemoryModel, GENERAL_ALLOC) },
+            { "-MemModel::VisibleIntAlloc",
+              FlagOption(&sInputParams::nMemoryModel, VISIBLE_INT_ALLOC) },
+            { "-MemModel::HiddenIntAlloc",
+              FlagOption(&sInputParams::nMemoryModel, HIDDEN_INT_ALLOC) },
+            { "-preallocate",
+              ValueOption(&sInputParams::preallocate, "preallocate param is invalid") },
+            { "-TargetBitDepthLuma",
+              ValueOption(&sInputParams::TargetBitDepthLuma,
+                          "TargetBitDepthLuma param is invalid") },
+            { "-TargetBitDepthChroma",
+              ValueOption(&sInputParams::TargetBitDepthChroma,
+                          "TargetBitDepthChroma param is invalid") },
+            { "-cs", FlagOption(&sInputParams::CascadeScaler, true) },
+            { "-cs_priority",
+              ValueOption(&sInputParams::CascadePriority, "-cs_priority \"%s\" is invalid") },
+            { "-cs_latency",
+              ValueOption(&sInputParams::CascadeLatencyBudget, "-cs_latency \"%s\" is invalid") },
+            { "-trace", FlagOption(&sInputParams::EnableTracing, true) },
+            { "-trace_buffer_size",
+              ValueOption(&sInputParams::TraceBufferSize, "-trace_buffer_size \"%s\" is invalid") },
+            { "-parallel_encoding", FlagOption(&sInputParams::ParallelEncoding, true) },
+            { "-idr_interval", ValueOption(&sInputParams::nIdrInterval, "IdrInterval is invalid") },
+            { "-MinQPI",
+              ValueOption(&sInputParams::nMinQPI, "Min Quantizer for I frames is invalid") },
+            { "-MinQPP",
+              ValueOption(&sInputParams::nMinQPP, "Min Quantizer for P frames is invalid") },
+            { "-MinQPB",
+              ValueOption(&sInputParams::nMinQPB, "Min Quantizer for B frames is invalid") },
+            { "-MaxQPI",
+              ValueOption(&sInputParams::nMaxQPI, "Max Quantizer for I frames is invalid") },
+            { "-MaxQPP",
+              ValueOption(&sInputParams::nMaxQPP, "Max Quantizer for P frames is invalid") },
+            { "-MaxQPB",
+              ValueOption(&sInputParams::nMaxQPB, "Max Quantizer for B frames is invalid") },
+            { "-NumActiveRefP",
+              ValueOption(&sInputParams::nNumRefActiveP,
+                          "Number of active reference frames for P frames \"%s\" is invalid") },
+            { "-ivf:on", FlagOption(&sInputParams::nIVFHeader, MFX_CODINGOPTION_ON) },
+            { "-ivf:off", FlagOption(&sInputParams::nIVFHeader, MFX_CODINGOPTION_OFF) },
+            { "-msb10", FlagOption(&sInputParams::IsSourceMSB, true) },
+            { "-syncop_timeout",
+              ValueOption(&sInputParams::nSyncOpTimeout, "syncop_timeout is invalid") },
+            { "-api_ver_init::1x", FlagOption(&sInputParams::verSessionInit, API_1X) },
+            { "-api_ver_init::2x", FlagOption(&sInputParams::verSessionInit, API_2X) },
+#ifdef ONEVPL_EXPERIMENTAL
+            { "-perc_enc_filter", FlagOption(&sInputParams::PercEncPrefilter, true) },
+            { "-tune_enc", ValueOption(&sInputParams::TuneEncodeQuality, "-tune_enc is invalid") },
+#endif
+            { "-ScenarioInfo",
+              ValueOption(&sInputParams::ScenarioInfo, "-ScenarioInfo option is invalid") },
+            { "-ContentInfo",
+              ValueOption(&sInputParams::ContentInfo, "-ContentInfo option is invalid") },
+            { "-exactNframe",
+              ValueOption(&sInputParams::ExactNframe, "-exactNframe %s is invalid") },
+        };
+
+    auto it = options.find(name);
+    return (it != options.end()) ? &it->second : nullptr;
+}
+
+// Original command line of a session, kept for debug purpose
+static std::string DescribeSession(mfxU32 argc, char* argv[]) {
+    size_t length = 0;
+    for (mfxU32 i = 0; i < argc; i++)
+        length += strlen(argv[i]) + 1;
+
+    std::string description;
+    description.reserve(length);
+    for (mfxU32 i = 0; i < argc; i++) {
+        description += argv[i];
+        description += ' ';
+    }
+    return description;
+}
+
+mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, char* argv[]) {
+    mfxStatus sts = MFX_ERR_NONE;
+
+    session_descriptions.push_back(DescribeSession(argc, argv));
+
+    if (msdk_match(argv[0], "set")) {
+        if (argc != 3) {
+            printf("error: number of arguments for 'set' options is wrong");
+            return MFX_ERR_UNSUPPORTED;
+        }
+        sts = ParseOption__set(argv[1], argv[2]);
+        return sts;
+    }
+
+    TranscodingSample::sInputParams InputParams;
+    bool hasSession = false;
+    sts = ParseSessionOptions(argc, argv, InputParams, performance_file_name, hasSession);
+    if (sts != MFX_ERR_NONE)
+        return sts;
+
+    return hasSession ? AddSession(InputParams) : MFX_ERR_NONE;
+}
+
+mfxStatus CmdProcessor::AddSession(TranscodingSample::sInputParams& InputParams) {
+    mfxStatus sts = VerifyAndCorrectInputParams(InputParams);
+    MSDK_CHECK_STATUS(sts, "VerifyAndCorrectInputParams failed");
+    m_SessionArray.push_back(std::move(InputParams));
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CmdProcessor::ParseParLines(const std::vector<std::string>& lines) {
+    struct ParsedLine {
+        // set lines and lines without arguments are left to TokenizeLine
+        bool Deferred    = false;
+        mfxStatus Status = MFX_ERR_NONE;
+        std::string Description;
+        std::string PerformanceFile;
+        bool HasSession = false;
+        TranscodingSample::sInputParams Params;
+    };
+
+    std::vector<ParsedLine> parsed(lines.size());
+    std::atomic<size_t> next(0);
+    const std::string performanceFile = performance_file_name;
+
+    auto parseLines = [&]() {
+        std::vector<char> buffer;
+        std::vector<char*> argv;
+        for (size_t k = next++; k < lines.size(); k = next++) {
+            ParsedLine& line = parsed[k];
+            split_cmd(lines[k], buffer, argv);
+            if (argv.empty() || msdk_match(argv[0], "set")) {
+                line.Deferred = true;
+                continue;
+            }
+
+            line.Description     = DescribeSession((mfxU32)argv.size(), argv.data());
+            line.PerformanceFile = performanceFile;
+            line.Status          = ParseSessionOptions((mfxU32)argv.size(),
+                                                       argv.data(),
+                                                       line.Params,
+                                                       line.PerformanceFile,
+                                                       line.HasSession);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min<size_t>(m_nParThreads, lines.size()); i++)
+        workers.emplace_back(parseLines);
+    parseLines();
+    for (auto& worker : workers)
+        worker.join();
+
+    // results are taken in the order of the lines, as if they were parsed one by one
+    for (size_t k = 0; k < lines.size(); k++) {
+        ParsedLine& line = parsed[k];
+        mfxStatus sts    = MFX_ERR_NONE;
+
+        if (line.Deferred) {
+            sts = TokenizeLine(lines[k]);
+            MSDK_CHECK_STATUS(sts, "TokenizeLine failed");
+            continue;
+        }
+
+        session_descriptions.push_back(std::move(line.Description));
+        sts = line.Status;
+        if (sts == MFX_ERR_NONE && line.PerformanceFile != performanceFile) {
+            // -p of an earlier line
+            if (!performance_file_name.empty()) {
+                printf("error: only one performance file is supported");
+                sts = MFX_ERR_UNSUPPORTED;
+            }
+            performance_file_name = line.PerformanceFile;
+        }
+        if (sts == MFX_ERR_NONE && line.HasSession)
+            sts = AddSession(line.Params);
+        MSDK_CHECK_STATUS(sts, "TokenizeLine failed");
+    }
+
+    return MFX_ERR_NONE;
+}
+
+std::shared_ptr<const ROIFile> CmdProcessor::OpenROIFile(const std::string& fileName) const {
+    // the lock is held while a file is indexed, so parallel par file lines index it only once
+    std::lock_guard<std::mutex> lock(m_ROIFilesMutex);
+    std::shared_ptr<const ROIFile>& file = m_ROIFiles[fileName];
+    if (!file)
+        file = ROIFile::Open(fileName);
+    return file;
+}
+
+mfxStatus CmdProcessor::ParseSessionOptions(mfxU32 argc,
+                                            char* argv[],
+                                            TranscodingSample::sInputParams& InputParams,
+                                            std::string& performanceFile,
+                                            bool& hasSession) const {
+    mfxStatus sts                = MFX_ERR_NONE;
+    mfxStatus stsExtBuf          = MFX_ERR_NONE;
+    mfxStatus stsAddlParams      = MFX_ERR_NONE;
+    mfxU32 skipped               = 0;
+    const SessionOption* pOption = nullptr;
+
+    if (m_nTimeout)
+        InputParams.nTimeout = m_nTimeout;
+    if (bRobustFlag)
+        InputParams.bRobustFlag = true;
+    if (bSoftRobustFlag)
+        InputParams.bSoftRobustFlag = true;
+
+    InputParams.shouldUseGreedyFormula = shouldUseGreedyFormula;
+
+    InputParams.statisticsWindowSize = statisticsWindowSize;
+    InputParams.statisticsLogFile    = statisticsLogFile;
+
+    //bind to a dump-log-file name
+    InputParams.DumpLogFileName = DumpLogFileName;
+
+    // default implementation
+    InputParams.libType = MFX_IMPL_HARDWARE_ANY;
+#if defined(_WIN32) || defined(_WIN64)
+    InputParams.libType = MFX_IMPL_HARDWARE_ANY | MFX_IMPL_VIA_D3D11;
+#endif
+    InputParams.eModeExt = Native;
 
     for (mfxU32 i = 0; i < argc; i++) {
         // process multi-character options
@@ -2458,327 +2732,201 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, char* argv[]) {
                 InputParams.bIsMVC   = true;
             }
         }
-        else if (msdk_match(argv[i], "-roi_file")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-
-            std::string strRoiFile;
-            msdk_opt_read(argv[i], strRoiFile);
-
-            if (!ParseROIFile(strRoiFile, InputParams.m_ROIData)) {
-                PrintError("Incorrect ROI file: \"%s\" ", strRoiFile.c_str());
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
-        else if (msdk_match(argv[i], "-p")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-
-            if (!performance_file_name.empty()) {
-                printf("error: only one performance file is supported");
-                return MFX_ERR_UNSUPPORTED;
-            }
-
-            if (!argv[i]) {
-                printf("error: no argument given for '-p' option\n");
-                return MFX_ERR_UNSUPPORTED;
-            }
-            performance_file_name = std::string(argv[i]);
-        }
-        else if (msdk_match(argv[i], "-roi_qpmap")) {
-            InputParams.bROIasQPMAP = true;
-        }
-        else if (msdk_match(argv[i], "-extmbqp")) {
-            InputParams.bExtMBQP = true;
-        }
-        else if (msdk_match(argv[i], "-sw")) {
-            InputParams.libType = MFX_IMPL_SOFTWARE;
-        }
-        else if (msdk_match(argv[i], "-hw")) {
-#if defined(_WIN32) || defined(_WIN64)
-            InputParams.libType = MFX_IMPL_HARDWARE_ANY | MFX_IMPL_VIA_D3D11;
-#elif defined(LIBVA_SUPPORT)
-            InputParams.libType = MFX_IMPL_HARDWARE_ANY;
-#endif
-        }
-        else if (msdk_match(argv[i], "-hw_d3d11")) {
-            InputParams.libType = MFX_IMPL_HARDWARE_ANY | MFX_IMPL_VIA_D3D11;
-        }
-        else if (msdk_match(argv[i], "-hw_d3d9")) {
-            InputParams.libType = MFX_IMPL_HARDWARE_ANY | MFX_IMPL_VIA_D3D9;
-        }
-#if (defined(LINUX32) || defined(LINUX64))
-        else if (msdk_match(argv[i], "-device")) {
-            if (!InputParams.strDevicePath.empty()) {
-                printf("error: you can specify only one device\n");
-                return MFX_ERR_UNSUPPORTED;
-            }
-
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            InputParams.strDevicePath = argv[++i];
-
-            size_t pos = InputParams.strDevicePath.find("renderD");
-            if (pos != std::string::npos) {
-                InputParams.DRMRenderNodeNum =
-                    std::stoi(InputParams.strDevicePath.substr(pos + 7, 3));
+        else if ((pOption = FindSessionOption(argv[i])) != nullptr) {
+            if (pOption->NumArgs) {
+                VAL_CHECK(i + 1 == argc, i, argv[i]);
+                i++;
             }
-        }
-#endif
-        else if (msdk_match(argv[i], "-robust")) {
-            InputParams.bRobustFlag = true;
-        }
-        else if (msdk_match(argv[i], "-robust:soft")) {
-            InputParams.bSoftRobustFlag = true;
-        }
-        else if (msdk_match(argv[i], "-threads")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nThreadsNum)) {
-                PrintError("Threads number is invalid");
+            if (MFX_ERR_NONE != pOption->Apply(argv[i], InputParams))
                 return MFX_ERR_UNSUPPORTED;
-            }
         }
-        else if (msdk_match(argv[i], "-f")) {
+        else if (msdk_match(argv[i], "-name")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
-            // Temporary check for giving priority to -fe option
-            if (!InputParams.dVPPOutFramerate) {
-                if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.dVPPOutFramerate)) {
-                    PrintError("FrameRate \"%s\" is invalid", argv[i]);
-                    return MFX_ERR_UNSUPPORTED;
-                }
-            }
+            msdk_opt_read(argv[i], InputParams.SessionName);
         }
-        else if (msdk_match(argv[i], "-fe")) {
+        else if (msdk_match(argv[i], "-cpus")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.dVPPOutFramerate)) {
-                PrintError("FrameRate \"%s\" is invalid", argv[i]);
+            std::vector<mfxU32> cpus;
+            msdk_opt_read(argv[i], InputParams.CpuList);
+            if (!ParseCpuList(InputParams.CpuList, cpus)) {
+                PrintError("-cpus \"%s\" is invalid", argv[i]);
                 return MFX_ERR_UNSUPPORTED;
             }
         }
-        else if (msdk_match(argv[i], "-fps")) {
+        else if (msdk_match(argv[i], "-numa_node")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nFPS)) {
-                PrintError("FPS limit \"%s\" is invalid", argv[i]);
+            mfxU32 node = 0;
+            if (MFX_ERR_NONE != msdk_opt_read(argv[i], node) || node > 4095) {
+                PrintError("-numa_node \"%s\" is invalid", argv[i]);
                 return MFX_ERR_UNSUPPORTED;
             }
+            InputParams.NumaNode = (mfxI32)node;
         }
-        else if (msdk_match(argv[i], "-b")) {
+        else if (msdk_match(argv[i], "-live")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nBitRate)) {
-                PrintError("BitRate \"%s\" is invalid", argv[i]);
+            if (MFX_ERR_NONE != ParseFrameRate(argv[i],
+                                               InputParams.LiveSource.RateN,
+                                               InputParams.LiveSource.RateD)) {
+                PrintError("-live \"%s\" is invalid", argv[i]);
                 return MFX_ERR_UNSUPPORTED;
             }
         }
-        else if (msdk_match(argv[i], "-bm")) {
+        else if (msdk_match(argv[i], "-live_jitter")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nBitRateMultiplier)) {
-                PrintError("Bitrate multiplier \"%s\" is invalid", argv[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.LiveSource.JitterUs)) {
+                PrintError("-live_jitter \"%s\" is invalid", argv[i]);
                 return MFX_ERR_UNSUPPORTED;
             }
         }
-        else if (msdk_match(argv[i], "-wb")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.WinBRCMaxAvgKbps)) {
-                PrintError("Maximum bitrate for sliding window \"%s\" is invalid", argv[i]);
+        else if (msdk_match(argv[i], "-live_burst")) {
+            VAL_CHECK(i + 2 >= argc, i, argv[i]);
+            LiveSourceParams& live = InputParams.LiveSource;
+            if (MFX_ERR_NONE != msdk_opt_read(argv[i + 1], live.BurstInterval) ||
+                MFX_ERR_NONE != msdk_opt_read(argv[i + 2], live.BurstLength) ||
+                live.BurstLength > live.BurstInterval) {
+                PrintError("-live_burst \"%s %s\" is invalid", argv[i + 1], argv[i + 2]);
                 return MFX_ERR_UNSUPPORTED;
             }
+            i += 2;
         }
-        else if (msdk_match(argv[i], "-ws")) {
+        else if (msdk_match(argv[i], "-live_deadline")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.WinBRCSize)) {
-                PrintError("Sliding window size \"%s\" is invalid", argv[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.LiveSource.DeadlineMs)) {
+                PrintError("-live_deadline \"%s\" is invalid", argv[i]);
                 return MFX_ERR_UNSUPPORTED;
             }
         }
-        else if (msdk_match(argv[i], "-hrd")) {
+        else if (msdk_match(argv[i], "-shm_ring")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.BufferSizeInKB)) {
-                PrintError("Frame buffer size \"%s\" is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
-            }
+            msdk_opt_read(argv[i], InputParams.ShmRing.Name);
         }
-        else if (msdk_match(argv[i], "-dist")) {
+        else if (msdk_match(argv[i], "-shm_ring_slots")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.GopRefDist)) {
-                PrintError("GOP reference distance \"%s\" is invalid", argv[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.ShmRing.Slots) ||
+                !InputParams.ShmRing.Slots) {
+                PrintError("-shm_ring_slots \"%s\" is invalid", argv[i]);
                 return MFX_ERR_UNSUPPORTED;
             }
         }
-        else if (msdk_match(argv[i], "-gop_size")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.GopPicSize)) {
-                PrintError("GOP size \"%s\" is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
-            }
+        else if (msdk_match(argv[i], "-shm_ring_drop")) {
+            InputParams.ShmRing.Policy = SHM_RING_DROP;
         }
-        else if (msdk_match(argv[i], "-num_ref")) {
+        else if (msdk_match(argv[i], "-roi_file")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.NumRefFrame)) {
-                PrintError("Number of reference frames \"%s\" is invalid", argv[i]);
+
+            std::string strRoiFile;
+            msdk_opt_read(argv[i], strRoiFile);
+
+            InputParams.m_ROIFile = OpenROIFile(strRoiFile);
+            if (!InputParams.m_ROIFile) {
+                PrintError("Incorrect ROI file: \"%s\" ", strRoiFile.c_str());
                 return MFX_ERR_UNSUPPORTED;
             }
         }
-        else if (msdk_match(argv[i], "-trows")) {
+        else if (msdk_match(argv[i], "-p")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nEncTileRows)) {
-                PrintError("Encoding tile row count \"%s\" is invalid", argv[i]);
+
+            if (!performanceFile.empty()) {
+                printf("error: only one performance file is supported");
                 return MFX_ERR_UNSUPPORTED;
             }
-        }
-        else if (msdk_match(argv[i], "-tcols")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nEncTileCols)) {
-                PrintError("Encoding tile column count \"%s\" is invalid", argv[i]);
+
+            if (!argv[i]) {
+                printf("error: no argument given for '-p' option\n");
                 return MFX_ERR_UNSUPPORTED;
             }
+            performanceFile = std::string(argv[i]);
         }
-        else if (msdk_match(argv[i], "-CodecLevel")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.CodecLevel)) {
-                PrintError("CodecLevel \"%s\" is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
-            }
+        else if (msdk_match(argv[i], "-hw")) {
+#if defined(_WIN32) || defined(_WIN64)
+            InputParams.libType = MFX_IMPL_HARDWARE_ANY | MFX_IMPL_VIA_D3D11;
+#elif defined(LIBVA_SUPPORT)
+            InputParams.libType = MFX_IMPL_HARDWARE_ANY;
+#endif
         }
-        else if (msdk_match(argv[i], "-CodecProfile")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.CodecProfile)) {
-                PrintError("CodecProfile \"%s\" is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
-            }
+        else if (msdk_match(argv[i], "-hw_d3d11")) {
+            InputParams.libType = MFX_IMPL_HARDWARE_ANY | MFX_IMPL_VIA_D3D11;
         }
-        else if (msdk_match(argv[i], "-MaxKbps")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.MaxKbps)) {
-                PrintError("MaxKbps \"%s\" is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
-            }
+        else if (msdk_match(argv[i], "-hw_d3d9")) {
+            InputParams.libType = MFX_IMPL_HARDWARE_ANY | MFX_IMPL_VIA_D3D9;
         }
-        else if (msdk_match(argv[i], "-InitialDelayInKB")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.InitialDelayInKB)) {
-                PrintError("InitialDelayInKB \"%s\" is invalid", argv[i]);
+#if (defined(LINUX32) || defined(LINUX64))
+        else if (msdk_match(argv[i], "-device")) {
+            if (!InputParams.strDevicePath.empty()) {
+                printf("error: you can specify only one device\n");
                 return MFX_ERR_UNSUPPORTED;
             }
-        }
-        else if (msdk_match(argv[i], "-GopOptFlag:closed")) {
-            InputParams.GopOptFlag = MFX_GOP_CLOSED;
-        }
-        else if (msdk_match(argv[i], "-GopOptFlag:strict")) {
-            InputParams.GopOptFlag = MFX_GOP_STRICT;
-        }
-        else if (msdk_match(argv[i], "-bref")) {
-            InputParams.nBRefType = MFX_B_REF_PYRAMID;
-        }
-        else if (msdk_match(argv[i], "-nobref")) {
-            InputParams.nBRefType = MFX_B_REF_OFF;
-        }
-        else if (msdk_match(argv[i], "-gpb:on")) {
-            InputParams.GPB = MFX_CODINGOPTION_ON;
-        }
-        else if (msdk_match(argv[i], "-gpb:off")) {
-            InputParams.GPB = MFX_CODINGOPTION_OFF;
-        }
-        else if (msdk_match(argv[i], "-TransformSkip:on")) {
-            InputParams.nTransformSkip = MFX_CODINGOPTION_ON;
-        }
-        else if (msdk_match(argv[i], "-TransformSkip:off")) {
-            InputParams.nTransformSkip = MFX_CODINGOPTION_OFF;
-        }
-        else if (msdk_match(argv[i], "-u")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            InputParams.nTargetUsage = StrToTargetUsage(argv[i]);
-            if (!InputParams.nTargetUsage) {
-                PrintError(" \"%s\" target usage is invalid. Balanced will be used.", argv[i]);
-                InputParams.nTargetUsage = MFX_TARGETUSAGE_BALANCED;
-            }
-        }
-        else if (msdk_match(argv[i], "-WeightedPred::default")) {
-            InputParams.WeightedPred = MFX_WEIGHTED_PRED_DEFAULT;
-        }
-        else if (msdk_match(argv[i], "-WeightedPred::implicit")) {
-            InputParams.WeightedPred = MFX_WEIGHTED_PRED_IMPLICIT;
-        }
-        else if (msdk_match(argv[i], "-WeightedBiPred::default")) {
-            InputParams.WeightedBiPred = MFX_WEIGHTED_PRED_DEFAULT;
-        }
-        else if (msdk_match(argv[i], "-WeightedBiPred::implicit")) {
-            InputParams.WeightedBiPred = MFX_WEIGHTED_PRED_IMPLICIT;
-        }
-        else if (msdk_match(argv[i], "-q")) {
+
             VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nQuality)) {
-                PrintError(" \"%s\" quality is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
+            InputParams.strDevicePath = argv[++i];
+
+            size_t pos = InputParams.strDevicePath.find("renderD");
+            if (pos != std::string::npos) {
+                InputParams.DRMRenderNodeNum =
+                    std::stoi(InputParams.strDevicePath.substr(pos + 7, 3));
             }
         }
-        else if (msdk_match(argv[i], "-w")) {
+#endif
+        else if (msdk_match(argv[i], "-verify_ref")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nDstWidth)) {
-                PrintError("width \"%s\" is invalid", argv[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.qualityParams.strRefFile)) {
+                PrintError("Reference file name \"%s\" is invalid", argv[i]);
                 return MFX_ERR_UNSUPPORTED;
             }
         }
-        else if (msdk_match(argv[i], "-h")) {
+        else if (msdk_match(argv[i], "-verify_digest")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nDstHeight)) {
-                PrintError("height \"%s\" is invalid", argv[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.qualityParams.strDigestIn)) {
+                PrintError("Digest file name \"%s\" is invalid", argv[i]);
                 return MFX_ERR_UNSUPPORTED;
             }
         }
-        else if (msdk_match(argv[i], "-l")) {
+        else if (msdk_match(argv[i], "-dump_digest")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nSlices)) {
-                PrintError("numSlices \"%s\" is invalid", argv[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.qualityParams.strDigestOut)) {
+                PrintError("Digest file name \"%s\" is invalid", argv[i]);
                 return MFX_ERR_UNSUPPORTED;
             }
         }
-        else if (msdk_match(argv[i], "-mss")) {
+        else if (msdk_match(argv[i], "-verify_threads")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nMaxSliceSize)) {
-                PrintError("maxSliceSize \"%s\" is invalid", argv[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.qualityParams.numThreads)) {
+                PrintError("-verify_threads \"%s\" is invalid", argv[i]);
                 return MFX_ERR_UNSUPPORTED;
             }
         }
-        else if (msdk_match(argv[i], "-async")) {
+        else if (msdk_match(argv[i], "-f")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nAsyncDepth)) {
-                PrintError("async \"%s\" is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
+            // Temporary check for giving priority to -fe option
+            if (!InputParams.dVPPOutFramerate) {
+                if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.dVPPOutFramerate)) {
+                    PrintError("FrameRate \"%s\" is invalid", argv[i]);
+                    return MFX_ERR_UNSUPPORTED;
+                }
             }
         }
-        else if (msdk_match(argv[i], "-join")) {
-            InputParams.bIsJoin = true;
-        }
-        else if (msdk_match(argv[i], "-priority")) {
+        else if (msdk_match(argv[i], "-u")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.priority)) {
-                PrintError("priority \"%s\" is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
+            InputParams.nTargetUsage = StrToTargetUsage(argv[i]);
+            if (!InputParams.nTargetUsage) {
+                PrintError(" \"%s\" target usage is invalid. Balanced will be used.", argv[i]);
+                InputParams.nTargetUsage = MFX_TARGETUSAGE_BALANCED;
             }
         }
         else if (msdk_match(argv[i], "-i::source")) {
@@ -2831,11 +2979,6 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, char* argv[]) {
             i++;
             msdk_opt_read(argv[i], InputParams.strDumpVppCompFile);
         }
-#if defined(LIBVA_X11_SUPPORT)
-        else if (msdk_match(argv[i], "-rx11")) {
-            InputParams.libvaBackend = MFX_LIBVA_X11;
-        }
-#endif
 
 #if defined(LIBVA_WAYLAND_SUPPORT)
         else if (msdk_match(argv[i], "-rwld")) {
@@ -2866,12 +3009,6 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, char* argv[]) {
             }
         }
 #endif
-        else if (msdk_match(argv[i], "-vpp::sys")) {
-            InputParams.VppOutPattern = MFX_IOPATTERN_OUT_SYSTEM_MEMORY;
-        }
-        else if (msdk_match(argv[i], "-vpp::vid")) {
-            InputParams.VppOutPattern = MFX_IOPATTERN_OUT_VIDEO_MEMORY;
-        }
         else if (msdk_match(argv[i], "-vpp_comp_dst_x")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
@@ -2942,37 +3079,10 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, char* argv[]) {
             if (InputParams.eModeExt != VppCompOnly)
                 InputParams.eModeExt = VppCompOnly;
         }
-        else if (msdk_match(argv[i], "-vpp_comp_tile_id")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nVppCompTileId)) {
-                PrintError("-vpp_comp_tile_id %s is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
         else if (msdk_match(argv[i], "-vpp_comp_render")) {
             if (InputParams.eModeExt != VppComp)
                 InputParams.eModeExt = VppComp;
         }
-        else if (msdk_match(argv[i], "-dec_postproc")) {
-            InputParams.bDecoderPostProcessing = true;
-        }
-        else if (msdk_match(argv[i], "-n")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.MaxFrameNumber)) {
-                PrintError("-n %s is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
-        else if (msdk_match(argv[i], "-prolong")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.prolonged)) {
-                PrintError("-prolong %s is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
         else if (msdk_match(argv[i], "-angle")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
@@ -2984,30 +3094,6 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, char* argv[]) {
                 InputParams.strVPPPluginDLLPath = std::string(MSDK_CPU_ROTATE_PLUGIN);
             }
         }
-        else if (msdk_match(argv[i], "-mfe_frames")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.numMFEFrames)) {
-                PrintError("-mfe_frames %s num frames is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
-        else if (msdk_match(argv[i], "-mfe_mode")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.MFMode)) {
-                PrintError("-mfe_mode %s is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
-        else if (msdk_match(argv[i], "-mfe_timeout")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.mfeTimeout)) {
-                PrintError("-mfe_timeout %s is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
         else if (msdk_match(argv[i], "-timeout")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
@@ -3017,50 +3103,16 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, char* argv[]) {
             }
             skipped += 2;
         }
-        else if (msdk_match(argv[i], "-dump")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.dump_file)) {
-                PrintError("Dump file name \"%s\" is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
-        else if (msdk_match(argv[i], "-robust")) {
-            InputParams.bRobustFlag = true;
-        }
         else if (msdk_match(argv[i], "-opencl")) {
             InputParams.strVPPPluginDLLPath = std::string(MSDK_OCL_ROTATE_PLUGIN);
             InputParams.bOpenCL             = true;
         }
 
         // output PicStruct
-        else if (msdk_match(argv[i], "-la_ext")) {
-            InputParams.bEnableExtLA = true;
-        }
         else if (msdk_match(argv[i], "-la")) {
             InputParams.bLABRC             = true;
             InputParams.nRateControlMethod = MFX_RATECONTROL_LA;
         }
-        else if (msdk_match(argv[i], "-vbr")) {
-            InputParams.nRateControlMethod = MFX_RATECONTROL_VBR;
-        }
-        else if (msdk_match(argv[i], "-cbr")) {
-            InputParams.nRateControlMethod = MFX_RATECONTROL_CBR;
-        }
-        else if (msdk_match(argv[i], "-bpyr")) {
-            InputParams.bEnableBPyramid = true;
-        }
-        else if (msdk_match(argv[i], "-vcm")) {
-            InputParams.nRateControlMethod = MFX_RATECONTROL_VCM;
-        }
-        else if (msdk_match(argv[i], "-lad")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nLADepth)) {
-                PrintError("look ahead depth \"%s\" is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
         else if (msdk_match(argv[i], "-pe")) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             InputParams.encoderPluginParams = ParsePluginGuid(argv[i + 1]);
@@ -3079,93 +3131,6 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, char* argv[]) {
             }
             i++;
         }
-        else if (msdk_match(argv[i], "-override_decoder_framerate")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.dDecoderFrameRateOverride)) {
-                PrintError("Framerate \"%s\" is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
-        else if (msdk_match(argv[i], "-override_encoder_framerate")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.dEncoderFrameRateOverride)) {
-                PrintError("Framerate \"%s\" is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
-        else if (msdk_match(argv[i], "-override_encoder_picstruct")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            i++;
-            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.EncoderPicstructOverride)) {
-                PrintError("Picstruct \"%s\" is invalid", argv[i]);
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
-        else if (msdk_match(argv[i], "-gpucopy::on")) {
-            InputParams.nGpuCopyMode = MFX_GPUCOPY_ON;
-        }
-        else if (msdk_match(argv[i], "-gpucopy::off")) {
-            InputParams.nGpuCopyMode = MFX_GPUCOPY_OFF;
-        }
-        else if (msdk_match(argv[i], "-repartitioncheck::on")) {
-            InputParams.RepartitionCheckMode = MFX_CODINGOPTION_ON;
-        }
-        else if (msdk_match(argv[i], "-repartitioncheck::off")) {
-            InputParams.RepartitionCheckMode = MFX_CODINGOPTION_OFF;
-        }
-        else if (msdk_match(argv[i], "-cqp")) {
-            InputParams.nRateControlMethod = MFX_RATECONTROL_CQP;
-        }
-        else if (msdk_match(argv[i], "-qpi")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nQPI)) {
-                PrintError("Quantizer for I frames is invalid");
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
-        else if (msdk_match(argv[i], "-qpp")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nQPP)) {
-                PrintError("Quantizer for P frames is invalid");
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
-        else if (msdk_match(argv[i], "-qpb")) {
-            VAL_CHECK(i + 1 == argc, i, argv[i]);
-            if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nQPB)) {
-                PrintError("Quantizer for B frames is invalid");
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
-        else if (msdk_match(argv[i], "-DisableQPOffset")) {
-            InputParams.bDisableQPOffset = true;
-        }
-        else if (msdk_match(argv[i], "-qsv-ff")) {
-            InputParams.enableQSVFF = true;
-        }
-        else if (msdk_match(argv[i], "-single_texture_d3d11")) {
-            InputParams.bSingleTexture = true;
-        }
-        else if (msdk_match(argv[i], "-extbrc::on")) {
-            InputParams.nExtBRC = EXTBRC_ON;
-        }
-        else if (msdk_match(argv[i], "-extbrc::off")) {
-            InputParams.nExtBRC = EXTBRC_OFF;
-        }
-        else if (msdk_match(argv[i], "-extbrc::implicit")) {
-            InputParams.nExtBRC = EXTBRC_IMPLICIT;
-        }
-        else if (msdk_match(argv[i], "-ExtBrcAdaptiveLTR:on")) {
-            InputParams.ExtBrcAdaptiveLTR = MFX_CODINGOPTION_ON;
-        }
-        else if (msdk_match(argv[i], "-ExtBrcAdaptiveLTR:off")) {
-            InputParams.ExtBrcAdaptiveLTR = MFX_CODINGOPTION_OFF;
-        }
-        else if (msdk_match(argv[i], "-pp")) {
-            InputParams.shouldPrintPresets = true;
-        }
         else if (msdk_match(argv[i], "-preset")) {
             std::string presetName;
             VAL_CHECK(i + 1 >= argc, i, argv[i]);
@@ -3180,60 +3145,6 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, char* argv[]) {
                 return MFX_ERR_UNSUPPORTED;
             }
         }
-        else if (msdk_match(argv[i], "-forceSyncAllSession:on")) {
-            InputParams.forceSyncAllSession = MFX_CODINGOPTION_ON;
-        }
-        else if (msdk_match(argv[i], "-forceSyncAllSession:off")) {
-            InputParams.forceSyncAllSession = MFX_CODINGOPTION_OFF;
-        }
-        else if (msdk_match(argv[i], "-ir_type")) {
-            VAL_CHECK(i + 1 >= argc, i, argv[i]);
-
-            if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.IntRefType)) {
-                PrintError("Intra refresh type is invalid");
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
-        else if (msdk_match(argv[i], "-ir_cycle_size")) {
-            VAL_CHECK(i + 1 >= argc, i, argv[i]);
-
-            if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.IntRefCycleSize)) {
-                PrintError("IR refresh cycle size param is invalid");
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
-        else if (msdk_match(argv[i], "-ir_qp_delta")) {
-            VAL_CHECK(i + 1 >= argc, i, argv[i]);
-
-            if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.IntRefQPDelta)) {
-                PrintError("IR QP delta param is invalid");
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
-        else if (msdk_match(argv[i], "-ir_cycle_dist")) {
-            VAL_CHECK(i + 1 >= argc, i, argv[i]);
-
-            if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.IntRefCycleDist)) {
-                PrintError("IR cycle distance param is invalid");
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
-        else if (msdk_match(argv[i], "-LowDelayBRC")) {
-            InputParams.LowDelayBRC = MFX_CODINGOPTION_ON;
-        }
-        else if (msdk_match(argv[i], "-amfs:on")) {
-            InputParams.nAdaptiveMaxFrameSize = MFX_CODINGOPTION_ON;
-        }
-        else if (msdk_match(argv[i], "-amfs:off")) {
-            InputParams.nAdaptiveMaxFrameSize = MFX_CODINGOPTION_OFF;
-        }
-        else if (msdk_match(argv[i], "-mfs")) {
-            VAL_CHECK(i + 1 >= argc, i, argv[i]);
-            if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nMaxFrameSize)) {
-                PrintError("MaxFrameSize is invalid");
-                return MFX_ERR_UNSUPPORTED;
-            }
-        }
         MOD_SMT_PARSE_INPUT
         else if ((stsExtBuf = ParseVPPCmdLine(argv, argc, i, &InputParams, skipped)) !=
                  MFX_ERR_MORE_DATA) {
@@ -3259,15 +3170,10 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, char* argv[]) {
         }
     }
 
-    if (skipped < argc) {
-        sts = VerifyAndCorrectInputParams(InputParams);
-        MSDK_CHECK_STATUS(sts, "VerifyAndCorrectInputParams failed");
-        m_SessionArray.push_back(InputParams);
-    }
-
+    hasSession = skipped < argc;
     return MFX_ERR_NONE;
 
-} //mfxStatus CmdProcessor::ParseParamsForOneSession(char *pLine, mfxU32 length)
+} //mfxStatus CmdProcessor::ParseSessionOptions(mfxU32 argc, char* argv[], ...)
 
 mfxStatus CmdProcessor::ParseOption__set(char* strCodecType, char* strPluginGuid) {
     mfxU32 codecid = 0;
@@ -3317,6 +3223,19 @@ mfxStatus CmdProcessor::VerifyAndCorrectInputParams(TranscodingSample::sInputPar
         return MFX_ERR_UNSUPPORTED;
     };
 
+    // frames in the ring are the raw output, a file is optional
+    if (!InputParams.ShmRing.Name.empty()) {
+        if (InputParams.eMode == Sink || InputParams.eModeExt == VppCompOnly ||
+            (!InputParams.strDstFile.empty() && InputParams.EncodeId != MFX_CODEC_DUMP)) {
+            PrintError("-shm_ring needs a session with raw output");
+            return MFX_ERR_UNSUPPORTED;
+        }
+        if (InputParams.strDstFile.empty()) {
+            InputParams.EncodeId   = MFX_CODEC_DUMP;
+            InputParams.strDstFile = "null";
+        }
+    }
+
     if (InputParams.strDstFile.empty() &&
         (InputParams.eMode == Source || InputParams.eMode == Native ||
          InputParams.eMode == VppComp) &&
@@ -3346,6 +3265,14 @@ mfxStatus CmdProcessor::VerifyAndCorrectInputParams(TranscodingSample::sInputPar
         return MFX_ERR_UNSUPPORTED;
     }
 
+    // access units are released on the schedule, so the input needs a frame reader
+    if (InputParams.LiveSource.RateN &&
+        (InputParams.eMode == Source || MFX_CODEC_MPEG2 == InputParams.DecodeId ||
+         MFX_CODEC_HEVC == InputParams.DecodeId || MFX_CODEC_VC1 == InputParams.DecodeId)) {
+        PrintError("-live needs a raw, h264, mjpeg, vp8, vp9 or av1 input file");
+        return MFX_ERR_UNSUPPORTED;
+    }
+
     if (MFX_CODEC_I420 == InputParams.DecodeId || MFX_CODEC_NV12 == InputParams.DecodeId ||
         MFX_CODEC_P010 == InputParams.DecodeId || MFX_CODEC_YUY2 == InputParams.DecodeId ||
         MFX_CODEC_Y210 == InputParams.DecodeId) {
@@ -0,0 +1,362 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "smt_control.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <sstream>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "sample_defs.h"
+
+using namespace TranscodingSample;
+
+// longer lines are dropped, there is no command of that length
+static const size_t MaxCommandLength = 256;
+
+static bool ReadControlValue(std::istringstream& words, mfxU32& value) {
+    std::string word;
+    if (!(words >> word) || word.size() > 9 ||
+        word.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+
+    value = (mfxU32)strtoul(word.c_str(), NULL, 10);
+    return true;
+}
+
+mfxStatus TranscodingSample::ParseControlCommand(const std::string& line,
+                                                 ControlCommand& cmd,
+                                                 std::string& error) {
+    std::istringstream words(line);
+    std::string name;
+    if (!(words >> cmd.Session >> name)) {
+        error = "expected <session> <command>";
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    cmd.Value[0] = cmd.Value[1] = 0;
+    if (name == "bitrate") {
+        cmd.Kind = ControlCommand::Type::Bitrate;
+        if (!ReadControlValue(words, cmd.Value[0]) || !cmd.Value[0]) {
+            error = "expected bitrate <kbps> [<max kbps>]";
+            return MFX_ERR_UNSUPPORTED;
+        }
+        // optional maximum bitrate
+        if (!(words >> std::ws).eof() && !ReadControlValue(words, cmd.Value[1])) {
+            error = "expected bitrate <kbps> [<max kbps>]";
+            return MFX_ERR_UNSUPPORTED;
+        }
+    }
+    else if (name == "size") {
+        cmd.Kind = ControlCommand::Type::Size;
+        if (!ReadControlValue(words, cmd.Value[0]) || !ReadControlValue(words, cmd.Value[1]) ||
+            !cmd.Value[0] || !cmd.Value[1]) {
+            error = "expected size <width> <height>";
+            return MFX_ERR_UNSUPPORTED;
+        }
+    }
+    else if (name == "qp") {
+        cmd.Kind = ControlCommand::Type::QP;
+        if (!ReadControlValue(words, cmd.Value[0]) || cmd.Value[0] > 51) {
+            error = "expected qp <0-51>";
+            return MFX_ERR_UNSUPPORTED;
+        }
+    }
+    else if (name == "idr") {
+        cmd.Kind = ControlCommand::Type::IDR;
+    }
+    else {
+        error = "unknown command '" + name + "'";
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    std::string extra;
+    if (words >> extra) {
+        error = "unexpected '" + extra + "'";
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    cmd.Text = line;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus TranscodingSample::ApplyControlCommand(const ControlCommand& cmd,
+                                                 mfxInfoMFX& enc,
+                                                 mfxFrameInfo* pVppOut,
+                                                 mfxU16 maxWidth,
+                                                 mfxU16 maxHeight,
+                                                 ControlChange& change,
+                                                 std::string& error) {
+    switch (cmd.Kind) {
+        case ControlCommand::Type::Bitrate: {
+            if (enc.RateControlMethod == MFX_RATECONTROL_CQP ||
+                enc.RateControlMethod == MFX_RATECONTROL_ICQ ||
+                enc.RateControlMethod == MFX_RATECONTROL_LA_ICQ) {
+                error = "rate control method has no bitrate";
+                return MFX_ERR_UNSUPPORTED;
+            }
+
+            // values are in units of BRCParamMultiplier kbps
+            mfxU32 multiplier = std::max<mfxU32>(enc.BRCParamMultiplier, 1);
+            mfxU32 target     = (cmd.Value[0] + multiplier - 1) / multiplier;
+            mfxU32 max        = (cmd.Value[1] + multiplier - 1) / multiplier;
+            if (target > 0xFFFF || max > 0xFFFF) {
+                error = "bitrate is out of range";
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (max && max < target) {
+                error = "maximum bitrate is below the target one";
+                return MFX_ERR_UNSUPPORTED;
+            }
+
+            enc.TargetKbps = (mfxU16)target;
+            if (max)
+                enc.MaxKbps = (mfxU16)max;
+            else if (enc.MaxKbps && enc.MaxKbps < target)
+                enc.MaxKbps = (mfxU16)target;
+
+            change.ResetEncoder = true;
+            break;
+        }
+        case ControlCommand::Type::Size: {
+            if (!pVppOut) {
+                error = "resolution can be changed only in a session with VPP";
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (cmd.Value[0] % 2 || cmd.Value[1] % 2) {
+                error = "width and height have to be even";
+                return MFX_ERR_UNSUPPORTED;
+            }
+
+            mfxU32 width  = MSDK_ALIGN16(cmd.Value[0]);
+            mfxU32 height = (enc.FrameInfo.PicStruct == MFX_PICSTRUCT_PROGRESSIVE)
+                                ? MSDK_ALIGN16(cmd.Value[1])
+                                : MSDK_ALIGN32(cmd.Value[1]);
+            if (width > maxWidth || height > maxHeight) {
+                error = "frames can't be larger than the allocated surfaces";
+                return MFX_ERR_UNSUPPORTED;
+            }
+
+            for (mfxFrameInfo* info : { &enc.FrameInfo, pVppOut }) {
+                info->Width  = (mfxU16)width;
+                info->Height = (mfxU16)height;
+                info->CropX  = 0;
+                info->CropY  = 0;
+                info->CropW  = (mfxU16)cmd.Value[0];
+                info->CropH  = (mfxU16)cmd.Value[1];
+            }
+
+            change.ResetVpp     = true;
+            change.ResetEncoder = true;
+            break;
+        }
+        case ControlCommand::Type::QP:
+            if (enc.RateControlMethod != MFX_RATECONTROL_CQP) {
+                error = "frame QP needs constant QP rate control";
+                return MFX_ERR_UNSUPPORTED;
+            }
+            // 0 returns to QPI/QPP/QPB of the encoder
+            change.SetFrameQP = true;
+            change.FrameQP    = (mfxU16)cmd.Value[0];
+            break;
+        case ControlCommand::Type::IDR:
+            change.InsertIDR = true;
+            break;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+ControlMailbox::ControlMailbox(mfxU32 latencyBound)
+        : m_latencyBound(latencyBound),
+          m_posted(false),
+          m_mutex(),
+          m_commands() {}
+
+void ControlMailbox::Post(const ControlCommand& cmd) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_commands.push_back(cmd);
+    m_posted = true;
+}
+
+bool ControlMailbox::Fetch(std::vector<ControlCommand>& commands,
+                           std::vector<ControlCommand>& expired,
+                           msdk_tick now) {
+    commands.clear();
+    expired.clear();
+    if (!m_posted.load(std::memory_order_acquire))
+        return false;
+
+    static msdk_tick frequency = msdk_time_get_frequency();
+    msdk_tick bound            = (msdk_tick)m_latencyBound * frequency / 1000;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const ControlCommand& cmd : m_commands) {
+        if (m_latencyBound && now - cmd.Received > bound)
+            expired.push_back(cmd);
+        else
+            commands.push_back(cmd);
+    }
+    m_commands.clear();
+    m_posted = false;
+    return true;
+}
+
+size_t ControlMailbox::GetPendingCount() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_commands.size();
+}
+
+ControlChannel::ControlChannel()
+        : m_sessions(),
+          m_path(),
+          m_fd(-1),
+          m_keepAliveFd(-1),
+          m_created(false),
+          m_stop(false),
+          m_rejected(0),
+          m_thread() {}
+
+ControlChannel::~ControlChannel() {
+    Close();
+}
+
+std::shared_ptr<ControlMailbox> ControlChannel::AddSession(const std::string& name,
+                                                           mfxU32 latencyBound) {
+    if (name.empty() || name == "*" || m_sessions.count(name))
+        return nullptr;
+
+    auto mailbox     = std::make_shared<ControlMailbox>(latencyBound);
+    m_sessions[name] = mailbox;
+    return mailbox;
+}
+
+bool ControlChannel::Dispatch(const std::string& line, msdk_tick received) {
+    // blank lines and comments of command scripts
+    size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#')
+        return true;
+
+    std::string error;
+    ControlCommand cmd;
+    if (ParseControlCommand(line, cmd, error) == MFX_ERR_NONE && cmd.Session != "*" &&
+        !m_sessions.count(cmd.Session)) {
+        error = "no session '" + cmd.Session + "'";
+    }
+    if (!error.empty()) {
+        printf("[ctrl] rejected \"%s\": %s\n", line.c_str(), error.c_str());
+        m_rejected++;
+        return false;
+    }
+
+    cmd.Received = received;
+    for (auto& session : m_sessions) {
+        if (cmd.Session == "*" || cmd.Session == session.first)
+            session.second->Post(cmd);
+    }
+    return true;
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+
+mfxStatus ControlChannel::Open(const std::string& path) {
+    Close();
+
+    if (mkfifo(path.c_str(), 0600) == 0) {
+        m_created = true;
+    }
+    else if (errno != EEXIST) {
+        printf("error: can't create control FIFO %s\n", path.c_str());
+        return MFX_ERR_NOT_FOUND;
+    }
+    m_path = path;
+
+    // read end has to be opened first for the non blocking write end to succeed
+    m_fd = open(path.c_str(), O_RDONLY | O_NONBLOCK);
+    if (m_fd >= 0)
+        m_keepAliveFd = open(path.c_str(), O_WRONLY | O_NONBLOCK);
+
+    struct stat info;
+    if (m_fd < 0 || m_keepAliveFd < 0 || fstat(m_fd, &info) || !S_ISFIFO(info.st_mode)) {
+        printf("error: %s is not a FIFO\n", path.c_str());
+        Close();
+        return MFX_ERR_NOT_FOUND;
+    }
+
+    m_stop   = false;
+    m_thread = std::thread(&ControlChannel::ReadCommands, this);
+    return MFX_ERR_NONE;
+}
+
+void ControlChannel::Close() {
+    m_stop = true;
+    if (m_thread.joinable())
+        m_thread.join();
+
+    if (m_fd >= 0)
+        close(m_fd);
+    if (m_keepAliveFd >= 0)
+        close(m_keepAliveFd);
+    m_fd          = -1;
+    m_keepAliveFd = -1;
+
+    if (m_created)
+        unlink(m_path.c_str());
+    m_created = false;
+}
+
+void ControlChannel::ReadCommands() {
+    std::string pending;
+    char buf[512];
+
+    while (!m_stop) {
+        // wakes up as soon as data comes, the timeout only bounds the time Close() waits
+        pollfd pfd = { m_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 50) <= 0)
+            continue;
+
+        ssize_t size = read(m_fd, buf, sizeof(buf));
+        if (size <= 0)
+            continue;
+
+        msdk_tick received = msdk_time_get_tick();
+        pending.append(buf, size);
+
+        size_t eol;
+        while ((eol = pending.find('\n')) != std::string::npos) {
+            Dispatch(pending.substr(0, eol), received);
+            pending.erase(0, eol + 1);
+        }
+
+        if (pending.size() > MaxCommandLength) {
+            printf("[ctrl] rejected command longer than %d characters\n", (int)MaxCommandLength);
+            m_rejected++;
+            pending.clear();
+        }
+    }
+}
+
+#else
+
+mfxStatus ControlChannel::Open(const std::string& path) {
+    printf("error: control FIFO %s is not supported on Windows\n", path.c_str());
+    return MFX_ERR_UNSUPPORTED;
+}
+
+void ControlChannel::Close() {}
+
+void ControlChannel::ReadCommands() {}
+
+#endif
@@ -0,0 +1,123 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "smt_frame_ctrl.h"
+
+#include <stdint.h>
+#include <cstring>
+
+using namespace TranscodingSample;
+
+// ext buffers of the source control plus ROI or MBQP fit without reallocation
+static const size_t ReservedExtParam = 8;
+
+FrameControl::FrameControl(mfxU32 numQP) : Ctrl(), ROI(), MBQP(), QP(numQP), ExtParam() {
+    MBQP.Header.BufferId = MFX_EXTBUFF_MBQP;
+    MBQP.Header.BufferSz = sizeof(mfxExtMBQP);
+    MBQP.NumQPAlloc      = numQP;
+    MBQP.QP              = numQP ? QP.data() : NULL;
+
+    ROI.Header.BufferId = MFX_EXTBUFF_ENCODER_ROI;
+    ROI.Header.BufferSz = sizeof(mfxExtEncoderROI);
+
+    ExtParam.reserve(ReservedExtParam);
+}
+
+void FrameControl::Reset(const mfxEncodeCtrl* pSrc) {
+    ExtParam.clear();
+    if (pSrc) {
+        Ctrl = *pSrc;
+        if (pSrc->ExtParam)
+            ExtParam.assign(pSrc->ExtParam, pSrc->ExtParam + pSrc->NumExtParam);
+    }
+    else {
+        std::memset(&Ctrl, 0, sizeof(Ctrl));
+    }
+
+    Ctrl.NumExtParam = (mfxU16)ExtParam.size();
+    Ctrl.ExtParam    = ExtParam.empty() ? NULL : ExtParam.data();
+}
+
+void FrameControl::Attach(mfxExtBuffer* pBuffer) {
+    ExtParam.push_back(pBuffer);
+    Ctrl.NumExtParam = (mfxU16)ExtParam.size();
+    Ctrl.ExtParam    = ExtParam.data();
+}
+
+FrameControlArena::FrameControlArena()
+        : m_numQP(0),
+          m_slots(),
+          m_bound(0),
+          m_keys(),
+          m_values() {}
+
+void FrameControlArena::Init(size_t numSlots, mfxU32 numQP) {
+    Close();
+
+    m_numQP = numQP;
+    for (size_t i = 0; i < numSlots; i++)
+        m_slots.emplace_back(m_numQP);
+
+    size_t tableSize = 16;
+    while (tableSize < 2 * numSlots)
+        tableSize *= 2;
+    Rehash(tableSize);
+}
+
+void FrameControlArena::Close() {
+    m_slots.clear();
+    m_bound = 0;
+    m_keys.clear();
+    m_values.clear();
+}
+
+size_t FrameControlArena::Find(const mfxFrameSurface1* pSurface) const {
+    const size_t mask = m_keys.size() - 1;
+
+    // surfaces are at least 16 bytes apart, Fibonacci hashing spreads the rest
+    size_t pos = (size_t)(((uintptr_t)pSurface >> 4) * 2654435761u) & mask;
+    while (m_keys[pos] && m_keys[pos] != pSurface)
+        pos = (pos + 1) & mask;
+
+    return pos;
+}
+
+void FrameControlArena::Rehash(size_t tableSize) {
+    std::vector<const mfxFrameSurface1*> keys(tableSize, nullptr);
+    std::vector<mfxU32> values(tableSize, 0);
+    keys.swap(m_keys);
+    values.swap(m_values);
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (!keys[i])
+            continue;
+        size_t pos    = Find(keys[i]);
+        m_keys[pos]   = keys[i];
+        m_values[pos] = values[i];
+    }
+}
+
+FrameControl& FrameControlArena::Get(const mfxFrameSurface1* pSurface) {
+    if (m_keys.empty())
+        Rehash(16);
+
+    size_t pos = Find(pSurface);
+    if (m_keys[pos])
+        return m_slots[m_values[pos]];
+
+    // surface seen for the first time
+    if (m_bound == m_slots.size())
+        m_slots.emplace_back(m_numQP);
+
+    if (2 * (m_bound + 1) > m_keys.size()) {
+        Rehash(2 * m_keys.size());
+        pos = Find(pSurface);
+    }
+
+    m_keys[pos]   = pSurface;
+    m_values[pos] = (mfxU32)m_bound;
+    return m_slots[m_bound++];
+}
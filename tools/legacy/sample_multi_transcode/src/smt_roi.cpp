@@ -0,0 +1,303 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "smt_roi.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include "sample_defs.h"
+
+using namespace TranscodingSample;
+
+ROIFile::Item ROIFile::ReadItem(FILE* file, std::string& item, long* pPos) {
+    item.clear();
+
+    for (;;) {
+        int c = fgetc(file);
+        if (c == EOF) {
+            if (ferror(file))
+                return Item::Error;
+            // trailing delimiter does not start one more item
+            return item.empty() ? Item::End : Item::Value;
+        }
+        (*pPos)++;
+
+        if (c == ';')
+            return Item::Value;
+        if (std::isspace(c))
+            continue;
+        if (!std::isdigit(c) && c != '-')
+            return Item::Error;
+
+        item.push_back((char)c);
+    }
+}
+
+ROIFile::Item ROIFile::ReadFrame(FILE* file, mfxExtEncoderROI& roi, long* pPos) {
+    std::string item;
+    Item res = ReadItem(file, item, pPos);
+    if (res != Item::Value)
+        return res;
+
+    int roi_num = std::atoi(item.c_str());
+    if (roi_num < 0 || roi_num > (int)(sizeof(roi.ROI) / sizeof(roi.ROI[0])))
+        return Item::Error;
+
+    std::memset(&roi, 0, sizeof(roi));
+    roi.Header.BufferId = MFX_EXTBUFF_ENCODER_ROI;
+    roi.ROIMode         = MFX_ROI_MODE_QP_DELTA;
+
+    for (int i = 0; i < roi_num; i++) {
+        mfxI32 values[5];
+        for (mfxI32& value : values) {
+            // do not handle out of range integer errors
+            if (ReadItem(file, item, pPos) != Item::Value)
+                return Item::Error;
+            value = std::atoi(item.c_str());
+        }
+
+        roi.ROI[i].Left    = values[0];
+        roi.ROI[i].Top     = values[1];
+        roi.ROI[i].Right   = values[2];
+        roi.ROI[i].Bottom  = values[3];
+        roi.ROI[i].DeltaQP = (mfxI16)values[4];
+    }
+    roi.NumROI = (mfxU16)roi_num;
+
+    return Item::Value;
+}
+
+std::shared_ptr<const ROIFile> ROIFile::Open(const std::string& fileName) {
+    FILE* fd = NULL;
+    MSDK_FOPEN(fd, fileName.c_str(), "rb");
+    if (!fd)
+        return nullptr;
+
+    std::shared_ptr<ROIFile> file(new ROIFile);
+    file->m_fileName = fileName;
+
+    std::unique_ptr<mfxExtEncoderROI> roi(new mfxExtEncoderROI);
+    long pos = 0;
+    Item res = Item::Value;
+    while (res == Item::Value) {
+        if (file->m_frameCount % CheckpointStep == 0)
+            file->m_checkpoints.push_back(pos);
+
+        res = ReadFrame(fd, *roi, &pos);
+        if (res == Item::Value)
+            file->m_frameCount++;
+    }
+    fclose(fd);
+
+    if (res == Item::Error)
+        return nullptr;
+
+    return file;
+}
+
+ROIReader::ROIReader()
+        : m_file(),
+          m_fd(NULL),
+          m_nextFrame(0),
+          m_nextPos(0),
+          m_lastFrame(0xFFFFFFFF),
+          m_lastROI() {}
+
+ROIReader::~ROIReader() {
+    Close();
+}
+
+mfxStatus ROIReader::Init(std::shared_ptr<const ROIFile> file) {
+    MSDK_CHECK_POINTER(file, MFX_ERR_NULL_PTR);
+    Close();
+
+    MSDK_FOPEN(m_fd, file->GetFileName().c_str(), "rb");
+    MSDK_CHECK_POINTER(m_fd, MFX_ERR_NOT_FOUND);
+
+    m_file = file;
+    return MFX_ERR_NONE;
+}
+
+void ROIReader::Close() {
+    if (m_fd)
+        fclose(m_fd);
+    m_fd        = NULL;
+    m_file      = nullptr;
+    m_nextFrame = 0;
+    m_nextPos   = 0;
+    m_lastFrame = 0xFFFFFFFF;
+}
+
+const mfxExtEncoderROI* ROIReader::GetFrame(mfxU32 frame) {
+    if (!m_fd || frame >= m_file->GetFrameCount())
+        return NULL;
+
+    if (frame == m_lastFrame)
+        return &m_lastROI;
+
+    // jump to the closest checkpoint when going back or far ahead
+    mfxU32 checkpoint = frame - frame % ROIFile::CheckpointStep;
+    if (frame < m_nextFrame || checkpoint > m_nextFrame) {
+        m_nextPos   = m_file->GetCheckpointOffset(frame);
+        m_nextFrame = checkpoint;
+        if (fseek(m_fd, m_nextPos, SEEK_SET)) {
+            m_lastFrame = 0xFFFFFFFF;
+            return NULL;
+        }
+    }
+
+    while (m_nextFrame <= frame) {
+        if (ROIFile::ReadFrame(m_fd, m_lastROI, &m_nextPos) != ROIFile::Item::Value) {
+            // file was changed after it was indexed
+            m_lastFrame = 0xFFFFFFFF;
+            m_nextFrame = m_file->GetFrameCount();
+            return NULL;
+        }
+        m_lastFrame = m_nextFrame++;
+    }
+
+    return &m_lastROI;
+}
+
+MBQPRasterizer::MBQPRasterizer()
+        : m_mapWidth(0),
+          m_mapHeight(0),
+          m_blockSize(16),
+          m_cacheSize(0),
+          m_cacheHits(0),
+          m_cache(),
+          m_bands() {}
+
+void MBQPRasterizer::Init(mfxU32 mapWidth, mfxU32 mapHeight, mfxU16 blockSize, size_t cacheSize) {
+    m_mapWidth  = mapWidth;
+    m_mapHeight = mapHeight;
+    m_blockSize = (blockSize == 32 || blockSize == 64) ? blockSize : 16;
+    m_cacheSize = cacheSize;
+    m_cacheHits = 0;
+    m_cache.clear();
+}
+
+void MBQPRasterizer::FillFrame(mfxU8* qp,
+                               mfxU32 numQP,
+                               mfxU32 frameQP,
+                               const mfxExtEncoderROI* roi) {
+    Fill(qp, numQP, frameQP, roi, false);
+}
+
+void MBQPRasterizer::FillField(mfxU8* qp,
+                               mfxU32 numQP,
+                               mfxU32 fieldQP,
+                               const mfxExtEncoderROI* roi) {
+    Fill(qp, numQP, fieldQP, roi, true);
+}
+
+void MBQPRasterizer::Fill(mfxU8* qp,
+                          mfxU32 numQP,
+                          mfxU32 baseQP,
+                          const mfxExtEncoderROI* roi,
+                          bool field) {
+    if (!roi || !roi->NumROI) {
+        std::memset(qp, (mfxI8)baseQP, numQP);
+        return;
+    }
+
+    const mfxU8* roiBegin = (const mfxU8*)roi->ROI;
+    const mfxU8* roiEnd   = (const mfxU8*)(roi->ROI + roi->NumROI);
+
+    for (auto it = m_cache.begin(); it != m_cache.end(); ++it) {
+        if (it->field == field && it->baseQP == baseQP && it->numROI == roi->NumROI &&
+            it->map.size() == numQP && std::equal(roiBegin, roiEnd, it->roi.begin())) {
+            std::memcpy(qp, it->map.data(), numQP);
+            m_cache.splice(m_cache.begin(), m_cache, it);
+            m_cacheHits++;
+            return;
+        }
+    }
+
+    if (field)
+        Rasterize(qp, numQP, baseQP, *roi, m_mapHeight / 2, 2 * m_blockSize);
+    else
+        Rasterize(qp, numQP, baseQP, *roi, m_mapHeight, m_blockSize);
+
+    if (!m_cacheSize)
+        return;
+
+    if (m_cache.size() >= m_cacheSize)
+        m_cache.pop_back();
+
+    CachedMap entry;
+    entry.field  = field;
+    entry.baseQP = baseQP;
+    entry.numROI = roi->NumROI;
+    entry.roi.assign(roiBegin, roiEnd);
+    entry.map.assign(qp, qp + numQP);
+    m_cache.push_front(std::move(entry));
+}
+
+void MBQPRasterizer::Rasterize(mfxU8* qp,
+                               mfxU32 numQP,
+                               mfxU32 baseQP,
+                               const mfxExtEncoderROI& roi,
+                               mfxU32 rows,
+                               mfxU32 vertBlockSize) {
+    struct Rect {
+        mfxU32 l, t, r, b;
+        mfxU8 qp;
+    };
+
+    mfxI8 fQP = (mfxI8)baseQP;
+    std::memset(qp, fQP, numQP);
+
+    // map is in 16x16 blocks, rectangles are aligned to the encoder QP block size
+    const mfxU32 hor   = m_blockSize;
+    const mfxU32 scale = m_blockSize / 16;
+
+    // the first rectangle has priority, so it is painted last
+    std::vector<Rect> rects;
+    m_bands.clear();
+    for (mfxI32 i = roi.NumROI - 1; i >= 0; i--) {
+        Rect rect;
+        rect.l  = std::min((roi.ROI[i].Left / hor) * scale, m_mapWidth);
+        rect.r  = std::min(((roi.ROI[i].Right + hor - 1) / hor) * scale, m_mapWidth);
+        rect.t  = std::min((roi.ROI[i].Top / vertBlockSize) * scale, rows);
+        rect.b  = std::min(((roi.ROI[i].Bottom + vertBlockSize - 1) / vertBlockSize) * scale, rows);
+        rect.qp = (mfxU8)std::min(std::max(fQP + (mfxI8)roi.ROI[i].DeltaQP, 0), 51);
+
+        if (rect.l >= rect.r || rect.t >= rect.b)
+            continue;
+
+        rects.push_back(rect);
+        m_bands.push_back(rect.t);
+        m_bands.push_back(rect.b);
+    }
+
+    std::sort(m_bands.begin(), m_bands.end());
+    m_bands.erase(std::unique(m_bands.begin(), m_bands.end()), m_bands.end());
+
+    // rows between two consecutive rectangle edges are equal: build the first one, copy the rest
+    for (size_t band = 0; band + 1 < m_bands.size(); band++) {
+        mfxU32 top    = m_bands[band];
+        mfxU32 bottom = m_bands[band + 1];
+        mfxU8* row    = qp + top * m_mapWidth;
+
+        bool painted = false;
+        for (const Rect& rect : rects) {
+            if (rect.t <= top && rect.b >= bottom) {
+                std::memset(row + rect.l, rect.qp, rect.r - rect.l);
+                painted = true;
+            }
+        }
+
+        if (!painted)
+            continue;
+
+        for (mfxU32 k = top + 1; k < bottom; k++)
+            std::memcpy(qp + k * m_mapWidth, row, m_mapWidth);
+    }
+}
@@ -0,0 +1,482 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+// Stub runtime (libvpl/test/runtimes/stub) with an encoder whose device hangs once and a VPP
+// that copies the luma of raw input frames. It stands in for the GPU runtime of the -robust
+// sessions in sample_multi_transcode_test:
+//   SMT_TEST_RT_HANG - SyncOperation of the frame with this number in its session, counted from 0,
+//                      returns MFX_ERR_GPU_HANG instead of the frame after 100 ms, once in the
+//                      process
+// SyncOperation writes one line "frame F data Y idr I" into the bitstream, F being the number of
+// the frame in its session and Y the first luma byte. Frames are IDR frames at the start of
+// every GOP and when the encode control asks for it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "vpl/mfx.h"
+
+#define SLICE_SIZE 64
+
+struct HangTask {
+    mfxFrameSurface1 *surface;
+    mfxBitstream *bs;
+    mfxU32 frameOrder; // frames the session got before this one
+    bool idr;
+};
+
+struct HangEncoder {
+    mfxVideoParam par;
+    mfxU32 submitted;
+    std::list<HangTask> tasks; // sync points point to the tasks
+
+    HangEncoder() : par(), submitted(0), tasks() {}
+};
+
+static std::mutex g_mutex;
+static std::map<mfxSession, HangEncoder> g_encoders;
+static std::map<mfxSession, mfxVideoParam> g_vpps;
+// VPP is done when RunFrameVPPAsync returns, all its sync points are the same
+static mfxU8 g_vppDone;
+static bool g_hung = false;
+
+static HangEncoder *FindEncoder(mfxSession session) {
+    auto it = g_encoders.find(session);
+    return it != g_encoders.end() ? &it->second : nullptr;
+}
+
+mfxStatus MFXInit(mfxIMPL implParam, mfxVersion *ver, mfxSession *session) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXJoinSession(mfxSession session, mfxSession child) {
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXSetPriority(mfxSession session, mfxPriority priority) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXGetPriority(mfxSession session, mfxPriority *priority) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+// surfaces are in system memory, the allocator is never used
+mfxStatus MFXVideoCORE_SetFrameAllocator(mfxSession session, mfxFrameAllocator *allocator) {
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoCORE_SetHandle(mfxSession session, mfxHandleType type, mfxHDL hdl) {
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoCORE_GetHandle(mfxSession session, mfxHandleType type, mfxHDL *hdl) {
+    // per spec, GetHandle returns UNDEFINED_BEHAVIOR for unknown handle type, which for stub RT is currently all types
+    return MFX_ERR_UNDEFINED_BEHAVIOR;
+}
+
+mfxStatus MFXVideoCORE_QueryPlatform(mfxSession session, mfxPlatform *platform) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoCORE_SyncOperation(mfxSession session, mfxSyncPoint syncp, mfxU32 wait) {
+    if (syncp == reinterpret_cast<mfxSyncPoint>(&g_vppDone))
+        return MFX_ERR_NONE;
+
+    std::unique_lock<std::mutex> lock(g_mutex);
+    HangEncoder *encoder = FindEncoder(session);
+    if (!encoder)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    auto task = encoder->tasks.begin();
+    while (task != encoder->tasks.end() && reinterpret_cast<mfxSyncPoint>(&*task) != syncp)
+        task++;
+    if (task == encoder->tasks.end())
+        return MFX_ERR_NULL_PTR;
+
+    // the device stays hung until the session is closed
+    const char *hang = getenv("SMT_TEST_RT_HANG");
+    if (!g_hung && hang && (mfxU32)atoi(hang) == task->frameOrder) {
+        g_hung = true;
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        return MFX_ERR_GPU_HANG;
+    }
+
+    mfxFrameSurface1 *surface = task->surface;
+    mfxBitstream *bs          = task->bs;
+    char slice[SLICE_SIZE];
+    int size = snprintf(slice,
+                        sizeof(slice),
+                        "frame %u data %u idr %u\n",
+                        (unsigned)task->frameOrder,
+                        (unsigned)(surface->Data.Y ? surface->Data.Y[0] : 0),
+                        (unsigned)task->idr);
+    memcpy(bs->Data + bs->DataOffset + bs->DataLength, slice, size);
+    bs->DataLength += size;
+    bs->FrameType = task->idr ? MFX_FRAMETYPE_I | MFX_FRAMETYPE_IDR | MFX_FRAMETYPE_REF
+                              : MFX_FRAMETYPE_P | MFX_FRAMETYPE_REF;
+
+    surface->Data.Locked--;
+    encoder->tasks.erase(task);
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoDECODE_DecodeHeader(mfxSession session, mfxBitstream *bs, mfxVideoParam *par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_Query(mfxSession session, mfxVideoParam *in, mfxVideoParam *out) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_QueryIOSurf(mfxSession session,
+                                     mfxVideoParam *par,
+                                     mfxFrameAllocRequest *request) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_Init(mfxSession session, mfxVideoParam *par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_Close(mfxSession session) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_DecodeFrameAsync(mfxSession session,
+                                          mfxBitstream *bs,
+                                          mfxFrameSurface1 *surface_work,
+                                          mfxFrameSurface1 **surface_out,
+                                          mfxSyncPoint *syncp) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_GetVideoParam(mfxSession session, mfxVideoParam *par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_Reset(mfxSession session, mfxVideoParam *par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_GetDecodeStat(mfxSession session, mfxDecodeStat *stat) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_SetSkipMode(mfxSession session, mfxSkipMode mode) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_GetPayload(mfxSession session, mfxU64 *ts, mfxPayload *payload) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_VPP_Init(mfxSession session,
+                                  mfxVideoParam *decode_par,
+                                  mfxVideoChannelParam **vpp_par_array,
+                                  mfxU32 num_vpp_par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_VPP_DecodeFrameAsync(mfxSession session,
+                                              mfxBitstream *bs,
+                                              mfxU32 *skip_channels,
+                                              mfxU32 num_skip_channels,
+                                              mfxSurfaceArray **surf_array_out) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_VPP_Reset(mfxSession session,
+                                   mfxVideoParam *decode_par,
+                                   mfxVideoChannelParam **vpp_par_array,
+                                   mfxU32 num_vpp_par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_VPP_GetChannelParam(mfxSession session,
+                                             mfxVideoChannelParam *par,
+                                             mfxU32 channel_id) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoDECODE_VPP_Close(mfxSession session) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoENCODE_Query(mfxSession session, mfxVideoParam *in, mfxVideoParam *out) {
+    if (!out)
+        return MFX_ERR_NULL_PTR;
+
+    // any parameters are supported
+    if (in && in != out) {
+        out->mfx        = in->mfx;
+        out->IOPattern  = in->IOPattern;
+        out->AsyncDepth = in->AsyncDepth;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoENCODE_QueryIOSurf(mfxSession session,
+                                     mfxVideoParam *par,
+                                     mfxFrameAllocRequest *request) {
+    if (!par || !request)
+        return MFX_ERR_NULL_PTR;
+
+    // every frame in flight locks its surface
+    request->Info              = par->mfx.FrameInfo;
+    request->NumFrameMin       = 1;
+    request->NumFrameSuggested = std::max<mfxU16>(par->AsyncDepth, 1);
+    request->Type              = MFX_MEMTYPE_EXTERNAL_FRAME | MFX_MEMTYPE_FROM_ENCODE;
+    request->Type |= MFX_MEMTYPE_SYSTEM_MEMORY;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoENCODE_Init(mfxSession session, mfxVideoParam *par) {
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!par)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (FindEncoder(session))
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    HangEncoder &encoder    = g_encoders[session];
+    encoder.par             = *par;
+    encoder.par.NumExtParam = 0;
+    encoder.par.ExtParam    = nullptr;
+    if (!encoder.par.AsyncDepth)
+        encoder.par.AsyncDepth = 1;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoENCODE_Close(mfxSession session) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    HangEncoder *encoder = FindEncoder(session);
+    if (!encoder)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    for (auto &task : encoder->tasks)
+        task.surface->Data.Locked--;
+    g_encoders.erase(session);
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoENCODE_EncodeFrameAsync(mfxSession session,
+                                          mfxEncodeCtrl *ctrl,
+                                          mfxFrameSurface1 *surface,
+                                          mfxBitstream *bs,
+                                          mfxSyncPoint *syncp) {
+    if (!bs || !syncp)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    HangEncoder *encoder = FindEncoder(session);
+    if (!encoder)
+        return MFX_ERR_NOT_INITIALIZED;
+    // no frames are buffered
+    if (!surface)
+        return MFX_ERR_MORE_DATA;
+    if (encoder->tasks.size() >= encoder->par.AsyncDepth)
+        return MFX_WRN_DEVICE_BUSY;
+    if (bs->MaxLength - bs->DataOffset - bs->DataLength < SLICE_SIZE)
+        return MFX_ERR_NOT_ENOUGH_BUFFER;
+
+    mfxU16 gopSize = encoder->par.mfx.GopPicSize;
+
+    HangTask task   = {};
+    task.surface    = surface;
+    task.bs         = bs;
+    task.frameOrder = encoder->submitted++;
+    task.idr        = (ctrl && (ctrl->FrameType & MFX_FRAMETYPE_IDR)) ||
+                      (gopSize ? task.frameOrder % gopSize == 0 : task.frameOrder == 0);
+    encoder->tasks.push_back(task);
+
+    surface->Data.Locked++;
+    *syncp = reinterpret_cast<mfxSyncPoint>(&encoder->tasks.back());
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoENCODE_Reset(mfxSession session, mfxVideoParam *par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoENCODE_GetVideoParam(mfxSession session, mfxVideoParam *par) {
+    if (!par)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    HangEncoder *encoder = FindEncoder(session);
+    if (!encoder)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    par->mfx        = encoder->par.mfx;
+    par->IOPattern  = encoder->par.IOPattern;
+    par->AsyncDepth = encoder->par.AsyncDepth;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoENCODE_GetEncodeStat(mfxSession session, mfxEncodeStat *stat) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoVPP_Query(mfxSession session, mfxVideoParam *in, mfxVideoParam *out) {
+    if (!out)
+        return MFX_ERR_NULL_PTR;
+
+    // any parameters are supported
+    if (in && in != out) {
+        out->vpp        = in->vpp;
+        out->IOPattern  = in->IOPattern;
+        out->AsyncDepth = in->AsyncDepth;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoVPP_QueryIOSurf(mfxSession session,
+                                  mfxVideoParam *par,
+                                  mfxFrameAllocRequest request[2]) {
+    if (!par || !request)
+        return MFX_ERR_NULL_PTR;
+
+    request[0].Info = par->vpp.In;
+    request[0].Type = MFX_MEMTYPE_EXTERNAL_FRAME | MFX_MEMTYPE_FROM_VPPIN;
+    request[1].Info = par->vpp.Out;
+    request[1].Type = MFX_MEMTYPE_EXTERNAL_FRAME | MFX_MEMTYPE_FROM_VPPOUT;
+    for (int i = 0; i < 2; i++) {
+        request[i].NumFrameMin       = 1;
+        request[i].NumFrameSuggested = std::max<mfxU16>(par->AsyncDepth, 1);
+        request[i].Type |= MFX_MEMTYPE_SYSTEM_MEMORY;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoVPP_Init(mfxSession session, mfxVideoParam *par) {
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!par)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_vpps.count(session))
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    mfxVideoParam &vpp = g_vpps[session];
+    vpp                = *par;
+    vpp.NumExtParam    = 0;
+    vpp.ExtParam       = nullptr;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoVPP_Close(mfxSession session) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_vpps.erase(session) ? MFX_ERR_NONE : MFX_ERR_NOT_INITIALIZED;
+}
+
+mfxStatus MFXVideoVPP_GetVideoParam(mfxSession session, mfxVideoParam *par) {
+    if (!par)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_vpps.find(session);
+    if (it == g_vpps.end())
+        return MFX_ERR_NOT_INITIALIZED;
+
+    par->vpp        = it->second.vpp;
+    par->IOPattern  = it->second.IOPattern;
+    par->AsyncDepth = it->second.AsyncDepth;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoVPP_RunFrameVPPAsync(mfxSession session,
+                                       mfxFrameSurface1 *in,
+                                       mfxFrameSurface1 *out,
+                                       mfxExtVppAuxData *aux,
+                                       mfxSyncPoint *syncp) {
+    if (!out || !syncp)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!g_vpps.count(session))
+        return MFX_ERR_NOT_INITIALIZED;
+    // no frames are buffered
+    if (!in)
+        return MFX_ERR_MORE_DATA;
+
+    mfxU16 height = std::min(in->Info.CropH, out->Info.CropH);
+    mfxU16 width  = std::min(in->Info.CropW, out->Info.CropW);
+    if (in->Data.Y && out->Data.Y) {
+        for (mfxU16 y = 0; y < height; y++)
+            memcpy(out->Data.Y + y * out->Data.Pitch, in->Data.Y + y * in->Data.Pitch, width);
+    }
+    out->Data.TimeStamp  = in->Data.TimeStamp;
+    out->Data.FrameOrder = in->Data.FrameOrder;
+
+    *syncp = reinterpret_cast<mfxSyncPoint>(&g_vppDone);
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoVPP_Reset(mfxSession session, mfxVideoParam *par) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoVPP_GetVPPStat(mfxSession session, mfxVPPStat *stat) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXVideoVPP_ProcessFrameAsync(mfxSession session,
+                                        mfxFrameSurface1 *in,
+                                        mfxFrameSurface1 **out) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+// memory functions are associated with initialized session
+mfxStatus MFXMemory_GetSurfaceForVPP(mfxSession session, mfxFrameSurface1 **surface) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXMemory_GetSurfaceForEncode(mfxSession session, mfxFrameSurface1 **surface) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXMemory_GetSurfaceForDecode(mfxSession session, mfxFrameSurface1 **surface) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus MFXMemory_GetSurfaceForVPPOut(mfxSession session, mfxFrameSurface1 **surface) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+// DLL entry point
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+BOOL APIENTRY DllMain(HMODULE, DWORD, LPVOID lpReserved) {
+    return TRUE;
+} // BOOL APIENTRY DllMain(HMODULE hModule,
+#else // #if defined(_WIN32) || defined(_WIN64)
+void __attribute__((constructor)) dll_init(void) {}
+#endif // #if defined(_WIN32) || defined(_WIN64)
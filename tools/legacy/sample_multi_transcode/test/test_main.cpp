@@ -4,10 +4,32 @@
   # SPDX-License-Identifier: MIT
   ############################################################################*/
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
 #include <regex>
+#include <thread>
 #include "gtest/gtest.h"
+#include "live_source.h"
 #include "sample_defs.h"
 #include "sample_multi_transcode.h"
+#include "shm_frame_ring.h"
+#include "smt_affinity.h"
+#include "smt_control.h"
+#include "smt_frame_ctrl.h"
+#include "smt_roi.h"
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <sched.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
 
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
@@ -24,6 +46,11 @@ struct init_result {
 
 #define EXPECT_CONTAINS(ACTUAL, EXPECTED) EXPECT_TRUE(ACTUAL.find(EXPECTED) != ACTUAL.npos);
 
+void write_file(const char* name, const std::string& content) {
+    std::ofstream file(name, std::ios::binary | std::ios::trunc);
+    file << content;
+}
+
 // TranscodingSample::CmdProcessor::ParseCmdLine expects non-const char*
 init_result init(int argc, char* argv[], TranscodingSample::CmdProcessor* cmd_override = nullptr) {
     init_result result;
@@ -85,7 +112,9 @@ init_result init_no_extras(std::vector<std::string> opts,
     for (auto& opt : opts) {
         args.push_back(&opt[0]);
     }
-    return init((int)args.size(), &args[0], cmd_override);
+    // argv of main() ends with a null pointer
+    args.push_back(nullptr);
+    return init((int)args.size() - 1, &args[0], cmd_override);
 }
 
 init_result init_session(std::vector<std::string> opts,
@@ -99,7 +128,9 @@ init_result init_session(std::vector<std::string> opts,
     for (auto& opt : opts) {
         args.push_back(&opt[0]);
     }
-    return init((int)args.size(), &args[0], cmd_override);
+    // argv of main() ends with a null pointer
+    args.push_back(nullptr);
+    return init((int)args.size() - 1, &args[0], cmd_override);
 }
 
 init_result init(std::vector<std::string> opts,
@@ -109,7 +140,9 @@ init_result init(std::vector<std::string> opts,
     for (auto& opt : opts) {
         args.push_back(&opt[0]);
     }
-    return init((int)args.size(), &args[0], cmd_override);
+    // argv of main() ends with a null pointer
+    args.push_back(nullptr);
+    return init((int)args.size() - 1, &args[0], cmd_override);
 }
 
 TEST(Transcode_CLI, build_env) {
@@ -208,6 +241,7 @@ TEST(Transcode_CLI, TrivialSessionOptions) {
     EXPECT_EQ(result.parsed[0].strDstFile, std::string("out_file"));
     EXPECT_TRUE(result.parsed[0].strDumpVppCompFile.empty());
     EXPECT_TRUE(result.parsed[0].dump_file.empty());
+    EXPECT_FALSE(result.parsed[0].qualityParams.IsEnabled());
     EXPECT_TRUE(result.parsed[0].strTCBRCFilePath.empty());
     EXPECT_EQ(result.parsed[0].nTargetUsage, 0);
     EXPECT_EQ(result.parsed[0].dDecoderFrameRateOverride, 0.0);
@@ -418,8 +452,7 @@ TEST(Transcode_CLI, TrivialSessionOptions) {
     EXPECT_EQ(result.parsed[0].PercEncPrefilter = false, false);
 #endif
     EXPECT_TRUE(result.parsed[0].DumpLogFileName.empty());
-    EXPECT_TRUE(result.parsed[0].m_ROIData.empty());
-    EXPECT_TRUE(result.parsed[0].m_ROIData.empty());
+    EXPECT_FALSE(result.parsed[0].m_ROIFile);
     EXPECT_EQ(result.parsed[0].bDecoderPostProcessing, false);
     EXPECT_EQ(result.parsed[0].bROIasQPMAP, false);
 #ifdef ENABLE_MCTF
@@ -654,8 +687,39 @@ TEST(Transcode_CLI, OptionROIFileMissingFile) {
 }
 
 TEST(Transcode_CLI, OptionROIFile) {
-    GTEST_SKIP() << "Test not implemented";
-    // Test that an ROI file is recognized
+    const char* name = "temp_roi_file.txt";
+    write_file(name, "1;0;0;64;64;-5;\n0;\n");
+    do {
+        auto result = init_session({ "-roi_file", name });
+        EXPECT_EQ(result.status, MFX_ERR_NONE);
+        ASSERT_EQ(result.parsed.size(), 1u);
+        ASSERT_TRUE(result.parsed[0].m_ROIFile);
+        EXPECT_EQ(result.parsed[0].m_ROIFile->GetFrameCount(), 2u);
+    } while (0);
+    remove(name);
+}
+
+TEST(Transcode_CLI, OptionROIFileSharedBySessions) {
+    write_file("temp_roi_file.txt", "1;0;0;64;64;-5;\n0;\n");
+    write_file("temp_roi_file2.txt", "0;\n");
+    write_file("temp_roi.par",
+               "-i::h264 in0 -o::h265 out0 -roi_file temp_roi_file.txt\n"
+               "-i::h264 in1 -o::h265 out1 -roi_file temp_roi_file2.txt\n"
+               "-i::h264 in2 -o::h265 out2 -roi_file temp_roi_file.txt\n");
+    do {
+        TranscodingSample::CmdProcessor cmd;
+        auto result = init({ "-par_threads", "3", "-par", "temp_roi.par" }, &cmd);
+        EXPECT_EQ(result.status, MFX_ERR_NONE);
+        ASSERT_EQ(result.parsed.size(), 3u);
+        ASSERT_TRUE(result.parsed[0].m_ROIFile && result.parsed[1].m_ROIFile);
+        // the file named twice is read and indexed once
+        EXPECT_EQ(result.parsed[0].m_ROIFile, result.parsed[2].m_ROIFile);
+        EXPECT_NE(result.parsed[0].m_ROIFile, result.parsed[1].m_ROIFile);
+        EXPECT_EQ(result.parsed[1].m_ROIFile->GetFrameCount(), 1u);
+    } while (0);
+    remove("temp_roi_file.txt");
+    remove("temp_roi_file2.txt");
+    remove("temp_roi.par");
 }
 
 TEST(Transcode_CLI, OptionPerfFileNoValue) {
@@ -761,6 +825,38 @@ TEST(Transcode_CLI, OptionDevice1024) {
 
 #endif
 
+TEST(Transcode_CLI, OptionCascadePriority) {
+    auto result = init_session({ "-cs", "-cs_priority", "3", "-cs_latency", "20" });
+    EXPECT_EQ(result.status, MFX_ERR_NONE);
+    EXPECT_EQ(result.parsed[0].CascadeScaler, true);
+    EXPECT_EQ(result.parsed[0].CascadePriority, 3);
+    EXPECT_EQ(result.parsed[0].CascadeLatencyBudget, 20u);
+}
+
+TEST(Transcode_CLI, OptionCascadeLatencyNoArg) {
+    auto result = init_session({ "-cs_latency" });
+    EXPECT_NE(result.status, MFX_ERR_NONE);
+}
+
+TEST(Transcode_CLI, OptionControlChannel) {
+    TranscodingSample::CmdProcessor cmd;
+    auto result = init(
+        { "-ctrl", "smt_fifo", "-ctrl_latency", "200", "-i::h264", "in", "-o::h265", "out", "-name",
+          "enc0" },
+        &cmd);
+    EXPECT_EQ(result.status, MFX_ERR_NONE);
+    EXPECT_EQ(cmd.GetControlChannel(), std::string("smt_fifo"));
+    EXPECT_EQ(cmd.GetControlLatency(), 200u);
+    ASSERT_EQ(result.parsed.size(), 1u);
+    EXPECT_EQ(result.parsed[0].SessionName, std::string("enc0"));
+}
+
+TEST(Transcode_CLI, OptionControlLatencyInvalid) {
+    auto result = init({ "-ctrl", "smt_fifo", "-ctrl_latency", "soon", "-i::h264", "in" });
+    EXPECT_EQ(result.status, MFX_ERR_UNSUPPORTED);
+    EXPECT_CONTAINS(result.out, "error: -ctrl_latency \"soon\" is invalid");
+}
+
 TEST(Transcode_CLI, OptionRobust) {
     auto result = init_session({ "-robust" });
     EXPECT_EQ(result.status, MFX_ERR_NONE);
@@ -771,4 +867,2357 @@ TEST(Transcode_CLI, OptionRobustSoft) {
     auto result = init_session({ "-robust:soft" });
     EXPECT_EQ(result.status, MFX_ERR_NONE);
     EXPECT_EQ(result.parsed[0].bSoftRobustFlag, true);
-}
\ No newline at end of file
+}
+
+TEST(Transcode_CLI, OptionVerify) {
+    auto result = init_session(
+        { "-verify_digest", "out.crc", "-verify_ref", "ref.yuv", "-verify_threads", "4" });
+    EXPECT_EQ(result.status, MFX_ERR_NONE);
+    EXPECT_EQ(result.parsed[0].qualityParams.strDigestIn, std::string("out.crc"));
+    EXPECT_EQ(result.parsed[0].qualityParams.strRefFile, std::string("ref.yuv"));
+    EXPECT_TRUE(result.parsed[0].qualityParams.strDigestOut.empty());
+    EXPECT_EQ(result.parsed[0].qualityParams.numThreads, 4u);
+}
+
+TEST(Transcode_CLI, OptionDumpDigestNoArg) {
+    auto result = init_session({ "-dump_digest" });
+    EXPECT_EQ(result.status, MFX_ERR_UNSUPPORTED);
+}
+
+TEST(Transcode_Init, DependenciesIndependentSessions) {
+    std::vector<TranscodingSample::sInputParams> params(3);
+    auto deps = TranscodingSample::GetSessionInitDependencies(params);
+    ASSERT_EQ(deps.size(), 3u);
+    EXPECT_TRUE(deps[0].empty());
+    EXPECT_EQ(deps[1], std::vector<mfxU32>({ 0 }));
+    EXPECT_EQ(deps[2], std::vector<mfxU32>({ 0 }));
+}
+
+TEST(Transcode_Init, DependenciesJoinedSessions) {
+    std::vector<TranscodingSample::sInputParams> params(4);
+    params[1].bIsJoin = true;
+    params[2].bIsJoin = true;
+    auto deps         = TranscodingSample::GetSessionInitDependencies(params);
+    ASSERT_EQ(deps.size(), 4u);
+    EXPECT_EQ(deps[1], std::vector<mfxU32>({ 0 }));
+    EXPECT_EQ(deps[2], std::vector<mfxU32>({ 0, 1 }));
+    EXPECT_EQ(deps[3], std::vector<mfxU32>({ 0, 1 }));
+}
+
+TEST(Transcode_Init, DependenciesSinkAndSources) {
+    std::vector<TranscodingSample::sInputParams> params(5);
+    params[0].eMode = TranscodingSample::Sink;
+    params[1].eMode = TranscodingSample::Sink;
+    params[2].eMode = TranscodingSample::Source;
+    params[3].eMode = TranscodingSample::Source;
+    params[4].eMode = TranscodingSample::Native;
+    auto deps       = TranscodingSample::GetSessionInitDependencies(params);
+    ASSERT_EQ(deps.size(), 5u);
+    EXPECT_EQ(deps[1], std::vector<mfxU32>({ 0 }));
+    EXPECT_EQ(deps[2], std::vector<mfxU32>({ 0, 1 }));
+    EXPECT_EQ(deps[3], std::vector<mfxU32>({ 0, 1 }));
+    EXPECT_EQ(deps[4], std::vector<mfxU32>({ 0 }));
+}
+
+TEST(Transcode_Init, SchedulerRunsIndependentStepsConcurrently) {
+    std::mutex m;
+    std::condition_variable cv;
+    int started = 0;
+
+    // each step waits for the other one to start, which only succeeds when they run in parallel
+    auto step = [&]() {
+        std::unique_lock<std::mutex> lock(m);
+        started++;
+        cv.notify_all();
+        bool both = cv.wait_for(lock, std::chrono::seconds(10), [&] {
+            return started == 2;
+        });
+        return both ? MFX_ERR_NONE : MFX_ERR_GPU_HANG;
+    };
+
+    TranscodingSample::SessionInitScheduler scheduler;
+    scheduler.Launch(0, {}, step);
+    scheduler.Launch(1, {}, step);
+    EXPECT_EQ(scheduler.WaitAll(), MFX_ERR_NONE);
+}
+
+TEST(Transcode_Init, SchedulerRespectsDependencies) {
+    std::mutex m;
+    std::vector<mfxU32> order;
+    auto step = [&](mfxU32 idx, int delayMs) {
+        return [&, idx, delayMs]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+            std::lock_guard<std::mutex> lock(m);
+            order.push_back(idx);
+            return MFX_ERR_NONE;
+        };
+    };
+
+    TranscodingSample::SessionInitScheduler scheduler;
+    scheduler.Launch(0, {}, step(0, 50));
+    scheduler.Launch(1, { 0 }, step(1, 0));
+    scheduler.Launch(2, { 0, 1 }, step(2, 0));
+    EXPECT_EQ(scheduler.WaitAll(), MFX_ERR_NONE);
+    EXPECT_EQ(order, std::vector<mfxU32>({ 0, 1, 2 }));
+}
+
+TEST(Transcode_Init, SchedulerPropagatesFailure) {
+    std::atomic<bool> dependentRan(false);
+    TranscodingSample::SessionInitScheduler scheduler;
+    scheduler.Launch(0, {}, []() {
+        return MFX_ERR_UNSUPPORTED;
+    });
+    scheduler.Launch(1, { 0 }, [&]() {
+        dependentRan = true;
+        return MFX_ERR_NONE;
+    });
+    scheduler.Launch(2, {}, []() {
+        return MFX_WRN_PARTIAL_ACCELERATION;
+    });
+
+    mfxU32 failedIdx = 99;
+    EXPECT_EQ(scheduler.WaitAll(&failedIdx), MFX_ERR_UNSUPPORTED);
+    EXPECT_EQ(failedIdx, 0u);
+    EXPECT_FALSE(dependentRan);
+    EXPECT_EQ(scheduler.Wait({ 2 }), MFX_ERR_NONE);
+}
+
+TEST(Transcode_Robust, RecoveryGroupIndependentSessions) {
+    std::vector<TranscodingSample::sInputParams> params(3);
+    EXPECT_EQ(TranscodingSample::GetRecoveryGroup(params, 0), std::vector<mfxU32>({ 0 }));
+    EXPECT_EQ(TranscodingSample::GetRecoveryGroup(params, 2), std::vector<mfxU32>({ 2 }));
+    EXPECT_TRUE(TranscodingSample::GetRecoveryGroup(params, 3).empty());
+}
+
+TEST(Transcode_Robust, RecoveryGroupSinkAndSources) {
+    std::vector<TranscodingSample::sInputParams> params(4);
+    params[0].eMode = TranscodingSample::Sink;
+    params[1].eMode = TranscodingSample::Source;
+    params[2].eMode = TranscodingSample::Source;
+    params[3].eMode = TranscodingSample::Native;
+    EXPECT_EQ(TranscodingSample::GetRecoveryGroup(params, 2), std::vector<mfxU32>({ 0, 1, 2 }));
+    EXPECT_EQ(TranscodingSample::GetRecoveryGroup(params, 3), std::vector<mfxU32>({ 3 }));
+}
+
+TEST(Transcode_Robust, RecoveryGroupJoinedSessions) {
+    std::vector<TranscodingSample::sInputParams> params(4);
+    params[0].bIsJoin = true;
+    params[2].bIsJoin = true;
+    params[3].bIsJoin = true;
+    EXPECT_EQ(TranscodingSample::GetRecoveryGroup(params, 3), std::vector<mfxU32>({ 0, 2, 3 }));
+    EXPECT_EQ(TranscodingSample::GetRecoveryGroup(params, 1), std::vector<mfxU32>({ 1 }));
+}
+
+TEST(Transcode_Robust, RestartSkipsCompletedSessions) {
+    std::vector<TranscodingSample::sInputParams> params(4);
+    std::vector<bool> completed({ true, false, true, false });
+    EXPECT_EQ(TranscodingSample::GetRestartedSessions(params, { 0, 1, 2 }, completed),
+              std::vector<mfxU32>({ 1 }));
+    EXPECT_TRUE(TranscodingSample::GetRestartedSessions(params, { 0, 2 }, completed).empty());
+}
+
+TEST(Transcode_Robust, RestartReplaysCompletedSinkOfSource) {
+    std::vector<TranscodingSample::sInputParams> params(4);
+    params[0].eMode = TranscodingSample::Sink;
+    params[1].eMode = TranscodingSample::Source;
+    params[2].eMode = TranscodingSample::Source;
+    std::vector<bool> completed({ true, true, false, false });
+    EXPECT_EQ(TranscodingSample::GetRestartedSessions(params, { 0, 1, 2 }, completed),
+              std::vector<mfxU32>({ 0, 2 }));
+
+    // a sink alone is restarted only if it didn't complete
+    completed = { false, true, true, false };
+    EXPECT_EQ(TranscodingSample::GetRestartedSessions(params, { 0, 1, 2 }, completed),
+              std::vector<mfxU32>({ 0 }));
+}
+
+TEST(Transcode_Robust, RecoveryGroupJoinedSinkTiesGroups) {
+    std::vector<TranscodingSample::sInputParams> params(5);
+    params[0].eMode   = TranscodingSample::Sink;
+    params[0].bIsJoin = true;
+    params[1].eMode   = TranscodingSample::Source;
+    params[2].bIsJoin = true;
+    params[4].eMode   = TranscodingSample::Source;
+    auto expected     = std::vector<mfxU32>({ 0, 1, 2, 4 });
+    EXPECT_EQ(TranscodingSample::GetRecoveryGroup(params, 2), expected);
+    EXPECT_EQ(TranscodingSample::GetRecoveryGroup(params, 4), expected);
+    EXPECT_EQ(TranscodingSample::GetRecoveryGroup(params, 3), std::vector<mfxU32>({ 3 }));
+}
+
+static std::vector<TranscodingSample::sInputParams> make_ladder(
+    const std::vector<std::string>& inputs) {
+    std::vector<TranscodingSample::sInputParams> params(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        params[i].DecodeId   = MFX_CODEC_AVC;
+        params[i].strSrcFile = inputs[i];
+        params[i].EncodeId   = MFX_CODEC_HEVC;
+        params[i].strDstFile = "out" + std::to_string(i) + ".h265";
+        params[i].nDstWidth  = mfxU16(320 * (i + 1));
+    }
+    return params;
+}
+
+TEST(Transcode_ShareDecode, GroupsSameInput) {
+    auto params = make_ladder({ "a.h264", "b.h264", "a.h264", "a.h264", "b.h264", "c.h264" });
+    auto groups = TranscodingSample::GetSharedDecodeGroups(params);
+    ASSERT_EQ(groups.size(), 2u);
+    EXPECT_EQ(groups[0], std::vector<mfxU32>({ 0, 2, 3 }));
+    EXPECT_EQ(groups[1], std::vector<mfxU32>({ 1, 4 }));
+}
+
+TEST(Transcode_ShareDecode, GroupsNeedSameDecode) {
+    auto params                      = make_ladder({ "a.h264", "a.h264", "a.h264", "a.h264" });
+    params[1].nMemoryModel           = TranscodingSample::VISIBLE_INT_ALLOC;
+    params[2].bDecoderPostProcessing = true;
+    params[3].MaxFrameNumber         = 100;
+    EXPECT_TRUE(TranscodingSample::GetSharedDecodeGroups(params).empty());
+
+    params[3].MaxFrameNumber = MFX_INFINITE;
+    auto groups              = TranscodingSample::GetSharedDecodeGroups(params);
+    ASSERT_EQ(groups.size(), 1u);
+    EXPECT_EQ(groups[0], std::vector<mfxU32>({ 0, 3 }));
+}
+
+TEST(Transcode_ShareDecode, KeepsInterSessionTopology) {
+    auto params     = make_ladder({ "a.h264", "", "a.h264", "a.h264" });
+    params[0].eMode = TranscodingSample::Sink;
+    params[1].eMode = TranscodingSample::Source;
+    EXPECT_TRUE(TranscodingSample::GetSharedDecodeGroups(params).empty());
+
+    auto origins = TranscodingSample::ShareDuplicateDecodes(params);
+    EXPECT_EQ(origins, std::vector<mfxI32>({ 0, 1, 2, 3 }));
+    EXPECT_EQ(params[2].eMode, TranscodingSample::Native);
+}
+
+TEST(Transcode_ShareDecode, GroupsAgreeOnJoin) {
+    auto params       = make_ladder({ "a.h264", "b.h264", "a.h264", "b.h264" });
+    params[1].bIsJoin = true;
+    params[3].bIsJoin = true;
+    auto groups       = TranscodingSample::GetSharedDecodeGroups(params);
+    ASSERT_EQ(groups.size(), 1u);
+    EXPECT_EQ(groups[0], std::vector<mfxU32>({ 0, 2 }));
+}
+
+TEST(Transcode_ShareDecode, RewritesGroupsToSinkAndSources) {
+    auto params           = make_ladder({ "a.h264", "b.h264", "a.h264", "c.h264" });
+    params[0].libType     = MFX_IMPL_HARDWARE_ANY;
+    params[0].nAsyncDepth = 2;
+    params[2].libType     = MFX_IMPL_HARDWARE_ANY;
+    params[2].nAsyncDepth = 2;
+    params[2].SessionName = "hd";
+
+    params[0].dDecoderFrameRateOverride = 25.0;
+    params[2].dDecoderFrameRateOverride = 25.0;
+
+    auto origins = TranscodingSample::ShareDuplicateDecodes(params);
+    EXPECT_EQ(origins, std::vector<mfxI32>({ -1, 0, 2, 1, 3 }));
+    ASSERT_EQ(params.size(), 5u);
+
+    const auto& sink = params[0];
+    EXPECT_EQ(sink.eMode, TranscodingSample::Sink);
+    EXPECT_EQ(sink.strSrcFile, std::string("a.h264"));
+    EXPECT_EQ(sink.DecodeId, (mfxU32)MFX_CODEC_AVC);
+    EXPECT_EQ(sink.libType, (mfxIMPL)MFX_IMPL_HARDWARE_ANY);
+    EXPECT_EQ(sink.nAsyncDepth, 2);
+    EXPECT_EQ(sink.dDecoderFrameRateOverride, 25.0);
+    // the sink only decodes
+    EXPECT_EQ(sink.EncodeId, 0u);
+    EXPECT_TRUE(sink.strDstFile.empty());
+    EXPECT_EQ(sink.nDstWidth, 0);
+
+    for (size_t i : { 1, 2 }) {
+        EXPECT_EQ(params[i].eMode, TranscodingSample::Source);
+        EXPECT_TRUE(params[i].strSrcFile.empty());
+        EXPECT_EQ(params[i].DecodeId, 0u);
+        EXPECT_EQ(params[i].EncodeId, (mfxU32)MFX_CODEC_HEVC);
+    }
+    EXPECT_EQ(params[1].nDstWidth, 320);
+    EXPECT_EQ(params[2].nDstWidth, 960);
+    EXPECT_EQ(params[1].SessionName, std::string("0"));
+    EXPECT_EQ(params[2].SessionName, std::string("hd"));
+
+    EXPECT_EQ(params[3].eMode, TranscodingSample::Native);
+    EXPECT_EQ(params[3].strSrcFile, std::string("b.h264"));
+    EXPECT_EQ(params[3].SessionName, std::string("1"));
+    EXPECT_EQ(params[4].strSrcFile, std::string("c.h264"));
+
+    // the sessions fed by a sink wait for it during initialization
+    auto deps = TranscodingSample::GetSessionInitDependencies(params);
+    EXPECT_EQ(deps[2], std::vector<mfxU32>({ 0 }));
+}
+
+class SafetyBufferLauncher : public TranscodingSample::Launcher {
+public:
+    using Launcher::CreateSafetyBuffers;
+    using Launcher::m_InputParamsArray;
+    using Launcher::m_pBufferArray;
+};
+
+TEST(Transcode_ShareDecode, SinksFeedOnlyTheirOwnSources) {
+    SafetyBufferLauncher launcher;
+    launcher.m_InputParamsArray = make_ladder({ "a.h264", "b.h264", "a.h264", "b.h264", "a.h264" });
+    TranscodingSample::ShareDuplicateDecodes(launcher.m_InputParamsArray);
+    const auto& params = launcher.m_InputParamsArray;
+    ASSERT_EQ(params.size(), 7u);
+    for (size_t i : { 0, 4 })
+        ASSERT_EQ(params[i].eMode, TranscodingSample::Sink);
+
+    ASSERT_EQ(launcher.CreateSafetyBuffers(), MFX_ERR_NONE);
+    ASSERT_EQ(launcher.m_pBufferArray.size(), 5u);
+
+    auto buffers = TranscodingSample::GetOneToManyBuffers(params);
+    EXPECT_EQ(buffers, std::vector<mfxI32>({ 2, 0, 1, 2, 4, 3, 4 }));
+
+    // walking the chain from a sink's buffer visits the buffers of its sources and nothing else
+    for (size_t sink : { 0, 4 }) {
+        std::vector<TranscodingSample::SafetySurfaceBuffer*> expected;
+        for (size_t j = sink + 1; j < params.size() && params[j].eMode != TranscodingSample::Sink;
+             j++)
+            expected.insert(expected.begin(), launcher.m_pBufferArray[buffers[j]].get());
+
+        std::vector<TranscodingSample::SafetySurfaceBuffer*> chain;
+        auto pBuffer = launcher.m_pBufferArray[buffers[sink]].get();
+        while (pBuffer) {
+            chain.push_back(pBuffer);
+            pBuffer = pBuffer->m_pNext;
+        }
+        EXPECT_EQ(chain, expected);
+    }
+
+    // a sink without sources has no buffer to feed
+    launcher.m_InputParamsArray[5].eMode = TranscodingSample::Sink;
+    launcher.m_InputParamsArray[6].eMode = TranscodingSample::Sink;
+    buffers = TranscodingSample::GetOneToManyBuffers(params);
+    EXPECT_EQ(buffers, std::vector<mfxI32>({ 2, 0, 1, 2, -1, -1, -1 }));
+}
+
+TEST(Transcode_Robust, OutputOffsetTracksWrittenBytes) {
+    const char* name = "temp_robust_out.h265";
+    do {
+        std::shared_ptr<CSmplBitstreamWriter> writer(new CSmplBitstreamWriter);
+        ASSERT_EQ(writer->Init(name), MFX_ERR_NONE);
+
+        TranscodingSample::FileBitstreamProcessor processor;
+        processor.SetWriter(writer);
+
+        mfxBitstreamWrapper bs(64);
+        bs.DataLength = 10;
+        EXPECT_EQ(processor.ProcessOutputBitstream(&bs), MFX_ERR_NONE);
+        bs.DataLength = 20;
+        EXPECT_EQ(processor.ProcessOutputBitstream(&bs), MFX_ERR_NONE);
+        EXPECT_EQ(processor.GetOutputOffset(), 30u);
+
+        // a resumed session writes again from its checkpoint
+        EXPECT_EQ(processor.TruncateOutput(10), MFX_ERR_NONE);
+        EXPECT_EQ(processor.GetOutputOffset(), 10u);
+        bs.DataLength = 5;
+        EXPECT_EQ(processor.ProcessOutputBitstream(&bs), MFX_ERR_NONE);
+        EXPECT_EQ(processor.GetOutputOffset(), 15u);
+        writer->Close();
+        std::ifstream written(name, std::ios::binary | std::ios::ate);
+        EXPECT_EQ((mfxU64)written.tellg(), 15u);
+        ASSERT_EQ(writer->Init(name), MFX_ERR_NONE);
+
+        EXPECT_EQ(processor.ResetOutput(), MFX_ERR_NONE);
+        EXPECT_EQ(processor.GetOutputOffset(), 0u);
+    } while (0);
+    remove(name);
+}
+
+static void set_env(const char* name, const std::string& value) {
+#if defined(_WIN32) || defined(_WIN64)
+    _putenv_s(name, value.c_str());
+#else
+    setenv(name, value.c_str(), 1);
+#endif
+}
+
+struct EncodedFrame {
+    unsigned frame;
+    unsigned data;
+    unsigned idr;
+};
+
+// Reads the lines the encoder of test/runtime/hang_stubs.cpp writes for every frame
+static std::vector<EncodedFrame> read_encoded_frames(const char* name) {
+    std::vector<EncodedFrame> frames;
+    FILE* f = fopen(name, "r");
+    EncodedFrame frame;
+    while (f && fscanf(f, "frame %u data %u idr %u\n", &frame.frame, &frame.data, &frame.idr) == 3)
+        frames.push_back(frame);
+    if (f)
+        fclose(f);
+    return frames;
+}
+
+// Session 0 of two joined sessions hangs on the stub runtime of test/runtime/hang_stubs.cpp once
+// session 1 has completed. Frame i of the input has luma value i. Only session 0 is rebuilt, it
+// writes again from its last IDR frame, so every frame is in its output once and in order.
+TEST(Transcode_Robust, ResumesHungSessionFromLastIDR) {
+    if (!getenv("ONEVPL_SEARCH_PATH"))
+        GTEST_SKIP() << "ONEVPL_SEARCH_PATH has to point to the vplsmttestrt runtime";
+    set_env("SMT_TEST_RT_HANG", "6");
+
+    const char* inFile  = "temp_robust_in.yuv";
+    const char* parFile = "temp_robust.par";
+    const char* outA    = "temp_robust_a.h265";
+    const char* outB    = "temp_robust_b.h265";
+    const int numFrames = 12;
+    {
+        std::ofstream in(inFile, std::ios::binary);
+        for (int i = 0; i < numFrames; i++) {
+            in << std::string(64 * 64, (char)i) << std::string(64 * 64 / 2, (char)128);
+        }
+        std::ofstream par(parFile);
+        par << "-i::i420 " << inFile << " -w 64 -h 64 -o::h265 " << outA
+            << " -sw -gop_size 4 -join -robust\n";
+        par << "-i::i420 " << inFile << " -w 64 -h 64 -o::h265 " << outB
+            << " -sw -gop_size 4 -join -robust -n 3\n";
+    }
+
+    std::vector<std::string> opts({ "sample_multi_transcode", "-par", parFile });
+    std::vector<char*> args;
+    for (auto& opt : opts) {
+        args.push_back(&opt[0]);
+    }
+    args.push_back(nullptr);
+
+    mfxStatus sts = MFX_ERR_NONE;
+    testing::internal::CaptureStdout();
+    {
+        TranscodingSample::Launcher launcher;
+        sts = launcher.Init((int)opts.size(), args.data());
+        if (sts == MFX_ERR_NONE) {
+            launcher.Run();
+            sts = launcher.ProcessResult();
+        }
+    }
+    fflush(stdout);
+    std::string out = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(sts, MFX_ERR_NONE) << out;
+    EXPECT_NE(out.find("Trying to recover session(s) 0...\n"), std::string::npos) << out;
+    EXPECT_NE(out.find("Resuming from IDR frame 4 at output offset 84\n"), std::string::npos);
+
+    auto framesA = read_encoded_frames(outA);
+    ASSERT_EQ(framesA.size(), (size_t)numFrames);
+    for (int i = 0; i < numFrames; i++) {
+        EXPECT_EQ(framesA[i].data, (unsigned)i);
+        EXPECT_EQ(framesA[i].idr, (unsigned)(i % 4 == 0)) << i;
+    }
+    // the rebuilt encoder started at the IDR frame
+    EXPECT_EQ(framesA[4].frame, 0u);
+
+    auto framesB = read_encoded_frames(outB);
+    ASSERT_EQ(framesB.size(), 3u);
+    for (unsigned i = 0; i < 3; i++) {
+        EXPECT_EQ(framesB[i].frame, i);
+        EXPECT_EQ(framesB[i].data, i);
+    }
+
+    remove(inFile);
+    remove(parFile);
+    remove(outA);
+    remove(outB);
+}
+
+TEST(Transcode_Bitstream, SizeClasses) {
+    EXPECT_EQ(BitstreamBufferPool::GetClassSize(1), 4096u);
+    EXPECT_EQ(BitstreamBufferPool::GetClassSize(4096), 4096u);
+    EXPECT_EQ(BitstreamBufferPool::GetClassSize(4097), 5120u);
+    EXPECT_EQ(BitstreamBufferPool::GetClassSize(8192), 8192u);
+    EXPECT_EQ(BitstreamBufferPool::GetClassSize(1500000), 1572864u);
+    EXPECT_EQ(BitstreamBufferPool::GetClassSize(1u << 21), 1u << 21);
+}
+
+TEST(Transcode_Bitstream, PoolReusesReleasedBuffers) {
+    BitstreamBufferPool pool;
+    mfxU32 capacity = 0;
+    mfxU8* first    = pool.Acquire(100000, &capacity);
+    EXPECT_EQ(capacity, BitstreamBufferPool::GetClassSize(100000));
+    pool.Release(first, capacity);
+
+    mfxU32 other = 0;
+    EXPECT_EQ(pool.Acquire(99000, &other), first);
+    EXPECT_EQ(other, capacity);
+    mfxU8* second = pool.Acquire(99000, &other);
+    EXPECT_NE(second, first);
+    pool.Release(first, capacity);
+    pool.Release(second, other);
+
+    auto stat = pool.GetStatistics();
+    EXPECT_EQ(stat.Allocations, 2u);
+    EXPECT_EQ(stat.Reuses, 1u);
+    EXPECT_EQ(stat.PeakResident, 2u * capacity);
+    EXPECT_EQ(stat.PeakInUse, 2u * capacity);
+    EXPECT_EQ(stat.InUse, 0u);
+}
+
+TEST(Transcode_Bitstream, WrapperExtendKeepsData) {
+    auto pool = std::make_shared<BitstreamBufferPool>();
+    do {
+        mfxBitstreamWrapper bs;
+        bs.SetPool(pool);
+        bs.Extend(5000);
+        EXPECT_EQ(bs.MaxLength, 5120u);
+        //growing inside of the size class doesn't touch storage
+        mfxU8* data = bs.Data;
+        bs.Extend(5100);
+        EXPECT_EQ(bs.Data, data);
+
+        bs.DataOffset = 2;
+        bs.DataLength = 3;
+        std::fill(bs.Data, bs.Data + 5, 7);
+        bs.Extend(100000);
+        EXPECT_NE(bs.Data, data);
+        EXPECT_EQ(bs.DataOffset, 2u);
+        EXPECT_EQ(bs.DataLength, 3u);
+        EXPECT_EQ(std::count(bs.Data, bs.Data + 5, 7), 5);
+        EXPECT_EQ(pool->GetStatistics().InUse, BitstreamBufferPool::GetClassSize(100000));
+
+        mfxBitstreamWrapper copy(bs);
+        EXPECT_NE(copy.Data, bs.Data);
+        EXPECT_EQ(copy.MaxLength, bs.MaxLength);
+        EXPECT_EQ(std::count(copy.Data, copy.Data + 5, 7), 5);
+
+        mfxBitstreamWrapper moved(std::move(copy));
+        EXPECT_EQ(copy.Data, nullptr);
+        EXPECT_EQ(std::count(moved.Data, moved.Data + 5, 7), 5);
+
+        bs.ReleaseBuffer();
+        EXPECT_EQ(bs.Data, nullptr);
+        EXPECT_EQ(bs.MaxLength, 0u);
+    } while (0);
+    EXPECT_EQ(pool->GetStatistics().InUse, 0u);
+}
+
+TEST(Transcode_Bitstream, StoresShareReleasedBuffers) {
+    auto pool = std::make_shared<BitstreamBufferPool>();
+    TranscodingSample::ExtendedBSStore first(4, pool);
+    TranscodingSample::ExtendedBSStore second(4, pool);
+
+    //sessions encode one after another, finished frames give storage back
+    for (int frame = 0; frame < 10; frame++) {
+        for (auto store : { &first, &second }) {
+            TranscodingSample::ExtendedBS* pBS = store->GetNext();
+            ASSERT_NE(pBS, nullptr);
+            EXPECT_EQ(pBS->Bitstream.Data, nullptr);
+            pBS->Bitstream.Extend(1000000);
+            pBS->Bitstream.DataLength = 1000;
+            store->Release(pBS);
+        }
+    }
+
+    auto stat = pool->GetStatistics();
+    EXPECT_EQ(stat.Allocations, 1u);
+    EXPECT_EQ(stat.Reuses, 19u);
+    EXPECT_EQ(stat.PeakResident, BitstreamBufferPool::GetClassSize(1000000));
+    EXPECT_EQ(stat.InUse, 0u);
+}
+
+TEST(Transcode_Bitstream, StoreWithoutPoolKeepsBuffers) {
+    TranscodingSample::ExtendedBSStore store(1);
+    TranscodingSample::ExtendedBS* pBS = store.GetNext();
+    ASSERT_NE(pBS, nullptr);
+    pBS->Bitstream.Extend(1000);
+    mfxU8* data = pBS->Bitstream.Data;
+    store.Release(pBS);
+    EXPECT_EQ(store.GetNext()->Bitstream.Data, data);
+}
+
+namespace {
+
+TranscodingSample::CascadeScalerConfig::TargetDescriptor cascade_target(mfxU32 id,
+                                                                         mfxU16 width,
+                                                                         mfxU16 height,
+                                                                         bool cascade = true) {
+    TranscodingSample::CascadeScalerConfig::TargetDescriptor desc;
+    desc.TargetID      = id;
+    desc.DstWidth      = width;
+    desc.DstHeight     = height;
+    desc.CascadeScaler = cascade;
+    return desc;
+}
+
+mfxU32 cascade_source(TranscodingSample::CascadeScalerConfig& cfg, mfxU32 id) {
+    return cfg.GetDesc(id).SrcTargetID;
+}
+
+} // namespace
+
+TEST(Transcode_Cascade, TreeScalesFromNearestLarger) {
+    TranscodingSample::CascadeScalerConfig cfg;
+    cfg.Targets.push_back(cascade_target(101, 640, 360));
+    cfg.Targets.push_back(cascade_target(102, 1920, 1080));
+    cfg.Targets.push_back(cascade_target(103, 1280, 720));
+    cfg.Targets.push_back(cascade_target(104, 320, 180));
+    cfg.BuildScalingTree();
+
+    EXPECT_EQ(cascade_source(cfg, 102), TranscodingSample::DecoderTargetID);
+    EXPECT_EQ(cascade_source(cfg, 103), 102u);
+    EXPECT_EQ(cascade_source(cfg, 101), 103u);
+    EXPECT_EQ(cascade_source(cfg, 104), 101u);
+    EXPECT_EQ(cfg.DispatchOrder, std::vector<mfxU32>({ 102, 103, 101, 104 }));
+
+    cfg.CreatePoolList();
+    EXPECT_EQ(cfg.Pools[13].PrevID, 12u);
+    EXPECT_EQ(cfg.Pools[11].PrevID, 13u);
+    EXPECT_EQ(cfg.Pools[14].PrevID, 11u);
+}
+
+TEST(Transcode_Cascade, TreeKeepsFRCAndDI) {
+    TranscodingSample::CascadeScalerConfig cfg;
+    cfg.Targets.push_back(cascade_target(101, 640, 360));
+    cfg.Targets.push_back(cascade_target(102, 1920, 1080));
+    cfg.Targets[1].DI = true;
+    cfg.Targets.push_back(cascade_target(103, 1280, 720));
+    cfg.Targets.push_back(cascade_target(104, 960, 540));
+    cfg.Targets[3].FRC          = true;
+    cfg.Targets[3].DstFrameRate = 30.;
+    cfg.Targets.push_back(cascade_target(105, 320, 180, false));
+    cfg.BuildScalingTree();
+
+    //101 is before deinterlacing in par file, so it is still scaled from the decoder
+    EXPECT_EQ(cascade_source(cfg, 101), TranscodingSample::DecoderTargetID);
+    EXPECT_EQ(cascade_source(cfg, 102), TranscodingSample::DecoderTargetID);
+    EXPECT_EQ(cascade_source(cfg, 103), 102u);
+    EXPECT_EQ(cascade_source(cfg, 104), 103u);
+    //105 gets frame rate of 104
+    EXPECT_EQ(cascade_source(cfg, 105), 104u);
+}
+
+TEST(Transcode_Cascade, TreeHasNoCyclesForEqualSizes) {
+    TranscodingSample::CascadeScalerConfig cfg;
+    cfg.Targets.push_back(cascade_target(101, 1280, 720));
+    cfg.Targets.push_back(cascade_target(102, 1280, 720));
+    cfg.Targets.push_back(cascade_target(103, 1280, 720, false));
+    cfg.BuildScalingTree();
+
+    EXPECT_EQ(cascade_source(cfg, 101), TranscodingSample::DecoderTargetID);
+    EXPECT_EQ(cascade_source(cfg, 102), 101u);
+    EXPECT_EQ(cascade_source(cfg, 103), 102u);
+    EXPECT_EQ(cfg.DispatchOrder.size(), 3u);
+
+    cfg.CreatePoolList();
+    EXPECT_EQ(cfg.GetDesc(103).PoolID, 12u);
+}
+
+TEST(Transcode_Cascade, DispatchPutsDeadlineFirst) {
+    TranscodingSample::CascadeScalerConfig cfg;
+    cfg.Targets.push_back(cascade_target(101, 640, 360));
+    cfg.Targets.push_back(cascade_target(102, 1920, 1080));
+    cfg.Targets[1].DI = true;
+    cfg.Targets.push_back(cascade_target(103, 1280, 720));
+    cfg.BuildScalingTree();
+    EXPECT_EQ(cascade_source(cfg, 103), 102u);
+    EXPECT_EQ(cfg.DispatchOrder, std::vector<mfxU32>({ 101, 102, 103 }));
+
+    //source of 103 gets its deadline too
+    cfg.Targets[2].LatencyBudget = 10;
+    cfg.BuildScalingTree();
+    EXPECT_EQ(cfg.DispatchOrder, std::vector<mfxU32>({ 102, 103, 101 }));
+}
+
+TEST(Transcode_Cascade, DispatchPriorityAndBudget) {
+    TranscodingSample::CascadeScalerConfig cfg;
+    cfg.Targets.push_back(cascade_target(101, 960, 540));
+    cfg.Targets[0].LatencyBudget = 40;
+    cfg.Targets.push_back(cascade_target(102, 1920, 1080));
+    cfg.Targets[1].DI = true;
+    cfg.Targets.push_back(cascade_target(103, 1280, 720));
+    cfg.Targets[2].Priority = 2;
+    cfg.Targets.push_back(cascade_target(104, 640, 360, false));
+    cfg.BuildScalingTree();
+
+    //budget goes before priority, priority before par file order
+    EXPECT_EQ(cascade_source(cfg, 104), 103u);
+    EXPECT_EQ(cfg.DispatchOrder, std::vector<mfxU32>({ 101, 102, 103, 104 }));
+
+    cfg.Targets[0].LatencyBudget = 0;
+    cfg.BuildScalingTree();
+    EXPECT_EQ(cfg.DispatchOrder, std::vector<mfxU32>({ 102, 103, 101, 104 }));
+
+    cfg.Targets[3].Priority = 3;
+    cfg.BuildScalingTree();
+    EXPECT_EQ(cfg.DispatchOrder, std::vector<mfxU32>({ 102, 103, 104, 101 }));
+}
+
+TEST(Transcode_Cascade, PropagateAlongTree) {
+    TranscodingSample::CascadeScalerConfig cfg;
+    cfg.Targets.push_back(cascade_target(101, 1280, 720));
+    cfg.Targets[0].FRC          = true;
+    cfg.Targets[0].DstFrameRate = 30.;
+    cfg.Targets.push_back(cascade_target(102, 320, 180, false));
+    cfg.Targets[1].FRC          = true;
+    cfg.Targets[1].DstFrameRate = 15.;
+    cfg.Targets.push_back(cascade_target(103, 640, 360));
+    cfg.BuildScalingTree();
+    cfg.CreatePoolList();
+
+    cfg.Targets[0].SrcWidth     = 1920;
+    cfg.Targets[0].SrcHeight    = 1080;
+    cfg.Targets[0].SrcFrameRate = 60.;
+    cfg.Targets[0].SrcPicStruct = MFX_PICSTRUCT_PROGRESSIVE;
+    cfg.PropagateCascadeParameters();
+
+    auto desc = cfg.GetDesc(103);
+    EXPECT_EQ(desc.SrcTargetID, 101u);
+    EXPECT_EQ(desc.SrcWidth, 1280);
+    EXPECT_EQ(desc.DstFrameRate, 30.);
+    //102 is scaled from the smallest cascade output, which is after it in par file
+    desc = cfg.GetDesc(102);
+    EXPECT_EQ(desc.SrcTargetID, 103u);
+    EXPECT_EQ(desc.PoolID, 13u);
+    EXPECT_EQ(desc.SrcWidth, 640);
+    EXPECT_EQ(desc.SrcHeight, 360);
+    EXPECT_EQ(desc.SrcFrameRate, 30.);
+    EXPECT_EQ(desc.DstFrameRate, 15.);
+    EXPECT_EQ(cfg.Pools[TranscodingSample::DecoderPoolID].SurfaceWidth, 1920);
+}
+
+namespace {
+
+// Cascade scaling of a decoding session with VPP replaced: scaling returns the surface of the
+// target at once and the rendition completes scaleMs after the decoding session waits for it
+class TestCascadePipeline : public TranscodingSample::CTranscodingPipeline {
+public:
+    struct Dispatch {
+        mfxU32 TargetID;
+        mfxFrameSurface1* pIn;
+        std::vector<mfxU32> Published; // targets with a rendition in their buffer at the time
+    };
+
+    explicit TestCascadePipeline(mfxU32 scaleMs) : m_scaleMs(scaleMs) {}
+
+    typedef TranscodingSample::CascadeScalerConfig::TargetDescriptor Target;
+
+    void SetTargets(const std::vector<Target>& t) {
+        m_ScalerConfig.Targets = t;
+        m_ScalerConfig.BuildScalingTree();
+        m_ScalerConfig.CreatePoolList();
+        m_ScalerConfig.CascadeScalerRequired = true;
+
+        m_buffers.clear();
+        TranscodingSample::SafetySurfaceBuffer* pNext = NULL;
+        for (const auto& desc : t) {
+            m_buffers.emplace_back(new TranscodingSample::SafetySurfaceBuffer(pNext));
+            m_buffers.back()->TargetID = desc.TargetID;
+            pNext                      = m_buffers.back().get();
+        }
+        m_pBuffer = pNext;
+    }
+
+    mfxStatus ScaleFrame(mfxFrameSurface1* pDecoded,
+                         std::vector<TranscodingSample::ExtendedSurface>& out) {
+        TranscodingSample::ExtendedSurface dec = {}, last = {};
+        dec.pSurface                           = pDecoded;
+        return CascadeScaleFrame(dec, last, out, false);
+    }
+
+    TranscodingSample::SafetySurfaceBuffer* GetBuffer(mfxU32 targetID) {
+        for (auto& buffer : m_buffers) {
+            if (buffer->TargetID == targetID)
+                return buffer.get();
+        }
+        return NULL;
+    }
+
+    mfxFrameSurface1 m_surfaces[4] = {};
+    std::vector<Dispatch> m_dispatched;
+    std::vector<mfxU32> m_synced;
+
+protected:
+    mfxStatus VPPOneFrame(TranscodingSample::ExtendedSurface* pSurfaceIn,
+                          TranscodingSample::ExtendedSurface* pExtSurface,
+                          mfxU32 ID) override {
+        Dispatch d = { ID, pSurfaceIn->pSurface, {} };
+        for (auto& buffer : m_buffers) {
+            if (buffer->GetLength())
+                d.Published.push_back(buffer->TargetID);
+        }
+        m_dispatched.push_back(d);
+
+        pExtSurface->pSurface = &m_surfaces[ID % 4];
+        pExtSurface->Syncp    = (mfxSyncPoint)pExtSurface->pSurface;
+        return MFX_ERR_NONE;
+    }
+
+    mfxStatus SyncRendition(TranscodingSample::ExtendedSurface& Surf) override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_scaleMs));
+        m_synced.push_back(Surf.TargetID);
+        Surf.Syncp = NULL;
+        return MFX_ERR_NONE;
+    }
+
+    mfxU32 m_scaleMs;
+    std::vector<std::unique_ptr<TranscodingSample::SafetySurfaceBuffer>> m_buffers;
+};
+
+} // namespace
+
+TEST(Transcode_Cascade, ScaleFramePublishesDeadlineRenditionsOnceScaled) {
+    TestCascadePipeline pipeline(40);
+    std::vector<TranscodingSample::CascadeScalerConfig::TargetDescriptor> targets;
+    targets.push_back(cascade_target(101, 640, 360));
+    targets.push_back(cascade_target(102, 1920, 1080));
+    targets.push_back(cascade_target(103, 320, 180, false));
+    targets.push_back(cascade_target(104, 1280, 720));
+    targets[3].LatencyBudget = 30;
+    pipeline.SetTargets(targets);
+
+    mfxFrameSurface1 decoded = {};
+    std::vector<TranscodingSample::ExtendedSurface> out;
+    ASSERT_EQ(pipeline.ScaleFrame(&decoded, out), MFX_ERR_NONE);
+
+    //104 and its source go first, every target is scaled from the output of its source
+    ASSERT_EQ(pipeline.m_dispatched.size(), 3u);
+    EXPECT_EQ(pipeline.m_dispatched[0].TargetID, 102u);
+    EXPECT_EQ(pipeline.m_dispatched[0].pIn, &decoded);
+    EXPECT_EQ(pipeline.m_dispatched[1].TargetID, 104u);
+    EXPECT_EQ(pipeline.m_dispatched[1].pIn, &pipeline.m_surfaces[102 % 4]);
+    EXPECT_EQ(pipeline.m_dispatched[2].TargetID, 101u);
+    EXPECT_EQ(pipeline.m_dispatched[2].pIn, &pipeline.m_surfaces[104 % 4]);
+
+    //104 is in its buffer, scaled, before 101 is dispatched, the rest waits for the whole tree
+    EXPECT_EQ(pipeline.m_dispatched[1].Published, std::vector<mfxU32>());
+    EXPECT_EQ(pipeline.m_dispatched[2].Published, std::vector<mfxU32>({ 104 }));
+    EXPECT_EQ(pipeline.m_synced, std::vector<mfxU32>({ 104 }));
+    TranscodingSample::ExtendedSurface published = {};
+    ASSERT_EQ(pipeline.GetBuffer(104)->GetSurface(published), MFX_ERR_NONE);
+    EXPECT_EQ(published.pSurface, &pipeline.m_surfaces[104 % 4]);
+    EXPECT_EQ(published.Syncp, nullptr);
+
+    ASSERT_EQ(out.size(), 3u);
+    EXPECT_EQ(out[0].TargetID, 102u);
+    EXPECT_EQ(out[1].TargetID, 101u);
+    EXPECT_EQ(out[2].TargetID, 103u);
+    EXPECT_EQ(out[2].pSurface, &pipeline.m_surfaces[101 % 4]);
+
+    //latency counts until scaling is complete, so 40 ms of scaling misses the 30 ms budget
+    const auto& latency = pipeline.GetRenditionLatency();
+    ASSERT_EQ(latency.size(), 1u);
+    const TranscodingSample::RenditionLatency& stat = latency.at(104);
+    EXPECT_EQ(stat.Frames, 1u);
+    EXPECT_EQ(stat.Missed, 1u);
+    EXPECT_GE(1000. * stat.Total / msdk_time_get_frequency(), 40.);
+}
+
+namespace {
+
+// Reference copies of the former -roi_file parser and MBQP map fill, the streaming reader and
+// the rasterizer must produce the same output
+bool ref_parse_roi(const std::string& content, std::vector<mfxExtEncoderROI>& roiData) {
+    roiData.clear();
+    for (char c : content) {
+        if (!std::isdigit(c) && !std::isspace(c) && c != ';' && c != '-')
+            return false;
+    }
+
+    std::string unformatted;
+    for (char c : content) {
+        if (!std::isspace(c))
+            unformatted.push_back(c);
+    }
+
+    std::vector<std::string> items;
+    std::string item;
+    std::stringstream ss(unformatted);
+    while (getline(ss, item, ';'))
+        items.push_back(item);
+
+    size_t item_ind = 0;
+    while (item_ind < items.size()) {
+        mfxExtEncoderROI frame_roi;
+        std::memset(&frame_roi, 0, sizeof(frame_roi));
+        frame_roi.Header.BufferId = MFX_EXTBUFF_ENCODER_ROI;
+        frame_roi.ROIMode         = MFX_ROI_MODE_QP_DELTA;
+
+        int roi_num = std::atoi(items[item_ind].c_str());
+        if (roi_num < 0 || roi_num > (int)(sizeof(frame_roi.ROI) / sizeof(frame_roi.ROI[0])) ||
+            (item_ind + 5 * roi_num) >= items.size()) {
+            roiData.clear();
+            return false;
+        }
+
+        for (int i = 0; i < roi_num; i++) {
+            frame_roi.ROI[i].Left    = std::atoi(items[item_ind + i * 5 + 1].c_str());
+            frame_roi.ROI[i].Top     = std::atoi(items[item_ind + i * 5 + 2].c_str());
+            frame_roi.ROI[i].Right   = std::atoi(items[item_ind + i * 5 + 3].c_str());
+            frame_roi.ROI[i].Bottom  = std::atoi(items[item_ind + i * 5 + 4].c_str());
+            frame_roi.ROI[i].DeltaQP = (mfxI16)std::atoi(items[item_ind + i * 5 + 5].c_str());
+        }
+        frame_roi.NumROI = (mfxU16)roi_num;
+        roiData.push_back(frame_roi);
+        item_ind = item_ind + roi_num * 5 + 1;
+    }
+    return true;
+}
+
+void ref_fill_frame(mfxU8* qp,
+                    mfxU32 width,
+                    mfxU32 height,
+                    mfxU32 numQP,
+                    mfxI8 fQP,
+                    const mfxExtEncoderROI& roi,
+                    bool hevcLowPower) {
+    std::memset(qp, fQP, numQP);
+    for (mfxI32 i = roi.NumROI - 1; i >= 0; i--) {
+        mfxU32 l = (roi.ROI[i].Left) >> 4, t = (roi.ROI[i].Top) >> 4,
+               r = (roi.ROI[i].Right + 15) >> 4, b = (roi.ROI[i].Bottom + 15) >> 4;
+        if (hevcLowPower) {
+            l = ((roi.ROI[i].Left) >> 5) << 1;
+            t = ((roi.ROI[i].Top) >> 5) << 1;
+            r = ((roi.ROI[i].Right + 31) >> 5) << 1;
+            b = ((roi.ROI[i].Bottom + 31) >> 5) << 1;
+        }
+        l = std::min(l, width);
+        r = std::min(r, width);
+        t = std::min(t, height);
+        b = std::min(b, height);
+
+        mfxI8 qp_value = (mfxI8)std::min(std::max(fQP + (mfxI8)roi.ROI[i].DeltaQP, 0), 51);
+        for (mfxU32 k = t; k < b; k++)
+            std::memset(qp + k * width + l, qp_value, r - l);
+    }
+}
+
+void ref_fill_field(mfxU8* qp,
+                    mfxU32 width,
+                    mfxU32 height,
+                    mfxU32 numQP,
+                    mfxU32 fQP,
+                    const mfxExtEncoderROI& roi) {
+    std::memset(qp, fQP, numQP);
+    for (mfxI32 i = roi.NumROI - 1; i >= 0; i--) {
+        mfxU32 l = (roi.ROI[i].Left) >> 4, t = (roi.ROI[i].Top) >> 5,
+               r = (roi.ROI[i].Right + 15) >> 4, b = (roi.ROI[i].Bottom + 31) >> 5;
+        mfxI8 qp_delta = (mfxI8)roi.ROI[i].DeltaQP;
+        mfxU8 roi_qp   = (mfxU8)std::min(std::max(mfxI8(fQP) + qp_delta, 0), 51);
+
+        l = std::min(l, width);
+        r = std::min(r, width);
+        t = std::min(t, height / 2);
+        b = std::min(b, height / 2);
+
+        for (mfxU32 k = t; k < b; k++)
+            std::memset(qp + k * width + l, roi_qp, r - l);
+    }
+}
+
+// Deterministic ROI lists with overlapping, empty and out of frame rectangles
+std::vector<mfxExtEncoderROI> make_roi_lists(mfxU32 count, mfxU32 frameW, mfxU32 frameH) {
+    std::vector<mfxExtEncoderROI> lists;
+    mfxU32 seed = 12345;
+    auto next   = [&seed](mfxU32 range) {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 8) % range;
+    };
+
+    for (mfxU32 n = 0; n < count; n++) {
+        mfxExtEncoderROI roi;
+        std::memset(&roi, 0, sizeof(roi));
+        roi.Header.BufferId = MFX_EXTBUFF_ENCODER_ROI;
+        roi.ROIMode         = MFX_ROI_MODE_QP_DELTA;
+        roi.NumROI          = (mfxU16)next(9);
+        for (mfxU16 i = 0; i < roi.NumROI; i++) {
+            roi.ROI[i].Left    = next(frameW + 64);
+            roi.ROI[i].Top     = next(frameH + 64);
+            roi.ROI[i].Right   = roi.ROI[i].Left + next(frameW / 2);
+            roi.ROI[i].Bottom  = roi.ROI[i].Top + next(frameH / 2);
+            roi.ROI[i].DeltaQP = (mfxI16)((mfxI32)next(81) - 40);
+        }
+        lists.push_back(roi);
+    }
+    return lists;
+}
+
+std::string format_roi_lists(const std::vector<mfxExtEncoderROI>& lists) {
+    std::stringstream ss;
+    for (const auto& roi : lists) {
+        ss << roi.NumROI << ";";
+        for (mfxU16 i = 0; i < roi.NumROI; i++) {
+            ss << roi.ROI[i].Left << ";" << roi.ROI[i].Top << ";" << roi.ROI[i].Right << ";"
+               << roi.ROI[i].Bottom << ";" << roi.ROI[i].DeltaQP << ";";
+        }
+        ss << "\n";
+    }
+    return ss.str();
+}
+
+void expect_same_roi(const mfxExtEncoderROI* actual, const mfxExtEncoderROI& expected) {
+    ASSERT_NE(actual, nullptr);
+    EXPECT_EQ(std::memcmp(actual, &expected, sizeof(expected)), 0);
+}
+
+} // namespace
+
+TEST(Transcode_ROI, FileMatchesFormerParser) {
+    const char* name = "temp_roi_file.txt";
+
+    std::vector<std::string> contents = {
+        "",
+        "0",
+        "0;0;0;",
+        "1;0;0;64;64;-5",
+        "1;0;0;64;64;-5;",
+        "2; 16 ;32;48\n;64;10;\r\n100;100;200;200;-51;\n0;\n",
+        "1;1 6;3 2;4 8;6 4;- 3;",
+        "1;;;;;;0",
+        "1;0;0;64;64;-5;;",
+        "1;0;0;64;64",
+        "1;0;0;64;64;x",
+        "-1;",
+        "257;",
+        "0;a",
+    };
+    contents.push_back(format_roi_lists(make_roi_lists(300, 1920, 1080)));
+
+    for (const std::string& content : contents) {
+        write_file(name, content);
+
+        std::vector<mfxExtEncoderROI> expected;
+        bool valid = ref_parse_roi(content, expected);
+
+        auto file = TranscodingSample::ROIFile::Open(name);
+        EXPECT_EQ(file != nullptr, valid) << content;
+        if (!file || !valid)
+            continue;
+
+        ASSERT_EQ(file->GetFrameCount(), expected.size()) << content;
+
+        TranscodingSample::ROIReader reader;
+        ASSERT_EQ(reader.Init(file), MFX_ERR_NONE);
+        for (mfxU32 i = 0; i < expected.size(); i++)
+            expect_same_roi(reader.GetFrame(i), expected[i]);
+        EXPECT_EQ(reader.GetFrame((mfxU32)expected.size()), nullptr);
+    }
+    remove(name);
+}
+
+TEST(Transcode_ROI, ReaderRandomAccess) {
+    const char* name = "temp_roi_file.txt";
+    auto lists       = make_roi_lists(200, 1280, 720);
+    write_file(name, format_roi_lists(lists));
+
+    auto file = TranscodingSample::ROIFile::Open(name);
+    ASSERT_TRUE(file);
+    ASSERT_EQ(file->GetFrameCount(), 200u);
+
+    // readers of different sessions share one file
+    TranscodingSample::ROIReader reader1, reader2;
+    ASSERT_EQ(reader1.Init(file), MFX_ERR_NONE);
+    ASSERT_EQ(reader2.Init(file), MFX_ERR_NONE);
+    for (mfxU32 frame : { 150, 3, 3, 4, 63, 64, 65, 199, 0, 130, 128, 127 }) {
+        expect_same_roi(reader1.GetFrame(frame), lists[frame]);
+        expect_same_roi(reader2.GetFrame(199 - frame), lists[199 - frame]);
+    }
+    EXPECT_EQ(reader1.GetFrame(200), nullptr);
+    expect_same_roi(reader1.GetFrame(10), lists[10]);
+    remove(name);
+}
+
+TEST(Transcode_ROI, RasterizerFrameMatchesFormerFill) {
+    for (bool hevcLowPower : { false, true }) {
+        for (auto size : { std::make_pair(1920u, 1080u), std::make_pair(720u, 480u) }) {
+            mfxU32 width  = (size.first + 15) >> 4;
+            mfxU32 height = (size.second + 15) >> 4;
+            mfxU32 numQP  = width * height;
+
+            TranscodingSample::MBQPRasterizer rasterizer;
+            rasterizer.Init(width, height, hevcLowPower ? 32 : 16, 4);
+
+            auto lists = make_roi_lists(64, size.first, size.second);
+            std::vector<mfxU8> expected(numQP), actual(numQP);
+            // lists are repeated to hit the cache, QP changes to miss it
+            for (mfxU32 n = 0; n < 3 * lists.size(); n++) {
+                const mfxExtEncoderROI& roi = lists[n < lists.size() ? n : (n * 7) % 5];
+                mfxU32 fQP                  = (n % 3) ? 30 : 22;
+
+                ref_fill_frame(&expected[0], width, height, numQP, (mfxI8)fQP, roi, hevcLowPower);
+                std::fill(actual.begin(), actual.end(), 0xCD);
+                rasterizer.FillFrame(&actual[0], numQP, fQP, &roi);
+                ASSERT_EQ(expected, actual) << "frame " << n;
+            }
+            EXPECT_GT(rasterizer.GetCacheHits(), 0u);
+        }
+    }
+}
+
+TEST(Transcode_ROI, RasterizerFieldMatchesFormerFill) {
+    mfxU32 width  = (720 + 15) >> 4;
+    mfxU32 height = (576 + 15) >> 4;
+    mfxU32 numQP  = width * height;
+
+    TranscodingSample::MBQPRasterizer rasterizer;
+    rasterizer.Init(width, height, 16);
+
+    auto lists = make_roi_lists(64, 720, 576);
+    std::vector<mfxU8> expected(numQP), actual(numQP);
+    for (mfxU32 n = 0; n < lists.size(); n++) {
+        // TFF and BFF maps place fields in different halves
+        mfxU32 off[2] = { 0, numQP / 2 };
+        if (n % 2)
+            std::swap(off[0], off[1]);
+
+        for (int fld = 0; fld <= 1; fld++) {
+            const mfxExtEncoderROI& roi = lists[(2 * n + fld) % lists.size()];
+            mfxU32 fQP                  = fld ? 28 : 24;
+            ref_fill_field(&expected[off[fld]], width, height, numQP / 2, fQP, roi);
+            rasterizer.FillField(&actual[off[fld]], numQP / 2, fQP, &roi);
+        }
+        ASSERT_EQ(expected, actual) << "frame " << n;
+    }
+}
+
+TEST(Transcode_ROI, RasterizerBlockSize64) {
+    // 128x64 frame, one 64x64 block covers 4x4 entries of the 16x16 map
+    TranscodingSample::MBQPRasterizer rasterizer;
+    rasterizer.Init(8, 4, 64);
+
+    mfxExtEncoderROI roi;
+    std::memset(&roi, 0, sizeof(roi));
+    roi.NumROI         = 1;
+    roi.ROI[0].Left    = 70;
+    roi.ROI[0].Top     = 10;
+    roi.ROI[0].Right   = 80;
+    roi.ROI[0].Bottom  = 20;
+    roi.ROI[0].DeltaQP = -5;
+
+    std::vector<mfxU8> actual(32);
+    rasterizer.FillFrame(&actual[0], 32, 30, &roi);
+    for (mfxU32 y = 0; y < 4; y++) {
+        for (mfxU32 x = 0; x < 8; x++)
+            EXPECT_EQ(actual[y * 8 + x], x < 4 ? 30 : 25) << x << "," << y;
+    }
+
+    rasterizer.FillFrame(&actual[0], 32, 30, nullptr);
+    EXPECT_EQ(actual, std::vector<mfxU8>(32, 30));
+}
+
+// Per-frame control kept in surface keyed maps the way CTranscodingPipeline used to
+struct ref_map_frame_ctrl {
+    std::map<void*, mfxExtEncoderROI> bufExtROI;
+    std::map<void*, mfxExtMBQP> bufExtMBQP;
+    std::map<void*, std::vector<mfxU8>> qpMapStorage;
+    std::map<void*, std::vector<mfxExtBuffer*>> extBuffPtrStorage;
+    std::map<void*, mfxEncodeCtrl> encControlStorage;
+
+    mfxEncodeCtrl* Set(mfxFrameSurface1* surface,
+                       const mfxEncodeCtrl* src,
+                       mfxU32 numQP,
+                       const mfxExtEncoderROI* roi) {
+        void* keyId = (void*)surface;
+        if (numQP && bufExtMBQP.find(keyId) == bufExtMBQP.end()) {
+            extBuffPtrStorage[keyId] = std::vector<mfxExtBuffer*>();
+            qpMapStorage[keyId]      = std::vector<mfxU8>();
+            qpMapStorage[keyId].resize(numQP);
+
+            bufExtMBQP[keyId]                 = mfxExtMBQP();
+            bufExtMBQP[keyId].Header.BufferId = MFX_EXTBUFF_MBQP;
+            bufExtMBQP[keyId].Header.BufferSz = sizeof(mfxExtMBQP);
+            bufExtMBQP[keyId].NumQPAlloc      = numQP;
+            bufExtMBQP[keyId].QP              = &(qpMapStorage[keyId][0]);
+        }
+
+        mfxEncodeCtrl& ctrl = encControlStorage[keyId];
+        MSDK_ZERO_MEMORY(ctrl);
+        if (src)
+            ctrl = *src;
+
+        extBuffPtrStorage[keyId].clear();
+        if (src) {
+            for (unsigned int i = 0; i < ctrl.NumExtParam; i++)
+                extBuffPtrStorage[keyId].push_back(src->ExtParam[i]);
+        }
+
+        if (numQP) {
+            std::memset(bufExtMBQP[keyId].QP, 26, numQP);
+            extBuffPtrStorage[keyId].push_back((mfxExtBuffer*)&bufExtMBQP[keyId]);
+        }
+        else if (roi) {
+            bufExtROI[keyId] = *roi;
+            extBuffPtrStorage[keyId].push_back((mfxExtBuffer*)&bufExtROI[keyId]);
+        }
+
+        ctrl.NumExtParam = (mfxU16)extBuffPtrStorage[keyId].size();
+        if (ctrl.NumExtParam)
+            ctrl.ExtParam = &(extBuffPtrStorage[keyId][0]);
+        return &ctrl;
+    }
+};
+
+static mfxEncodeCtrl* set_arena_frame_ctrl(TranscodingSample::FrameControlArena& arena,
+                                           mfxFrameSurface1* surface,
+                                           const mfxEncodeCtrl* src,
+                                           mfxU32 numQP,
+                                           const mfxExtEncoderROI* roi) {
+    TranscodingSample::FrameControl& frameCtrl = arena.Get(surface);
+    frameCtrl.Reset(src);
+    if (numQP) {
+        std::memset(frameCtrl.MBQP.QP, 26, numQP);
+        frameCtrl.Attach(&frameCtrl.MBQP.Header);
+    }
+    else if (roi) {
+        frameCtrl.ROI = *roi;
+        frameCtrl.Attach(&frameCtrl.ROI.Header);
+    }
+    return &frameCtrl.Ctrl;
+}
+
+TEST(Transcode_FrameControl, BundleIsBoundToSurface) {
+    std::vector<mfxFrameSurface1> surfaces(40);
+
+    TranscodingSample::FrameControlArena arena;
+    arena.Init(4, 0);
+    EXPECT_EQ(arena.GetCapacity(), 4u);
+
+    std::vector<TranscodingSample::FrameControl*> bound;
+    for (auto& surface : surfaces)
+        bound.push_back(&arena.Get(&surface));
+
+    // the arena grows past the preconstructed bundles without moving them
+    EXPECT_EQ(arena.GetBoundCount(), surfaces.size());
+    EXPECT_EQ(arena.GetCapacity(), surfaces.size());
+    for (size_t i = 0; i < surfaces.size(); i++) {
+        EXPECT_EQ(&arena.Get(&surfaces[i]), bound[i]) << i;
+        for (size_t j = 0; j < i; j++)
+            ASSERT_NE(bound[i], bound[j]);
+    }
+
+    arena.Close();
+    EXPECT_EQ(arena.GetBoundCount(), 0u);
+    EXPECT_EQ(arena.GetCapacity(), 0u);
+}
+
+TEST(Transcode_FrameControl, ResetCopiesSourceBuffers) {
+    mfxExtCodingOption2 co2;
+    mfxExtCodingOption3 co3;
+    mfxExtBuffer* srcParam[] = { &co2.Header, &co3.Header };
+
+    mfxEncodeCtrl src;
+    MSDK_ZERO_MEMORY(src);
+    src.QP          = 30;
+    src.NumExtParam = 2;
+    src.ExtParam    = srcParam;
+
+    mfxFrameSurface1 surface;
+    TranscodingSample::FrameControlArena arena;
+    arena.Init(1, 120);
+
+    TranscodingSample::FrameControl& frameCtrl = arena.Get(&surface);
+    EXPECT_EQ(frameCtrl.MBQP.Header.BufferId, (mfxU32)MFX_EXTBUFF_MBQP);
+    EXPECT_EQ(frameCtrl.MBQP.NumQPAlloc, 120u);
+    EXPECT_EQ(frameCtrl.MBQP.QP, frameCtrl.QP.data());
+
+    frameCtrl.Reset(&src);
+    frameCtrl.Attach(&frameCtrl.MBQP.Header);
+    EXPECT_EQ(frameCtrl.Ctrl.QP, 30);
+    ASSERT_EQ(frameCtrl.Ctrl.NumExtParam, 3);
+    EXPECT_NE(frameCtrl.Ctrl.ExtParam, srcParam);
+    EXPECT_EQ(frameCtrl.Ctrl.ExtParam[0], &co2.Header);
+    EXPECT_EQ(frameCtrl.Ctrl.ExtParam[1], &co3.Header);
+    EXPECT_EQ(frameCtrl.Ctrl.ExtParam[2], &frameCtrl.MBQP.Header);
+
+    // next frame of the surface has no source control
+    frameCtrl.Reset(NULL);
+    EXPECT_EQ(frameCtrl.Ctrl.QP, 0);
+    EXPECT_EQ(frameCtrl.Ctrl.NumExtParam, 0);
+    EXPECT_EQ(frameCtrl.Ctrl.ExtParam, nullptr);
+}
+
+TEST(Transcode_FrameControl, MatchesFormerMaps) {
+    const size_t poolLen = 24;
+    const mfxU32 numQP   = ((1920 + 15) >> 4) * ((1080 + 15) >> 4);
+
+    std::vector<mfxFrameSurface1> surfaces(poolLen);
+    mfxExtCodingOption2 co2;
+    MSDK_ZERO_MEMORY(co2);
+    co2.Header.BufferId      = MFX_EXTBUFF_CODING_OPTION2;
+    mfxExtBuffer* srcParam[] = { &co2.Header };
+    mfxEncodeCtrl src;
+    MSDK_ZERO_MEMORY(src);
+    src.NumExtParam = 1;
+    src.ExtParam    = srcParam;
+
+    mfxExtEncoderROI roi;
+    MSDK_ZERO_MEMORY(roi);
+    roi.Header.BufferId = MFX_EXTBUFF_ENCODER_ROI;
+    roi.NumROI          = 2;
+    roi.ROI[1].DeltaQP  = -4;
+
+    for (mfxU32 qp : { 0u, numQP }) {
+        ref_map_frame_ctrl maps;
+        TranscodingSample::FrameControlArena arena;
+        arena.Init(poolLen / 2, qp);
+
+        for (mfxU32 n = 0; n < 4 * poolLen; n++) {
+            mfxFrameSurface1* surface = &surfaces[(n * 7) % poolLen];
+            const mfxEncodeCtrl* pSrc = (n % 3) ? &src : NULL;
+
+            mfxEncodeCtrl* expected = maps.Set(surface, pSrc, qp, &roi);
+            mfxEncodeCtrl* actual   = set_arena_frame_ctrl(arena, surface, pSrc, qp, &roi);
+            ASSERT_EQ(expected->NumExtParam, actual->NumExtParam) << n;
+            for (mfxU16 i = 0; i < actual->NumExtParam; i++) {
+                mfxExtBuffer* e = expected->ExtParam[i];
+                mfxExtBuffer* a = actual->ExtParam[i];
+                ASSERT_EQ(e->BufferId, a->BufferId) << n;
+                if (e->BufferId == MFX_EXTBUFF_MBQP)
+                    EXPECT_EQ(0, std::memcmp(((mfxExtMBQP*)e)->QP, ((mfxExtMBQP*)a)->QP, qp));
+                else if (e->BufferId == MFX_EXTBUFF_ENCODER_ROI)
+                    EXPECT_EQ(0, std::memcmp(e, a, sizeof(mfxExtEncoderROI)));
+                else
+                    EXPECT_EQ(e, a);
+            }
+        }
+        EXPECT_EQ(arena.GetBoundCount(), poolLen);
+    }
+}
+
+// Once every surface of the pool is bound the arena does not allocate any more
+TEST(Transcode_FrameControl, BoundArenaKeepsItsBuffers) {
+    mfxExtCodingOption2 co2;
+    mfxExtCodingOption3 co3;
+    mfxExtBuffer* srcParam[] = { &co2.Header, &co3.Header };
+    mfxEncodeCtrl src;
+    MSDK_ZERO_MEMORY(src);
+    src.NumExtParam = 2;
+    src.ExtParam    = srcParam;
+
+    for (size_t poolLen : { 8, 32, 128 }) {
+        std::vector<mfxFrameSurface1> surfaces(poolLen);
+        TranscodingSample::FrameControlArena arena;
+        arena.Init(poolLen, 0);
+
+        for (auto& surface : surfaces)
+            set_arena_frame_ctrl(arena, &surface, &src, 0, NULL);
+        const TranscodingSample::FrameControl& first = arena.Get(&surfaces[0]);
+        auto extParam                                = first.ExtParam.data();
+
+        for (mfxU32 n = 0; n < 16 * poolLen; n++)
+            set_arena_frame_ctrl(arena, &surfaces[n % poolLen], &src, 0, NULL);
+
+        EXPECT_EQ(arena.GetCapacity(), poolLen);
+        EXPECT_EQ(first.ExtParam.data(), extParam);
+    }
+}
+
+// Microbenchmark of the SetEncCtrlRT bookkeeping, ROI and MBQP contents are left out as they are
+// copied the same way by both. Prints time per frame of each approach. Disabled as it only
+// measures, run it with --gtest_also_run_disabled_tests.
+TEST(Transcode_FrameControl, DISABLED_PerFrameOverheadAgainstMaps) {
+    const mfxU32 frames = 1000000;
+
+    mfxExtCodingOption2 co2;
+    mfxExtCodingOption3 co3;
+    mfxExtBuffer* srcParam[] = { &co2.Header, &co3.Header };
+    mfxEncodeCtrl src;
+    MSDK_ZERO_MEMORY(src);
+    src.NumExtParam = 2;
+    src.ExtParam    = srcParam;
+
+    for (size_t poolLen : { 8, 32, 128 }) {
+        std::vector<mfxFrameSurface1> surfaces(poolLen);
+        ref_map_frame_ctrl maps;
+        TranscodingSample::FrameControlArena arena;
+        arena.Init(poolLen, 0);
+
+        for (auto& surface : surfaces)
+            set_arena_frame_ctrl(arena, &surface, &src, 0, NULL);
+
+        auto start = std::chrono::steady_clock::now();
+        for (mfxU32 n = 0; n < frames; n++)
+            maps.Set(&surfaces[n % poolLen], &src, 0, NULL);
+        auto mapTime = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        for (mfxU32 n = 0; n < frames; n++)
+            set_arena_frame_ctrl(arena, &surfaces[n % poolLen], &src, 0, NULL);
+        auto arenaTime = std::chrono::steady_clock::now() - start;
+
+        printf("[ BENCHMARK] %3zu surfaces: maps %6.1f ns/frame, arena %6.1f ns/frame\n",
+               poolLen,
+               std::chrono::duration<double, std::nano>(mapTime).count() / frames,
+               std::chrono::duration<double, std::nano>(arenaTime).count() / frames);
+    }
+}
+
+TEST(Transcode_Control, ParseCommands) {
+    TranscodingSample::ControlCommand cmd;
+    std::string error;
+
+    ASSERT_EQ(TranscodingSample::ParseControlCommand("enc0 bitrate 4000", cmd, error),
+              MFX_ERR_NONE);
+    EXPECT_EQ(cmd.Session, std::string("enc0"));
+    EXPECT_TRUE(cmd.Kind == TranscodingSample::ControlCommand::Type::Bitrate);
+    EXPECT_EQ(cmd.Value[0], 4000u);
+    EXPECT_EQ(cmd.Value[1], 0u);
+    EXPECT_EQ(cmd.Text, std::string("enc0 bitrate 4000"));
+
+    ASSERT_EQ(TranscodingSample::ParseControlCommand("  1  bitrate 4000 6000 ", cmd, error),
+              MFX_ERR_NONE);
+    EXPECT_EQ(cmd.Session, std::string("1"));
+    EXPECT_EQ(cmd.Value[1], 6000u);
+
+    ASSERT_EQ(TranscodingSample::ParseControlCommand("* size 1280 720", cmd, error), MFX_ERR_NONE);
+    EXPECT_TRUE(cmd.Kind == TranscodingSample::ControlCommand::Type::Size);
+    EXPECT_EQ(cmd.Value[0], 1280u);
+    EXPECT_EQ(cmd.Value[1], 720u);
+
+    ASSERT_EQ(TranscodingSample::ParseControlCommand("a qp 0", cmd, error), MFX_ERR_NONE);
+    EXPECT_TRUE(cmd.Kind == TranscodingSample::ControlCommand::Type::QP);
+    ASSERT_EQ(TranscodingSample::ParseControlCommand("a idr", cmd, error), MFX_ERR_NONE);
+    EXPECT_TRUE(cmd.Kind == TranscodingSample::ControlCommand::Type::IDR);
+
+    for (const char* line : { "",
+                              "a",
+                              "a bitrate",
+                              "a bitrate 0",
+                              "a bitrate -5",
+                              "a bitrate 4000 fast",
+                              "a size 1280",
+                              "a size 0 720",
+                              "a qp 52",
+                              "a idr now",
+                              "a rotate 90" }) {
+        error.clear();
+        EXPECT_EQ(TranscodingSample::ParseControlCommand(line, cmd, error), MFX_ERR_UNSUPPORTED)
+            << line;
+        EXPECT_FALSE(error.empty()) << line;
+    }
+}
+
+static TranscodingSample::ControlCommand make_control_command(const std::string& line) {
+    TranscodingSample::ControlCommand cmd;
+    std::string error;
+    EXPECT_EQ(TranscodingSample::ParseControlCommand(line, cmd, error), MFX_ERR_NONE) << line;
+    return cmd;
+}
+
+TEST(Transcode_Control, ApplyBitrate) {
+    mfxInfoMFX enc;
+    MSDK_ZERO_MEMORY(enc);
+    enc.RateControlMethod  = MFX_RATECONTROL_VBR;
+    enc.BRCParamMultiplier = 2;
+    enc.TargetKbps         = 1000;
+    enc.MaxKbps            = 1500;
+
+    TranscodingSample::ControlChange change;
+    std::string error;
+    ASSERT_EQ(TranscodingSample::ApplyControlCommand(make_control_command("a bitrate 6000 8000"),
+                                                     enc,
+                                                     NULL,
+                                                     1920,
+                                                     1088,
+                                                     change,
+                                                     error),
+              MFX_ERR_NONE);
+    EXPECT_EQ(enc.TargetKbps, 3000);
+    EXPECT_EQ(enc.MaxKbps, 4000);
+    EXPECT_TRUE(change.ResetEncoder);
+    EXPECT_FALSE(change.ResetVpp);
+
+    // maximum follows a target going over it
+    ASSERT_EQ(TranscodingSample::ApplyControlCommand(make_control_command("a bitrate 10000"),
+                                                     enc,
+                                                     NULL,
+                                                     1920,
+                                                     1088,
+                                                     change,
+                                                     error),
+              MFX_ERR_NONE);
+    EXPECT_EQ(enc.TargetKbps, 5000);
+    EXPECT_EQ(enc.MaxKbps, 5000);
+
+    for (const char* line : { "a bitrate 4000 2000", "a bitrate 200000" }) {
+        EXPECT_EQ(TranscodingSample::ApplyControlCommand(make_control_command(line),
+                                                         enc,
+                                                         NULL,
+                                                         1920,
+                                                         1088,
+                                                         change,
+                                                         error),
+                  MFX_ERR_UNSUPPORTED)
+            << line;
+    }
+
+    enc.RateControlMethod = MFX_RATECONTROL_CQP;
+    EXPECT_EQ(TranscodingSample::ApplyControlCommand(make_control_command("a bitrate 4000"),
+                                                     enc,
+                                                     NULL,
+                                                     1920,
+                                                     1088,
+                                                     change,
+                                                     error),
+              MFX_ERR_UNSUPPORTED);
+    EXPECT_EQ(enc.TargetKbps, 5000);
+}
+
+TEST(Transcode_Control, ApplySize) {
+    mfxInfoMFX enc;
+    MSDK_ZERO_MEMORY(enc);
+    enc.FrameInfo.PicStruct = MFX_PICSTRUCT_PROGRESSIVE;
+    mfxFrameInfo vppOut     = enc.FrameInfo;
+
+    TranscodingSample::ControlChange change;
+    std::string error;
+    auto cmd = make_control_command("a size 1278 718");
+
+    EXPECT_EQ(TranscodingSample::ApplyControlCommand(cmd, enc, NULL, 1920, 1088, change, error),
+              MFX_ERR_UNSUPPORTED);
+    EXPECT_EQ(TranscodingSample::ApplyControlCommand(cmd, enc, &vppOut, 1024, 1088, change, error),
+              MFX_ERR_UNSUPPORTED);
+    EXPECT_FALSE(change.ResetEncoder);
+
+    ASSERT_EQ(TranscodingSample::ApplyControlCommand(cmd, enc, &vppOut, 1920, 1088, change, error),
+              MFX_ERR_NONE);
+    EXPECT_TRUE(change.ResetEncoder);
+    EXPECT_TRUE(change.ResetVpp);
+    for (const mfxFrameInfo& info : { enc.FrameInfo, vppOut }) {
+        EXPECT_EQ(info.Width, 1280);
+        EXPECT_EQ(info.Height, 720);
+        EXPECT_EQ(info.CropW, 1278);
+        EXPECT_EQ(info.CropH, 718);
+    }
+
+    // interlaced height is aligned to 32
+    enc.FrameInfo.PicStruct = MFX_PICSTRUCT_FIELD_TFF;
+    ASSERT_EQ(TranscodingSample::ApplyControlCommand(cmd, enc, &vppOut, 1920, 1088, change, error),
+              MFX_ERR_NONE);
+    EXPECT_EQ(enc.FrameInfo.Height, 736);
+
+    EXPECT_EQ(TranscodingSample::ApplyControlCommand(make_control_command("a size 641 480"),
+                                                     enc,
+                                                     &vppOut,
+                                                     1920,
+                                                     1088,
+                                                     change,
+                                                     error),
+              MFX_ERR_UNSUPPORTED);
+}
+
+TEST(Transcode_Control, ApplyFrameParams) {
+    mfxInfoMFX enc;
+    MSDK_ZERO_MEMORY(enc);
+    enc.RateControlMethod = MFX_RATECONTROL_CQP;
+
+    TranscodingSample::ControlChange change;
+    std::string error;
+    ASSERT_EQ(TranscodingSample::ApplyControlCommand(make_control_command("a qp 30"),
+                                                     enc,
+                                                     NULL,
+                                                     1920,
+                                                     1088,
+                                                     change,
+                                                     error),
+              MFX_ERR_NONE);
+    EXPECT_TRUE(change.SetFrameQP);
+    EXPECT_EQ(change.FrameQP, 30);
+    EXPECT_FALSE(change.ResetEncoder);
+
+    ASSERT_EQ(TranscodingSample::ApplyControlCommand(make_control_command("a idr"),
+                                                     enc,
+                                                     NULL,
+                                                     1920,
+                                                     1088,
+                                                     change,
+                                                     error),
+              MFX_ERR_NONE);
+    EXPECT_TRUE(change.InsertIDR);
+
+    enc.RateControlMethod = MFX_RATECONTROL_CBR;
+    EXPECT_EQ(TranscodingSample::ApplyControlCommand(make_control_command("a qp 30"),
+                                                     enc,
+                                                     NULL,
+                                                     1920,
+                                                     1088,
+                                                     change,
+                                                     error),
+              MFX_ERR_UNSUPPORTED);
+}
+
+TEST(Transcode_Control, MailboxDropsLateCommands) {
+    msdk_tick frequency = msdk_time_get_frequency();
+    msdk_tick now       = msdk_time_get_tick();
+
+    TranscodingSample::ControlMailbox mailbox(100);
+    std::vector<TranscodingSample::ControlCommand> commands, expired;
+    EXPECT_FALSE(mailbox.Fetch(commands, expired, now));
+
+    auto late     = make_control_command("a bitrate 1000");
+    late.Received = now - frequency / 5;
+    auto fresh     = make_control_command("a idr");
+    fresh.Received = now - frequency / 50;
+    mailbox.Post(late);
+    mailbox.Post(fresh);
+    EXPECT_EQ(mailbox.GetPendingCount(), 2u);
+
+    ASSERT_TRUE(mailbox.Fetch(commands, expired, now));
+    ASSERT_EQ(commands.size(), 1u);
+    EXPECT_EQ(commands[0].Text, fresh.Text);
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired[0].Text, late.Text);
+    EXPECT_EQ(mailbox.GetPendingCount(), 0u);
+    EXPECT_FALSE(mailbox.Fetch(commands, expired, now));
+    EXPECT_TRUE(commands.empty() && expired.empty());
+
+    // without a bound nothing expires
+    TranscodingSample::ControlMailbox unbounded(0);
+    unbounded.Post(late);
+    ASSERT_TRUE(unbounded.Fetch(commands, expired, now + 100 * frequency));
+    EXPECT_EQ(commands.size(), 1u);
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+TEST(Transcode_Control, ChannelRoutesScriptedCommands) {
+    std::string path = "smt_ctrl_test_fifo";
+    remove(path.c_str());
+
+    TranscodingSample::ControlChannel channel;
+    auto a = channel.AddSession("a", 0);
+    auto b = channel.AddSession("b", 0);
+    ASSERT_TRUE(a && b);
+    EXPECT_EQ(channel.AddSession("a", 0), nullptr);
+    EXPECT_EQ(channel.AddSession("*", 0), nullptr);
+
+    testing::internal::CaptureStdout();
+    ASSERT_EQ(channel.Open(path), MFX_ERR_NONE);
+    EXPECT_TRUE(channel.IsOpen());
+
+    // a script written the way "cat script > fifo" does, the second writer after the first closed
+    for (const char* script : { "# raise bitrate\na bitrate 3000\n* idr\n", "c idr\nb qp 60\n" }) {
+        std::ofstream fifo(path);
+        fifo << script;
+    }
+
+    for (int i = 0; i < 200 && (a->GetPendingCount() < 2 || channel.GetRejectedCount() < 2); i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    channel.Close();
+    std::string out = testing::internal::GetCapturedStdout();
+
+    EXPECT_EQ(a->GetPendingCount(), 2u);
+    EXPECT_EQ(b->GetPendingCount(), 1u);
+    EXPECT_EQ(channel.GetRejectedCount(), 2u);
+    EXPECT_CONTAINS(out, "no session 'c'");
+    EXPECT_CONTAINS(out, "expected qp <0-51>");
+
+    std::vector<TranscodingSample::ControlCommand> commands, expired;
+    ASSERT_TRUE(a->Fetch(commands, expired, msdk_time_get_tick()));
+    ASSERT_EQ(commands.size(), 2u);
+    EXPECT_EQ(commands[0].Text, std::string("a bitrate 3000"));
+    EXPECT_EQ(commands[1].Text, std::string("* idr"));
+
+    // FIFO created by the channel is removed
+    EXPECT_FALSE(std::ifstream(path).good());
+}
+#endif
+
+TEST(Transcode_Control, OneToManyCommandsReachEncoders) {
+    // one decode-only sink feeding two encoding sources, one of them named
+    std::vector<TranscodingSample::sInputParams> params(3);
+    params[0].eMode       = TranscodingSample::Sink;
+    params[1].eMode       = TranscodingSample::Source;
+    params[2].eMode       = TranscodingSample::Source;
+    params[2].SessionName = "hd";
+
+    std::vector<std::string> names = TranscodingSample::GetControlSessionNames(params);
+    EXPECT_EQ(names, std::vector<std::string>({ "", "1", "hd" }));
+
+    TranscodingSample::ControlChannel channel;
+    std::vector<std::shared_ptr<TranscodingSample::ControlMailbox>> mailboxes;
+    for (const std::string& name : names) {
+        if (!name.empty())
+            mailboxes.push_back(channel.AddSession(name, 0));
+    }
+    ASSERT_EQ(mailboxes.size(), 2u);
+    ASSERT_TRUE(mailboxes[0] && mailboxes[1]);
+
+    EXPECT_TRUE(channel.Dispatch("* bitrate 2000", msdk_time_get_tick()));
+    EXPECT_TRUE(channel.Dispatch("hd idr", msdk_time_get_tick()));
+    EXPECT_EQ(mailboxes[0]->GetPendingCount(), 1u);
+    EXPECT_EQ(mailboxes[1]->GetPendingCount(), 2u);
+
+    // the sink has no encoder and can't be addressed
+    testing::internal::CaptureStdout();
+    EXPECT_FALSE(channel.Dispatch("0 idr", msdk_time_get_tick()));
+    testing::internal::GetCapturedStdout();
+}
+
+template <typename T>
+static std::string session_field_str(const T& value) {
+    std::ostringstream str;
+    str << +value;
+    return str.str();
+}
+
+static std::string session_field_str(const std::string& value) {
+    return value;
+}
+
+#define SESSION_FIELD(name) \
+    { #name, session_field_str(params.name) }
+
+// Fields of sInputParams set by the options of the session option table
+static std::vector<std::pair<std::string, std::string>> session_fields(
+    const TranscodingSample::sInputParams& params) {
+    return {
+        SESSION_FIELD(bROIasQPMAP),
+        SESSION_FIELD(bExtMBQP),
+        SESSION_FIELD(libType),
+        SESSION_FIELD(bRobustFlag),
+        SESSION_FIELD(bSoftRobustFlag),
+        SESSION_FIELD(nThreadsNum),
+        SESSION_FIELD(dVPPOutFramerate),
+        SESSION_FIELD(nFPS),
+        SESSION_FIELD(nBitRate),
+        SESSION_FIELD(nBitRateMultiplier),
+        SESSION_FIELD(WinBRCMaxAvgKbps),
+        SESSION_FIELD(WinBRCSize),
+        SESSION_FIELD(BufferSizeInKB),
+        SESSION_FIELD(GopRefDist),
+        SESSION_FIELD(GopPicSize),
+        SESSION_FIELD(NumRefFrame),
+        SESSION_FIELD(nEncTileRows),
+        SESSION_FIELD(nEncTileCols),
+        SESSION_FIELD(CodecLevel),
+        SESSION_FIELD(CodecProfile),
+        SESSION_FIELD(MaxKbps),
+        SESSION_FIELD(InitialDelayInKB),
+        SESSION_FIELD(GopOptFlag),
+        SESSION_FIELD(nBRefType),
+        SESSION_FIELD(GPB),
+        SESSION_FIELD(nTransformSkip),
+        SESSION_FIELD(WeightedPred),
+        SESSION_FIELD(WeightedBiPred),
+        SESSION_FIELD(nQuality),
+        SESSION_FIELD(nDstWidth),
+        SESSION_FIELD(nDstHeight),
+        SESSION_FIELD(nSlices),
+        SESSION_FIELD(nMaxSliceSize),
+        SESSION_FIELD(nAsyncDepth),
+        SESSION_FIELD(bIsJoin),
+        SESSION_FIELD(priority),
+#if defined(LIBVA_X11_SUPPORT)
+        SESSION_FIELD(libvaBackend),
+#endif
+        SESSION_FIELD(VppOutPattern),
+        SESSION_FIELD(nVppCompTileId),
+        SESSION_FIELD(bDecoderPostProcessing),
+        SESSION_FIELD(MaxFrameNumber),
+        SESSION_FIELD(prolonged),
+        SESSION_FIELD(numMFEFrames),
+        SESSION_FIELD(MFMode),
+        SESSION_FIELD(mfeTimeout),
+        SESSION_FIELD(dump_file),
+        SESSION_FIELD(bEnableExtLA),
+        SESSION_FIELD(nRateControlMethod),
+        SESSION_FIELD(bEnableBPyramid),
+        SESSION_FIELD(nLADepth),
+        SESSION_FIELD(dDecoderFrameRateOverride),
+        SESSION_FIELD(dEncoderFrameRateOverride),
+        SESSION_FIELD(EncoderPicstructOverride),
+        SESSION_FIELD(nGpuCopyMode),
+        SESSION_FIELD(RepartitionCheckMode),
+        SESSION_FIELD(nQPI),
+        SESSION_FIELD(nQPP),
+        SESSION_FIELD(nQPB),
+        SESSION_FIELD(bDisableQPOffset),
+        SESSION_FIELD(enableQSVFF),
+        SESSION_FIELD(bSingleTexture),
+        SESSION_FIELD(nExtBRC),
+        SESSION_FIELD(ExtBrcAdaptiveLTR),
+        SESSION_FIELD(shouldPrintPresets),
+        SESSION_FIELD(forceSyncAllSession),
+        SESSION_FIELD(IntRefType),
+        SESSION_FIELD(IntRefCycleSize),
+        SESSION_FIELD(IntRefQPDelta),
+        SESSION_FIELD(IntRefCycleDist),
+        SESSION_FIELD(LowDelayBRC),
+        SESSION_FIELD(nAdaptiveMaxFrameSize),
+        SESSION_FIELD(nMaxFrameSize),
+        SESSION_FIELD(nBaseLayerPID),
+        SESSION_FIELD(nSPSId),
+        SESSION_FIELD(nPPSId),
+        SESSION_FIELD(nTransferCharacteristics),
+        SESSION_FIELD(nPicTimingSEI),
+        SESSION_FIELD(nNalHrdConformance),
+        SESSION_FIELD(nVuiNalHrdParameters),
+        SESSION_FIELD(BitrateLimit),
+        SESSION_FIELD(AdaptiveI),
+        SESSION_FIELD(AdaptiveB),
+        SESSION_FIELD(AdaptiveCQM),
+        SESSION_FIELD(adapterNum),
+        SESSION_FIELD(dispFullSearch),
+        SESSION_FIELD(DecOutPattern),
+        SESSION_FIELD(nMemoryModel),
+        SESSION_FIELD(preallocate),
+        SESSION_FIELD(TargetBitDepthLuma),
+        SESSION_FIELD(TargetBitDepthChroma),
+        SESSION_FIELD(CascadeScaler),
+        SESSION_FIELD(CascadePriority),
+        SESSION_FIELD(CascadeLatencyBudget),
+        SESSION_FIELD(EnableTracing),
+        SESSION_FIELD(TraceBufferSize),
+        SESSION_FIELD(ParallelEncoding),
+        SESSION_FIELD(nIdrInterval),
+        SESSION_FIELD(nMinQPI),
+        SESSION_FIELD(nMinQPP),
+        SESSION_FIELD(nMinQPB),
+        SESSION_FIELD(nMaxQPI),
+        SESSION_FIELD(nMaxQPP),
+        SESSION_FIELD(nMaxQPB),
+        SESSION_FIELD(nNumRefActiveP),
+        SESSION_FIELD(nIVFHeader),
+        SESSION_FIELD(IsSourceMSB),
+        SESSION_FIELD(nSyncOpTimeout),
+        SESSION_FIELD(verSessionInit),
+#ifdef ONEVPL_EXPERIMENTAL
+        SESSION_FIELD(PercEncPrefilter),
+        SESSION_FIELD(TuneEncodeQuality),
+#endif
+        SESSION_FIELD(ScenarioInfo),
+        SESSION_FIELD(ContentInfo),
+        SESSION_FIELD(ExactNframe),
+    };
+}
+
+#undef SESSION_FIELD
+
+static std::vector<std::string> split_options(const std::string& options) {
+    std::vector<std::string> opts;
+    std::istringstream words(options);
+    std::string word;
+    while (words >> word)
+        opts.push_back(word);
+    return opts;
+}
+
+// Status of parsing the options and the fields they changed in a session
+static std::string changed_session_fields(const std::string& options) {
+    auto base   = init_session({});
+    auto result = init_session(split_options(options));
+
+    std::string changed = std::to_string(result.status);
+    if (result.status != MFX_ERR_NONE)
+        return changed;
+
+    auto before = session_fields(base.parsed[0]);
+    auto after  = session_fields(result.parsed[0]);
+    for (size_t i = 0; i < after.size(); i++) {
+        if (after[i] != before[i])
+            changed += " " + after[i].first + "=" + after[i].second;
+    }
+    return changed;
+}
+
+TEST(Transcode_ParFile, OptionTableMatchesFormerParser) {
+    // expected values were produced by the if/else chain the option table replaced
+    struct {
+        const char* Options;
+        const char* Expected;
+    } corpus[] = {
+        { "-roi_qpmap", "0 bROIasQPMAP=1" },
+        { "-extmbqp", "0 bExtMBQP=1" },
+        { "-sw", "0 libType=1" },
+        { "-robust", "0 bRobustFlag=1" },
+        { "-robust:soft", "0 bSoftRobustFlag=1" },
+        { "-threads 3", "0 nThreadsNum=3" },
+        { "-fe 29.97", "0" },
+        { "-fps 3", "0 nFPS=3" },
+        { "-b 3", "0 nBitRate=3" },
+        { "-bm 3", "0 nBitRateMultiplier=3" },
+        { "-wb 3", "0 WinBRCMaxAvgKbps=3" },
+        { "-ws 3", "0 WinBRCSize=3" },
+        { "-hrd 3", "0 BufferSizeInKB=3" },
+        { "-dist 3", "0 GopRefDist=3" },
+        { "-gop_size 3", "0 GopPicSize=3" },
+        { "-num_ref 3", "0 NumRefFrame=3" },
+        { "-trows 3", "0 nEncTileRows=3" },
+        { "-tcols 3", "0 nEncTileCols=3" },
+        { "-CodecLevel 3", "0 CodecLevel=3" },
+        { "-CodecProfile 3", "0 CodecProfile=3" },
+        { "-MaxKbps 3", "0 MaxKbps=3" },
+        { "-InitialDelayInKB 3", "0 InitialDelayInKB=3" },
+        { "-GopOptFlag:closed", "0 GopOptFlag=1" },
+        { "-GopOptFlag:strict", "0 GopOptFlag=2" },
+        { "-bref", "0 nBRefType=2" },
+        { "-nobref", "0 nBRefType=1" },
+        { "-gpb:on", "0 GPB=16" },
+        { "-gpb:off", "0 GPB=32" },
+        { "-TransformSkip:on", "0 nTransformSkip=16" },
+        { "-TransformSkip:off", "0 nTransformSkip=32" },
+        { "-WeightedPred::default", "0 WeightedPred=1" },
+        { "-WeightedPred::implicit", "0 WeightedPred=3" },
+        { "-WeightedBiPred::default", "0 WeightedBiPred=1" },
+        { "-WeightedBiPred::implicit", "0 WeightedBiPred=3" },
+        { "-q 3", "-3" },
+        { "-w 3", "0 nDstWidth=3" },
+        { "-h 3", "0 nDstHeight=3" },
+        { "-l 3", "0 nSlices=3" },
+        { "-mss 3", "-3" },
+        { "-async 3", "0 nAsyncDepth=3" },
+        { "-join", "0 bIsJoin=1" },
+        { "-priority 3", "0 priority=3" },
+#if defined(LIBVA_X11_SUPPORT)
+        { "-rx11", "0 libvaBackend=3" },
+#endif
+        { "-vpp::sys", "0 VppOutPattern=32" },
+        { "-vpp::vid", "0 VppOutPattern=16" },
+        { "-vpp_comp_tile_id 3", "0 nVppCompTileId=3" },
+        { "-dec_postproc", "0 bDecoderPostProcessing=1" },
+        { "-n 3", "0 MaxFrameNumber=3" },
+        { "-prolong 3", "0 prolonged=3" },
+        { "-mfe_frames 3", "0 numMFEFrames=3" },
+        { "-mfe_mode 3", "0 MFMode=3" },
+        { "-mfe_timeout 3", "0 mfeTimeout=3" },
+        { "-dump dump.bin", "0 dump_file=dump.bin" },
+        { "-la_ext", "0 bEnableExtLA=1" },
+        { "-vbr", "0 nRateControlMethod=2" },
+        { "-cbr", "0 nRateControlMethod=1" },
+        { "-bpyr", "0 bEnableBPyramid=1" },
+        { "-vcm", "0 nRateControlMethod=10" },
+        { "-lad 3", "0 nRateControlMethod=8 nLADepth=3" },
+        { "-override_decoder_framerate 29.97", "0 dDecoderFrameRateOverride=29.97" },
+        { "-override_encoder_framerate 29.97", "0 dEncoderFrameRateOverride=29.97" },
+        { "-override_encoder_picstruct 3", "0 EncoderPicstructOverride=3" },
+        { "-gpucopy::on", "0 nGpuCopyMode=1" },
+        { "-gpucopy::off", "0 nGpuCopyMode=2" },
+        { "-repartitioncheck::on", "0 RepartitionCheckMode=16" },
+        { "-repartitioncheck::off", "0 RepartitionCheckMode=32" },
+        { "-cqp", "0 nRateControlMethod=3" },
+        { "-qpi 3", "0 nQPI=3" },
+        { "-qpp 3", "0 nQPP=3" },
+        { "-qpb 3", "0 nQPB=3" },
+        { "-DisableQPOffset", "0 bDisableQPOffset=1" },
+        { "-qsv-ff", "0 enableQSVFF=1" },
+        { "-single_texture_d3d11", "0 bSingleTexture=1" },
+        { "-extbrc::on", "0 nExtBRC=2" },
+        { "-extbrc::off", "0 nExtBRC=1" },
+        { "-extbrc::implicit", "0 nExtBRC=3" },
+        { "-ExtBrcAdaptiveLTR:on", "0 ExtBrcAdaptiveLTR=16" },
+        { "-ExtBrcAdaptiveLTR:off", "0 ExtBrcAdaptiveLTR=32" },
+        { "-pp", "0 shouldPrintPresets=1" },
+        { "-forceSyncAllSession:on", "0 forceSyncAllSession=16" },
+        { "-forceSyncAllSession:off", "0 forceSyncAllSession=32" },
+        { "-ir_type 3", "0 IntRefType=3" },
+        { "-ir_cycle_size 3", "0 IntRefCycleSize=3" },
+        { "-ir_qp_delta 3", "0 IntRefQPDelta=3" },
+        { "-ir_cycle_dist 3", "0 IntRefCycleDist=3" },
+        { "-LowDelayBRC", "0 LowDelayBRC=16" },
+        { "-amfs:on", "0 nAdaptiveMaxFrameSize=16" },
+        { "-amfs:off", "0 nAdaptiveMaxFrameSize=32" },
+        { "-mfs 3", "0 nMaxFrameSize=3" },
+        { "-BaseLayerPID 3", "0 nBaseLayerPID=3" },
+        { "-SPSId 3", "0 nSPSId=3" },
+        { "-PPSId 3", "0 nPPSId=3" },
+        { "-VuiTC 3", "0 nTransferCharacteristics=3" },
+        { "-lowpower:on", "0 enableQSVFF=1" },
+        { "-lowpower:off", "0" },
+        { "-PicTimingSEI:on", "0 nPicTimingSEI=16" },
+        { "-PicTimingSEI:off", "0 nPicTimingSEI=32" },
+        { "-NalHrdConformance:on", "0 nNalHrdConformance=16" },
+        { "-NalHrdConformance:off", "0 nNalHrdConformance=32" },
+        { "-VuiNalHrdParameters:on", "0 nVuiNalHrdParameters=16" },
+        { "-VuiNalHrdParameters:off", "0 nVuiNalHrdParameters=32" },
+        { "-BitrateLimit:on", "0 BitrateLimit=16" },
+        { "-BitrateLimit:off", "0" },
+        { "-AdaptiveI:on", "0 AdaptiveI=16" },
+        { "-AdaptiveI:off", "0 AdaptiveI=32" },
+        { "-AdaptiveB:on", "0 AdaptiveB=16" },
+        { "-AdaptiveB:off", "0 AdaptiveB=32" },
+        { "-AdaptiveCQM:on", "0 AdaptiveCQM=16" },
+        { "-AdaptiveCQM:off", "0 AdaptiveCQM=32" },
+        { "-AdapterNum 3", "0 adapterNum=3" },
+        { "-dispatcher:fullSearch", "0" },
+        { "-dispatcher:lowLatency", "0 dispFullSearch=0" },
+        { "-dec::sys", "0 DecOutPattern=32" },
+        { "-MemModel::GeneralAlloc", "0 nMemoryModel=1" },
+        { "-MemModel::VisibleIntAlloc", "0 nMemoryModel=2" },
+        { "-MemModel::HiddenIntAlloc", "0 nMemoryModel=3" },
+        { "-preallocate 3", "0 preallocate=3" },
+        { "-TargetBitDepthLuma 3", "0 TargetBitDepthLuma=3" },
+        { "-TargetBitDepthChroma 3", "0 TargetBitDepthChroma=3" },
+        { "-cs", "0 CascadeScaler=1" },
+        { "-cs_priority 3", "0 CascadePriority=3" },
+        { "-cs_latency 3", "0 CascadeLatencyBudget=3" },
+        { "-trace", "0 EnableTracing=1" },
+        { "-trace_buffer_size 3", "0 TraceBufferSize=3" },
+        { "-parallel_encoding", "0 ParallelEncoding=1" },
+        { "-idr_interval 3", "0 nIdrInterval=3" },
+        { "-MinQPI 20", "0 nMinQPI=20" },
+        { "-MinQPP 20", "0 nMinQPP=20" },
+        { "-MinQPB 20", "0 nMinQPB=20" },
+        { "-MaxQPI 20", "0 nMaxQPI=20" },
+        { "-MaxQPP 20", "0 nMaxQPP=20" },
+        { "-MaxQPB 20", "0 nMaxQPB=20" },
+        { "-NumActiveRefP 3", "0 nNumRefActiveP=3" },
+        { "-ivf:on", "0 nIVFHeader=16" },
+        { "-ivf:off", "0 nIVFHeader=32" },
+        { "-msb10", "0 IsSourceMSB=1" },
+        { "-syncop_timeout 3", "0 nSyncOpTimeout=3" },
+        { "-api_ver_init::1x", "0 verSessionInit=1" },
+        { "-api_ver_init::2x", "0" },
+#ifdef ONEVPL_EXPERIMENTAL
+        { "-perc_enc_filter", "0 PercEncPrefilter=1" },
+        { "-tune_enc 3", "0 TuneEncodeQuality=3" },
+#endif
+        { "-ScenarioInfo 3", "0 ScenarioInfo=3" },
+        { "-ContentInfo 3", "0 ContentInfo=3" },
+        { "-exactNframe 3", "0 ExactNframe=3" },
+    };
+
+    for (const auto& entry : corpus)
+        EXPECT_EQ(changed_session_fields(entry.Options), entry.Expected) << entry.Options;
+}
+
+TEST(Transcode_ParFile, TokenizerMatchesFormerParser) {
+    // expected descriptions were produced by the former std::stringstream based tokenizer
+    struct {
+        const char* Line;
+        const char* Expected;
+    } corpus[] = {
+        { "-i::h264 in.h264 -o::h265 out.h265", "0|-i::h264 in.h264 -o::h265 out.h265 " },
+        { "  -i::h264\tin.h264   -o::h265 out.h265  ", "0|-i::h264 in.h264 -o::h265 out.h265 " },
+        { "-i::h264=in.h264 -o::h265==out.h265 -b=3000",
+          "0|-i::h264 in.h264 -o::h265 out.h265 -b 3000 " },
+        { "-i::h264 \"my input.h264\" -o::h265 \"out\"put.h265",
+          "0|-i::h264 my input.h264 -o::h265 output.h265 " },
+        { "-i::h264 in\\\\dir\\file.h264 -o::h265 \"a\\\"b\".h265",
+          "0|-i::h264 in\\\\dir\\file.h264 -o::h265 a\"b.h265 " },
+        { "-i::h264 \"\" -o::h265 \"x\"\"y\" -b 3", "-3|-i::h264  -o::h265 x\"y -b 3 " },
+        { "-i::h264 \"in = 1.h264\" -o::h265 out\\\\\\\"q.h265",
+          "0|-i::h264 in = 1.h264 -o::h265 out\\\"q.h265 " },
+        { "-i::h264 in.h264 -o::h265 out.h265\r", "0|-i::h264 in.h264 -o::h265 out.h265\r " },
+    };
+
+    for (const auto& entry : corpus) {
+        write_file("tokenizer.par", entry.Line);
+        TranscodingSample::CmdProcessor cmd;
+        auto result = init({ "-par", "tokenizer.par" }, &cmd);
+        std::string description = std::to_string(result.status);
+        for (const auto& session : cmd.GetSessionDescriptions())
+            description += "|" + session;
+        EXPECT_EQ(description, entry.Expected) << entry.Line;
+    }
+}
+
+// Par file of count sessions with various options, with a blank line and no final new line
+static std::string make_par_file(mfxU32 count) {
+    static const char* extras[] = { "-b 3000",
+                                    "-n 100 -async 4",
+                                    "-u 4 -gop_size 30",
+                                    "-cqp -qpi 20",
+                                    "-hw -bref",
+                                    "-w 640 -h 480",
+                                    "-fps 30 -lowpower:on",
+                                    "-extbrc::on -la_ext" };
+    std::string par;
+    for (mfxU32 i = 0; i < count; i++) {
+        if (i == count / 2)
+            par += "\n";
+        par += "-i::h264 in" + std::to_string(i) + ".h264 -o::h265 \"out " + std::to_string(i) +
+               ".h265\" " + extras[i % (sizeof(extras) / sizeof(extras[0]))];
+        if (i + 1 < count)
+            par += "\n";
+    }
+    return par;
+}
+
+// Status, descriptions and fields of all sessions of a par file parsed on threads threads
+static std::string parse_par_file(const char* name, mfxU32 threads) {
+    TranscodingSample::CmdProcessor cmd;
+    auto result = init({ "-par_threads", std::to_string(threads), "-par", name }, &cmd);
+
+    std::string parsed = std::to_string(result.status);
+    for (const auto& description : cmd.GetSessionDescriptions())
+        parsed += "\n" + description;
+    for (const auto& session : result.parsed) {
+        parsed += "\n";
+        for (const auto& field : session_fields(session))
+            parsed += field.first + "=" + field.second + " ";
+    }
+    return parsed;
+}
+
+TEST(Transcode_ParFile, ParallelMatchesSequential) {
+    write_file("parallel.par", make_par_file(200));
+    std::string sequential = parse_par_file("parallel.par", 1);
+    EXPECT_EQ(sequential.substr(0, 2), "0\n");
+    for (mfxU32 threads : { 2, 4, 16 })
+        EXPECT_EQ(parse_par_file("parallel.par", threads), sequential) << threads;
+
+    // parsing stops at the first bad line
+    std::string par = make_par_file(200);
+    par.insert(par.find("-i::h264 in150.h264"), "-i::h264 in.h264 -o::h265 out.h265 -b\n");
+    write_file("parallel.par", par);
+    sequential = parse_par_file("parallel.par", 1);
+    EXPECT_EQ(sequential.substr(0, 3), "-3\n");
+    EXPECT_EQ(parse_par_file("parallel.par", 4), sequential);
+}
+
+TEST(Transcode_CLI, OptionParThreadsInvalid) {
+    auto result = init({ "-par_threads", "0", "-i::h264", "in", "-o::h265", "out" });
+    EXPECT_EQ(result.status, MFX_ERR_UNSUPPORTED);
+    EXPECT_CONTAINS(result.out, "error: -par_threads \"0\" is invalid");
+}
+
+// Parses a par file of many sessions on one and on several threads. Prints sessions per second.
+// Disabled as it only measures, ParallelMatchesSequential checks the result of the parallel
+// parser. Run it with --gtest_also_run_disabled_tests.
+TEST(Transcode_ParFile, DISABLED_ParseThroughput) {
+    const mfxU32 sessions = 5000;
+    write_file("throughput.par", make_par_file(sessions));
+
+    for (mfxU32 threads : { 1, 4 }) {
+        TranscodingSample::CmdProcessor cmd;
+        auto start  = std::chrono::steady_clock::now();
+        auto result = init({ "-par_threads", std::to_string(threads), "-par", "throughput.par" },
+                           &cmd);
+        auto time   = std::chrono::steady_clock::now() - start;
+
+        EXPECT_EQ(result.status, MFX_ERR_NONE);
+        EXPECT_EQ(result.parsed.size(), sessions);
+        printf("[ BENCHMARK] %u thread(s): %5.1f ms, %8.0f sessions/s\n",
+               threads,
+               std::chrono::duration<double, std::milli>(time).count(),
+               sessions / std::chrono::duration<double>(time).count());
+    }
+}
+
+TEST(Transcode_CLI, OptionAffinity) {
+    TranscodingSample::CmdProcessor cmd;
+    auto result = init({ "-affinity", "adapter", "-i::h264", "in", "-o::h265", "out", "-cpus",
+                         "0-3,8", "-numa_node", "1" },
+                       &cmd);
+    EXPECT_EQ(result.status, MFX_ERR_NONE);
+    EXPECT_EQ(cmd.GetAffinityPolicy(), TranscodingSample::AffinityPolicy::Adapter);
+    ASSERT_EQ(result.parsed.size(), 1u);
+    EXPECT_EQ(result.parsed[0].CpuList, std::string("0-3,8"));
+    EXPECT_EQ(result.parsed[0].NumaNode, 1);
+}
+
+TEST(Transcode_CLI, OptionAffinityInvalid) {
+    auto result = init({ "-affinity", "numa", "-i::h264", "in", "-o::h265", "out" });
+    EXPECT_EQ(result.status, MFX_ERR_UNSUPPORTED);
+    EXPECT_CONTAINS(result.out, "error: -affinity \"numa\" is invalid");
+
+    result = init_session({ "-cpus", "3-1" });
+    EXPECT_EQ(result.status, MFX_ERR_UNSUPPORTED);
+    result = init_session({ "-numa_node", "-1" });
+    EXPECT_EQ(result.status, MFX_ERR_UNSUPPORTED);
+}
+
+TEST(Transcode_Affinity, CpuList) {
+    std::vector<mfxU32> cpus;
+    ASSERT_TRUE(TranscodingSample::ParseCpuList("8,0-3,2,10-11", cpus));
+    EXPECT_EQ(cpus, std::vector<mfxU32>({ 0, 1, 2, 3, 8, 10, 11 }));
+    EXPECT_EQ(TranscodingSample::FormatCpuList(cpus), "0-3,8,10-11");
+
+    for (const char* bad : { "", ",", "1,", "a", "3-1", "1-", "-1", "5000", "0 - 3" })
+        EXPECT_FALSE(TranscodingSample::ParseCpuList(bad, cpus)) << bad;
+}
+
+// 2 nodes of 4 CPUs each
+static TranscodingSample::CpuTopology make_two_nodes() {
+    TranscodingSample::CpuTopology topology;
+    topology.NodeCpus[0] = { 0, 1, 2, 3 };
+    topology.NodeCpus[1] = { 4, 5, 6, 7 };
+    return topology;
+}
+
+TEST(Transcode_Affinity, NoPolicyLeavesSessionsUnbound) {
+    auto placements = TranscodingSample::PlaceSessions({},
+                                                       {},
+                                                       { 0, 1 },
+                                                       {},
+                                                       make_two_nodes(),
+                                                       TranscodingSample::AffinityPolicy::None);
+    ASSERT_EQ(placements.size(), 2u);
+    for (const auto& placement : placements) {
+        EXPECT_TRUE(placement.Cpus.empty());
+        EXPECT_EQ(placement.Node, -1);
+    }
+}
+
+TEST(Transcode_Affinity, AutoSpreadsGroupsOverNodes) {
+    auto placements = TranscodingSample::PlaceSessions({},
+                                                       {},
+                                                       { 0, 0, 2, 3, 4, 5 },
+                                                       {},
+                                                       make_two_nodes(),
+                                                       TranscodingSample::AffinityPolicy::Auto);
+    ASSERT_EQ(placements.size(), 6u);
+    // groups 0, 3 and 5 go to node 0, groups 2 and 4 to node 1
+    EXPECT_EQ(placements[0].Cpus, std::vector<mfxU32>({ 0 }));
+    EXPECT_EQ(placements[1].Cpus, placements[0].Cpus);
+    EXPECT_EQ(placements[2].Cpus, std::vector<mfxU32>({ 4, 5 }));
+    EXPECT_EQ(placements[3].Cpus, std::vector<mfxU32>({ 1 }));
+    EXPECT_EQ(placements[4].Cpus, std::vector<mfxU32>({ 6, 7 }));
+    EXPECT_EQ(placements[5].Cpus, std::vector<mfxU32>({ 2, 3 }));
+    EXPECT_EQ(placements[0].Node, 0);
+    EXPECT_EQ(placements[2].Node, 1);
+    EXPECT_EQ(placements[5].Node, 0);
+}
+
+TEST(Transcode_Affinity, AdapterPolicyFollowsAdapterNode) {
+    auto placements = TranscodingSample::PlaceSessions({},
+                                                       {},
+                                                       { 0, 0, 2, 3 },
+                                                       { 1, 1, -1, 5 },
+                                                       make_two_nodes(),
+                                                       TranscodingSample::AffinityPolicy::Adapter);
+    ASSERT_EQ(placements.size(), 4u);
+    EXPECT_EQ(placements[0].Node, 1);
+    EXPECT_EQ(placements[0].Cpus, std::vector<mfxU32>({ 4, 5, 6, 7 }));
+    EXPECT_EQ(placements[1].Cpus, placements[0].Cpus);
+    // unknown adapter nodes fall back to the least used node
+    EXPECT_EQ(placements[2].Node, 0);
+    EXPECT_EQ(placements[3].Node, 0);
+    EXPECT_EQ(placements[2].Cpus, std::vector<mfxU32>({ 0, 1 }));
+    EXPECT_EQ(placements[3].Cpus, std::vector<mfxU32>({ 2, 3 }));
+}
+
+TEST(Transcode_Affinity, ExplicitPlacementOverridesPolicy) {
+    auto placements = TranscodingSample::PlaceSessions({ "2-3,5", "", "1", "64", "" },
+                                                       { -1, 1, 1, -1, 7 },
+                                                       { 0, 1, 2, 3, 4 },
+                                                       {},
+                                                       make_two_nodes(),
+                                                       TranscodingSample::AffinityPolicy::None);
+    ASSERT_EQ(placements.size(), 5u);
+    // CPUs of both nodes leave memory to the OS
+    EXPECT_EQ(placements[0].Cpus, std::vector<mfxU32>({ 2, 3, 5 }));
+    EXPECT_EQ(placements[0].Node, -1);
+    EXPECT_EQ(placements[1].Cpus, std::vector<mfxU32>({ 4, 5, 6, 7 }));
+    EXPECT_EQ(placements[1].Node, 1);
+    // -numa_node with -cpus places memory only
+    EXPECT_EQ(placements[2].Cpus, std::vector<mfxU32>({ 1 }));
+    EXPECT_EQ(placements[2].Node, 1);
+    // unknown CPUs and nodes leave the session unbound
+    EXPECT_TRUE(placements[3].Cpus.empty());
+    EXPECT_TRUE(placements[4].Cpus.empty());
+    EXPECT_EQ(placements[4].Node, -1);
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+static void make_sysfs_file(const std::string& path, const std::string& content) {
+    for (size_t pos = path.find('/'); pos != std::string::npos; pos = path.find('/', pos + 1))
+        mkdir(path.substr(0, pos).c_str(), 0755);
+    write_file(path.c_str(), content);
+}
+
+TEST(Transcode_Affinity, ReadTopologyFromSysfs) {
+    make_sysfs_file("fake_sysfs/devices/system/node/online", "0-1\n");
+    make_sysfs_file("fake_sysfs/devices/system/node/node0/cpulist", "0-3\n");
+    make_sysfs_file("fake_sysfs/devices/system/node/node1/cpulist", "4-5,8\n");
+    make_sysfs_file("fake_sysfs/class/drm/renderD129/device/numa_node", "1\n");
+
+    auto topology = TranscodingSample::ReadCpuTopology("fake_sysfs");
+    ASSERT_EQ(topology.NodeCpus.size(), 2u);
+    EXPECT_EQ(topology.NodeCpus[0], std::vector<mfxU32>({ 0, 1, 2, 3 }));
+    EXPECT_EQ(topology.NodeCpus[1], std::vector<mfxU32>({ 4, 5, 8 }));
+    EXPECT_EQ(topology.GetNode(8), 1);
+    EXPECT_EQ(topology.GetNode(6), -1);
+    EXPECT_EQ(TranscodingSample::GetRenderNodeNumaNode(129, "fake_sysfs"), 1);
+    EXPECT_EQ(TranscodingSample::GetRenderNodeNumaNode(128, "fake_sysfs"), -1);
+
+    // hosts without NUMA information are one node of the online CPUs
+    make_sysfs_file("fake_sysfs_uma/devices/system/cpu/online", "0-5\n");
+    topology = TranscodingSample::ReadCpuTopology("fake_sysfs_uma");
+    ASSERT_EQ(topology.NodeCpus.size(), 1u);
+    EXPECT_EQ(topology.NodeCpus[0], std::vector<mfxU32>({ 0, 1, 2, 3, 4, 5 }));
+}
+
+// Binds a thread to the first CPU of this host, threads it starts stay there
+TEST(Transcode_Affinity, BindCurrentThread) {
+    auto topology = TranscodingSample::ReadCpuTopology();
+    ASSERT_FALSE(topology.NodeCpus.empty());
+    TranscodingSample::CpuPlacement placement;
+    placement.Cpus = { topology.NodeCpus.begin()->second.front() };
+
+    std::thread([&placement]() {
+        ASSERT_EQ(TranscodingSample::BindCurrentThread(placement), MFX_ERR_NONE);
+        std::thread([&placement]() {
+            EXPECT_EQ(sched_getcpu(), (int)placement.Cpus.front());
+            cpu_set_t cpuSet;
+            ASSERT_EQ(sched_getaffinity(0, sizeof(cpuSet), &cpuSet), 0);
+            EXPECT_EQ(CPU_COUNT(&cpuSet), 1);
+            // a thread bound to one CPU can't migrate
+            mfxU64 migrations = TranscodingSample::GetCurrentThreadMigrations();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            EXPECT_EQ(TranscodingSample::GetCurrentThreadMigrations(), migrations);
+        }).join();
+    }).join();
+}
+#endif
+
+TEST(Transcode_CLI, OptionFpsFraction) {
+    auto result = init_session({ "-fps", "30000/1001" });
+    EXPECT_EQ(result.status, MFX_ERR_NONE);
+    ASSERT_EQ(result.parsed.size(), 1u);
+    EXPECT_EQ(result.parsed[0].nFPS, 30000u);
+    EXPECT_EQ(result.parsed[0].nFPSDenom, 1001u);
+
+    result = init_session({ "-fps", "29.97" });
+    ASSERT_EQ(result.parsed.size(), 1u);
+    EXPECT_EQ(result.parsed[0].nFPS, 2997u);
+    EXPECT_EQ(result.parsed[0].nFPSDenom, 100u);
+
+    for (const char* invalid : { "0", "30/0", "30/", "/2", "30.", "-30", "1x" }) {
+        result = init_session({ "-fps", invalid });
+        EXPECT_EQ(result.status, MFX_ERR_UNSUPPORTED) << invalid;
+    }
+
+    TranscodingSample::CmdProcessor cmd;
+    result = init({ "-fps_spin", "200", "-i::h264", "in", "-o::h265", "out", "-fps", "60" }, &cmd);
+    EXPECT_EQ(result.status, MFX_ERR_NONE);
+    EXPECT_EQ(cmd.GetFpsSpinTail(), 200u);
+}
+
+TEST(Transcode_CLI, OptionLive) {
+    auto result = init_session({ "-live", "30000/1001", "-live_jitter", "500", "-live_burst", "30",
+                                 "5", "-live_deadline", "80" });
+    EXPECT_EQ(result.status, MFX_ERR_NONE);
+    ASSERT_EQ(result.parsed.size(), 1u);
+    const LiveSourceParams& live = result.parsed[0].LiveSource;
+    EXPECT_EQ(live.RateN, 30000u);
+    EXPECT_EQ(live.RateD, 1001u);
+    EXPECT_EQ(live.JitterUs, 500u);
+    EXPECT_EQ(live.BurstInterval, 30u);
+    EXPECT_EQ(live.BurstLength, 5u);
+    EXPECT_EQ(live.DeadlineMs, 80u);
+
+    result = init_session({ "-live_burst", "5", "30" });
+    EXPECT_EQ(result.status, MFX_ERR_UNSUPPORTED);
+    result = init_session({ "-live", "0" });
+    EXPECT_EQ(result.status, MFX_ERR_UNSUPPORTED);
+
+    // access units of h265 streams can't be told apart by the reader
+    result = init({ "-i::h265", "in", "-o::h264", "out", "-live", "30" });
+    EXPECT_EQ(result.status, MFX_ERR_UNSUPPORTED);
+    EXPECT_CONTAINS(result.out, "-live needs a raw, h264, mjpeg, vp8, vp9 or av1 input file");
+}
+
+TEST(Transcode_CLI, OptionShmRing) {
+    auto result = init({ "-i::h264", "in", "-shm_ring", "frames", "-shm_ring_slots", "4",
+                         "-shm_ring_drop" });
+    EXPECT_EQ(result.status, MFX_ERR_NONE);
+    ASSERT_EQ(result.parsed.size(), 1u);
+    // the ring alone is the raw output of the session
+    EXPECT_EQ(result.parsed[0].EncodeId, MFX_CODEC_DUMP);
+    EXPECT_EQ(result.parsed[0].strDstFile, std::string("null"));
+    EXPECT_EQ(result.parsed[0].ShmRing.Name, std::string("frames"));
+    EXPECT_EQ(result.parsed[0].ShmRing.Slots, 4u);
+    EXPECT_EQ(result.parsed[0].ShmRing.Policy, SHM_RING_DROP);
+
+    result = init({ "-i::h264", "in", "-o::raw", "out", "-shm_ring", "frames" });
+    EXPECT_EQ(result.status, MFX_ERR_NONE);
+    ASSERT_EQ(result.parsed.size(), 1u);
+    EXPECT_EQ(result.parsed[0].strDstFile, std::string("out"));
+    EXPECT_EQ(result.parsed[0].ShmRing.Policy, SHM_RING_BLOCK);
+
+    result = init_session({ "-shm_ring", "frames" });
+    EXPECT_EQ(result.status, MFX_ERR_UNSUPPORTED);
+    EXPECT_CONTAINS(result.out, "-shm_ring needs a session with raw output");
+    result = init_session({ "-shm_ring_slots", "0" });
+    EXPECT_EQ(result.status, MFX_ERR_UNSUPPORTED);
+}
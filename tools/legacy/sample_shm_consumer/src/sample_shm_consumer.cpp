@@ -0,0 +1,178 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "sample_utils.h"
+#include "shm_frame_ring.h"
+#include "version.h"
+
+// Reference consumer of the shared memory frame ring of sample_decode and
+// sample_multi_transcode (-shm_ring). Frames are read in place from the mapped slots.
+
+struct sConsumerParams {
+    std::string ringName;
+    std::string dstFile; // frames are written to it if given
+    mfxU32 nDelayMs; // time the consumer holds every frame, emulates a slow analytics stage
+    mfxU32 nTimeoutMs; // how long to wait for the ring to appear and for frames
+    mfxU32 nFrames; // frames to read, 0 - until the producer closes the ring
+};
+
+static void PrintHelp(char* strAppName, const char* strErrorMessage) {
+    printf("Shared Memory Consumer Sample Version %s\n\n", GetMSDKSampleVersion().c_str());
+
+    if (strErrorMessage) {
+        printf("Error: %s\n", strErrorMessage);
+    }
+
+    printf("Usage: %s -i RingName [<options>]\n", strAppName);
+    printf("\n");
+    printf("Reads frames a producer started with -shm_ring RingName hands over\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("   [-o fileName]            - write the frames to a raw file\n");
+    printf("   [-delay ms]              - hold every frame this long before releasing it\n");
+    printf(
+        "   [-timeout ms]            - wait this long for the ring and for frames, 10 s by default\n");
+    printf("   [-n frames]              - stop after this many frames\n");
+    printf("\n");
+    printf("Example:\n");
+    printf("  sample_decode h264 -i in.h264 -shm_ring frames &\n");
+    printf("  %s -i frames -o out.yuv\n", strAppName);
+}
+
+static mfxStatus ParseInputString(char* strInput[], mfxU32 nArgNum, sConsumerParams* pParams) {
+    for (mfxU32 i = 1; i < nArgNum; i++) {
+        mfxU32* pValue = NULL;
+        if (msdk_match(strInput[i], "-i")) {
+            if (i + 1 >= nArgNum) {
+                PrintHelp(strInput[0], "Ring name for -i should be provided");
+                return MFX_ERR_UNSUPPORTED;
+            }
+            pParams->ringName = strInput[++i];
+            continue;
+        }
+        else if (msdk_match(strInput[i], "-o")) {
+            if (i + 1 >= nArgNum) {
+                PrintHelp(strInput[0], "File name for -o should be provided");
+                return MFX_ERR_UNSUPPORTED;
+            }
+            pParams->dstFile = strInput[++i];
+            continue;
+        }
+        else if (msdk_match(strInput[i], "-delay")) {
+            pValue = &pParams->nDelayMs;
+        }
+        else if (msdk_match(strInput[i], "-timeout")) {
+            pValue = &pParams->nTimeoutMs;
+        }
+        else if (msdk_match(strInput[i], "-n")) {
+            pValue = &pParams->nFrames;
+        }
+        else if (msdk_match(strInput[i], "-?")) {
+            PrintHelp(strInput[0], NULL);
+            return MFX_ERR_UNSUPPORTED;
+        }
+        else {
+            std::string message = std::string("Unknown option: ") + strInput[i];
+            PrintHelp(strInput[0], message.c_str());
+            return MFX_ERR_UNSUPPORTED;
+        }
+
+        if (i + 1 >= nArgNum || MFX_ERR_NONE != msdk_opt_read(strInput[i + 1], *pValue)) {
+            std::string message = std::string("Invalid value for ") + strInput[i];
+            PrintHelp(strInput[0], message.c_str());
+            return MFX_ERR_UNSUPPORTED;
+        }
+        i++;
+    }
+
+    if (pParams->ringName.empty()) {
+        PrintHelp(strInput[0], "ring name not found");
+        return MFX_ERR_UNSUPPORTED;
+    }
+    return MFX_ERR_NONE;
+}
+
+int main(int argc, char* argv[]) {
+    sConsumerParams params = {};
+    params.nTimeoutMs      = 10000;
+
+    mfxStatus sts = ParseInputString(argv, (mfxU32)argc, &params);
+    if (sts != MFX_ERR_NONE)
+        return 1;
+
+    FILE* dst = NULL;
+    if (!params.dstFile.empty()) {
+        MSDK_FOPEN(dst, params.dstFile.c_str(), "wb");
+        if (!dst) {
+            printf("error: can't open %s\n", params.dstFile.c_str());
+            return 1;
+        }
+    }
+
+    // the producer creates the ring with its first frame
+    CShmFrameRingReader ring;
+    CTimer timer;
+    timer.Start();
+    while ((sts = ring.Open(params.ringName)) == MFX_ERR_NOT_FOUND &&
+           timer.GetTime() * 1000 < params.nTimeoutMs)
+        MSDK_SLEEP(10);
+    if (sts != MFX_ERR_NONE) {
+        printf("error: can't open ring %s: %s\n", params.ringName.c_str(), StatusToString(sts));
+        if (dst)
+            fclose(dst);
+        return 1;
+    }
+    printf("Consuming %s, %u slots\n", params.ringName.c_str(), ring.GetSlots());
+
+    mfxU64 frames = 0, bytes = 0, lost = 0, nextFrameNumber = 0;
+    timer.Start();
+    while (!params.nFrames || frames < params.nFrames) {
+        const ShmFrameInfo* info = NULL;
+        const mfxU8* data        = NULL;
+        sts                      = ring.Acquire(info, data, params.nTimeoutMs);
+        if (sts != MFX_ERR_NONE)
+            break;
+
+        // the producer numbers every frame it is offered, dropped ones leave gaps
+        lost += info->FrameNumber - nextFrameNumber;
+        nextFrameNumber = info->FrameNumber + 1;
+
+        if (dst && fwrite(data, 1, info->DataSize, dst) != info->DataSize) {
+            printf("error: can't write %s\n", params.dstFile.c_str());
+            sts = MFX_ERR_UNDEFINED_BEHAVIOR;
+            break;
+        }
+        if (params.nDelayMs)
+            MSDK_SLEEP(params.nDelayMs);
+        frames++;
+        bytes += info->DataSize;
+
+        // the producer may reuse the slot from now on
+        ring.Release();
+    }
+    double time = timer.GetTime();
+
+    if (dst)
+        fclose(dst);
+    if (sts == MFX_WRN_IN_EXECUTION)
+        printf("no frame came within %u ms\n", params.nTimeoutMs);
+    else if (sts < MFX_ERR_NONE && sts != MFX_ERR_MORE_DATA)
+        printf("error: %s\n", StatusToString(sts));
+
+    printf("%llu frames in %.3f s, %.2f fps, %.1f MB/s, %llu frames lost (%llu dropped by the "
+           "producer)\n",
+           (unsigned long long)frames,
+           time,
+           time > 0 ? frames / time : 0.0,
+           time > 0 ? bytes / time / 1000000 : 0.0,
+           (unsigned long long)lost,
+           (unsigned long long)ring.GetDropped());
+    ring.Close();
+
+    return (sts < MFX_ERR_NONE && sts != MFX_ERR_MORE_DATA) ? 1 : 0;
+}
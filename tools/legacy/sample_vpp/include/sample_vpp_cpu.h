@@ -0,0 +1,163 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __SAMPLE_VPP_CPU_H
+#define __SAMPLE_VPP_CPU_H
+
+#include <memory>
+#include <vector>
+
+#include "vpl/mfxvideo++.h"
+#include "vpl/mfxvideo.h"
+
+#include "sample_thread_pool.h"
+
+#ifndef MFX_VERSION
+    #error MFX_VERSION not defined
+#endif
+
+/* ************************************************************************* */
+// CPU reference implementation of the VPP operations used by sample_vpp.
+// It replaces the runtime VPP component when -cpu_ref is set, so the reader,
+// writer, surface store and PTS/FRC checker paths can run without a GPU or
+// against the stub runtime.
+//
+// Supported operations: crop, resize (bilinear or nearest neighbor), color
+// conversion between NV12, I420, YV12, P010, I010 and RGB4 (BT.601/BT.709
+// limited range), bob deinterlace, spatial denoise, frame rate conversion by
+// frame repeat/drop and composition with global alpha.
+//
+// Every output pixel is computed with integer arithmetic from the input only,
+// so results are bit-exact regardless of the number of worker threads.
+class CCpuVPP : public MFXVideoVPP {
+public:
+    // numThreads == 0 selects the number of hardware threads
+    explicit CCpuVPP(mfxU32 numThreads = 0);
+    virtual ~CCpuVPP();
+
+    // allocator used to lock surfaces which come without mapped pointers
+    void SetFrameAllocator(mfxFrameAllocator* pAllocator) {
+        m_pAllocator = pAllocator;
+    }
+
+    mfxU32 GetNumThreads() const {
+        return m_pool.GetNumThreads();
+    }
+
+    static bool IsFourCCSupported(mfxU32 fourcc);
+
+    virtual mfxStatus Query(mfxVideoParam* in, mfxVideoParam* out) override;
+    virtual mfxStatus QueryIOSurf(mfxVideoParam* par, mfxFrameAllocRequest request[2]) override;
+    virtual mfxStatus Init(mfxVideoParam* par) override;
+    virtual mfxStatus Reset(mfxVideoParam* par) override;
+    virtual mfxStatus Close(void) override;
+
+    virtual mfxStatus GetVideoParam(mfxVideoParam* par) override;
+    virtual mfxStatus GetVPPStat(mfxVPPStat* stat) override;
+    virtual mfxStatus RunFrameVPPAsync(mfxFrameSurface1* in,
+                                       mfxFrameSurface1* out,
+                                       mfxExtVppAuxData* aux,
+                                       mfxSyncPoint* syncp) override;
+
+    virtual mfxStatus GetSurfaceIn(mfxFrameSurface1** output_surf) override;
+    virtual mfxStatus GetSurfaceOut(mfxFrameSurface1** output_surf) override;
+    virtual mfxStatus ProcessFrameAsync(mfxFrameSurface1* in, mfxFrameSurface1** out) override;
+
+    // Processing is finished by the time RunFrameVPPAsync returns, the sync point
+    // only identifies the task.
+    mfxStatus SyncOperation(mfxSyncPoint syncp, mfxU32 wait);
+
+    struct Plane {
+        std::vector<mfxU16> data;
+        mfxU32 width;
+        mfxU32 height;
+
+        Plane() : data(), width(0), height(0) {}
+        void Resize(mfxU32 w, mfxU32 h) {
+            width  = w;
+            height = h;
+            if (data.size() < (size_t)w * h)
+                data.resize((size_t)w * h);
+        }
+        mfxU16* Row(mfxU32 y) {
+            return data.data() + (size_t)y * width;
+        }
+        const mfxU16* Row(mfxU32 y) const {
+            return data.data() + (size_t)y * width;
+        }
+    };
+
+    // Working picture: 3 planes, either YUV 4:2:0 or RGB 4:4:4
+    struct Picture {
+        Plane plane[3];
+        bool isRGB;
+        mfxU16 bitDepth;
+
+        Picture() : isRGB(false), bitDepth(8) {}
+    };
+
+protected:
+    CCpuVPP(CCpuVPP const&)                  = delete;
+    const CCpuVPP& operator=(CCpuVPP const&) = delete;
+
+private:
+    struct Config {
+        mfxU16 denoiseStrength; // 0 - disabled
+        mfxU16 interpolation;
+        mfxU16 frcAlgorithm;
+        bool bFRC;
+        mfxU16 inMatrix;
+        mfxU16 outMatrix;
+        std::vector<mfxVPPCompInputStream> composition;
+        mfxU16 background[3]; // Y,U,V or R,G,B depending on output format
+    };
+
+    mfxStatus CheckParams(mfxVideoParam* par, bool* pFilterSkipped);
+    mfxStatus ParseExtBuffers(mfxVideoParam* par, Config& cfg, bool* pFilterSkipped);
+
+    mfxStatus LockSurface(mfxFrameSurface1* surface, bool* pLocked);
+    void UnlockSurface(mfxFrameSurface1* surface, bool locked);
+
+    mfxStatus ProcessFrame(mfxFrameSurface1* in,
+                           mfxFrameSurface1* out,
+                           const mfxFrameInfo& dstRect,
+                           mfxU16 alpha);
+    void FillBackground(mfxFrameSurface1* out);
+
+    void Unpack(const mfxFrameSurface1* in, Picture& pic);
+    void Deinterlace(Picture& pic, bool topFieldFirst);
+    void Denoise(Picture& pic, mfxU16 strength);
+    void Scale(const Plane& src, Plane& dst, mfxU32 dstW, mfxU32 dstH);
+    void Pack(const Picture& pic, mfxFrameSurface1* out, const mfxFrameInfo& rect, mfxU16 alpha);
+
+    CThreadPool m_pool;
+    mfxFrameAllocator* m_pAllocator;
+
+    bool m_bInitialized;
+    mfxVideoParam m_par;
+    Config m_cfg;
+
+    Picture m_src;
+    Picture m_dst;
+    Plane m_tmp;
+
+    // scaling tables: source index and Q8 weight of the next sample
+    std::vector<mfxU32> m_xIdx, m_yIdx;
+    std::vector<mfxU16> m_xFrac, m_yFrac;
+
+    // frame rate conversion state
+    mfxU64 m_inFrames;
+    mfxU64 m_outFrames;
+    mfxU64 m_firstTimeStamp;
+
+    // composition state
+    std::vector<mfxFrameSurface1*> m_compInputs;
+
+    mfxU64 m_lastTask;
+    mfxU32 m_numFramesOut;
+};
+
+#endif /* __SAMPLE_VPP_CPU_H */
@@ -8,12 +8,127 @@
 #define __SAMPLE_VPP_FRC_H
 
 #include <stdio.h>
+#include <vector>
 #include "vpl/mfxvideo.h"
 
 #ifndef MFX_VERSION
     #error MFX_VERSION not defined
 #endif
 
+// Fixed-capacity ring of time stamps keyed by input frame index.
+// Frame N is stored in slot N & mask, so lookup by index and FIFO access are O(1)
+// and nothing is allocated per frame. When the ring is full the oldest entry is
+// overwritten.
+class PTSRing {
+public:
+    explicit PTSRing(mfxU32 minCapacity = 256) : m_data(), m_mask(0), m_head(0), m_tail(0) {
+        Init(minCapacity);
+    }
+
+    void Init(mfxU32 minCapacity) {
+        mfxU32 capacity = 1;
+        while (capacity < minCapacity)
+            capacity <<= 1;
+        m_data.assign(capacity, 0);
+        m_mask = capacity - 1;
+        m_head = m_tail = 0;
+    }
+
+    // returns false if an entry which was not popped yet had to be overwritten
+    bool Push(mfxU64 timeStamp) {
+        bool bLost              = (m_tail - m_head == m_data.size());
+        m_data[m_tail & m_mask] = timeStamp;
+        m_tail++;
+        if (bLost)
+            m_head++;
+        return !bLost;
+    }
+
+    bool Front(mfxU64& timeStamp) const {
+        if (IsEmpty())
+            return false;
+        timeStamp = m_data[m_head & m_mask];
+        return true;
+    }
+
+    void Pop() {
+        if (!IsEmpty())
+            m_head++;
+    }
+
+    // time stamp of frame 'index' if it is still in the ring
+    bool Find(mfxU64 index, mfxU64& timeStamp) const {
+        if (index < m_head || index >= m_tail)
+            return false;
+        timeStamp = m_data[index & m_mask];
+        return true;
+    }
+
+    bool IsEmpty() const {
+        return m_head == m_tail;
+    }
+    // index of the oldest stored frame
+    mfxU64 GetHead() const {
+        return m_head;
+    }
+    // number of frames pushed so far
+    mfxU64 GetTail() const {
+        return m_tail;
+    }
+    mfxU32 GetCapacity() const {
+        return (mfxU32)m_data.size();
+    }
+
+private:
+    std::vector<mfxU64> m_data;
+    mfxU64 m_mask;
+    mfxU64 m_head;
+    mfxU64 m_tail;
+};
+
+// Deviation of output time stamps from the ideal output frame grid
+struct sPTSDriftStat {
+    mfxU32 numFrames; // checked output frames
+    mfxU32 numMismatches; // frames outside of the tolerance
+    mfxU32 numDropped; // input frames which did not reach the output
+    mfxU32 numDuplicated; // output frames which repeat an input frame
+    mfxF64 maxDeviation; // seconds
+    mfxF64 sumDeviation; // seconds
+
+    sPTSDriftStat()
+            : numFrames(0),
+              numMismatches(0),
+              numDropped(0),
+              numDuplicated(0),
+              maxDeviation(0),
+              sumDeviation(0) {}
+
+    void AddDeviation(mfxF64 deviation) {
+        if (deviation < 0)
+            deviation = -deviation;
+        if (deviation > maxDeviation)
+            maxDeviation = deviation;
+        sumDeviation += deviation;
+        numFrames++;
+    }
+
+    mfxF64 GetMeanDeviation() const {
+        return numFrames ? sumDeviation / numFrames : 0;
+    }
+
+    void Print(const char* name) const {
+        printf("%s: frames %u, mismatches %u, dropped %u, duplicated %u, "
+               "deviation max %.3f ms, mean %.3f ms\n",
+               name,
+               numFrames,
+               numMismatches,
+               numDropped,
+               numDuplicated,
+               maxDeviation * 1000,
+               GetMeanDeviation() * 1000);
+    }
+};
+
 class BaseFRCChecker {
 public:
     //BaseFRCChecker();
@@ -26,6 +141,11 @@ public:
 
     // notify FRCChecker about one more output frame and check result
     virtual bool PutOutputFrameAndCheck(mfxFrameSurface1* pSurface) = 0;
+
+    // checkers which follow time stamps report their drift, others return NULL
+    virtual const sPTSDriftStat* GetDriftStat() const {
+        return NULL;
+    }
 };
 
 class FRCChecker : public BaseFRCChecker {
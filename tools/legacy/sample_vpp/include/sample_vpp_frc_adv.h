@@ -8,7 +8,6 @@
 #define __SAMPLE_VPP_FRC_ADV_H
 
 #include <stdio.h>
-#include <list>
 #include <memory>
 
 #include "sample_vpp_frc.h"
@@ -31,10 +30,16 @@ public:
     // notify FRCChecker about one more output frame and check result
     bool PutOutputFrameAndCheck(mfxFrameSurface1* pSurface);
 
+    const sPTSDriftStat* GetDriftStat() const {
+        return &m_driftStat;
+    }
+
 private:
     mfxU64 GetExpectedPTS(mfxU32 frameNumber, mfxU64 timeOffset, mfxU64 timeJump);
 
     bool IsTimeStampsNear(mfxU64 timeStampRef, mfxU64 timeStampTst, mfxU64 eps);
+    // IsTimeStampsNear which also accounts the frame in drift statistics
+    bool CheckOutputTimeStamp(mfxU64 timeStampRef, mfxU64 timeStampTst);
 
     mfxU64 m_minDeltaTime;
 
@@ -50,7 +55,8 @@ private:
 
     mfxVideoParam m_videoParam;
 
-    std::list<mfxU64> m_ptsList;
+    PTSRing m_ptsRing; // input time stamps which are not matched with output yet
+    sPTSDriftStat m_driftStat;
 };
 
 #endif /* __SAMPLE_VPP_PTS_ADV_H*/
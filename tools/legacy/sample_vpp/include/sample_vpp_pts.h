@@ -7,7 +7,6 @@
 #ifndef __SAMPLE_VPP_PTS_H
 #define __SAMPLE_VPP_PTS_H
 
-#include <list>
 #include <memory>
 #include "vpl/mfxvideo.h"
 
@@ -35,6 +34,10 @@ public:
     // sometimes need to pts jumping
     void JumpPTS();
 
+    // deviation of output time stamps collected by CheckPTS
+    const sPTSDriftStat& GetDriftStat() const;
+    void PrintDriftStat() const;
+
 protected:
     void PrintDumpInfo();
 
@@ -42,6 +45,9 @@ protected:
     bool CheckBasicPTS(mfxFrameSurface1* pSurface);
     // FRC based on pts
     bool CheckAdvancedPTS(mfxFrameSurface1* pSurface);
+    // index of the input frame carrying time stamp ts, computed from the input frame rate
+    bool FindInputFrame(mfxU64 ts, mfxU64& index) const;
+    void UpdateDriftStat(mfxU64 ts, mfxU64 index);
 
     std::unique_ptr<BaseFRCChecker> m_pFRCChecker;
 
@@ -70,7 +76,12 @@ protected:
     // FRC based on PTS mode
     bool m_bIsAdvancedMode;
 
-    std::list<mfxU64> m_ptsList;
+    // time stamps of input frames which can still be seen at the output
+    PTSRing m_ptsRing;
+
+    sPTSDriftStat m_driftStat;
+    mfxU64 m_firstOutTimeStamp;
+    mfxU64 m_lastInIndex; // input frame matched by the previous output frame
 };
 
 #endif /* __SAMPLE_VPP_PTS_H*/
@@ -7,6 +7,8 @@
 #ifndef __SAMPLE_VPP_ROI_H
 #define __SAMPLE_VPP_ROI_H
 
+#include <string>
+#include <vector>
 #include "vpl/mfxvideo.h"
 
 typedef enum {
@@ -24,7 +26,11 @@ typedef struct sROICheckParam {
 
     int dstSeed;
 
-    sROICheckParam() {
+    // files to store the generated ROI schedules in, empty - don't store
+    std::string srcScheduleFile;
+    std::string dstScheduleFile;
+
+    sROICheckParam() : srcScheduleFile(), dstScheduleFile() {
         mode    = eROIMode(0);
         srcSeed = 0;
         dstSeed = 0;
@@ -34,12 +40,25 @@ typedef struct sROICheckParam {
 
 /* ************************************************************************* */
 
+struct sROIRect {
+    mfxU16 x;
+    mfxU16 y;
+    mfxU16 w;
+    mfxU16 h;
+};
+
+// Generates a random ROI per frame for the ROI check modes.
+// The whole schedule is derived from the seed by a private generator, so the
+// same seed gives the same ROI sequence on every run and platform regardless of
+// other users of rand(). ROIs are generated in batches (all frames at once if
+// the number of frames is known) and SetROI only copies the next entry.
 class ROIGenerator {
 public:
     ROIGenerator(void);
     ~ROIGenerator(void);
 
-    mfxStatus Init(mfxU16 width, mfxU16 height, int seed);
+    // numFrames == 0 - length of the sequence is unknown, schedule grows on demand
+    mfxStatus Init(mfxU16 width, mfxU16 height, int seed, mfxU32 numFrames = 0);
     mfxStatus Close(void);
 
     // need to set specific ROI from usage model of generator
@@ -48,11 +67,29 @@ public:
     // return seed for external application
     mfxI32 GetSeed(void);
 
+    // ROIs generated so far, SetROI uses them in order
+    const std::vector<sROIRect>& GetSchedule() const {
+        return m_schedule;
+    }
+    mfxU32 GetNumUsed() const {
+        return m_numUsed;
+    }
+
+    // writes the first numFrames entries (0 - the used ones) as "frame x y w h" text lines
+    mfxStatus SaveSchedule(const char* fileName, mfxU32 numFrames = 0) const;
+
 protected:
+    void Generate(mfxU32 numFrames);
+    int GetRandom(int lowest, int highest);
+
     mfxU16 m_width;
     mfxU16 m_height;
 
     mfxI32 m_seed;
+    mfxU32 m_state;
+
+    std::vector<sROIRect> m_schedule;
+    mfxU32 m_numUsed;
 };
 
-#endif /* __SAMPLE_VPP_PTS_H*/
+#endif /* __SAMPLE_VPP_ROI_H*/
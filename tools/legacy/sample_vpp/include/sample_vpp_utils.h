@@ -49,7 +49,9 @@
     #include "vpl/mfxvideo.h"
 
     #include "base_allocator.h"
+    #include "sample_quality.h"
     #include "sample_vpp_config.h"
+    #include "sample_vpp_cpu.h"
     #include "sample_vpp_roi.h"
 
     // we introduce new macros without error message (returned status only)
@@ -213,6 +215,10 @@ struct sInputParams {
 
     bool bPartialAccel;
 
+    // CPU reference VPP is used instead of the library
+    bool bCpuRef;
+    mfxU32 cpuRefThreads; // 0 - number of hardware threads
+
     bool bPerf;
     mfxU32 numFrames;
     mfxU16 numRepeat;
@@ -225,6 +231,9 @@ struct sInputParams {
     /* roi checking parameters */
     sROICheckParam roiCheckParam;
 
+    /* output verification parameters */
+    sQualityCheckParams qualityParams;
+
     #ifdef ENABLE_VPP_RUNTIME_HSBC
     /* run-time ProcAmp parameters */
     typedef struct {
@@ -328,6 +337,8 @@ struct sInputParams {
               uChromaSiting(0),
               GPUCopyValue(0),
               bPartialAccel(false),
+              bCpuRef(false),
+              cpuRefThreads(0),
               bPerf(false),
               numFrames(0),
               numRepeat(0),
@@ -337,6 +348,7 @@ struct sInputParams {
               ptsAdvanced(false),
               ptsFR(0.0),
               roiCheckParam(),
+              qualityParams(),
     #ifdef ENABLE_VPP_RUNTIME_HSBC
               rtHue({ 0 }),
               rtSaturation({ 0 }),
@@ -373,8 +385,18 @@ struct sFrameProcessor {
     std::unique_ptr<VPLImplementationLoader> pLoader;
     MainVideoSession mfxSession;
     MFXVideoVPP* pmfxVPP;
+    CCpuVPP* pCpuVPP; // same object as pmfxVPP in -cpu_ref mode, not owned
     mfxLoader loader = NULL;
-    sFrameProcessor(void) : pLoader(), mfxSession(), pmfxVPP(nullptr), loader(nullptr){};
+    sFrameProcessor(void)
+            : pLoader(),
+              mfxSession(),
+              pmfxVPP(nullptr),
+              pCpuVPP(nullptr),
+              loader(nullptr){};
+
+    mfxStatus SyncOperation(mfxSyncPoint syncp, mfxU32 wait) {
+        return pCpuVPP ? pCpuVPP->SyncOperation(syncp, wait) : mfxSession.SyncOperation(syncp, wait);
+    }
 };
 
 struct sMemoryAllocator {
@@ -464,16 +486,23 @@ public:
                            mfxFrameSurfaceWrap* pSurface);
     mfxStatus PutNextFrame(mfxFrameInfo* pInfo, mfxFrameSurfaceWrap* pSurface);
 
+    // every written frame is passed to the checker, also when there is no output file
+    void SetQualityChecker(CQualityChecker* pChecker) {
+        m_pQualityChecker = pChecker;
+    }
+
 protected:
     CRawVideoWriter(CRawVideoWriter const&)                  = delete;
     const CRawVideoWriter& operator=(CRawVideoWriter const&) = delete;
 
 private:
     mfxStatus WriteFrame(mfxFrameData* pData, mfxFrameInfo* pInfo);
+    mfxStatus CheckFrame(mfxFrameData* pData, mfxFrameInfo* pInfo);
 
     FILE* m_fDst;
     PTSMaker* m_pPTSMaker;
     mfxU32 m_forcedOutputFourcc;
+    CQualityChecker* m_pQualityChecker;
 };
 
 class GeneralWriter // : public CRawVideoWriter
@@ -494,6 +523,8 @@ public:
                            mfxFrameSurfaceWrap* pSurface);
     mfxStatus PutNextFrame(mfxFrameInfo* pInfo, mfxFrameSurfaceWrap* pSurface);
 
+    void SetQualityChecker(CQualityChecker* pChecker);
+
 private:
     std::unique_ptr<CRawVideoWriter> m_ofile[8];
 
@@ -187,7 +187,7 @@ mfxStatus OutputProcessFrame(sAppResources Resources,
 
     for (; !Resources.pSurfStore->m_SyncPoints.empty();
          Resources.pSurfStore->m_SyncPoints.pop_front()) {
-        sts = Resources.pProcessor->mfxSession.SyncOperation(
+        sts = Resources.pProcessor->SyncOperation(
             Resources.pSurfStore->m_SyncPoints.front().first,
             MSDK_VPP_WAIT_INTERVAL);
         if (sts == MFX_WRN_IN_EXECUTION) {
@@ -197,7 +197,7 @@ mfxStatus OutputProcessFrame(sAppResources Resources,
 
         pProcessedSurface = Resources.pSurfStore->m_SyncPoints.front().second.pSurface;
 
-        if (!Resources.pParams->strDstFiles.empty()) {
+        if (Resources.pDstFileWriters) {
             GeneralWriter* writer = (1 == Resources.dstFileWritersN)
                                         ? &Resources.pDstFileWriters[0]
                                         : &Resources.pDstFileWriters[paramID];
@@ -309,6 +309,7 @@ int sample_vpp_main(int argc, char* argv[]) {
     SurfaceVPPStore surfStore;
 
     unique_ptr<PTSMaker> ptsMaker;
+    CQualityChecker qualityChecker;
 
     /* generators for ROI testing */
     ROIGenerator inROIGenerator;
@@ -472,9 +473,19 @@ int sample_vpp_main(int argc, char* argv[]) {
     }
     ownToMfxFrameInfo(&(Params.frameInfoOut[0]), &realFrameInfoOut);
 
-    if (!Params.strDstFiles.empty()) {
-        //prepare file writers (YUV file)
-        Resources.dstFileWritersN = (mfxU32)Params.strDstFiles.size();
+    if (Params.qualityParams.IsEnabled()) {
+        Params.qualityParams.fileFourCC = Params.forcedOutputFourcc;
+        sts                             = qualityChecker.Init(Params.qualityParams);
+        MSDK_CHECK_STATUS_SAFE(sts, "qualityChecker.Init failed", {
+            WipeResources(&Resources);
+            WipeParams(&Params);
+        });
+    }
+
+    if (!Params.strDstFiles.empty() || Params.qualityParams.IsEnabled()) {
+        //prepare file writers (YUV file), output can be verified without writing it
+        Resources.dstFileWritersN =
+            Params.strDstFiles.empty() ? 1 : (mfxU32)Params.strDstFiles.size();
         Resources.pDstFileWriters = new GeneralWriter[Resources.dstFileWritersN];
         const char* istream;
         for (mfxU32 i = 0; i < Resources.dstFileWritersN; i++) {
@@ -487,6 +498,8 @@ int sample_vpp_main(int argc, char* argv[]) {
                 WipeResources(&Resources);
                 WipeParams(&Params);
             });
+            if (Params.qualityParams.IsEnabled())
+                Resources.pDstFileWriters[i].SetQualityChecker(&qualityChecker);
         }
     }
 
@@ -516,15 +529,17 @@ int sample_vpp_main(int argc, char* argv[]) {
         ROI_VAR_TO_VAR == Params.roiCheckParam.mode) {
         inROIGenerator.Init(realFrameInfoIn[0].Width,
                             realFrameInfoIn[0].Height,
-                            Params.roiCheckParam.srcSeed);
+                            Params.roiCheckParam.srcSeed,
+                            Params.numFrames);
         Params.roiCheckParam.srcSeed = inROIGenerator.GetSeed();
         bROITest[VPP_IN]             = true;
     }
     if (ROI_FIX_TO_VAR == Params.roiCheckParam.mode ||
         ROI_VAR_TO_VAR == Params.roiCheckParam.mode) {
-        outROIGenerator.Init(realFrameInfoIn[0].Width,
-                             realFrameInfoIn[0].Height,
-                             Params.roiCheckParam.dstSeed);
+        outROIGenerator.Init(realFrameInfoOut.Width,
+                             realFrameInfoOut.Height,
+                             Params.roiCheckParam.dstSeed,
+                             Params.numFrames);
         Params.roiCheckParam.dstSeed = outROIGenerator.GetSeed();
         bROITest[VPP_OUT]            = true;
     }
@@ -553,10 +568,12 @@ int sample_vpp_main(int argc, char* argv[]) {
     }
 
 #ifdef ONEVPL_EXPERIMENTAL
-    sts = SetParameters((mfxSession)Resources.pProcessor->mfxSession,
-                        mfxParamsVideo,
-                        Params.m_vpp_cfg);
-    MSDK_CHECK_STATUS(sts, "SetParameters failed");
+    if (!Params.bCpuRef) {
+        sts = SetParameters((mfxSession)Resources.pProcessor->mfxSession,
+                            mfxParamsVideo,
+                            Params.m_vpp_cfg);
+        MSDK_CHECK_STATUS(sts, "SetParameters failed");
+    }
 #endif
 
     if (Params.bPerf) {
@@ -575,7 +592,7 @@ int sample_vpp_main(int argc, char* argv[]) {
     }
 
     // print loaded lib info
-    if (Params.verSessionInit != API_1X) {
+    if (Params.verSessionInit != API_1X && !Params.bCpuRef) {
         PrintLibInfo(Resources.pProcessor);
     }
 
@@ -657,8 +674,12 @@ int sample_vpp_main(int argc, char* argv[]) {
                 WipeParams(&Params);
             });
 #ifdef ONEVPL_EXPERIMENTAL
-            sts = SetParameters(Resources.pProcessor->mfxSession, mfxParamsVideo, Params.m_vpp_cfg);
-            MSDK_CHECK_STATUS(sts, "SetParameters failed");
+            if (!Params.bCpuRef) {
+                sts = SetParameters(Resources.pProcessor->mfxSession,
+                                    mfxParamsVideo,
+                                    Params.m_vpp_cfg);
+                MSDK_CHECK_STATUS(sts, "SetParameters failed");
+            }
 #endif
 
             sts = ConfigVideoEnhancementFilters(&Params, &Resources, paramID);
@@ -949,11 +970,11 @@ int sample_vpp_main(int argc, char* argv[]) {
             MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_SURFACE);
             MSDK_BREAK_ON_ERROR(sts);
 
-            sts = Resources.pProcessor->mfxSession.SyncOperation(syncPoint, MSDK_VPP_WAIT_INTERVAL);
+            sts = Resources.pProcessor->SyncOperation(syncPoint, MSDK_VPP_WAIT_INTERVAL);
             if (sts)
                 printf("SyncOperation wait interval exceeded\n");
             MSDK_BREAK_ON_ERROR(sts);
-            if (!Resources.pParams->strDstFiles.empty()) {
+            if (Resources.pDstFileWriters) {
                 GeneralWriter* writer = (1 == Resources.dstFileWritersN)
                                             ? &Resources.pDstFileWriters[0]
                                             : &Resources.pDstFileWriters[paramID];
@@ -993,6 +1014,36 @@ int sample_vpp_main(int argc, char* argv[]) {
 
     PutPerformanceToFile(Params, nFrames / statTimer.GetTotalTime());
 
+    if (ptsMaker.get()) {
+        ptsMaker->PrintDriftStat();
+    }
+
+    if (bROITest[VPP_IN] && !Params.roiCheckParam.srcScheduleFile.empty()) {
+        sts = inROIGenerator.SaveSchedule(Params.roiCheckParam.srcScheduleFile.c_str());
+        MSDK_CHECK_STATUS_SAFE(sts, "Failed to save input ROI schedule", {
+            WipeResources(&Resources);
+            WipeParams(&Params);
+        });
+    }
+    if (bROITest[VPP_OUT] && !Params.roiCheckParam.dstScheduleFile.empty()) {
+        sts = outROIGenerator.SaveSchedule(Params.roiCheckParam.dstScheduleFile.c_str());
+        MSDK_CHECK_STATUS_SAFE(sts, "Failed to save output ROI schedule", {
+            WipeResources(&Resources);
+            WipeParams(&Params);
+        });
+    }
+
+    if (Params.qualityParams.IsEnabled()) {
+        qualityChecker.Close();
+        qualityChecker.PrintSummary("");
+
+        sts = qualityChecker.GetMismatchCount() ? MFX_ERR_ABORTED : MFX_ERR_NONE;
+        MSDK_CHECK_STATUS_SAFE(sts, "Output does not match the digest stream", {
+            WipeResources(&Resources);
+            WipeParams(&Params);
+        });
+    }
+
     WipeResources(&Resources);
     WipeParams(&Params);
 
@@ -0,0 +1,1031 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "sample_vpp_cpu.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "sample_defs.h"
+#include "vm/atomic_defs.h"
+#include "vpl/mfxmvc.h"
+
+#ifndef MFX_VERSION
+    #error MFX_VERSION not defined
+#endif
+
+// rows handed to a worker at once
+#define CPU_VPP_ROW_GRAIN 16
+
+// strength used when denoise is requested through mfxExtVPPDoUse only
+#define CPU_VPP_DEFAULT_DENOISE 50
+
+#define CPU_VPP_TIME_STAMP_FREQUENCY 90000
+
+/* ************************************************************************* */
+/* surface access helpers                                                    */
+/* ************************************************************************* */
+
+struct PlaneDesc {
+    mfxU8* ptr;
+    mfxU32 pitch; // bytes
+    mfxU32 step; // samples between neighbouring pixels
+    bool is16;
+    mfxU32 shift; // P010 with Shift=1 keeps samples in the high bits
+};
+
+static bool IsYUV420(mfxU32 fourcc) {
+    switch (fourcc) {
+        case MFX_FOURCC_NV12:
+        case MFX_FOURCC_I420:
+        case MFX_FOURCC_YV12:
+        case MFX_FOURCC_P010:
+        case MFX_FOURCC_I010:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static mfxU16 GetBitDepth(const mfxFrameInfo& info) {
+    if (info.FourCC == MFX_FOURCC_P010 || info.FourCC == MFX_FOURCC_I010)
+        return info.BitDepthLuma ? info.BitDepthLuma : 10;
+    return 8;
+}
+
+static mfxU32 GetPitch(const mfxFrameData& data) {
+    return ((mfxU32)data.PitchHigh << 16) | data.PitchLow;
+}
+
+// fills Y,U,V (or R,G,B,A for RGB4) plane descriptors
+static void GetPlanes(const mfxFrameSurface1* s, PlaneDesc desc[4]) {
+    const mfxFrameData& d = s->Data;
+    mfxU32 pitch          = GetPitch(d);
+    bool is16             = (s->Info.FourCC == MFX_FOURCC_P010 || s->Info.FourCC == MFX_FOURCC_I010);
+    mfxU32 shift          = (s->Info.FourCC == MFX_FOURCC_P010 && s->Info.Shift)
+                                ? 16 - GetBitDepth(s->Info)
+                                : 0;
+
+    memset(desc, 0, sizeof(PlaneDesc) * 4);
+
+    switch (s->Info.FourCC) {
+        case MFX_FOURCC_NV12:
+        case MFX_FOURCC_P010:
+            desc[0] = { d.Y, pitch, 1, is16, shift };
+            desc[1] = { d.U, pitch, 2, is16, shift };
+            desc[2] = { d.V, pitch, 2, is16, shift };
+            break;
+        case MFX_FOURCC_I420:
+        case MFX_FOURCC_YV12:
+        case MFX_FOURCC_I010:
+            desc[0] = { d.Y, pitch, 1, is16, shift };
+            desc[1] = { d.U, pitch / 2, 1, is16, shift };
+            desc[2] = { d.V, pitch / 2, 1, is16, shift };
+            break;
+        case MFX_FOURCC_RGB4:
+            desc[0] = { d.R, pitch, 4, false, 0 };
+            desc[1] = { d.G, pitch, 4, false, 0 };
+            desc[2] = { d.B, pitch, 4, false, 0 };
+            desc[3] = { d.A, pitch, 4, false, 0 };
+            break;
+        default:
+            break;
+    }
+}
+
+static void LoadRow(const PlaneDesc& d,
+                    mfxU32 x,
+                    mfxU32 y,
+                    mfxU32 n,
+                    mfxU16* __restrict dst) {
+    if (d.is16) {
+        const mfxU16* src = (const mfxU16*)(d.ptr + (size_t)y * d.pitch) + (size_t)x * d.step;
+        for (mfxU32 i = 0; i < n; i++)
+            dst[i] = (mfxU16)(src[i * d.step] >> d.shift);
+    }
+    else {
+        const mfxU8* src = d.ptr + (size_t)y * d.pitch + (size_t)x * d.step;
+        for (mfxU32 i = 0; i < n; i++)
+            dst[i] = src[i * d.step];
+    }
+}
+
+// alpha in [0, 255], 255 overwrites the destination
+static void StoreRow(const PlaneDesc& d,
+                     mfxU32 x,
+                     mfxU32 y,
+                     mfxU32 n,
+                     const mfxU16* __restrict src,
+                     mfxU16 alpha) {
+    if (d.is16) {
+        mfxU16* dst = (mfxU16*)(d.ptr + (size_t)y * d.pitch) + (size_t)x * d.step;
+        if (alpha >= 255) {
+            for (mfxU32 i = 0; i < n; i++)
+                dst[i * d.step] = (mfxU16)(src[i] << d.shift);
+        }
+        else {
+            for (mfxU32 i = 0; i < n; i++) {
+                mfxU32 old      = dst[i * d.step] >> d.shift;
+                mfxU32 v        = (src[i] * alpha + old * (255 - alpha) + 127) / 255;
+                dst[i * d.step] = (mfxU16)(v << d.shift);
+            }
+        }
+    }
+    else {
+        mfxU8* dst = d.ptr + (size_t)y * d.pitch + (size_t)x * d.step;
+        if (alpha >= 255) {
+            for (mfxU32 i = 0; i < n; i++)
+                dst[i * d.step] = (mfxU8)src[i];
+        }
+        else {
+            for (mfxU32 i = 0; i < n; i++) {
+                mfxU32 old      = dst[i * d.step];
+                dst[i * d.step] = (mfxU8)((src[i] * alpha + old * (255 - alpha) + 127) / 255);
+            }
+        }
+    }
+}
+
+static inline mfxU16 Clip(mfxI32 v, mfxI32 maxVal) {
+    return (mfxU16)(v < 0 ? 0 : (v > maxVal ? maxVal : v));
+}
+
+// rounds or expands a sample between bit depths
+static inline mfxU16 ConvertDepth(mfxU16 v, mfxU16 from, mfxU16 to) {
+    if (from == to)
+        return v;
+    if (from > to) {
+        mfxU32 s = from - to;
+        return Clip((v + (1 << (s - 1))) >> s, (1 << to) - 1);
+    }
+    return (mfxU16)(v << (to - from));
+}
+
+/* ************************************************************************* */
+/* color conversion, 8 bit limited range, Q8 coefficients                    */
+/* ************************************************************************* */
+
+struct YUV2RGB {
+    mfxI32 y, rv, gu, gv, bu;
+};
+struct RGB2YUV {
+    mfxI32 yr, yg, yb, ur, ug, ub, vr, vg, vb;
+};
+
+static const YUV2RGB kYUV2RGB601 = { 298, 409, 100, 208, 516 };
+static const YUV2RGB kYUV2RGB709 = { 298, 459, 55, 136, 541 };
+static const RGB2YUV kRGB2YUV601 = { 66, 129, 25, -38, -74, 112, 112, -94, -18 };
+static const RGB2YUV kRGB2YUV709 = { 47, 157, 16, -26, -87, 112, 112, -102, -10 };
+
+static inline void ToRGB(const YUV2RGB& m, mfxI32 y, mfxI32 u, mfxI32 v, mfxU16 rgb[3]) {
+    y      = m.y * (y - 16) + 128;
+    u      = u - 128;
+    v      = v - 128;
+    rgb[0] = Clip((y + m.rv * v) >> 8, 255);
+    rgb[1] = Clip((y - m.gu * u - m.gv * v) >> 8, 255);
+    rgb[2] = Clip((y + m.bu * u) >> 8, 255);
+}
+
+static inline mfxU16 ToY(const RGB2YUV& m, mfxI32 r, mfxI32 g, mfxI32 b) {
+    return Clip(((m.yr * r + m.yg * g + m.yb * b + 128) >> 8) + 16, 255);
+}
+
+static inline mfxU16 ToU(const RGB2YUV& m, mfxI32 r, mfxI32 g, mfxI32 b) {
+    return Clip(((m.ur * r + m.ug * g + m.ub * b + 128) >> 8) + 128, 255);
+}
+
+static inline mfxU16 ToV(const RGB2YUV& m, mfxI32 r, mfxI32 g, mfxI32 b) {
+    return Clip(((m.vr * r + m.vg * g + m.vb * b + 128) >> 8) + 128, 255);
+}
+
+/* ************************************************************************* */
+
+CCpuVPP::CCpuVPP(mfxU32 numThreads)
+        : MFXVideoVPP((mfxSession)0),
+          m_pool(numThreads),
+          m_pAllocator(nullptr),
+          m_bInitialized(false),
+          m_par(),
+          m_cfg(),
+          m_src(),
+          m_dst(),
+          m_tmp(),
+          m_xIdx(),
+          m_yIdx(),
+          m_xFrac(),
+          m_yFrac(),
+          m_inFrames(0),
+          m_outFrames(0),
+          m_firstTimeStamp(0),
+          m_compInputs(),
+          m_lastTask(0),
+          m_numFramesOut(0) {}
+
+CCpuVPP::~CCpuVPP() {
+    Close();
+}
+
+bool CCpuVPP::IsFourCCSupported(mfxU32 fourcc) {
+    return IsYUV420(fourcc) || fourcc == MFX_FOURCC_RGB4;
+}
+
+mfxStatus CCpuVPP::ParseExtBuffers(mfxVideoParam* par, Config& cfg, bool* pFilterSkipped) {
+    bool denoiseDoUse = false;
+
+    cfg.denoiseStrength = 0;
+    cfg.interpolation   = MFX_INTERPOLATION_DEFAULT;
+    cfg.frcAlgorithm    = MFX_FRCALGM_PRESERVE_TIMESTAMP;
+    cfg.inMatrix        = MFX_TRANSFERMATRIX_BT601;
+    cfg.outMatrix       = MFX_TRANSFERMATRIX_BT601;
+    cfg.composition.clear();
+    memset(cfg.background, 0, sizeof(cfg.background));
+
+    for (mfxU32 i = 0; i < par->NumExtParam; i++) {
+        mfxExtBuffer* pBuf = par->ExtParam ? par->ExtParam[i] : nullptr;
+        if (!pBuf)
+            return MFX_ERR_NULL_PTR;
+
+        switch (pBuf->BufferId) {
+            case MFX_EXTBUFF_VPP_DOUSE: {
+                auto doUse = (mfxExtVPPDoUse*)pBuf;
+                for (mfxU32 j = 0; j < doUse->NumAlg; j++) {
+                    switch (doUse->AlgList[j]) {
+                        case MFX_EXTBUFF_VPP_DENOISE:
+                            denoiseDoUse = true;
+                            break;
+                        case MFX_EXTBUFF_VIDEO_SIGNAL_INFO_IN:
+                        case MFX_EXTBUFF_VIDEO_SIGNAL_INFO_OUT:
+                            break;
+                        default:
+                            *pFilterSkipped = true;
+                            break;
+                    }
+                }
+                break;
+            }
+            case MFX_EXTBUFF_VPP_DENOISE2:
+                cfg.denoiseStrength = ((mfxExtVPPDenoise2*)pBuf)->Strength;
+                if (!cfg.denoiseStrength)
+                    denoiseDoUse = true;
+                break;
+            case MFX_EXTBUFF_VPP_DENOISE:
+                cfg.denoiseStrength = ((mfxExtVPPDenoise*)pBuf)->DenoiseFactor;
+                break;
+            case MFX_EXTBUFF_VPP_DEINTERLACING: {
+                mfxU16 mode = ((mfxExtVPPDeinterlacing*)pBuf)->Mode;
+                // every spatial mode is served by bob, telecine handling is not implemented
+                if (mode != MFX_DEINTERLACING_BOB && mode != MFX_DEINTERLACING_ADVANCED &&
+                    mode != MFX_DEINTERLACING_ADVANCED_NOREF &&
+                    mode != MFX_DEINTERLACING_ADVANCED_SCD && mode != MFX_DEINTERLACING_FIELD_WEAVING)
+                    *pFilterSkipped = true;
+                break;
+            }
+            case MFX_EXTBUFF_VPP_SCALING:
+                cfg.interpolation = ((mfxExtVPPScaling*)pBuf)->InterpolationMethod;
+                break;
+            case MFX_EXTBUFF_VPP_FRAME_RATE_CONVERSION:
+                cfg.frcAlgorithm = ((mfxExtVPPFrameRateConversion*)pBuf)->Algorithm;
+                // interpolated frames are replaced by repeated ones
+                if (cfg.frcAlgorithm == MFX_FRCALGM_FRAME_INTERPOLATION)
+                    *pFilterSkipped = true;
+                break;
+            case MFX_EXTBUFF_VPP_VIDEO_SIGNAL_INFO: {
+                auto vsi = (mfxExtVPPVideoSignalInfo*)pBuf;
+                if (vsi->In.TransferMatrix || vsi->Out.TransferMatrix) {
+                    cfg.inMatrix  = vsi->In.TransferMatrix;
+                    cfg.outMatrix = vsi->Out.TransferMatrix;
+                }
+                else {
+                    cfg.inMatrix = cfg.outMatrix = vsi->TransferMatrix;
+                }
+                break;
+            }
+            case MFX_EXTBUFF_VPP_COMPOSITE: {
+                auto comp = (mfxExtVPPComposite*)pBuf;
+                if (comp->NumInputStream && !comp->InputStream)
+                    return MFX_ERR_NULL_PTR;
+                cfg.composition.assign(comp->InputStream,
+                                       comp->InputStream + comp->NumInputStream);
+                cfg.background[0] = comp->Y;
+                cfg.background[1] = comp->U;
+                cfg.background[2] = comp->V;
+                break;
+            }
+            // do not change the picture in this implementation
+            case MFX_EXTBUFF_VPP_COLORFILL:
+            case MFX_EXTBUFF_VPP_COLOR_CONVERSION:
+            case MFX_EXTBUFF_VIDEO_SIGNAL_INFO_IN:
+            case MFX_EXTBUFF_VIDEO_SIGNAL_INFO_OUT:
+            case MFX_EXTBUFF_MVC_SEQ_DESC:
+                break;
+            default:
+                *pFilterSkipped = true;
+                break;
+        }
+    }
+
+    if (denoiseDoUse && !cfg.denoiseStrength)
+        cfg.denoiseStrength = CPU_VPP_DEFAULT_DENOISE;
+    if (cfg.denoiseStrength > 100)
+        cfg.denoiseStrength = 100;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CCpuVPP::CheckParams(mfxVideoParam* par, bool* pFilterSkipped) {
+    MSDK_CHECK_POINTER(par, MFX_ERR_NULL_PTR);
+
+    if (par->IOPattern & (MFX_IOPATTERN_IN_VIDEO_MEMORY | MFX_IOPATTERN_OUT_VIDEO_MEMORY))
+        return MFX_ERR_UNSUPPORTED;
+
+    const mfxFrameInfo* info[2] = { &par->vpp.In, &par->vpp.Out };
+    for (auto pInfo : info) {
+        if (!IsFourCCSupported(pInfo->FourCC))
+            return MFX_ERR_UNSUPPORTED;
+        if (!pInfo->Width || !pInfo->Height)
+            return MFX_ERR_INVALID_VIDEO_PARAM;
+        if (pInfo->CropX + pInfo->CropW > pInfo->Width ||
+            pInfo->CropY + pInfo->CropH > pInfo->Height)
+            return MFX_ERR_INVALID_VIDEO_PARAM;
+    }
+
+    // interlaced output is not produced
+    if (par->vpp.Out.PicStruct != MFX_PICSTRUCT_PROGRESSIVE &&
+        par->vpp.Out.PicStruct != MFX_PICSTRUCT_UNKNOWN &&
+        par->vpp.Out.PicStruct != par->vpp.In.PicStruct)
+        *pFilterSkipped = true;
+
+    Config cfg;
+    mfxStatus sts = ParseExtBuffers(par, cfg, pFilterSkipped);
+    MSDK_CHECK_STATUS(sts, "ParseExtBuffers failed");
+
+    bool rateChange = (mfxU64)par->vpp.In.FrameRateExtN * par->vpp.Out.FrameRateExtD !=
+                      (mfxU64)par->vpp.Out.FrameRateExtN * par->vpp.In.FrameRateExtD;
+    if (rateChange && (!par->vpp.In.FrameRateExtN || !par->vpp.In.FrameRateExtD ||
+                       !par->vpp.Out.FrameRateExtN || !par->vpp.Out.FrameRateExtD))
+        return MFX_ERR_INVALID_VIDEO_PARAM;
+
+    if (rateChange && !cfg.composition.empty())
+        return MFX_ERR_UNSUPPORTED;
+
+    for (auto& stream : cfg.composition) {
+        if (stream.DstX + stream.DstW > par->vpp.Out.Width ||
+            stream.DstY + stream.DstH > par->vpp.Out.Height)
+            return MFX_ERR_INVALID_VIDEO_PARAM;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CCpuVPP::Query(mfxVideoParam* in, mfxVideoParam* out) {
+    MSDK_CHECK_POINTER(out, MFX_ERR_NULL_PTR);
+
+    mfxExtBuffer** extParam = out->ExtParam;
+    mfxU16 numExtParam      = out->NumExtParam;
+
+    if (!in) {
+        // report configurable fields
+        memset(&out->vpp, 0, sizeof(out->vpp));
+        mfxFrameInfo* info[2] = { &out->vpp.In, &out->vpp.Out };
+        for (auto pInfo : info) {
+            pInfo->FourCC        = 1;
+            pInfo->Width         = 1;
+            pInfo->Height        = 1;
+            pInfo->CropX         = 1;
+            pInfo->CropY         = 1;
+            pInfo->CropW         = 1;
+            pInfo->CropH         = 1;
+            pInfo->PicStruct     = 1;
+            pInfo->FrameRateExtN = 1;
+            pInfo->FrameRateExtD = 1;
+        }
+        out->IOPattern  = 1;
+        out->AsyncDepth = 1;
+        return MFX_ERR_NONE;
+    }
+
+    *out             = *in;
+    out->ExtParam    = extParam;
+    out->NumExtParam = numExtParam;
+
+    bool filterSkipped = false;
+    mfxStatus sts      = CheckParams(in, &filterSkipped);
+    MSDK_CHECK_STATUS(sts, "CheckParams failed");
+
+    return filterSkipped ? MFX_WRN_FILTER_SKIPPED : MFX_ERR_NONE;
+}
+
+mfxStatus CCpuVPP::QueryIOSurf(mfxVideoParam* par, mfxFrameAllocRequest request[2]) {
+    MSDK_CHECK_POINTER(par, MFX_ERR_NULL_PTR);
+    MSDK_CHECK_POINTER(request, MFX_ERR_NULL_PTR);
+
+    bool filterSkipped = false;
+    mfxStatus sts      = CheckParams(par, &filterSkipped);
+    MSDK_CHECK_STATUS(sts, "CheckParams failed");
+
+    // an output surface is released only after the application synced it
+    mfxU16 numFrames = (mfxU16)((par->AsyncDepth ? par->AsyncDepth : 1) + 1);
+
+    request[0]                   = {};
+    request[0].Info              = par->vpp.In;
+    request[0].NumFrameMin       = 1;
+    request[0].NumFrameSuggested = numFrames;
+    request[0].Type = MFX_MEMTYPE_FROM_VPPIN | MFX_MEMTYPE_SYSTEM_MEMORY | MFX_MEMTYPE_EXTERNAL_FRAME;
+
+    request[1]                   = {};
+    request[1].Info              = par->vpp.Out;
+    request[1].NumFrameMin       = 1;
+    request[1].NumFrameSuggested = numFrames;
+    request[1].Type = MFX_MEMTYPE_FROM_VPPOUT | MFX_MEMTYPE_SYSTEM_MEMORY | MFX_MEMTYPE_EXTERNAL_FRAME;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CCpuVPP::Init(mfxVideoParam* par) {
+    MSDK_CHECK_POINTER(par, MFX_ERR_NULL_PTR);
+    if (m_bInitialized)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    bool filterSkipped = false;
+    mfxStatus sts      = CheckParams(par, &filterSkipped);
+    MSDK_CHECK_STATUS(sts, "CheckParams failed");
+
+    sts = ParseExtBuffers(par, m_cfg, &filterSkipped);
+    MSDK_CHECK_STATUS(sts, "ParseExtBuffers failed");
+
+    m_par             = *par;
+    m_par.ExtParam    = nullptr;
+    m_par.NumExtParam = 0;
+    m_cfg.bFRC        = (mfxU64)par->vpp.In.FrameRateExtN * par->vpp.Out.FrameRateExtD !=
+                 (mfxU64)par->vpp.Out.FrameRateExtN * par->vpp.In.FrameRateExtD;
+
+    m_inFrames       = 0;
+    m_outFrames      = 0;
+    m_firstTimeStamp = 0;
+    m_numFramesOut   = 0;
+    m_compInputs.clear();
+
+    m_bInitialized = true;
+
+    return filterSkipped ? MFX_WRN_FILTER_SKIPPED : MFX_ERR_NONE;
+}
+
+mfxStatus CCpuVPP::Reset(mfxVideoParam* par) {
+    MSDK_CHECK_POINTER(par, MFX_ERR_NULL_PTR);
+    if (!m_bInitialized)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    // surfaces held for an unfinished composition are given back
+    for (auto pSurf : m_compInputs)
+        msdk_atomic_dec16((volatile mfxU16*)&pSurf->Data.Locked);
+    m_compInputs.clear();
+
+    m_bInitialized = false;
+    return Init(par);
+}
+
+mfxStatus CCpuVPP::Close(void) {
+    if (!m_bInitialized)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    for (auto pSurf : m_compInputs)
+        msdk_atomic_dec16((volatile mfxU16*)&pSurf->Data.Locked);
+    m_compInputs.clear();
+
+    m_bInitialized = false;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CCpuVPP::GetVideoParam(mfxVideoParam* par) {
+    MSDK_CHECK_POINTER(par, MFX_ERR_NULL_PTR);
+    if (!m_bInitialized)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    mfxExtBuffer** extParam = par->ExtParam;
+    mfxU16 numExtParam      = par->NumExtParam;
+
+    *par             = m_par;
+    par->ExtParam    = extParam;
+    par->NumExtParam = numExtParam;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CCpuVPP::GetVPPStat(mfxVPPStat* stat) {
+    MSDK_CHECK_POINTER(stat, MFX_ERR_NULL_PTR);
+    if (!m_bInitialized)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    memset(stat, 0, sizeof(*stat));
+    stat->NumFrame       = m_numFramesOut;
+    stat->NumCachedFrame = (mfxU32)m_compInputs.size();
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CCpuVPP::GetSurfaceIn(mfxFrameSurface1** /*output_surf*/) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus CCpuVPP::GetSurfaceOut(mfxFrameSurface1** /*output_surf*/) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus CCpuVPP::ProcessFrameAsync(mfxFrameSurface1* /*in*/, mfxFrameSurface1** /*out*/) {
+    return MFX_ERR_NOT_IMPLEMENTED;
+}
+
+mfxStatus CCpuVPP::SyncOperation(mfxSyncPoint syncp, mfxU32 /*wait*/) {
+    mfxU64 task = (mfxU64)(size_t)syncp;
+    if (!task || task > m_lastTask)
+        return MFX_ERR_NULL_PTR;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CCpuVPP::LockSurface(mfxFrameSurface1* surface, bool* pLocked) {
+    *pLocked = false;
+    if (surface->Data.Y || surface->Data.B)
+        return MFX_ERR_NONE;
+
+    MSDK_CHECK_POINTER(m_pAllocator, MFX_ERR_LOCK_MEMORY);
+    mfxStatus sts = m_pAllocator->Lock(m_pAllocator->pthis, surface->Data.MemId, &surface->Data);
+    MSDK_CHECK_STATUS(sts, "m_pAllocator->Lock failed");
+    *pLocked = true;
+
+    return MFX_ERR_NONE;
+}
+
+void CCpuVPP::UnlockSurface(mfxFrameSurface1* surface, bool locked) {
+    if (locked)
+        m_pAllocator->Unlock(m_pAllocator->pthis, surface->Data.MemId, &surface->Data);
+}
+
+/* ************************************************************************* */
+/* processing stages                                                          */
+/* ************************************************************************* */
+
+void CCpuVPP::Unpack(const mfxFrameSurface1* in, Picture& pic) {
+    const mfxFrameInfo& info = in->Info;
+
+    mfxU32 cx = info.CropX, cy = info.CropY;
+    mfxU32 cw = info.CropW ? info.CropW : info.Width;
+    mfxU32 ch = info.CropH ? info.CropH : info.Height;
+
+    PlaneDesc desc[4];
+    GetPlanes(in, desc);
+
+    pic.isRGB    = !IsYUV420(info.FourCC);
+    pic.bitDepth = GetBitDepth(info);
+
+    pic.plane[0].Resize(cw, ch);
+    if (pic.isRGB) {
+        pic.plane[1].Resize(cw, ch);
+        pic.plane[2].Resize(cw, ch);
+    }
+    else {
+        pic.plane[1].Resize((cw + 1) / 2, (ch + 1) / 2);
+        pic.plane[2].Resize((cw + 1) / 2, (ch + 1) / 2);
+    }
+
+    // odd crops may point one chroma sample outside of the surface
+    mfxU32 chromaW = (info.Width + 1) / 2, chromaH = (info.Height + 1) / 2;
+    mfxU32 ccx = std::min(cx / 2, chromaW - pic.plane[1].width);
+    mfxU32 ccy = std::min(cy / 2, chromaH - pic.plane[1].height);
+
+    m_pool.ParallelFor(
+        ch,
+        [&](mfxU32 begin, mfxU32 end) {
+            for (mfxU32 y = begin; y < end; y++) {
+                if (pic.isRGB) {
+                    for (int p = 0; p < 3; p++)
+                        LoadRow(desc[p], cx, cy + y, cw, pic.plane[p].Row(y));
+                    continue;
+                }
+
+                LoadRow(desc[0], cx, cy + y, cw, pic.plane[0].Row(y));
+                if (y % 2 == 0) {
+                    mfxU32 cy2 = y / 2;
+                    LoadRow(desc[1], ccx, ccy + cy2, pic.plane[1].width, pic.plane[1].Row(cy2));
+                    LoadRow(desc[2], ccx, ccy + cy2, pic.plane[2].width, pic.plane[2].Row(cy2));
+                }
+            }
+        },
+        CPU_VPP_ROW_GRAIN);
+}
+
+void CCpuVPP::Deinterlace(Picture& pic, bool topFieldFirst) {
+    // bob: rows of the second field are interpolated from the first one
+    for (int p = 0; p < 3; p++) {
+        Plane& plane = pic.plane[p];
+        if (plane.height < 2)
+            continue;
+
+        mfxU32 first = topFieldFirst ? 1 : 0;
+        mfxU32 count = (plane.height - first + 1) / 2;
+
+        m_pool.ParallelFor(
+            count,
+            [&](mfxU32 begin, mfxU32 end) {
+                for (mfxU32 i = begin; i < end; i++) {
+                    mfxU32 y           = first + 2 * i;
+                    const mfxU16* prev = plane.Row(y ? y - 1 : y + 1);
+                    const mfxU16* next = plane.Row(y + 1 < plane.height ? y + 1 : y - 1);
+                    mfxU16* dst        = plane.Row(y);
+                    for (mfxU32 x = 0; x < plane.width; x++)
+                        dst[x] = (mfxU16)((prev[x] + next[x] + 1) >> 1);
+                }
+            },
+            CPU_VPP_ROW_GRAIN / 2);
+    }
+}
+
+void CCpuVPP::Denoise(Picture& pic, mfxU16 strength) {
+    // 3x3 box filter blended with the source, luma only for YUV
+    int numPlanes = pic.isRGB ? 3 : 1;
+
+    for (int p = 0; p < numPlanes; p++) {
+        Plane& plane = pic.plane[p];
+        mfxU32 w = plane.width, h = plane.height;
+        if (!w || !h)
+            continue;
+
+        m_tmp.Resize(w, h);
+
+        m_pool.ParallelFor(
+            h,
+            [&](mfxU32 begin, mfxU32 end) {
+                for (mfxU32 y = begin; y < end; y++) {
+                    const mfxU16* r0 = plane.Row(y ? y - 1 : 0);
+                    const mfxU16* r1 = plane.Row(y);
+                    const mfxU16* r2 = plane.Row(y + 1 < h ? y + 1 : h - 1);
+                    mfxU16* dst      = m_tmp.Row(y);
+                    for (mfxU32 x = 0; x < w; x++) {
+                        mfxU32 xl  = x ? x - 1 : 0;
+                        mfxU32 xr  = x + 1 < w ? x + 1 : w - 1;
+                        mfxU32 sum = r0[xl] + r0[x] + r0[xr] + r1[xl] + r1[x] + r1[xr] + r2[xl] +
+                                     r2[x] + r2[xr];
+                        mfxU32 box = (sum + 4) / 9;
+                        dst[x]     = (mfxU16)((r1[x] * (100 - strength) + box * strength + 50) / 100);
+                    }
+                }
+            },
+            CPU_VPP_ROW_GRAIN);
+
+        std::swap(plane.data, m_tmp.data);
+    }
+}
+
+static void BuildScaleTable(mfxU32 srcN,
+                            mfxU32 dstN,
+                            bool nearest,
+                            std::vector<mfxU32>& idx,
+                            std::vector<mfxU16>& frac) {
+    idx.resize(dstN);
+    frac.resize(dstN);
+
+    for (mfxU32 i = 0; i < dstN; i++) {
+        if (nearest) {
+            idx[i]  = (mfxU32)(((mfxU64)(2 * i + 1) * srcN) / (2 * (mfxU64)dstN));
+            frac[i] = 0;
+        }
+        else {
+            // center aligned source position in Q8
+            mfxI64 pos = (mfxI64)(((mfxU64)(2 * i + 1) * srcN * 128) / dstN) - 128;
+            if (pos < 0)
+                pos = 0;
+            idx[i]  = (mfxU32)(pos >> 8);
+            frac[i] = (mfxU16)(pos & 0xFF);
+        }
+        if (idx[i] >= srcN - 1) {
+            idx[i]  = srcN - 1;
+            frac[i] = 0;
+        }
+    }
+}
+
+void CCpuVPP::Scale(const Plane& src, Plane& dst, mfxU32 dstW, mfxU32 dstH) {
+    dst.Resize(dstW, dstH);
+    if (!dstW || !dstH || !src.width || !src.height)
+        return;
+
+    if (src.width == dstW && src.height == dstH) {
+        memcpy(dst.data.data(), src.data.data(), (size_t)dstW * dstH * sizeof(mfxU16));
+        return;
+    }
+
+    bool nearest = (m_cfg.interpolation == MFX_INTERPOLATION_NEAREST_NEIGHBOR);
+    BuildScaleTable(src.width, dstW, nearest, m_xIdx, m_xFrac);
+    BuildScaleTable(src.height, dstH, nearest, m_yIdx, m_yFrac);
+
+    // horizontal pass: src.width x src.height -> dstW x src.height
+    m_tmp.Resize(dstW, src.height);
+    m_pool.ParallelFor(
+        src.height,
+        [&](mfxU32 begin, mfxU32 end) {
+            const mfxU32* idx  = m_xIdx.data();
+            const mfxU16* frac = m_xFrac.data();
+            mfxU32 last        = src.width - 1;
+            for (mfxU32 y = begin; y < end; y++) {
+                const mfxU16* s = src.Row(y);
+                mfxU16* d       = m_tmp.Row(y);
+                for (mfxU32 x = 0; x < dstW; x++) {
+                    mfxU32 i0 = idx[x];
+                    mfxU32 i1 = i0 < last ? i0 + 1 : last;
+                    mfxU32 f  = frac[x];
+                    d[x]      = (mfxU16)((s[i0] * (256 - f) + s[i1] * f + 128) >> 8);
+                }
+            }
+        },
+        CPU_VPP_ROW_GRAIN);
+
+    // vertical pass: dstW x src.height -> dstW x dstH
+    m_pool.ParallelFor(
+        dstH,
+        [&](mfxU32 begin, mfxU32 end) {
+            mfxU32 last = src.height - 1;
+            for (mfxU32 y = begin; y < end; y++) {
+                mfxU32 i0        = m_yIdx[y];
+                mfxU32 i1        = i0 < last ? i0 + 1 : last;
+                mfxU32 f         = m_yFrac[y];
+                const mfxU16* s0 = m_tmp.Row(i0);
+                const mfxU16* s1 = m_tmp.Row(i1);
+                mfxU16* d        = dst.Row(y);
+                for (mfxU32 x = 0; x < dstW; x++)
+                    d[x] = (mfxU16)((s0[x] * (256 - f) + s1[x] * f + 128) >> 8);
+            }
+        },
+        CPU_VPP_ROW_GRAIN);
+}
+
+void CCpuVPP::Pack(const Picture& pic,
+                   mfxFrameSurface1* out,
+                   const mfxFrameInfo& rect,
+                   mfxU16 alpha) {
+    PlaneDesc desc[4];
+    GetPlanes(out, desc);
+
+    bool outRGB     = !IsYUV420(out->Info.FourCC);
+    mfxU16 outDepth = GetBitDepth(out->Info);
+    mfxU32 rx = rect.CropX, ry = rect.CropY, rw = rect.CropW, rh = rect.CropH;
+
+    const YUV2RGB& toRGB = (m_cfg.inMatrix == MFX_TRANSFERMATRIX_BT709) ? kYUV2RGB709 : kYUV2RGB601;
+    const RGB2YUV& toYUV = (m_cfg.outMatrix == MFX_TRANSFERMATRIX_BT709) ? kRGB2YUV709 : kRGB2YUV601;
+
+    mfxU32 chromaW = (out->Info.Width + 1) / 2, chromaH = (out->Info.Height + 1) / 2;
+    mfxU32 ccx = rx / 2, ccy = ry / 2;
+    mfxU32 ccw = std::min((rw + 1) / 2, chromaW - ccx);
+    mfxU32 cch = std::min((rh + 1) / 2, chromaH - ccy);
+
+    m_pool.ParallelFor(
+        rh,
+        [&](mfxU32 begin, mfxU32 end) {
+            std::vector<mfxU16> row[3];
+            for (auto& r : row)
+                r.resize(rw);
+
+            for (mfxU32 y = begin; y < end; y++) {
+                bool chromaRow = !outRGB && (y % 2 == 0) && (y / 2 < cch);
+
+                if (!pic.isRGB && !outRGB) {
+                    // YUV -> YUV, bit depth only
+                    const mfxU16* s = pic.plane[0].Row(y);
+                    for (mfxU32 x = 0; x < rw; x++)
+                        row[0][x] = ConvertDepth(s[x], pic.bitDepth, outDepth);
+                    StoreRow(desc[0], rx, ry + y, rw, row[0].data(), alpha);
+
+                    if (chromaRow) {
+                        for (int p = 1; p < 3; p++) {
+                            const mfxU16* c = pic.plane[p].Row(y / 2);
+                            for (mfxU32 x = 0; x < ccw; x++)
+                                row[p][x] = ConvertDepth(c[x], pic.bitDepth, outDepth);
+                            StoreRow(desc[p], ccx, ccy + y / 2, ccw, row[p].data(), alpha);
+                        }
+                    }
+                }
+                else if (pic.isRGB && outRGB) {
+                    for (int p = 0; p < 3; p++)
+                        StoreRow(desc[p], rx, ry + y, rw, pic.plane[p].Row(y), alpha);
+                }
+                else if (outRGB) {
+                    // YUV 4:2:0 -> RGB, chroma is replicated
+                    const mfxU16* sy = pic.plane[0].Row(y);
+                    const mfxU16* su = pic.plane[1].Row(y / 2);
+                    const mfxU16* sv = pic.plane[2].Row(y / 2);
+                    mfxU16 rgb[3];
+                    for (mfxU32 x = 0; x < rw; x++) {
+                        ToRGB(toRGB,
+                              ConvertDepth(sy[x], pic.bitDepth, 8),
+                              ConvertDepth(su[x / 2], pic.bitDepth, 8),
+                              ConvertDepth(sv[x / 2], pic.bitDepth, 8),
+                              rgb);
+                        row[0][x] = rgb[0];
+                        row[1][x] = rgb[1];
+                        row[2][x] = rgb[2];
+                    }
+                    for (int p = 0; p < 3; p++)
+                        StoreRow(desc[p], rx, ry + y, rw, row[p].data(), alpha);
+                }
+                else {
+                    // RGB -> YUV 4:2:0, chroma from the average of each 2x2 block
+                    const mfxU16* r = pic.plane[0].Row(y);
+                    const mfxU16* g = pic.plane[1].Row(y);
+                    const mfxU16* b = pic.plane[2].Row(y);
+                    for (mfxU32 x = 0; x < rw; x++)
+                        row[0][x] = ConvertDepth(ToY(toYUV, r[x], g[x], b[x]), 8, outDepth);
+                    StoreRow(desc[0], rx, ry + y, rw, row[0].data(), alpha);
+
+                    if (chromaRow) {
+                        mfxU32 y1        = (y + 1 < rh) ? y + 1 : y;
+                        const mfxU16* r1 = pic.plane[0].Row(y1);
+                        const mfxU16* g1 = pic.plane[1].Row(y1);
+                        const mfxU16* b1 = pic.plane[2].Row(y1);
+                        for (mfxU32 x = 0; x < ccw; x++) {
+                            mfxU32 x0 = 2 * x, x1 = (2 * x + 1 < rw) ? 2 * x + 1 : 2 * x;
+                            mfxI32 ar = (r[x0] + r[x1] + r1[x0] + r1[x1] + 2) >> 2;
+                            mfxI32 ag = (g[x0] + g[x1] + g1[x0] + g1[x1] + 2) >> 2;
+                            mfxI32 ab = (b[x0] + b[x1] + b1[x0] + b1[x1] + 2) >> 2;
+                            row[1][x] = ConvertDepth(ToU(toYUV, ar, ag, ab), 8, outDepth);
+                            row[2][x] = ConvertDepth(ToV(toYUV, ar, ag, ab), 8, outDepth);
+                        }
+                        StoreRow(desc[1], ccx, ccy + y / 2, ccw, row[1].data(), alpha);
+                        StoreRow(desc[2], ccx, ccy + y / 2, ccw, row[2].data(), alpha);
+                    }
+                }
+
+                if (outRGB && desc[3].ptr) {
+                    std::fill(row[0].begin(), row[0].end(), (mfxU16)255);
+                    StoreRow(desc[3], rx, ry + y, rw, row[0].data(), 255);
+                }
+            }
+        },
+        CPU_VPP_ROW_GRAIN);
+}
+
+void CCpuVPP::FillBackground(mfxFrameSurface1* out) {
+    Picture bg;
+    mfxFrameInfo rect = out->Info;
+    rect.CropX = rect.CropY = 0;
+    rect.CropW              = out->Info.Width;
+    rect.CropH              = out->Info.Height;
+
+    bool outRGB = !IsYUV420(out->Info.FourCC);
+    bg.isRGB    = outRGB;
+    bg.bitDepth = GetBitDepth(out->Info);
+    mfxU32 cw   = outRGB ? rect.CropW : (rect.CropW + 1) / 2;
+    mfxU32 chgt = outRGB ? rect.CropH : (rect.CropH + 1) / 2;
+    bg.plane[0].Resize(rect.CropW, rect.CropH);
+    std::fill(bg.plane[0].data.begin(), bg.plane[0].data.end(), m_cfg.background[0]);
+    for (int p = 1; p < 3; p++) {
+        bg.plane[p].Resize(cw, chgt);
+        std::fill(bg.plane[p].data.begin(), bg.plane[p].data.end(), m_cfg.background[p]);
+    }
+
+    Pack(bg, out, rect, 255);
+}
+
+mfxStatus CCpuVPP::ProcessFrame(mfxFrameSurface1* in,
+                                mfxFrameSurface1* out,
+                                const mfxFrameInfo& dstRect,
+                                mfxU16 alpha) {
+    Unpack(in, m_src);
+
+    mfxU16 inPicStruct = in->Info.PicStruct ? in->Info.PicStruct : m_par.vpp.In.PicStruct;
+    bool interlaced    = (inPicStruct & (MFX_PICSTRUCT_FIELD_TFF | MFX_PICSTRUCT_FIELD_BFF)) != 0;
+    if (interlaced && !(m_par.vpp.Out.PicStruct & (MFX_PICSTRUCT_FIELD_TFF | MFX_PICSTRUCT_FIELD_BFF)))
+        Deinterlace(m_src, (inPicStruct & MFX_PICSTRUCT_FIELD_TFF) != 0);
+
+    if (m_cfg.denoiseStrength)
+        Denoise(m_src, m_cfg.denoiseStrength);
+
+    m_dst.isRGB    = m_src.isRGB;
+    m_dst.bitDepth = m_src.bitDepth;
+
+    mfxU32 w = dstRect.CropW, h = dstRect.CropH;
+    Scale(m_src.plane[0], m_dst.plane[0], w, h);
+    for (int p = 1; p < 3; p++) {
+        if (m_src.isRGB)
+            Scale(m_src.plane[p], m_dst.plane[p], w, h);
+        else
+            Scale(m_src.plane[p], m_dst.plane[p], (w + 1) / 2, (h + 1) / 2);
+    }
+
+    Pack(m_dst, out, dstRect, alpha);
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CCpuVPP::RunFrameVPPAsync(mfxFrameSurface1* in,
+                                    mfxFrameSurface1* out,
+                                    mfxExtVppAuxData* /*aux*/,
+                                    mfxSyncPoint* syncp) {
+    if (!m_bInitialized)
+        return MFX_ERR_NOT_INITIALIZED;
+    MSDK_CHECK_POINTER(out, MFX_ERR_NULL_PTR);
+    MSDK_CHECK_POINTER(syncp, MFX_ERR_NULL_PTR);
+
+    // nothing is buffered between calls apart from unfinished compositions
+    if (!in)
+        return MFX_ERR_MORE_DATA;
+
+    mfxStatus sts = MFX_ERR_NONE;
+
+    if (!m_cfg.composition.empty()) {
+        m_compInputs.push_back(in);
+        msdk_atomic_inc16((volatile mfxU16*)&in->Data.Locked);
+        if (m_compInputs.size() < m_cfg.composition.size())
+            return MFX_ERR_MORE_DATA;
+    }
+
+    // frame rate conversion by repeating or dropping input frames:
+    // output frame k shows input frame floor(k * rateIn / rateOut)
+    bool repeatNext = false;
+    mfxU64 outIndex = m_outFrames;
+    if (m_cfg.bFRC) {
+        const mfxFrameInfo& fi = m_par.vpp.In;
+        const mfxFrameInfo& fo = m_par.vpp.Out;
+        mfxU64 num             = (mfxU64)fo.FrameRateExtD * fi.FrameRateExtN;
+        mfxU64 den             = (mfxU64)fo.FrameRateExtN * fi.FrameRateExtD;
+
+        if (!m_inFrames)
+            m_firstTimeStamp = in->Data.TimeStamp;
+
+        if (m_outFrames * num / den > m_inFrames) {
+            m_inFrames++;
+            return MFX_ERR_MORE_DATA;
+        }
+        repeatNext = ((m_outFrames + 1) * num / den == m_inFrames);
+    }
+
+    bool inLocked = false, outLocked = false;
+    sts = LockSurface(out, &outLocked);
+    MSDK_CHECK_STATUS(sts, "LockSurface failed");
+
+    if (m_compInputs.empty()) {
+        sts = LockSurface(in, &inLocked);
+        if (sts == MFX_ERR_NONE) {
+            mfxFrameInfo rect = out->Info;
+            if (!rect.CropW || !rect.CropH) {
+                rect.CropX = rect.CropY = 0;
+                rect.CropW              = out->Info.Width;
+                rect.CropH              = out->Info.Height;
+            }
+            rect.CropW = std::min<mfxU16>(rect.CropW, out->Info.Width - rect.CropX);
+            rect.CropH = std::min<mfxU16>(rect.CropH, out->Info.Height - rect.CropY);
+            sts        = ProcessFrame(in, out, rect, 255);
+            UnlockSurface(in, inLocked);
+        }
+    }
+    else {
+        FillBackground(out);
+        for (size_t i = 0; i < m_compInputs.size() && sts == MFX_ERR_NONE; i++) {
+            const mfxVPPCompInputStream& stream = m_cfg.composition[i];
+            mfxFrameInfo rect                   = out->Info;
+            rect.CropX                          = stream.DstX;
+            rect.CropY                          = stream.DstY;
+            rect.CropW                          = stream.DstW;
+            rect.CropH                          = stream.DstH;
+            mfxU16 alpha = stream.GlobalAlphaEnable ? std::min<mfxU16>(stream.GlobalAlpha, 255) : 255;
+
+            sts = LockSurface(m_compInputs[i], &inLocked);
+            if (sts == MFX_ERR_NONE) {
+                sts = ProcessFrame(m_compInputs[i], out, rect, alpha);
+                UnlockSurface(m_compInputs[i], inLocked);
+            }
+        }
+        for (auto pSurf : m_compInputs)
+            msdk_atomic_dec16((volatile mfxU16*)&pSurf->Data.Locked);
+        m_compInputs.clear();
+    }
+    UnlockSurface(out, outLocked);
+    MSDK_CHECK_STATUS(sts, "ProcessFrame failed");
+
+    out->Info.PicStruct  = m_par.vpp.Out.PicStruct;
+    out->Data.FrameOrder = in->Data.FrameOrder;
+    out->Data.TimeStamp  = in->Data.TimeStamp;
+    if (m_cfg.bFRC) {
+        const mfxFrameInfo& fo = m_par.vpp.Out;
+        if (m_cfg.frcAlgorithm == MFX_FRCALGM_DISTRIBUTED_TIMESTAMP) {
+            out->Data.TimeStamp = m_firstTimeStamp + outIndex * fo.FrameRateExtD *
+                                                         CPU_VPP_TIME_STAMP_FREQUENCY /
+                                                         fo.FrameRateExtN;
+        }
+        else if (outIndex && (outIndex - 1) * fo.FrameRateExtD * m_par.vpp.In.FrameRateExtN /
+                                     ((mfxU64)fo.FrameRateExtN * m_par.vpp.In.FrameRateExtD) ==
+                                 m_inFrames) {
+            // inserted frames carry no time stamp
+            out->Data.TimeStamp = (mfxU64)MFX_TIMESTAMP_UNKNOWN;
+        }
+        m_outFrames++;
+        if (!repeatNext)
+            m_inFrames++;
+    }
+
+    m_numFramesOut++;
+    *syncp = (mfxSyncPoint)(size_t)(++m_lastTask);
+
+    // the same input has to be submitted again for the next output
+    return repeatNext ? MFX_ERR_MORE_SURFACE : MFX_ERR_NONE;
+}
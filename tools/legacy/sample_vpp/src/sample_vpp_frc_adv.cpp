@@ -41,6 +41,17 @@ bool FRCAdvancedChecker::IsTimeStampsNear(mfxU64 timeStampRef, mfxU64 timeStampT
 
 } // bool IsTimeStampsNear( mfxU64 timeStampTst, mfxU64 timeStampRef,  mfxU64 eps)
 
+bool FRCAdvancedChecker::CheckOutputTimeStamp(mfxU64 timeStampRef, mfxU64 timeStampTst) {
+    m_driftStat.AddDeviation((mfxF64)(mfxI64)(timeStampTst - timeStampRef) /
+                             MFX_TIME_STAMP_FREQUENCY);
+
+    bool res = IsTimeStampsNear(timeStampRef, timeStampTst, m_minDeltaTime);
+    if (!res)
+        m_driftStat.numMismatches++;
+
+    return res;
+}
+
 FRCAdvancedChecker::FRCAdvancedChecker()
         : m_minDeltaTime(0),
           m_bIsSetTimeOffset(false),
@@ -51,11 +62,16 @@ FRCAdvancedChecker::FRCAdvancedChecker()
           m_bReadyOutput(false),
           m_defferedInputTimeStamp(0),
           m_videoParam({ 0 }),
-          m_ptsList() {} // FRCAdvancedChecker::FRCAdvancedChecker()
+          m_ptsRing(),
+          m_driftStat() {} // FRCAdvancedChecker::FRCAdvancedChecker()
 
-mfxStatus FRCAdvancedChecker::Init(mfxVideoParam* par, mfxU32 /*asyncDeep*/) {
+mfxStatus FRCAdvancedChecker::Init(mfxVideoParam* par, mfxU32 asyncDeep) {
     m_videoParam = *par;
 
+    // inputs wait for output no longer than the async depth plus the FRC look-ahead
+    m_ptsRing.Init(std::max<mfxU32>(256, 4 * (asyncDeep + 1)));
+    m_driftStat = sPTSDriftStat();
+
     m_minDeltaTime = std::min(
         ((uint64_t)m_videoParam.vpp.In.FrameRateExtD * (uint64_t)MFX_TIME_STAMP_FREQUENCY) /
             (2 * (uint64_t)m_videoParam.vpp.In.FrameRateExtN),
@@ -67,8 +83,8 @@ mfxStatus FRCAdvancedChecker::Init(mfxVideoParam* par, mfxU32 /*asyncDeep*/) {
 } // mfxStatus FRCAdvancedChecker::Init(mfxVideoParam *par, mfxU32 asyncDeep)
 
 bool FRCAdvancedChecker::PutInputFrameAndCheck(mfxFrameSurface1* pSurface) {
-    if (pSurface) {
-        m_ptsList.push_back(pSurface->Data.TimeStamp);
+    if (pSurface && !m_ptsRing.Push(pSurface->Data.TimeStamp)) {
+        printf("Warning: FRC checker lost an input time stamp, output lags too much\n");
     }
 
     return true;
@@ -93,8 +109,9 @@ bool FRCAdvancedChecker::PutOutputFrameAndCheck(mfxFrameSurface1* pSurface) {
             m_expectedTimeStamp = GetExpectedPTS(m_numOutputFrames, m_timeOffset, m_timeStampJump);
 
             m_numOutputFrames++;
+            m_driftStat.numDuplicated++;
 
-            res = IsTimeStampsNear(m_expectedTimeStamp, timeStampTst, m_minDeltaTime);
+            res = CheckOutputTimeStamp(m_expectedTimeStamp, timeStampTst);
 
             return res;
         }
@@ -102,15 +119,17 @@ bool FRCAdvancedChecker::PutOutputFrameAndCheck(mfxFrameSurface1* pSurface) {
             //------------------------------------------------
             //           standard processing
             //------------------------------------------------
-            if (0 == m_ptsList.size()) {
+            mfxU64 inputTimeStamp = 0;
+            if (!m_ptsRing.Front(inputTimeStamp)) {
                 if (m_numOutputFrames > 0) // last frame processing
                 {
                     m_expectedTimeStamp =
                         GetExpectedPTS(m_numOutputFrames, m_timeOffset, m_timeStampJump);
 
                     m_numOutputFrames++;
+                    m_driftStat.numDuplicated++;
 
-                    res = IsTimeStampsNear(m_expectedTimeStamp, timeStampTst, m_minDeltaTime);
+                    res = CheckOutputTimeStamp(m_expectedTimeStamp, timeStampTst);
 
                     return res;
                 }
@@ -119,9 +138,6 @@ bool FRCAdvancedChecker::PutOutputFrameAndCheck(mfxFrameSurface1* pSurface) {
                 }
             }
 
-            mfxU64 inputTimeStamp = m_ptsList.front();
-            m_ptsList.pop_front();
-
             if (false == m_bIsSetTimeOffset) {
                 m_bIsSetTimeOffset = true;
                 m_timeOffset       = inputTimeStamp;
@@ -138,27 +154,36 @@ bool FRCAdvancedChecker::PutOutputFrameAndCheck(mfxFrameSurface1* pSurface) {
 
             if (inputTimeStamp < m_expectedTimeStamp) {
                 m_bReadyOutput = false;
+                m_ptsRing.Pop();
 
                 // skip frame
                 // request new one input surface
                 //return MFX_ERR_MORE_DATA;
+                m_driftStat.numDropped++;
                 bRepeatAnalysis = true;
             }
             else if (inputTimeStamp == m_expectedTimeStamp) // see above (minDelta)
             {
                 m_bReadyOutput = false;
+                m_ptsRing.Pop();
 
                 m_numOutputFrames++;
 
-                res = IsTimeStampsNear(m_expectedTimeStamp, timeStampTst, m_minDeltaTime);
+                res = CheckOutputTimeStamp(m_expectedTimeStamp, timeStampTst);
 
                 return res;
             }
             else // inputTimeStampParam > ptr->expectedTimeStamp
             {
+                // output slot comes before the input: previous frame is repeated and
+                // the input stays queued for the next slot. Unlike the former list based
+                // checker the input is not popped here, so a late input is matched with
+                // its own slot instead of being lost; the pass/fail result is the same
+                // as the output is compared with the slot time stamp in both cases
                 m_numOutputFrames++;
+                m_driftStat.numDuplicated++;
 
-                res = IsTimeStampsNear(m_expectedTimeStamp, timeStampTst, m_minDeltaTime);
+                res = CheckOutputTimeStamp(m_expectedTimeStamp, timeStampTst);
 
                 return res;
             }
@@ -318,7 +318,9 @@ void vppPrintHelp(const char* strAppName, const char* strErrorMessage) {
     printf("                      var_to_var - variable input ROI and variable output ROI\n");
     printf("               seed1 - seed for init of rand generator for src\n");
     printf("               seed2 - seed for init of rand generator for dst\n");
-    printf("                       range of seed [1, 65535]. 0 reserved for random init\n\n");
+    printf("                       range of seed [1, 65535]. 0 reserved for random init\n");
+    printf("   [-roi_dump_src file] - save ROI schedule of src as \"frame x y w h\" lines\n");
+    printf("   [-roi_dump_dst file] - save ROI schedule of dst as \"frame x y w h\" lines\n\n");
 
     printf("   [-tc_pattern (pattern)] - set telecine pattern\n");
     printf(
@@ -338,6 +340,18 @@ void vppPrintHelp(const char* strAppName, const char* strErrorMessage) {
         "   [-api_ver_init::<1x,2x>]  - select the api version for the session initialization\n");
     printf("   [-rbf] - read frame-by-frame from the input (sw lib only)\n\n");
 
+    printf(
+        "   [-cpu_ref]           - process frames with the CPU reference VPP instead of the library (sys_to_sys only)\n");
+    printf(
+        "   [-cpu_ref_threads n] - number of CPU reference VPP threads. def: number of hardware threads\n\n");
+
+    printf(
+        "   [-verify_ref file]    - compare output with a raw reference of the same layout, print PSNR and SSIM\n");
+    printf("   [-verify_digest file] - compare per-plane CRC32 of output with a digest stream\n");
+    printf("   [-dump_digest file]   - write per-plane CRC32 of output to a digest stream\n");
+    printf(
+        "   [-verify_threads n]   - number of output verification threads. def: number of hardware threads\n\n");
+
     printf("   [-3dlut] path to 3dlut table file\n");
     printf("   [-3dlutMemType] specify 3dlut memory type, 0: video, 1: sys. Default value is 0\n");
     printf("   [-3dlutMode] specify 3dlut mode for HDR 3Dlut, allowwed values:17|33|65\n");
@@ -1567,6 +1581,16 @@ mfxStatus vppParseInputString(char* strInput[],
                 i++;
                 msdk_opt_read(strInput[i], pParams->roiCheckParam.dstSeed);
             }
+            else if (msdk_match(strInput[i], "-roi_dump_src")) {
+                VAL_CHECK(1 + i == nArgNum);
+                i++;
+                pParams->roiCheckParam.srcScheduleFile = strInput[i];
+            }
+            else if (msdk_match(strInput[i], "-roi_dump_dst")) {
+                VAL_CHECK(1 + i == nArgNum);
+                i++;
+                pParams->roiCheckParam.dstScheduleFile = strInput[i];
+            }
             //-----------------------------------------------------------------------------------
             else if (msdk_match(strInput[i], "-i")) {
                 VAL_CHECK(1 + i == nArgNum);
@@ -1894,6 +1918,35 @@ mfxStatus vppParseInputString(char* strInput[],
             else if (msdk_match(strInput[i], "-rbf")) {
                 pParams->bReadByFrame = true;
             }
+            else if (msdk_match(strInput[i], "-cpu_ref")) {
+                pParams->bCpuRef = true;
+            }
+            else if (msdk_match(strInput[i], "-cpu_ref_threads")) {
+                VAL_CHECK(1 + i == nArgNum);
+                i++;
+                msdk_opt_read(strInput[i], pParams->cpuRefThreads);
+                pParams->bCpuRef = true;
+            }
+            else if (msdk_match(strInput[i], "-verify_ref")) {
+                VAL_CHECK(1 + i == nArgNum);
+                i++;
+                pParams->qualityParams.strRefFile = strInput[i];
+            }
+            else if (msdk_match(strInput[i], "-verify_digest")) {
+                VAL_CHECK(1 + i == nArgNum);
+                i++;
+                pParams->qualityParams.strDigestIn = strInput[i];
+            }
+            else if (msdk_match(strInput[i], "-dump_digest")) {
+                VAL_CHECK(1 + i == nArgNum);
+                i++;
+                pParams->qualityParams.strDigestOut = strInput[i];
+            }
+            else if (msdk_match(strInput[i], "-verify_threads")) {
+                VAL_CHECK(1 + i == nArgNum);
+                i++;
+                msdk_opt_read(strInput[i], pParams->qualityParams.numThreads);
+            }
 #ifdef ONEVPL_EXPERIMENTAL
             else if (msdk_match(strInput[i], "-cfg::vpp")) {
                 VAL_CHECK(1 + i == nArgNum);
@@ -1965,6 +2018,11 @@ mfxStatus vppParseInputString(char* strInput[],
         return MFX_ERR_UNSUPPORTED;
     }
 
+    // CPU reference VPP replaces the library and works with system memory only
+    if (pParams->bCpuRef) {
+        pParams->ImpLib = MFX_IMPL_SOFTWARE;
+    }
+
     if ((pParams->ImpLib & MFX_IMPL_SOFTWARE) &&
         (pParams->IOPattern & (MFX_IOPATTERN_IN_VIDEO_MEMORY | MFX_IOPATTERN_OUT_VIDEO_MEMORY))) {
         printf(
@@ -2043,6 +2101,11 @@ bool CheckInputParams(char* strInput[], sInputParams* pParams) {
         return false;
     }
 
+    if (pParams->bCpuRef && pParams->bReadByFrame) {
+        vppPrintHelp(strInput[0], "-rbf (Read by frame) is not supported with -cpu_ref.\n");
+        return false;
+    }
+
     return true;
 } // bool CheckInputParams(char* strInput[], sInputVppParams* pParams )
 
@@ -6,6 +6,7 @@
 
 #include "sample_vpp_pts.h"
 #include <math.h>
+#include <algorithm>
 #include "vm/strings_defs.h"
 #include "vm/time_defs.h"
 
@@ -31,7 +32,10 @@ PTSMaker::PTSMaker()
           m_NumFrame_Out(0),
           m_IsJump(false),
           m_bIsAdvancedMode(false),
-          m_ptsList() {}
+          m_ptsRing(),
+          m_driftStat(),
+          m_firstOutTimeStamp(0),
+          m_lastInIndex(0) {}
 
 mfxStatus PTSMaker::Init(mfxVideoParam* par,
                          mfxU32 asyncDeep,
@@ -46,6 +50,10 @@ mfxStatus PTSMaker::Init(mfxVideoParam* par,
     m_FRateExtN_Out = par->vpp.Out.FrameRateExtN;
     m_FRateExtD_Out = par->vpp.Out.FrameRateExtD;
 
+    // output lags behind input by no more than the async depth plus the FRC look-ahead
+    m_ptsRing.Init(std::max<mfxU32>(256, 4 * (asyncDeep + 1)));
+    m_driftStat = sPTSDriftStat();
+
     if (isFrameCorrespond) {
         m_pFRCChecker.reset(new FRCChecker);
         m_pFRCChecker.get()->Init(par, asyncDeep);
@@ -92,7 +100,7 @@ bool PTSMaker::SetPTS(mfxFrameSurface1* pSurface) {
 
     pSurface->Data.TimeStamp = (mfxU64)(ts * MFX_TIME_STAMP_FREQUENCY + .5);
     m_NumFrame_In++;
-    m_ptsList.push_back(pSurface->Data.TimeStamp);
+    m_ptsRing.Push(pSurface->Data.TimeStamp);
 
     if (m_pFRCChecker.get()) {
         return m_pFRCChecker.get()->PutInputFrameAndCheck(pSurface);
@@ -106,29 +114,84 @@ bool PTSMaker::CheckPTS(mfxFrameSurface1* pSurface) {
 }
 
 bool PTSMaker::CheckBasicPTS(mfxFrameSurface1* pSurface) {
-    std::list<mfxU64>::iterator it;
     // -1 valid value
     if (-1 == static_cast<int>(pSurface->Data.TimeStamp))
         return true;
 
     mfxU64 ts = pSurface->Data.TimeStamp;
-    if (0 == m_ptsList.size()) {
+    if (m_ptsRing.IsEmpty()) {
         m_CurrDiff = -1;
         PrintDumpInfo();
         return false;
     }
-    for (it = m_ptsList.begin(); it != m_ptsList.end(); it++) {
-        if (ts == *it) {
-            if (m_pFRCChecker.get())
-                m_pFRCChecker.get()->PutOutputFrameAndCheck(pSurface);
 
+    mfxU64 index = 0;
+    if (FindInputFrame(ts, index)) {
+        UpdateDriftStat(ts, index);
+        if (m_pFRCChecker.get())
+            m_pFRCChecker.get()->PutOutputFrameAndCheck(pSurface);
+
+        return true;
+    }
+
+    mfxU64 front = 0;
+    m_ptsRing.Front(front);
+    m_CurrDiff = (mfxF64)(mfxI64)(ts - front) / MFX_TIME_STAMP_FREQUENCY;
+    m_driftStat.numMismatches++;
+    PrintDumpInfo();
+    return false;
+}
+
+bool PTSMaker::FindInputFrame(mfxU64 ts, mfxU64& index) const {
+    mfxU64 stored = 0;
+
+    if (m_FRateExtN_In) {
+        // inverse of the SetPTS formula, neighbours absorb the rounding of the time stamp
+        mfxF64 pos = ((mfxF64)ts / MFX_TIME_STAMP_FREQUENCY - m_TimeOffset - m_CurrTime) *
+                     m_FRateExtN_In / m_FRateExtD_In;
+        if (pos > -1) {
+            mfxU64 candidate = (mfxU64)(pos + .5);
+            for (mfxU64 i = (candidate ? candidate - 1 : 0); i <= candidate + 1; i++) {
+                if (m_ptsRing.Find(i, stored) && stored == ts) {
+                    index = i;
+                    return true;
+                }
+            }
+        }
+    }
+
+    // time stamps which do not follow the input grid, look through the ring
+    for (mfxU64 i = m_ptsRing.GetHead(); i < m_ptsRing.GetTail(); i++) {
+        if (m_ptsRing.Find(i, stored) && stored == ts) {
+            index = i;
             return true;
         }
     }
-    m_CurrDiff = (mfxF64)(ts - m_ptsList.front()) / MFX_TIME_STAMP_FREQUENCY;
-    PrintDumpInfo();
     return false;
 }
+
+void PTSMaker::UpdateDriftStat(mfxU64 ts, mfxU64 index) {
+    if (0 == m_driftStat.numFrames) {
+        m_firstOutTimeStamp = ts;
+    }
+    else if (index == m_lastInIndex) {
+        m_driftStat.numDuplicated++;
+    }
+    else if (index > m_lastInIndex + 1) {
+        m_driftStat.numDropped += (mfxU32)(index - m_lastInIndex - 1);
+    }
+    m_lastInIndex = index;
+
+    // distance to the nearest slot of the output grid, frames without time stamp
+    // are not checked so the slot can not be taken from the frame counter
+    mfxF64 deviation = (mfxF64)(mfxI64)(ts - m_firstOutTimeStamp) / MFX_TIME_STAMP_FREQUENCY;
+    if (m_FRateExtN_Out) {
+        mfxF64 period = (mfxF64)m_FRateExtD_Out / m_FRateExtN_Out;
+        deviation -= floor(deviation / period + .5) * period;
+    }
+    m_driftStat.AddDeviation(deviation);
+}
+
 bool PTSMaker::CheckAdvancedPTS(mfxFrameSurface1* pSurface) {
     mfxF64 ts = (mfxF64)pSurface->Data.TimeStamp / MFX_TIME_STAMP_FREQUENCY;
     mfxF64 ref =
@@ -174,6 +237,15 @@ void PTSMaker::JumpPTS() {
         m_IsJump = true;
 }
 
+const sPTSDriftStat& PTSMaker::GetDriftStat() const {
+    const sPTSDriftStat* pStat = m_pFRCChecker.get() ? m_pFRCChecker->GetDriftStat() : NULL;
+    return pStat ? *pStat : m_driftStat;
+}
+
+void PTSMaker::PrintDriftStat() const {
+    GetDriftStat().Print(m_bIsAdvancedMode ? "PTS drift (advanced FRC)" : "PTS drift");
+}
+
 void PTSMaker::PrintDumpInfo() {
     printf("Error in PTS setting \n");
     printf("Input frame number is %d\n", m_NumFrame_In);
@@ -22,20 +22,16 @@
     #error MFX_VERSION not defined
 #endif
 
-int ownRandomGenerator_32s(int lowest, int highest) {
-    int random_integer;
-    int range = (highest - lowest) + 1;
-
-    random_integer = lowest + int(range * rand() / (RAND_MAX + 1.0));
-
-    return random_integer;
-}
+// ROIs generated at once when the length of the sequence is unknown
+static const mfxU32 ROI_SCHEDULE_BATCH = 256;
 
 /* *************************************************************************** */
 
-ROIGenerator::ROIGenerator(void) {
+ROIGenerator::ROIGenerator(void) : m_schedule() {
     m_width = m_height = 0;
     m_seed             = 0;
+    m_state            = 0;
+    m_numUsed          = 0;
 } // ROIGenerator::ROIGenerator( void )
 
 ROIGenerator::~ROIGenerator(void) {
@@ -43,7 +39,7 @@ ROIGenerator::~ROIGenerator(void) {
 
 } // ROIGenerator::~ROIGenerator( void )
 
-mfxStatus ROIGenerator::Init(mfxU16 width, mfxU16 height, int seed) {
+mfxStatus ROIGenerator::Init(mfxU16 width, mfxU16 height, int seed, mfxU32 numFrames) {
     m_width  = width;
     m_height = height;
 
@@ -53,7 +49,14 @@ mfxStatus ROIGenerator::Init(mfxU16 width, mfxU16 height, int seed) {
         m_seed = (int)time(NULL);
     }
 
-    srand(m_seed);
+    // xorshift state must not be zero
+    m_state = ((mfxU32)m_seed * 2654435761u) ^ 0x9E3779B9;
+    if (0 == m_state)
+        m_state = 1;
+
+    m_schedule.clear();
+    m_numUsed = 0;
+    Generate(numFrames ? numFrames : ROI_SCHEDULE_BATCH);
 
     //printf("\nroi seed = %i \n", m_seed);
 
@@ -63,46 +66,65 @@ mfxStatus ROIGenerator::Init(mfxU16 width, mfxU16 height, int seed) {
 
 mfxStatus ROIGenerator::Close(void) {
     m_width = m_height = 0;
+    m_schedule.clear();
+    m_numUsed = 0;
 
     return MFX_ERR_NONE;
 
 } // mfxStatus ROIGenerator::Close( void )
 
-mfxStatus ROIGenerator::SetROI(mfxFrameInfo* pInfo) {
-    int lowest, highest;
-    int result;
+int ROIGenerator::GetRandom(int lowest, int highest) {
+    int range = (highest - lowest) + 1;
+    if (range <= 0)
+        return lowest;
 
-    // roi_width
-    lowest  = 16;
-    highest = (int)(m_width - 16);
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 17;
+    m_state ^= m_state << 5;
 
-    result       = ownRandomGenerator_32s(lowest, highest);
-    result       = (((result + 15) >> 4) << 4);
-    pInfo->CropW = (mfxU16)result;
+    return lowest + (int)(((mfxU64)m_state * (mfxU32)range) >> 32);
+}
 
-    // roi_height
-    lowest  = 32;
-    highest = (int)(m_height - 32);
+void ROIGenerator::Generate(mfxU32 numFrames) {
+    m_schedule.reserve(m_schedule.size() + numFrames);
 
-    result       = (mfxU16)ownRandomGenerator_32s(lowest, highest);
-    result       = (((result + 31) >> 5) << 5);
-    pInfo->CropH = (mfxU16)result;
+    for (mfxU32 i = 0; i < numFrames; i++) {
+        sROIRect roi;
+        int result;
 
-    // roi_x
-    lowest  = 0;
-    highest = (int)(m_width - pInfo->CropW);
+        // roi_width
+        result = GetRandom(16, (int)(m_width - 16));
+        roi.w  = (mfxU16)(((result + 15) >> 4) << 4);
 
-    result       = ownRandomGenerator_32s(lowest, highest);
-    result       = (((result + 1) >> 1) << 1);
-    pInfo->CropX = (mfxU16)result;
+        // roi_height
+        result = GetRandom(32, (int)(m_height - 32));
+        roi.h  = (mfxU16)(((result + 31) >> 5) << 5);
 
-    // roi_y
-    lowest  = 0;
-    highest = (int)(m_height - pInfo->CropH);
+        // roi_x
+        result = GetRandom(0, (int)(m_width - roi.w));
+        roi.x  = (mfxU16)(((result + 1) >> 1) << 1);
 
-    result       = ownRandomGenerator_32s(lowest, highest);
-    result       = (((result + 1) >> 1) << 1);
-    pInfo->CropY = (mfxU16)result;
+        // roi_y
+        result = GetRandom(0, (int)(m_height - roi.h));
+        roi.y  = (mfxU16)(((result + 1) >> 1) << 1);
+
+        m_schedule.push_back(roi);
+    }
+} // void ROIGenerator::Generate(mfxU32 numFrames)
+
+mfxStatus ROIGenerator::SetROI(mfxFrameInfo* pInfo) {
+    MSDK_CHECK_POINTER(pInfo, MFX_ERR_NULL_PTR);
+
+    if (m_numUsed == m_schedule.size()) {
+        Generate(ROI_SCHEDULE_BATCH);
+    }
+
+    const sROIRect& roi = m_schedule[m_numUsed++];
+
+    pInfo->CropX = roi.x;
+    pInfo->CropY = roi.y;
+    pInfo->CropW = roi.w;
+    pInfo->CropH = roi.h;
 
     //printf("\nroi (x, y, w, h) = (%i, %i, %i, %i)\n", pInfo->CropX, pInfo->CropY, pInfo->CropW, pInfo->CropH);
 
@@ -114,4 +136,33 @@ mfxI32 ROIGenerator::GetSeed(void) {
     return m_seed;
 }
 
-/* EOF */
\ No newline at end of file
+mfxStatus ROIGenerator::SaveSchedule(const char* fileName, mfxU32 numFrames) const {
+    MSDK_CHECK_POINTER(fileName, MFX_ERR_NULL_PTR);
+
+    if (0 == numFrames)
+        numFrames = m_numUsed;
+    MSDK_CHECK_ERROR(numFrames > m_schedule.size(), true, MFX_ERR_NOT_ENOUGH_BUFFER);
+
+    FILE* f = NULL;
+    MSDK_FOPEN(f, fileName, "w");
+    MSDK_CHECK_POINTER(f, MFX_ERR_NULL_PTR);
+
+    fprintf(f, "# ROI schedule: width %u height %u seed %d frames %u\n",
+            m_width,
+            m_height,
+            m_seed,
+            numFrames);
+    fprintf(f, "# frame x y w h\n");
+    for (mfxU32 i = 0; i < numFrames; i++) {
+        const sROIRect& roi = m_schedule[i];
+        fprintf(f, "%u %u %u %u %u\n", i, roi.x, roi.y, roi.w, roi.h);
+    }
+
+    int err = ferror(f);
+    fclose(f);
+
+    return err ? MFX_ERR_UNKNOWN : MFX_ERR_NONE;
+
+} // mfxStatus ROIGenerator::SaveSchedule(const char* fileName, mfxU32 numFrames) const
+
+/* EOF */
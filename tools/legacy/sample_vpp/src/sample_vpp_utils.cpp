@@ -247,6 +247,13 @@ void PrintStreamInfo(sInputParams* pParams,
     printf("\n");
 
     //-------------------------------------------------------
+    if (pParams->bCpuRef) {
+        printf("MediaSDK impl\tcpu reference (%u threads)\n",
+               (unsigned int)(pParams->cpuRefThreads ? pParams->cpuRefThreads
+                                                     : std::thread::hardware_concurrency()));
+        return;
+    }
+
     mfxIMPL impl;
     pMfxSession->QueryIMPL(&impl);
     bool isHWlib = MFX_IMPL_SOFTWARE != impl;
@@ -510,6 +517,13 @@ mfxStatus CreateFrameProcessor(sFrameProcessor* pProcessor,
 
     WipeFrameProcessor(pProcessor);
 
+    // CPU reference VPP does not need a session
+    if (pInParams->bCpuRef) {
+        pProcessor->pCpuVPP = new CCpuVPP(pInParams->cpuRefThreads);
+        pProcessor->pmfxVPP = pProcessor->pCpuVPP;
+        return MFX_ERR_NONE;
+    }
+
     //MFX session
     if (pInParams->verSessionInit == API_1X) {
 #if (defined(_WIN64) || defined(_WIN32)) && (MFX_VERSION >= 1031)
@@ -638,7 +652,11 @@ mfxStatus InitMemoryAllocator(sFrameProcessor* pProcessor,
 
     bool isHWLib = (MFX_IMPL_HARDWARE & pInParams->ImpLib) ? true : false;
 
-    if (isHWLib) {
+    if (pProcessor->pCpuVPP) {
+        // system memory only, surfaces are locked by the CPU VPP itself
+        pProcessor->pCpuVPP->SetFrameAllocator(pAllocator->pMfxAllocator);
+    }
+    else if (isHWLib) {
         if ((pInParams->ImpLib & IMPL_VIA_MASK) == MFX_IMPL_VIA_D3D9) {
 #ifdef D3D_SURFACES_SUPPORT
             // prepare device manager
@@ -773,10 +791,12 @@ mfxStatus InitMemoryAllocator(sFrameProcessor* pProcessor,
 #endif
     }
     /* This sample uses external memory allocator model for both system and HW memory */
-    sts = pProcessor->mfxSession.SetFrameAllocator(pAllocator->pMfxAllocator);
-    MSDK_CHECK_STATUS_SAFE(sts,
-                           "pProcessor->mfxSession.SetFrameAllocator failed",
-                           WipeMemoryAllocator(pAllocator));
+    if (!pProcessor->pCpuVPP) {
+        sts = pProcessor->mfxSession.SetFrameAllocator(pAllocator->pMfxAllocator);
+        MSDK_CHECK_STATUS_SAFE(sts,
+                               "pProcessor->mfxSession.SetFrameAllocator failed",
+                               WipeMemoryAllocator(pAllocator));
+    }
     pAllocator->bUsedAsExternalAllocator = true;
 
     sts = pAllocator->pMfxAllocator->Init(pAllocator->pAllocatorParams);
@@ -872,6 +892,7 @@ void WipeFrameProcessor(sFrameProcessor* pProcessor) {
     MSDK_CHECK_POINTER_NO_RET(pProcessor);
 
     MSDK_SAFE_DELETE(pProcessor->pmfxVPP);
+    pProcessor->pCpuVPP = nullptr;
 
     pProcessor->mfxSession.Close();
 }
@@ -1600,6 +1621,7 @@ CRawVideoWriter::CRawVideoWriter() {
     m_fDst               = 0;
     m_pPTSMaker          = 0;
     m_forcedOutputFourcc = 0;
+    m_pQualityChecker    = 0;
     return;
 }
 
@@ -1641,26 +1663,31 @@ mfxStatus CRawVideoWriter::PutNextFrame(sMemoryAllocator* pAllocator,
                                         mfxFrameInfo* pInfo,
                                         mfxFrameSurfaceWrap* pSurface) {
     mfxStatus sts;
-    if (m_fDst) {
+    if (m_fDst || m_pQualityChecker) {
         if (pSurface->Data.MemId) {
             // get YUV pointers
             sts = pAllocator->pMfxAllocator->Lock(pAllocator->pMfxAllocator->pthis,
                                                   pSurface->Data.MemId,
                                                   &(pSurface->Data));
             MSDK_CHECK_NOT_EQUAL(sts, MFX_ERR_NONE, MFX_ERR_ABORTED);
+        }
 
+        if (m_fDst) {
             sts = WriteFrame(&(pSurface->Data), pInfo);
             MSDK_CHECK_NOT_EQUAL(sts, MFX_ERR_NONE, MFX_ERR_ABORTED);
+        }
+
+        if (m_pQualityChecker) {
+            sts = CheckFrame(&(pSurface->Data), pInfo);
+            MSDK_CHECK_NOT_EQUAL(sts, MFX_ERR_NONE, MFX_ERR_ABORTED);
+        }
 
+        if (pSurface->Data.MemId) {
             sts = pAllocator->pMfxAllocator->Unlock(pAllocator->pMfxAllocator->pthis,
                                                     pSurface->Data.MemId,
                                                     &(pSurface->Data));
             MSDK_CHECK_NOT_EQUAL(sts, MFX_ERR_NONE, MFX_ERR_ABORTED);
         }
-        else {
-            sts = WriteFrame(&(pSurface->Data), pInfo);
-            MSDK_CHECK_NOT_EQUAL(sts, MFX_ERR_NONE, MFX_ERR_ABORTED);
-        }
     }
     else // performance mode
     {
@@ -1683,12 +1710,19 @@ mfxStatus CRawVideoWriter::PutNextFrame(sMemoryAllocator* pAllocator,
 
 mfxStatus CRawVideoWriter::PutNextFrame(mfxFrameInfo* pInfo, mfxFrameSurfaceWrap* pSurface) {
     mfxStatus sts;
-    if (m_fDst) {
+    if (m_fDst || m_pQualityChecker) {
         sts = pSurface->FrameInterface->Map(pSurface, MFX_MAP_READ);
         MSDK_CHECK_NOT_EQUAL(sts, MFX_ERR_NONE, MFX_ERR_ABORTED);
 
-        sts = WriteFrame(&(pSurface->Data), pInfo);
-        MSDK_CHECK_NOT_EQUAL(sts, MFX_ERR_NONE, MFX_ERR_ABORTED);
+        if (m_fDst) {
+            sts = WriteFrame(&(pSurface->Data), pInfo);
+            MSDK_CHECK_NOT_EQUAL(sts, MFX_ERR_NONE, MFX_ERR_ABORTED);
+        }
+
+        if (m_pQualityChecker) {
+            sts = CheckFrame(&(pSurface->Data), pInfo);
+            MSDK_CHECK_NOT_EQUAL(sts, MFX_ERR_NONE, MFX_ERR_ABORTED);
+        }
 
         sts = pSurface->FrameInterface->Unmap(pSurface);
         MSDK_CHECK_NOT_EQUAL(sts, MFX_ERR_NONE, MFX_ERR_ABORTED);
@@ -1700,6 +1734,21 @@ mfxStatus CRawVideoWriter::PutNextFrame(mfxFrameInfo* pInfo, mfxFrameSurfaceWrap
     return sts;
 }
 
+mfxStatus CRawVideoWriter::CheckFrame(mfxFrameData* pData, mfxFrameInfo* pInfo) {
+    MSDK_CHECK_POINTER(pData, MFX_ERR_NOT_INITIALIZED);
+    MSDK_CHECK_POINTER(pInfo, MFX_ERR_NOT_INITIALIZED);
+
+    // WriteFrame stores 16-bit samples as they are in memory, MSB aligned ones included
+    mfxFrameInfo info = *pInfo;
+    if (info.Shift) {
+        info.Shift          = 0;
+        info.BitDepthLuma   = 16;
+        info.BitDepthChroma = 16;
+    }
+
+    return m_pQualityChecker->CheckFrame(info, *pData);
+}
+
 mfxStatus CRawVideoWriter::WriteFrame(mfxFrameData* pData, mfxFrameInfo* pInfo) {
     mfxI32 nBytesRead = 0;
 
@@ -2231,6 +2280,13 @@ mfxStatus GeneralWriter::PutNextFrame(sMemoryAllocator* pAllocator,
     return sts;
 };
 
+void GeneralWriter::SetQualityChecker(CQualityChecker* pChecker) {
+    for (mfxU32 did = 0; did < 8; did++) {
+        if (m_ofile[did].get())
+            m_ofile[did]->SetQualityChecker(pChecker);
+    }
+}
+
 mfxStatus GeneralWriter::PutNextFrame(mfxFrameInfo* pInfo, mfxFrameSurfaceWrap* pSurface) {
     mfxU32 did = (m_svcMode) ? pSurface->Info.FrameId.DependencyId
                              : 0; //aya: for MVC we have 1 out file only
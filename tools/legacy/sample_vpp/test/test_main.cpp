@@ -6,6 +6,7 @@
 
 #include <regex>
 #include "gtest/gtest.h"
+#include "sample_vpp_pts.h"
 #include "sample_vpp_utils.h"
 
 int main(int argc, char** argv) {
@@ -273,3 +274,490 @@ TEST(VPP_CLI, Escape1) {
                "-n",      "100" });
     EXPECT_EQ(result.status, MFX_ERR_NONE);
 }
+
+TEST(VPP_CLI, OptionCpuRef) {
+    auto result = init({ "-i",
+                         "in.nv12",
+                         "-sw",
+                         "176",
+                         "-sh",
+                         "144",
+                         "-iopattern",
+                         "d3d_to_d3d",
+                         "-cpu_ref_threads",
+                         "3" });
+    EXPECT_EQ(result.status, MFX_ERR_NONE);
+    EXPECT_TRUE(result.pParams.bCpuRef);
+    EXPECT_EQ(result.pParams.cpuRefThreads, 3u);
+    EXPECT_EQ(result.pParams.ImpLib, MFX_IMPL_SOFTWARE);
+    EXPECT_EQ(result.pParams.IOPattern,
+              MFX_IOPATTERN_IN_SYSTEM_MEMORY | MFX_IOPATTERN_OUT_SYSTEM_MEMORY);
+}
+
+TEST(VPP_CLI, OptionVerify) {
+    auto result = init({ "-i",
+                         "in.nv12",
+                         "-sw",
+                         "176",
+                         "-sh",
+                         "144",
+                         "-verify_ref",
+                         "ref.nv12",
+                         "-dump_digest",
+                         "out.crc",
+                         "-verify_threads",
+                         "2" });
+    EXPECT_EQ(result.status, MFX_ERR_NONE);
+    EXPECT_EQ(result.pParams.qualityParams.strRefFile, "ref.nv12");
+    EXPECT_EQ(result.pParams.qualityParams.strDigestOut, "out.crc");
+    EXPECT_TRUE(result.pParams.qualityParams.strDigestIn.empty());
+    EXPECT_EQ(result.pParams.qualityParams.numThreads, 2u);
+    EXPECT_TRUE(result.pParams.qualityParams.IsEnabled());
+}
+
+TEST(VPP_CLI, OptionRoiDump) {
+    auto result = init({ "-i",
+                         "in.nv12",
+                         "-sw",
+                         "176",
+                         "-sh",
+                         "144",
+                         "-roi_check",
+                         "var_to_var",
+                         "7",
+                         "9",
+                         "-roi_dump_src",
+                         "src.roi",
+                         "-roi_dump_dst",
+                         "dst.roi" });
+    EXPECT_EQ(result.status, MFX_ERR_NONE);
+    EXPECT_EQ(result.pParams.roiCheckParam.mode, ROI_VAR_TO_VAR);
+    EXPECT_EQ(result.pParams.roiCheckParam.srcSeed, 7);
+    EXPECT_EQ(result.pParams.roiCheckParam.dstSeed, 9);
+    EXPECT_EQ(result.pParams.roiCheckParam.srcScheduleFile, "src.roi");
+    EXPECT_EQ(result.pParams.roiCheckParam.dstScheduleFile, "dst.roi");
+}
+
+// system memory surface with mapped pointers, no allocator needed
+struct TestSurface {
+    std::vector<mfxU8> buf;
+    mfxFrameSurface1 surf;
+
+    TestSurface(mfxU32 fourcc, mfxU16 w, mfxU16 h) : buf(), surf() {
+        surf.Info.FourCC        = fourcc;
+        surf.Info.ChromaFormat  = (fourcc == MFX_FOURCC_RGB4) ? MFX_CHROMAFORMAT_YUV444
+                                                              : MFX_CHROMAFORMAT_YUV420;
+        surf.Info.Width         = w;
+        surf.Info.Height        = h;
+        surf.Info.CropW         = w;
+        surf.Info.CropH         = h;
+        surf.Info.PicStruct     = MFX_PICSTRUCT_PROGRESSIVE;
+        surf.Info.FrameRateExtN = 30;
+        surf.Info.FrameRateExtD = 1;
+
+        mfxU32 pitch = (fourcc == MFX_FOURCC_RGB4) ? w * 4 : w;
+        buf.resize((fourcc == MFX_FOURCC_RGB4) ? pitch * h : pitch * h * 3 / 2);
+        surf.Data.PitchLow = (mfxU16)pitch;
+        if (fourcc == MFX_FOURCC_RGB4) {
+            surf.Data.B = buf.data();
+            surf.Data.G = surf.Data.B + 1;
+            surf.Data.R = surf.Data.B + 2;
+            surf.Data.A = surf.Data.B + 3;
+        }
+        else {
+            surf.Data.Y = buf.data();
+            surf.Data.U = surf.Data.Y + pitch * h;
+            surf.Data.V = surf.Data.U + 1;
+        }
+    }
+};
+
+static mfxVideoParam CpuVppParams(const mfxFrameInfo& in, const mfxFrameInfo& out) {
+    mfxVideoParam par = {};
+    par.vpp.In        = in;
+    par.vpp.Out       = out;
+    par.IOPattern     = MFX_IOPATTERN_IN_SYSTEM_MEMORY | MFX_IOPATTERN_OUT_SYSTEM_MEMORY;
+    par.AsyncDepth    = 1;
+    return par;
+}
+
+static mfxStatus RunCpuVpp(mfxU32 numThreads, TestSurface& in, TestSurface& out) {
+    CCpuVPP vpp(numThreads);
+    mfxVideoParam par = CpuVppParams(in.surf.Info, out.surf.Info);
+    mfxStatus sts     = vpp.Init(&par);
+    if (sts != MFX_ERR_NONE)
+        return sts;
+
+    mfxSyncPoint syncp = nullptr;
+    sts                = vpp.RunFrameVPPAsync(&in.surf, &out.surf, nullptr, &syncp);
+    if (sts != MFX_ERR_NONE)
+        return sts;
+    return vpp.SyncOperation(syncp, MSDK_VPP_WAIT_INTERVAL);
+}
+
+TEST(VPP_CPU_REF, QueryRejectsVideoMemory) {
+    TestSurface in(MFX_FOURCC_NV12, 64, 32);
+    CCpuVPP vpp(1);
+    mfxVideoParam par = CpuVppParams(in.surf.Info, in.surf.Info);
+    par.IOPattern     = MFX_IOPATTERN_IN_VIDEO_MEMORY | MFX_IOPATTERN_OUT_SYSTEM_MEMORY;
+    mfxVideoParam out = {};
+    EXPECT_EQ(vpp.Query(&par, &out), MFX_ERR_UNSUPPORTED);
+}
+
+TEST(VPP_CPU_REF, NV12PassThroughIsExact) {
+    TestSurface in(MFX_FOURCC_NV12, 64, 32), out(MFX_FOURCC_NV12, 64, 32);
+    for (size_t i = 0; i < in.buf.size(); i++)
+        in.buf[i] = (mfxU8)(i * 7 + (i >> 6));
+
+    EXPECT_EQ(RunCpuVpp(2, in, out), MFX_ERR_NONE);
+    EXPECT_EQ(in.buf, out.buf);
+}
+
+TEST(VPP_CPU_REF, DownscaleKeepsFlatColor) {
+    TestSurface in(MFX_FOURCC_NV12, 128, 64), out(MFX_FOURCC_NV12, 48, 24);
+    std::fill(in.buf.begin(), in.buf.begin() + 128 * 64, (mfxU8)90);
+    std::fill(in.buf.begin() + 128 * 64, in.buf.end(), (mfxU8)200);
+
+    EXPECT_EQ(RunCpuVpp(4, in, out), MFX_ERR_NONE);
+    for (size_t i = 0; i < out.buf.size(); i++)
+        ASSERT_EQ(out.buf[i], (i < 48 * 24) ? 90 : 200) << "offset " << i;
+}
+
+TEST(VPP_CPU_REF, NV12ToRGB4Gray) {
+    TestSurface in(MFX_FOURCC_NV12, 16, 16), out(MFX_FOURCC_RGB4, 16, 16);
+    std::fill(in.buf.begin(), in.buf.begin() + 16 * 16, (mfxU8)126);
+    std::fill(in.buf.begin() + 16 * 16, in.buf.end(), (mfxU8)128);
+
+    EXPECT_EQ(RunCpuVpp(1, in, out), MFX_ERR_NONE);
+    // (298 * (126 - 16) + 128) >> 8 = 128
+    for (size_t i = 0; i < out.buf.size(); i += 4) {
+        ASSERT_EQ(out.buf[i + 0], 128);
+        ASSERT_EQ(out.buf[i + 1], 128);
+        ASSERT_EQ(out.buf[i + 2], 128);
+        ASSERT_EQ(out.buf[i + 3], 255);
+    }
+}
+
+TEST(VPP_CPU_REF, ResultDoesNotDependOnThreadCount) {
+    TestSurface in(MFX_FOURCC_RGB4, 97, 61);
+    for (size_t i = 0; i < in.buf.size(); i++)
+        in.buf[i] = (mfxU8)((i * 31) ^ (i >> 5));
+
+    TestSurface ref(MFX_FOURCC_NV12, 80, 46), out(MFX_FOURCC_NV12, 80, 46);
+    EXPECT_EQ(RunCpuVpp(1, in, ref), MFX_ERR_NONE);
+    EXPECT_EQ(RunCpuVpp(5, in, out), MFX_ERR_NONE);
+    EXPECT_EQ(ref.buf, out.buf);
+}
+
+TEST(VPP_CPU_REF, FrameRateDoubling) {
+    TestSurface in(MFX_FOURCC_NV12, 16, 16), out(MFX_FOURCC_NV12, 16, 16);
+    mfxFrameInfo outInfo  = out.surf.Info;
+    outInfo.FrameRateExtN = 60;
+
+    CCpuVPP vpp(1);
+    mfxVideoParam par = CpuVppParams(in.surf.Info, outInfo);
+    ASSERT_EQ(vpp.Init(&par), MFX_ERR_NONE);
+
+    mfxSyncPoint syncp     = nullptr;
+    in.surf.Data.TimeStamp = 3000;
+    EXPECT_EQ(vpp.RunFrameVPPAsync(&in.surf, &out.surf, nullptr, &syncp), MFX_ERR_MORE_SURFACE);
+    EXPECT_EQ(out.surf.Data.TimeStamp, 3000u);
+    EXPECT_EQ(vpp.RunFrameVPPAsync(&in.surf, &out.surf, nullptr, &syncp), MFX_ERR_NONE);
+    EXPECT_EQ(out.surf.Data.TimeStamp, (mfxU64)MFX_TIMESTAMP_UNKNOWN);
+    EXPECT_EQ(vpp.SyncOperation(syncp, MSDK_VPP_WAIT_INTERVAL), MFX_ERR_NONE);
+}
+
+TEST(VPP_QUALITY, CRC32KnownValue) {
+    const char* str = "123456789";
+    EXPECT_EQ(CQualityChecker::CRC32(0, (const mfxU8*)str, 9), 0xCBF43926u);
+    // chained calls are the same as one call
+    mfxU32 crc = CQualityChecker::CRC32(0, (const mfxU8*)str, 4);
+    EXPECT_EQ(CQualityChecker::CRC32(crc, (const mfxU8*)str + 4, 5), 0xCBF43926u);
+}
+
+TEST(VPP_QUALITY, CRC32CombineMatchesSequential) {
+    std::vector<mfxU8> data(1000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (mfxU8)(i * 13 + (i >> 3));
+
+    mfxU32 full = CQualityChecker::CRC32(0, data.data(), data.size());
+    for (size_t split : { 0, 1, 3, 517, 999, 1000 }) {
+        mfxU32 a = CQualityChecker::CRC32(0, data.data(), split);
+        mfxU32 b = CQualityChecker::CRC32(0, data.data() + split, data.size() - split);
+        EXPECT_EQ(CQualityChecker::CRC32Combine(a, b, data.size() - split), full) << split;
+    }
+}
+
+TEST(VPP_QUALITY, PlaneCRCMatchesFileLayout) {
+    TestSurface in(MFX_FOURCC_NV12, 64, 70);
+    for (size_t i = 0; i < in.buf.size(); i++)
+        in.buf[i] = (mfxU8)((i * 31) ^ (i >> 4));
+
+    std::vector<sQualityPlane> planes;
+    ASSERT_EQ(CQualityChecker::GetPlanes(in.surf.Info, in.surf.Data, MFX_FOURCC_I420, planes),
+              MFX_ERR_NONE);
+    ASSERT_EQ(planes.size(), 3u);
+
+    // U plane of an I420 file is every other byte of the NV12 chroma
+    std::vector<mfxU8> u;
+    for (size_t i = 64 * 70; i < in.buf.size(); i += 2)
+        u.push_back(in.buf[i]);
+
+    for (mfxU32 threads : { 1, 3 }) {
+        sQualityCheckParams params;
+        params.numThreads = threads;
+        CQualityChecker checker;
+        ASSERT_EQ(checker.Init(params), MFX_ERR_NONE);
+        EXPECT_EQ(checker.PlaneCRC(planes[0]), CQualityChecker::CRC32(0, in.buf.data(), 64 * 70));
+        EXPECT_EQ(checker.PlaneCRC(planes[1]), CQualityChecker::CRC32(0, u.data(), u.size()));
+    }
+}
+
+TEST(VPP_QUALITY, IdenticalPlanes) {
+    TestSurface a(MFX_FOURCC_RGB4, 37, 21), b(MFX_FOURCC_RGB4, 37, 21);
+    for (size_t i = 0; i < a.buf.size(); i++)
+        a.buf[i] = b.buf[i] = (mfxU8)(i * 7);
+
+    std::vector<sQualityPlane> pa, pb;
+    ASSERT_EQ(CQualityChecker::GetPlanes(a.surf.Info, a.surf.Data, 0, pa), MFX_ERR_NONE);
+    ASSERT_EQ(CQualityChecker::GetPlanes(b.surf.Info, b.surf.Data, 0, pb), MFX_ERR_NONE);
+
+    CQualityChecker checker;
+    ASSERT_EQ(checker.Init(sQualityCheckParams()), MFX_ERR_NONE);
+    EXPECT_EQ(checker.PlaneSSE(pa[0], pb[0]), 0u);
+    EXPECT_DOUBLE_EQ(CQualityChecker::PSNR(0, 37 * 21 * 4, 8), 100.0);
+    EXPECT_NEAR(checker.PlaneSSIM(pa[0], pb[0]), 1.0, 1e-9);
+
+    b.buf[5] ^= 0x10;
+    EXPECT_EQ(checker.PlaneSSE(pa[0], pb[0]), 256u);
+    EXPECT_LT(checker.PlaneSSIM(pa[0], pb[0]), 1.0);
+}
+
+TEST(VPP_QUALITY, DigestRoundTrip) {
+    const char* digest = "vpp_quality_test.crc";
+    TestSurface frame(MFX_FOURCC_NV12, 32, 16);
+    for (size_t i = 0; i < frame.buf.size(); i++)
+        frame.buf[i] = (mfxU8)i;
+
+    sQualityCheckParams params;
+    params.strDigestOut = digest;
+    CQualityChecker checker;
+    ASSERT_EQ(checker.Init(params), MFX_ERR_NONE);
+    EXPECT_EQ(checker.CheckFrame(frame.surf.Info, frame.surf.Data), MFX_ERR_NONE);
+    EXPECT_EQ(checker.CheckFrame(frame.surf.Info, frame.surf.Data), MFX_ERR_NONE);
+    checker.Close();
+
+    params.strDigestOut.clear();
+    params.strDigestIn = digest;
+    ASSERT_EQ(checker.Init(params), MFX_ERR_NONE);
+    EXPECT_EQ(checker.CheckFrame(frame.surf.Info, frame.surf.Data), MFX_ERR_NONE);
+    frame.buf[40] ^= 1;
+    EXPECT_EQ(checker.CheckFrame(frame.surf.Info, frame.surf.Data), MFX_ERR_NONE);
+    checker.Close();
+    EXPECT_EQ(checker.GetFrameCount(), 2u);
+    EXPECT_EQ(checker.GetMismatchCount(), 1u);
+
+    remove(digest);
+}
+
+TEST(VPP_PTS, RingFindAndOverwrite) {
+    PTSRing ring(3);
+    EXPECT_EQ(ring.GetCapacity(), 4u);
+
+    mfxU64 ts = 0;
+    EXPECT_FALSE(ring.Front(ts));
+    for (mfxU64 i = 0; i < 4; i++)
+        EXPECT_TRUE(ring.Push(i * 100));
+    EXPECT_FALSE(ring.Push(400));
+
+    EXPECT_FALSE(ring.Find(0, ts));
+    ASSERT_TRUE(ring.Find(4, ts));
+    EXPECT_EQ(ts, 400u);
+    ASSERT_TRUE(ring.Front(ts));
+    EXPECT_EQ(ts, 100u);
+
+    ring.Pop();
+    EXPECT_EQ(ring.GetHead(), 2u);
+    EXPECT_FALSE(ring.Find(1, ts));
+    EXPECT_FALSE(ring.Find(5, ts));
+}
+
+static mfxVideoParam PtsParams(mfxU32 inRate, mfxU32 outRate) {
+    mfxVideoParam par         = {};
+    par.vpp.In.FrameRateExtN  = inRate;
+    par.vpp.In.FrameRateExtD  = 1;
+    par.vpp.Out.FrameRateExtN = outRate;
+    par.vpp.Out.FrameRateExtD = 1;
+    return par;
+}
+
+TEST(VPP_PTS, BasicCheckCountsDroppedFrames) {
+    mfxVideoParam par = PtsParams(30, 15);
+    PTSMaker ptsMaker;
+    ASSERT_EQ(ptsMaker.Init(&par, 1), MFX_ERR_NONE);
+
+    mfxFrameSurface1 surf = {};
+    std::vector<mfxU64> inputs;
+    for (int i = 0; i < 6; i++) {
+        ptsMaker.SetPTS(&surf);
+        inputs.push_back(surf.Data.TimeStamp);
+    }
+
+    for (int i = 0; i < 6; i += 2) {
+        surf.Data.TimeStamp = inputs[i];
+        EXPECT_TRUE(ptsMaker.CheckPTS(&surf));
+    }
+    surf.Data.TimeStamp = inputs[1] + 1;
+    EXPECT_FALSE(ptsMaker.CheckPTS(&surf));
+
+    const sPTSDriftStat& stat = ptsMaker.GetDriftStat();
+    EXPECT_EQ(stat.numFrames, 3u);
+    EXPECT_EQ(stat.numDropped, 2u);
+    EXPECT_EQ(stat.numDuplicated, 0u);
+    EXPECT_EQ(stat.numMismatches, 1u);
+    EXPECT_LT(stat.maxDeviation, 1e-4);
+}
+
+static void RunAdvancedFRC(mfxU32 inRate, mfxU32 outRate, mfxU32 numIn, sPTSDriftStat& stat) {
+    mfxVideoParam par = PtsParams(inRate, outRate);
+    FRCAdvancedChecker checker;
+    ASSERT_EQ(checker.Init(&par, 1), MFX_ERR_NONE);
+
+    mfxFrameSurface1 surf = {};
+    for (mfxU32 i = 0; i < numIn; i++) {
+        surf.Data.TimeStamp = (mfxU64)i * 90000 / inRate;
+        checker.PutInputFrameAndCheck(&surf);
+    }
+    mfxU32 numOut = (numIn - 1) * outRate / inRate + 1;
+    for (mfxU32 i = 0; i < numOut; i++) {
+        surf.Data.TimeStamp = (mfxU64)i * 90000 / outRate;
+        EXPECT_TRUE(checker.PutOutputFrameAndCheck(&surf)) << "output frame " << i;
+    }
+    ASSERT_NE(checker.GetDriftStat(), nullptr);
+    stat = *checker.GetDriftStat();
+}
+
+TEST(VPP_PTS, AdvancedFRCDoubling) {
+    sPTSDriftStat stat;
+    RunAdvancedFRC(30, 60, 5, stat);
+    EXPECT_EQ(stat.numFrames, 9u);
+    EXPECT_EQ(stat.numDuplicated, 4u);
+    EXPECT_EQ(stat.numDropped, 0u);
+    EXPECT_EQ(stat.numMismatches, 0u);
+    EXPECT_EQ(stat.maxDeviation, 0.0);
+}
+
+TEST(VPP_PTS, AdvancedFRCHalving) {
+    sPTSDriftStat stat;
+    RunAdvancedFRC(60, 30, 9, stat);
+    EXPECT_EQ(stat.numFrames, 5u);
+    EXPECT_EQ(stat.numDuplicated, 0u);
+    EXPECT_EQ(stat.numDropped, 4u);
+    EXPECT_EQ(stat.numMismatches, 0u);
+}
+
+// an input which is late for its output slot stays queued and is matched with the
+// next slot, so only the slot before it counts as a repeated frame
+TEST(VPP_PTS, AdvancedFRCKeepsLateInputQueued) {
+    mfxVideoParam par = PtsParams(30, 30);
+    FRCAdvancedChecker checker;
+    ASSERT_EQ(checker.Init(&par, 1), MFX_ERR_NONE);
+
+    // input frame 1 is missing
+    mfxFrameSurface1 surf = {};
+    for (mfxU64 i : { 0, 2, 3, 4 }) {
+        surf.Data.TimeStamp = i * 3000;
+        checker.PutInputFrameAndCheck(&surf);
+    }
+    for (mfxU64 i = 0; i < 5; i++) {
+        surf.Data.TimeStamp = i * 3000;
+        EXPECT_TRUE(checker.PutOutputFrameAndCheck(&surf)) << "output frame " << i;
+    }
+
+    const sPTSDriftStat* stat = checker.GetDriftStat();
+    EXPECT_EQ(stat->numFrames, 5u);
+    EXPECT_EQ(stat->numDuplicated, 1u);
+    EXPECT_EQ(stat->numDropped, 0u);
+    EXPECT_EQ(stat->numMismatches, 0u);
+
+    // all inputs are matched, a further output repeats the last frame
+    surf.Data.TimeStamp = 5 * 3000;
+    EXPECT_TRUE(checker.PutOutputFrameAndCheck(&surf));
+    EXPECT_EQ(checker.GetDriftStat()->numDuplicated, 2u);
+}
+
+TEST(VPP_ROI, ScheduleIsDeterministic) {
+    ROIGenerator a, b, c;
+    ASSERT_EQ(a.Init(352, 288, 7, 50), MFX_ERR_NONE);
+    ASSERT_EQ(b.Init(352, 288, 7, 50), MFX_ERR_NONE);
+    ASSERT_EQ(c.Init(352, 288, 8, 50), MFX_ERR_NONE);
+
+    mfxFrameInfo infoA = {}, infoB = {};
+    for (int i = 0; i < 50; i++) {
+        a.SetROI(&infoA);
+        b.SetROI(&infoB);
+        ASSERT_EQ(memcmp(&infoA, &infoB, sizeof(infoA)), 0) << "frame " << i;
+    }
+
+    bool bDiffer = false;
+    for (size_t i = 0; i < 50; i++) {
+        const sROIRect& ra = a.GetSchedule()[i];
+        const sROIRect& rc = c.GetSchedule()[i];
+        bDiffer |= ra.x != rc.x || ra.y != rc.y || ra.w != rc.w || ra.h != rc.h;
+    }
+    EXPECT_TRUE(bDiffer);
+}
+
+TEST(VPP_ROI, ScheduleFitsFrame) {
+    ROIGenerator gen;
+    ASSERT_EQ(gen.Init(176, 144, 3), MFX_ERR_NONE);
+
+    // unknown length, schedule grows past the first batch
+    mfxFrameInfo info = {};
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_EQ(gen.SetROI(&info), MFX_ERR_NONE);
+        ASSERT_EQ(info.CropW % 16, 0);
+        ASSERT_EQ(info.CropH % 32, 0);
+        ASSERT_EQ(info.CropX % 2, 0);
+        ASSERT_EQ(info.CropY % 2, 0);
+        ASSERT_GE(info.CropW, 16);
+        ASSERT_GE(info.CropH, 32);
+        ASSERT_LE(info.CropX + info.CropW, 176);
+        ASSERT_LE(info.CropY + info.CropH, 144);
+    }
+    EXPECT_EQ(gen.GetNumUsed(), 1000u);
+    EXPECT_GE(gen.GetSchedule().size(), 1000u);
+}
+
+TEST(VPP_ROI, SaveSchedule) {
+    const char* fileName = "vpp_roi_test.txt";
+    ROIGenerator gen;
+    ASSERT_EQ(gen.Init(176, 144, 5, 4), MFX_ERR_NONE);
+    mfxFrameInfo info = {};
+    gen.SetROI(&info);
+    gen.SetROI(&info);
+    ASSERT_EQ(gen.SaveSchedule(fileName), MFX_ERR_NONE);
+
+    FILE* f = fopen(fileName, "r");
+    ASSERT_NE(f, nullptr);
+    char line[256];
+    std::vector<std::string> lines;
+    while (fgets(line, sizeof(line), f))
+        if (line[0] != '#')
+            lines.push_back(line);
+    fclose(f);
+    remove(fileName);
+
+    ASSERT_EQ(lines.size(), 2u);
+    char expected[64];
+    snprintf(expected,
+             sizeof(expected),
+             "1 %u %u %u %u\n",
+             info.CropX,
+             info.CropY,
+             info.CropW,
+             info.CropH);
+    EXPECT_EQ(lines[1], expected);
+
+    EXPECT_EQ(gen.SaveSchedule(fileName, 5), MFX_ERR_NOT_ENOUGH_BUFFER);
+}